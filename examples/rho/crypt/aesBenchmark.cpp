@@ -0,0 +1,131 @@
+#include <rho/crypt/tEncAES.h>
+#include <rho/crypt/tDecAES.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+
+/*
+ * Times tEncAES and tDecAES in each mode, for each key length, with the
+ * fast ASM impl (when this cpu has AES-NI) and with the fallback impl.
+ * CBC encryption can only do one block at a time; CTR and GCM (and ECB,
+ * and CBC decryption) could do several.
+ *
+ * Figures are GB/s.
+ *
+ * Usage:  ./a.out [megabytes] [iterations]
+ */
+
+
+static
+void s_report(string name, u64 elapsed, u32 numbytes, u32 iterations)
+{
+    f64 gbps = ((f64)numbytes * iterations) / ((f64)elapsed * 1000.0);
+    cout << std::setw(14) << name << std::setw(10) << gbps << endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 megabytes = (argc > 1) ? (u32) atoi(argv[1]) : 1;
+    u32 iterations = (argc > 2) ? (u32) atoi(argv[2]) : 100;
+
+    u32 numbytes = megabytes * 1024 * 1024;
+    u32 numblocks = numbytes / AES_BLOCK_SIZE;
+    vector<u8> pt(numbytes);
+    vector<u8> ct(numbytes);
+    for (u32 i = 0; i < numbytes; i++)
+        pt[i] = (u8)(rand() % 256);
+
+    u8 key[32];
+    for (u32 i = 0; i < sizeof(key); i++)
+        key[i] = (u8)(rand() % 256);
+    u8 iv[AES_BLOCK_SIZE] = { 0 };
+    u8 nonce[12] = { 0 };
+    u8 aad[13] = { 0 };
+    u8 tag[AES_BLOCK_SIZE];
+
+    cout << megabytes << " MB, " << iterations << " iterations" << endl;
+    cout << std::fixed << std::setprecision(2);
+
+    const crypt::nKeyLengthAES kKeyLens[] = { crypt::k128bit, crypt::k256bit };
+    const char* kKeyLenNames[] = { "128", "256" };
+
+    for (int impl = 0; impl < 2; impl++)
+    {
+        bool useFastASM = (impl == 0);
+        if (useFastASM && !crypt::tEncAES::canRunFastASM())
+            continue;
+
+        for (int k = 0; k < 2; k++)
+        {
+            crypt::nKeyLengthAES keylen = kKeyLens[k];
+            cout << endl << (useFastASM ? "AES-NI" : "fallback") << ", "
+                 << kKeyLenNames[k] << "-bit key:" << endl;
+
+            {
+                crypt::tEncAES aes(crypt::kOpModeECB, key, keylen, useFastASM);
+                u64 start = sync::tTimer::usecTime();
+                for (u32 i = 0; i < iterations; i++)
+                    aes.enc(&pt[0], &ct[0], numblocks);
+                s_report("ECB", sync::tTimer::usecTime() - start, numbytes, iterations);
+            }
+
+            {
+                crypt::tEncAES aes(crypt::kOpModeCBC, key, keylen, useFastASM);
+                u64 start = sync::tTimer::usecTime();
+                for (u32 i = 0; i < iterations; i++)
+                    aes.enc(&pt[0], &ct[0], numblocks, iv);
+                s_report("CBC enc", sync::tTimer::usecTime() - start, numbytes, iterations);
+            }
+
+            {
+                crypt::tDecAES aes(crypt::kOpModeCBC, key, keylen, useFastASM);
+                u64 start = sync::tTimer::usecTime();
+                for (u32 i = 0; i < iterations; i++)
+                    aes.dec(&ct[0], &pt[0], numblocks, iv);
+                s_report("CBC dec", sync::tTimer::usecTime() - start, numbytes, iterations);
+            }
+
+            {
+                crypt::tEncAES aes(crypt::kOpModeCTR, key, keylen, useFastASM);
+                u64 start = sync::tTimer::usecTime();
+                for (u32 i = 0; i < iterations; i++)
+                    aes.enc(&pt[0], &ct[0], numblocks, iv);
+                s_report("CTR", sync::tTimer::usecTime() - start, numbytes, iterations);
+            }
+
+            {
+                crypt::tEncAES aes(crypt::kOpModeGCM, key, keylen, useFastASM);
+                u64 start = sync::tTimer::usecTime();
+                for (u32 i = 0; i < iterations; i++)
+                    aes.encGCM(&pt[0], &ct[0], numbytes, nonce, aad, sizeof(aad), tag);
+                s_report("GCM enc", sync::tTimer::usecTime() - start, numbytes, iterations);
+            }
+
+            {
+                crypt::tDecAES aes(crypt::kOpModeGCM, key, keylen, useFastASM);
+                u64 start = sync::tTimer::usecTime();
+                for (u32 i = 0; i < iterations; i++)
+                    aes.decGCM(&ct[0], &pt[0], numbytes, nonce, aad, sizeof(aad), tag);
+                s_report("GCM dec", sync::tTimer::usecTime() - start, numbytes, iterations);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <rho/crypt/tAdler32.h>
+#include <rho/crypt/tCRC32C.h>
+#include <rho/crypt/tMD5.h>
+#include <rho/crypt/tSHA1.h>
+#include <rho/crypt/tXXHash64.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+
+/*
+ * Times the non-cryptographic hashes and checksums (xxHash64, CRC-32C
+ * with and without the crc32 instruction, Adler-32 at each SIMD level)
+ * against tMD5 and tSHA1, over 64 B, 4 KB and 1 MB messages.
+ *
+ * Figures are GB/s.
+ *
+ * Usage:  ./a.out [megabytesPerSize]
+ */
+
+
+static const u32 kSizes[] = { 64, 4096, 1024*1024 };
+static const char* kSizeNames[] = { "64 B", "4 KB", "1 MB" };
+
+
+static u64 gSink = 0;     // so the compiler can't skip the work
+
+
+static
+void s_report(string name, u64 elapsed, u64 numbytes)
+{
+    f64 gbps = (f64)numbytes / ((f64)elapsed * 1000.0);
+    cout << std::setw(18) << name << std::setw(10) << gbps << endl;
+}
+
+
+template <class Hasher>
+void s_timeHasher(string name, const vector<u8>& buf, u32 size)
+{
+    u64 start = sync::tTimer::usecTime();
+    for (size_t pos = 0; pos + size <= buf.size(); pos += size)
+    {
+        Hasher h;
+        h.write(&buf[pos], (i32)size);
+        gSink += h.getHash()[0];
+    }
+    s_report(name, sync::tTimer::usecTime() - start, buf.size() / size * size);
+}
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 megabytes = (argc > 1) ? (u32) atoi(argv[1]) : 64;
+
+    vector<u8> buf(megabytes * 1024 * 1024);
+    for (size_t i = 0; i < buf.size(); i++)
+        buf[i] = (u8)(rand() % 256);
+
+    cout << megabytes << " MB per message size" << endl;
+    cout << std::fixed << std::setprecision(2);
+
+    for (size_t s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); s++)
+    {
+        u32 size = kSizes[s];
+        u64 numbytes = buf.size() / size * size;
+        cout << endl << "messages of " << kSizeNames[s] << endl;
+
+        u64 start = sync::tTimer::usecTime();
+        for (size_t pos = 0; pos + size <= buf.size(); pos += size)
+            gSink += crypt::xxhash64(&buf[pos], size, 0);
+        s_report("xxhash64", sync::tTimer::usecTime() - start, numbytes);
+
+        start = sync::tTimer::usecTime();
+        for (size_t pos = 0; pos + size <= buf.size(); pos += size)
+            gSink += crypt::crc32c(0, &buf[pos], size, true);
+        s_report("crc32c (SSE4.2)", sync::tTimer::usecTime() - start, numbytes);
+
+        start = sync::tTimer::usecTime();
+        for (size_t pos = 0; pos + size <= buf.size(); pos += size)
+            gSink += crypt::crc32c(0, &buf[pos], size, false);
+        s_report("crc32c (tables)", sync::tTimer::usecTime() - start, numbytes);
+
+        for (int level = kSimdNone; level <= getSimdLevel(); level++)
+        {
+            start = sync::tTimer::usecTime();
+            for (size_t pos = 0; pos + size <= buf.size(); pos += size)
+                gSink += crypt::adler32(1, &buf[pos], size, (nSimdLevel)level);
+            s_report("adler32 (" + simdLevelEnumToString((nSimdLevel)level) + ")",
+                     sync::tTimer::usecTime() - start, numbytes);
+        }
+
+        s_timeHasher<crypt::tMD5>("tMD5", buf, size);
+        s_timeHasher<crypt::tSHA1>("tSHA1", buf, size);
+    }
+
+    cout << endl << "(" << gSink % 10 << ")" << endl;
+
+    return 0;
+}
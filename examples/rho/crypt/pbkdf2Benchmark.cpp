@@ -0,0 +1,96 @@
+#include <rho/crypt/hash_utils.h>
+#include <rho/sync/tThreadPool.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+
+/*
+ * Times PBKDF2-HMAC-SHA256 and PBKDF2-HMAC-Whirlpool. "per call" hands
+ * pbkdf2() a prf it doesn't recognize, so every iteration re-keys a new
+ * HMAC (which is how pbkdf2() used to work for every prf); "cached" keys
+ * one tHmac per output block; "pool" also computes the output blocks on
+ * a thread pool.
+ *
+ * Times are milliseconds per derived key.
+ *
+ * Usage:  ./a.out [iterations] [dklen] [numThreads] [repeats]
+ */
+
+
+static
+vector<u8> s_opaqueSha256(const vector<u8>& key, const vector<u8>& message)
+{
+    return crypt::hmac_sha256(key, message);
+}
+
+static
+vector<u8> s_opaqueWhirlpool(const vector<u8>& key, const vector<u8>& message)
+{
+    return crypt::hmac_whirlpool(key, message);
+}
+
+
+static
+void s_report(string name, u64 elapsed, u32 repeats)
+{
+    cout << std::setw(22) << name << std::setw(12) << ((f64)elapsed / 1000.0) / repeats << endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 iterations = (argc > 1) ? (u32) atoi(argv[1]) : 100000;
+    u32 dklen = (argc > 2) ? (u32) atoi(argv[2]) : 128;
+    u32 numThreads = (argc > 3) ? (u32) atoi(argv[3]) : 4;
+    u32 repeats = (argc > 4) ? (u32) atoi(argv[4]) : 3;
+
+    string passStr = "correct horse battery staple";
+    string saltStr = "NaCl, but more of it";
+    vector<u8> pass(passStr.begin(), passStr.end());
+    vector<u8> salt(saltStr.begin(), saltStr.end());
+
+    sync::tThreadPool pool(numThreads);
+
+    cout << iterations << " iterations, dklen " << dklen << ", "
+         << numThreads << " threads" << endl;
+    cout << std::fixed << std::setprecision(2);
+
+    const crypt::hmac_func kFast[] = { crypt::hmac_sha256, crypt::hmac_whirlpool };
+    const crypt::hmac_func kOpaque[] = { s_opaqueSha256, s_opaqueWhirlpool };
+    const char* kNames[] = { "SHA256", "Whirlpool" };
+
+    for (int h = 0; h < 2; h++)
+    {
+        u64 start = sync::tTimer::usecTime();
+        for (u32 i = 0; i < repeats; i++)
+            crypt::pbkdf2(kOpaque[h], pass, salt, iterations, dklen);
+        s_report(string(kNames[h]) + " per call", sync::tTimer::usecTime() - start, repeats);
+
+        start = sync::tTimer::usecTime();
+        for (u32 i = 0; i < repeats; i++)
+            crypt::pbkdf2(kFast[h], pass, salt, iterations, dklen);
+        s_report(string(kNames[h]) + " cached", sync::tTimer::usecTime() - start, repeats);
+
+        start = sync::tTimer::usecTime();
+        for (u32 i = 0; i < repeats; i++)
+            crypt::pbkdf2(kFast[h], pass, salt, iterations, dklen, pool);
+        s_report(string(kNames[h]) + " pool", sync::tTimer::usecTime() - start, repeats);
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <rho/crypt/hash_utils.h>
+#include <rho/crypt/tSHA1.h>
+#include <rho/crypt/tSHA256.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+
+/*
+ * Times SHA-1 and SHA-256 over lots of 64 B, 4 KB and 1 MB messages: one
+ * tSHA1/tSHA256 per message, then sha1_batch()/sha256_batch() with each
+ * impl this cpu can run.
+ *
+ * Figures are GB/s.
+ *
+ * Usage:  ./a.out [megabytesPerSize]
+ */
+
+
+static const u32 kSizes[] = { 64, 4096, 1024*1024 };
+static const char* kSizeNames[] = { "64 B", "4 KB", "1 MB" };
+
+static const crypt::nShaImpl kImpls[] = { crypt::kShaImplPortable,
+                                          crypt::kShaImplSHANI,
+                                          crypt::kShaImplAVX2x8 };
+static const char* kImplNames[] = { "batch portable", "batch SHA-NI", "batch AVX2 x8" };
+
+
+static
+void s_report(string name, u64 elapsed, u64 numbytes)
+{
+    f64 gbps = (f64)numbytes / ((f64)elapsed * 1000.0);
+    cout << std::setw(18) << name << std::setw(10) << gbps << endl;
+}
+
+
+template <class Hasher>
+void s_time(string name, const vector<const u8*>& messages, const vector<u32>& lengths,
+            void (*batch)(const u8* const[], const u32[], u32, u8*, crypt::nShaImpl))
+{
+    u32 count = (u32)messages.size();
+    u64 numbytes = (u64)count * lengths[0];
+    vector<u8> hashes(count * Hasher::kHashSize);
+
+    cout << name << ":" << endl;
+
+    u64 start = sync::tTimer::usecTime();
+    for (u32 m = 0; m < count; m++)
+    {
+        Hasher h;
+        h.write(messages[m], (i32)lengths[m]);
+        h.getHash(&hashes[m * Hasher::kHashSize]);
+    }
+    s_report("iHasher", sync::tTimer::usecTime() - start, numbytes);
+
+    for (size_t i = 0; i < sizeof(kImpls) / sizeof(kImpls[0]); i++)
+    {
+        if (!crypt::canRunShaImpl(kImpls[i]))
+            continue;
+        start = sync::tTimer::usecTime();
+        batch(&messages[0], &lengths[0], count, &hashes[0], kImpls[i]);
+        s_report(kImplNames[i], sync::tTimer::usecTime() - start, numbytes);
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 megabytes = (argc > 1) ? (u32) atoi(argv[1]) : 64;
+
+    vector<u8> buf(megabytes * 1024 * 1024);
+    for (size_t i = 0; i < buf.size(); i++)
+        buf[i] = (u8)(rand() % 256);
+
+    cout << megabytes << " MB per message size" << endl;
+    cout << std::fixed << std::setprecision(2);
+
+    for (size_t s = 0; s < sizeof(kSizes) / sizeof(kSizes[0]); s++)
+    {
+        u32 count = (u32)(buf.size() / kSizes[s]);
+        vector<const u8*> messages(count);
+        vector<u32> lengths(count, kSizes[s]);
+        for (u32 m = 0; m < count; m++)
+            messages[m] = &buf[m * kSizes[s]];
+
+        cout << endl << count << " messages of " << kSizeNames[s] << endl;
+        s_time<crypt::tSHA1>("SHA-1", messages, lengths, crypt::sha1_batch);
+        s_time<crypt::tSHA256>("SHA-256", messages, lengths, crypt::sha256_batch);
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include <rho/img/nImageFormat.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+using std::vector;
+
+
+/*
+ * Measures colorspace_conversion() throughput for each pair of formats,
+ * once per instruction set this cpu supports. Every level produces the
+ * same bytes; see tests/rho/img/nImageFormatTest.cpp.
+ *
+ * All figures are megapixels per second.
+ *
+ * Usage:  ./a.out [width] [height] [iterations]
+ */
+
+
+static const char* kNames[] = { "RGB16", "RGB24", "RGBA", "BGRA", "YUYV", "Grey",
+                                "I420", "NV12", "Planar" };
+
+
+f64 mpixPerSec(img::nImageFormat from, img::nImageFormat to, nSimdLevel level,
+               vector<u8>& source, vector<u8>& dest, u32 width, u32 height, u32 iterations)
+{
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        img::colorspace_conversion(from, to, width, height, level,
+                                   &source[0], (i32)img::getBufSize(from, width, height),
+                                   &dest[0], (i32)dest.size());
+    }
+    u64 elapsed = sync::tTimer::usecTime() - start;
+    return ((f64)width * height * iterations / 1000000.0) / ((f64)elapsed / 1000000.0);
+}
+
+
+/*
+ * Whether colorspace_conversion() does this pair at all.
+ */
+static
+bool s_isImplemented(img::nImageFormat from, img::nImageFormat to, vector<u8>& source, vector<u8>& dest)
+{
+    try
+    {
+        img::colorspace_conversion(from, to, 2, 2, &source[0], (i32)img::getBufSize(from, 2, 2),
+                                   &dest[0], (i32)dest.size());
+        return true;
+    }
+    catch (eNotImplemented& e)
+    {
+        return false;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 width = (argc > 1) ? (u32) atoi(argv[1]) : 1920;
+    u32 height = (argc > 2) ? (u32) atoi(argv[2]) : 1080;
+    u32 iterations = (argc > 3) ? (u32) atoi(argv[3]) : 100;
+
+    u32 numPixels = width * height;
+    vector<u8> source(numPixels * 4);
+    vector<u8> dest(numPixels * 4);
+    for (size_t i = 0; i < source.size(); i++)
+        source[i] = (u8)(rand() % 256);
+
+    cout << width << "x" << height << ", " << iterations << " iterations, "
+         << "cpu supports " << simdLevelEnumToString(getSimdLevel()) << endl;
+    cout << std::setw(16) << " ";
+    for (i32 level = kSimdNone; level <= getSimdLevel(); level++)
+        cout << std::setw(10) << simdLevelEnumToString((nSimdLevel)level);
+    cout << endl;
+
+    cout << std::fixed << std::setprecision(1);
+    for (i32 f = img::kRGB24; f < img::kMaxImageFormat; f++)
+    {
+        for (i32 t = img::kRGB24; t < img::kMaxImageFormat; t++)
+        {
+            if (f == t)
+                continue;
+            img::nImageFormat from = (img::nImageFormat) f;
+            img::nImageFormat to = (img::nImageFormat) t;
+            if (!s_isImplemented(from, to, source, dest))
+                continue;
+            cout << std::setw(6) << kNames[f] << " -> " << std::setw(6) << kNames[t];
+            for (i32 level = kSimdNone; level <= getSimdLevel(); level++)
+            {
+                cout << std::setw(10) << mpixPerSec(from, to, (nSimdLevel)level,
+                                                    source, dest, width, height, iterations);
+            }
+            cout << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <rho/img/tImage.h>
+#include <rho/sync/tThreadPool.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+
+
+/*
+ * Times the banded tImage filters on a pool of 1, 2, ... N threads. The
+ * output of every run is the same as the single-threaded filter's; see
+ * tests/rho/img/tImageTest.cpp.
+ *
+ * All figures are milliseconds per call.
+ *
+ * Usage:  ./a.out [maxThreads] [width] [height] [iterations]
+ */
+
+
+static
+void s_fill(img::tImage* image, u32 width, u32 height)
+{
+    image->setBufSize(width*height*3);
+    image->setBufUsed(width*height*3);
+    image->setWidth(width);
+    image->setHeight(height);
+    image->setFormat(img::kRGB24);
+    for (u32 i = 0; i < image->bufUsed(); i++)
+        image->buf()[i] = (u8)(rand() % 256);
+}
+
+
+f64 msecPerCall(const img::tImage& image, u32 filter, sync::tThreadPool& pool, u32 iterations)
+{
+    img::tImage dest;
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        switch (filter)
+        {
+            case 0: image.medianFilter(&dest, 3, 3, pool); break;
+            case 1: image.medianFilter(&dest, 15, 15, pool); break;
+            case 2: image.sobel(&dest, 255, pool); break;
+            case 3: image.adaptiveThreshold(&dest, -1, 5, 127, pool); break;
+            case 4: image.scale(image.width()/3, image.height()/3, &dest, pool); break;
+            case 5: image.rotate(30.0, &dest, pool); break;
+            case 6: image.bradleyThreshold(&dest, (image.width()/8) | 1, 15, pool); break;
+            case 7: image.boxBlur(&dest, 15, 15, pool); break;
+            case 8: image.localStdDev(&dest, 15, 15, pool); break;
+            case 9: image.canny(&dest, 200, 400, pool); break;
+            default: break;
+        }
+    }
+    u64 elapsed = sync::tTimer::usecTime() - start;
+    return ((f64)elapsed / 1000.0) / iterations;
+}
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 maxThreads = (argc > 1) ? (u32) atoi(argv[1]) : 4;
+    u32 width = (argc > 2) ? (u32) atoi(argv[2]) : 3840;
+    u32 height = (argc > 3) ? (u32) atoi(argv[3]) : 2160;
+    u32 iterations = (argc > 4) ? (u32) atoi(argv[4]) : 3;
+
+    img::tImage image;
+    s_fill(&image, width, height);
+
+    const char* names[] = { "median 3x3", "median 15x15", "sobel", "adaptiveThreshold", "scale 1/3", "rotate 30",
+                            "bradleyThreshold", "boxBlur 15x15", "localStdDev 15x15", "canny" };
+
+    cout << width << "x" << height << ", " << iterations << " iterations" << endl;
+    cout << std::setw(20) << "threads:";
+    for (u32 n = 1; n <= maxThreads; n++)
+        cout << std::setw(10) << n;
+    cout << endl;
+
+    cout << std::fixed << std::setprecision(1);
+    for (u32 f = 0; f < 10; f++)
+    {
+        cout << std::setw(20) << names[f];
+        for (u32 n = 1; n <= maxThreads; n++)
+        {
+            sync::tThreadPool pool(n);
+            cout << std::setw(10) << msecPerCall(image, f, pool, iterations) << std::flush;
+        }
+        cout << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <rho/img/tImage.h>
+#include <rho/img/tGradient.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+
+
+/*
+ * Times tGradient for each operator and norm, with and without the
+ * orientation plane, once per instruction set this cpu supports. For
+ * scale, the first line is the per-pixel loop tImage::sobel() used to
+ * run (magnitudes only), and the last lines are sobel() and canny().
+ *
+ * All figures are milliseconds per frame.
+ *
+ * Usage:  ./a.out [width] [height] [iterations]
+ */
+
+
+static
+void s_oldSobel(const img::tImage& orig, img::tImage* edges)
+{
+    u32 bpp = img::getBPP(orig.format());
+    edges->setFormat(orig.format());
+    edges->setWidth(orig.width() - 2);
+    edges->setHeight(orig.height() - 2);
+    edges->setBufSize(edges->width() * edges->height() * bpp);
+    edges->setBufUsed(edges->bufSize());
+    for (u32 row = 0; row < edges->height(); row++)
+    {
+        for (u32 col = 0; col < edges->width(); col++)
+        {
+            for (u32 k = 0; k < bpp; k++)
+            {
+                u32 a = orig[row+0][col+0][k], b = orig[row+0][col+1][k], c = orig[row+0][col+2][k];
+                u32 d = orig[row+1][col+0][k],                            f = orig[row+1][col+2][k];
+                u32 g = orig[row+2][col+0][k], h = orig[row+2][col+1][k], i = orig[row+2][col+2][k];
+                u32 gx = 1*a + 2*d + 1*g - 1*c - 2*f - 1*i;
+                u32 gy = 1*a + 2*b + 1*c - 1*g - 2*h - 1*i;
+                u32 grad = (u32) round(std::sqrt((f64)(gx*gx + gy*gy)));
+                (*edges)[row][col][k] = (u8) std::min(grad, (u32)255);
+            }
+        }
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 width = (argc > 1) ? (u32) atoi(argv[1]) : 1920;
+    u32 height = (argc > 2) ? (u32) atoi(argv[2]) : 1080;
+    u32 iterations = (argc > 3) ? (u32) atoi(argv[3]) : 10;
+
+    img::tImage frame(width * height);
+    frame.setBufUsed(width * height);
+    frame.setWidth(width);
+    frame.setHeight(height);
+    frame.setFormat(img::kGrey);
+    for (u32 i = 0; i < frame.bufUsed(); i++)
+        frame.buf()[i] = (u8)(rand() % 256);
+
+    img::tImage dest;
+
+    cout << width << "x" << height << " grey, " << iterations << " iterations" << endl;
+    cout << std::fixed << std::setprecision(2);
+
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+        s_oldSobel(frame, &dest);
+    u64 elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(20) << "old sobel loop" << std::setw(10)
+         << ((f64)elapsed / 1000.0) / iterations << endl;
+
+    cout << std::setw(20) << " ";
+    for (i32 level = kSimdNone; level <= getSimdLevel(); level++)
+        cout << std::setw(10) << simdLevelEnumToString((nSimdLevel)level);
+    cout << endl;
+
+    const char* names[] = { "sobel L1", "sobel L2", "scharr L1", "scharr L2" };
+    for (i32 withOrientation = 0; withOrientation < 2; withOrientation++)
+    {
+        for (i32 n = 0; n < 4; n++)
+        {
+            cout << std::setw(14) << names[n] << (withOrientation ? " +dirs" : "      ");
+            for (i32 level = kSimdNone; level <= getSimdLevel(); level++)
+            {
+                img::tGradient gradient((img::nGradientOperator)(n / 2), (img::nGradientNorm)(n % 2),
+                                        withOrientation != 0, (nSimdLevel)level);
+                start = sync::tTimer::usecTime();
+                for (u32 i = 0; i < iterations; i++)
+                    gradient.compute(&frame);
+                elapsed = sync::tTimer::usecTime() - start;
+                cout << std::setw(10) << ((f64)elapsed / 1000.0) / iterations;
+            }
+            cout << endl;
+        }
+    }
+
+    start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+        frame.sobel(&dest);
+    elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(20) << "tImage::sobel" << std::setw(10)
+         << ((f64)elapsed / 1000.0) / iterations << endl;
+
+    start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+        frame.canny(&dest, 200, 400);
+    elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(20) << "tImage::canny" << std::setw(10)
+         << ((f64)elapsed / 1000.0) / iterations << endl;
+
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include <rho/img/tImage.h>
+#include <rho/sync/tThreadPool.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+
+
+/*
+ * Times the brute-force houghCircles() (run on the sobel() edges, as it
+ * expects) against the gradient-voting houghCirclesGradient(), serially
+ * and on a pool of 1, 2, 4, ... threads, on a synthetic grey image of
+ * filled discs. Every centre and radius is searched at a step of 1.
+ *
+ * Times are milliseconds per call, and the strongest few circles each
+ * finds are printed next to the discs that were drawn.
+ *
+ * Usage:  ./a.out [maxThreads] [width] [height] [numDiscs] [minRadius] [maxRadius]
+ */
+
+
+static
+void s_drawDiscs(img::tImage* image, u32 numDiscs, u32 minRadius, u32 maxRadius)
+{
+    u32 width = image->width();
+    u32 height = image->height();
+    memset(image->buf(), 128, image->bufUsed());
+    for (u32 n = 0; n < numDiscs; n++)
+    {
+        u32 r = minRadius + (u32)rand() % (maxRadius - minRadius + 1);
+        u32 x = r + 2 + (u32)rand() % (width - 2*r - 4);
+        u32 y = r + 2 + (u32)rand() % (height - 2*r - 4);
+        u8 shade = (rand() % 2) ? 255 : 0;
+        for (u32 row = y - r; row <= y + r; row++)
+            for (u32 col = x - r; col <= x + r; col++)
+                if ((col-x)*(col-x) + (row-y)*(row-y) <= r*r)
+                    (*image)[row][col][0] = shade;
+        cout << "disc at (" << x << ", " << y << ") radius " << r << endl;
+    }
+}
+
+static
+void s_printTop(const std::vector<img::tImage::tHoughCircle>& circles)
+{
+    for (size_t i = 0; i < circles.size() && i < 3; i++)
+    {
+        cout << "        (" << circles[i].x << ", " << circles[i].y << ") radius "
+             << circles[i].r << ", " << circles[i].v << " votes" << endl;
+    }
+}
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 maxThreads = (argc > 1) ? (u32) atoi(argv[1]) : 4;
+    u32 width = (argc > 2) ? (u32) atoi(argv[2]) : 320;
+    u32 height = (argc > 3) ? (u32) atoi(argv[3]) : 240;
+    u32 numDiscs = (argc > 4) ? (u32) atoi(argv[4]) : 3;
+    u32 minRadius = (argc > 5) ? (u32) atoi(argv[5]) : 10;
+    u32 maxRadius = (argc > 6) ? (u32) atoi(argv[6]) : 30;
+
+    img::tImage image(width * height);
+    image.setBufUsed(width * height);
+    image.setWidth(width);
+    image.setHeight(height);
+    image.setFormat(img::kGrey);
+    s_drawDiscs(&image, numDiscs, minRadius, maxRadius);
+
+    cout << width << "x" << height << ", radii " << minRadius << " to " << maxRadius << endl;
+    cout << std::fixed << std::setprecision(1);
+
+    std::vector< std::vector<u32> > accum;
+    std::vector<img::tImage::tHoughCircle> circles;
+
+    // The edge image is two pixels smaller, and its coordinates are one
+    // pixel in.
+    img::tImage edges;
+    u64 start = sync::tTimer::usecTime();
+    image.sobel(&edges);
+    circles = edges.houghCircles(accum, 0, width-3, 1, 0, height-3, 1,
+                                 minRadius, maxRadius, 1, 20);
+    u64 elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(24) << "houghCircles" << std::setw(12) << (f64)elapsed / 1000.0 << endl;
+    for (size_t i = 0; i < circles.size(); i++)
+    {
+        circles[i].x++;
+        circles[i].y++;
+    }
+    s_printTop(circles);
+
+    start = sync::tTimer::usecTime();
+    circles = image.houghCirclesGradient(accum, 0, width-1, 1, 0, height-1, 1,
+                                         minRadius, maxRadius, 1, 20, 255);
+    elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(24) << "houghCirclesGradient" << std::setw(12) << (f64)elapsed / 1000.0 << endl;
+    s_printTop(circles);
+
+    for (u32 n = 1; n <= maxThreads; n *= 2)
+    {
+        sync::tThreadPool pool(n);
+        start = sync::tTimer::usecTime();
+        circles = image.houghCirclesGradient(accum, 0, width-1, 1, 0, height-1, 1,
+                                             minRadius, maxRadius, 1, 20, 255, pool);
+        elapsed = sync::tTimer::usecTime() - start;
+        cout << std::setw(21) << "pool x" << std::setw(3) << n
+             << std::setw(12) << (f64)elapsed / 1000.0 << endl;
+    }
+
+    return 0;
+}
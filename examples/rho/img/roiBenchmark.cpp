@@ -0,0 +1,92 @@
+#include <rho/img/tImage.h>
+#include <rho/img/tImageView.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+
+
+/*
+ * Times a multi-ROI pipeline on one RGB24 frame: for each of numRois
+ * rectangles, convert to grey and run sobel(). Once by crop()ing each
+ * rectangle into an image of its own first, and once through tImageViews
+ * of the frame, which copy nothing.
+ *
+ * Times are milliseconds per frame (all the ROIs).
+ *
+ * Usage:  ./a.out [width] [height] [numRois] [roiWidth] [roiHeight] [iterations]
+ */
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 width = (argc > 1) ? (u32) atoi(argv[1]) : 1920;
+    u32 height = (argc > 2) ? (u32) atoi(argv[2]) : 1080;
+    u32 numRois = (argc > 3) ? (u32) atoi(argv[3]) : 16;
+    u32 roiWidth = (argc > 4) ? (u32) atoi(argv[4]) : 256;
+    u32 roiHeight = (argc > 5) ? (u32) atoi(argv[5]) : 256;
+    u32 iterations = (argc > 6) ? (u32) atoi(argv[6]) : 20;
+
+    img::tImage frame(width * height * 3);
+    frame.setBufUsed(width * height * 3);
+    frame.setWidth(width);
+    frame.setHeight(height);
+    frame.setFormat(img::kRGB24);
+    for (u32 i = 0; i < frame.bufUsed(); i++)
+        frame.buf()[i] = (u8)(rand() % 256);
+
+    std::vector<geo::tRect> rois;
+    for (u32 n = 0; n < numRois; n++)
+    {
+        rois.push_back(geo::tRect(rand() % (width - roiWidth + 1),
+                                  rand() % (height - roiHeight + 1),
+                                  roiWidth, roiHeight));
+    }
+
+    cout << width << "x" << height << " RGB24, " << numRois << " ROIs of "
+         << roiWidth << "x" << roiHeight << ", " << iterations << " iterations" << endl;
+    cout << std::fixed << std::setprecision(2);
+
+    img::tImage roi, grey, edges;
+
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        for (u32 n = 0; n < numRois; n++)
+        {
+            frame.crop(rois[n], &roi);
+            roi.convertToFormat(img::kGrey, &grey);
+            grey.sobel(&edges, 255);
+        }
+    }
+    u64 elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(12) << "copies" << std::setw(10)
+         << ((f64)elapsed / 1000.0) / iterations << endl;
+
+    start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        for (u32 n = 0; n < numRois; n++)
+        {
+            img::tImageView view;
+            frame.crop(rois[n], &view);
+            view.convertToFormat(img::kGrey, &grey);
+            grey.sobel(&edges, 255);
+        }
+    }
+    elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(12) << "views" << std::setw(10)
+         << ((f64)elapsed / 1000.0) / iterations << endl;
+
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include <rho/img/tImage.h>
+#include <rho/img/tScaler.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+
+
+/*
+ * Times tScaler for each filter, once per instruction set this cpu
+ * supports, next to the original area-averaging tImage::scale().
+ *
+ * All figures are milliseconds per frame.
+ *
+ * Usage:  ./a.out [fromWidth] [fromHeight] [toWidth] [toHeight] [iterations]
+ */
+
+
+static const char* kNames[] = { "box", "bilinear", "bicubic", "lanczos3" };
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 fromWidth = (argc > 1) ? (u32) atoi(argv[1]) : 1920;
+    u32 fromHeight = (argc > 2) ? (u32) atoi(argv[2]) : 1080;
+    u32 toWidth = (argc > 3) ? (u32) atoi(argv[3]) : 320;
+    u32 toHeight = (argc > 4) ? (u32) atoi(argv[4]) : 180;
+    u32 iterations = (argc > 5) ? (u32) atoi(argv[5]) : 20;
+
+    img::tImage frame(fromWidth * fromHeight * 3);
+    frame.setBufUsed(fromWidth * fromHeight * 3);
+    frame.setWidth(fromWidth);
+    frame.setHeight(fromHeight);
+    frame.setFormat(img::kRGB24);
+    for (u32 i = 0; i < frame.bufUsed(); i++)
+        frame.buf()[i] = (u8)(rand() % 256);
+
+    img::tImage dest;
+
+    cout << fromWidth << "x" << fromHeight << " -> " << toWidth << "x" << toHeight
+         << " RGB24, " << iterations << " iterations" << endl;
+    cout << std::fixed << std::setprecision(2);
+
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+        frame.scale(toWidth, toHeight, &dest);
+    u64 elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(12) << "tImage::scale" << std::setw(10)
+         << ((f64)elapsed / 1000.0) / iterations << endl;
+
+    cout << std::setw(12) << " ";
+    for (i32 level = kSimdNone; level <= getSimdLevel(); level++)
+        cout << std::setw(10) << simdLevelEnumToString((nSimdLevel)level);
+    cout << endl;
+
+    for (i32 f = 0; f < img::kMaxScaleFilter; f++)
+    {
+        cout << std::setw(12) << kNames[f];
+        for (i32 level = kSimdNone; level <= getSimdLevel(); level++)
+        {
+            img::tScaler scaler(fromWidth, fromHeight, toWidth, toHeight,
+                                (img::nScaleFilter)f, (nSimdLevel)level);
+            start = sync::tTimer::usecTime();
+            for (u32 i = 0; i < iterations; i++)
+                scaler.scale(&frame, &dest);
+            elapsed = sync::tTimer::usecTime() - start;
+            cout << std::setw(10) << ((f64)elapsed / 1000.0) / iterations;
+        }
+        cout << endl;
+    }
+
+    return 0;
+}
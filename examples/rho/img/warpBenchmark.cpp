@@ -0,0 +1,90 @@
+#include <rho/img/tImage.h>
+#include <rho/img/tWarper.h>
+#include <rho/sync/tThreadPool.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+
+
+/*
+ * Times the original forward-mapping tImage::rotate() against the
+ * inverse-mapping tWarper: computing the remap per call, with a cached
+ * remap table, and banded on a thread pool.
+ *
+ * All figures are milliseconds per frame.
+ *
+ * Usage:  ./a.out [angle] [maxThreads] [width] [height] [iterations]
+ */
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    f64 angle = (argc > 1) ? atof(argv[1]) : 30.0;
+    u32 maxThreads = (argc > 2) ? (u32) atoi(argv[2]) : 4;
+    u32 width = (argc > 3) ? (u32) atoi(argv[3]) : 1920;
+    u32 height = (argc > 4) ? (u32) atoi(argv[4]) : 1080;
+    u32 iterations = (argc > 5) ? (u32) atoi(argv[5]) : 10;
+
+    img::tImage frame(width * height * 3);
+    frame.setBufUsed(width * height * 3);
+    frame.setWidth(width);
+    frame.setHeight(height);
+    frame.setFormat(img::kRGB24);
+    for (u32 i = 0; i < frame.bufUsed(); i++)
+        frame.buf()[i] = (u8)(rand() % 256);
+
+    img::tImage dest;
+
+    cout << width << "x" << height << " RGB24 rotated " << angle << " degrees, "
+         << iterations << " iterations" << endl;
+    cout << std::fixed << std::setprecision(2);
+
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+        frame.rotate(angle, &dest);
+    u64 elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(16) << "tImage::rotate" << std::setw(10)
+         << ((f64)elapsed / 1000.0) / iterations << endl;
+
+    u32 newWidth, newHeight;
+    geo::tTrans4 trans = img::rotationTransform(width, height, angle, &newWidth, &newHeight);
+    img::tWarper warper(width, height, newWidth, newHeight, trans);
+
+    start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+        warper.warp(&frame, &dest);
+    elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(16) << "tWarper" << std::setw(10)
+         << ((f64)elapsed / 1000.0) / iterations << endl;
+
+    warper.cacheRemapTable();
+    start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+        warper.warp(&frame, &dest);
+    elapsed = sync::tTimer::usecTime() - start;
+    cout << std::setw(16) << "tWarper cached" << std::setw(10)
+         << ((f64)elapsed / 1000.0) / iterations << endl;
+
+    for (u32 threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        sync::tThreadPool pool(threads);
+        start = sync::tTimer::usecTime();
+        for (u32 i = 0; i < iterations; i++)
+            warper.warp(&frame, &dest, pool);
+        elapsed = sync::tTimer::usecTime() - start;
+        cout << std::setw(13) << "pool x" << std::setw(3) << threads << std::setw(10)
+             << ((f64)elapsed / 1000.0) / iterations << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include <rho/ip/tcp/tServer.h>
+#include <rho/ip/tcp/tSocket.h>
+#include <rho/sync/tThread.h>
+#include <rho/sync/tTimer.h>
+#include <rho/iReadable.h>
+#include <rho/iWritable.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+using std::vector;
+
+
+/*
+ * Measures loopback throughput of sending a file over tcp, and of
+ * forwarding one connection into another (as a proxy does):
+ *
+ *   - the copy loop: read() into a buffer, then writeAll() to the socket,
+ *   - tSocket::transferFrom(), which uses sendfile(2) / splice(2) on Linux.
+ *
+ * The file is read once before timing so that it's in the page cache.
+ * All figures are MB/s.
+ *
+ * Usage:  ./a.out [megabytes] [filepath]
+ */
+
+
+const u16 kPort = 17001;
+
+
+class tDrainRunnable : public sync::iRunnable
+{
+    public:
+
+        tDrainRunnable(refc<ip::tcp::tSocket> socket)
+            : m_socket(socket), m_numBytes(0) { }
+
+        void run()
+        {
+            vector<u8> buf(64*1024);
+            i32 r;
+            while ((r = m_socket->read(&buf[0], (i32)buf.size())) > 0)
+                m_numBytes += (u64)r;
+        }
+
+        refc<ip::tcp::tSocket> m_socket;
+        u64 m_numBytes;
+};
+
+
+class tFileSendRunnable : public sync::iRunnable
+{
+    public:
+
+        tFileSendRunnable(refc<ip::tcp::tSocket> socket, std::string path)
+            : m_socket(socket), m_path(path) { }
+
+        void run()
+        {
+            tFileReadable file(m_path);
+            vector<u8> buf(64*1024);
+            i32 r;
+            while ((r = file.read(&buf[0], (i32)buf.size())) > 0)
+                m_socket->writeAll(&buf[0], r);
+            m_socket->close();
+        }
+
+        refc<ip::tcp::tSocket> m_socket;
+        std::string m_path;
+};
+
+
+f64 mbPerSec(u64 numBytes, u64 startUsec)
+{
+    u64 elapsed = sync::tTimer::usecTime() - startUsec;
+    return ((f64)numBytes / (1024.0*1024.0)) / ((f64)elapsed / 1000000.0);
+}
+
+
+/*
+ * Connects a fresh socket pair and starts a thread draining the far end.
+ */
+refc<ip::tcp::tSocket> connect(u16 port, refc<sync::tThread>& thread, tDrainRunnable*& drain)
+{
+    ip::tcp::tServer server(port);
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    refc<ip::tcp::tSocket> socket(new ip::tcp::tSocket(addrGroup, port));
+    drain = new tDrainRunnable(server.accept());
+    thread = new sync::tThread(refc<sync::iRunnable>(drain));
+    return socket;
+}
+
+
+f64 fileCopyLoop(std::string path, u64 fileSize, u16 port)
+{
+    refc<sync::tThread> thread;
+    tDrainRunnable* drain = NULL;
+    refc<ip::tcp::tSocket> socket = connect(port, thread, drain);
+
+    u64 start = sync::tTimer::usecTime();
+    tFileReadable file(path);
+    vector<u8> buf(64*1024);
+    i32 r;
+    while ((r = file.read(&buf[0], (i32)buf.size())) > 0)
+        socket->writeAll(&buf[0], r);
+    socket->close();
+    thread->join();
+    f64 result = mbPerSec(drain->m_numBytes, start);
+
+    if (drain->m_numBytes != fileSize)
+        cout << "(short transfer!) ";
+    return result;
+}
+
+
+f64 fileSendfile(std::string path, u64 fileSize, u16 port)
+{
+    refc<sync::tThread> thread;
+    tDrainRunnable* drain = NULL;
+    refc<ip::tcp::tSocket> socket = connect(port, thread, drain);
+
+    u64 start = sync::tTimer::usecTime();
+    tFileReadable file(path);
+    socket->transferFrom(file, fileSize);
+    socket->close();
+    thread->join();
+    f64 result = mbPerSec(drain->m_numBytes, start);
+
+    if (drain->m_numBytes != fileSize)
+        cout << "(short transfer!) ";
+    return result;
+}
+
+
+f64 proxy(std::string path, u64 fileSize, u16 port, bool useSplice)
+{
+    // The data goes: file -> sender ... proxyIn -> proxyOut ... drain.
+    ip::tcp::tServer inServer(port);
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    refc<ip::tcp::tSocket> sender(new ip::tcp::tSocket(addrGroup, port));
+    refc<ip::tcp::tSocket> proxyIn = inServer.accept();
+
+    refc<sync::tThread> drainThread;
+    tDrainRunnable* drain = NULL;
+    refc<ip::tcp::tSocket> proxyOut = connect((u16)(port+1), drainThread, drain);
+
+    u64 start = sync::tTimer::usecTime();
+    sync::tThread sendThread(refc<sync::iRunnable>(new tFileSendRunnable(sender, path)));
+    if (useSplice)
+    {
+        proxyOut->transferFrom(*proxyIn, fileSize);
+    }
+    else
+    {
+        vector<u8> buf(64*1024);
+        i32 r;
+        while ((r = proxyIn->read(&buf[0], (i32)buf.size())) > 0)
+            proxyOut->writeAll(&buf[0], r);
+    }
+    proxyOut->close();
+    sendThread.join();
+    drainThread->join();
+    f64 result = mbPerSec(drain->m_numBytes, start);
+
+    if (drain->m_numBytes != fileSize)
+        cout << "(short transfer!) ";
+    return result;
+}
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 megabytes = (argc > 1) ? (u32) atoi(argv[1]) : 256;
+    std::string path = (argc > 2) ? argv[2] : "/tmp/transferBenchmark.bin";
+
+    u64 fileSize = (u64)megabytes * 1024 * 1024;
+    {
+        tFileWritable file(path);
+        vector<u8> buf(1024*1024);
+        for (size_t i = 0; i < buf.size(); i++)
+            buf[i] = (u8)(rand() % 256);
+        for (u32 i = 0; i < megabytes; i++)
+            file.writeAll(&buf[0], (i32)buf.size());
+    }
+    {
+        tFileReadable file(path);          // warm the page cache
+        vector<u8> buf(1024*1024);
+        while (file.read(&buf[0], (i32)buf.size()) > 0) { }
+    }
+
+    cout << std::fixed << std::setprecision(1);
+    cout << "file -> socket, copy loop:        " << fileCopyLoop(path, fileSize, kPort) << " MB/s" << endl;
+    cout << "file -> socket, transferFrom():   " << fileSendfile(path, fileSize, kPort+1) << " MB/s" << endl;
+    cout << "socket -> socket, copy loop:      " << proxy(path, fileSize, kPort+2, false) << " MB/s" << endl;
+    cout << "socket -> socket, transferFrom(): " << proxy(path, fileSize, kPort+4, true) << " MB/s" << endl;
+
+    remove(path.c_str());
+
+    return 0;
+}
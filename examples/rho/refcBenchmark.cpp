@@ -0,0 +1,171 @@
+#include <rho/refc.h>
+#include <rho/sync/tAtomicInt.h>
+#include <rho/sync/tThread.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+using std::vector;
+
+
+/*
+ * Measures the cost of the reference counting that refc does:
+ *
+ *   - raw increment/decrement of a sync::au32,
+ *   - copying and destroying a refc (one increment + one decrement),
+ *   - creating and destroying a refc'd object from scratch, with the
+ *     count kept in the global table, kept inside the object (bRefcounted),
+ *     or allocated together with the object (makeRefc()),
+ *
+ * first on one thread, then with several threads copying the same refc.
+ * All figures are nanoseconds per operation.
+ *
+ * Usage:  ./a.out [iterations] [threads]
+ */
+
+
+struct tPayload
+{
+    u32 x;
+};
+
+
+struct tIntrusivePayload : public bRefcounted
+{
+    u32 x;
+};
+
+
+f64 nsPerOp(u64 startUsec, u64 numOps)
+{
+    u64 elapsed = sync::tTimer::usecTime() - startUsec;
+    return (f64)elapsed * 1000.0 / (f64)numOps;
+}
+
+
+f64 atomicIncDec(u32 iterations)
+{
+    sync::au32 counter(1);
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        ++counter;
+        --counter;
+    }
+    return nsPerOp(start, iterations);
+}
+
+
+f64 refcCopyDestroy(refc<tPayload> r, u32 iterations)
+{
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        refc<tPayload> copy(r);
+        copy->x++;
+    }
+    return nsPerOp(start, iterations);
+}
+
+
+f64 refcCreateDestroy(u32 iterations)
+{
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        refc<tPayload> r(new tPayload);
+        r->x = i;
+    }
+    return nsPerOp(start, iterations);
+}
+
+
+f64 intrusiveCreateDestroy(u32 iterations)
+{
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        refc<tIntrusivePayload> r(new tIntrusivePayload);
+        r->x = i;
+    }
+    return nsPerOp(start, iterations);
+}
+
+
+f64 makeRefcCreateDestroy(u32 iterations)
+{
+    u64 start = sync::tTimer::usecTime();
+    for (u32 i = 0; i < iterations; i++)
+    {
+        refc<tPayload> r = makeRefc<tPayload>();
+        r->x = i;
+    }
+    return nsPerOp(start, iterations);
+}
+
+
+class tCopier : public sync::iRunnable
+{
+    public:
+
+        tCopier(refc<tPayload> r, u32 iterations)
+            : m_r(r), m_iterations(iterations), m_result(0.0) { }
+
+        void run()
+        {
+            m_result = refcCopyDestroy(m_r, m_iterations);
+        }
+
+        f64 result() const { return m_result; }
+
+    private:
+
+        refc<tPayload> m_r;
+        u32 m_iterations;
+        f64 m_result;
+};
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 iterations = (argc > 1) ? (u32) atoi(argv[1]) : 10000000;
+    u32 numThreads = (argc > 2) ? (u32) atoi(argv[2]) : 4;
+
+    refc<tPayload> shared(new tPayload);
+    shared->x = 0;
+
+    cout << std::fixed << std::setprecision(2);
+    cout << "au32 ++/-- pair:              " << atomicIncDec(iterations) << " ns" << endl;
+    cout << "refc copy+destroy:            " << refcCopyDestroy(shared, iterations) << " ns" << endl;
+    cout << "refc create+destroy:          " << refcCreateDestroy(iterations / 10) << " ns" << endl;
+    cout << "bRefcounted create+destroy:   " << intrusiveCreateDestroy(iterations / 10) << " ns" << endl;
+    cout << "makeRefc create+destroy:      " << makeRefcCreateDestroy(iterations / 10) << " ns" << endl;
+
+    vector<tCopier*> copiers;
+    vector< refc<sync::tThread> > threads;
+    for (u32 i = 0; i < numThreads; i++)
+    {
+        copiers.push_back(new tCopier(shared, iterations / numThreads));
+        threads.push_back(refc<sync::tThread>(new sync::tThread(refc<sync::iRunnable>(copiers.back()))));
+    }
+    f64 worst = 0.0;
+    for (u32 i = 0; i < numThreads; i++)
+    {
+        threads[i]->join();
+        if (copiers[i]->result() > worst)
+            worst = copiers[i]->result();
+    }
+    cout << "refc copy+destroy (" << numThreads << " thr):   " << worst << " ns" << endl;
+
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <rho/sync/tLockFreePCQ.h>
+#include <rho/sync/tPCQ.h>
+#include <rho/sync/tThread.h>
+#include <rho/sync/tTimer.h>
+#include <rho/tCrashReporter.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+
+using namespace rho;
+using std::cout;
+using std::endl;
+using std::vector;
+
+
+/*
+ * Compares tPCQ with tLockFreePCQ under contention. For every combination
+ * of 1..N producers and 1..N consumers it pushes a fixed number of items
+ * through a kBlock queue of each kind and reports millions of items per
+ * second.
+ *
+ * Usage:  ./a.out [maxThreads] [itemsPerRun] [capacity]
+ */
+
+
+template <class Q>
+class tProducer : public sync::iRunnable
+{
+    public:
+
+        tProducer(Q* q, u32 numItems) : m_q(q), m_numItems(numItems) { }
+
+        void run()
+        {
+            for (u32 i = 0; i < m_numItems; i++)
+                m_q->push(i);
+        }
+
+    private:
+
+        Q*  m_q;
+        u32 m_numItems;
+};
+
+
+template <class Q>
+class tConsumer : public sync::iRunnable
+{
+    public:
+
+        tConsumer(Q* q, u32 numItems) : m_q(q), m_numItems(numItems) { }
+
+        void run()
+        {
+            for (u32 i = 0; i < m_numItems; i++)
+                m_q->pop();
+        }
+
+    private:
+
+        Q*  m_q;
+        u32 m_numItems;
+};
+
+
+template <class Q>
+f64 benchmark(u32 numProducers, u32 numConsumers, u32 numItems, u32 capacity)
+{
+    Q q(capacity, sync::kBlock);
+
+    // Round down so that the work splits evenly in both directions.
+    u32 perProducer = numItems / (numProducers * numConsumers) * numConsumers;
+    u32 perConsumer = perProducer * numProducers / numConsumers;
+    u64 total = (u64)perProducer * numProducers;
+
+    vector< refc<sync::tThread> > threads;
+
+    u64 start = sync::tTimer::usecTime();
+
+    for (u32 i = 0; i < numConsumers; i++)
+    {
+        refc<sync::iRunnable> r(new tConsumer<Q>(&q, perConsumer));
+        threads.push_back(refc<sync::tThread>(new sync::tThread(r)));
+    }
+    for (u32 i = 0; i < numProducers; i++)
+    {
+        refc<sync::iRunnable> r(new tProducer<Q>(&q, perProducer));
+        threads.push_back(refc<sync::tThread>(new sync::tThread(r)));
+    }
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i]->join();
+
+    u64 elapsed = sync::tTimer::usecTime() - start;
+    if (elapsed == 0)
+        elapsed = 1;
+
+    return (f64)total / (f64)elapsed;      // <-- items per usec == Mitems/sec
+}
+
+
+int main(int argc, char* argv[])
+{
+    tCrashReporter::init();
+
+    u32 maxThreads = (argc > 1) ? (u32) atoi(argv[1]) : 8;
+    u32 numItems   = (argc > 2) ? (u32) atoi(argv[2]) : 1000000;
+    u32 capacity   = (argc > 3) ? (u32) atoi(argv[3]) : 1024;
+
+    cout << "items per run: " << numItems << ", capacity: " << capacity << endl;
+    cout << endl;
+    cout << "producers  consumers      tPCQ (M/s)   tLockFreePCQ (M/s)   speedup" << endl;
+
+    for (u32 p = 1; p <= maxThreads; p *= 2)
+    {
+        for (u32 c = 1; c <= maxThreads; c *= 2)
+        {
+            f64 locked   = benchmark< sync::tPCQ<u32> >(p, c, numItems, capacity);
+            f64 lockfree = benchmark< sync::tLockFreePCQ<u32> >(p, c, numItems, capacity);
+
+            cout << std::setw(9)  << p << "  "
+                 << std::setw(9)  << c << "  "
+                 << std::setw(14) << std::fixed << std::setprecision(2) << locked << "  "
+                 << std::setw(19) << lockfree << "  "
+                 << std::setw(8)  << (lockfree / locked) << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef __rho_bRefcounted_h__
+#define __rho_bRefcounted_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/sync/tAtomicInt.h>
+
+
+namespace rho
+{
+
+
+template <class T>
+class refc;
+
+
+/**
+ * Derive from this class to make refc count references to your objects
+ * *inside* the objects themselves (an "intrusive" count). Then refc never
+ * allocates a separate counter for the object and never has to look the
+ * object up in its global table, even when a raw pointer to the object is
+ * handed to a new refc.
+ *
+ * refc notices this base class through the static type it is given, so
+ * make the first refc to such an object a refc<X> where X derives from
+ * bRefcounted. Converting that to a refc<Y> for a base class Y is fine
+ * (the two share the count), but don't give a raw pointer to the object
+ * to a refc<Y> where Y doesn't derive from bRefcounted; that refc would
+ * keep its own count.
+ *
+ * Copying an object does not copy its reference count.
+ */
+class bRefcounted
+{
+    protected:
+
+        bRefcounted() : m_refcCount(0) { }
+
+        bRefcounted(const bRefcounted& other) : m_refcCount(0) { }
+
+        bRefcounted& operator= (const bRefcounted& other) { return *this; }
+
+        ~bRefcounted() { }
+
+    private:
+
+        sync::au32 m_refcCount;
+
+        template <class T>
+        friend class refc;
+};
+
+
+}    // namespace rho
+
+
+#endif   // __rho_bRefcounted_h__
@@ -4,6 +4,7 @@
 
 #include <rho/ppcheck.h>
 #include <rho/types.h>
+#include <rho/crypt/nShaImpl.h>
 
 #include <string>
 #include <vector>
@@ -11,6 +12,7 @@
 
 namespace rho
 {
+namespace sync { class tThreadPool; }
 namespace crypt
 {
 
@@ -78,6 +80,10 @@ typedef std::vector<u8> (*hmac_func)(const std::vector<u8>& key, const std::vect
  * It does 'c' iterations and generates a hash of length 'dklen'. The returned
  * vector has length 'dklen'.
  *
+ * When 'prf' is one of the hmac_<hasher> functions above, the password is
+ * only hashed into an HMAC key state once (see tHmac), rather than once
+ * per iteration. Any other 'prf' is called 'c' times per output block.
+ *
  * This is part of the PKCS #5 series.
  * See RFC 2898.
  */
@@ -86,6 +92,53 @@ std::vector<u8> pbkdf2(hmac_func prf,
                        u32 c, u32 dklen);
 
 
+/**
+ * Same as above, but computes the output blocks (each is one hash length
+ * of the output, and costs all 'c' iterations) in parallel on 'pool'.
+ * This only helps when 'dklen' is longer than the hash.
+ */
+std::vector<u8> pbkdf2(hmac_func prf,
+                       const std::vector<u8>& password, const std::vector<u8>& salt,
+                       u32 c, u32 dklen, sync::tThreadPool& pool);
+
+
+/**
+ * Returns whether this cpu can run 'impl'.
+ */
+bool canRunShaImpl(nShaImpl impl);
+
+
+/**
+ * Hashes 'count' independent messages with SHA-1: message i is the
+ * 'lengths[i]' bytes at 'messages[i]', and its 20 byte hash is written to
+ * 'hashes + 20*i'. The hashes are the same as tSHA1's.
+ *
+ * This is for hashing lots of messages (especially small ones) quickly.
+ * With AVX2 it hashes eight messages at once, one per 32-bit lane; else
+ * it uses the SHA extensions when this cpu has them. (tSHA1 also uses the
+ * SHA extensions, but it can't do the eight-lane trick.)
+ */
+void sha1_batch(const u8* const messages[], const u32 lengths[], u32 count, u8* hashes);
+
+
+/**
+ * Same as above, but uses 'impl' (which must be one canRunShaImpl() says
+ * this cpu can run). Every impl gives the same hashes.
+ */
+void sha1_batch(const u8* const messages[], const u32 lengths[], u32 count, u8* hashes,
+                nShaImpl impl);
+
+
+/**
+ * The same as the two above, but SHA-256: each hash is 32 bytes, written
+ * to 'hashes + 32*i', and is the same as tSHA256's. (SHA-256 prefers the
+ * SHA extensions over the eight AVX2 lanes when this cpu has both.)
+ */
+void sha256_batch(const u8* const messages[], const u32 lengths[], u32 count, u8* hashes);
+void sha256_batch(const u8* const messages[], const u32 lengths[], u32 count, u8* hashes,
+                  nShaImpl impl);
+
+
 }  // namespace crypt
 }  // namespace rho
 
@@ -14,7 +14,9 @@ namespace crypt
 enum nOperationModeAES
 {
     kOpModeECB,         // "electronic code book"
-    kOpModeCBC          // "cipher-block chaining"
+    kOpModeCBC,         // "cipher-block chaining"
+    kOpModeCTR,         // "counter"
+    kOpModeGCM          // "Galois/counter mode" (CTR, plus an authentication tag)
 };
 
 
@@ -0,0 +1,31 @@
+#ifndef __rho_crypt_nShaImpl_h__
+#define __rho_crypt_nShaImpl_h__
+
+
+#include <rho/ppcheck.h>
+
+
+namespace rho
+{
+namespace crypt
+{
+
+
+/**
+ * The ways sha1_batch() and sha256_batch() (see hash_utils.h) can do
+ * their hashing. See canRunShaImpl().
+ */
+enum nShaImpl
+{
+    kShaImplPortable,       // plain C++, one message at a time
+    kShaImplSHANI,          // the x86 SHA extensions, one message at a time
+    kShaImplAVX2x8          // AVX2, eight messages at a time (one per 32-bit lane);
+                            // the last few of a batch go one at a time
+};
+
+
+}    // namespace crypt
+}    // namespace rho
+
+
+#endif   // __rho_crypt_nShaImpl_h__
@@ -0,0 +1,76 @@
+#ifndef __rho_crypt_tAdler32_h__
+#define __rho_crypt_tAdler32_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/crypt/iHasher.h>
+
+
+namespace rho
+{
+namespace crypt
+{
+
+
+/**
+ * Adler-32 (the checksum in the zlib format): very cheap, but weaker
+ * than a CRC, especially on short inputs. It is NOT a cryptographic hash.
+ *
+ * Uses SSSE3 or AVX2 when the cpu has them.
+ */
+class tAdler32 : public iHasher, public bNonCopyable
+{
+    public:
+
+        static const u32 kHashSize = 4;
+
+        tAdler32();
+
+        i32 write(const u8* buffer, i32 length);
+        i32 writeAll(const u8* buffer, i32 length);
+
+        /**
+         * Returns the checksum in vector form (big-endian, as it's
+         * stored in a zlib stream). The returned vector always has
+         * length of 4.
+         */
+        std::vector<u8> getHash() const;
+
+        /**
+         * Returns the hash in string form.
+         * The returned string always is hexadecimal
+         * and always has length 8.
+         */
+        std::string getHashString() const;
+
+        /**
+         * Returns the checksum as a number.
+         */
+        u32 getChecksum() const;
+
+    private:
+
+        u32 m_adler;
+};
+
+
+/**
+ * Updates the Adler-32 checksum 'adler' with 'length' bytes at 'buffer',
+ * and returns the new checksum. Start with an 'adler' of 1. (Same
+ * convention as zlib's adler32().)
+ */
+u32 adler32(u32 adler, const u8* buffer, u32 length);
+
+
+/**
+ * Same as above, but uses no instruction set beyond 'maxLevel' (see
+ * nSimdLevel).
+ */
+u32 adler32(u32 adler, const u8* buffer, u32 length, nSimdLevel maxLevel);
+
+
+}   // namespace crypt
+}   // namespace rho
+
+
+#endif   // __rho_crypt_tAdler32_h__
@@ -0,0 +1,77 @@
+#ifndef __rho_crypt_tCRC32C_h__
+#define __rho_crypt_tCRC32C_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/crypt/iHasher.h>
+
+
+namespace rho
+{
+namespace crypt
+{
+
+
+/**
+ * CRC-32C (the Castagnoli polynomial, as used by iSCSI, ext4, SCTP, ...):
+ * a checksum for catching accidental corruption. It is NOT a
+ * cryptographic hash.
+ *
+ * On x86 cpus with SSE4.2 this uses the crc32 instruction, which does
+ * eight bytes at a time; elsewhere it uses tables.
+ */
+class tCRC32C : public iHasher, public bNonCopyable
+{
+    public:
+
+        static const u32 kHashSize = 4;
+
+        tCRC32C();
+
+        i32 write(const u8* buffer, i32 length);
+        i32 writeAll(const u8* buffer, i32 length);
+
+        /**
+         * Returns the CRC in vector form (big-endian).
+         * The returned vector always has length of 4.
+         */
+        std::vector<u8> getHash() const;
+
+        /**
+         * Returns the hash in string form.
+         * The returned string always is hexadecimal
+         * and always has length 8.
+         */
+        std::string getHashString() const;
+
+        /**
+         * Returns the CRC as a number.
+         */
+        u32 getCRC() const;
+
+    private:
+
+        u32 m_crc;
+};
+
+
+/**
+ * Updates the CRC-32C 'crc' with 'length' bytes at 'buffer', and returns
+ * the new CRC. Start with a 'crc' of 0. (Same convention as zlib's
+ * crc32(), so a message's CRC can be built up a piece at a time.)
+ */
+u32 crc32c(u32 crc, const u8* buffer, u32 length);
+
+
+/**
+ * Same as above, but when 'useSSE42' is false, always uses the tables
+ * (even on cpus with the crc32 instruction).
+ */
+u32 crc32c(u32 crc, const u8* buffer, u32 length, bool useSSE42);
+
+
+}   // namespace crypt
+}   // namespace rho
+
+
+#endif   // __rho_crypt_tCRC32C_h__
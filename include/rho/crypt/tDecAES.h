@@ -53,9 +53,30 @@ class tDecAES : public bNonCopyable
          * Pass an 'iv' vector if you constructed this object with:
          *   opmode == kOpModeCBC
          * The 'iv' vector, if passed, must be 16 bytes.
+         *
+         * If you constructed this object with opmode == kOpModeCTR, the 'iv'
+         * vector must be passed: it is the 16-byte counter block of the
+         * first block, and it is advanced past the last one, so consecutive
+         * calls carry on where the last one left off.
+         *
+         * This can't be used with opmode == kOpModeGCM; see decGCM().
          */
         void dec(u8* ctbuf, u8* ptbuf, u32 numblocks, u8* iv=NULL);
 
+        /**
+         * The inverse of tEncAES::encGCM(): checks 'tag' against the cypher
+         * text and the 'aadlen' bytes at 'aad', and decrypts 'numbytes'
+         * bytes from 'ctbuf' into 'ptbuf' (which may be the same buffer).
+         *
+         * Throws eRuntimeError if the tag doesn't match, i.e. if any of the
+         * cypher text, the aad, the nonce or the tag itself was altered. The
+         * plain text buffer is zeroed in that case.
+         *
+         * Only for objects constructed with opmode == kOpModeGCM.
+         */
+        void decGCM(const u8* ctbuf, u8* ptbuf, u32 numbytes, const u8 nonce[12],
+                    const u8* aad, u32 aadlen, const u8 tag[AES_BLOCK_SIZE]);
+
         /**
          * Free stuff.
          */
@@ -85,6 +106,11 @@ class tDecAES : public bNonCopyable
         // State used by the fallback implementation:
         u32 m_rk[60];    // size is 4*(MAXNR+1)
         int m_Nr;
+
+        // The GHASH key, used only in kOpModeGCM (with PCLMULQDQ if
+        // m_usePCLMUL, else the fallback GHASH):
+        u8* m_hashKey;
+        bool m_usePCLMUL;
 };
 
 
@@ -53,9 +53,30 @@ class tEncAES : public bNonCopyable
          * Pass an 'iv' vector if you constructed this object with:
          *   opmode == kOpModeCBC
          * The 'iv' vector, if passed, must be 16 bytes.
+         *
+         * If you constructed this object with opmode == kOpModeCTR, the 'iv'
+         * vector must be passed: it is the 16-byte counter block of the
+         * first block, and it is advanced past the last one, so consecutive
+         * calls carry on where the last one left off.
+         *
+         * This can't be used with opmode == kOpModeGCM; see encGCM().
          */
         void enc(u8* ptbuf, u8* ctbuf, u32 numblocks, u8* iv=NULL);
 
+        /**
+         * Encrypts 'numbytes' bytes of plain text (any number of bytes; GCM
+         * doesn't need whole blocks) from 'ptbuf' into 'ctbuf', which may be
+         * the same buffer. Also writes the 16-byte authentication tag into
+         * 'tag'. The tag covers the cypher text and the 'aadlen' bytes at
+         * 'aad' ("additional authenticated data", which isn't encrypted and
+         * may be NULL if 'aadlen' is 0).
+         *
+         * Only for objects constructed with opmode == kOpModeGCM. The
+         * 12-byte 'nonce' must never be used twice with the same key.
+         */
+        void encGCM(const u8* ptbuf, u8* ctbuf, u32 numbytes, const u8 nonce[12],
+                    const u8* aad, u32 aadlen, u8 tag[AES_BLOCK_SIZE]);
+
         /**
          * Free stuff.
          */
@@ -85,6 +106,11 @@ class tEncAES : public bNonCopyable
         // State used by the fallback implementation:
         u32 m_rk[60];    // size is 4*(MAXNR+1)
         int m_Nr;
+
+        // The GHASH key, used only in kOpModeGCM (with PCLMULQDQ if
+        // m_usePCLMUL, else the fallback GHASH):
+        u8* m_hashKey;
+        bool m_usePCLMUL;
 };
 
 
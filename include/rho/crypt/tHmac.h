@@ -0,0 +1,172 @@
+#ifndef __rho_crypt_tHmac_h__
+#define __rho_crypt_tHmac_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/bNonCopyable.h>
+#include <rho/eRho.h>
+#include <rho/crypt/iHasher.h>
+#include <rho/crypt/hash_utils.h>
+
+#include <string>
+#include <vector>
+
+
+namespace rho
+{
+namespace crypt
+{
+
+
+/**
+ * HMAC (RFC 2104) over the hasher 'Hasher' (tMD5, tSHA1, ..., tWhirlpool),
+ * keyed once and then reused for as many messages as you like.
+ *
+ * The constructor hashes the key's inner and outer pad blocks once and
+ * keeps the two hasher states; each message after that costs only the
+ * hashing of the message itself and of one inner hash. Write a message,
+ * call getHash(), then reset() to start the next message.
+ *
+ * The hmac_<hasher>() functions in hash_utils.h are one-shot wrappers
+ * around this class.
+ */
+template <class Hasher>
+class tHmac : public iHasher, public bNonCopyable
+{
+    public:
+
+        static const u32 kHashSize = Hasher::kHashSize;
+
+        tHmac(const u8* key, u32 keylen);
+        tHmac(const std::vector<u8>& key);
+
+        /**
+         * Starts a new message (with the same key).
+         */
+        void reset();
+
+        i32 write(const u8* buffer, i32 length);
+        i32 writeAll(const u8* buffer, i32 length);
+
+        /**
+         * Returns the HMAC of everything written since the last reset().
+         * The returned vector always has length kHashSize.
+         */
+        std::vector<u8> getHash() const;
+
+        std::string getHashString() const;
+
+        /**
+         * Writes the HMAC into 'hash', which must have room for kHashSize
+         * bytes. Unlike getHash(), this doesn't allocate.
+         */
+        void getHash(u8* hash) const;
+
+    private:
+
+        void m_init(const u8* key, u32 keylen);
+
+    private:
+
+        Hasher m_innerStart;       // after the inner pad block
+        Hasher m_outerStart;       // after the outer pad block
+        Hasher m_inner;            // after the inner pad and the message so far
+        mutable Hasher m_outer;    // scratch space for getHash()
+};
+
+
+template <class Hasher>
+const u32 tHmac<Hasher>::kHashSize;
+
+
+template <class Hasher>
+tHmac<Hasher>::tHmac(const u8* key, u32 keylen)
+{
+    if (key == NULL && keylen > 0)
+        throw eNullPointer("key may not be null");
+    m_init(key, keylen);
+}
+
+template <class Hasher>
+tHmac<Hasher>::tHmac(const std::vector<u8>& key)
+{
+    m_init(key.size() > 0 ? &key[0] : NULL, (u32)key.size());
+}
+
+template <class Hasher>
+void tHmac<Hasher>::reset()
+{
+    m_inner.copyFrom(m_innerStart);
+}
+
+template <class Hasher>
+i32 tHmac<Hasher>::write(const u8* buffer, i32 length)
+{
+    return this->writeAll(buffer, length);
+}
+
+template <class Hasher>
+i32 tHmac<Hasher>::writeAll(const u8* buffer, i32 length)
+{
+    return m_inner.writeAll(buffer, length);
+}
+
+template <class Hasher>
+std::vector<u8> tHmac<Hasher>::getHash() const
+{
+    std::vector<u8> v(kHashSize, 0);
+    getHash(&v[0]);
+    return v;
+}
+
+template <class Hasher>
+std::string tHmac<Hasher>::getHashString() const
+{
+    std::vector<u8> hash = getHash();
+    return hashToString(hash);
+}
+
+template <class Hasher>
+void tHmac<Hasher>::getHash(u8* hash) const
+{
+    u8 innerHash[Hasher::kHashSize];
+    m_inner.getHash(innerHash);
+    m_outer.copyFrom(m_outerStart);
+    m_outer.writeAll(innerHash, (i32)Hasher::kHashSize);
+    m_outer.getHash(hash);
+}
+
+template <class Hasher>
+void tHmac<Hasher>::m_init(const u8* key, u32 keylen)
+{
+    // If the key is too long, shorten it.
+    u8 shortKey[Hasher::kHashSize];
+    if (keylen > Hasher::kBlockSize)
+    {
+        m_inner.writeAll(key, (i32)keylen);
+        m_inner.getHash(shortKey);
+        key = shortKey;
+        keylen = Hasher::kHashSize;
+    }
+
+    // The key, padded on the right with zeros, xor'ed with each pad.
+    u8 ipad[Hasher::kBlockSize];
+    u8 opad[Hasher::kBlockSize];
+    for (u32 i = 0; i < Hasher::kBlockSize; i++)
+    {
+        u8 k = (i < keylen) ? key[i] : (u8)0x00;
+        ipad[i] = (u8)(k ^ 0x36);
+        opad[i] = (u8)(k ^ 0x5c);
+    }
+
+    m_innerStart.writeAll(ipad, (i32)Hasher::kBlockSize);
+    m_outerStart.writeAll(opad, (i32)Hasher::kBlockSize);
+    reset();
+}
+
+
+}   // namespace crypt
+}   // namespace rho
+
+
+#endif   // __rho_crypt_tHmac_h__
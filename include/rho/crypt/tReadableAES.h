@@ -23,10 +23,23 @@ namespace crypt
  * and unaltered". Details follow.
  *
  * Assumptions:
- *    - CBC mode is being used
+ *    - CBC or GCM mode is being used
  *    - the key is only know by the sender and the receiver
  *    - the key has never been used before  <--  IMPORTANT!
  *
+ * In GCM mode, every chunk carries an authentication tag
+ * which covers the whole chunk, and the chunk's nonce is
+ * made from its sequence number, so any of the changes
+ * below fails the tag check of the chunk it's in, before
+ * any of that chunk is returned.
+ *
+ * CTR mode keeps the data secret, but it makes none of
+ * the guarantees below: flipping a bit of the cypher text
+ * flips the same bit of the plain text and nothing else,
+ * so the parity check won't notice changes which keep it
+ * balanced. Use GCM unless something else authenticates
+ * the data.
+ *
  * Guarantees:
  *    - byte injection will fail the connection
  *        * the 4-byte parity check will ensure this
@@ -73,6 +86,7 @@ class tReadableAES : public iReadable, public bNonCopyable
     private:
 
         bool m_refill();
+        bool m_refillGCM();
 
     private:
 
@@ -87,7 +101,8 @@ class tReadableAES : public iReadable, public bNonCopyable
         // Operation mode stuff:
         nOperationModeAES m_opmode;
         u8 m_last_ct[AES_BLOCK_SIZE];        // <-- used only in kOpModeCBC
-        bool m_hasReadInitializationVector;  // <-- used only in kOpModeCBC
+        u8 m_nonce[12];                      // <-- used only in kOpModeCTR and kOpModeGCM
+        bool m_hasReadInitializationVector;  // <-- not used in kOpModeECB
 
         // Encryption state:
         tDecAES m_aes;
@@ -16,6 +16,13 @@ class tSHA1 : public iHasher, public bNonCopyable
 {
     public:
 
+        /**
+         * The length of the hash, and of the blocks the hash function
+         * consumes, in bytes.
+         */
+        static const u32 kHashSize = 20;
+        static const u32 kBlockSize = 64;
+
         tSHA1();
         ~tSHA1();
 
@@ -35,6 +42,19 @@ class tSHA1 : public iHasher, public bNonCopyable
          */
         std::string getHashString() const;
 
+        /**
+         * Writes the hash into 'hash', which must have room for
+         * kHashSize bytes. Unlike getHash(), this doesn't allocate.
+         */
+        void getHash(u8* hash) const;
+
+        /**
+         * Makes this hasher's state a copy of 'other's, as if everything
+         * written to 'other' so far had been written to this one instead.
+         * (Use it to hash a common prefix only once.)
+         */
+        void copyFrom(const tSHA1& other);
+
     private:
 
         void* m_context;
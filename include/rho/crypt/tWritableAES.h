@@ -49,7 +49,8 @@ class tWritableAES : public iWritable, public iFlushable, public bNonCopyable
         // Operation mode stuff:
         nOperationModeAES m_opmode;
         u8 m_last_ct[AES_BLOCK_SIZE];        // <-- only used in kOpModeCBC
-        bool m_hasSentInitializationVector;  // <-- only used in kOpModeCBC
+        u8 m_nonce[12];                      // <-- only used in kOpModeCTR and kOpModeGCM
+        bool m_hasSentInitializationVector;  // <-- not used in kOpModeECB
 
         // Encryption state:
         tEncAES m_aes;
@@ -0,0 +1,71 @@
+#ifndef __rho_crypt_tXXHash64_h__
+#define __rho_crypt_tXXHash64_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/crypt/iHasher.h>
+
+
+namespace rho
+{
+namespace crypt
+{
+
+
+/**
+ * xxHash64 (Yann Collet's XXH64): a fast, well-mixed, NON-cryptographic
+ * 64-bit hash, for hash tables, sharding and the like. Anyone can find
+ * collisions on purpose, so don't use it where someone might try.
+ */
+class tXXHash64 : public iHasher, public bNonCopyable
+{
+    public:
+
+        static const u32 kHashSize = 8;
+
+        tXXHash64();
+        tXXHash64(u64 seed);
+
+        i32 write(const u8* buffer, i32 length);
+        i32 writeAll(const u8* buffer, i32 length);
+
+        /**
+         * Returns the hash in vector form: the 64-bit value, big-endian
+         * (xxHash's canonical form). The returned vector always has
+         * length of 8.
+         */
+        std::vector<u8> getHash() const;
+
+        /**
+         * Returns the hash in string form.
+         * The returned string always is hexadecimal
+         * and always has length 16.
+         */
+        std::string getHashString() const;
+
+        /**
+         * Returns the hash as a number.
+         */
+        u64 getHash64() const;
+
+    private:
+
+        u64 m_seed;
+        u64 m_v[4];           // the four accumulators
+        u64 m_totalLen;
+        u8  m_buf[32];        // bytes not yet making up a whole stripe
+        u32 m_bufUsed;
+};
+
+
+/**
+ * xxHash64 of 'length' bytes at 'buffer', in one go.
+ */
+u64 xxhash64(const u8* buffer, u32 length, u64 seed);
+
+
+}   // namespace crypt
+}   // namespace rho
+
+
+#endif   // __rho_crypt_tXXHash64_h__
@@ -65,6 +65,24 @@ void unpack(iReadable* in, std::string& str, u64 maxlen = 0xFFFFFFFFFFFFFFFF);
 void pack(iWritable*  out, const iPackable& packable);
 void unpack(iReadable* in, iPackable& packable);
 
+/**
+ * Packs 'length' (as a u64) followed by the 'length' bytes at 'buffer',
+ * which is how a std::string or a std::vector<u8> is packed. The length
+ * and the bytes go to the stream in one gathered write (see
+ * iWritable::writeAllv()), so through a tcp::tSocket a large buffer is
+ * sent together with whatever was packed before it, in one syscall.
+ */
+void packBytes(iWritable* out, const u8* buffer, u64 length);
+
+/**
+ * Unpacks a byte buffer written by packBytes() (or by pack() for a
+ * std::vector<u8> or a std::string) without copying it: returns a
+ * pointer to the bytes where they sit in the mapped file, and sets
+ * 'length'. The pointer stays valid for as long as 'in' does (see
+ * tMmapReadable::borrow()).
+ */
+u8* unpackView(tMmapReadable* in, u64& length, u64 maxlen);
+
 template <class T>
 void pack(iWritable* out, const std::vector<T>& vtr)
 {
@@ -89,20 +107,7 @@ void unpack(iReadable* in, std::vector<T>& vtr, u64 maxlen = 0xFFFFFFFFFFFFFFFF)
 template <> inline
 void pack(iWritable* out, const std::vector<u8>& vtr)
 {
-    u64 size = (u64)vtr.size();
-    u64 w = 0;
-    pack(out, size);
-    while (w < size)
-    {
-        i32 where = 0;
-        if (size - w > 0x7FFFFFFF)
-            where = 0x7FFFFFFF;
-        else
-            where = (i32)(size - w);
-        if (out->writeAll(&vtr[(size_t)w], where) != where)
-            throw eBufferOverflow("Cannot pack to the given output stream.");
-        w += where;
-    }
+    packBytes(out, vtr.empty() ? NULL : &vtr[0], (u64)vtr.size());
 }
 
 template <> inline
@@ -4,6 +4,7 @@
 
 #include <rho/ppcheck.h>
 #include <rho/bNonCopyable.h>
+#include <rho/tIoVec.h>
 #include <rho/types.h>
 #include <rho/eRho.h>
 
@@ -49,6 +50,25 @@ class iReadable
          */
         virtual i32 readAll(u8* buffer, i32 length) = 0;
 
+        /**
+         * Reads into the 'count' buffers described by 'bufs', filling
+         * them in order as if they were one buffer (a "scatter" read).
+         * Otherwise it works like read(): it returns the number of bytes
+         * read, or 0 when eof is reached, or -1 if the stream is closed.
+         *
+         * The default implementation read()s into the first non-empty
+         * buffer only; streams that can do better override it.
+         */
+        virtual i32 readv(const tIoVec* bufs, i32 count);
+
+        /**
+         * Like readAll(), but for a list of buffers (see readv()).
+         *
+         * The default implementation calls readv() until the buffers
+         * are full (or eof is reached).
+         */
+        virtual i32 readAllv(const tIoVec* bufs, i32 count);
+
         virtual ~iReadable() { }
 };
 
@@ -74,6 +94,12 @@ class tBufferedReadable : public iReadable, public bNonCopyable
 
         iReadable* getInternalStream() { return m_stream; }
 
+        /**
+         * Returns the number of bytes which have been pulled from the
+         * internal stream but not yet read out of this one.
+         */
+        u32 getNumBuffered() const { return (m_pos < m_bufUsed) ? (m_bufUsed - m_pos) : 0; }
+
     private:
 
         bool m_refill();
@@ -101,6 +127,27 @@ class tFileReadable : public iReadable, public bNonCopyable
 
         std::string getFilename() const;
 
+        /**
+         * Returns the underlying file descriptor.
+         *
+         * Reads are buffered above the descriptor, so its own offset is
+         * usually ahead of this stream's; use getPosition() and
+         * setPosition() instead of seeking the descriptor.
+         */
+        int getFileDescriptor();
+
+        /**
+         * Returns the offset of the next byte read() will return.
+         */
+        u64 getPosition();
+
+        /**
+         * Moves to 'position' (an offset from the start of the file)
+         * so that read() continues from there. This also forgets that
+         * eof was seen.
+         */
+        void setPosition(u64 position);
+
     private:
 
         std::string m_filename;
@@ -109,6 +156,70 @@ class tFileReadable : public iReadable, public bNonCopyable
 };
 
 
+/**
+ * Reads a file through a memory mapping instead of stdio, so read()
+ * is a single memcpy out of the page cache, and borrow() hands out
+ * the mapped bytes themselves without copying them at all.
+ *
+ * The kernel is told the file will be read sequentially, and the
+ * region just ahead of the read position is prefetched as reading
+ * moves along.
+ */
+class tMmapReadable : public iReadable, public bNonCopyable
+{
+    public:
+
+        tMmapReadable(std::string filename);
+
+        ~tMmapReadable();
+
+        i32 read(u8* buffer, i32 length);
+        i32 readAll(u8* buffer, i32 length);
+
+        std::string getFilename() const;
+
+        /**
+         * Returns the size of the file (and of the mapping).
+         */
+        u64 getSize() const;
+
+        /**
+         * Returns the offset of the next byte read() will return.
+         */
+        u64 getPosition() const;
+
+        /**
+         * Moves to 'position' (an offset from the start of the file),
+         * and forgets that eof was seen.
+         */
+        void setPosition(u64 position);
+
+        /**
+         * Returns a pointer to the next 'length' bytes of the file, in
+         * place, and moves the read position past them. Returns NULL
+         * (and doesn't move) if fewer than 'length' bytes remain.
+         *
+         * The bytes stay valid until this object is destroyed. They are
+         * mapped copy-on-write: they may be modified, but the changes
+         * are private to this process and never reach the file.
+         */
+        u8* borrow(u64 length);
+
+    private:
+
+        void m_prefetch(u64 position, u64 length);
+
+    private:
+
+        std::string m_filename;
+        u8* m_data;
+        u64 m_size;
+        u64 m_pos;
+        u64 m_prefetchedTo;
+        bool m_eof;
+};
+
+
 class tZlibReadable : public iReadable, public bNonCopyable
 {
     public:
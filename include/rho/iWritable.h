@@ -6,6 +6,7 @@
 #include <rho/bNonCopyable.h>
 #include <rho/iFlushable.h>
 #include <rho/iClosable.h>
+#include <rho/tIoVec.h>
 #include <rho/types.h>
 #include <rho/eRho.h>
 
@@ -52,6 +53,25 @@ class iWritable
          */
         virtual i32 writeAll(const u8* buffer, i32 length) = 0;
 
+        /**
+         * Writes the 'count' buffers described by 'bufs', in order, as
+         * if they were one buffer (a "gather" write). Otherwise it works
+         * like write(): it writes what will immediately fit, and returns
+         * the number of bytes written, or 0 if an error occurred.
+         *
+         * The default implementation write()s the first non-empty buffer
+         * only; streams that can do better override it.
+         */
+        virtual i32 writev(const tConstIoVec* bufs, i32 count);
+
+        /**
+         * Like writeAll(), but for a list of buffers (see writev()).
+         *
+         * The default implementation calls writev() until everything
+         * is written (or an error occurs).
+         */
+        virtual i32 writeAllv(const tConstIoVec* bufs, i32 count);
+
         virtual ~iWritable() { }
 };
 
@@ -75,6 +95,13 @@ class tBufferedWritable : public iWritable, public iFlushable,
         i32 write(const u8* buffer, i32 length);
         i32 writeAll(const u8* buffer, i32 length);
 
+        /**
+         * Buffers the whole list if it fits. If it doesn't, what is
+         * already buffered and the new buffers are handed to the internal
+         * stream in one gathered write, without being copied.
+         */
+        i32 writev(const tConstIoVec* bufs, i32 count);
+
         bool flush();
 
     private:
@@ -98,6 +125,13 @@ class tFileWritable : public iWritable, public iFlushable,
         i32 write(const u8* buffer, i32 length);
         i32 writeAll(const u8* buffer, i32 length);
 
+        /**
+         * Small lists are coalesced in stdio's buffer. Lists of at least
+         * BUFSIZ bytes are written to the file descriptor with writev(2)
+         * (after flushing stdio), so they aren't copied.
+         */
+        i32 writev(const tConstIoVec* bufs, i32 count);
+
         bool flush();
 
         std::string getFilename() const;
@@ -21,28 +21,66 @@ enum nImageFormat
     kBGRA           = 3,      // BGRA, 32 bits == 1 pixel
     kYUYV           = 4,      // YUYV, 32 bits == 2 pixels  (aka, YUY2, see: http://www.fourcc.org/yuv.php#YUY2 and http://www.fourcc.org/fccyvrgb.php)
     kGrey           = 5,      // Grey, 8 bits  == 1 pixel
+    kI420           = 6,      // Planar YUV 4:2:0: the Y plane, then the U plane, then the V plane, each chroma sample shared by a 2x2 block
+    kNV12           = 7,      // Planar YUV 4:2:0: the Y plane, then one plane of interleaved U and V samples
+    kRGBPlanar      = 8,      // Planar RGB: the R plane, then the G plane, then the B plane
 
-    kMaxImageFormat = 6,
+    kMaxImageFormat = 9,
 
     kUnspecified    = 98,
     kUnknown        = 99
 };
 
 
-// Gets the number of bytes per pixel for the given image format.
+// Gets the number of bytes per pixel for the given image format. The planar
+// formats have none (their pixels aren't laid out one after the other), so
+// this throws for them.
 u32 getBPP(nImageFormat format);
 
 
-// Gets the number of bits per pixel for the given image format.
+// Gets the number of bits per pixel for the given image format. (For kI420
+// and kNV12 this is the average: 12.)
 u32 getBitsPP(nImageFormat format);
 
 
+// Whether the given format keeps its channels in separate planes.
+bool isPlanar(nImageFormat format);
+
+
+// Gets the number of bytes an image of the given format and size takes.
+// Unlike getBPP(), this works for every format. (kI420 and kNV12 must have
+// an even width and height.)
+u32 getBufSize(nImageFormat format, u32 width, u32 height);
+
+
 // Converts an image buffer. Returns the number of bytes used of 'dest'.
 i32 colorspace_conversion(nImageFormat from, nImageFormat to,
                           u8* source, i32 sourceSize,
                           u8* dest, i32 destSize);
 
 
+// Same as above, but uses no instruction set beyond 'maxLevel' (see
+// nSimdLevel).
+i32 colorspace_conversion(nImageFormat from, nImageFormat to,
+                          nSimdLevel maxLevel,
+                          u8* source, i32 sourceSize,
+                          u8* dest, i32 destSize);
+
+
+// Same as the two above, for an image of the given width and height. The
+// conversions to and from kI420 and kNV12 need these to find the chroma
+// planes (and throw without them); the other formats ignore them.
+i32 colorspace_conversion(nImageFormat from, nImageFormat to,
+                          u32 width, u32 height,
+                          u8* source, i32 sourceSize,
+                          u8* dest, i32 destSize);
+i32 colorspace_conversion(nImageFormat from, nImageFormat to,
+                          u32 width, u32 height,
+                          nSimdLevel maxLevel,
+                          u8* source, i32 sourceSize,
+                          u8* dest, i32 destSize);
+
+
 }  // namespace img
 }  // namespace rho
 
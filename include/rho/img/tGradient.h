@@ -0,0 +1,146 @@
+#ifndef __rho_img_tGradient_h__
+#define __rho_img_tGradient_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/bNonCopyable.h>
+#include <rho/types.h>
+#include <rho/sync/tThreadPool.h>
+
+#include <vector>
+
+
+namespace rho
+{
+namespace img
+{
+
+
+class tImage;
+class tImageView;
+
+
+enum nGradientOperator
+{
+    kGradientSobel    = 0,      // weights 1 2 1
+    kGradientScharr   = 1,      // weights 3 10 3; closer to rotation-invariant
+
+    kMaxGradientOperator = 2
+};
+
+
+enum nGradientNorm
+{
+    kGradientL1       = 0,      // |gx| + |gy|
+    kGradientL2       = 1,      // sqrt(gx^2 + gy^2), rounded
+
+    kMaxGradientNorm  = 2
+};
+
+
+/**
+ * The directions kept in the orientation plane. This is the line the
+ * gradient lies along (so the sign is lost), to the nearest 45 degrees,
+ * with x to the right and y down. These are what non-maximum suppression
+ * needs: the two neighbours to compare against lie along this line.
+ */
+enum nGradientDirection
+{
+    kGradientHorizontal   = 0,  // neighbours (x-1, y) and (x+1, y)
+    kGradientDiagonalDown = 1,  // neighbours (x-1, y-1) and (x+1, y+1)
+    kGradientVertical     = 2,  // neighbours (x, y-1) and (x, y+1)
+    kGradientDiagonalUp   = 3   // neighbours (x+1, y-1) and (x-1, y+1)
+};
+
+
+/**
+ * Computes the gradient of an image with a 3x3 operator, in one pass:
+ * a plane of 16-bit magnitudes and, optionally, a plane of directions
+ * (see nGradientDirection).
+ *
+ * As with tImage::sobel(), every byte of the pixel is treated as its own
+ * channel, and the planes are two pixels narrower and shorter than the
+ * image (there's no gradient at the border). The planes are laid out
+ * like the image: row by row, the channels of each pixel side by side.
+ *
+ * The rows are done with SSE2 / AVX2 when the cpu has them; every
+ * instruction set gives exactly the same planes.
+ */
+class tGradient : public bNonCopyable
+{
+    public:
+
+        tGradient(nGradientOperator op, nGradientNorm norm, bool withOrientation);
+
+        /**
+         * Same as above, but uses no instruction set beyond 'maxLevel'
+         * (see nSimdLevel).
+         */
+        tGradient(nGradientOperator op, nGradientNorm norm, bool withOrientation,
+                  nSimdLevel maxLevel);
+
+        /**
+         * Computes the planes for 'image' (which must be at least 3x3),
+         * replacing whatever was here.
+         */
+        void compute(const tImage* image);
+
+        /**
+         * Same as above, but splits the rows into bands and runs them on
+         * the pool. The planes are the same.
+         */
+        void compute(const tImage* image, sync::tThreadPool& pool);
+
+        /**
+         * The same two, for a view (which may be part of a bigger image;
+         * see tImageView).
+         */
+        void compute(const tImageView& view);
+        void compute(const tImageView& view, sync::tThreadPool& pool);
+
+        u32 width()    const;
+        u32 height()   const;
+        u32 channels() const;
+
+        const u16* magnitude()   const;
+        const u8*  orientation() const;   // <-- NULL unless made withOrientation
+
+        /**
+         * No magnitude this operator and norm give is bigger than this.
+         */
+        u16 maxMagnitude() const;
+
+    public:
+
+        /**
+         * Computes rows [rowBegin, rowEnd) of the planes. (Used by the
+         * row bands.)
+         */
+        void computeRows(const tImageView& view, u32 rowBegin, u32 rowEnd);
+
+    private:
+
+        void m_init(nSimdLevel maxLevel);
+        void m_prepare(const tImageView& view);
+
+    private:
+
+        nGradientOperator m_op;
+        nGradientNorm m_norm;
+        bool m_withOrientation;
+        nSimdLevel m_level;
+
+        u32 m_width;
+        u32 m_height;
+        u32 m_channels;
+
+        std::vector<u16> m_magnitude;
+        std::vector<u8>  m_orientation;
+};
+
+
+}  // namespace img
+}  // namespace rho
+
+
+#endif    // __rho_img_tGradient_h__
@@ -6,7 +6,10 @@
 #include <rho/bNonCopyable.h>
 #include <rho/geo/tRect.h>
 #include <rho/img/nImageFormat.h>
+#include <rho/img/tScaler.h>
+#include <rho/img/tWarper.h>
 #include <rho/iPackable.h>
+#include <rho/sync/tThreadPool.h>
 
 #include <cstdlib>
 #include <string>
@@ -19,6 +22,9 @@ namespace img
 {
 
 
+class tImageView;
+
+
 class tImage : public bNonCopyable, public iPackable
 {
     public:
@@ -32,6 +38,14 @@ class tImage : public bNonCopyable, public iPackable
         void copyTo(tImage* other) const;  // <-- copies must be explicit with this method
         void convertToFormat(nImageFormat format, tImage* dest) const;
 
+        /**
+         * Returns a kGrey view of this kI420 or kNV12 image's luma plane,
+         * which is the front of the buffer in both. Like any tImageView,
+         * it must not be used once this image's buffer is changed or
+         * freed.
+         */
+        tImageView viewLumaAsGrey() const;
+
         void saveToFile(std::string filepath) const;
 
         void setBufSize(u32 bufSize);      // <-- allocates a buffer of that size
@@ -58,6 +72,50 @@ class tImage : public bNonCopyable, public iPackable
         void rotate(double angleDegrees,   tImage* dest)  const;
         void rotate90CCW(int numRotations, tImage* dest)  const;
 
+        /**
+         * Like crop() above, but makes 'dest' a view of the rectangle
+         * instead of copying it (see tImageView). 'dest' must not be used
+         * once this image's buffer is changed or freed.
+         */
+        void crop(geo::tRect rect, tImageView* dest) const;
+
+        /**
+         * Scales with the given filter, using a tScaler (see tScaler.h).
+         * When scaling many images of the same size, use a tScaler
+         * directly, so that its weights are only worked out once.
+         */
+        void scale(u32 width, u32 height, nScaleFilter filter, tImage* dest) const;
+
+        /**
+         * Rotates onto the same canvas as rotate(), but works backwards
+         * from each output pixel and blends the four source pixels
+         * around where it came from, so there are no holes. See tWarper,
+         * which is also the way to rotate many same-sized frames.
+         */
+        void rotateBilinear(double angleDegrees, tImage* dest) const;
+        void rotateBilinear(double angleDegrees, tImage* dest,
+                            sync::tThreadPool& pool) const;
+
+        /**
+         * Applies an affine transformation onto a width x height canvas,
+         * using a tWarper.
+         */
+        void warp(const geo::tTrans4& trans, u32 width, u32 height, tImage* dest) const;
+
+        /**
+         * The overloads which take a tThreadPool split the work into
+         * horizontal bands of the destination image and run the bands on
+         * the pool's threads. Each band reads whatever source rows it
+         * needs (including the rows past its edges), so the result is
+         * byte-for-byte the same as the single-threaded version's.
+         *
+         * They may be called from inside a task running on 'pool'.
+         */
+        void scale (u32 width, u32 height, tImage* dest,
+                    sync::tThreadPool& pool) const;
+        void rotate(double angleDegrees,   tImage* dest,
+                    sync::tThreadPool& pool) const;
+
         /**
          * Adaptive thresholds the receiving image and stores the binary,
          * grey-scale image result into 'dest'. Three parameters can be
@@ -76,13 +134,88 @@ class tImage : public bNonCopyable, public iPackable
                                i32 t = 5,
                                i32 b = 127) const;
 
+        /**
+         * The running average carries from each pixel to the next along a
+         * single path through the whole image, so the thresholding itself
+         * can't be split into bands without changing the result; only the
+         * conversion to grey runs on the pool. (bradleyThreshold() runs
+         * entirely on the pool.)
+         */
+        void adaptiveThreshold(tImage* dest,
+                               i32 s,
+                               i32 t,
+                               i32 b,
+                               sync::tThreadPool& pool) const;
+
+        /**
+         * Thresholds the receiving image against the mean of the
+         * windowSize x windowSize window around each pixel, and stores the
+         * binary, grey-scale image result into 'dest'. A pixel is turned
+         * black if it is at least 't' percent below its window's mean
+         * (and white otherwise). The window is clipped to the image, and
+         * windowSize must be odd; width()/8 (made odd) is a good start.
+         *
+         * The window sums come from an integral image, so this takes the
+         * same time per pixel whatever the window size, and every row
+         * can be done independently.
+         *
+         * Algorithm first described by:
+         *     Bradley and Roth, "Adaptive Thresholding Using the Integral Image"
+         */
+        void bradleyThreshold(tImage* dest, u32 windowSize, u32 t) const;
+        void bradleyThreshold(tImage* dest, u32 windowSize, u32 t,
+                              sync::tThreadPool& pool) const;
+
         /**
          * Applies a median filter to the image with the specified window
          * size.
+         *
+         * Near the edges of the image the window is clipped to the image;
+         * when that leaves an even number of pixels, the mean of the
+         * middle two is used.
+         *
+         * Windows of 5 pixels or more are done with sliding histograms,
+         * which take the same time per pixel whatever the window size.
+         * Smaller windows are sorted pixel by pixel.
          */
         void medianFilter(tImage* dest,
                           u32 windowWidth=5,
                           u32 windowHeight=5) const;
+        void medianFilter(tImage* dest,
+                          u32 windowWidth,
+                          u32 windowHeight,
+                          sync::tThreadPool& pool) const;
+
+        /**
+         * Replaces each pixel by the mean (rounded) of the window around
+         * it, which must have odd dimensions. Near the edges of the image
+         * the window is clipped to the image.
+         *
+         * This uses an integral image, so it takes the same time per pixel
+         * whatever the window size. 'dest' may be this image.
+         *
+         * Works on kRGB24, kRGBA, kBGRA and kGrey images.
+         */
+        void boxBlur(tImage* dest,
+                     u32 windowWidth,
+                     u32 windowHeight) const;
+        void boxBlur(tImage* dest,
+                     u32 windowWidth,
+                     u32 windowHeight,
+                     sync::tThreadPool& pool) const;
+
+        /**
+         * Replaces each pixel by the standard deviation (rounded) of the
+         * window around it, channel by channel; windows as for boxBlur().
+         * (The local mean is boxBlur().)
+         */
+        void localStdDev(tImage* dest,
+                         u32 windowWidth,
+                         u32 windowHeight) const;
+        void localStdDev(tImage* dest,
+                         u32 windowWidth,
+                         u32 windowHeight,
+                         sync::tThreadPool& pool) const;
 
         /**
          * Finds edges using the Sobel operator, as described by:
@@ -97,6 +230,25 @@ class tImage : public bNonCopyable, public iPackable
          * so that the full range of the returned image is utilized.
          */
         void sobel(tImage* dest, u32 clipAtValue=255) const;
+        void sobel(tImage* dest, u32 clipAtValue, sync::tThreadPool& pool) const;
+
+        /**
+         * Finds edges using the Canny edge detector, as described by:
+         *     http://en.wikipedia.org/wiki/Canny_edge_detector
+         *
+         * The gradient is the same as sobel()'s (see tGradient), so there
+         * is no smoothing first; blur the image beforehand if it's noisy.
+         * Magnitudes that aren't the maximum along their gradient direction
+         * are dropped, those of at least 'highThresh' are edges, and those
+         * of at least 'lowThresh' are edges if they connect to an edge.
+         * The magnitudes go up to tGradient::maxMagnitude() (1442), not 255.
+         *
+         * Like sobel(), each byte of the pixel is its own channel, and the
+         * output is two pixels narrower and shorter than this image. Edge
+         * pixels are 255 and the rest 0.
+         */
+        void canny(tImage* dest, u32 lowThresh, u32 highThresh) const;
+        void canny(tImage* dest, u32 lowThresh, u32 highThresh, sync::tThreadPool& pool) const;
 
         /**
          * A struct used in the houghCircles() method below.
@@ -136,6 +288,44 @@ class tImage : public bNonCopyable, public iPackable
                                                u32 r_min, u32 r_max, u32 r_step,
                                                u32 voteThresh) const;
 
+        /**
+         * The Hough Transform for Circles, by gradient voting.
+         *
+         * This is run on the image itself rather than on its edges: the
+         * Sobel operator is applied here (with 'clipAtValue' as in
+         * sobel()), and the pixels whose edge value would be over 127 are
+         * the edge points. Each edge point then votes for the centres one
+         * radius away along its gradient direction (both ways), looked up
+         * in a table of offsets made once per call. So the time taken
+         * grows with the number of edge points times the number of radii,
+         * rather than with the size of the whole search space.
+         *
+         * The search space, 'allRadiiAccumulator', 'voteThresh' and the
+         * returned circles are as for houghCircles() above, except that
+         * a vote is one edge point, and the coordinates are those of this
+         * image (the output of sobel() is one pixel in from each edge).
+         * Sobel's edges are two pixels thick and its directions are
+         * rough, so a search point counts the votes for the 3x3 pixels
+         * around it.
+         */
+        std::vector<tHoughCircle> houghCirclesGradient(std::vector< std::vector<u32> >& allRadiiAccumulator,
+                                                       u32 x_min, u32 x_max, u32 x_step,
+                                                       u32 y_min, u32 y_max, u32 y_step,
+                                                       u32 r_min, u32 r_max, u32 r_step,
+                                                       u32 voteThresh, u32 clipAtValue) const;
+
+        /**
+         * Same as above, but the edge points are found in bands of rows,
+         * and the radii are split among the pool's threads. The result is
+         * the same.
+         */
+        std::vector<tHoughCircle> houghCirclesGradient(std::vector< std::vector<u32> >& allRadiiAccumulator,
+                                                       u32 x_min, u32 x_max, u32 x_step,
+                                                       u32 y_min, u32 y_max, u32 y_step,
+                                                       u32 r_min, u32 r_max, u32 r_step,
+                                                       u32 voteThresh, u32 clipAtValue,
+                                                       sync::tThreadPool& pool) const;
+
     public:
 
         struct tRow
@@ -171,9 +361,20 @@ class tImage : public bNonCopyable, public iPackable
         void pack(iWritable* out) const;
         void unpack(iReadable* in);
 
+        /**
+         * Like unpack(), but the pixel buffer is borrowed from the mapped
+         * file instead of being copied (see tMmapReadable::borrow()).
+         *
+         * The image must then not be used after 'in' is destroyed, unless
+         * it has been given a buffer of its own again in the meantime
+         * (by setBufSize(), unpack(), copyTo(), etc).
+         */
+        void unpackView(tMmapReadable* in);
+
     private:
 
         u8*          m_buf;
+        bool         m_ownsBuf;
         u32          m_bufSize;
         u32          m_bufUsed;
         u32          m_width;
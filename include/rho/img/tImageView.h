@@ -0,0 +1,146 @@
+#ifndef __rho_img_tImageView_h__
+#define __rho_img_tImageView_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/types.h>
+#include <rho/geo/tRect.h>
+#include <rho/img/nImageFormat.h>
+#include <rho/img/tImage.h>
+#include <rho/img/tScaler.h>
+#include <rho/sync/tThreadPool.h>
+
+
+namespace rho
+{
+namespace img
+{
+
+
+/**
+ * A read-only window onto the pixels of an image which lives somewhere
+ * else (usually a tImage): an origin, a width and height, and a row
+ * stride, which is the number of bytes from the start of one row to the
+ * start of the next. A view of part of an image has the stride of the
+ * whole image, so making one copies nothing.
+ *
+ * Views are small and are passed around by value. A view doesn't own its
+ * pixels, so it must not be used once the buffer it looks into is changed
+ * or freed; and the filters below must not be asked to write into the
+ * image a view looks into (they throw if they are).
+ *
+ * The filters are the same code as tImage's (tImage's methods view their
+ * whole image and call it), so filtering a view gives exactly the bytes
+ * that filtering a crop()ed copy of it would.
+ *
+ * Only packed formats can be viewed; see tImage::viewLumaAsGrey() for
+ * the luma plane of kI420 and kNV12 images.
+ */
+class tImageView
+{
+    public:
+
+        /**
+         * An empty (0x0) view.
+         */
+        tImageView();
+
+        /**
+         * A view of the whole of 'image'.
+         */
+        tImageView(const tImage& image);
+
+        /**
+         * A view of the width x height pixels at 'buf', whose rows are
+         * 'stride' bytes apart. ('format' must be a packed format.)
+         */
+        tImageView(const u8* buf, u32 width, u32 height, u32 stride, nImageFormat format);
+
+        const u8*    buf()      const;     // <-- the top-left pixel
+        u32          width()    const;
+        u32          height()   const;
+        u32          stride()   const;
+        u32          bpp()      const;
+        nImageFormat format()   const;
+
+        /**
+         * Whether the rows follow one another with no gap, as in a tImage.
+         */
+        bool isContiguous() const;
+
+        /**
+         * Whether this view's pixels are in 'image's buffer. (An empty
+         * view's never are.)
+         */
+        bool looksInto(const tImage* image) const;
+
+        /**
+         * Makes 'dest' a view of the given rectangle of this view. The
+         * rectangle is clipped to this view the same way tImage::crop()
+         * clips it.
+         */
+        void crop(geo::tRect rect, tImageView* dest) const;
+
+        /**
+         * Copies the pixels into 'dest', which becomes a plain
+         * width x height image. (This is what tImage::crop() does.)
+         */
+        void copyTo(tImage* dest) const;
+
+        /**
+         * These are tImage's filters (see tImage.h). Their output is a
+         * plain image the size of this view (or, for sobel(), two pixels
+         * smaller).
+         */
+        void convertToFormat(nImageFormat format, tImage* dest) const;
+
+        void scale(u32 width, u32 height, tImage* dest) const;
+        void scale(u32 width, u32 height, tImage* dest,
+                   sync::tThreadPool& pool) const;
+        void scale(u32 width, u32 height, nScaleFilter filter, tImage* dest) const;
+
+        void adaptiveThreshold(tImage* dest, i32 s, i32 t, i32 b) const;
+        void adaptiveThreshold(tImage* dest, i32 s, i32 t, i32 b,
+                               sync::tThreadPool& pool) const;
+
+        void medianFilter(tImage* dest, u32 windowWidth, u32 windowHeight) const;
+        void medianFilter(tImage* dest, u32 windowWidth, u32 windowHeight,
+                          sync::tThreadPool& pool) const;
+
+        void sobel(tImage* dest, u32 clipAtValue) const;
+        void sobel(tImage* dest, u32 clipAtValue, sync::tThreadPool& pool) const;
+
+    public:
+
+        struct tRow
+        {
+            const u8* m_rowbuf;
+            u32 m_bpp;
+
+            const u8* operator[] (size_t index) const { return m_rowbuf+index*m_bpp; }
+        };
+
+        const tRow operator[] (size_t index) const
+        {
+            tRow row;
+            row.m_rowbuf = m_buf + index*m_stride;
+            row.m_bpp = m_bpp;
+            return row;
+        }
+
+    private:
+
+        const u8*    m_buf;
+        u32          m_width;
+        u32          m_height;
+        u32          m_stride;
+        u32          m_bpp;
+        nImageFormat m_format;
+};
+
+
+}    // namespace img
+}    // namespace rho
+
+
+#endif   // __rho_img_tImageView_h__
@@ -0,0 +1,112 @@
+#ifndef __rho_img_tIntegralImage_h__
+#define __rho_img_tIntegralImage_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/bNonCopyable.h>
+#include <rho/types.h>
+#include <rho/sync/tThreadPool.h>
+
+#include <vector>
+
+
+namespace rho
+{
+namespace img
+{
+
+
+class tImage;
+
+
+/**
+ * The integral image (summed-area table) of an image: for each channel,
+ * the sum of every pixel above and to the left of each point. With it the
+ * sum of the pixels in any rectangle takes four lookups, whatever the size
+ * of the rectangle.
+ *
+ * Optionally the sums of the squares of the pixels are kept too, which is
+ * what local variances need.
+ *
+ * The sums are 32-bit and are allowed to wrap around; the four-lookup
+ * differences come out right anyway for any rectangle whose true sum fits
+ * in 32 bits, which is any rectangle of fewer than 16843009 pixels.
+ * The sums of squares are 64-bit.
+ *
+ * The rows of the table are built with SSE2 when the cpu has it. The
+ * table is the same either way.
+ *
+ * Works on kRGB24, kRGBA, kBGRA and kGrey images.
+ */
+class tIntegralImage : public bNonCopyable
+{
+    public:
+
+        tIntegralImage();
+
+        /**
+         * Same as above, but uses no instruction set beyond 'maxLevel'
+         * (see nSimdLevel).
+         */
+        tIntegralImage(nSimdLevel maxLevel);
+
+        /**
+         * Builds the table(s) for 'image', replacing whatever was here.
+         */
+        void build(const tImage* image, bool withSquares);
+
+        /**
+         * Same as above, but the rows are summed in bands on the pool,
+         * and then the columns in bands. The tables are the same.
+         */
+        void build(const tImage* image, bool withSquares, sync::tThreadPool& pool);
+
+        u32  width()      const;
+        u32  height()     const;
+        u32  channels()   const;
+        bool hasSquares() const;
+
+        /**
+         * The sum of 'channel' over the pixels with x in [x0, x1) and y in
+         * [y0, y1).
+         */
+        u32 sum(u32 x0, u32 y0, u32 x1, u32 y1, u32 channel) const;
+
+        /**
+         * The same for the squares of the pixels. (Only if the table was
+         * built with squares.)
+         */
+        u64 sumOfSquares(u32 x0, u32 y0, u32 x1, u32 y1, u32 channel) const;
+
+        /**
+         * The tables themselves. Each has height()+1 rows of
+         * (width()+1)*channels() entries; the first row and first column
+         * are zero, and entry [y][x][c] is the sum over the pixels above
+         * and left of pixel (x, y).
+         */
+        const u32* sums()    const;
+        const u64* squares() const;
+        u32        stride()  const;    // <-- entries per row of the tables
+
+    private:
+
+        void m_prepare(const tImage* image, bool withSquares);
+
+    private:
+
+        nSimdLevel m_level;
+
+        u32 m_width;
+        u32 m_height;
+        u32 m_channels;
+
+        std::vector<u32> m_sums;
+        std::vector<u64> m_squares;
+};
+
+
+}  // namespace img
+}  // namespace rho
+
+
+#endif    // __rho_img_tIntegralImage_h__
@@ -0,0 +1,129 @@
+#ifndef __rho_img_tScaler_h__
+#define __rho_img_tScaler_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/bNonCopyable.h>
+#include <rho/types.h>
+
+#include <vector>
+
+
+namespace rho
+{
+namespace img
+{
+
+
+class tImage;
+class tImageView;
+
+
+enum nScaleFilter
+{
+    kScaleBox         = 0,      // the average of the pixels under each output pixel
+    kScaleBilinear    = 1,      // triangle filter, 2 source pixels wide (when enlarging)
+    kScaleBicubic     = 2,      // Keys cubic (a = -0.5), 4 source pixels wide
+    kScaleLanczos3    = 3,      // windowed sinc, 6 source pixels wide; sharpest
+
+    kMaxScaleFilter   = 4
+};
+
+
+/**
+ * Scales images of one fixed size to another fixed size.
+ *
+ * This is a separable resampler: the image is filtered horizontally to the
+ * new width and vertically to the new height, one pass after the other
+ * (in whichever order is cheaper for the two sizes). When shrinking, the
+ * filter is stretched so that every source pixel counts towards the
+ * result.
+ *
+ * The filter weights for each output row and column are worked out once,
+ * in the constructor, as 14-bit fixed-point numbers. So keep one of these
+ * around to scale a stream of same-sized frames. The filtering itself is
+ * done in integer math, with SSE2 / AVX2 when the cpu has them; every
+ * instruction set gives exactly the same bytes.
+ *
+ * Works on kRGB24, kRGBA, kBGRA and kGrey images. (kYUYV and kRGB16 pack
+ * more than one channel into their bytes; convert them first.)
+ */
+class tScaler : public bNonCopyable
+{
+    public:
+
+        tScaler(u32 fromWidth, u32 fromHeight,
+                u32 toWidth,   u32 toHeight,
+                nScaleFilter filter);
+
+        /**
+         * Same as above, but uses no instruction set beyond 'maxLevel'
+         * (see nSimdLevel).
+         */
+        tScaler(u32 fromWidth, u32 fromHeight,
+                u32 toWidth,   u32 toHeight,
+                nScaleFilter filter,
+                nSimdLevel maxLevel);
+
+        /**
+         * Scales 'from' (which must be fromWidth x fromHeight) into 'to'.
+         * The format of 'to' is set to that of 'from'.
+         */
+        void scale(const tImage* from, tImage* to);
+
+        /**
+         * Same as above, for a view (which may be part of a bigger image;
+         * see tImageView).
+         */
+        void scale(const tImageView& from, tImage* to);
+
+        u32 fromWidth()  const;
+        u32 fromHeight() const;
+        u32 toWidth()    const;
+        u32 toHeight()   const;
+        nScaleFilter filter() const;
+
+    public:
+
+        /**
+         * The filter for one dimension: output pixel i is the weighted sum
+         * of input pixels [starts[i], starts[i]+counts[i]), with the weights
+         * at weights[i*maxTaps]. Each output's weights add up to exactly
+         * 1 << 14.
+         */
+        struct tWeights
+        {
+            u32 maxTaps;
+            std::vector<u32> starts;
+            std::vector<u32> counts;
+            std::vector<i16> weights;
+        };
+
+    private:
+
+        void m_init(nSimdLevel maxLevel);
+
+    private:
+
+        u32 m_fromWidth;
+        u32 m_fromHeight;
+        u32 m_toWidth;
+        u32 m_toHeight;
+        nScaleFilter m_filter;
+        nSimdLevel m_level;
+
+        tWeights m_horizontal;
+        tWeights m_vertical;
+        bool m_verticalFirst;
+        u32 m_firstRow;           // <-- the source rows used are [m_firstRow, m_lastRow)
+        u32 m_lastRow;
+
+        std::vector<u8> m_temp;   // <-- the result of the first pass
+};
+
+
+}  // namespace img
+}  // namespace rho
+
+
+#endif    // __rho_img_tScaler_h__
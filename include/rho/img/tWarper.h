@@ -0,0 +1,133 @@
+#ifndef __rho_img_tWarper_h__
+#define __rho_img_tWarper_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/bNonCopyable.h>
+#include <rho/types.h>
+#include <rho/geo/tTrans4.h>
+#include <rho/sync/tThreadPool.h>
+
+#include <vector>
+
+
+namespace rho
+{
+namespace img
+{
+
+
+class tImage;
+
+
+/**
+ * Applies an affine transformation (rotation, scaling, shearing,
+ * translation, or any product of those) to images of one fixed size.
+ *
+ * This works backwards: each output pixel is mapped through the inverse
+ * transformation to a point in the source image, and the four source
+ * pixels around that point are blended (bilinear sampling). So every
+ * output pixel gets exactly one value -- there are no holes and nothing
+ * is drawn twice. Output pixels which map to outside the source image
+ * are black.
+ *
+ * The source point is stepped along each output row in 16.16 fixed point,
+ * so there is no per-pixel matrix math. For a stream of same-sized frames
+ * call cacheRemapTable() once, and each warp() is then just lookups and
+ * blends.
+ *
+ * Works on kRGB24, kRGBA, kBGRA and kGrey images.
+ */
+class tWarper : public bNonCopyable
+{
+    public:
+
+        /**
+         * 'trans' maps a point (x, y) in the source image to the point
+         * where it belongs in the output image. Pixel (x, y) is the point
+         * (x, y); only the 2D part of 'trans' is used.
+         */
+        tWarper(u32 fromWidth, u32 fromHeight,
+                u32 toWidth,   u32 toHeight,
+                const geo::tTrans4& trans);
+
+        /**
+         * Works out, once, where each output pixel samples from, so that
+         * later calls to warp() needn't. Costs eight bytes per output pixel.
+         * Output is the same either way.
+         */
+        void cacheRemapTable();
+
+        /**
+         * Warps 'from' (which must be fromWidth x fromHeight) into 'to'.
+         * The format of 'to' is set to that of 'from'.
+         */
+        void warp(const tImage* from, tImage* to);
+
+        /**
+         * Same as above, but splits the output rows into bands and runs
+         * them on the pool. The output is the same.
+         */
+        void warp(const tImage* from, tImage* to, sync::tThreadPool& pool);
+
+        u32 fromWidth()  const;
+        u32 fromHeight() const;
+        u32 toWidth()    const;
+        u32 toHeight()   const;
+
+    public:
+
+        /**
+         * Where one output pixel samples from: the index of the top-left
+         * source pixel (or -1 for outside the image), and how far (in
+         * 256ths of a pixel) the point is to its right and below it.
+         */
+        struct tRemap
+        {
+            i32 offset;
+            u8  fx;
+            u8  fy;
+        };
+
+        /**
+         * Writes output rows [rowBegin, rowEnd). (Used by the row bands.)
+         */
+        void warpRows(const tImage* from, tImage* to, u32 rowBegin, u32 rowEnd) const;
+
+    private:
+
+        void m_prepare(const tImage* from, tImage* to) const;
+        void m_remapRow(u32 row, tRemap* remap) const;
+
+    private:
+
+        u32 m_fromWidth;
+        u32 m_fromHeight;
+        u32 m_toWidth;
+        u32 m_toHeight;
+
+        // The inverse transformation: output pixel (col, row) samples
+        // source point (ax*col + bx*row + cx, ay*col + by*row + cy).
+        f64 m_ax, m_bx, m_cx;
+        f64 m_ay, m_by, m_cy;
+        i64 m_stepX;              // <-- ax and ay in 16.16 fixed point
+        i64 m_stepY;
+
+        std::vector<tRemap> m_table;
+};
+
+
+/**
+ * Builds the transformation which rotates a width x height image by
+ * 'angleDegrees' about its centre, into the canvas size tImage::rotate()
+ * uses (returned in 'newWidth' and 'newHeight').
+ */
+geo::tTrans4 rotationTransform(u32 width, u32 height, f64 angleDegrees,
+                               u32* newWidth, u32* newHeight);
+
+
+}  // namespace img
+}  // namespace rho
+
+
+#endif    // __rho_img_tWarper_h__
@@ -29,12 +29,23 @@ class eSocketCreationError : public ebIP
 {
     public:
 
-        eSocketCreationError(std::string reason)
-            : ebIP(reason)
+        eSocketCreationError(std::string reason, int errnum = 0)
+            : ebIP(reason),
+              m_errnum(errnum)
         {
         }
 
         ~eSocketCreationError() throw() { }
+
+        /**
+         * Returns the errno of the call that failed, or 0 if the
+         * thrower didn't record one.
+         */
+        int errnum() const { return m_errnum; }
+
+    private:
+
+        int m_errnum;
 };
 
 
@@ -0,0 +1,72 @@
+#ifndef __rho_ip_tcp_iReactorObserver_h__
+#define __rho_ip_tcp_iReactorObserver_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/ip/tcp/_pre.h>
+#include <rho/ip/ebIP.h>
+#include <rho/refc.h>
+#include <rho/types.h>
+
+
+namespace rho
+{
+namespace ip
+{
+namespace tcp
+{
+
+
+class tReactor;
+
+
+/**
+ * Receives the events of the servers and sockets in a tReactor.
+ * (Incoming bytes don't come here; they go to the socket's
+ * iAsyncReadable.) Every method is called on the thread running
+ * the reactor.
+ */
+class iReactorObserver
+{
+    public:
+
+        /**
+         * Called when 'server' accepts a new connection. The socket
+         * is not in the reactor yet; add() it if you want to.
+         */
+        virtual void accepted(tReactor& reactor, refc<tServer> server,
+                              refc<tSocket> socket) { }
+
+        /**
+         * Called when 'server' fails to accept a connection. If the
+         * cause may pass (e.g. the process is out of file descriptors),
+         * the reactor tries again every so often.
+         */
+        virtual void acceptFailed(tReactor& reactor, refc<tServer> server,
+                                  const eSocketCreationError& e) { }
+
+        /**
+         * Called when everything queued with tReactor::send() has been
+         * handed to the kernel, after a send() that couldn't finish
+         * right away.
+         */
+        virtual void writable(tReactor& reactor, refc<tSocket> socket) { }
+
+        /**
+         * Called when the connection has been closed by the other side
+         * (or broken, or given up on because a callback threw). The
+         * socket has already been removed from the reactor, and its
+         * iAsyncReadable has been sent endStream().
+         */
+        virtual void closed(tReactor& reactor, refc<tSocket> socket) { }
+
+        virtual ~iReactorObserver() { }
+};
+
+
+}   // namespace tcp
+}   // namespace ip
+}   // namespace rho
+
+
+#endif    // __rho_ip_tcp_iReactorObserver_h__
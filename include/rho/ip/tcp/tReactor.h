@@ -0,0 +1,159 @@
+#ifndef __rho_ip_tcp_tReactor_h__
+#define __rho_ip_tcp_tReactor_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/ip/tcp/iReactorObserver.h>
+#include <rho/ip/tcp/tServer.h>
+#include <rho/ip/tcp/tSocket.h>
+#include <rho/bNonCopyable.h>
+#include <rho/iAsyncReadable.h>
+#include <rho/refc.h>
+#include <rho/types.h>
+
+#include <map>
+#include <vector>
+
+
+namespace rho
+{
+namespace ip
+{
+namespace tcp
+{
+
+
+struct tReactorEntry;
+
+
+/**
+ * An event loop which services many non-blocking servers and sockets
+ * from one thread, so that a process can hold tens of thousands of
+ * (mostly idle) connections without a thread per connection.
+ *
+ * It is built on edge-triggered epoll, so it is Linux-only; the
+ * constructor throws elsewhere.
+ *
+ * Bytes arriving on a socket are pushed into the iAsyncReadable given
+ * to add(), so async parsers like tZlibAsyncReadable plug in directly.
+ * Bytes going out are passed to send(), which writes what it can right
+ * away and queues the rest until the socket is writable again.
+ *
+ * When the peer shuts down its side of a connection, the socket's
+ * iAsyncReadable is sent endStream() straight away. Bytes queued for the
+ * peer (including any send() from endStream()) are still delivered; then
+ * the reactor shuts down its side too and closes the connection.
+ *
+ * If a callback throws, the exception is reported on stderr, and the
+ * connection it was for (if any) is closed as if the peer had gone.
+ *
+ * Except for stop(), the methods of this class must be called either
+ * from the thread running the reactor (i.e. from the callbacks) or
+ * while the reactor isn't running.
+ */
+class tReactor : public bNonCopyable
+{
+    public:
+
+        /**
+         * Creates an empty reactor.
+         */
+        tReactor();
+
+        /**
+         * Destroys the reactor. The servers and sockets still in it are
+         * dropped (they close once nobody else references them); their
+         * observers are not told.
+         */
+        ~tReactor();
+
+        /**
+         * Adds a server. It's put into non-blocking mode, and each
+         * connection it accepts is handed to obs->accepted().
+         */
+        void add(refc<tServer> server, iReactorObserver* obs);
+
+        /**
+         * Adds a socket. It's put into non-blocking mode. Incoming bytes
+         * are given to 'sink'. 'obs' may be NULL if you don't care
+         * about the socket's other events.
+         *
+         * The reactor does not own 'sink' or 'obs'.
+         */
+        void add(refc<tSocket> socket, iAsyncReadable* sink, iReactorObserver* obs);
+
+        /**
+         * Removes a server or socket from the reactor (without calling
+         * any observer). Bytes still queued for the socket are dropped.
+         */
+        void remove(refc<tServer> server);
+        void remove(refc<tSocket> socket);
+
+        /**
+         * Sends bytes on a socket that is in the reactor. As much as
+         * possible is written immediately; the rest is buffered.
+         * If the connection turns out to be broken, it is closed (see
+         * iReactorObserver::closed()) before this returns.
+         */
+        void send(refc<tSocket> socket, const u8* buffer, i32 length);
+
+        /**
+         * Returns the number of bytes buffered for the socket (i.e. which
+         * send() couldn't write yet). Use this to apply back-pressure.
+         */
+        u32 pendingOutput(refc<tSocket> socket) const;
+
+        /**
+         * Returns the number of servers and sockets in the reactor.
+         */
+        u32 size() const;
+
+        /**
+         * Dispatches events until stop() is called.
+         */
+        void run();
+
+        /**
+         * Waits up to 'timeoutMS' milliseconds for events, and dispatches
+         * those that arrived. Returns the number of events dispatched.
+         */
+        u32 runOnce(u32 timeoutMS);
+
+        /**
+         * Makes run() return soon. May be called from any thread.
+         */
+        void stop();
+
+    private:
+
+        tReactorEntry* m_find(int fd) const;
+        void m_register(tReactorEntry* entry, u32 events);
+        void m_remove(tReactorEntry* entry);
+        void m_dispatch(tReactorEntry* entry, u32 events);
+        void m_accept(tReactorEntry* entry);
+        void m_read(tReactorEntry* entry);
+        void m_flush(tReactorEntry* entry);
+        void m_close(tReactorEntry* entry);
+        void m_guardedDispatch(tReactorEntry* entry, u32 events);
+        u32  m_wait(int timeoutMS);
+
+    private:
+
+        int                            m_epollFd;
+        int                            m_wakeFd;
+        u32                            m_stopping;
+
+        std::map<int, tReactorEntry*>  m_entries;
+        std::vector<tReactorEntry*>    m_dead;
+        std::vector<tReactorEntry*>    m_acceptRetries;
+
+        std::vector<u8>                m_readBuf;
+};
+
+
+}   // namespace tcp
+}   // namespace ip
+}   // namespace rho
+
+
+#endif    // __rho_ip_tcp_tReactor_h__
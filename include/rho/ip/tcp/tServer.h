@@ -59,6 +59,18 @@ class tServer : public bNonCopyable
          */
         refc<tSocket> accept(u32 timeoutMS);
 
+        /**
+         * Puts the server socket into (or takes it out of) non-blocking
+         * mode. In non-blocking mode, accept() returns null right away
+         * when there is no connection waiting.
+         */
+        void setNonBlocking(bool on);
+
+        /**
+         * Returns the underlying unix socket file descriptor.
+         */
+        int getFileDescriptor() { return m_fd; }
+
         ~tServer();
 
     private:
@@ -92,23 +92,83 @@ class tSocket :
          */
         void setTimeout(u16 seconds);
 
+        /**
+         * Puts the socket into (or takes it out of) non-blocking mode.
+         * Sockets are blocking by default.
+         *
+         * The iReadable/iWritable methods below don't understand
+         * would-block, so a non-blocking socket should only be used
+         * through its file descriptor (this is what tReactor does), or
+         * with transferFrom(), which does.
+         */
+        void setNonBlocking(bool on);
+
         /**
          * See iReadable interface.
          */
         i32 read(u8* buffer, i32 length);
         i32 readAll(u8* buffer, i32 length);
 
+        /**
+         * See iReadable interface. Once the read buffer is drained this
+         * reads straight into 'bufs' with one readv(2).
+         */
+        i32 readv(const tIoVec* bufs, i32 count);
+
         /**
          * See iWritable interface.
          */
         i32 write(const u8* buffer, i32 length);
         i32 writeAll(const u8* buffer, i32 length);
 
+        /**
+         * See iWritable interface. Lists too big for the write buffer go
+         * out with one writev(2) (together with whatever was buffered),
+         * so e.g. a header and a large payload cost one syscall and no copy.
+         */
+        i32 writev(const tConstIoVec* bufs, i32 count);
+
         /**
          * See iFlushable interface.
          */
         bool flush();
 
+        /**
+         * Sends up to 'length' bytes of 'file' (starting at its current
+         * position) on this socket, and advances the file's position past
+         * what was sent.
+         *
+         * On Linux the bytes go straight from the page cache to the socket
+         * with sendfile(2), without being copied through userspace;
+         * elsewhere they are copied through a buffer.
+         *
+         * Anything already written to this socket is flushed first.
+         * Returns the number of bytes sent, which is less than 'length'
+         * if the end of the file is reached or the connection breaks, or
+         * if this socket is non-blocking and fills up (in which case it
+         * stays open, and you can call this again once it has room).
+         */
+        u64 transferFrom(tFileReadable& file, u64 length);
+
+        /**
+         * Forwards up to 'length' bytes received on 'source' to this
+         * socket.
+         *
+         * On Linux the bytes are moved with splice(2) through a pipe,
+         * so they never enter userspace (except for bytes 'source' had
+         * already buffered, which are sent first). Elsewhere they are
+         * copied through a buffer.
+         *
+         * Anything already written to this socket is flushed first.
+         * Returns the number of bytes forwarded, which is less than
+         * 'length' if 'source' reaches eof or either connection breaks,
+         * or if 'source' is non-blocking and has nothing more for now (in
+         * which case both stay open). When this socket is non-blocking
+         * and fills up, this waits for room for the bytes it has already
+         * taken from 'source'.
+         */
+        u64 transferFrom(tSocket& source, u64 length);
+
         /**
          * Shuts down the socket's input and output streams.
          */
@@ -139,6 +199,8 @@ class tSocket :
 
         i32 m_read(u8* buffer, i32 length);
         i32 m_write(const u8* buffer, i32 length);
+        i32 m_readv(const tIoVec* bufs, i32 count);
+        i32 m_writev(const tConstIoVec* bufs, i32 count);
 
         friend class tServer;
 
@@ -159,9 +221,11 @@ class tSocket :
 
                 i32 read(u8* buffer, i32 length);
                 i32 readAll(u8* buffer, i32 length);
+                i32 readv(const tIoVec* bufs, i32 count);
 
                 i32 write(const u8* buffer, i32 length);
                 i32 writeAll(const u8* buffer, i32 length);
+                i32 writev(const tConstIoVec* bufs, i32 count);
 
             private:
 
@@ -176,6 +240,21 @@ class tSocket :
 };
 
 
+/**
+ * Moves up to 'length' bytes from 'from' to 'to'.
+ *
+ * When 'to' is a tSocket and 'from' is a tFileReadable or another
+ * tSocket, this is tSocket::transferFrom(), so it takes the zero-copy
+ * path where there is one. Any other pair is copied through a buffer
+ * using read() and writeAll() (so what was written may still be
+ * sitting in 'to''s buffer when this returns).
+ *
+ * Returns the number of bytes moved, which is less than 'length'
+ * if 'from' reaches eof or 'to' stops accepting bytes.
+ */
+u64 transfer(iReadable* from, iWritable* to, u64 length);
+
+
 } // namespace tcp
 } // namespace ip
 } // namespace rho
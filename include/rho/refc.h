@@ -3,6 +3,8 @@
 
 
 #include <rho/ppcheck.h>
+#include <rho/bNonCopyable.h>
+#include <rho/bRefcounted.h>
 #include <rho/eRho.h>
 
 #include <rho/sync/tAtomicInt.h>
@@ -11,12 +13,38 @@
 
 #include <cstdlib>
 #include <map>
+#include <new>
 
 
 namespace rho
 {
 
 
+template <class T>
+class tRefcBlock;
+
+
+/**
+ * A reference-counting smart pointer. The object is deleted when the last
+ * refc pointing to it goes away.
+ *
+ * There are three ways refc can keep the count:
+ *
+ *   - By default (refc<T>(new T)), the count is allocated separately and
+ *     the object is recorded in a global table, so that a second refc made
+ *     from the same raw pointer shares the count.
+ *
+ *   - If T derives from bRefcounted, the count lives inside the object.
+ *     Nothing extra is allocated and the global table is never touched.
+ *
+ *   - makeRefc<T>(args...) constructs the object and its count in a single
+ *     allocation. (Don't make another refc from the raw pointer of such an
+ *     object unless T derives from bRefcounted.)
+ *
+ * All three behave identically through the API below. A refc<Derived>
+ * converts to a refc<Base> which shares its count; the object is still
+ * deleted as a Derived, however it was made.
+ */
 template <class T>
 class refc
 {
@@ -25,9 +53,11 @@ class refc
         refc();
         explicit refc(T* object);
         refc(const refc& other);
+        template <class U> refc(const refc<U>& other);
 
         const refc& operator= (T* object);
         const refc& operator= (const refc& other);
+        template <class U> const refc& operator= (const refc<U>& other);
 
         T& operator* ();
         T* operator-> ();
@@ -47,11 +77,45 @@ class refc
 
     private:
 
-        T*          m_object;
-        sync::au32* m_ref_count;
+        // The destroy functions are given the object as the type it was
+        // made with, which a converted refc<Base> doesn't know.
+        typedef void (*tDestroyFunc)(void* object, sync::au32* count);
+
+        refc(T* object, sync::au32* count, tDestroyFunc destroy);
+
+        void m_share(T* object, sync::au32* count, void* owned, tDestroyFunc destroy);
+
+        void m_acquire(T* object);
+        void m_release();
+
+        static sync::au32* s_intrusiveCount(const bRefcounted* object);
+        static sync::au32* s_intrusiveCount(const void* object);
+
+        static void s_destroyShared(void* object, sync::au32* count);
+        static void s_destroyIntrusive(void* object, sync::au32* count);
+
+    private:
+
+        T*           m_object;
+        sync::au32*  m_ref_count;
+        void*        m_owned;
+        tDestroyFunc m_destroy;
+
+        template <class U>
+        friend class refc;
+
+        friend class tRefcBlock<T>;
 };
 
 
+/*
+ * A note on the memory orderings used below: taking a new reference from an
+ * existing one only needs a relaxed increment (the holder already keeps the
+ * object alive), but dropping a reference needs acquire-release so that
+ * every other holder's writes to the object happen-before its deletion.
+ */
+
+
 extern std::map<void*, sync::au32*> gAllKnownRefcObjectsMap;
 
 extern sync::tMutex                 gAllKnownRefcObjectsSync;
@@ -60,45 +124,50 @@ extern sync::tMutex                 gAllKnownRefcObjectsSync;
 template <class T>
 refc<T>::refc()
     : m_object(NULL),
-      m_ref_count(NULL)
+      m_ref_count(NULL),
+      m_owned(NULL),
+      m_destroy(NULL)
 {
 }
 
 template <class T>
 refc<T>::refc(T* object)
     : m_object(NULL),
-      m_ref_count(NULL)
+      m_ref_count(NULL),
+      m_owned(NULL),
+      m_destroy(NULL)
 {
-    if (object == NULL)
-    {
-        return;
-    }
-
-    sync::tAutoSync as(gAllKnownRefcObjectsSync);
-    if (gAllKnownRefcObjectsMap.find(object) != gAllKnownRefcObjectsMap.end())
-    {
-        m_object = object;
-        m_ref_count = gAllKnownRefcObjectsMap[object];
-        ++(*m_ref_count);
-    }
-    else
-    {
-        m_object = object;
-        m_ref_count = new sync::au32(1);
-        gAllKnownRefcObjectsMap.insert(
-                std::make_pair((void*)m_object, m_ref_count));
-    }
+    m_acquire(object);
 }
 
 template <class T>
 refc<T>::refc(const refc<T>& other)
     : m_object(NULL),
-      m_ref_count(NULL)
+      m_ref_count(NULL),
+      m_owned(NULL),
+      m_destroy(NULL)
+{
+    m_share(other.m_object, other.m_ref_count, other.m_owned, other.m_destroy);
+}
+
+template <class T>
+template <class U>
+refc<T>::refc(const refc<U>& other)
+    : m_object(NULL),
+      m_ref_count(NULL),
+      m_owned(NULL),
+      m_destroy(NULL)
+{
+    m_share(other.m_object, other.m_ref_count, other.m_owned, other.m_destroy);
+}
+
+template <class T>
+refc<T>::refc(T* object, sync::au32* count, tDestroyFunc destroy)
+    : m_object(object),
+      m_ref_count(count),
+      m_owned((void*)object),
+      m_destroy(destroy)
 {
-    m_object = other.m_object;
-    m_ref_count = other.m_ref_count;
-    if (m_ref_count)
-        ++(*m_ref_count);
 }
 
 template <class T>
@@ -107,61 +176,34 @@ const refc<T>& refc<T>::operator= (const refc<T>& other)
     if (m_object == other.m_object)
         return *this;
 
-    if ((m_ref_count) && --(*m_ref_count) == 0)
-    {
-        {
-            sync::tAutoSync as(gAllKnownRefcObjectsSync);
-            gAllKnownRefcObjectsMap.erase(m_object);
-        }
-        delete m_object;
-        delete m_ref_count;
-    }
-
-    m_object = other.m_object;
-    m_ref_count = other.m_ref_count;
-    if (m_ref_count)
-        ++(*m_ref_count);
+    m_release();
+    m_share(other.m_object, other.m_ref_count, other.m_owned, other.m_destroy);
 
     return *this;
 }
 
 template <class T>
-const refc<T>& refc<T>::operator= (T* object)
+template <class U>
+const refc<T>& refc<T>::operator= (const refc<U>& other)
 {
+    T* object = other.m_object;
     if (m_object == object)
         return *this;
 
-    if ((m_ref_count) && --(*m_ref_count) == 0)
-    {
-        {
-            sync::tAutoSync as(gAllKnownRefcObjectsSync);
-            gAllKnownRefcObjectsMap.erase(m_object);
-        }
-        delete m_object;
-        delete m_ref_count;
-    }
+    m_release();
+    m_share(object, other.m_ref_count, other.m_owned, other.m_destroy);
 
-    if (object == NULL)
-    {
-        m_object = NULL;
-        m_ref_count = NULL;
+    return *this;
+}
+
+template <class T>
+const refc<T>& refc<T>::operator= (T* object)
+{
+    if (m_object == object)
         return *this;
-    }
 
-    sync::tAutoSync as(gAllKnownRefcObjectsSync);
-    if (gAllKnownRefcObjectsMap.find(object) != gAllKnownRefcObjectsMap.end())
-    {
-        m_object = object;
-        m_ref_count = gAllKnownRefcObjectsMap[object];
-        ++(*m_ref_count);
-    }
-    else
-    {
-        m_object = object;
-        m_ref_count = new sync::au32(1);
-        gAllKnownRefcObjectsMap.insert(
-                std::make_pair((void*)m_object, m_ref_count));
-    }
+    m_release();
+    m_acquire(object);
 
     return *this;
 }
@@ -239,17 +281,211 @@ refc<T>::operator const T* () const
 template <class T>
 refc<T>::~refc()
 {
-    if ((m_ref_count) && --(*m_ref_count) == 0)
+    m_release();
+}
+
+template <class T>
+void refc<T>::m_share(T* object, sync::au32* count, void* owned, tDestroyFunc destroy)
+{
+    m_object = object;
+    m_ref_count = count;
+    m_owned = owned;
+    m_destroy = destroy;
+    if (m_ref_count)
+        m_ref_count->fetchAdd(1, sync::kRelaxed);
+}
+
+template <class T>
+void refc<T>::m_acquire(T* object)
+{
+    m_object = object;
+    m_ref_count = NULL;
+    m_owned = (void*)object;
+    m_destroy = NULL;
+
+    if (object == NULL)
+        return;
+
+    sync::au32* intrusiveCount = s_intrusiveCount(object);
+    if (intrusiveCount)
     {
-        {
-            sync::tAutoSync as(gAllKnownRefcObjectsSync);
-            gAllKnownRefcObjectsMap.erase(m_object);
-        }
-        delete m_object;
-        delete m_ref_count;
+        m_ref_count = intrusiveCount;
+        m_destroy = s_destroyIntrusive;
+        m_ref_count->fetchAdd(1, sync::kRelaxed);
+        return;
+    }
+
+    m_destroy = s_destroyShared;
+    sync::tAutoSync as(gAllKnownRefcObjectsSync);
+    std::map<void*, sync::au32*>::iterator itr = gAllKnownRefcObjectsMap.find((void*)object);
+    if (itr != gAllKnownRefcObjectsMap.end())
+    {
+        m_ref_count = itr->second;
+        ++(*m_ref_count);
+    }
+    else
+    {
+        m_ref_count = new sync::au32(1);
+        gAllKnownRefcObjectsMap.insert(
+                std::make_pair((void*)m_object, m_ref_count));
     }
+}
+
+template <class T>
+void refc<T>::m_release()
+{
+    if ((m_ref_count) && m_ref_count->fetchSub(1, sync::kAcqRel) == 1)
+        m_destroy(m_owned, m_ref_count);
     m_object = NULL;
     m_ref_count = NULL;
+    m_owned = NULL;
+    m_destroy = NULL;
+}
+
+template <class T>
+sync::au32* refc<T>::s_intrusiveCount(const bRefcounted* object)
+{
+    return &(const_cast<bRefcounted*>(object)->m_refcCount);
+}
+
+template <class T>
+sync::au32* refc<T>::s_intrusiveCount(const void* object)
+{
+    return NULL;
+}
+
+template <class T>
+void refc<T>::s_destroyShared(void* object, sync::au32* count)
+{
+    {
+        sync::tAutoSync as(gAllKnownRefcObjectsSync);
+        gAllKnownRefcObjectsMap.erase(object);
+    }
+    delete static_cast<T*>(object);
+    delete count;
+}
+
+template <class T>
+void refc<T>::s_destroyIntrusive(void* object, sync::au32* count)
+{
+    delete static_cast<T*>(object);
+}
+
+
+/*
+ * The single allocation behind makeRefc(): the count, then (suitably
+ * aligned) the object. Use makeRefc() rather than this class.
+ */
+template <class T>
+class tRefcBlock : public bNonCopyable
+{
+    private:
+
+        static char s_probe(const bRefcounted* object);
+        static long s_probe(const void* object);
+
+    public:
+
+        enum { kIntrusive = (sizeof(s_probe((T*)NULL)) == sizeof(char)) };
+
+        tRefcBlock()
+            : m_mem(::operator new(kObjectOffset + sizeof(T)))
+        {
+        }
+
+        void* objectMemory()
+        {
+            return static_cast<char*>(m_mem) + kObjectOffset;
+        }
+
+        refc<T> adopt(T* object)
+        {
+            sync::au32* count = new (m_mem) sync::au32(1);
+            m_mem = NULL;
+            return refc<T>(object, count, s_destroy);
+        }
+
+        ~tRefcBlock()
+        {
+            if (m_mem)
+                ::operator delete(m_mem);     // <-- T's constructor threw
+        }
+
+    private:
+
+        static void s_destroy(void* object, sync::au32* count)
+        {
+            static_cast<T*>(object)->~T();
+            count->~tAtomicInt();
+            ::operator delete(static_cast<void*>(count));
+        }
+
+    private:
+
+        enum { kAlign = __alignof__(T) };
+        enum { kObjectOffset = (sizeof(sync::au32) + kAlign - 1) / kAlign * kAlign };
+
+        void* m_mem;
+};
+
+
+/**
+ * Constructs a T from the given arguments and returns a refc to it. The
+ * object and its reference count share one allocation. (If T derives from
+ * bRefcounted the object is simply new'd, since it carries its own count.)
+ */
+template <class T>
+refc<T> makeRefc()
+{
+    if (tRefcBlock<T>::kIntrusive)
+        return refc<T>(new T());
+    tRefcBlock<T> block;
+    return block.adopt(new (block.objectMemory()) T());
+}
+
+template <class T, class A1>
+refc<T> makeRefc(const A1& a1)
+{
+    if (tRefcBlock<T>::kIntrusive)
+        return refc<T>(new T(a1));
+    tRefcBlock<T> block;
+    return block.adopt(new (block.objectMemory()) T(a1));
+}
+
+template <class T, class A1, class A2>
+refc<T> makeRefc(const A1& a1, const A2& a2)
+{
+    if (tRefcBlock<T>::kIntrusive)
+        return refc<T>(new T(a1, a2));
+    tRefcBlock<T> block;
+    return block.adopt(new (block.objectMemory()) T(a1, a2));
+}
+
+template <class T, class A1, class A2, class A3>
+refc<T> makeRefc(const A1& a1, const A2& a2, const A3& a3)
+{
+    if (tRefcBlock<T>::kIntrusive)
+        return refc<T>(new T(a1, a2, a3));
+    tRefcBlock<T> block;
+    return block.adopt(new (block.objectMemory()) T(a1, a2, a3));
+}
+
+template <class T, class A1, class A2, class A3, class A4>
+refc<T> makeRefc(const A1& a1, const A2& a2, const A3& a3, const A4& a4)
+{
+    if (tRefcBlock<T>::kIntrusive)
+        return refc<T>(new T(a1, a2, a3, a4));
+    tRefcBlock<T> block;
+    return block.adopt(new (block.objectMemory()) T(a1, a2, a3, a4));
+}
+
+template <class T, class A1, class A2, class A3, class A4, class A5>
+refc<T> makeRefc(const A1& a1, const A2& a2, const A3& a3, const A4& a4, const A5& a5)
+{
+    if (tRefcBlock<T>::kIntrusive)
+        return refc<T>(new T(a1, a2, a3, a4, a5));
+    tRefcBlock<T> block;
+    return block.adopt(new (block.objectMemory()) T(a1, a2, a3, a4, a5));
 }
 
 
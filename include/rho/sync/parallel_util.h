@@ -0,0 +1,113 @@
+#ifndef __rho_sync_parallel_util_h__
+#define __rho_sync_parallel_util_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/bNonCopyable.h>
+#include <rho/eRho.h>
+#include <rho/refc.h>
+#include <rho/types.h>
+#include <rho/sync/iRunnable.h>
+#include <rho/sync/tThreadPool.h>
+
+#include <vector>
+
+
+namespace rho
+{
+namespace sync
+{
+
+
+/**
+ * Calls functor(b, e) on sub-ranges [b, e) which together cover exactly
+ * [begin, end), using the pool's threads. Each sub-range is at most
+ * 'grain' long. Returns once every sub-range is done.
+ *
+ * The functor is shared by all the threads, so its operator() must be
+ * safe to call concurrently on disjoint ranges. It must look like:
+ *
+ *          void operator() (u32 begin, u32 end);
+ *
+ * The range is split in halves recursively; the calling thread keeps
+ * one half and pushes the other onto the pool. So idle workers steal
+ * big chunks first, and the caller always does useful work. It is fine
+ * to call parallelFor() from inside a pool task (nested loops don't
+ * deadlock; see tThreadPool::wait()).
+ *
+ * Exceptions thrown by the functor on the calling thread propagate (after
+ * all pushed sub-ranges finish); those thrown on other pool threads are
+ * reported by the pool and swallowed, so prefer a functor that doesn't
+ * throw.
+ */
+template <class F>
+void parallelFor(tThreadPool& pool, u32 begin, u32 end, u32 grain, F& functor);
+
+
+template <class F>
+class tParallelForTask : public iRunnable, public bNonCopyable
+{
+    public:
+
+        tParallelForTask(tThreadPool& pool, u32 begin, u32 end, u32 grain, F& functor)
+            : m_pool(pool),
+              m_begin(begin),
+              m_end(end),
+              m_grain(grain),
+              m_functor(functor)
+        {
+        }
+
+        void run()
+        {
+            parallelFor(m_pool, m_begin, m_end, m_grain, m_functor);
+        }
+
+    private:
+
+        tThreadPool& m_pool;
+        u32          m_begin;
+        u32          m_end;
+        u32          m_grain;
+        F&           m_functor;
+};
+
+
+template <class F>
+void parallelFor(tThreadPool& pool, u32 begin, u32 end, u32 grain, F& functor)
+{
+    if (grain == 0)
+        throw eInvalidArgument("The grain size must be >0");
+    if (end <= begin)
+        return;
+
+    std::vector<tThreadPool::tTaskKey> keys;
+
+    try
+    {
+        while (end - begin > grain)
+        {
+            u32 mid = begin + (end - begin) / 2;
+            refc<iRunnable> task(new tParallelForTask<F>(pool, mid, end, grain, functor));
+            keys.push_back(pool.push(task));
+            end = mid;
+        }
+        functor(begin, end);
+    }
+    catch (...)
+    {
+        for (size_t i = 0; i < keys.size(); i++)
+            pool.wait(keys[i]);
+        throw;
+    }
+
+    for (size_t i = keys.size(); i > 0; i--)
+        pool.wait(keys[i-1]);
+}
+
+
+}    // namespace sync
+}    // namespace rho
+
+
+#endif   // __rho_sync_parallel_util_h__
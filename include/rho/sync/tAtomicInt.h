@@ -6,9 +6,6 @@
 #include <rho/bNonCopyable.h>
 #include <rho/types.h>
 
-#include <rho/sync/tAutoSync.h>
-#include <rho/sync/tMutex.h>
-
 #include <iostream>
 
 
@@ -33,6 +30,26 @@ typedef tAtomicInt<i32> ai32;
 typedef tAtomicInt<i64> ai64;
 
 
+/**
+ * Memory orderings for the explicit tAtomicInt operations. These have the
+ * same meaning as the C++11 std::memory_order values of the same names.
+ *
+ *   kRelaxed -- atomic, but orders nothing else (e.g. plain counters)
+ *   kAcquire -- later reads/writes can't move before this load
+ *   kRelease -- earlier reads/writes can't move after this store
+ *   kAcqRel  -- both (for read-modify-write operations)
+ *   kSeqCst  -- a single total order (what the operators use)
+ */
+enum nMemoryOrder
+{
+    kRelaxed = __ATOMIC_RELAXED,
+    kAcquire = __ATOMIC_ACQUIRE,
+    kRelease = __ATOMIC_RELEASE,
+    kAcqRel  = __ATOMIC_ACQ_REL,
+    kSeqCst  = __ATOMIC_SEQ_CST
+};
+
+
 template <class T>
 std::ostream& operator<< (std::ostream& o, const tAtomicInt<T>& ai);
 
@@ -40,6 +57,12 @@ template <class T>
 std::istream& operator>> (std::istream& i, tAtomicInt<T>& ai);
 
 
+/**
+ * An integer whose operations are atomic. The operators are lock-free
+ * (they compile down to the CPU's atomic instructions) and sequentially
+ * consistent. When you know you need less ordering than that, use the
+ * explicit load()/store()/fetchAdd()/... methods below.
+ */
 template <class T>
 class tAtomicInt : public bNonCopyable
 {
@@ -92,75 +115,133 @@ class tAtomicInt : public bNonCopyable
          */
         T operator-- ();
 
+    public:
+
+        /**
+         * Returns the value. 'order' should be kRelaxed, kAcquire or kSeqCst.
+         */
+        T load(nMemoryOrder order) const;
+
+        /**
+         * Sets the value. 'order' should be kRelaxed, kRelease or kSeqCst.
+         */
+        void store(T val, nMemoryOrder order);
+
+        /**
+         * Adds 'n' and returns the value from *before* the addition.
+         */
+        T fetchAdd(T n, nMemoryOrder order);
+
+        /**
+         * Subtracts 'n' and returns the value from *before* the subtraction.
+         */
+        T fetchSub(T n, nMemoryOrder order);
+
+        /**
+         * Sets the value to 'val' and returns the previous value.
+         */
+        T exchange(T val, nMemoryOrder order);
+
+        /**
+         * If the value equals 'expected', sets it to 'desired' and returns
+         * true. Otherwise copies the current value into 'expected' and
+         * returns false.
+         */
+        bool compareExchange(T& expected, T desired, nMemoryOrder order);
+
     private:
 
-        T      m_val;
-        tMutex m_mutex;
+        T m_val;
 };
 
 
 template <class T>
 tAtomicInt<T>::tAtomicInt()
-    : m_val(0),
-      m_mutex()
+    : m_val(0)
 {
 }
 
 template <class T>
 tAtomicInt<T>::tAtomicInt(T initialVal)
-    : m_val(initialVal),
-      m_mutex()
+    : m_val(initialVal)
 {
 }
 
 template <class T>
 void tAtomicInt<T>::operator= (T newval)
 {
-    tAutoSync as(m_mutex);
-    m_val = newval;
+    __atomic_store_n(&m_val, newval, __ATOMIC_SEQ_CST);
 }
 
 template <class T>
 T tAtomicInt<T>::val() const
 {
-    T temp = m_val;
-    return temp;
+    return __atomic_load_n(&m_val, __ATOMIC_SEQ_CST);
 }
 
 template <class T>
 T tAtomicInt<T>::operator+= (T n)
 {
-    tAutoSync as(m_mutex);
-    m_val += n;
-    T temp = m_val;
-    return temp;
+    return __atomic_add_fetch(&m_val, n, __ATOMIC_SEQ_CST);
 }
 
 template <class T>
 T tAtomicInt<T>::operator-= (T n)
 {
-    tAutoSync as(m_mutex);
-    m_val -= n;
-    T temp = m_val;
-    return temp;
+    return __atomic_sub_fetch(&m_val, n, __ATOMIC_SEQ_CST);
 }
 
 template <class T>
 T tAtomicInt<T>::operator++ ()
 {
-    tAutoSync as(m_mutex);
-    ++m_val;
-    T temp = m_val;
-    return temp;
+    return __atomic_add_fetch(&m_val, 1, __ATOMIC_SEQ_CST);
 }
 
 template <class T>
 T tAtomicInt<T>::operator-- ()
 {
-    tAutoSync as(m_mutex);
-    --m_val;
-    T temp = m_val;
-    return temp;
+    return __atomic_sub_fetch(&m_val, 1, __ATOMIC_SEQ_CST);
+}
+
+template <class T>
+T tAtomicInt<T>::load(nMemoryOrder order) const
+{
+    return __atomic_load_n(&m_val, order);
+}
+
+template <class T>
+void tAtomicInt<T>::store(T val, nMemoryOrder order)
+{
+    __atomic_store_n(&m_val, val, order);
+}
+
+template <class T>
+T tAtomicInt<T>::fetchAdd(T n, nMemoryOrder order)
+{
+    return __atomic_fetch_add(&m_val, n, order);
+}
+
+template <class T>
+T tAtomicInt<T>::fetchSub(T n, nMemoryOrder order)
+{
+    return __atomic_fetch_sub(&m_val, n, order);
+}
+
+template <class T>
+T tAtomicInt<T>::exchange(T val, nMemoryOrder order)
+{
+    return __atomic_exchange_n(&m_val, val, order);
+}
+
+template <class T>
+bool tAtomicInt<T>::compareExchange(T& expected, T desired, nMemoryOrder order)
+{
+    // The failure ordering may not be release-flavored or stronger than
+    // the success ordering, so derive it from 'order'.
+    int failOrder = (order == kAcqRel) ? __ATOMIC_ACQUIRE
+                  : (order == kRelease) ? __ATOMIC_RELAXED
+                  : order;
+    return __atomic_compare_exchange_n(&m_val, &expected, desired, false, order, failOrder);
 }
 
 template <class T>
@@ -0,0 +1,467 @@
+#ifndef __rho_sync_tLockFreePCQ_h__
+#define __rho_sync_tLockFreePCQ_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/bNonCopyable.h>
+#include <rho/eRho.h>
+#include <rho/sync/ebSync.h>
+#include <rho/sync/tPCQ.h>
+#include <rho/types.h>
+#include <rho/sysinclude.h>
+
+
+namespace rho
+{
+namespace sync
+{
+
+
+/**
+ * Lock-free Producer-Consumer Queue
+ *
+ * This is a drop-in alternative to tPCQ for when many producers and many
+ * consumers are hammering the same queue. Items live in a fixed-size ring
+ * buffer, and each slot carries a sequence number which producers and
+ * consumers use to claim the slot with a single compare-and-swap (this is
+ * Dmitry Vyukov's bounded MPMC queue). The enqueue and dequeue positions
+ * each sit on their own cache line so that producers and consumers do not
+ * fight over the same line.
+ *
+ * A mutex is only touched when a thread has to go to sleep: i.e. when a
+ * consumer finds the queue empty, or when a kBlock producer finds the
+ * queue full. While the queue is neither empty nor full, push() and pop()
+ * never lock anything.
+ *
+ * Differences from tPCQ:
+ *   - The capacity is rounded up to the next power of two (and is at
+ *     least two, since the slot sequence numbers can't tell "full" from
+ *     "empty" in a one-slot ring).
+ *   - kGrow is not supported (the ring cannot be resized without a lock).
+ *   - T must be default-constructible and assignable. A popped slot is
+ *     reset to T() so that the queue doesn't keep things (like refc
+ *     objects) alive longer than necessary.
+ */
+template <class T>
+class tLockFreePCQ : public bNonCopyable
+{
+    public:
+
+        /**
+         * Creates a producer-consumer queue with (at least) the specified
+         * capacity and the specified overflow behavior. The behavior must
+         * be kDiscard, kBlock, or kThrow.
+         */
+        tLockFreePCQ(u32 capacity, nPCQOverflowBehavior behavior);
+
+        /**
+         * Pushes the item onto the queue. The overflow behavior
+         * specified at the queue's construction will be used
+         * if the item overflows the queue's capacity.
+         */
+        void push(T item);
+
+        /**
+         * Pops the front item off of the queue and returns it. If the
+         * queue has no items when this method is called, the calling
+         * thread will block until an item is available.
+         */
+        T pop();
+
+        /**
+         * Pops the front item off of the queue and returns it. If the
+         * queue has no items when this method is called, the calling
+         * thread will block until an item is available, or until 'timeoutMS'
+         * milliseconds pass. If no item is available after 'timeoutMS'
+         * milliseconds, this method will throw a eQueueBlockingTimeoutExpired
+         * exception.
+         */
+        T pop(u32 timeoutMS);
+
+        /**
+         * Returns the number of items in the queue. When other threads
+         * are pushing and popping this is only a snapshot.
+         */
+        u32 size() const;
+
+        /**
+         * Returns the capacity of the queue. This is the number of items
+         * which will fit into the queue before the overflow behavior is
+         * performed. (It is the requested capacity rounded up to a
+         * power of two, and is never less than two.)
+         */
+        u32 capacity() const;
+
+        /**
+         * Destructs...
+         */
+        ~tLockFreePCQ();
+
+    private:
+
+        bool m_tryPush(const T& item);
+        bool m_tryPop(T& item);
+
+        void m_wakeConsumers();
+        void m_wakeProducers();
+
+        void m_wait(pthread_cond_t* cond, const struct timespec* abstime);
+
+        void m_lock();
+        void m_unlock();
+
+        class tAutoLock
+        {
+            public:
+                tAutoLock(tLockFreePCQ* pcq) : m_pcq(pcq) { m_pcq->m_lock(); }
+                ~tAutoLock() { m_pcq->m_unlock(); }
+            private:
+                tLockFreePCQ* m_pcq;
+        };
+
+        class tAutoWaiter
+        {
+            public:
+                tAutoWaiter(u32* count) : m_count(count) { __atomic_add_fetch(m_count, 1, __ATOMIC_SEQ_CST);
+                                                           __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+                ~tAutoWaiter() { __atomic_sub_fetch(m_count, 1, __ATOMIC_SEQ_CST); }
+            private:
+                u32* m_count;
+        };
+
+    private:
+
+        enum { kCacheLineSize = 64 };
+        enum { kSpinTries = 64 };
+
+        struct tCell
+        {
+            u64 seq;
+            T   item;
+        };
+
+        char  m_pad0[kCacheLineSize];
+        u64   m_enqueuePos;
+        char  m_pad1[kCacheLineSize - sizeof(u64)];
+        u64   m_dequeuePos;
+        char  m_pad2[kCacheLineSize - sizeof(u64)];
+
+        tCell* m_cells;
+        u64    m_mask;
+        u32    m_capacity;
+
+        nPCQOverflowBehavior m_behavior;
+
+        u32 m_waitingConsumers;
+        u32 m_waitingProducers;
+
+        pthread_mutex_t m_mutex;
+        pthread_cond_t  m_queueHasSomething;
+        pthread_cond_t  m_queueHasRoom;
+};
+
+
+template <class T>
+tLockFreePCQ<T>::tLockFreePCQ(u32 capacity, nPCQOverflowBehavior behavior)
+    : m_enqueuePos(0),
+      m_dequeuePos(0),
+      m_cells(NULL),
+      m_mask(0),
+      m_capacity(2),
+      m_behavior(behavior),
+      m_waitingConsumers(0),
+      m_waitingProducers(0),
+      m_mutex(),
+      m_queueHasSomething(),
+      m_queueHasRoom()
+{
+    if (capacity == 0)
+    {
+        throw eInvalidArgument("The queue's capacity must be >0");
+    }
+    if (capacity > 0x80000000)
+    {
+        throw eInvalidArgument("The queue's capacity must be <=2^31");
+    }
+    if (behavior != kDiscard && behavior != kBlock && behavior != kThrow)
+    {
+        throw eInvalidArgument("The lock-free queue supports kDiscard, kBlock, and kThrow only");
+    }
+    while (m_capacity < capacity)
+        m_capacity <<= 1;
+    m_mask = m_capacity - 1;
+
+    m_cells = new tCell[m_capacity];
+    for (u32 i = 0; i < m_capacity; i++)
+        m_cells[i].seq = i;
+
+    if (pthread_mutex_init(&m_mutex, NULL) != 0)
+    {
+        delete [] m_cells;
+        throw eMutexCreationError();
+    }
+    if (pthread_cond_init(&m_queueHasSomething, NULL) != 0)
+    {
+        delete [] m_cells;
+        pthread_mutex_destroy(&m_mutex);
+        throw eConditionCreationError();
+    }
+    if (pthread_cond_init(&m_queueHasRoom, NULL) != 0)
+    {
+        delete [] m_cells;
+        pthread_mutex_destroy(&m_mutex);
+        pthread_cond_destroy(&m_queueHasSomething);
+        throw eConditionCreationError();
+    }
+}
+
+template <class T>
+tLockFreePCQ<T>::~tLockFreePCQ()
+{
+    delete [] m_cells;
+    m_cells = NULL;
+    pthread_mutex_destroy(&m_mutex);
+    pthread_cond_destroy(&m_queueHasSomething);
+    pthread_cond_destroy(&m_queueHasRoom);
+}
+
+template <class T>
+void tLockFreePCQ<T>::push(T item)
+{
+    for (u32 i = 0; i < kSpinTries; i++)
+    {
+        if (m_tryPush(item))
+        {
+            m_wakeConsumers();
+            return;
+        }
+        if (m_behavior != kBlock)
+            break;
+    }
+
+    switch (m_behavior)
+    {
+        case kDiscard:
+            return;
+        case kBlock:
+        {
+            tAutoLock al(this);
+            tAutoWaiter aw(&m_waitingProducers);
+            while (!m_tryPush(item))
+                m_wait(&m_queueHasRoom, NULL);
+            break;
+        }
+        case kThrow:
+            throw eBufferOverflow("The PCQ is out of room!");
+            break;
+        case kGrow:
+        default:
+            throw eLogicError("What?");
+            break;
+    }
+
+    m_wakeConsumers();
+}
+
+template <class T>
+T tLockFreePCQ<T>::pop()
+{
+    T item;
+
+    for (u32 i = 0; i < kSpinTries; i++)
+    {
+        if (m_tryPop(item))
+        {
+            m_wakeProducers();
+            return item;
+        }
+    }
+
+    {
+        tAutoLock al(this);
+        tAutoWaiter aw(&m_waitingConsumers);
+        while (!m_tryPop(item))
+            m_wait(&m_queueHasSomething, NULL);
+    }
+
+    m_wakeProducers();
+    return item;
+}
+
+template <class T>
+T tLockFreePCQ<T>::pop(u32 timeoutMS)
+{
+    T item;
+
+    if (m_tryPop(item))
+    {
+        m_wakeProducers();
+        return item;
+    }
+
+    struct timeval currtime; gettimeofday(&currtime, NULL);
+    struct timespec abstime;
+    abstime.tv_sec = currtime.tv_sec;
+    abstime.tv_nsec = currtime.tv_usec * 1000;
+    abstime.tv_sec += timeoutMS / 1000;
+    abstime.tv_nsec += (timeoutMS % 1000) * 1000000;
+    if (abstime.tv_nsec >= 1000000000)
+    {
+        abstime.tv_nsec -= 1000000000;
+        abstime.tv_sec += 1;
+    }
+
+    {
+        tAutoLock al(this);
+        tAutoWaiter aw(&m_waitingConsumers);
+        while (!m_tryPop(item))
+            m_wait(&m_queueHasSomething, &abstime);
+    }
+
+    m_wakeProducers();
+    return item;
+}
+
+template <class T>
+u32 tLockFreePCQ<T>::size() const
+{
+    u64 deq = __atomic_load_n(&m_dequeuePos, __ATOMIC_ACQUIRE);
+    u64 enq = __atomic_load_n(&m_enqueuePos, __ATOMIC_ACQUIRE);
+    if (enq <= deq)
+        return 0;
+    if (enq - deq > m_capacity)
+        return m_capacity;
+    return (u32)(enq - deq);
+}
+
+template <class T>
+u32 tLockFreePCQ<T>::capacity() const
+{
+    return m_capacity;
+}
+
+template <class T>
+bool tLockFreePCQ<T>::m_tryPush(const T& item)
+{
+    u64 pos = __atomic_load_n(&m_enqueuePos, __ATOMIC_RELAXED);
+    while (true)
+    {
+        tCell& cell = m_cells[pos & m_mask];
+        u64 seq = __atomic_load_n(&cell.seq, __ATOMIC_ACQUIRE);
+        i64 diff = (i64)(seq - pos);
+        if (diff == 0)
+        {
+            // The slot is free; try to claim it. (On failure 'pos' is
+            // reloaded with the current enqueue position.)
+            if (__atomic_compare_exchange_n(&m_enqueuePos, &pos, pos+1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                cell.item = item;
+                __atomic_store_n(&cell.seq, pos+1, __ATOMIC_RELEASE);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;    // full
+        }
+        else
+        {
+            pos = __atomic_load_n(&m_enqueuePos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+template <class T>
+bool tLockFreePCQ<T>::m_tryPop(T& item)
+{
+    u64 pos = __atomic_load_n(&m_dequeuePos, __ATOMIC_RELAXED);
+    while (true)
+    {
+        tCell& cell = m_cells[pos & m_mask];
+        u64 seq = __atomic_load_n(&cell.seq, __ATOMIC_ACQUIRE);
+        i64 diff = (i64)(seq - (pos+1));
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&m_dequeuePos, &pos, pos+1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                item = cell.item;
+                cell.item = T();
+                __atomic_store_n(&cell.seq, pos+m_mask+1, __ATOMIC_RELEASE);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;    // empty
+        }
+        else
+        {
+            pos = __atomic_load_n(&m_dequeuePos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+template <class T>
+void tLockFreePCQ<T>::m_wakeConsumers()
+{
+    // Pairs with the seq-cst increment in tAutoWaiter: either the sleeper
+    // sees our item when it re-checks the queue, or we see the sleeper here.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&m_waitingConsumers, __ATOMIC_RELAXED) == 0)
+        return;
+    tAutoLock al(this);
+    if (pthread_cond_broadcast(&m_queueHasSomething) != 0)
+        throw eRuntimeError("Why can't I broadcast?");
+}
+
+template <class T>
+void tLockFreePCQ<T>::m_wakeProducers()
+{
+    if (m_behavior != kBlock)
+        return;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&m_waitingProducers, __ATOMIC_RELAXED) == 0)
+        return;
+    tAutoLock al(this);
+    if (pthread_cond_broadcast(&m_queueHasRoom) != 0)
+        throw eRuntimeError("Why can't I broadcast?");
+}
+
+template <class T>
+void tLockFreePCQ<T>::m_wait(pthread_cond_t* cond, const struct timespec* abstime)
+{
+    if (abstime == NULL)
+    {
+        if (pthread_cond_wait(cond, &m_mutex) != 0)
+            throw eRuntimeError("Why can't I wait on the condition?");
+        return;
+    }
+    int returnVal = pthread_cond_timedwait(cond, &m_mutex, abstime);
+    if (returnVal == ETIMEDOUT)
+        throw eQueueBlockingTimeoutExpired();
+    if (returnVal != 0)
+        throw eRuntimeError("Why can't I wait on the condition?");
+}
+
+template <class T>
+void tLockFreePCQ<T>::m_lock()
+{
+    if (pthread_mutex_lock(&m_mutex) != 0)
+        throw eRuntimeError("Cannot lock pcq mutex!");
+}
+
+template <class T>
+void tLockFreePCQ<T>::m_unlock()
+{
+    if (pthread_mutex_unlock(&m_mutex) != 0)
+        throw eRuntimeError("Cannot unlock pcq mutex!");
+}
+
+
+}    // namespace sync
+}    // namespace rho
+
+
+#endif   // __rho_sync_tLockFreePCQ_h__
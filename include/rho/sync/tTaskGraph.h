@@ -0,0 +1,96 @@
+#ifndef __rho_sync_tTaskGraph_h__
+#define __rho_sync_tTaskGraph_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/bNonCopyable.h>
+#include <rho/refc.h>
+#include <rho/types.h>
+#include <rho/sync/iRunnable.h>
+#include <rho/sync/tThreadPool.h>
+
+#include <vector>
+
+
+namespace rho
+{
+namespace sync
+{
+
+
+/**
+ * A small dependency graph of tasks (a DAG) which runs on a tThreadPool.
+ *
+ * Add tasks with add(), then declare edges with addDependency(a, b),
+ * meaning "b may only start once a has finished". run() schedules every
+ * task which has no predecessors; each finishing task then schedules any
+ * successor whose predecessors have all finished. No pool thread ever
+ * sits blocked waiting for a predecessor.
+ *
+ * run() returns once every task in the graph has finished. It may be
+ * called from inside a pool task (nested graphs are fine), and the graph
+ * may be run() again afterward.
+ *
+ * A task which throws is reported on std::cerr (as tThreadPool does) and
+ * counts as finished, so its successors still run.
+ */
+class tTaskGraph : public bNonCopyable
+{
+    public:
+
+        typedef u32 tNodeId;
+
+        tTaskGraph();
+
+        /**
+         * Adds a task to the graph and returns its id.
+         */
+        tNodeId add(refc<iRunnable> runnable);
+
+        /**
+         * Declares that 'after' must not start until 'before' has finished.
+         */
+        void addDependency(tNodeId before, tNodeId after);
+
+        /**
+         * Returns the number of tasks in the graph.
+         */
+        u32 size() const;
+
+        /**
+         * Runs the whole graph on 'pool' and returns when it's done.
+         * Throws eInvalidArgument (before running anything) if the
+         * dependencies contain a cycle.
+         */
+        void run(tThreadPool& pool);
+
+        ~tTaskGraph();
+
+    private:
+
+        void m_schedule(tNodeId id);
+        void m_finished(tNodeId id);
+
+    private:
+
+        struct tNode
+        {
+            refc<iRunnable>      runnable;
+            std::vector<tNodeId> successors;
+            u32                  numPredecessors;
+            u32                  numPending;
+        };
+
+        std::vector<tNode> m_nodes;
+        tThreadPool*       m_pool;
+        u32                m_numUnfinished;
+
+        friend class tGraphNodeTask;
+};
+
+
+}    // namespace sync
+}    // namespace rho
+
+
+#endif   // __rho_sync_tTaskGraph_h__
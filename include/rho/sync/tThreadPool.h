@@ -4,9 +4,7 @@
 
 #include <rho/ppcheck.h>
 #include <rho/sync/tThread.h>
-#include <rho/sync/tPCQ.h>
 
-#include <set>
 #include <utility>
 #include <vector>
 
@@ -17,6 +15,30 @@ namespace sync
 {
 
 
+class tWorkerQueue;
+class tTaskGraph;
+
+
+/**
+ * A pool of worker threads which run iRunnable tasks.
+ *
+ * Each worker owns a task deque. Tasks pushed from outside the pool are
+ * dealt round-robin onto the workers' deques; tasks pushed from inside
+ * a running task go onto the current worker's own deque. A worker runs
+ * the newest task from its own deque first and, when that deque is
+ * empty, steals the oldest task from another worker's deque. So workers
+ * only contend with each other when one of them has run dry.
+ *
+ * Completion is tracked with one atomic state word per task, so
+ * finishing a task doesn't take any pool-wide lock unless somebody
+ * is sleeping in wait().
+ *
+ * A task may itself push() more tasks and wait() on them. When wait() is
+ * called on one of the pool's own threads, that thread keeps running
+ * queued tasks until the awaited one finishes instead of going to sleep,
+ * so nested parallelism neither deadlocks nor idles a worker. (See also
+ * tTaskGraph and parallelFor().)
+ */
 class tThreadPool : public bNonCopyable
 {
     public:
@@ -28,31 +50,76 @@ class tThreadPool : public bNonCopyable
 
         typedef u64 tTaskKey;
 
+        /**
+         * Schedules the runnable to be run by one of the pool's threads.
+         * You must eventually either wait() on or forget() the returned key.
+         */
         tTaskKey push(refc<iRunnable> runnable);
+
+        /**
+         * Blocks until the task identified by 'key' has finished running.
+         * The key is no longer valid after this returns.
+         *
+         * If called from one of this pool's threads, the thread runs other
+         * queued tasks while it waits.
+         */
         void     wait(tTaskKey key);
+
+        /**
+         * Tells the pool that you will never wait() on 'key'.
+         */
         void     forget(tTaskKey key);
 
     private:
 
-        tTaskKey m_incrementKey();
-        void     m_addToCompleted(tTaskKey key);
+        struct tSlot
+        {
+            u32 generation;
+            u32 state;
+            u32 nextFree;
+        };
+
+        typedef std::pair< u32,refc<iRunnable> > tTask;
+
+        u32      m_allocSlot();
+        void     m_freeSlot(u32 index);
+        tSlot&   m_slot(u32 index);
+        tSlot&   m_lookup(tTaskKey key, u32& index);
+
         tTaskKey m_push(refc<iRunnable> runnable);
+        bool     m_pop(u32 workerIndex, tTask& task);
+        void     m_run(tTask& task);
+        void     m_complete(u32 index);
+        void     m_waitFor(const u32* word, u32 value);
+
+        void     m_wakeWorkers();
+        void     m_wakeWaiters();
 
     private:
 
-        typedef std::pair< tTaskKey,refc<iRunnable> > tTask;
+        enum { kSlotsPerChunk = 4096 };
+        enum { kMaxChunks = 1024 };
 
         std::vector< refc<tThread> > m_threads;
+        std::vector<tWorkerQueue*>   m_queues;
+
+        u32                          m_nextQueue;
+        i32                          m_numQueued;
+        u32                          m_numSleepingWorkers;
+        u32                          m_numWaiters;
+        u32                          m_numHelpers;
+        u32                          m_stopping;
 
-        tPCQ<tTask>                  m_queue;
-        tTaskKey                     m_nextKey;
+        tSlot*                       m_chunks[kMaxChunks];
+        u32                          m_numSlots;
+        u64                          m_freeHead;
 
-        std::set<tTaskKey>           m_forgotten;
-        std::set<tTaskKey>           m_completed;
-        pthread_mutex_t              m_completedMutex;
+        pthread_mutex_t              m_mutex;
+        pthread_cond_t               m_workAvailable;
         pthread_cond_t               m_completedWasUpdated;
 
         friend class tWorker;
+        friend class tTaskGraph;
 };
 
 
@@ -4,7 +4,7 @@
 
 #include <rho/ppcheck.h>
 #include <rho/sync/iTimerObserver.h>
-#include <rho/sync/tThread.h>
+#include <rho/sync/tTimerService.h>
 #include <rho/eRho.h>
 #include <rho/bNonCopyable.h>
 #include <rho/types.h>
@@ -16,13 +16,19 @@ namespace sync
 {
 
 
+/**
+ * Calls an observer periodically and repeatedly.
+ *
+ * Timers don't have threads of their own; they all share the thread of
+ * a tTimerService (tTimerService::shared(), unless you pass one in).
+ */
 class tTimer : public bNonCopyable
 {
     public:
 
         /**
-         * Create a thread that will call the given observer periodically
-         * and repeatedly.
+         * Create a timer that will call the given observer periodically
+         * and repeatedly, on the shared timer service's thread.
          * This timer does not own the observer (i.e. you must destroy it
          * yourself).
          *
@@ -30,6 +36,11 @@ class tTimer : public bNonCopyable
          */
         tTimer(iTimerObserver* obs, u64 period);
 
+        /**
+         * Same as above, but runs on the given timer service.
+         */
+        tTimer(iTimerObserver* obs, u64 period, tTimerService& service);
+
         /**
          * Returns the timer's observer.
          */
@@ -41,7 +52,7 @@ class tTimer : public bNonCopyable
         u64 getPeriod() const;
 
         /**
-         * Stops the timer (i.e. thread) from calling the observer ever again!
+         * Stops the timer from calling the observer ever again!
          * It is safe to destroy the observer after this method returns.
          */
         void stop();
@@ -65,16 +76,17 @@ class tTimer : public bNonCopyable
 
     private:
 
-        refc<tThread> m_thread;
+        void m_init();
+
+    private:
+
+        tTimerService* m_service;
+        tTimerService::tTimerId m_id;
 
         iTimerObserver* m_obs;
         u64 m_period;
-        u64 m_nextCallTime;
 
         bool m_running;
-        bool m_stopped;
-
-        friend class tTimerThread;
 };
 
 
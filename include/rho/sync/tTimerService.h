@@ -0,0 +1,222 @@
+#ifndef __rho_sync_tTimerService_h__
+#define __rho_sync_tTimerService_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/sync/ebSync.h>
+#include <rho/sync/iTimerObserver.h>
+#include <rho/sync/tThread.h>
+#include <rho/eRho.h>
+#include <rho/bNonCopyable.h>
+#include <rho/types.h>
+
+#include <vector>
+
+
+namespace rho
+{
+namespace sync
+{
+
+
+class tTimerServiceThread;
+
+
+/**
+ * Runs any number of periodic timers on a single thread.
+ *
+ * The timers are kept in a hierarchical timing wheel: five levels of
+ * buckets (256 one-tick buckets, then four levels of 64 buckets, each
+ * level 64 times coarser than the last). Scheduling and cancelling a
+ * timer are O(1); a timer moves down a level at most four times before
+ * it fires. Between firings the service thread sleeps on a condition
+ * variable until the next non-empty bucket is due, and it doesn't wake
+ * up at all while there are no timers.
+ *
+ * Observers are called on the service thread, one at a time, so they
+ * should return quickly. timerAlert() is passed the timer's period and
+ * keeps being called every 'period' microseconds for as long as it
+ * returns true. timerThreadInit() is called just before a timer's first
+ * timerAlert(), and timerThreadEnd() after its last one (whether the
+ * observer returned false, threw, or the timer was cancelled), so both
+ * run on the service thread. An exception thrown from timerAlert() is
+ * reported and stops that timer.
+ *
+ * Timers never fire early. They fire late by at most about one tick,
+ * plus however long the observers ahead of them take.
+ */
+class tTimerService : public bNonCopyable
+{
+    public:
+
+        typedef u64 tTimerId;
+
+        /**
+         * Creates a timer service with a one millisecond tick.
+         */
+        tTimerService();
+
+        /**
+         * Creates a timer service whose tick is 'tickPeriod'
+         * micro-seconds (10^-6 seconds) long.
+         */
+        tTimerService(u64 tickPeriod);
+
+        /**
+         * Schedules the observer to be called every 'period' micro-seconds
+         * (10^-6 seconds), starting 'period' micro-seconds from now.
+         * The service does not own the observer.
+         *
+         * The returned id is valid until the timer is cancelled or its
+         * observer returns false.
+         */
+        tTimerId schedule(iTimerObserver* obs, u64 period);
+
+        /**
+         * Cancels the timer. When this returns, the observer is not being
+         * called and won't be called again, and if it was ever called, its
+         * timerThreadEnd() has been called on the service thread. (If you
+         * call cancel() from inside an observer, it just won't be called
+         * again; timerThreadEnd() follows once the current observer
+         * returns.)
+         *
+         * Returns false if the timer had already stopped (or the id is
+         * bogus), else true.
+         */
+        bool cancel(tTimerId id);
+
+        /**
+         * Returns true once the timer has stopped (it was cancelled or its
+         * observer returned false) and its observer is done being called,
+         * timerThreadEnd() included. (Also true for a bogus id.)
+         */
+        bool isStopped(tTimerId id) const;
+
+        /**
+         * Returns the tick length in micro-seconds (10^-6 seconds).
+         */
+        u64 getTickPeriod() const;
+
+        /**
+         * Returns the number of scheduled timers.
+         */
+        u32 size() const;
+
+        /**
+         * Stops the service thread. Timers that are still scheduled
+         * are dropped without their observers being told.
+         */
+        ~tTimerService();
+
+        /**
+         * Returns a process-wide service (with a one millisecond tick)
+         * which is created the first time it's needed and never destroyed.
+         * tTimer uses this one by default.
+         */
+        static tTimerService& shared();
+
+    private:
+
+        struct tLink
+        {
+            tLink* prev;
+            tLink* next;
+        };
+
+        struct tRecord : public tLink
+        {
+            tLink*          list;
+            iTimerObserver* obs;
+            u64             period;
+            u64             due;
+            u64             expiresTick;
+            u32             index;
+            u32             generation;
+            bool            initCalled;
+            bool            cancelled;
+        };
+
+        void     m_init(u64 tickPeriod);
+        void     m_run();
+
+        tRecord* m_lookup(tTimerId id) const;
+        tRecord* m_allocRecord();
+        void     m_freeRecord(tRecord* rec);
+
+        u64      m_now() const;
+        u64      m_tickOf(u64 time) const;
+        u64      m_tickFor(u64 due) const;
+
+        void     m_insert(tRecord* rec);
+        void     m_unlink(tRecord* rec);
+        void     m_cascade(u32 level);
+        void     m_advance();
+        void     m_fireExpiring();
+        void     m_end(tRecord* rec);
+        void     m_endCancelled();
+        bool     m_nextWakeTick(u64& tick) const;
+
+        void     m_lock() const;
+        void     m_unlock() const;
+
+        class tAutoLock
+        {
+            public:
+                tAutoLock(const tTimerService* s) : m_s(s) { m_s->m_lock(); }
+                ~tAutoLock() { m_s->m_unlock(); }
+            private:
+                const tTimerService* m_s;
+        };
+
+        class tAutoUnlock
+        {
+            public:
+                tAutoUnlock(const tTimerService* s) : m_s(s) { m_s->m_unlock(); }
+                ~tAutoUnlock() { m_s->m_lock(); }
+            private:
+                const tTimerService* m_s;
+        };
+
+    private:
+
+        enum { kLevel0Bits = 8 };
+        enum { kLevel0Size = (1 << kLevel0Bits) };
+        enum { kLevelBits = 6 };
+        enum { kLevelSize = (1 << kLevelBits) };
+        enum { kNumUpperLevels = 4 };
+
+        u64                   m_tickPeriod;
+        u64                   m_baseTime;
+        u64                   m_curTick;
+
+        tLink                 m_level0[kLevel0Size];
+        u64                   m_level0Bits[kLevel0Size / 64];
+        tLink                 m_levels[kNumUpperLevels][kLevelSize];
+        tLink                 m_expiring;
+        tLink                 m_ending;
+
+        std::vector<tRecord*> m_records;
+        std::vector<u32>      m_freeRecords;
+        u32                   m_numScheduled;
+
+        tRecord*              m_running;
+        pthread_t             m_serviceThreadId;
+        bool                  m_stopping;
+        bool                  m_sleeping;
+        u64                   m_sleepUntilTick;
+
+        refc<tThread>         m_thread;
+
+        mutable pthread_mutex_t m_mutex;
+        pthread_cond_t        m_wakeService;
+        pthread_cond_t        m_callbackDone;
+
+        friend class tTimerServiceThread;
+};
+
+
+}  // namespace sync
+}  // namespace rho
+
+
+#endif  // __rho_sync_tTimerService_h__
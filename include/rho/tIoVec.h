@@ -0,0 +1,89 @@
+#ifndef __rho_tIoVec_h__
+#define __rho_tIoVec_h__
+
+
+#include <rho/ppcheck.h>
+#include <rho/eRho.h>
+#include <rho/types.h>
+
+#include <cstddef>
+#include <vector>
+
+
+namespace rho
+{
+
+
+/**
+ * One buffer of a scatter read (see iReadable::readv()).
+ */
+struct tIoVec
+{
+    u8* base;
+    i32 length;
+};
+
+
+/**
+ * One buffer of a gather write (see iWritable::writev()).
+ */
+struct tConstIoVec
+{
+    const u8* base;
+    i32 length;
+};
+
+
+/**
+ * Returns the total length of the 'count' buffers in 'bufs'.
+ *
+ * Throws eInvalidArgument unless the total is positive and fits in
+ * an i32 (the same rule the single-buffer stream methods have).
+ * Individual buffers may be empty.
+ */
+template <class T>
+i32 ioVecLength(const T* bufs, i32 count)
+{
+    if (bufs == NULL || count <= 0)
+        throw eInvalidArgument("Stream read/write buffer count must be >0");
+    i64 total = 0;
+    for (i32 i = 0; i < count; i++)
+    {
+        if (bufs[i].length < 0)
+            throw eInvalidArgument("Stream read/write length must be >=0 for each buffer");
+        total += bufs[i].length;
+        if (total > 0x7FFFFFFF)
+            throw eInvalidArgument("Stream read/write total length must fit in an i32");
+    }
+    if (total == 0)
+        throw eInvalidArgument("Stream read/write length must be >0");
+    return (i32)total;
+}
+
+
+/**
+ * Consumes 'n' bytes from the front of bufs[first..], moving 'first'
+ * past the buffers which are used up and trimming the one that's
+ * partly used.
+ */
+template <class T>
+void ioVecAdvance(std::vector<T>& bufs, size_t& first, i32 n)
+{
+    while (n > 0 && first < bufs.size())
+    {
+        if (n < bufs[first].length)
+        {
+            bufs[first].base += n;
+            bufs[first].length -= n;
+            return;
+        }
+        n -= bufs[first].length;
+        first++;
+    }
+}
+
+
+}     // namespace rho
+
+
+#endif    // __rho_tIoVec_h__
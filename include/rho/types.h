@@ -47,6 +47,35 @@ std::string platformVersionString();
 int getMachineBitness();
 
 
+/**
+ * The x86 vector instruction sets which the optimized code paths are
+ * written for. Each level includes the ones below it.
+ *
+ * Code with such paths picks the best one getSimdLevel() allows, and
+ * usually also has an overload taking a 'maxLevel' to cap it at. Every
+ * level gives exactly the same results; the caps are there for testing
+ * and benchmarking the levels against each other.
+ */
+enum nSimdLevel
+{
+    kSimdNone       = 0,      // plain C++ only
+    kSimdSSE2       = 1,
+    kSimdSSSE3      = 2,
+    kSimdAVX2       = 3,
+
+    kMaxSimdLevel   = 4
+};
+
+
+/**
+ * Returns the best level which both this cpu and the OS support.
+ * (Always kSimdNone on non-x86 machines.)
+ */
+nSimdLevel getSimdLevel();
+
+std::string simdLevelEnumToString(nSimdLevel level);
+
+
 }  // namespace rho
 
 
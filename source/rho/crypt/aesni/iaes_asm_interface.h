@@ -80,5 +80,18 @@ void iDec256_CBC(sAesData *data);
 void iEnc192_CBC(sAesData *data);
 void iDec192_CBC(sAesData *data);
 
+// CTR mode: 'iv' is the counter block, whose last 4 bytes are a big-endian
+// counter; it is left holding the counter of the next block.
+// (Decryption is the same operation, with the encryption key schedule.)
+void iEnc128_CTR(sAesData *data);
+void iEnc256_CTR(sAesData *data);
+void iEnc192_CTR(sAesData *data);
+
+// GHASH, for GCM mode (these need PCLMULQDQ; see check_for_pclmul_instructions()).
+// iGhashExpandKey() turns the hash key H into the 64 bytes (16-byte aligned)
+// that iGhash() wants; iGhash() folds 'num_blocks' blocks into the hash 'x'.
+void iGhashExpandKey(const UCHAR *h, UCHAR *hash_key);
+void iGhash(const UCHAR *hash_key, UCHAR *x, const UCHAR *in, size_t num_blocks);
+
 
 #endif
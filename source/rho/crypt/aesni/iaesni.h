@@ -51,5 +51,8 @@
 // Executing one the AES instructions without processor support will cause UD fault.
 bool check_for_aes_instructions();
 
+// Test if the processor supports the carry-less multiply (PCLMULQDQ) instruction.
+bool check_for_pclmul_instructions();
+
 
 #endif
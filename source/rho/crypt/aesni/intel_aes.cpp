@@ -37,6 +37,7 @@
 
 
 #define AES_INSTRCTIONS_CPUID_BIT (1<<25)
+#define PCLMUL_INSTRCTIONS_CPUID_BIT (1<<1)
 
 
 #if IS_x86_FAM
@@ -89,3 +90,22 @@ bool check_for_aes_instructions()
 
     return false;
 }
+
+
+/*
+ * check_for_pclmul_instructions()
+ *   return true if support PCLMULQDQ and false if don't support PCLMULQDQ
+ */
+bool check_for_pclmul_instructions()
+{
+#if IS_x86_FAM
+    unsigned int cpuid_results[4];
+
+    __cpuid(cpuid_results,1);
+
+    if (cpuid_results[2] & PCLMUL_INSTRCTIONS_CPUID_BIT)
+        return true;
+#endif
+
+    return false;
+}
@@ -0,0 +1,22 @@
+/*
+ * Shared by tWritableAES and tReadableAES. This file must be included
+ * inside the rho::crypt namespace.
+ */
+
+
+/*
+ * In CTR and GCM modes each chunk gets a nonce of its own: the stream's
+ * nonce with the sequence number of the chunk XORed into its last 8 bytes.
+ * (The key stream must never repeat, so no two chunks may share one.)
+ */
+static
+void s_chunkNonce(const u8 streamNonce[12], u64 seq, u8 nonce[12])
+{
+    for (int i = 0; i < 4; i++)
+        nonce[i] = streamNonce[i];
+    for (int i = 11; i >= 4; i--)
+    {
+        nonce[i] = (u8)(streamNonce[i] ^ (seq & 0xFF));
+        seq >>= 8;
+    }
+}
@@ -0,0 +1,287 @@
+/*
+ * CTR and GCM modes, shared by tEncAES and tDecAES. (Both directions of
+ * these modes only ever run the cipher forwards, so a tDecAES in one of
+ * these modes holds the encryption key schedule, same as a tEncAES.)
+ *
+ * This file must be included inside the rho::crypt namespace, after
+ * "aesni/iaes_asm_interface.h" and "rijndael-alg-fst.h".
+ */
+
+
+// GCM hashes (and encrypts) this much at a time, so that the bytes it has
+// just encrypted are still in the cache when it hashes them.
+static const u32 kGcmPieceSize = 4096;
+
+// The GHASH key is H, H^2, H^3 and H^4 for iGhash(), or s_gfmul()'s table.
+static const size_t kHashKeySize = 256;
+
+
+static
+void s_incCounter(u8 counter[AES_BLOCK_SIZE])
+{
+    for (int i = AES_BLOCK_SIZE-1; i >= AES_BLOCK_SIZE-4; i--)
+        if (++counter[i] != 0)
+            break;
+}
+
+
+/*
+ * XORs 'numbytes' bytes of AES-CTR key stream into 'out'. The last four
+ * bytes of 'counter' are a big-endian block counter; 'counter' is left
+ * holding the counter of the block after the last one used. (When
+ * 'numbytes' isn't a multiple of 16, the rest of the last block's key
+ * stream is thrown away.)
+ */
+static
+void s_ctr(bool useASM, nKeyLengthAES keylen, u8* expandedKey, const u32* rk, int Nr,
+           const u8* in, u8* out, size_t numbytes, u8 counter[AES_BLOCK_SIZE])
+{
+    size_t numblocks = numbytes / AES_BLOCK_SIZE;
+    u32 extra = (u32)(numbytes % AES_BLOCK_SIZE);
+
+    // Fast ASM impl:
+    if (useASM)
+    {
+        sAesData data;
+        data.in_block = const_cast<u8*>(in);
+        data.out_block = out;
+        data.expanded_key = expandedKey;
+        data.iv = counter;
+        data.num_blocks = numblocks;
+        if (numblocks > 0)
+        {
+            switch (keylen)
+            {
+                case k128bit: iEnc128_CTR(&data); break;
+                case k192bit: iEnc192_CTR(&data); break;
+                case k256bit: iEnc256_CTR(&data); break;
+                default: throw eInvalidArgument("The keylen parameter is not valid!");
+            }
+        }
+        if (extra > 0)
+        {
+            u8 block[AES_BLOCK_SIZE] = { 0 };
+            memcpy(block, in+numblocks*AES_BLOCK_SIZE, extra);
+            data.in_block = block;
+            data.out_block = block;
+            data.num_blocks = 1;
+            switch (keylen)
+            {
+                case k128bit: iEnc128_CTR(&data); break;
+                case k192bit: iEnc192_CTR(&data); break;
+                case k256bit: iEnc256_CTR(&data); break;
+                default: throw eInvalidArgument("The keylen parameter is not valid!");
+            }
+            memcpy(out+numblocks*AES_BLOCK_SIZE, block, extra);
+        }
+    }
+
+    // Fallback impl:
+    else
+    {
+        u8 keystream[AES_BLOCK_SIZE];
+        for (size_t i = 0; i < numbytes; i += AES_BLOCK_SIZE)
+        {
+            rijndaelEncrypt(rk, Nr, counter, keystream);
+            s_incCounter(counter);
+            size_t n = (numbytes - i < AES_BLOCK_SIZE) ? (numbytes - i) : AES_BLOCK_SIZE;
+            for (size_t j = 0; j < n; j++)
+                out[i+j] = (u8)(in[i+j] ^ keystream[j]);
+        }
+    }
+}
+
+
+/*
+ * The fallback GHASH multiplies four bits at a time (Shoup's method, as in
+ * most portable GCM code): 'table' holds H times each 4-bit value, as
+ * pairs of big-endian halves, and s_last4 folds the four bits shifted off
+ * the end back in.
+ */
+static const u64 s_last4[16] =
+{
+    0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+    0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+static
+void s_gfmulTableInit(const u8 H[AES_BLOCK_SIZE], u64 table[32])
+{
+    u64* hh = table;
+    u64* hl = table + 16;
+
+    u64 vh = 0, vl = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        vh = (vh << 8) | H[i];
+        vl = (vl << 8) | H[i+8];
+    }
+
+    hh[0] = 0; hl[0] = 0;
+    hh[8] = vh; hl[8] = vl;
+    for (int i = 4; i > 0; i >>= 1)
+    {
+        u64 lsb = vl & 1;
+        vl = (vh << 63) | (vl >> 1);
+        vh = (vh >> 1) ^ (lsb ? 0xE100000000000000ULL : 0);
+        hh[i] = vh; hl[i] = vl;
+    }
+    for (int i = 2; i <= 8; i *= 2)
+    {
+        for (int j = 1; j < i; j++)
+        {
+            hh[i+j] = hh[i] ^ hh[j];
+            hl[i+j] = hl[i] ^ hl[j];
+        }
+    }
+}
+
+/*
+ * X = X * H in GF(2^128).
+ */
+static
+void s_gfmul(u8 X[AES_BLOCK_SIZE], const u64 table[32])
+{
+    const u64* hh = table;
+    const u64* hl = table + 16;
+
+    u32 lo = X[15] & 0xF;
+    u64 zh = hh[lo], zl = hl[lo];
+    for (int i = 15; i >= 0; i--)
+    {
+        lo = X[i] & 0xF;
+        u32 hi = (X[i] >> 4) & 0xF;
+        u32 rem;
+        if (i != 15)
+        {
+            rem = (u32)(zl & 0xF);
+            zl = (zh << 60) | (zl >> 4);
+            zh = (zh >> 4) ^ (s_last4[rem] << 48);
+            zh ^= hh[lo];
+            zl ^= hl[lo];
+        }
+        rem = (u32)(zl & 0xF);
+        zl = (zh << 60) | (zl >> 4);
+        zh = (zh >> 4) ^ (s_last4[rem] << 48);
+        zh ^= hh[hi];
+        zl ^= hl[hi];
+    }
+    for (int i = 7; i >= 0; i--)
+    {
+        X[i]   = (u8)(zh & 0xFF); zh >>= 8;
+        X[i+8] = (u8)(zl & 0xFF); zl >>= 8;
+    }
+}
+
+
+/*
+ * Folds 'numbytes' bytes into the GHASH value X, zero-padding the last
+ * block if 'numbytes' isn't a multiple of 16.
+ */
+static
+void s_ghash(bool usePCLMUL, const u8* hashKey, u8 X[AES_BLOCK_SIZE],
+             const u8* buf, u32 numbytes)
+{
+    u32 numblocks = numbytes / AES_BLOCK_SIZE;
+    u32 extra = numbytes % AES_BLOCK_SIZE;
+
+    u8 last[AES_BLOCK_SIZE] = { 0 };
+    if (extra > 0)
+        memcpy(last, buf+numblocks*AES_BLOCK_SIZE, extra);
+
+    if (usePCLMUL)
+    {
+        if (numblocks > 0)
+            iGhash(hashKey, X, buf, numblocks);
+        if (extra > 0)
+            iGhash(hashKey, X, last, 1);
+    }
+    else
+    {
+        for (u32 i = 0; i < numblocks; i++)
+        {
+            for (u32 j = 0; j < AES_BLOCK_SIZE; j++)
+                X[j] ^= buf[i*AES_BLOCK_SIZE+j];
+            s_gfmul(X, (const u64*)hashKey);
+        }
+        if (extra > 0)
+        {
+            for (u32 j = 0; j < AES_BLOCK_SIZE; j++)
+                X[j] ^= last[j];
+            s_gfmul(X, (const u64*)hashKey);
+        }
+    }
+}
+
+
+/*
+ * Makes the GHASH key (H = E(K, 0^128)) in the form s_ghash() wants it.
+ * 'hashKey' must be kHashKeySize bytes, 16-byte aligned.
+ */
+static
+void s_ghashInit(bool useASM, bool usePCLMUL, nKeyLengthAES keylen, u8* expandedKey,
+                 const u32* rk, int Nr, u8* hashKey)
+{
+    u8 zeros[AES_BLOCK_SIZE] = { 0 };
+    u8 counter[AES_BLOCK_SIZE] = { 0 };
+    u8 H[AES_BLOCK_SIZE];
+    s_ctr(useASM, keylen, expandedKey, rk, Nr, zeros, H, AES_BLOCK_SIZE, counter);
+    if (usePCLMUL)
+        iGhashExpandKey(H, hashKey);
+    else
+        s_gfmulTableInit(H, (u64*)hashKey);
+}
+
+
+/*
+ * GCM with a 96-bit nonce (NIST SP 800-38D): encrypts (or decrypts)
+ * 'numbytes' bytes from 'in' to 'out' (which may be the same buffer), and
+ * computes the tag over 'aad' and the cypher text.
+ */
+static
+void s_gcm(bool encrypting, bool useASM, bool usePCLMUL, nKeyLengthAES keylen,
+           u8* expandedKey, const u32* rk, int Nr, const u8* hashKey,
+           const u8* in, u8* out, u32 numbytes,
+           const u8 nonce[12], const u8* aad, u32 aadlen, u8 tag[AES_BLOCK_SIZE])
+{
+    // J0 is the nonce followed by a 32-bit 1; the data's key stream starts
+    // at J0+1, and E(K, J0) masks the tag.
+    u8 j0[AES_BLOCK_SIZE];
+    memcpy(j0, nonce, 12);
+    j0[12] = 0; j0[13] = 0; j0[14] = 0; j0[15] = 1;
+    u8 counter[AES_BLOCK_SIZE];
+    memcpy(counter, j0, AES_BLOCK_SIZE);
+    s_incCounter(counter);
+
+    u8 X[AES_BLOCK_SIZE] = { 0 };
+    if (aadlen > 0)
+        s_ghash(usePCLMUL, hashKey, X, aad, aadlen);
+
+    for (u32 i = 0, n = 0; i < numbytes; i += n)
+    {
+        n = (numbytes - i < kGcmPieceSize) ? (numbytes - i) : kGcmPieceSize;
+        if (encrypting)
+        {
+            s_ctr(useASM, keylen, expandedKey, rk, Nr, in+i, out+i, n, counter);
+            s_ghash(usePCLMUL, hashKey, X, out+i, n);
+        }
+        else
+        {
+            s_ghash(usePCLMUL, hashKey, X, in+i, n);
+            s_ctr(useASM, keylen, expandedKey, rk, Nr, in+i, out+i, n, counter);
+        }
+    }
+
+    // The lengths (in bits) of the aad and the cypher text.
+    u8 lengths[AES_BLOCK_SIZE];
+    u64 aadbits = ((u64)aadlen) * 8;
+    u64 ctbits = ((u64)numbytes) * 8;
+    for (int i = 7; i >= 0; i--)
+    {
+        lengths[i]   = (u8)(aadbits & 0xFF); aadbits >>= 8;
+        lengths[i+8] = (u8)(ctbits & 0xFF);  ctbits >>= 8;
+    }
+    s_ghash(usePCLMUL, hashKey, X, lengths, AES_BLOCK_SIZE);
+
+    s_ctr(useASM, keylen, expandedKey, rk, Nr, X, tag, AES_BLOCK_SIZE, j0);
+}
@@ -6,8 +6,18 @@
 #include <rho/crypt/tSHA384.h>
 #include <rho/crypt/tSHA512.h>
 #include <rho/crypt/tWhirlpool.h>
-
-#include <cassert>
+#include <rho/crypt/tHmac.h>
+#include <rho/eRho.h>
+#include <rho/sync/parallel_util.h>
+#include <rho/sync/tAutoSync.h>
+#include <rho/sync/tMutex.h>
+#include <rho/sync/tThreadPool.h>
+
+#include "sha.h"
+#include "sha_x86.h"
+
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 #include <iomanip>
 
@@ -30,101 +40,113 @@ string hashToString(const vector<u8>& hash)
 }
 
 
-template <class Hasher, size_t blocksize>
-vector<u8> hmac(vector<u8> key, const vector<u8>& message)
+template <class Hasher>
+vector<u8> hmac(const vector<u8>& key, const vector<u8>& message)
 {
-    assert(blocksize > 0);
-
-    // If the key is too long, shorten it.
-    if (key.size() > blocksize)
-    {
-        Hasher h;
-        h.write(&key[0], (i32)key.size());
-        key = h.getHash();
-        assert(key.size() <= blocksize);
-    }
-
-    // If the key is (now) too short, pad it on the right with zeros.
-    while (key.size() < blocksize)
-        key.push_back(0x00);
-
-    // Create the outer padding vector.
-    vector<u8> o_key_pad(blocksize, 0x5c);
-    for (size_t i = 0; i < blocksize; i++)
-        o_key_pad[i] = (u8)(o_key_pad[i] ^ key[i]);
-
-    // Create the inner padding vector.
-    vector<u8> i_key_pad(blocksize, 0x36);
-    for (size_t i = 0; i < blocksize; i++)
-        i_key_pad[i] = (u8)(i_key_pad[i] ^ key[i]);
-
-    // Compute the inner hash part.
-    Hasher h1;
-    h1.write(&i_key_pad[0], (i32)i_key_pad.size());
+    tHmac<Hasher> h(key);
     if (message.size() > 0)
-        h1.write(&message[0], (i32)message.size());
-    vector<u8> res1 = h1.getHash();
-    assert(res1.size() > 0);
-
-    // Compute the outer hash part.
-    Hasher h2;
-    h2.write(&o_key_pad[0], (i32)o_key_pad.size());
-    h2.write(&res1[0], (i32)res1.size());
-    return h2.getHash();
+        h.write(&message[0], (i32)message.size());
+    return h.getHash();
 }
 
 
 vector<u8> hmac_md5(const vector<u8>& key, const vector<u8>& message)
 {
-    return hmac<crypt::tMD5, 64>(key, message);
+    return hmac<crypt::tMD5>(key, message);
 }
 
 
 vector<u8> hmac_sha1(const vector<u8>& key, const vector<u8>& message)
 {
-    return hmac<crypt::tSHA1, 64>(key, message);
+    return hmac<crypt::tSHA1>(key, message);
 }
 
 
 vector<u8> hmac_sha224(const vector<u8>& key, const vector<u8>& message)
 {
-    return hmac<crypt::tSHA224, 64>(key, message);
+    return hmac<crypt::tSHA224>(key, message);
 }
 
 
 vector<u8> hmac_sha256(const vector<u8>& key, const vector<u8>& message)
 {
-    return hmac<crypt::tSHA256, 64>(key, message);
+    return hmac<crypt::tSHA256>(key, message);
 }
 
 
 vector<u8> hmac_sha384(const vector<u8>& key, const vector<u8>& message)
 {
-    return hmac<crypt::tSHA384, 128>(key, message);
+    return hmac<crypt::tSHA384>(key, message);
 }
 
 
 vector<u8> hmac_sha512(const vector<u8>& key, const vector<u8>& message)
 {
-    return hmac<crypt::tSHA512, 128>(key, message);
+    return hmac<crypt::tSHA512>(key, message);
 }
 
 
 vector<u8> hmac_whirlpool(const vector<u8>& key, const vector<u8>& message)
 {
-    return hmac<crypt::tWhirlpool, 64>(key, message);
+    return hmac<crypt::tWhirlpool>(key, message);
 }
 
 
-static
-vector<u8> pbkdf2_T(hmac_func prf,
-                    const vector<u8>& password, const vector<u8>& salt,
-                    u32 c, u32 i)
+/*
+ * Computes the i'th block of PBKDF2's output (1-based) into 'out', or the
+ * first 'outlen' bytes of it. The keyed HMAC state is made once, and the
+ * iterations don't allocate.
+ */
+template <class Hasher>
+void pbkdf2_T(const vector<u8>& password, const vector<u8>& salt,
+              u32 c, u32 i, u8* out, u32 outlen)
 {
-    assert(prf != NULL);
-    assert(c > 0);
-    assert(i > 0);
+    if (outlen > Hasher::kHashSize)
+        throw eLogicError("pbkdf2: asked for more than one hash of output from one block");
+
+    u8 index[4];
+    index[0] = (u8)((i >> 24) & 0xFF);
+    index[1] = (u8)((i >> 16) & 0xFF);
+    index[2] = (u8)((i >>  8) & 0xFF);
+    index[3] = (u8)((i      ) & 0xFF);
+
+    tHmac<Hasher> prf(password);
+    u8 u[Hasher::kHashSize];
+    u8 res[Hasher::kHashSize];
+
+    if (salt.size() > 0)
+        prf.write(&salt[0], (i32)salt.size());
+    prf.write(index, 4);
+    prf.getHash(u);
+    c--;
 
+    memcpy(res, u, Hasher::kHashSize);
+
+    while (c > 0)
+    {
+        prf.reset();
+        prf.write(u, (i32)Hasher::kHashSize);
+        prf.getHash(u);
+        c--;
+
+        for (u32 j = 0; j < Hasher::kHashSize; j++)
+            res[j] = (u8)(res[j] ^ u[j]);
+    }
+
+    memcpy(out, res, outlen);
+}
+
+
+/*
+ * The same, for a prf which isn't one of the hmac_<hasher> functions: it
+ * is just called 'c' times. Returns the whole block, which is as long as
+ * the prf's hashes.
+ */
+static
+vector<u8> s_prfBlock(hmac_func prf,
+                      const vector<u8>& password, const vector<u8>& salt,
+                      u32 c, u32 i)
+{
     vector<u8> u = salt;
     u.push_back((u8)((i >> 24) & 0xFF));
     u.push_back((u8)((i >> 16) & 0xFF));
@@ -135,14 +157,16 @@ vector<u8> pbkdf2_T(hmac_func prf,
     c--;
 
     vector<u8> res = u;
-    assert(res.size() > 0);
+    if (res.size() == 0)
+        throw eInvalidArgument("pbkdf2: the prf returned an empty hash");
 
     while (c > 0)
     {
         u = prf(password, u);
         c--;
 
-        assert(res.size() == u.size());
+        if (u.size() != res.size())
+            throw eInvalidArgument("pbkdf2: the prf must always return hashes of the same length");
         for (size_t j = 0; j < res.size(); j++)
             res[j] = (u8)(res[j] ^ u[j]);
     }
@@ -151,9 +175,142 @@ vector<u8> pbkdf2_T(hmac_func prf,
 }
 
 
-vector<u8> pbkdf2(hmac_func prf,
-                  const vector<u8>& password, const vector<u8>& salt,
-                  u32 c, u32 dklen)
+/*
+ * The hash length of 'prf', if it's one of the hmac_<hasher> functions
+ * above, else 0.
+ */
+static
+u32 s_hashSize(hmac_func prf)
+{
+    if (prf == hmac_md5)       return tMD5::kHashSize;
+    if (prf == hmac_sha1)      return tSHA1::kHashSize;
+    if (prf == hmac_sha224)    return tSHA224::kHashSize;
+    if (prf == hmac_sha256)    return tSHA256::kHashSize;
+    if (prf == hmac_sha384)    return tSHA384::kHashSize;
+    if (prf == hmac_sha512)    return tSHA512::kHashSize;
+    if (prf == hmac_whirlpool) return tWhirlpool::kHashSize;
+    return 0;
+}
+
+
+/*
+ * Computes the i'th block of PBKDF2's output into 'out', or the first
+ * 'outlen' bytes of it, for any prf.
+ */
+static
+void s_pbkdf2Block(hmac_func prf,
+                   const vector<u8>& password, const vector<u8>& salt,
+                   u32 c, u32 i, u8* out, u32 outlen)
+{
+    if (prf == hmac_md5)       { pbkdf2_T<tMD5>(password, salt, c, i, out, outlen); return; }
+    if (prf == hmac_sha1)      { pbkdf2_T<tSHA1>(password, salt, c, i, out, outlen); return; }
+    if (prf == hmac_sha224)    { pbkdf2_T<tSHA224>(password, salt, c, i, out, outlen); return; }
+    if (prf == hmac_sha256)    { pbkdf2_T<tSHA256>(password, salt, c, i, out, outlen); return; }
+    if (prf == hmac_sha384)    { pbkdf2_T<tSHA384>(password, salt, c, i, out, outlen); return; }
+    if (prf == hmac_sha512)    { pbkdf2_T<tSHA512>(password, salt, c, i, out, outlen); return; }
+    if (prf == hmac_whirlpool) { pbkdf2_T<tWhirlpool>(password, salt, c, i, out, outlen); return; }
+
+    vector<u8> res = s_prfBlock(prf, password, salt, c, i);
+    if (res.size() < outlen)
+        throw eInvalidArgument("pbkdf2: the prf must always return hashes of the same length");
+    memcpy(out, &res[0], outlen);
+}
+
+
+/*
+ * Computes blocks [begin, end) (0-based) of PBKDF2's output, for
+ * sync::parallelFor(). The blocks don't depend on each other.
+ *
+ * A prf of the caller's might throw (or return hashes of the wrong
+ * length), and the pool would swallow that on its own threads, so the
+ * first such error is kept for pbkdf2() to throw.
+ */
+class tPbkdf2Blocks
+{
+    public:
+
+        tPbkdf2Blocks(hmac_func prf,
+                      const vector<u8>& password, const vector<u8>& salt,
+                      u32 c, u32 hlen, vector<u8>& res)
+            : m_prf(prf),
+              m_password(password),
+              m_salt(salt),
+              m_c(c),
+              m_hlen(hlen),
+              m_res(res),
+              m_failed(false),
+              m_invalidArg(false)
+        {
+        }
+
+        void operator() (u32 begin, u32 end)
+        {
+            u32 dklen = (u32)m_res.size();
+            for (u32 b = begin; b < end; b++)
+            {
+                u32 offset = b * m_hlen;
+                u32 outlen = std::min(m_hlen, dklen - offset);
+                try
+                {
+                    s_pbkdf2Block(m_prf, m_password, m_salt, m_c, b+1, &m_res[offset], outlen);
+                }
+                catch (eInvalidArgument& e)
+                {
+                    m_fail(e.what(), true);
+                    return;
+                }
+                catch (std::exception& e)
+                {
+                    m_fail(e.what(), false);
+                    return;
+                }
+            }
+        }
+
+        void throwIfFailed()
+        {
+            sync::tAutoSync as(m_mutex);
+            if (!m_failed)
+                return;
+            if (m_invalidArg)
+                throw eInvalidArgument(m_error);
+            throw eRuntimeError("pbkdf2: the prf threw: " + m_error);
+        }
+
+    private:
+
+        void m_fail(const std::string& error, bool invalidArg)
+        {
+            sync::tAutoSync as(m_mutex);
+            if (m_failed)
+                return;
+            m_failed = true;
+            m_invalidArg = invalidArg;
+            m_error = error;
+        }
+
+        hmac_func         m_prf;
+        const vector<u8>& m_password;
+        const vector<u8>& m_salt;
+        u32               m_c;
+        u32               m_hlen;
+        vector<u8>&       m_res;
+
+        sync::tMutex      m_mutex;
+        bool              m_failed;
+        bool              m_invalidArg;
+        std::string       m_error;
+};
+
+
+/*
+ * Both pbkdf2()s: the blocks run on 'pool', or on this thread when it's
+ * NULL.
+ */
+static
+vector<u8> s_pbkdf2(hmac_func prf,
+                    const vector<u8>& password, const vector<u8>& salt,
+                    u32 c, u32 dklen, sync::tThreadPool* pool)
 {
     if (prf == NULL)
         throw eInvalidArgument("prf may not be null");
@@ -162,21 +319,355 @@ vector<u8> pbkdf2(hmac_func prf,
     if (dklen == 0)
         throw eInvalidArgument("dklen must be greater than zero");
 
-    vector<u8> res;
-    u32 len = 0;
-    u32 i = 1;
-    while (len < dklen)
+    vector<u8> res(dklen, 0);
+    u32 done = 0;
+
+    // Any other prf's hash length is only known once it has hashed
+    // something, so its first block is done here.
+    u32 hlen = s_hashSize(prf);
+    if (hlen == 0)
     {
-        vector<u8> Ti = pbkdf2_T(prf, password, salt, c, i);
-        assert(Ti.size() > 0);
-        u32 lenHere = std::min((u32)Ti.size(), dklen-len);
-        res.insert(res.end(), Ti.begin(), Ti.begin()+lenHere);
-        len += lenHere;
-        i++;
+        vector<u8> first = s_prfBlock(prf, password, salt, c, 1);
+        hlen = (u32)first.size();
+        memcpy(&res[0], &first[0], std::min(hlen, dklen));
+        done = 1;
     }
+    u32 numBlocks = (dklen + hlen - 1) / hlen;
+
+    tPbkdf2Blocks blocks(prf, password, salt, c, hlen, res);
+    if (pool)
+        sync::parallelFor(*pool, done, numBlocks, 1, blocks);
+    else
+        blocks(done, numBlocks);
+    blocks.throwIfFailed();
     return res;
 }
 
 
+vector<u8> pbkdf2(hmac_func prf,
+                  const vector<u8>& password, const vector<u8>& salt,
+                  u32 c, u32 dklen)
+{
+    return s_pbkdf2(prf, password, salt, c, dklen, NULL);
+}
+
+
+vector<u8> pbkdf2(hmac_func prf,
+                  const vector<u8>& password, const vector<u8>& salt,
+                  u32 c, u32 dklen, sync::tThreadPool& pool)
+{
+    return s_pbkdf2(prf, password, salt, c, dklen, &pool);
+}
+
+
+/*
+ * What the batch functions need to know about SHA-1 or SHA-256. Both use
+ * 64-byte blocks and the same padding; they differ in the compression
+ * function and the size of the state.
+ *
+ * SHA-1's rounds are cheap enough that eight AVX2 lanes outrun the SHA
+ * extensions; SHA-256's aren't (see examples/rho/crypt/shaBenchmark.cpp).
+ */
+struct sShaAlgo
+{
+    u32 numWords;           // chaining words in the state
+    u32 hashSize;           // bytes
+    const u32* iv;
+    void (*compress_c)(u32* state, const u8* data, size_t num);
+    void (*compress_shani)(u32* state, const u8* data, size_t num);
+    void (*compress_x8)(u32 (*state)[8], const u8* const data[8], size_t num);
+    bool lanesBeatShaNi;    // whether AVX2 x8 is faster than the SHA extensions
+};
+
+static const u32 kSha1IV[5] =
+{
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+static const u32 kSha256IV[8] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static const sShaAlgo kSha1 =
+{
+    5, 20, kSha1IV, sha1_compress_c, sha1_compress_shani, sha1_compress_x8_avx2, true
+};
+
+static const sShaAlgo kSha256 =
+{
+    8, 32, kSha256IV, sha256_compress_c, sha256_compress_shani, sha256_compress_x8_avx2, false
+};
+
+
+/*
+ * Pads the last (partial) block of a 'len' byte message into 'tail', and
+ * returns how many blocks of 'tail' (one or two) to hash.
+ */
+static
+u32 s_shaPadTail(const u8* message, u32 len, u8 tail[128])
+{
+    u32 extra = len % 64;
+    u32 numBlocks = (extra < 56) ? 1 : 2;
+    memset(tail, 0, 128);
+    if (extra > 0)
+        memcpy(tail, message + (len - extra), extra);
+    tail[extra] = 0x80;
+    u64 bits = ((u64)len) * 8;
+    for (u32 i = 0; i < 8; i++)
+        tail[numBlocks*64 - 1 - i] = (u8)((bits >> (8*i)) & 0xFF);
+    return numBlocks;
+}
+
+static
+void s_shaWriteHash(const u32* state, u32 hashSize, u8* hash)
+{
+    for (u32 i = 0; i < hashSize; i++)
+        hash[i] = (u8)((state[i/4] >> (24 - 8*(i%4))) & 0xFF);
+}
+
+
+/*
+ * One message at a time.
+ */
+static
+void s_shaBatch1(const sShaAlgo& algo, bool useShaNi,
+                 const u8* const messages[], const u32 lengths[], u32 count, u8* hashes)
+{
+    void (*compress)(u32*, const u8*, size_t) = useShaNi ? algo.compress_shani : algo.compress_c;
+
+    u32 state[8];
+    u8 tail[128];
+    for (u32 m = 0; m < count; m++)
+    {
+        memcpy(state, algo.iv, algo.numWords * sizeof(u32));
+        u32 numFull = lengths[m] / 64;
+        if (numFull > 0)
+            compress(state, messages[m], numFull);
+        compress(state, tail, s_shaPadTail(messages[m], lengths[m], tail));
+        s_shaWriteHash(state, algo.hashSize, hashes + m*algo.hashSize);
+    }
+}
+
+
+/*
+ * Eight messages at a time. Each lane hashes its message's whole blocks
+ * straight from the message, then its padded tail; a lane that finishes
+ * picks up the next message. Every step runs all eight lanes for as many
+ * blocks as the busy lane closest to the end of its current run has left.
+ * Idle lanes duplicate a busy lane's work into a state nobody reads.
+ *
+ * With fewer than kMinBusyLanes busy and no messages left, the single
+ * message code finishes the stragglers faster.
+ */
+static const u32 kMinBusyLanes = 3;
+
+static
+void s_shaBatch8(const sShaAlgo& algo,
+                 const u8* const messages[], const u32 lengths[], u32 count, u8* hashes)
+{
+    void (*compress)(u32*, const u8*, size_t) =
+        canRunShaImpl(kShaImplSHANI) ? algo.compress_shani : algo.compress_c;
+
+    u32 state[8][8];
+    u8 tails[8][128];
+    bool busy[8];
+    u32 message[8];         // which message each lane is on
+    const u8* next[8];      // each lane's next block
+    size_t remaining[8];    // blocks left in each lane's current run
+    bool inTail[8];
+
+    u32 numBusy = 0;
+    u32 m = 0;
+    for (u32 j = 0; j < 8; j++)
+        busy[j] = false;
+
+    while (true)
+    {
+        // Give idle lanes new messages.
+        for (u32 j = 0; j < 8 && m < count; j++)
+        {
+            if (busy[j])
+                continue;
+            for (u32 i = 0; i < algo.numWords; i++)
+                state[i][j] = algo.iv[i];
+            u32 numTail = s_shaPadTail(messages[m], lengths[m], tails[j]);
+            busy[j] = true;
+            message[j] = m;
+            next[j] = messages[m];
+            remaining[j] = lengths[m] / 64;
+            inTail[j] = false;
+            if (remaining[j] == 0)
+            {
+                next[j] = tails[j];
+                remaining[j] = numTail;
+                inTail[j] = true;
+            }
+            numBusy++;
+            m++;
+        }
+
+        if (numBusy == 0)
+            break;
+
+        // Finish off the stragglers one at a time.
+        if (numBusy < kMinBusyLanes)
+        {
+            for (u32 j = 0; j < 8; j++)
+            {
+                if (!busy[j])
+                    continue;
+                u32 s[8];
+                for (u32 i = 0; i < algo.numWords; i++)
+                    s[i] = state[i][j];
+                compress(s, next[j], remaining[j]);
+                if (!inTail[j])
+                {
+                    u8 tail[128];
+                    compress(s, tail, s_shaPadTail(messages[message[j]],
+                                                          lengths[message[j]], tail));
+                }
+                s_shaWriteHash(s, algo.hashSize, hashes + message[j]*algo.hashSize);
+            }
+            break;
+        }
+
+        // Run all the lanes as far as the shortest busy run goes.
+        size_t numBlocks = 0;
+        u32 anyBusy = 0;
+        for (u32 j = 0; j < 8; j++)
+        {
+            if (busy[j] && (numBlocks == 0 || remaining[j] < numBlocks))
+            {
+                numBlocks = remaining[j];
+                anyBusy = j;
+            }
+        }
+        const u8* data[8];
+        for (u32 j = 0; j < 8; j++)
+            data[j] = busy[j] ? next[j] : next[anyBusy];
+        algo.compress_x8(state, data, numBlocks);
+
+        for (u32 j = 0; j < 8; j++)
+        {
+            if (!busy[j])
+                continue;
+            next[j] += numBlocks * 64;
+            remaining[j] -= numBlocks;
+            if (remaining[j] > 0)
+                continue;
+            if (!inTail[j])
+            {
+                next[j] = tails[j];
+                remaining[j] = (lengths[message[j]] % 64 < 56) ? 1 : 2;
+                inTail[j] = true;
+            }
+            else
+            {
+                u32 s[8];
+                for (u32 i = 0; i < algo.numWords; i++)
+                    s[i] = state[i][j];
+                s_shaWriteHash(s, algo.hashSize, hashes + message[j]*algo.hashSize);
+                busy[j] = false;
+                numBusy--;
+            }
+        }
+    }
+}
+
+
+static
+void s_shaBatch(const sShaAlgo& algo,
+                const u8* const messages[], const u32 lengths[], u32 count, u8* hashes,
+                nShaImpl impl)
+{
+    if (!canRunShaImpl(impl))
+        throw eInvalidArgument("This cpu can't run the requested SHA impl");
+    if (count == 0)
+        return;
+    if (messages == NULL || lengths == NULL || hashes == NULL)
+        throw eNullPointer("messages, lengths and hashes may not be null");
+    for (u32 m = 0; m < count; m++)
+        if (messages[m] == NULL && lengths[m] > 0)
+            throw eNullPointer("A message may only be null if its length is zero");
+
+    switch (impl)
+    {
+        case kShaImplPortable:
+            s_shaBatch1(algo, false, messages, lengths, count, hashes);
+            break;
+        case kShaImplSHANI:
+            s_shaBatch1(algo, true, messages, lengths, count, hashes);
+            break;
+        case kShaImplAVX2x8:
+            s_shaBatch8(algo, messages, lengths, count, hashes);
+            break;
+        default:
+            throw eInvalidArgument("Unknown SHA impl");
+    }
+}
+
+
+static
+nShaImpl s_bestShaImpl(const sShaAlgo& algo)
+{
+    if (algo.lanesBeatShaNi && canRunShaImpl(kShaImplAVX2x8))
+        return kShaImplAVX2x8;
+    if (canRunShaImpl(kShaImplSHANI))
+        return kShaImplSHANI;
+    if (canRunShaImpl(kShaImplAVX2x8))
+        return kShaImplAVX2x8;
+    return kShaImplPortable;
+}
+
+
+bool canRunShaImpl(nShaImpl impl)
+{
+    switch (impl)
+    {
+        case kShaImplPortable:
+            return true;
+        case kShaImplSHANI:
+        {
+            static bool sHasShaNi = sha_x86_has_shani();
+            return sHasShaNi;
+        }
+        case kShaImplAVX2x8:
+            return getSimdLevel() >= kSimdAVX2;
+        default:
+            return false;
+    }
+}
+
+
+void sha1_batch(const u8* const messages[], const u32 lengths[], u32 count, u8* hashes)
+{
+    static nShaImpl sBest = s_bestShaImpl(kSha1);
+    s_shaBatch(kSha1, messages, lengths, count, hashes, sBest);
+}
+
+
+void sha1_batch(const u8* const messages[], const u32 lengths[], u32 count, u8* hashes,
+                nShaImpl impl)
+{
+    s_shaBatch(kSha1, messages, lengths, count, hashes, impl);
+}
+
+
+void sha256_batch(const u8* const messages[], const u32 lengths[], u32 count, u8* hashes)
+{
+    static nShaImpl sBest = s_bestShaImpl(kSha256);
+    s_shaBatch(kSha256, messages, lengths, count, hashes, sBest);
+}
+
+
+void sha256_batch(const u8* const messages[], const u32 lengths[], u32 count, u8* hashes,
+                  nShaImpl impl)
+{
+    s_shaBatch(kSha256, messages, lengths, count, hashes, impl);
+}
+
+
 }   // namespace crypt
 }   // namespace rho
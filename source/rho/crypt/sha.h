@@ -97,6 +97,10 @@ int SHA1_Final(rho::u8 *md, SHA_CTX *c);
 rho::u8 *SHA1(const rho::u8 *d, size_t n, rho::u8 *md);
 void SHA1_Transform(SHA_CTX *c, const rho::u8 *data);
 
+/* Runs 'num' blocks through the portable compression function only (never
+ * the SHA extensions), updating the chaining words h0..h4 in 'state'. */
+void sha1_compress_c(SHA_LONG state[5], const rho::u8 *data, size_t num);
+
 #define SHA256_CBLOCK   (SHA_LBLOCK*4)  /* SHA-256 treats input data as a
                                          * contiguous array of 32 bit
                                          * wide big-endian values. */
@@ -122,6 +126,9 @@ int SHA256_Final(rho::u8 *md, SHA256_CTX *c);
 rho::u8 *SHA256(const rho::u8 *d, size_t n,rho::u8 *md);
 void SHA256_Transform(SHA256_CTX *c, const rho::u8 *data);
 
+/* The same, for SHA-224 and SHA-256. */
+void sha256_compress_c(SHA_LONG state[8], const rho::u8 *data, size_t num);
+
 
 #define SHA384_DIGEST_LENGTH    48
 #define SHA512_DIGEST_LENGTH    64
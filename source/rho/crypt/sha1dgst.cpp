@@ -66,3 +66,38 @@
 #define SHA_1
 
 #include "sha_locl.h"
+#include "sha_x86.h"
+
+#include <string.h>
+
+
+/*
+ * The block function md32_common.h calls: the SHA extensions when this cpu
+ * has them, else the portable code in sha_locl.h.
+ */
+static void sha1_block_data_order (SHA_CTX *c, const void *p, size_t num)
+{
+    static const bool sHasShaNi = sha_x86_has_shani();
+
+    if (sHasShaNi)
+    {
+        SHA_LONG state[5] = { c->h0, c->h1, c->h2, c->h3, c->h4 };
+        sha1_compress_shani(state, (const rho::u8*)p, num);
+        c->h0 = state[0]; c->h1 = state[1]; c->h2 = state[2];
+        c->h3 = state[3]; c->h4 = state[4];
+    }
+    else
+    {
+        sha1_block_data_order_c(c, p, num);
+    }
+}
+
+
+void sha1_compress_c(SHA_LONG state[5], const rho::u8 *data, size_t num)
+{
+    SHA_CTX c;
+    memset(&c, 0, sizeof(c));
+    c.h0 = state[0]; c.h1 = state[1]; c.h2 = state[2]; c.h3 = state[3]; c.h4 = state[4];
+    sha1_block_data_order_c(&c, data, num);
+    state[0] = c.h0; state[1] = c.h1; state[2] = c.h2; state[3] = c.h3; state[4] = c.h4;
+}
@@ -15,6 +15,7 @@
 #include <string.h>
 
 #include "sha.h"
+#include "sha_x86.h"
 
 
 int SHA224_Init(SHA256_CTX* c)
@@ -89,6 +90,7 @@ int SHA224_Final (rho::u8 *md, SHA256_CTX *c)
 #define HASH_BLOCK_DATA_ORDER   sha256_block_data_order
 
 static void sha256_block_data_order (SHA256_CTX *ctx, const void *in, size_t num);
+static void sha256_block_data_order_c (SHA256_CTX *ctx, const void *in, size_t num);
 
 #include "md32_common.h"
 
@@ -134,7 +136,7 @@ static const SHA_LONG K256[64] = {
     T1 = X[(i)&0x0f] += s0 + s1 + X[(i+9)&0x0f];    \
     ROUND_00_15(i,a,b,c,d,e,f,g,h);     } while (0)
 
-static void sha256_block_data_order (SHA256_CTX *ctx, const void *in, size_t num)
+static void sha256_block_data_order_c (SHA256_CTX *ctx, const void *in, size_t num)
 {
     MD32_REG_T a,b,c,d,e,f,g,h,s0,s1,T1;
     SHA_LONG    X[16];
@@ -221,3 +223,28 @@ static void sha256_block_data_order (SHA256_CTX *ctx, const void *in, size_t num
 
     }
 }
+
+
+/*
+ * The block function md32_common.h calls: the SHA extensions when this cpu
+ * has them, else the portable code above.
+ */
+static void sha256_block_data_order (SHA256_CTX *ctx, const void *in, size_t num)
+{
+    static const bool sHasShaNi = sha_x86_has_shani();
+
+    if (sHasShaNi)
+        sha256_compress_shani(ctx->h, (const rho::u8*)in, num);
+    else
+        sha256_block_data_order_c(ctx, in, num);
+}
+
+
+void sha256_compress_c(SHA_LONG state[8], const rho::u8 *data, size_t num)
+{
+    SHA256_CTX c;
+    memset(&c, 0, sizeof(c));
+    memcpy(c.h, state, sizeof(c.h));
+    sha256_block_data_order_c(&c, data, num);
+    memcpy(state, c.h, sizeof(c.h));
+}
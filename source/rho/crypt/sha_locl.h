@@ -90,6 +90,7 @@
     #define HASH_FINAL                  SHA_Final
     #define HASH_INIT                   SHA_Init
     #define HASH_BLOCK_DATA_ORDER       sha_block_data_order
+    #define HASH_BLOCK_DATA_ORDER_C     sha_block_data_order
     #define Xupdate(a,ix,ia,ib,ic,id)   (ix=(a)=(ia^ib^ic^id))
 
     static void sha_block_data_order (SHA_CTX *c, const void *p,size_t num);
@@ -101,6 +102,7 @@
     #define HASH_FINAL                  SHA1_Final
     #define HASH_INIT                   SHA1_Init
     #define HASH_BLOCK_DATA_ORDER       sha1_block_data_order
+    #define HASH_BLOCK_DATA_ORDER_C     sha1_block_data_order_c
     #if defined(__MWERKS__) && defined(__MC68K__)
           /* Metrowerks for Motorola fails otherwise:-( <appro@fy.chalmers.se> */
         #define Xupdate(a,ix,ia,ib,ic,id)   do { (a)=(ia^ib^ic^id);     \
@@ -113,6 +115,7 @@
     #endif
 
     static void sha1_block_data_order (SHA_CTX *c, const void *p,size_t num);
+    static void sha1_block_data_order_c (SHA_CTX *c, const void *p,size_t num);
 
 #else
     #error "Either SHA_0 or SHA_1 must be defined."
@@ -192,7 +195,7 @@ int SHA1_Init(SHA_CTX* c)
 #undef X
 #define X(i)   XX##i
 
-static void HASH_BLOCK_DATA_ORDER (SHA_CTX *c, const void *p, size_t num)
+static void HASH_BLOCK_DATA_ORDER_C (SHA_CTX *c, const void *p, size_t num)
 {
     const rho::u8 *data = (const rho::u8*)p;
     MD32_REG_T A,B,C,D,E,T,l;
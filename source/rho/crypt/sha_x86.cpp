@@ -0,0 +1,425 @@
+#include "sha_x86.h"
+
+#include "aesni/iaesni.h"
+
+
+#if IS_x86_FAM
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wcast-align"
+
+
+#define SHANI_FUNC __attribute__((target("sha,sse4.1")))
+#define AVX2_FUNC  __attribute__((target("avx2")))
+
+
+using rho::u8;
+using rho::u32;
+
+
+bool sha_x86_has_shani()
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, NULL) < 7)
+        return false;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1))
+        return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & bit_SHA) != 0;
+}
+
+
+static const u32 K256[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SHA extensions, one message
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Four SHA-1 rounds (group g of 20) with round function f, in the steady
+ * state: feeds in m0 (which holds W[4g..4g+3]) and works m1, m2 and m3
+ * towards the W's of groups g+1, g+2 and g+3. ex is the E value for this
+ * group; ey receives the one for the next.
+ */
+#define SHA1_ROUNDS4(f, ex, ey, m0, m1, m2, m3)     \
+    ex = _mm_sha1nexte_epu32(ex, m0);               \
+    ey = abcd;                                      \
+    m1 = _mm_sha1msg2_epu32(m1, m0);                \
+    abcd = _mm_sha1rnds4_epu32(abcd, ex, f);        \
+    m3 = _mm_sha1msg1_epu32(m3, m0);                \
+    m2 = _mm_xor_si128(m2, m0)
+
+SHANI_FUNC
+void sha1_compress_shani(u32 state[5], const u8* data, size_t num)
+{
+    const __m128i kMask = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1B);
+    __m128i e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+    __m128i e1;
+
+    for (; num > 0; num--, data += 64)
+    {
+        __m128i abcdSave = abcd;
+        __m128i e0Save = e0;
+
+        __m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data +  0)), kMask);
+        __m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), kMask);
+        __m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), kMask);
+        __m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), kMask);
+
+        // Rounds 0-15 (the message words themselves).
+        e0 = _mm_add_epi32(e0, m0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+        e1 = _mm_sha1nexte_epu32(e1, m1);
+        e0 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+        m0 = _mm_sha1msg1_epu32(m0, m1);
+
+        e0 = _mm_sha1nexte_epu32(e0, m2);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        m1 = _mm_sha1msg1_epu32(m1, m2);
+        m0 = _mm_xor_si128(m0, m2);
+
+        SHA1_ROUNDS4(0, e1, e0, m3, m0, m1, m2);
+
+        // Rounds 16-79 (the expanded message).
+        SHA1_ROUNDS4(0, e0, e1, m0, m1, m2, m3);
+        SHA1_ROUNDS4(1, e1, e0, m1, m2, m3, m0);
+        SHA1_ROUNDS4(1, e0, e1, m2, m3, m0, m1);
+        SHA1_ROUNDS4(1, e1, e0, m3, m0, m1, m2);
+        SHA1_ROUNDS4(1, e0, e1, m0, m1, m2, m3);
+        SHA1_ROUNDS4(1, e1, e0, m1, m2, m3, m0);
+        SHA1_ROUNDS4(2, e0, e1, m2, m3, m0, m1);
+        SHA1_ROUNDS4(2, e1, e0, m3, m0, m1, m2);
+        SHA1_ROUNDS4(2, e0, e1, m0, m1, m2, m3);
+        SHA1_ROUNDS4(2, e1, e0, m1, m2, m3, m0);
+        SHA1_ROUNDS4(2, e0, e1, m2, m3, m0, m1);
+        SHA1_ROUNDS4(3, e1, e0, m3, m0, m1, m2);
+        SHA1_ROUNDS4(3, e0, e1, m0, m1, m2, m3);
+        SHA1_ROUNDS4(3, e1, e0, m1, m2, m3, m0);
+        SHA1_ROUNDS4(3, e0, e1, m2, m3, m0, m1);
+        SHA1_ROUNDS4(3, e1, e0, m3, m0, m1, m2);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+
+    _mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = (u32)_mm_extract_epi32(e0, 3);
+}
+
+
+/*
+ * Four SHA-256 rounds (group g of 16): feeds in m0 (which holds
+ * W[4g..4g+3]) and, while more message words are needed, replaces m0 with
+ * the W's of group g+4.
+ */
+#define SHA256_ROUNDS4(g, m0, m1, m2, m3)                                           \
+    do {                                                                            \
+        __m128i msg = _mm_add_epi32(m0, _mm_loadu_si128((const __m128i*)&K256[4*g])); \
+        cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);                              \
+        abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0E));    \
+        if (g < 12)                                                                 \
+        {                                                                           \
+            __m128i t = _mm_add_epi32(_mm_sha256msg1_epu32(m0, m1),                 \
+                                      _mm_alignr_epi8(m3, m2, 4));                  \
+            m0 = _mm_sha256msg2_epu32(t, m3);                                       \
+        }                                                                           \
+    } while (false)
+
+SHANI_FUNC
+void sha256_compress_shani(u32 state[8], const u8* data, size_t num)
+{
+    const __m128i kMask = _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+    // The instructions want the state as (a, b, e, f) and (c, d, g, h).
+    __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1B);
+    __m128i abef = _mm_alignr_epi8(dcba, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, dcba, 0xF0);
+
+    for (; num > 0; num--, data += 64)
+    {
+        __m128i abefSave = abef;
+        __m128i cdghSave = cdgh;
+
+        __m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data +  0)), kMask);
+        __m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), kMask);
+        __m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), kMask);
+        __m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), kMask);
+
+        SHA256_ROUNDS4( 0, m0, m1, m2, m3);
+        SHA256_ROUNDS4( 1, m1, m2, m3, m0);
+        SHA256_ROUNDS4( 2, m2, m3, m0, m1);
+        SHA256_ROUNDS4( 3, m3, m0, m1, m2);
+        SHA256_ROUNDS4( 4, m0, m1, m2, m3);
+        SHA256_ROUNDS4( 5, m1, m2, m3, m0);
+        SHA256_ROUNDS4( 6, m2, m3, m0, m1);
+        SHA256_ROUNDS4( 7, m3, m0, m1, m2);
+        SHA256_ROUNDS4( 8, m0, m1, m2, m3);
+        SHA256_ROUNDS4( 9, m1, m2, m3, m0);
+        SHA256_ROUNDS4(10, m2, m3, m0, m1);
+        SHA256_ROUNDS4(11, m3, m0, m1, m2);
+        SHA256_ROUNDS4(12, m0, m1, m2, m3);
+        SHA256_ROUNDS4(13, m1, m2, m3, m0);
+        SHA256_ROUNDS4(14, m2, m3, m0, m1);
+        SHA256_ROUNDS4(15, m3, m0, m1, m2);
+
+        abef = _mm_add_epi32(abef, abefSave);
+        cdgh = _mm_add_epi32(cdgh, cdghSave);
+    }
+
+    __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(dchg, feba, 8));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// AVX2, eight messages
+////////////////////////////////////////////////////////////////////////////////
+
+static inline AVX2_FUNC
+__m256i s_rotl(__m256i x, int n)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+}
+
+/*
+ * Loads eight big-endian words from each of the eight lanes' blocks
+ * (starting 'offset' bytes in) and transposes them, so that w[i] holds
+ * word i of every lane.
+ */
+static inline AVX2_FUNC
+void s_loadTransposed(const u8* const data[8], size_t offset, __m256i w[8])
+{
+    const __m256i kMask = _mm256_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL,
+                                            0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+    __m256i r[8];
+    for (int j = 0; j < 8; j++)
+        r[j] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(data[j] + offset)), kMask);
+
+    __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    w[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    w[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    w[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    w[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    w[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    w[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    w[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    w[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+
+#define SHA1_F_00_19(b,c,d)  _mm256_xor_si256(_mm256_and_si256(b, _mm256_xor_si256(c, d)), d)
+#define SHA1_F_20_39(b,c,d)  _mm256_xor_si256(_mm256_xor_si256(b, c), d)
+#define SHA1_F_40_59(b,c,d)  _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)))
+#define SHA1_F_60_79(b,c,d)  SHA1_F_20_39(b,c,d)
+
+/*
+ * One SHA-1 round on all eight lanes. Rather than shuffling the five
+ * working variables along, the caller rotates the names: e receives the
+ * new a, and b is rotated in place.
+ */
+#define SHA1_ROUND_X8(F, k, a, b, c, d, e, wt)                                  \
+    do {                                                                        \
+        e = _mm256_add_epi32(_mm256_add_epi32(e, s_rotl(a, 5)),                 \
+                             _mm256_add_epi32(F(b, c, d), _mm256_add_epi32(k, wt))); \
+        b = s_rotl(b, 30);                                                      \
+    } while (false)
+
+#define SHA1_W_X8(w, t)                                                         \
+    (w[(t)&15] = s_rotl(_mm256_xor_si256(_mm256_xor_si256(w[((t)-3)&15], w[((t)-8)&15]), \
+                                         _mm256_xor_si256(w[((t)-14)&15], w[(t)&15])), 1))
+
+#define SHA1_ROUNDS5_X8(F, k, t, W)                                             \
+    SHA1_ROUND_X8(F, k, a, b, c, d, e, W(t+0));                                 \
+    SHA1_ROUND_X8(F, k, e, a, b, c, d, W(t+1));                                 \
+    SHA1_ROUND_X8(F, k, d, e, a, b, c, W(t+2));                                 \
+    SHA1_ROUND_X8(F, k, c, d, e, a, b, W(t+3));                                 \
+    SHA1_ROUND_X8(F, k, b, c, d, e, a, W(t+4))
+
+#define SHA1_W_LOADED(t)    w[t]
+#define SHA1_W_EXPANDED(t)  SHA1_W_X8(w, t)
+
+AVX2_FUNC
+void sha1_compress_x8_avx2(u32 state[5][8], const u8* const data[8], size_t num)
+{
+    const __m256i k0 = _mm256_set1_epi32(0x5a827999);
+    const __m256i k1 = _mm256_set1_epi32(0x6ed9eba1);
+    const __m256i k2 = _mm256_set1_epi32((int)0x8f1bbcdc);
+    const __m256i k3 = _mm256_set1_epi32((int)0xca62c1d6);
+
+    __m256i h[5];
+    for (int i = 0; i < 5; i++)
+        h[i] = _mm256_loadu_si256((const __m256i*)state[i]);
+
+    const u8* p[8];
+    for (int j = 0; j < 8; j++)
+        p[j] = data[j];
+
+    for (; num > 0; num--)
+    {
+        __m256i w[16];
+        s_loadTransposed(p, 0, w);
+        s_loadTransposed(p, 32, w + 8);
+        for (int j = 0; j < 8; j++)
+            p[j] += 64;
+
+        __m256i a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+
+        SHA1_ROUNDS5_X8(SHA1_F_00_19, k0,  0, SHA1_W_LOADED);
+        SHA1_ROUNDS5_X8(SHA1_F_00_19, k0,  5, SHA1_W_LOADED);
+        SHA1_ROUNDS5_X8(SHA1_F_00_19, k0, 10, SHA1_W_LOADED);
+        SHA1_ROUND_X8(SHA1_F_00_19, k0, a, b, c, d, e, w[15]);
+        SHA1_ROUND_X8(SHA1_F_00_19, k0, e, a, b, c, d, SHA1_W_EXPANDED(16));
+        SHA1_ROUND_X8(SHA1_F_00_19, k0, d, e, a, b, c, SHA1_W_EXPANDED(17));
+        SHA1_ROUND_X8(SHA1_F_00_19, k0, c, d, e, a, b, SHA1_W_EXPANDED(18));
+        SHA1_ROUND_X8(SHA1_F_00_19, k0, b, c, d, e, a, SHA1_W_EXPANDED(19));
+
+        for (int t = 20; t < 40; t += 5) { SHA1_ROUNDS5_X8(SHA1_F_20_39, k1, t, SHA1_W_EXPANDED); }
+        for (int t = 40; t < 60; t += 5) { SHA1_ROUNDS5_X8(SHA1_F_40_59, k2, t, SHA1_W_EXPANDED); }
+        for (int t = 60; t < 80; t += 5) { SHA1_ROUNDS5_X8(SHA1_F_60_79, k3, t, SHA1_W_EXPANDED); }
+
+        h[0] = _mm256_add_epi32(h[0], a);
+        h[1] = _mm256_add_epi32(h[1], b);
+        h[2] = _mm256_add_epi32(h[2], c);
+        h[3] = _mm256_add_epi32(h[3], d);
+        h[4] = _mm256_add_epi32(h[4], e);
+    }
+
+    for (int i = 0; i < 5; i++)
+        _mm256_storeu_si256((__m256i*)state[i], h[i]);
+}
+
+
+#define SHA256_S0(x)  _mm256_xor_si256(_mm256_xor_si256(s_rotl(x, 30), s_rotl(x, 19)), s_rotl(x, 10))
+#define SHA256_S1(x)  _mm256_xor_si256(_mm256_xor_si256(s_rotl(x, 26), s_rotl(x, 21)), s_rotl(x, 7))
+#define SHA256_s0(x)  _mm256_xor_si256(_mm256_xor_si256(s_rotl(x, 25), s_rotl(x, 14)), _mm256_srli_epi32(x, 3))
+#define SHA256_s1(x)  _mm256_xor_si256(_mm256_xor_si256(s_rotl(x, 15), s_rotl(x, 13)), _mm256_srli_epi32(x, 10))
+#define SHA256_CH(e,f,g)   _mm256_xor_si256(_mm256_and_si256(e, _mm256_xor_si256(f, g)), g)
+#define SHA256_MAJ(a,b,c)  _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)))
+
+/*
+ * One SHA-256 round on all eight lanes. As in sha256.cpp, only d and h
+ * change; the caller rotates the names.
+ */
+#define SHA256_ROUND_X8(t, a, b, c, d, e, f, g, h, wt)                          \
+    do {                                                                        \
+        __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, SHA256_S1(e)),        \
+                                      _mm256_add_epi32(SHA256_CH(e, f, g),      \
+                                          _mm256_add_epi32(_mm256_set1_epi32((int)K256[t]), wt))); \
+        d = _mm256_add_epi32(d, t1);                                            \
+        h = _mm256_add_epi32(t1, _mm256_add_epi32(SHA256_S0(a), SHA256_MAJ(a, b, c))); \
+    } while (false)
+
+#define SHA256_W_X8(w, t)                                                       \
+    (w[(t)&15] = _mm256_add_epi32(_mm256_add_epi32(w[(t)&15], SHA256_s0(w[((t)+1)&15])), \
+                                  _mm256_add_epi32(w[((t)+9)&15], SHA256_s1(w[((t)+14)&15]))))
+
+#define SHA256_ROUNDS8_X8(t, W)                                                 \
+    SHA256_ROUND_X8(t+0, a, b, c, d, e, f, g, h, W(t+0));                       \
+    SHA256_ROUND_X8(t+1, h, a, b, c, d, e, f, g, W(t+1));                       \
+    SHA256_ROUND_X8(t+2, g, h, a, b, c, d, e, f, W(t+2));                       \
+    SHA256_ROUND_X8(t+3, f, g, h, a, b, c, d, e, W(t+3));                       \
+    SHA256_ROUND_X8(t+4, e, f, g, h, a, b, c, d, W(t+4));                       \
+    SHA256_ROUND_X8(t+5, d, e, f, g, h, a, b, c, W(t+5));                       \
+    SHA256_ROUND_X8(t+6, c, d, e, f, g, h, a, b, W(t+6));                       \
+    SHA256_ROUND_X8(t+7, b, c, d, e, f, g, h, a, W(t+7))
+
+#define SHA256_W_LOADED(t)    w[t]
+#define SHA256_W_EXPANDED(t)  SHA256_W_X8(w, t)
+
+AVX2_FUNC
+void sha256_compress_x8_avx2(u32 state[8][8], const u8* const data[8], size_t num)
+{
+    __m256i s[8];
+    for (int i = 0; i < 8; i++)
+        s[i] = _mm256_loadu_si256((const __m256i*)state[i]);
+
+    const u8* p[8];
+    for (int j = 0; j < 8; j++)
+        p[j] = data[j];
+
+    for (; num > 0; num--)
+    {
+        __m256i w[16];
+        s_loadTransposed(p, 0, w);
+        s_loadTransposed(p, 32, w + 8);
+        for (int j = 0; j < 8; j++)
+            p[j] += 64;
+
+        __m256i a = s[0], b = s[1], c = s[2], d = s[3];
+        __m256i e = s[4], f = s[5], g = s[6], h = s[7];
+
+        SHA256_ROUNDS8_X8(0, SHA256_W_LOADED);
+        SHA256_ROUNDS8_X8(8, SHA256_W_LOADED);
+        for (int t = 16; t < 64; t += 8) { SHA256_ROUNDS8_X8(t, SHA256_W_EXPANDED); }
+
+        s[0] = _mm256_add_epi32(s[0], a);
+        s[1] = _mm256_add_epi32(s[1], b);
+        s[2] = _mm256_add_epi32(s[2], c);
+        s[3] = _mm256_add_epi32(s[3], d);
+        s[4] = _mm256_add_epi32(s[4], e);
+        s[5] = _mm256_add_epi32(s[5], f);
+        s[6] = _mm256_add_epi32(s[6], g);
+        s[7] = _mm256_add_epi32(s[7], h);
+    }
+
+    for (int i = 0; i < 8; i++)
+        _mm256_storeu_si256((__m256i*)state[i], s[i]);
+}
+
+
+#pragma GCC diagnostic pop
+
+#else
+
+#include <rho/eRho.h>
+
+bool sha_x86_has_shani() { return false; }
+
+void sha1_compress_shani(rho::u32 state[5], const rho::u8* data, size_t num) { throw rho::eImpossiblePath(); }
+void sha256_compress_shani(rho::u32 state[8], const rho::u8* data, size_t num) { throw rho::eImpossiblePath(); }
+
+void sha1_compress_x8_avx2(rho::u32 state[5][8], const rho::u8* const data[8], size_t num) { throw rho::eImpossiblePath(); }
+void sha256_compress_x8_avx2(rho::u32 state[8][8], const rho::u8* const data[8], size_t num) { throw rho::eImpossiblePath(); }
+
+#endif
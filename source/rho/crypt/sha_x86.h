@@ -0,0 +1,45 @@
+/*
+ * SHA-1 and SHA-256 compression functions that use x86 extensions, for
+ * sha1dgst.cpp, sha256.cpp and the batch functions in hash_utils.cpp.
+ *
+ * Each function runs 'num' 64-byte blocks through the compression
+ * function, updating 'state' (the five or eight chaining words, h0 first)
+ * in place. None of them pad; that's the caller's job.
+ *
+ * Only call the _shani functions when sha_x86_has_shani() says so, and
+ * the _x8_avx2 functions when rho::getSimdLevel() is kSimdAVX2. (On
+ * non-x86 machines they all throw eImpossiblePath.)
+ */
+
+
+#ifndef __rho_crypt_sha_x86_h__
+#define __rho_crypt_sha_x86_h__
+
+
+#include <rho/types.h>
+
+#include <stddef.h>
+
+
+/*
+ * Whether this cpu has the SHA extensions (SHA1RNDS4, SHA256RNDS2, ...).
+ */
+bool sha_x86_has_shani();
+
+
+void sha1_compress_shani(rho::u32 state[5], const rho::u8* data, size_t num);
+
+void sha256_compress_shani(rho::u32 state[8], const rho::u8* data, size_t num);
+
+
+/*
+ * Eight independent messages at once, one per 32-bit lane: 'data[j]' is
+ * lane j's next block, and state[i][j] is lane j's chaining word i. Every
+ * lane does 'num' blocks.
+ */
+void sha1_compress_x8_avx2(rho::u32 state[5][8], const rho::u8* const data[8], size_t num);
+
+void sha256_compress_x8_avx2(rho::u32 state[8][8], const rho::u8* const data[8], size_t num);
+
+
+#endif   // __rho_crypt_sha_x86_h__
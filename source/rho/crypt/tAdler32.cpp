@@ -0,0 +1,244 @@
+#include <rho/crypt/tAdler32.h>
+#include <rho/crypt/hash_utils.h>
+
+#if __i386__ || __x86_64__
+#include <tmmintrin.h>
+#include <immintrin.h>
+#endif
+
+
+namespace rho
+{
+namespace crypt
+{
+
+
+const u32 tAdler32::kHashSize;
+
+
+static const u32 kBase = 65521;     // largest prime below 2^16
+
+/*
+ * The most bytes that can be summed before s2 might overflow 32 bits (so
+ * before it has to be reduced mod kBase).
+ */
+static const u32 kNMax = 5552;
+
+
+static
+u32 s_adler32Scalar(u32 adler, const u8* p, u32 len)
+{
+    u32 s1 = adler & 0xFFFF;
+    u32 s2 = adler >> 16;
+    while (len > 0)
+    {
+        u32 n = (len < kNMax) ? len : kNMax;
+        len -= n;
+        for (; n > 0; n--, p++)
+        {
+            s1 += *p;
+            s2 += s1;
+        }
+        s1 %= kBase;
+        s2 %= kBase;
+    }
+    return (s2 << 16) | s1;
+}
+
+
+#if __i386__ || __x86_64__
+
+#define SSSE3_FUNC __attribute__((target("ssse3")))
+#define AVX2_FUNC  __attribute__((target("avx2")))
+
+/*
+ * The SSSE3 kernel works on 32-byte blocks, doing up to kNMax bytes' worth
+ * of blocks between reductions. Over a block of bytes b[0..31]:
+ *
+ *     s1' = s1 + sum(b[i])
+ *     s2' = s2 + 32*s1 + sum((32 - i) * b[i])
+ *
+ * sad_epu8 gives the first sum and maddubs (with taps 32, 31, ..., 1) the
+ * second. The 32*s1 terms are summed up in 'ps' and added in at the end.
+ * The leftover (less than a block) bytes go to the scalar code.
+ */
+static const u32 kBlock = 32;
+
+static
+SSSE3_FUNC
+u32 s_adler32SSSE3(u32 adler, const u8* p, u32 len)
+{
+    u32 s1 = adler & 0xFFFF;
+    u32 s2 = adler >> 16;
+
+    const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                       24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9,
+                                       8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+
+    u32 blocks = len / kBlock;
+    len -= blocks * kBlock;
+    while (blocks > 0)
+    {
+        u32 n = (blocks < kNMax / kBlock) ? blocks : kNMax / kBlock;
+        blocks -= n;
+
+        __m128i ps = _mm_setr_epi32((i32)(s1 * n), 0, 0, 0);
+        __m128i vs2 = _mm_setr_epi32((i32)s2, 0, 0, 0);
+        __m128i vs1 = zero;
+        for (; n > 0; n--, p += kBlock)
+        {
+            __m128i bytes1 = _mm_loadu_si128((const __m128i*)p);
+            __m128i bytes2 = _mm_loadu_si128((const __m128i*)(p + 16));
+            ps = _mm_add_epi32(ps, vs1);
+            vs1 = _mm_add_epi32(vs1, _mm_sad_epu8(bytes1, zero));
+            vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, tap1), ones));
+            vs1 = _mm_add_epi32(vs1, _mm_sad_epu8(bytes2, zero));
+            vs2 = _mm_add_epi32(vs2, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, tap2), ones));
+        }
+        vs2 = _mm_add_epi32(vs2, _mm_slli_epi32(ps, 5));
+
+        vs1 = _mm_add_epi32(vs1, _mm_shuffle_epi32(vs1, _MM_SHUFFLE(2, 3, 0, 1)));
+        vs1 = _mm_add_epi32(vs1, _mm_shuffle_epi32(vs1, _MM_SHUFFLE(1, 0, 3, 2)));
+        vs2 = _mm_add_epi32(vs2, _mm_shuffle_epi32(vs2, _MM_SHUFFLE(2, 3, 0, 1)));
+        vs2 = _mm_add_epi32(vs2, _mm_shuffle_epi32(vs2, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 = (s1 + (u32)_mm_cvtsi128_si32(vs1)) % kBase;
+        s2 = (u32)_mm_cvtsi128_si32(vs2) % kBase;
+    }
+
+    return s_adler32Scalar((s2 << 16) | s1, p, len);
+}
+
+/*
+ * Same idea with 64-byte blocks (taps 64, 63, ..., 1 over two loads), so
+ * there's more independent work per trip around the loop.
+ */
+static
+AVX2_FUNC
+u32 s_adler32AVX2(u32 adler, const u8* p, u32 len)
+{
+    const u32 kBlock64 = 64;
+
+    u32 s1 = adler & 0xFFFF;
+    u32 s2 = adler >> 16;
+
+    const __m256i tap1 = _mm256_setr_epi8(64, 63, 62, 61, 60, 59, 58, 57,
+                                          56, 55, 54, 53, 52, 51, 50, 49,
+                                          48, 47, 46, 45, 44, 43, 42, 41,
+                                          40, 39, 38, 37, 36, 35, 34, 33);
+    const __m256i tap2 = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25,
+                                          24, 23, 22, 21, 20, 19, 18, 17,
+                                          16, 15, 14, 13, 12, 11, 10, 9,
+                                          8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    u32 blocks = len / kBlock64;
+    len -= blocks * kBlock64;
+    while (blocks > 0)
+    {
+        u32 n = (blocks < kNMax / kBlock64) ? blocks : kNMax / kBlock64;
+        blocks -= n;
+
+        __m256i ps = _mm256_setr_epi32((i32)(s1 * n), 0, 0, 0, 0, 0, 0, 0);
+        __m256i vs2 = _mm256_setr_epi32((i32)s2, 0, 0, 0, 0, 0, 0, 0);
+        __m256i vs1 = zero;
+        for (; n > 0; n--, p += kBlock64)
+        {
+            __m256i bytes1 = _mm256_loadu_si256((const __m256i*)p);
+            __m256i bytes2 = _mm256_loadu_si256((const __m256i*)(p + 32));
+            __m256i sum = _mm256_add_epi32(_mm256_sad_epu8(bytes1, zero),
+                                           _mm256_sad_epu8(bytes2, zero));
+            __m256i mad = _mm256_add_epi32(_mm256_madd_epi16(_mm256_maddubs_epi16(bytes1, tap1), ones),
+                                           _mm256_madd_epi16(_mm256_maddubs_epi16(bytes2, tap2), ones));
+            ps = _mm256_add_epi32(ps, vs1);
+            vs1 = _mm256_add_epi32(vs1, sum);
+            vs2 = _mm256_add_epi32(vs2, mad);
+        }
+        vs2 = _mm256_add_epi32(vs2, _mm256_slli_epi32(ps, 6));
+
+        __m128i h1 = _mm_add_epi32(_mm256_castsi256_si128(vs1), _mm256_extracti128_si256(vs1, 1));
+        __m128i h2 = _mm_add_epi32(_mm256_castsi256_si128(vs2), _mm256_extracti128_si256(vs2, 1));
+        h1 = _mm_add_epi32(h1, _mm_shuffle_epi32(h1, _MM_SHUFFLE(2, 3, 0, 1)));
+        h1 = _mm_add_epi32(h1, _mm_shuffle_epi32(h1, _MM_SHUFFLE(1, 0, 3, 2)));
+        h2 = _mm_add_epi32(h2, _mm_shuffle_epi32(h2, _MM_SHUFFLE(2, 3, 0, 1)));
+        h2 = _mm_add_epi32(h2, _mm_shuffle_epi32(h2, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 = (s1 + (u32)_mm_cvtsi128_si32(h1)) % kBase;
+        s2 = (u32)_mm_cvtsi128_si32(h2) % kBase;
+    }
+
+    return s_adler32SSSE3((s2 << 16) | s1, p, len);
+}
+
+#endif
+
+
+u32 adler32(u32 adler, const u8* buffer, u32 length)
+{
+    return adler32(adler, buffer, length, getSimdLevel());
+}
+
+
+u32 adler32(u32 adler, const u8* buffer, u32 length, nSimdLevel maxLevel)
+{
+    if (buffer == NULL && length > 0)
+        throw eNullPointer("buffer may not be null");
+
+    nSimdLevel level = getSimdLevel();
+    if (maxLevel < level)
+        level = maxLevel;
+
+    #if __i386__ || __x86_64__
+    if (level >= kSimdAVX2)
+        return s_adler32AVX2(adler, buffer, length);
+    if (level >= kSimdSSSE3)
+        return s_adler32SSSE3(adler, buffer, length);
+    #endif
+
+    return s_adler32Scalar(adler, buffer, length);
+}
+
+
+tAdler32::tAdler32()
+    : m_adler(1)
+{
+}
+
+i32 tAdler32::write(const u8* buffer, i32 length)
+{
+    return this->writeAll(buffer, length);
+}
+
+i32 tAdler32::writeAll(const u8* buffer, i32 length)
+{
+    if (length <= 0)
+        throw eInvalidArgument("Stream read/write length must be >0");
+
+    m_adler = adler32(m_adler, buffer, (u32)length);
+    return length;
+}
+
+std::vector<u8> tAdler32::getHash() const
+{
+    std::vector<u8> v(kHashSize, 0);
+    for (u32 i = 0; i < kHashSize; i++)
+        v[i] = (u8)((m_adler >> (24 - 8*i)) & 0xFF);
+    return v;
+}
+
+std::string tAdler32::getHashString() const
+{
+    std::vector<u8> hash = getHash();
+    return hashToString(hash);
+}
+
+u32 tAdler32::getChecksum() const
+{
+    return m_adler;
+}
+
+
+}   // namespace crypt
+}   // namespace rho
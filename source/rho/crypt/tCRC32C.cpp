@@ -0,0 +1,291 @@
+#include <rho/crypt/tCRC32C.h>
+#include <rho/crypt/hash_utils.h>
+
+#include <cstring>
+
+#if __i386__ || __x86_64__
+#include <nmmintrin.h>
+#endif
+
+
+namespace rho
+{
+namespace crypt
+{
+
+
+const u32 tCRC32C::kHashSize;
+
+
+static const u32 kPoly = 0x82f63b78;     // reflected
+
+
+/*
+ * The tables: 'sw' is for doing eight bytes at a time in software
+ * ("slicing-by-8"). 'longShift' and 'shortShift' append kLong or kShort
+ * zero bytes to a CRC in one step; the crc32 instruction path uses them to
+ * glue together the CRCs of three pieces computed side by side. (Both
+ * ideas as in Mark Adler's crc32c.c.)
+ */
+static const u32 kLong = 8192;
+static const u32 kShort = 256;
+
+static
+u32 s_gf2MatrixTimes(const u32* mat, u32 vec)
+{
+    u32 sum = 0;
+    for (; vec; vec >>= 1, mat++)
+        if (vec & 1)
+            sum ^= *mat;
+    return sum;
+}
+
+static
+void s_gf2MatrixSquare(u32* square, const u32* mat)
+{
+    for (int n = 0; n < 32; n++)
+        square[n] = s_gf2MatrixTimes(mat, mat[n]);
+}
+
+static
+void s_zerosTable(u32 table[4][256], u32 len)
+{
+    // The operator for one zero bit goes in 'odd', then squaring gives
+    // two, four, eight (one byte), ... zero bits.
+    u32 odd[32];
+    u32 even[32];
+    odd[0] = kPoly;
+    for (int n = 1; n < 32; n++)
+        odd[n] = 1u << (n - 1);
+    s_gf2MatrixSquare(even, odd);
+    s_gf2MatrixSquare(odd, even);
+
+    const u32* op = NULL;
+    while (true)
+    {
+        s_gf2MatrixSquare(even, odd);
+        len >>= 1;
+        if (len == 0) { op = even; break; }
+        s_gf2MatrixSquare(odd, even);
+        len >>= 1;
+        if (len == 0) { op = odd; break; }
+    }
+
+    for (u32 n = 0; n < 256; n++)
+    {
+        table[0][n] = s_gf2MatrixTimes(op, n);
+        table[1][n] = s_gf2MatrixTimes(op, n << 8);
+        table[2][n] = s_gf2MatrixTimes(op, n << 16);
+        table[3][n] = s_gf2MatrixTimes(op, n << 24);
+    }
+}
+
+struct sCrc32cTables
+{
+    u32 sw[8][256];
+    u32 longShift[4][256];
+    u32 shortShift[4][256];
+
+    sCrc32cTables()
+    {
+        for (u32 n = 0; n < 256; n++)
+        {
+            u32 crc = n;
+            for (int k = 0; k < 8; k++)
+                crc = (crc & 1) ? (crc >> 1) ^ kPoly : (crc >> 1);
+            sw[0][n] = crc;
+        }
+        for (u32 n = 0; n < 256; n++)
+            for (int k = 1; k < 8; k++)
+                sw[k][n] = (sw[k-1][n] >> 8) ^ sw[0][sw[k-1][n] & 0xFF];
+
+        s_zerosTable(longShift, kLong);
+        s_zerosTable(shortShift, kShort);
+    }
+};
+
+static
+const sCrc32cTables& s_tables()
+{
+    static sCrc32cTables sTables;
+    return sTables;
+}
+
+static inline
+u32 s_shift(const u32 table[4][256], u32 crc)
+{
+    return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^
+           table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+}
+
+
+static
+u32 s_crc32cSoftware(u32 crc, const u8* p, u32 len)
+{
+    const u32 (*t)[256] = s_tables().sw;
+
+    crc = ~crc;
+    for (; len >= 8; len -= 8, p += 8)
+    {
+        u32 lo = crc ^ ((u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24));
+        u32 hi = (u32)p[4] | ((u32)p[5] << 8) | ((u32)p[6] << 16) | ((u32)p[7] << 24);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    for (; len > 0; len--, p++)
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+    return ~crc;
+}
+
+
+#if __i386__ || __x86_64__
+
+#define SSE42_FUNC __attribute__((target("sse4.2")))
+
+static inline SSE42_FUNC
+u64 s_crc64(u64 crc, const u8* p)
+{
+    u64 v;
+    memcpy(&v, p, 8);
+#if __x86_64__
+    return _mm_crc32_u64(crc, v);
+#else
+    u32 c = _mm_crc32_u32((u32)crc, (u32)v);
+    return _mm_crc32_u32(c, (u32)(v >> 32));
+#endif
+}
+
+/*
+ * The crc32 instruction can start a new crc every cycle, but each takes
+ * three cycles to finish; so for long buffers run three independent CRCs
+ * over three consecutive pieces, then shift and combine them.
+ */
+static
+SSE42_FUNC
+u32 s_crc32cSSE42(u32 crc32, const u8* p, u32 len)
+{
+    const sCrc32cTables& tables = s_tables();
+
+    u64 crc = (u32)~crc32;
+
+    for (; len >= 3*kLong; len -= 3*kLong, p += 3*kLong)
+    {
+        u64 crc1 = 0, crc2 = 0;
+        for (u32 i = 0; i < kLong; i += 8)
+        {
+            crc = s_crc64(crc, p + i);
+            crc1 = s_crc64(crc1, p + kLong + i);
+            crc2 = s_crc64(crc2, p + 2*kLong + i);
+        }
+        crc = s_shift(tables.longShift, (u32)crc) ^ crc1;
+        crc = s_shift(tables.longShift, (u32)crc) ^ crc2;
+    }
+
+    for (; len >= 3*kShort; len -= 3*kShort, p += 3*kShort)
+    {
+        u64 crc1 = 0, crc2 = 0;
+        for (u32 i = 0; i < kShort; i += 8)
+        {
+            crc = s_crc64(crc, p + i);
+            crc1 = s_crc64(crc1, p + kShort + i);
+            crc2 = s_crc64(crc2, p + 2*kShort + i);
+        }
+        crc = s_shift(tables.shortShift, (u32)crc) ^ crc1;
+        crc = s_shift(tables.shortShift, (u32)crc) ^ crc2;
+    }
+
+    for (; len >= 8; len -= 8, p += 8)
+        crc = s_crc64(crc, p);
+
+    u32 c = (u32)crc;
+    for (; len > 0; len--, p++)
+        c = _mm_crc32_u8(c, *p);
+
+    return ~c;
+}
+
+static
+bool s_hasSSE42()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#else
+
+static
+u32 s_crc32cSSE42(u32 crc, const u8* p, u32 len)
+{
+    throw eImpossiblePath();
+}
+
+static
+bool s_hasSSE42()
+{
+    return false;
+}
+
+#endif
+
+
+u32 crc32c(u32 crc, const u8* buffer, u32 length)
+{
+    return crc32c(crc, buffer, length, true);
+}
+
+
+u32 crc32c(u32 crc, const u8* buffer, u32 length, bool useSSE42)
+{
+    static bool sHasSSE42 = s_hasSSE42();
+
+    if (buffer == NULL && length > 0)
+        throw eNullPointer("buffer may not be null");
+
+    if (useSSE42 && sHasSSE42)
+        return s_crc32cSSE42(crc, buffer, length);
+    else
+        return s_crc32cSoftware(crc, buffer, length);
+}
+
+
+tCRC32C::tCRC32C()
+    : m_crc(0)
+{
+}
+
+i32 tCRC32C::write(const u8* buffer, i32 length)
+{
+    return this->writeAll(buffer, length);
+}
+
+i32 tCRC32C::writeAll(const u8* buffer, i32 length)
+{
+    if (length <= 0)
+        throw eInvalidArgument("Stream read/write length must be >0");
+
+    m_crc = crc32c(m_crc, buffer, (u32)length);
+    return length;
+}
+
+std::vector<u8> tCRC32C::getHash() const
+{
+    std::vector<u8> v(kHashSize, 0);
+    for (u32 i = 0; i < kHashSize; i++)
+        v[i] = (u8)((m_crc >> (24 - 8*i)) & 0xFF);
+    return v;
+}
+
+std::string tCRC32C::getHashString() const
+{
+    std::vector<u8> hash = getHash();
+    return hashToString(hash);
+}
+
+u32 tCRC32C::getCRC() const
+{
+    return m_crc;
+}
+
+
+}   // namespace crypt
+}   // namespace rho
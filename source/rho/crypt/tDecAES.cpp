@@ -17,6 +17,7 @@ namespace crypt
 
 
 #include "alignedmem.ipp"
+#include "ctr_gcm.ipp"
 
 
 tDecAES::tDecAES(nOperationModeAES opmode, const u8 key[], nKeyLengthAES keylen)
@@ -39,6 +40,19 @@ tDecAES::tDecAES(nOperationModeAES opmode, const u8 key[], nKeyLengthAES keylen,
 
 void tDecAES::dec(u8* ctbuf, u8* ptbuf, u32 numblocks, u8* iv)
 {
+    if (m_opmode == kOpModeGCM)
+        throw eLogicError("tDecAES::dec() can't be used in GCM mode. Use decGCM().");
+
+    // CTR mode (both impls):
+    if (m_opmode == kOpModeCTR)
+    {
+        if (iv == NULL)
+            throw eInvalidArgument("In CTR mode, the iv (the counter block) must be given.");
+        s_ctr(m_useASM, m_keylen, m_expandedKey, m_rk, m_Nr,
+              ctbuf, ptbuf, ((size_t)numblocks)*AES_BLOCK_SIZE, iv);
+        return;
+    }
+
     // Fast ASM impl:
     if (m_useASM)
     {
@@ -101,6 +115,29 @@ void tDecAES::dec(u8* ctbuf, u8* ptbuf, u32 numblocks, u8* iv)
 }
 
 
+void tDecAES::decGCM(const u8* ctbuf, u8* ptbuf, u32 numbytes, const u8 nonce[12],
+                     const u8* aad, u32 aadlen, const u8 tag[AES_BLOCK_SIZE])
+{
+    if (m_opmode != kOpModeGCM)
+        throw eLogicError("tDecAES::decGCM() can only be used in GCM mode.");
+
+    u8 expectedTag[AES_BLOCK_SIZE];
+    s_gcm(false, m_useASM, m_usePCLMUL, m_keylen, m_expandedKey, m_rk, m_Nr, m_hashKey,
+          ctbuf, ptbuf, numbytes, nonce, aad, aadlen, expectedTag);
+
+    // Compare every byte, so that how long this takes says nothing about
+    // how much of the tag was right.
+    u8 diff = 0;
+    for (u32 i = 0; i < AES_BLOCK_SIZE; i++)
+        diff |= (u8)(expectedTag[i] ^ tag[i]);
+    if (diff != 0)
+    {
+        memset(ptbuf, 0, numbytes);
+        throw eRuntimeError("The GCM authentication tag does not match. The data has been altered.");
+    }
+}
+
+
 tDecAES::~tDecAES()
 {
     m_finalize();
@@ -121,12 +158,16 @@ void tDecAES::m_init(nOperationModeAES opmode, const u8 key[], nKeyLengthAES key
     m_keylen = keylen;
     m_useASM = useFastASM;
     m_expandedKey = NULL;
+    m_hashKey = NULL;
+    m_usePCLMUL = false;
 
     // Check the opmode.
     switch (opmode)
     {
         case kOpModeECB: break;
         case kOpModeCBC: break;
+        case kOpModeCTR: break;
+        case kOpModeGCM: break;
         default: throw eInvalidArgument("The opmode parameter is not valid!");
     }
 
@@ -139,6 +180,10 @@ void tDecAES::m_init(nOperationModeAES opmode, const u8 key[], nKeyLengthAES key
         default: throw eInvalidArgument("The keylen parameter is not valid!");
     }
 
+    // CTR and GCM only ever run the cipher forwards, in both directions,
+    // so they need the encryption key schedule.
+    bool forwards = (opmode == kOpModeCTR || opmode == kOpModeGCM);
+
     // Fast ASM setup:
     if (m_useASM)
     {
@@ -149,7 +194,10 @@ void tDecAES::m_init(nOperationModeAES opmode, const u8 key[], nKeyLengthAES key
             {
                 u8* key_copy = new u8[16];
                 memcpy(key_copy, key, 16);
-                iDecExpandKey128(key_copy, m_expandedKey);
+                if (forwards)
+                    iEncExpandKey128(key_copy, m_expandedKey);
+                else
+                    iDecExpandKey128(key_copy, m_expandedKey);
                 delete [] key_copy;
                 break;
             }
@@ -157,7 +205,10 @@ void tDecAES::m_init(nOperationModeAES opmode, const u8 key[], nKeyLengthAES key
             {
                 u8* key_copy = new u8[24];
                 memcpy(key_copy, key, 24);
-                iDecExpandKey192(key_copy, m_expandedKey);
+                if (forwards)
+                    iEncExpandKey192(key_copy, m_expandedKey);
+                else
+                    iDecExpandKey192(key_copy, m_expandedKey);
                 delete [] key_copy;
                 break;
             }
@@ -165,7 +216,10 @@ void tDecAES::m_init(nOperationModeAES opmode, const u8 key[], nKeyLengthAES key
             {
                 u8* key_copy = new u8[32];
                 memcpy(key_copy, key, 32);
-                iDecExpandKey256(key_copy, m_expandedKey);
+                if (forwards)
+                    iEncExpandKey256(key_copy, m_expandedKey);
+                else
+                    iDecExpandKey256(key_copy, m_expandedKey);
                 delete [] key_copy;
                 break;
             }
@@ -185,10 +239,21 @@ void tDecAES::m_init(nOperationModeAES opmode, const u8 key[], nKeyLengthAES key
             case k256bit: keybits = 256; expectedNr = 14; break;
             default: throw eInvalidArgument("The keylen parameter is not valid!");
         }
-        m_Nr = rijndaelKeySetupDec(m_rk, key, keybits);
+        if (forwards)
+            m_Nr = rijndaelKeySetupEnc(m_rk, key, keybits);
+        else
+            m_Nr = rijndaelKeySetupDec(m_rk, key, keybits);
         if (m_Nr != expectedNr)
             throw eImpossiblePath();
     }
+
+    // GCM setup:
+    if (opmode == kOpModeGCM)
+    {
+        m_usePCLMUL = m_useASM && check_for_pclmul_instructions();
+        m_hashKey = s_aligned_malloc(kHashKeySize, 16);
+        s_ghashInit(m_useASM, m_usePCLMUL, m_keylen, m_expandedKey, m_rk, m_Nr, m_hashKey);
+    }
 }
 
 
@@ -196,6 +261,8 @@ void tDecAES::m_finalize()
 {
     s_aligned_free(m_expandedKey);
     m_expandedKey = NULL;
+    s_aligned_free(m_hashKey);
+    m_hashKey = NULL;
 }
 
 
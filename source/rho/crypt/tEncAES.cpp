@@ -17,6 +17,7 @@ namespace crypt
 
 
 #include "alignedmem.ipp"
+#include "ctr_gcm.ipp"
 
 
 tEncAES::tEncAES(nOperationModeAES opmode, const u8 key[], nKeyLengthAES keylen)
@@ -39,6 +40,19 @@ tEncAES::tEncAES(nOperationModeAES opmode, const u8 key[], nKeyLengthAES keylen,
 
 void tEncAES::enc(u8* ptbuf, u8* ctbuf, u32 numblocks, u8* iv)
 {
+    if (m_opmode == kOpModeGCM)
+        throw eLogicError("tEncAES::enc() can't be used in GCM mode. Use encGCM().");
+
+    // CTR mode (both impls):
+    if (m_opmode == kOpModeCTR)
+    {
+        if (iv == NULL)
+            throw eInvalidArgument("In CTR mode, the iv (the counter block) must be given.");
+        s_ctr(m_useASM, m_keylen, m_expandedKey, m_rk, m_Nr,
+              ptbuf, ctbuf, ((size_t)numblocks)*AES_BLOCK_SIZE, iv);
+        return;
+    }
+
     // Fast ASM impl:
     if (m_useASM)
     {
@@ -97,6 +111,16 @@ void tEncAES::enc(u8* ptbuf, u8* ctbuf, u32 numblocks, u8* iv)
 }
 
 
+void tEncAES::encGCM(const u8* ptbuf, u8* ctbuf, u32 numbytes, const u8 nonce[12],
+                     const u8* aad, u32 aadlen, u8 tag[AES_BLOCK_SIZE])
+{
+    if (m_opmode != kOpModeGCM)
+        throw eLogicError("tEncAES::encGCM() can only be used in GCM mode.");
+    s_gcm(true, m_useASM, m_usePCLMUL, m_keylen, m_expandedKey, m_rk, m_Nr, m_hashKey,
+          ptbuf, ctbuf, numbytes, nonce, aad, aadlen, tag);
+}
+
+
 tEncAES::~tEncAES()
 {
     m_finalize();
@@ -117,12 +141,16 @@ void tEncAES::m_init(nOperationModeAES opmode, const u8 key[], nKeyLengthAES key
     m_keylen = keylen;
     m_useASM = useFastASM;
     m_expandedKey = NULL;
+    m_hashKey = NULL;
+    m_usePCLMUL = false;
 
     // Check the opmode.
     switch (opmode)
     {
         case kOpModeECB: break;
         case kOpModeCBC: break;
+        case kOpModeCTR: break;
+        case kOpModeGCM: break;
         default: throw eInvalidArgument("The opmode parameter is not valid!");
     }
 
@@ -185,6 +213,14 @@ void tEncAES::m_init(nOperationModeAES opmode, const u8 key[], nKeyLengthAES key
         if (m_Nr != expectedNr)
             throw eImpossiblePath();
     }
+
+    // GCM setup:
+    if (opmode == kOpModeGCM)
+    {
+        m_usePCLMUL = m_useASM && check_for_pclmul_instructions();
+        m_hashKey = s_aligned_malloc(kHashKeySize, 16);
+        s_ghashInit(m_useASM, m_usePCLMUL, m_keylen, m_expandedKey, m_rk, m_Nr, m_hashKey);
+    }
 }
 
 
@@ -192,6 +228,8 @@ void tEncAES::m_finalize()
 {
     s_aligned_free(m_expandedKey);
     m_expandedKey = NULL;
+    s_aligned_free(m_hashKey);
+    m_hashKey = NULL;
 }
 
 
@@ -10,6 +10,10 @@ namespace crypt
 {
 
 
+const u32 tMD5::kHashSize;
+const u32 tMD5::kBlockSize;
+
+
 tMD5::tMD5()
     : m_context(NULL)
 {
@@ -39,9 +43,8 @@ i32 tMD5::writeAll(const u8* buffer, i32 length)
 
 std::vector<u8> tMD5::getHash() const
 {
-    std::vector<u8> v(16, 0);
-    MD5_CTX context = *((MD5_CTX*)m_context);
-    MD5Final(&(v[0]), &context);
+    std::vector<u8> v(kHashSize, 0);
+    getHash(&v[0]);
     return v;
 }
 
@@ -51,6 +54,17 @@ std::string tMD5::getHashString() const
     return hashToString(hash);
 }
 
+void tMD5::getHash(u8* hash) const
+{
+    MD5_CTX context = *((MD5_CTX*)m_context);
+    MD5Final(hash, &context);
+}
+
+void tMD5::copyFrom(const tMD5& other)
+{
+    *((MD5_CTX*)m_context) = *((MD5_CTX*)other.m_context);
+}
+
 
 }   // namespace crypt
 }   // namespace rho
@@ -11,6 +11,39 @@ namespace crypt
 {
 
 
+#include "chunk_nonce.ipp"
+
+
+/*
+ * Extracts the chunk length and sequence number from the first block of a
+ * chunk.
+ */
+static
+void s_parseHeader(const u8 pt[AES_BLOCK_SIZE], u32* chunkLenOut, u64* seqOut)
+{
+    // Extract the chunk length.
+    u32 chunkLen = 0;
+    chunkLen |= pt[0]; chunkLen <<= 8;
+    chunkLen |= pt[1]; chunkLen <<= 8;
+    chunkLen |= pt[2]; chunkLen <<= 8;
+    chunkLen |= pt[3];
+
+    // Extract the sequence number.
+    u64 seq = 0;
+    seq |= pt[ 4]; seq <<= 8;
+    seq |= pt[ 5]; seq <<= 8;
+    seq |= pt[ 6]; seq <<= 8;
+    seq |= pt[ 7]; seq <<= 8;
+    seq |= pt[ 8]; seq <<= 8;
+    seq |= pt[ 9]; seq <<= 8;
+    seq |= pt[10]; seq <<= 8;
+    seq |= pt[11];
+
+    *chunkLenOut = chunkLen;
+    *seqOut = seq;
+}
+
+
 tReadableAES::tReadableAES(iReadable* internalStream, nOperationModeAES opmode,
              const u8 key[], nKeyLengthAES keylen)
     : m_stream(internalStream),
@@ -21,14 +54,14 @@ tReadableAES::tReadableAES(iReadable* internalStream, nOperationModeAES opmode,
       m_aes(opmode, key, keylen)
 {
     // Check the op mode.
-    if (m_opmode == kOpModeCBC)
+    if (m_opmode != kOpModeECB)
     {
         m_hasReadInitializationVector = false;
     }
 
     // Alloc the chunk buffer.
     m_bufSize = 512*AES_BLOCK_SIZE;
-    m_buf = new u8[m_bufSize];
+    m_buf = new u8[m_bufSize + AES_BLOCK_SIZE];   // <-- room for the GCM tag
 }
 
 tReadableAES::~tReadableAES()
@@ -95,6 +128,29 @@ bool tReadableAES::m_refill()
         m_hasReadInitializationVector = true;
     }
 
+    // Same for the nonce in ctr and gcm modes (which is sent in the clear).
+    if ((m_opmode == kOpModeCTR || m_opmode == kOpModeGCM) && !m_hasReadInitializationVector)
+    {
+        i32 r = m_stream.readAll(m_nonce, 12);
+        if (r != 12)
+        {
+            return (r >= 0);  // <-- makes read() give the expected behavior
+        }
+        m_hasReadInitializationVector = true;
+    }
+
+    if (m_opmode == kOpModeGCM)
+        return m_refillGCM();
+
+    // In ctr mode, the chunk's counter blocks start at its nonce.
+    u8 counter[AES_BLOCK_SIZE] = { 0 };
+    u8* iv = m_last_ct;
+    if (m_opmode == kOpModeCTR)
+    {
+        s_chunkNonce(m_nonce, m_seq, counter);
+        iv = counter;
+    }
+
     // Read an AES block from the stream.
     u8  ct[AES_BLOCK_SIZE];
     i32 r = m_stream.readAll(ct, AES_BLOCK_SIZE);
@@ -105,31 +161,16 @@ bool tReadableAES::m_refill()
 
     // Decrypt the ct buffer into the pt buffer.
     u8 pt[AES_BLOCK_SIZE];
-    m_aes.dec(ct, pt, 1, m_last_ct);
+    m_aes.dec(ct, pt, 1, iv);
 
     // Pointer aliasing.
     u8* buf = m_buf;
 
     // We just read the first block (16 bytes) of a chunk from the stream.
     // This block contains the chunk's length, sequence number, and parity.
-
-    // Extract the chunk length.
-    u32 chunkLen = 0;
-    chunkLen |= pt[0]; chunkLen <<= 8;
-    chunkLen |= pt[1]; chunkLen <<= 8;
-    chunkLen |= pt[2]; chunkLen <<= 8;
-    chunkLen |= pt[3];
-
-    // Extract the sequence number.
-    u64 seq = 0;
-    seq |= pt[ 4]; seq <<= 8;
-    seq |= pt[ 5]; seq <<= 8;
-    seq |= pt[ 6]; seq <<= 8;
-    seq |= pt[ 7]; seq <<= 8;
-    seq |= pt[ 8]; seq <<= 8;
-    seq |= pt[ 9]; seq <<= 8;
-    seq |= pt[10]; seq <<= 8;
-    seq |= pt[11];
+    u32 chunkLen;
+    u64 seq;
+    s_parseHeader(pt, &chunkLen, &seq);
 
     // Verify that these values are correct.
     if (chunkLen <= 16)
@@ -156,7 +197,7 @@ bool tReadableAES::m_refill()
     }
 
     // Decrypt the bytes we just read.
-    m_aes.dec(buf, buf, bytesToRead/AES_BLOCK_SIZE, m_last_ct);
+    m_aes.dec(buf, buf, bytesToRead/AES_BLOCK_SIZE, iv);
 
     // Calculate the parity.
     for (u32 i = 0; i < bytesToRead; i += AES_BLOCK_SIZE)
@@ -180,12 +221,60 @@ bool tReadableAES::m_refill()
     return true;
 }
 
+bool tReadableAES::m_refillGCM()
+{
+    // Read the length of the chunk, which is sent in the clear (but is
+    // covered by the tag).
+    u8 len[4];
+    i32 r = m_stream.readAll(len, 4);
+    if (r != 4)
+    {
+        return (r >= 0);  // <-- makes read() give the expected behavior
+    }
+    u32 chunkLen = ((u32)len[0] << 24) | ((u32)len[1] << 16) |
+                   ((u32)len[2] <<  8) | ((u32)len[3]);
+    if (chunkLen <= 16)
+        throw eRuntimeError("This stream is not a valid AES stream. The chunk length is <=16.");
+    if (chunkLen > m_bufSize)
+        throw eRuntimeError("This stream is not a valid AES stream. The chunk length is too large.");
+
+    // Read the chunk and its tag.
+    u8* buf = m_buf;
+    r = m_stream.readAll(buf, chunkLen + AES_BLOCK_SIZE);
+    if (r < 0 || ((u32)r) != chunkLen + AES_BLOCK_SIZE)
+    {
+        return (r >= 0);  // <-- makes read() give the expected behavior
+    }
+
+    // Check the tag and decrypt. (This throws if the tag is wrong.)
+    u8 nonce[12];
+    s_chunkNonce(m_nonce, m_seq, nonce);
+    m_aes.decGCM(buf, buf, chunkLen, nonce, len, 4, buf+chunkLen);
+
+    // The tag vouches for the rest, but the header should agree with it.
+    u32 headerLen;
+    u64 seq;
+    s_parseHeader(buf, &headerLen, &seq);
+    if (headerLen != chunkLen)
+        throw eRuntimeError("This stream is not a valid AES stream. The chunk length is inconsistent.");
+    if (seq != m_seq)
+        throw eRuntimeError("This stream is not a valid AES stream. The sequence number is not what was expected.");
+    m_seq += chunkLen;
+
+    // All must have worked, so set the state up for reading. (The data
+    // follows the chunk's first block.)
+    m_pos = AES_BLOCK_SIZE;
+    m_bufUsed = chunkLen;
+
+    return true;
+}
+
 void tReadableAES::reset()
 {
     m_pos = 0;
     m_bufUsed = 0;
     m_seq = 0;
-    if (m_opmode == kOpModeCBC)
+    if (m_opmode != kOpModeECB)
         m_hasReadInitializationVector = false;
 }
 
@@ -10,6 +10,10 @@ namespace crypt
 {
 
 
+const u32 tSHA1::kHashSize;
+const u32 tSHA1::kBlockSize;
+
+
 tSHA1::tSHA1()
     : m_context(NULL)
 {
@@ -39,12 +43,8 @@ i32 tSHA1::writeAll(const u8* buffer, i32 length)
 
 std::vector<u8> tSHA1::getHash() const
 {
-    u8 dg[SHA_DIGEST_LENGTH];
-    SHA_CTX context = *((SHA_CTX*)m_context);
-    SHA1_Final(dg, &context);
-
-    std::vector<u8> v(SHA_DIGEST_LENGTH, 0);
-    for (size_t i = 0; i < v.size(); i++) v[i] = dg[i];
+    std::vector<u8> v(kHashSize, 0);
+    getHash(&v[0]);
     return v;
 }
 
@@ -54,6 +54,17 @@ std::string tSHA1::getHashString() const
     return hashToString(hash);
 }
 
+void tSHA1::getHash(u8* hash) const
+{
+    SHA_CTX context = *((SHA_CTX*)m_context);
+    SHA1_Final(hash, &context);
+}
+
+void tSHA1::copyFrom(const tSHA1& other)
+{
+    *((SHA_CTX*)m_context) = *((SHA_CTX*)other.m_context);
+}
+
 
 }   // namespace crypt
 }   // namespace rho
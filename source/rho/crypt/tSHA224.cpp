@@ -10,6 +10,10 @@ namespace crypt
 {
 
 
+const u32 tSHA224::kHashSize;
+const u32 tSHA224::kBlockSize;
+
+
 tSHA224::tSHA224()
     : m_context(NULL)
 {
@@ -39,12 +43,8 @@ i32 tSHA224::writeAll(const u8* buffer, i32 length)
 
 std::vector<u8> tSHA224::getHash() const
 {
-    u8 dg[SHA256_DIGEST_LENGTH];
-    SHA256_CTX context = *((SHA256_CTX*)m_context);
-    SHA224_Final(dg, &context);
-
-    std::vector<u8> v(SHA224_DIGEST_LENGTH, 0);
-    for (size_t i = 0; i < v.size(); i++) v[i] = dg[i];
+    std::vector<u8> v(kHashSize, 0);
+    getHash(&v[0]);
     return v;
 }
 
@@ -54,6 +54,17 @@ std::string tSHA224::getHashString() const
     return hashToString(hash);
 }
 
+void tSHA224::getHash(u8* hash) const
+{
+    SHA256_CTX context = *((SHA256_CTX*)m_context);
+    SHA224_Final(hash, &context);
+}
+
+void tSHA224::copyFrom(const tSHA224& other)
+{
+    *((SHA256_CTX*)m_context) = *((SHA256_CTX*)other.m_context);
+}
+
 
 }   // namespace crypt
 }   // namespace rho
@@ -10,6 +10,10 @@ namespace crypt
 {
 
 
+const u32 tSHA256::kHashSize;
+const u32 tSHA256::kBlockSize;
+
+
 tSHA256::tSHA256()
     : m_context(NULL)
 {
@@ -39,12 +43,8 @@ i32 tSHA256::writeAll(const u8* buffer, i32 length)
 
 std::vector<u8> tSHA256::getHash() const
 {
-    u8 dg[SHA256_DIGEST_LENGTH];
-    SHA256_CTX context = *((SHA256_CTX*)m_context);
-    SHA256_Final(dg, &context);
-
-    std::vector<u8> v(SHA256_DIGEST_LENGTH, 0);
-    for (size_t i = 0; i < v.size(); i++) v[i] = dg[i];
+    std::vector<u8> v(kHashSize, 0);
+    getHash(&v[0]);
     return v;
 }
 
@@ -54,6 +54,17 @@ std::string tSHA256::getHashString() const
     return hashToString(hash);
 }
 
+void tSHA256::getHash(u8* hash) const
+{
+    SHA256_CTX context = *((SHA256_CTX*)m_context);
+    SHA256_Final(hash, &context);
+}
+
+void tSHA256::copyFrom(const tSHA256& other)
+{
+    *((SHA256_CTX*)m_context) = *((SHA256_CTX*)other.m_context);
+}
+
 
 }   // namespace crypt
 }   // namespace rho
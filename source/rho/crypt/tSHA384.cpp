@@ -10,6 +10,10 @@ namespace crypt
 {
 
 
+const u32 tSHA384::kHashSize;
+const u32 tSHA384::kBlockSize;
+
+
 tSHA384::tSHA384()
     : m_context(NULL)
 {
@@ -39,12 +43,8 @@ i32 tSHA384::writeAll(const u8* buffer, i32 length)
 
 std::vector<u8> tSHA384::getHash() const
 {
-    u8 dg[SHA512_DIGEST_LENGTH];
-    SHA512_CTX context = *((SHA512_CTX*)m_context);
-    SHA384_Final(dg, &context);
-
-    std::vector<u8> v(SHA384_DIGEST_LENGTH, 0);
-    for (size_t i = 0; i < v.size(); i++) v[i] = dg[i];
+    std::vector<u8> v(kHashSize, 0);
+    getHash(&v[0]);
     return v;
 }
 
@@ -54,6 +54,17 @@ std::string tSHA384::getHashString() const
     return hashToString(hash);
 }
 
+void tSHA384::getHash(u8* hash) const
+{
+    SHA512_CTX context = *((SHA512_CTX*)m_context);
+    SHA384_Final(hash, &context);
+}
+
+void tSHA384::copyFrom(const tSHA384& other)
+{
+    *((SHA512_CTX*)m_context) = *((SHA512_CTX*)other.m_context);
+}
+
 
 }   // namespace crypt
 }   // namespace rho
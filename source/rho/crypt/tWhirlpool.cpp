@@ -10,6 +10,10 @@ namespace crypt
 {
 
 
+const u32 tWhirlpool::kHashSize;
+const u32 tWhirlpool::kBlockSize;
+
+
 tWhirlpool::tWhirlpool()
     : m_context(NULL)
 {
@@ -39,12 +43,8 @@ i32 tWhirlpool::writeAll(const u8* buffer, i32 length)
 
 std::vector<u8> tWhirlpool::getHash() const
 {
-    u8 dg[DIGESTBYTES];
-    struct NESSIEstruct context = *((struct NESSIEstruct*)m_context);
-    NESSIEfinalize(&context, dg);
-
-    std::vector<u8> v(DIGESTBYTES, 0);
-    for (size_t i = 0; i < v.size(); i++) v[i] = dg[i];
+    std::vector<u8> v(kHashSize, 0);
+    getHash(&v[0]);
     return v;
 }
 
@@ -54,6 +54,17 @@ std::string tWhirlpool::getHashString() const
     return hashToString(hash);
 }
 
+void tWhirlpool::getHash(u8* hash) const
+{
+    struct NESSIEstruct context = *((struct NESSIEstruct*)m_context);
+    NESSIEfinalize(&context, hash);
+}
+
+void tWhirlpool::copyFrom(const tWhirlpool& other)
+{
+    *((struct NESSIEstruct*)m_context) = *((struct NESSIEstruct*)other.m_context);
+}
+
 
 }   // namespace crypt
 }   // namespace rho
@@ -11,6 +11,9 @@ namespace crypt
 {
 
 
+#include "chunk_nonce.ipp"
+
+
 tWritableAES::tWritableAES(iWritable* internalStream, nOperationModeAES opmode,
              const u8 key[], nKeyLengthAES keylen)
     : m_stream(internalStream), m_buf(NULL),
@@ -27,10 +30,16 @@ tWritableAES::tWritableAES(iWritable* internalStream, nOperationModeAES opmode,
         secureRand_readAll(m_last_ct, AES_BLOCK_SIZE);
         m_hasSentInitializationVector = false;
     }
+    else if (m_opmode == kOpModeCTR || m_opmode == kOpModeGCM)
+    {
+        // Randomize the nonce
+        secureRand_readAll(m_nonce, 12);
+        m_hasSentInitializationVector = false;
+    }
 
     // Alloc stuff...
     m_bufSize = AES_BLOCK_SIZE*512;
-    m_buf = new u8[m_bufSize];
+    m_buf = new u8[m_bufSize + AES_BLOCK_SIZE];   // <-- room for the GCM tag
     m_bufUsed = 16;               // <-- the first 16 bytes are used to store:
                                   //       1. the size of the chunk (4 bytes)
                                   //       2. the sequence number of this chunk (8 bytes)
@@ -110,6 +119,18 @@ bool tWritableAES::flush()
         m_hasSentInitializationVector = true;
     }
 
+    // Same for the nonce in ctr and gcm modes, but it's sent in the clear:
+    // these modes encrypt counter blocks made from it to make the key
+    // stream, so encrypting it with the same key would give some away.
+    // (A nonce doesn't need to be secret, only unique.)
+    if ((m_opmode == kOpModeCTR || m_opmode == kOpModeGCM) && !m_hasSentInitializationVector)
+    {
+        i32 w = m_stream->writeAll(m_nonce, 12);
+        if (w != 12)
+            return false;
+        m_hasSentInitializationVector = true;
+    }
+
     // Pointer aliasing.
     u8* buf = m_buf;
 
@@ -128,6 +149,7 @@ bool tWritableAES::flush()
     buf[ 9] = (u8)((m_seq >> 16) & 0xFF);
     buf[10] = (u8)((m_seq >>  8) & 0xFF);
     buf[11] = (u8)((m_seq      ) & 0xFF);
+    u64 seq = m_seq;
     m_seq += m_bufUsed;
 
     // Store the parity of this chunk.
@@ -138,15 +160,43 @@ bool tWritableAES::flush()
     buf[14] = m_parity[2]; m_parity[2] = 0;
     buf[15] = m_parity[3]; m_parity[3] = 0;
 
-    // Randomize the end of the last block.
-    // (Removes potential predictable plain text.)
-    u32 extraBytes = (m_bufUsed % AES_BLOCK_SIZE);
-    u32 bytesToSend = (extraBytes > 0) ? (m_bufUsed + (AES_BLOCK_SIZE-extraBytes)) : (m_bufUsed);
-    if (bytesToSend > m_bufUsed)
-        secureRand_readAll(buf+m_bufUsed, bytesToSend-m_bufUsed);
-
-    // Encrypt the whole chunk.
-    m_aes.enc(buf, buf, bytesToSend/AES_BLOCK_SIZE, m_last_ct);
+    u32 bytesToSend;
+    if (m_opmode == kOpModeGCM)
+    {
+        // GCM doesn't need whole blocks. Send the length of the chunk in
+        // the clear (so the reader knows how much to read before it can
+        // check the tag), but authenticate it along with the chunk, and
+        // send the tag after the chunk.
+        u8 len[4] = { buf[0], buf[1], buf[2], buf[3] };
+        i32 w = m_stream->writeAll(len, 4);
+        if (w != 4)
+            return false;
+        u8 nonce[12];
+        s_chunkNonce(m_nonce, seq, nonce);
+        m_aes.encGCM(buf, buf, m_bufUsed, nonce, len, 4, buf+m_bufUsed);
+        bytesToSend = m_bufUsed + AES_BLOCK_SIZE;
+    }
+    else
+    {
+        // Randomize the end of the last block.
+        // (Removes potential predictable plain text.)
+        u32 extraBytes = (m_bufUsed % AES_BLOCK_SIZE);
+        bytesToSend = (extraBytes > 0) ? (m_bufUsed + (AES_BLOCK_SIZE-extraBytes)) : (m_bufUsed);
+        if (bytesToSend > m_bufUsed)
+            secureRand_readAll(buf+m_bufUsed, bytesToSend-m_bufUsed);
+
+        // Encrypt the whole chunk.
+        if (m_opmode == kOpModeCTR)
+        {
+            u8 counter[AES_BLOCK_SIZE] = { 0 };
+            s_chunkNonce(m_nonce, seq, counter);
+            m_aes.enc(buf, buf, bytesToSend/AES_BLOCK_SIZE, counter);
+        }
+        else
+        {
+            m_aes.enc(buf, buf, bytesToSend/AES_BLOCK_SIZE, m_last_ct);
+        }
+    }
 
     // Send the chunk.
     i32 r = m_stream->writeAll(buf, bytesToSend);
@@ -168,6 +218,12 @@ void tWritableAES::reset()
     m_seq = 0;
     if (m_opmode == kOpModeCBC)
         m_hasSentInitializationVector = false;
+    if (m_opmode == kOpModeCTR || m_opmode == kOpModeGCM)
+    {
+        // The sequence numbers start over, so the nonce must not.
+        secureRand_readAll(m_nonce, 12);
+        m_hasSentInitializationVector = false;
+    }
 }
 
 
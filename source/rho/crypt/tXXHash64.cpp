@@ -0,0 +1,225 @@
+#include <rho/crypt/tXXHash64.h>
+#include <rho/crypt/hash_utils.h>
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace rho
+{
+namespace crypt
+{
+
+
+const u32 tXXHash64::kHashSize;
+
+
+static const u64 kPrime1 = 0x9E3779B185EBCA87ULL;
+static const u64 kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+static const u64 kPrime3 = 0x165667B19E3779F9ULL;
+static const u64 kPrime4 = 0x85EBCA77C2B2AE63ULL;
+static const u64 kPrime5 = 0x27D4EB2F165667C5ULL;
+
+
+static inline
+u64 s_rotl(u64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+/*
+ * xxHash reads its input as little-endian words. (On a little-endian cpu
+ * the compiler turns these into plain loads.)
+ */
+static inline
+u64 s_read64(const u8* p)
+{
+    return ((u64)p[0]      ) | ((u64)p[1] <<  8) | ((u64)p[2] << 16) | ((u64)p[3] << 24) |
+           ((u64)p[4] << 32) | ((u64)p[5] << 40) | ((u64)p[6] << 48) | ((u64)p[7] << 56);
+}
+
+static inline
+u32 s_read32(const u8* p)
+{
+    return ((u32)p[0]) | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static inline
+u64 s_round(u64 acc, u64 input)
+{
+    acc += input * kPrime2;
+    acc = s_rotl(acc, 31);
+    return acc * kPrime1;
+}
+
+static inline
+u64 s_mergeRound(u64 acc, u64 v)
+{
+    acc ^= s_round(0, v);
+    return acc * kPrime1 + kPrime4;
+}
+
+
+/*
+ * Runs whole 32-byte stripes through the accumulators. Returns how many
+ * bytes it used.
+ */
+static
+u32 s_stripes(u64 v[4], const u8* p, u32 len)
+{
+    u64 v1 = v[0], v2 = v[1], v3 = v[2], v4 = v[3];
+    u32 used = 0;
+    for (; len - used >= 32; used += 32)
+    {
+        v1 = s_round(v1, s_read64(p + used));
+        v2 = s_round(v2, s_read64(p + used + 8));
+        v3 = s_round(v3, s_read64(p + used + 16));
+        v4 = s_round(v4, s_read64(p + used + 24));
+    }
+    v[0] = v1; v[1] = v2; v[2] = v3; v[3] = v4;
+    return used;
+}
+
+static
+void s_init(u64 v[4], u64 seed)
+{
+    v[0] = seed + kPrime1 + kPrime2;
+    v[1] = seed + kPrime2;
+    v[2] = seed;
+    v[3] = seed - kPrime1;
+}
+
+/*
+ * Folds the accumulators (or, for short inputs, just the seed), the total
+ * length and the last (less than 32) bytes into the final hash.
+ */
+static
+u64 s_finish(const u64 v[4], u64 seed, u64 totalLen, const u8* p, u32 len)
+{
+    u64 h;
+    if (totalLen >= 32)
+    {
+        h = s_rotl(v[0], 1) + s_rotl(v[1], 7) + s_rotl(v[2], 12) + s_rotl(v[3], 18);
+        h = s_mergeRound(h, v[0]);
+        h = s_mergeRound(h, v[1]);
+        h = s_mergeRound(h, v[2]);
+        h = s_mergeRound(h, v[3]);
+    }
+    else
+    {
+        h = seed + kPrime5;
+    }
+
+    h += totalLen;
+
+    u32 i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        h ^= s_round(0, s_read64(p + i));
+        h = s_rotl(h, 27) * kPrime1 + kPrime4;
+    }
+    if (i + 4 <= len)
+    {
+        h ^= (u64)s_read32(p + i) * kPrime1;
+        h = s_rotl(h, 23) * kPrime2 + kPrime3;
+        i += 4;
+    }
+    for (; i < len; i++)
+    {
+        h ^= p[i] * kPrime5;
+        h = s_rotl(h, 11) * kPrime1;
+    }
+
+    h ^= h >> 33;
+    h *= kPrime2;
+    h ^= h >> 29;
+    h *= kPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+
+u64 xxhash64(const u8* buffer, u32 length, u64 seed)
+{
+    if (buffer == NULL && length > 0)
+        throw eNullPointer("buffer may not be null");
+
+    u64 v[4];
+    s_init(v, seed);
+    u32 used = s_stripes(v, buffer, length);
+    return s_finish(v, seed, length, buffer + used, length - used);
+}
+
+
+tXXHash64::tXXHash64()
+    : m_seed(0),
+      m_totalLen(0),
+      m_bufUsed(0)
+{
+    s_init(m_v, m_seed);
+}
+
+tXXHash64::tXXHash64(u64 seed)
+    : m_seed(seed),
+      m_totalLen(0),
+      m_bufUsed(0)
+{
+    s_init(m_v, m_seed);
+}
+
+i32 tXXHash64::write(const u8* buffer, i32 length)
+{
+    return this->writeAll(buffer, length);
+}
+
+i32 tXXHash64::writeAll(const u8* buffer, i32 length)
+{
+    if (length <= 0)
+        throw eInvalidArgument("Stream read/write length must be >0");
+
+    u32 len = (u32)length;
+    m_totalLen += len;
+
+    // Top up a partial stripe first.
+    if (m_bufUsed > 0)
+    {
+        u32 n = std::min(len, 32 - m_bufUsed);
+        memcpy(m_buf + m_bufUsed, buffer, n);
+        m_bufUsed += n;
+        buffer += n;
+        len -= n;
+        if (m_bufUsed < 32)
+            return length;
+        s_stripes(m_v, m_buf, 32);
+        m_bufUsed = 0;
+    }
+
+    u32 used = s_stripes(m_v, buffer, len);
+    memcpy(m_buf, buffer + used, len - used);
+    m_bufUsed = len - used;
+    return length;
+}
+
+std::vector<u8> tXXHash64::getHash() const
+{
+    u64 h = getHash64();
+    std::vector<u8> v(kHashSize, 0);
+    for (u32 i = 0; i < kHashSize; i++)
+        v[i] = (u8)((h >> (56 - 8*i)) & 0xFF);
+    return v;
+}
+
+std::string tXXHash64::getHashString() const
+{
+    std::vector<u8> hash = getHash();
+    return hashToString(hash);
+}
+
+u64 tXXHash64::getHash64() const
+{
+    return s_finish(m_v, m_seed, m_totalLen, m_buf, m_bufUsed);
+}
+
+
+}   // namespace crypt
+}   // namespace rho
@@ -313,9 +313,7 @@ void unpack(iReadable* in, f64& x)
 
 void pack(iWritable* out, const std::string& str)
 {
-    pack(out, (u64)str.length());
-    for (size_t i = 0; i < str.length(); i++)
-        pack(out, (u8)str[i]);
+    packBytes(out, (const u8*)str.data(), (u64)str.length());
 }
 
 void unpack(iReadable* in, std::string& str, u64 maxlen)
@@ -343,5 +341,48 @@ void unpack(iReadable* in, iPackable& packable)
     packable.unpack(in);
 }
 
+void packBytes(iWritable* out, const u8* buffer, u64 length)
+{
+    u8 header[8];
+    for (int i = 0; i < 8; i++)
+        header[i] = (u8)((length >> (56 - 8*i)) & 0xFF);
+
+    tConstIoVec bufs[2];
+    bufs[0].base = header;
+    bufs[0].length = 8;
+
+    // The first write carries the length; the bytes follow in pieces
+    // that keep each write's total within an i32.
+    u64 w = 0;
+    i32 max = 0x7FFFFFFF - 8;
+    do
+    {
+        i32 here = (length - w > (u64)max) ? max : (i32)(length - w);
+        bufs[1].base = buffer + w;
+        bufs[1].length = here;
+        i32 total = bufs[0].length + here;
+        if (out->writeAllv(bufs, 2) != total)
+            throw eBufferOverflow("Cannot pack to the given output stream.");
+        w += (u64)here;
+        bufs[0].length = 0;
+        max = 0x7FFFFFFF;
+    }
+    while (w < length);
+}
+
+u8* unpackView(tMmapReadable* in, u64& length, u64 maxlen)
+{
+    if (in == NULL)
+        throw eNullPointer("in must not be NULL.");
+    u64 size; unpack(in, size);
+    if (size > maxlen)
+        throw eBufferOverflow("Unpacking a view: the max length was exceeded!");
+    u8* view = in->borrow(size);
+    if (view == NULL)
+        throw eBufferUnderflow("Cannot unpack from the given input stream.");
+    length = size;
+    return view;
+}
+
 
 }   // namespace rho
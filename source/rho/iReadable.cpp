@@ -8,11 +8,49 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#if __linux__ || __APPLE__ || __CYGWIN__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#elif __MINGW32__
+#include <windows.h>
+#else
+#error What platform are you on!?
+#endif
+
 
 namespace rho
 {
 
 
+i32 iReadable::readv(const tIoVec* bufs, i32 count)
+{
+    ioVecLength(bufs, count);
+    i32 i = 0;
+    while (bufs[i].length == 0)
+        i++;
+    return read(bufs[i].base, bufs[i].length);
+}
+
+i32 iReadable::readAllv(const tIoVec* bufs, i32 count)
+{
+    i32 length = ioVecLength(bufs, count);
+
+    std::vector<tIoVec> rem(bufs, bufs+count);
+    size_t first = 0;
+
+    i32 amountRead = 0;
+    while (amountRead < length)
+    {
+        i32 n = readv(&rem[first], (i32)(rem.size()-first));
+        if (n <= 0)
+            return (amountRead>0) ? amountRead : n;
+        amountRead += n;
+        ioVecAdvance(rem, first, n);
+    }
+    return amountRead;
+}
+
+
 tBufferedReadable::tBufferedReadable(
         iReadable* internalStream, u32 bufSize)
     : m_stream(internalStream), m_buf(NULL),
@@ -166,5 +204,228 @@ std::string tFileReadable::getFilename() const
     return m_filename;
 }
 
+int tFileReadable::getFileDescriptor()
+{
+    #if __linux__ || __APPLE__ || __CYGWIN__
+    return fileno(m_file);
+    #elif __MINGW32__
+    return _fileno(m_file);
+    #else
+    #error What platform are you on!?
+    #endif
+}
+
+u64 tFileReadable::getPosition()
+{
+    #if __linux__ || __APPLE__ || __CYGWIN__
+    off_t pos = ftello(m_file);
+    #elif __MINGW32__
+    __int64 pos = _ftelli64(m_file);
+    #else
+    #error What platform are you on!?
+    #endif
+    if (pos < 0)
+    {
+        std::ostringstream out;
+        out << "Cannot get the position in [" << m_filename << "] (error: " << strerror(errno);
+        throw eRuntimeError(out.str());
+    }
+    return (u64)pos;
+}
+
+void tFileReadable::setPosition(u64 position)
+{
+    #if __linux__ || __APPLE__ || __CYGWIN__
+    int r = fseeko(m_file, (off_t)position, SEEK_SET);
+    #elif __MINGW32__
+    int r = _fseeki64(m_file, (__int64)position, SEEK_SET);
+    #else
+    #error What platform are you on!?
+    #endif
+    if (r != 0)
+    {
+        std::ostringstream out;
+        out << "Cannot seek in [" << m_filename << "] (error: " << strerror(errno);
+        throw eRuntimeError(out.str());
+    }
+    m_eof = false;
+}
+
+
+static const u64 kPrefetchWindow = 4*1024*1024;
+
+
+tMmapReadable::tMmapReadable(std::string filename)
+    : m_filename(filename), m_data(NULL), m_size(0), m_pos(0),
+      m_prefetchedTo(0), m_eof(false)
+{
+    #if __linux__ || __APPLE__ || __CYGWIN__
+    int fd = open(filename.c_str(), O_RDONLY|O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        int err = errno;
+        if (fd >= 0)
+            close(fd);
+        std::ostringstream out;
+        out << "Cannot open [" << filename << "] for reading (error: " << strerror(err);
+        throw eRuntimeError(out.str());
+    }
+    m_size = (u64)st.st_size;
+    if (m_size > 0)
+    {
+        // Private and writable, so borrowed bytes are copy-on-write.
+        void* data = mmap(NULL, (size_t)m_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+        {
+            int err = errno;
+            close(fd);
+            std::ostringstream out;
+            out << "Cannot map [" << filename << "] (error: " << strerror(err);
+            throw eRuntimeError(out.str());
+        }
+        m_data = (u8*)data;
+        madvise(data, (size_t)m_size, MADV_SEQUENTIAL);
+    }
+    close(fd);        // the mapping keeps the file open
+    #elif __MINGW32__
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size))
+    {
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        std::ostringstream out;
+        out << "Cannot open [" << filename << "] for reading (error: " << GetLastError();
+        throw eRuntimeError(out.str());
+    }
+    m_size = (u64)size.QuadPart;
+    if (m_size > 0)
+    {
+        // Copy-on-write, so borrowed bytes may be modified.
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        void* data = (mapping != NULL) ? MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0) : NULL;
+        if (mapping != NULL)
+            CloseHandle(mapping);    // the view keeps the mapping alive
+        if (data == NULL)
+        {
+            CloseHandle(file);
+            std::ostringstream out;
+            out << "Cannot map [" << filename << "] (error: " << GetLastError();
+            throw eRuntimeError(out.str());
+        }
+        m_data = (u8*)data;
+    }
+    CloseHandle(file);
+    #else
+    #error What platform are you on!?
+    #endif
+}
+
+tMmapReadable::~tMmapReadable()
+{
+    if (m_data)
+    {
+        #if __linux__ || __APPLE__ || __CYGWIN__
+        munmap(m_data, (size_t)m_size);
+        #elif __MINGW32__
+        UnmapViewOfFile(m_data);
+        #else
+        #error What platform are you on!?
+        #endif
+    }
+    m_data = NULL;
+    m_size = 0;
+    m_pos = 0;
+}
+
+i32 tMmapReadable::read(u8* buffer, i32 length)
+{
+    if (length <= 0)
+        throw eInvalidArgument("Stream read/write length must be >0");
+
+    if (m_pos >= m_size)
+        return m_eof ? -1 : ((m_eof = true), 0);
+
+    u64 rem = m_size - m_pos;
+    if (rem > (u64)length)
+        rem = (u64)length;
+    m_prefetch(m_pos, rem);
+    memcpy(buffer, m_data+m_pos, (size_t)rem);
+    m_pos += rem;
+    return (i32)rem;
+}
+
+i32 tMmapReadable::readAll(u8* buffer, i32 length)
+{
+    i32 i = read(buffer, length);
+    if (i < length)       // readAll() is defined to have different behavior than read(),
+        m_eof = true;     // thus this extra logic here.
+    return i;
+}
+
+std::string tMmapReadable::getFilename() const
+{
+    return m_filename;
+}
+
+u64 tMmapReadable::getSize() const
+{
+    return m_size;
+}
+
+u64 tMmapReadable::getPosition() const
+{
+    return m_pos;
+}
+
+void tMmapReadable::setPosition(u64 position)
+{
+    if (position > m_size)
+        throw eInvalidArgument("Cannot set the position past the end of the file.");
+    m_pos = position;
+    m_prefetchedTo = position;
+    m_eof = false;
+}
+
+u8* tMmapReadable::borrow(u64 length)
+{
+    if (m_pos > m_size || length > m_size - m_pos)
+        return NULL;
+    u8* p = m_data + m_pos;
+    m_prefetch(m_pos, length);
+    m_pos += length;
+    return p;
+}
+
+void tMmapReadable::m_prefetch(u64 position, u64 length)
+{
+    // Each time reading gets near the end of what was prefetched, ask
+    // for the next window (or for the whole range being read, if that's
+    // bigger).
+    u64 end = position + length;
+    if (end + kPrefetchWindow/2 <= m_prefetchedTo)
+        return;
+    u64 from = (position > m_prefetchedTo) ? position : m_prefetchedTo;
+    u64 to = end + kPrefetchWindow;
+    if (to > m_size)
+        to = m_size;
+    if (from >= to)
+        return;
+
+    #if __linux__ || __APPLE__ || __CYGWIN__
+    static const u64 kPageMask = (u64)sysconf(_SC_PAGESIZE) - 1;
+    u64 alignedFrom = from & ~kPageMask;
+    madvise(m_data + alignedFrom, (size_t)(to - alignedFrom), MADV_WILLNEED);
+    #elif __MINGW32__
+    // Nothing cheap to do here; the page faults will read the file in.
+    #else
+    #error What platform are you on!?
+    #endif
+
+    m_prefetchedTo = to;
+}
+
 
 }   // namespace rho
@@ -9,11 +9,49 @@
 #include <unistd.h>
 #include <sys/stat.h>
 
+#if __linux__ || __APPLE__ || __CYGWIN__
+#include <sys/uio.h>
+#endif
+
 
 namespace rho
 {
 
 
+#if __linux__ || __APPLE__ || __CYGWIN__
+static const int kMaxIoVecs = 64;      // well under IOV_MAX everywhere
+#endif
+
+
+i32 iWritable::writev(const tConstIoVec* bufs, i32 count)
+{
+    ioVecLength(bufs, count);
+    i32 i = 0;
+    while (bufs[i].length == 0)
+        i++;
+    return write(bufs[i].base, bufs[i].length);
+}
+
+i32 iWritable::writeAllv(const tConstIoVec* bufs, i32 count)
+{
+    i32 length = ioVecLength(bufs, count);
+
+    std::vector<tConstIoVec> rem(bufs, bufs+count);
+    size_t first = 0;
+
+    i32 amountWritten = 0;
+    while (amountWritten < length)
+    {
+        i32 n = writev(&rem[first], (i32)(rem.size()-first));
+        if (n <= 0)
+            return (amountWritten>0) ? amountWritten : n;
+        amountWritten += n;
+        ioVecAdvance(rem, first, n);
+    }
+    return amountWritten;
+}
+
+
 tBufferedWritable::tBufferedWritable(
         iWritable* internalStream, u32 bufSize)
     : m_stream(internalStream), m_buf(NULL),
@@ -74,6 +112,54 @@ i32 tBufferedWritable::writeAll(const u8* buffer, i32 length)
     return amountWritten;
 }
 
+i32 tBufferedWritable::writev(const tConstIoVec* bufs, i32 count)
+{
+    i32 length = ioVecLength(bufs, count);
+
+    if ((u64)m_bufUsed + (u64)length <= (u64)m_bufSize)
+    {
+        for (i32 i = 0; i < count; i++)
+        {
+            if (bufs[i].length == 0)
+                continue;
+            memcpy(m_buf+m_bufUsed, bufs[i].base, bufs[i].length);
+            m_bufUsed += (u32)bufs[i].length;
+        }
+        return length;
+    }
+
+    if ((u64)m_bufUsed + (u64)length > 0x7FFFFFFF)
+        if (! flush())    // <-- if successful, resets m_bufUsed to 0
+            return 0;
+
+    std::vector<tConstIoVec> all;
+    all.reserve((size_t)count + 1);
+    if (m_bufUsed > 0)
+    {
+        tConstIoVec buffered;
+        buffered.base = m_buf;
+        buffered.length = (i32)m_bufUsed;
+        all.push_back(buffered);
+    }
+    all.insert(all.end(), bufs, bufs+count);
+
+    i32 buffered = (i32)m_bufUsed;
+    i32 w = m_stream->writeAllv(&all[0], (i32)all.size());
+    if (w < buffered)
+    {
+        // Only some of the buffered bytes went out; keep the rest
+        // (and only the rest) for the next flush().
+        if (w > 0)
+        {
+            memmove(m_buf, m_buf+w, m_bufUsed-(u32)w);
+            m_bufUsed -= (u32)w;
+        }
+        return 0;
+    }
+    m_bufUsed = 0;
+    return w - buffered;
+}
+
 bool tBufferedWritable::flush()
 {
     if (m_bufUsed == 0)
@@ -158,6 +244,66 @@ i32 tFileWritable::writeAll(const u8* buffer, i32 length)
     return amountWritten;
 }
 
+i32 tFileWritable::writev(const tConstIoVec* bufs, i32 count)
+{
+    i32 length = ioVecLength(bufs, count);
+
+    if (m_writeEOF)
+        return 0;
+
+    #if __linux__ || __APPLE__ || __CYGWIN__
+    if (length >= BUFSIZ)
+    {
+        if (fflush(m_file) != 0)
+        {
+            m_writeEOF = true;
+            return 0;
+        }
+
+        struct iovec vecs[kMaxIoVecs];
+        int numVecs = 0;
+        for (i32 i = 0; i < count && numVecs < kMaxIoVecs; i++)
+        {
+            if (bufs[i].length == 0)
+                continue;
+            vecs[numVecs].iov_base = const_cast<u8*>(bufs[i].base);
+            vecs[numVecs].iov_len = (size_t)bufs[i].length;
+            numVecs++;
+        }
+
+        ssize_t w;
+        do {
+            w = ::writev(fileno(m_file), vecs, numVecs);
+        } while (w < 0 && errno == EINTR);
+        if (w > 0)
+            return (i32)w;
+
+        m_writeEOF = true;
+        return 0;
+    }
+    #elif __MINGW32__
+    // No writev(); stdio will have to do.
+    #else
+    #error What platform are you on!?
+    #endif
+
+    i32 amountWritten = 0;
+    for (i32 i = 0; i < count; i++)
+    {
+        if (bufs[i].length == 0)
+            continue;
+        size_t w = fwrite(bufs[i].base, 1, bufs[i].length, m_file);
+        amountWritten += (i32)w;
+        if (w < (size_t)bufs[i].length)
+            break;
+    }
+    if (amountWritten > 0)
+        return amountWritten;
+
+    m_writeEOF = true;
+    return 0;
+}
+
 bool tFileWritable::flush()
 {
     return (fflush(m_file) == 0);
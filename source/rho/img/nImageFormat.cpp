@@ -6,6 +6,7 @@
 #include <rho/img/ebImg.h>
 
 #include <string.h>
+#include <vector>
 
 
 namespace rho
@@ -30,6 +31,10 @@ u32 getBPP(nImageFormat format)
             return 2;
         case kGrey:
             return 1;
+        case kI420:
+        case kNV12:
+        case kRGBPlanar:
+            throw eInvalidArgument("Planar formats have no bytes per pixel; use getBufSize().");
         default:
             throw eInvalidArgument("Invalid format given. Cannot return the correct bpp.");
     }
@@ -52,195 +57,383 @@ u32 getBitsPP(nImageFormat format)
             return 16;
         case kGrey:
             return 8;
+        case kI420:
+            return 12;
+        case kNV12:
+            return 12;
+        case kRGBPlanar:
+            return 24;
         default:
             throw eInvalidArgument("Invalid format given. Cannot return the correct bpp.");
     }
 }
 
 
+bool isPlanar(nImageFormat format)
+{
+    return format == kI420 || format == kNV12 || format == kRGBPlanar;
+}
+
+
+u32 getBufSize(nImageFormat format, u32 width, u32 height)
+{
+    switch (format)
+    {
+        case kI420:
+        case kNV12:
+            if ((width % 2) || (height % 2))
+                throw eInvalidArgument("kI420 and kNV12 images must have an even width and height.");
+            return width * height + 2 * (width/2) * (height/2);
+        case kRGBPlanar:
+            return width * height * 3;
+        default:
+            return width * height * getBPP(format);
+    }
+}
+
+
 static inline
-u8 clip(double val)
+u8 clip(i32 val)
 {
-    if (val > 255.0)
+    if (val > 255)
         return 255;
-    else if (val < 0.0)
+    else if (val < 0)
         return 0;
     return (u8)val;
 }
 
 
-static
-i32 no_conversion(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
+/*
+ * The conversions below use fixed-point math with 'kShift' fractional
+ * bits, so that the SIMD kernels (see nImageFormat_x86.ipp) can produce
+ * exactly the same bytes as the scalar kernels here. The scalar kernels
+ * are the reference; a SIMD kernel which disagrees with them is wrong.
+ *
+ * Right shifts of negative values round toward -infinity, which matches
+ * the truncation (and clipping to zero) the old floating-point code did
+ * for results in range.
+ */
+static const i32 kShift = 14;
+
+// yuv -> rgb
+//   standard: r = y + 1.402000*(v-128)
+//   standard: g = y - 0.344140*(u-128) - 0.714140*(v-128)
+//   standard: b = y + 1.772000*(u-128)
+//   logitech: r = y + 1.370705*(v-128)
+//   logitech: g = y - 0.337633*(u-128) - 0.698001*(v-128)
+//   logitech: b = y + 1.732446*(u-128)
+static const i32 kRV = 22970;     // 1.402000 * 2^14
+static const i32 kGU = 5638;      // 0.344140 * 2^14
+static const i32 kGV = 11700;     // 0.714140 * 2^14
+static const i32 kBU = 29032;     // 1.772000 * 2^14
+
+// rgb -> yuv
+//   y = 0.299*r + 0.587*g + 0.114*b
+//   u = -0.147*r - 0.289*g + 0.436*b + 128
+//   v = 0.615*r - 0.515*g - 0.100*b + 128
+// (rounded so that each row still sums to exactly 1.0 or 0.0)
+static const i32 kYR = 4899;      // 0.299 * 2^14
+static const i32 kYG = 9617;      // 0.587 * 2^14
+static const i32 kYB = 1868;      // 0.114 * 2^14
+static const i32 kUR = 2408;      // 0.147 * 2^14
+static const i32 kUG = 4735;      // 0.289 * 2^14
+static const i32 kUB = 7143;      // 0.436 * 2^14
+static const i32 kVR = 10076;     // 0.615 * 2^14
+static const i32 kVG = 8438;      // 0.515 * 2^14
+static const i32 kVB = 1638;      // 0.100 * 2^14
+
+
+/*
+ * Converts one yuyv macro-pixel (two pixels) to rgb. 'ri', 'gi' and 'bi'
+ * are the offsets of the channels in the destination pixels, and 'bpp'
+ * is the size of a destination pixel.
+ */
+static inline
+void s_yuyv_to_rgb(const u8* yuyv, u8* dest, i32 ri, i32 gi, i32 bi, i32 bpp)
 {
-    if (destSize < sourceSize)
-        throw eBufferOverflow("You're doing it wrong.");
-    memcpy(dest, source, sourceSize);
-    return sourceSize;
+    i32 du = yuyv[1] - 128;
+    i32 dv = yuyv[3] - 128;
+    i32 cr = (kRV*dv) >> kShift;
+    i32 cg = (-kGU*du - kGV*dv) >> kShift;
+    i32 cb = (kBU*du) >> kShift;
+    for (i32 i = 0; i < 2; i++)
+    {
+        i32 y = yuyv[2*i];
+        dest[ri] = clip(y + cr);
+        dest[gi] = clip(y + cg);
+        dest[bi] = clip(y + cb);
+        dest += bpp;
+    }
+}
+
+
+/*
+ * Converts two rgb pixels to one yuyv macro-pixel. The chroma is the
+ * average of the two pixels' chroma.
+ */
+static inline
+void s_rgb_to_yuyv(i32 r0, i32 g0, i32 b0, i32 r1, i32 g1, i32 b1, u8* yuyv)
+{
+    i32 r = r0 + r1;
+    i32 g = g0 + g1;
+    i32 b = b0 + b1;
+    yuyv[0] = clip((kYR*r0 + kYG*g0 + kYB*b0) >> kShift);
+    yuyv[1] = clip(((-kUR*r - kUG*g + kUB*b) >> (kShift+1)) + 128);
+    yuyv[2] = clip((kYR*r1 + kYG*g1 + kYB*b1) >> kShift);
+    yuyv[3] = clip(((kVR*r - kVG*g - kVB*b) >> (kShift+1)) + 128);
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// The scalar kernels. Each converts 'numPixels' pixels and trusts that the
+// buffers are big enough. (Those which produce or consume yuyv are only
+// ever given an even number of pixels.)
+////////////////////////////////////////////////////////////////////////////////
+
 static
-i32 yuyv_to_rgb24(u8* yuyv, i32 yuyvSize,
-                  u8* rgb, i32 rgbSize)
+void yuyv_to_rgb24_scalar(const u8* yuyv, u8* rgb, i32 numPixels)
 {
-    // yuyv images use four bytes to describe two pixels.
-    // rgb images use three bytes to describe one pixel.
+    for (i32 i = 0; i < numPixels; i += 2)
+        s_yuyv_to_rgb(yuyv + 2*i, rgb + 3*i, 0, 1, 2, 3);
+}
 
-    if (yuyvSize % 4)
+static
+void yuyv_to_rgba_scalar(const u8* yuyv, u8* rgba, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i += 2)
     {
-        throw eColorspaceConversionError(
-                "The yuyv image buffer has an incorrect size");
+        s_yuyv_to_rgb(yuyv + 2*i, rgba + 4*i, 0, 1, 2, 4);
+        rgba[4*i+3] = 255;
+        rgba[4*i+7] = 255;
     }
+}
 
-    i32 numPixels = yuyvSize / 2;
-
-    if (rgbSize < numPixels * 3)
+static
+void yuyv_to_bgra_scalar(const u8* yuyv, u8* bgra, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i += 2)
     {
-        throw eBufferOverflow(
-                "The supplied rgb buffer cannot hold the image described by "
-                "the supplied yuyv buffer.");
+        s_yuyv_to_rgb(yuyv + 2*i, bgra + 4*i, 2, 1, 0, 4);
+        bgra[4*i+3] = 255;
+        bgra[4*i+7] = 255;
     }
+}
+
+static
+void yuyv_to_grey_scalar(const u8* yuyv, u8* grey, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i++)
+        grey[i] = yuyv[2*i];
+}
 
-    for(i32 i = 0; i < yuyvSize; i += 4)
+static
+void rgb24_to_yuyv_scalar(const u8* rgb, u8* yuyv, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i += 2)
     {
-        u8 y0 = yuyv[i+0];
-        u8 u  = yuyv[i+1];
-        u8 y1 = yuyv[i+2];
-        u8 v  = yuyv[i+3];
+        const u8* p = rgb + 3*i;
+        s_rgb_to_yuyv(p[0], p[1], p[2], p[3], p[4], p[5], yuyv + 2*i);
+    }
+}
 
-        /* standard: r0 = y0 + 1.402000*(v-128) */
-        /* logitech: r0 = y0 + 1.370705*(v-128) */
-        *rgb++ = clip(y0 + 1.402000*(v-128));
+static
+void rgba_to_yuyv_scalar(const u8* rgba, u8* yuyv, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i += 2)
+    {
+        const u8* p = rgba + 4*i;
+        s_rgb_to_yuyv(p[0], p[1], p[2], p[4], p[5], p[6], yuyv + 2*i);
+    }
+}
 
-        /* standard: g0 = y0 - 0.344140*(u-128) - 0.714140*(v-128) */
-        /* logitech: g0 = y0 - 0.337633*(u-128) - 0.698001*(v-128) */
-        *rgb++ = clip(y0 - 0.344140*(u-128) - 0.714140*(v-128));
+static
+void bgra_to_yuyv_scalar(const u8* bgra, u8* yuyv, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i += 2)
+    {
+        const u8* p = bgra + 4*i;
+        s_rgb_to_yuyv(p[2], p[1], p[0], p[6], p[5], p[4], yuyv + 2*i);
+    }
+}
 
-        /* standard: b0 = y0 + 1.772000*(u-128) */
-        /* logitech: b0 = y0 + 1.732446*(u-128) */
-        *rgb++ = clip(y0 + 1.772000*(u-128));
+static
+void grey_to_yuyv_scalar(const u8* grey, u8* yuyv, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i += 2)
+    {
+        i32 p0 = grey[i];
+        i32 p1 = grey[i+1];
+        s_rgb_to_yuyv(p0, p0, p0, p1, p1, p1, yuyv + 2*i);
+    }
+}
 
-        /* standard: r1 = y1 + 1.402000*(v-128) */
-        /* logitech: r1 = y1 + 1.370705*(v-128) */
-        *rgb++ = clip(y1 + 1.402000*(v-128));
+static
+void rgb24_to_grey_scalar(const u8* rgb, u8* grey, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i++)
+    {
+        i32 r = *rgb++;
+        i32 g = *rgb++;
+        i32 b = *rgb++;
 
-        /* standard: g1 = y1 - 0.344140*(u-128) - 0.714140*(v-128) */
-        /* logitech: g1 = y1 - 0.337633*(u-128) - 0.698001*(v-128) */
-        *rgb++ = clip(y1 - 0.344140*(u-128) - 0.714140*(v-128));
+        // Also try:
+        //u8 avg = (std::max(std::max(r,g),b) + std::min(std::min(r,g),b)) / 2.0;
+        //u8 avg = 0.21*r + 0.71*g + 0.07*b;
 
-        /* standard: b1 = y1 + 1.772000*(u-128) */
-        /* logitech: b1 = y1 + 1.732446*(u-128) */
-        *rgb++ = clip(y1 + 1.772000*(u-128));
+        grey[i] = (u8) ((r + g + b) / 3);
     }
-
-    return numPixels * 3;
 }
 
-
+// (for rgba and bgra; the alpha is ignored)
 static
-i32 rgb24_to_yuyv(u8* rgb, i32 rgbSize,
-                  u8* yuyv, i32 yuyvSize)
+void rgbx_to_grey_scalar(const u8* rgbx, u8* grey, i32 numPixels)
 {
-    if (rgbSize % 3)
+    for (i32 i = 0; i < numPixels; i++)
     {
-        throw eColorspaceConversionError(
-                "The rgb image buffer has an incorrect size");
+        const u8* p = rgbx + 4*i;
+        grey[i] = (u8) ((p[0] + p[1] + p[2]) / 3);
     }
+}
 
-    i32 numPixels = rgbSize / 3;
-
-    if (numPixels % 2)
+static
+void grey_to_rgb24_scalar(const u8* grey, u8* rgb, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i++)
     {
-        throw eColorspaceConversionError(
-                "A yuyv image must have a multiple of two number of pixels.");
+        u8 pix = grey[i];
+        *rgb++ = pix;
+        *rgb++ = pix;
+        *rgb++ = pix;
     }
+}
 
-    if (yuyvSize < numPixels * 2)
+// (for rgba and bgra)
+static
+void grey_to_rgbx_scalar(const u8* grey, u8* rgbx, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i++)
     {
-        throw eBufferOverflow(
-                "The supplied yuyv buffer cannot hold the image described by "
-                "the supplied rgb buffer.");
+        u8 pix = grey[i];
+        *rgbx++ = pix;
+        *rgbx++ = pix;
+        *rgbx++ = pix;
+        *rgbx++ = 255;
     }
+}
 
-    for (i32 i = 0; i < rgbSize; i += 6)
+static
+void rgb24_to_rgba_scalar(const u8* rgb, u8* rgba, i32 numPixels)
+{
+    for (i32 i = 0; i < numPixels; i++)
     {
-        u8 r0 = rgb[i+0];
-        u8 g0 = rgb[i+1];
-        u8 b0 = rgb[i+2];
-        u8 r1 = rgb[i+3];
-        u8 g1 = rgb[i+4];
-        u8 b1 = rgb[i+5];
-
-        *yuyv++ = clip(0.299 * (r0 - 128) + 0.587 * (g0 - 128) + 0.114 * (b0 - 128) + 128);
-        *yuyv++ = clip(((- 0.147 * (r0 - 128) - 0.289 * (g0 - 128) + 0.436 * (b0 - 128) + 128) +
-                       (- 0.147 * (r1 - 128) - 0.289 * (g1 - 128) + 0.436 * (b1 - 128) + 128))/2);
-        *yuyv++ = clip(0.299 * (r1 - 128) + 0.587 * (g1 - 128) + 0.114 * (b1 - 128) + 128);
-        *yuyv++ = clip(((0.615 * (r0 - 128) - 0.515 * (g0 - 128) - 0.100 * (b0 - 128) + 128) +
-                       (0.615 * (r1 - 128) - 0.515 * (g1 - 128) - 0.100 * (b1 - 128) + 128))/2);
+        *rgba++ = rgb[3*i+0];
+        *rgba++ = rgb[3*i+1];
+        *rgba++ = rgb[3*i+2];
+        *rgba++ = 255;
     }
-
-    return numPixels * 2;
 }
 
-
 static
-i32 rgb16_to_rgb24(u8* source, i32 sourceSize,
-                   u8* dest, i32 destSize)
+void rgb24_to_bgra_scalar(const u8* rgb, u8* bgra, i32 numPixels)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    for (i32 i = 0; i < numPixels; i++)
+    {
+        *bgra++ = rgb[3*i+2];
+        *bgra++ = rgb[3*i+1];
+        *bgra++ = rgb[3*i+0];
+        *bgra++ = 255;
+    }
 }
 
-
 static
-i32 rgb16_to_rgba(u8* source, i32 sourceSize,
-                   u8* dest, i32 destSize)
+void rgba_to_rgb24_scalar(const u8* rgba, u8* rgb, i32 numPixels)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    for (i32 i = 0; i < numPixels; i++)
+    {
+        *rgb++ = rgba[4*i+0];
+        *rgb++ = rgba[4*i+1];
+        *rgb++ = rgba[4*i+2];
+    }
 }
 
-
 static
-i32 rgb16_to_yuyv(u8* source, i32 sourceSize,
-                   u8* dest, i32 destSize)
+void bgra_to_rgb24_scalar(const u8* bgra, u8* rgb, i32 numPixels)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    for (i32 i = 0; i < numPixels; i++)
+    {
+        *rgb++ = bgra[4*i+2];
+        *rgb++ = bgra[4*i+1];
+        *rgb++ = bgra[4*i+0];
+    }
 }
 
-
+// (rgba -> bgra and bgra -> rgba)
 static
-i32 rgb24_to_rgb16(u8* source, i32 sourceSize,
-                   u8* dest, i32 destSize)
+void swap_rb_scalar(const u8* source, u8* dest, i32 numPixels)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    for (i32 i = 0; i < numPixels; i++)
+    {
+        u8 c0 = source[4*i+0];
+        u8 c1 = source[4*i+1];
+        u8 c2 = source[4*i+2];
+        u8 c3 = source[4*i+3];
+        *dest++ = c2;
+        *dest++ = c1;
+        *dest++ = c0;
+        *dest++ = c3;
+    }
 }
 
 
+#if __i386__ || __x86_64__
+#include "nImageFormat_x86.ipp"
+#define X86_KERNEL(f) f
+#else
+#define X86_KERNEL(f) NULL
+#endif
+
+
+typedef void (*tKernel)(const u8* source, u8* dest, i32 numPixels);
+
+
+/*
+ * Picks the best kernel allowed by 'level'. A NULL kernel means that
+ * instruction set has nothing over the level below it.
+ */
 static
-i32 rgb24_to_rgba(u8* source, i32 sourceSize,
-                   u8* dest, i32 destSize)
+tKernel s_choose(nSimdLevel level, tKernel scalar, tKernel sse2, tKernel ssse3, tKernel avx2)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    if (level >= kSimdAVX2 && avx2)
+        return avx2;
+    if (level >= kSimdSSSE3 && ssse3)
+        return ssse3;
+    if (level >= kSimdSSE2 && sse2)
+        return sse2;
+    return scalar;
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+// The conversion functions. These check the buffer sizes, then run the
+// kernel.
+////////////////////////////////////////////////////////////////////////////////
+
 static
-i32 rgba_to_rgb16(u8* source, i32 sourceSize,
-                   u8* dest, i32 destSize)
+i32 no_conversion(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    if (destSize < sourceSize)
+        throw eBufferOverflow("You're doing it wrong.");
+    memcpy(dest, source, sourceSize);
+    return sourceSize;
 }
 
 
 static
-i32 rgba_to_rgb24(u8* source, i32 sourceSize,
-                   u8* dest, i32 destSize)
+i32 not_implemented(u8* source, i32 sourceSize,
+                    u8* dest, i32 destSize,
+                    u32 width, u32 height, nSimdLevel level)
 {
     throw eNotImplemented("This function will be lazy-implemented.");
     return 0;
@@ -248,65 +441,42 @@ i32 rgba_to_rgb24(u8* source, i32 sourceSize,
 
 
 static
-i32 rgba_to_yuyv(u8* rgba, i32 rgbaSize,
-                   u8* yuyv, i32 yuyvSize)
+i32 yuyv_to_rgb24(u8* yuyv, i32 yuyvSize,
+                  u8* rgb, i32 rgbSize,
+                  u32 width, u32 height, nSimdLevel level)
 {
-    if (rgbaSize % 4)
-    {
-        throw eColorspaceConversionError(
-                "The rgba image buffer has an incorrect size");
-    }
-
-    i32 numPixels = rgbaSize / 4;
+    // yuyv images use four bytes to describe two pixels.
+    // rgb images use three bytes to describe one pixel.
 
-    if (numPixels % 2)
+    if (yuyvSize % 4)
     {
         throw eColorspaceConversionError(
-                "A yuyv image must have a multiple of two number of pixels.");
+                "The yuyv image buffer has an incorrect size");
     }
 
-    if (yuyvSize < numPixels * 2)
-    {
-        throw eBufferOverflow(
-                "The supplied yuyv buffer cannot hold the image described by "
-                "the supplied rgba buffer.");
-    }
+    i32 numPixels = yuyvSize / 2;
 
-    for (i32 i = 0; i < rgbaSize; i += 8)
+    if (rgbSize < numPixels * 3)
     {
-        u8 r0 = rgba[i+0];
-        u8 g0 = rgba[i+1];
-        u8 b0 = rgba[i+2];
-        //u8 a0 = rgba[i+3];
-        u8 r1 = rgba[i+4];
-        u8 g1 = rgba[i+5];
-        u8 b1 = rgba[i+6];
-        //u8 a1 = rgba[i+7];
-
-        *yuyv++ = clip(0.299 * (r0 - 128) + 0.587 * (g0 - 128) + 0.114 * (b0 - 128) + 128);
-        *yuyv++ = clip(((- 0.147 * (r0 - 128) - 0.289 * (g0 - 128) + 0.436 * (b0 - 128) + 128) +
-                       (- 0.147 * (r1 - 128) - 0.289 * (g1 - 128) + 0.436 * (b1 - 128) + 128))/2);
-        *yuyv++ = clip(0.299 * (r1 - 128) + 0.587 * (g1 - 128) + 0.114 * (b1 - 128) + 128);
-        *yuyv++ = clip(((0.615 * (r0 - 128) - 0.515 * (g0 - 128) - 0.100 * (b0 - 128) + 128) +
-                       (0.615 * (r1 - 128) - 0.515 * (g1 - 128) - 0.100 * (b1 - 128) + 128))/2);
+        throw eBufferOverflow(
+                "The supplied rgb buffer cannot hold the image described by "
+                "the supplied yuyv buffer.");
     }
 
-    return numPixels * 2;
-}
-
+    tKernel kernel = s_choose(level, yuyv_to_rgb24_scalar,
+                              NULL,
+                              X86_KERNEL(yuyv_to_rgb24_ssse3),
+                              X86_KERNEL(yuyv_to_rgb24_avx2));
+    kernel(yuyv, rgb, numPixels);
 
-static
-i32 yuyv_to_rgb16(u8* source, i32 sourceSize,
-                   u8* dest, i32 destSize)
-{
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    return numPixels * 3;
 }
 
 
 static
 i32 yuyv_to_rgba(u8* yuyv, i32 yuyvSize,
-                 u8* rgba, i32 rgbaSize)
+                 u8* rgba, i32 rgbaSize,
+                 u32 width, u32 height, nSimdLevel level)
 {
     // yuyv images use four bytes to describe two pixels.
     // rgba images use four bytes to describe one pixel.
@@ -326,165 +496,155 @@ i32 yuyv_to_rgba(u8* yuyv, i32 yuyvSize,
                 "the supplied yuyv buffer.");
     }
 
-    for(i32 i = 0; i < yuyvSize; i += 4)
-    {
-        u8 y0 = yuyv[i+0];
-        u8 u  = yuyv[i+1];
-        u8 y1 = yuyv[i+2];
-        u8 v  = yuyv[i+3];
-
-        /* standard: r0 = y0 + 1.402000*(v-128) */
-        /* logitech: r0 = y0 + 1.370705*(v-128) */
-        *rgba++ = clip(y0 + 1.402000*(v-128));
+    tKernel kernel = s_choose(level, yuyv_to_rgba_scalar,
+                              X86_KERNEL(yuyv_to_rgba_sse2),
+                              NULL,
+                              X86_KERNEL(yuyv_to_rgba_avx2));
+    kernel(yuyv, rgba, numPixels);
 
-        /* standard: g0 = y0 - 0.344140*(u-128) - 0.714140*(v-128) */
-        /* logitech: g0 = y0 - 0.337633*(u-128) - 0.698001*(v-128) */
-        *rgba++ = clip(y0 - 0.344140*(u-128) - 0.714140*(v-128));
-
-        /* standard: b0 = y0 + 1.772000*(u-128) */
-        /* logitech: b0 = y0 + 1.732446*(u-128) */
-        *rgba++ = clip(y0 + 1.772000*(u-128));
+    return numPixels * 4;
+}
 
-        /* The alpha value */
-        *rgba++ = 255;
 
-        /* standard: r1 = y1 + 1.402000*(v-128) */
-        /* logitech: r1 = y1 + 1.370705*(v-128) */
-        *rgba++ = clip(y1 + 1.402000*(v-128));
+static
+i32 yuyv_to_bgra(u8* yuyv, i32 yuyvSize,
+                 u8* bgra, i32 bgraSize,
+                 u32 width, u32 height, nSimdLevel level)
+{
+    // yuyv images use four bytes to describe two pixels.
+    // bgra images use four bytes to describe one pixel.
 
-        /* standard: g1 = y1 - 0.344140*(u-128) - 0.714140*(v-128) */
-        /* logitech: g1 = y1 - 0.337633*(u-128) - 0.698001*(v-128) */
-        *rgba++ = clip(y1 - 0.344140*(u-128) - 0.714140*(v-128));
+    if (yuyvSize % 4)
+    {
+        throw eColorspaceConversionError(
+                "The yuyv image buffer has an incorrect size");
+    }
 
-        /* standard: b1 = y1 + 1.772000*(u-128) */
-        /* logitech: b1 = y1 + 1.732446*(u-128) */
-        *rgba++ = clip(y1 + 1.772000*(u-128));
+    i32 numPixels = yuyvSize / 2;
 
-        /* The alpha value */
-        *rgba++ = 255;
+    if (bgraSize < numPixels * 4)
+    {
+        throw eBufferOverflow(
+                "The supplied bgra buffer cannot hold the image described by "
+                "the supplied yuyv buffer.");
     }
 
-    return numPixels * 4;
-}
-
-static
-i32 rgb16_to_bgra(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
-{
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
-}
+    tKernel kernel = s_choose(level, yuyv_to_bgra_scalar,
+                              X86_KERNEL(yuyv_to_bgra_sse2),
+                              NULL,
+                              X86_KERNEL(yuyv_to_bgra_avx2));
+    kernel(yuyv, bgra, numPixels);
 
-static
-i32 rgb16_to_grey(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
-{
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    return numPixels * 4;
 }
 
-static
-i32 rgb24_to_bgra(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
-{
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
-}
 
 static
-i32 rgb24_to_grey(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
+i32 yuyv_to_grey(u8* yuyv, i32 yuyvSize,
+                 u8* grey, i32 greySize,
+                 u32 width, u32 height, nSimdLevel level)
 {
-    if ((sourceSize % 3) > 0)
+    if (yuyvSize % 4)
     {
-        throw eColorspaceConversionError("The source buffer does not seem "
-                "to be an rgb24 image.");
+        throw eColorspaceConversionError(
+                "The yuyv image buffer has an incorrect size");
     }
 
-    i32 numPix = sourceSize / 3;
+    i32 numPixels = yuyvSize / 2;
 
-    if (destSize < numPix)
+    if (greySize < numPixels)
     {
         throw eBufferOverflow(
                 "The supplied grey buffer cannot hold the image described by "
-                "the supplied rgb24 buffer.");
+                "the supplied yuyv buffer.");
     }
 
-    for (i32 i = 0; i < numPix; ++i)
-    {
-        i32 r = *source++;
-        i32 g = *source++;
-        i32 b = *source++;
-
-        u8 avg = (u8) ((r + g + b) / 3);
-
-        // Also try:
-        //u8 avg = (std::max(std::max(r,g),b) + std::min(std::min(r,g),b)) / 2.0;
-        //u8 avg = 0.21*r + 0.71*g + 0.07*b;
-
-        *dest++ = avg;
-    }
+    tKernel kernel = s_choose(level, yuyv_to_grey_scalar,
+                              X86_KERNEL(yuyv_to_grey_sse2),
+                              NULL,
+                              X86_KERNEL(yuyv_to_grey_avx2));
+    kernel(yuyv, grey, numPixels);
 
-    return numPix;
+    return numPixels;
 }
 
-static
-i32 rgba_to_bgra(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
-{
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
-}
 
 static
-i32 rgba_to_grey(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
+i32 rgb24_to_yuyv(u8* rgb, i32 rgbSize,
+                  u8* yuyv, i32 yuyvSize,
+                  u32 width, u32 height, nSimdLevel level)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
-}
+    if (rgbSize % 3)
+    {
+        throw eColorspaceConversionError(
+                "The rgb image buffer has an incorrect size");
+    }
 
-static
-i32 bgra_to_rgb16(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
-{
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
-}
+    i32 numPixels = rgbSize / 3;
 
-static
-i32 bgra_to_rgb24(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
-{
-    if (sourceSize % 4)
-        throw eColorspaceConversionError("An BGRA buffer must be a multiple of 4.");
-    i32 numPixels = sourceSize / 4;
-    if (numPixels * 3 > destSize)
-        throw eBufferOverflow("Not enough bytes in the RBG buffer.");
-    for (i32 i = 0; i < destSize; i += 4)
+    if (numPixels % 2)
     {
-        u8 b = source[i+0];
-        u8 g = source[i+1];
-        u8 r = source[i+2];
-        //u8 a = source[i+3];
-        *dest++ = r;
-        *dest++ = g;
-        *dest++ = b;
+        throw eColorspaceConversionError(
+                "A yuyv image must have a multiple of two number of pixels.");
     }
-    return numPixels * 3;
+
+    if (yuyvSize < numPixels * 2)
+    {
+        throw eBufferOverflow(
+                "The supplied yuyv buffer cannot hold the image described by "
+                "the supplied rgb buffer.");
+    }
+
+    tKernel kernel = s_choose(level, rgb24_to_yuyv_scalar,
+                              NULL,
+                              X86_KERNEL(rgb24_to_yuyv_ssse3),
+                              X86_KERNEL(rgb24_to_yuyv_avx2));
+    kernel(rgb, yuyv, numPixels);
+
+    return numPixels * 2;
 }
 
+
 static
-i32 bgra_to_rgba(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
+i32 rgba_to_yuyv(u8* rgba, i32 rgbaSize,
+                 u8* yuyv, i32 yuyvSize,
+                 u32 width, u32 height, nSimdLevel level)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    if (rgbaSize % 4)
+    {
+        throw eColorspaceConversionError(
+                "The rgba image buffer has an incorrect size");
+    }
+
+    i32 numPixels = rgbaSize / 4;
+
+    if (numPixels % 2)
+    {
+        throw eColorspaceConversionError(
+                "A yuyv image must have a multiple of two number of pixels.");
+    }
+
+    if (yuyvSize < numPixels * 2)
+    {
+        throw eBufferOverflow(
+                "The supplied yuyv buffer cannot hold the image described by "
+                "the supplied rgba buffer.");
+    }
+
+    tKernel kernel = s_choose(level, rgba_to_yuyv_scalar,
+                              X86_KERNEL(rgba_to_yuyv_sse2),
+                              NULL,
+                              X86_KERNEL(rgba_to_yuyv_avx2));
+    kernel(rgba, yuyv, numPixels);
+
+    return numPixels * 2;
 }
 
+
 static
 i32 bgra_to_yuyv(u8* bgra, i32 bgraSize,
-                  u8* yuyv, i32 yuyvSize)
+                 u8* yuyv, i32 yuyvSize,
+                 u32 width, u32 height, nSimdLevel level)
 {
     if (bgraSize % 4)
     {
@@ -507,265 +667,915 @@ i32 bgra_to_yuyv(u8* bgra, i32 bgraSize,
                 "the supplied bgra buffer.");
     }
 
-    for (i32 i = 0; i < bgraSize; i += 8)
-    {
-        u8 b0 = bgra[i+0];
-        u8 g0 = bgra[i+1];
-        u8 r0 = bgra[i+2];
-        //u8 a0 = bgra[i+3];
-        u8 b1 = bgra[i+4];
-        u8 g1 = bgra[i+5];
-        u8 r1 = bgra[i+6];
-        //u8 a1 = bgra[i+7];
-
-        *yuyv++ = clip(0.299 * (r0 - 128) + 0.587 * (g0 - 128) + 0.114 * (b0 - 128) + 128);
-        *yuyv++ = clip(((- 0.147 * (r0 - 128) - 0.289 * (g0 - 128) + 0.436 * (b0 - 128) + 128) +
-                       (- 0.147 * (r1 - 128) - 0.289 * (g1 - 128) + 0.436 * (b1 - 128) + 128))/2);
-        *yuyv++ = clip(0.299 * (r1 - 128) + 0.587 * (g1 - 128) + 0.114 * (b1 - 128) + 128);
-        *yuyv++ = clip(((0.615 * (r0 - 128) - 0.515 * (g0 - 128) - 0.100 * (b0 - 128) + 128) +
-                       (0.615 * (r1 - 128) - 0.515 * (g1 - 128) - 0.100 * (b1 - 128) + 128))/2);
-    }
+    tKernel kernel = s_choose(level, bgra_to_yuyv_scalar,
+                              X86_KERNEL(bgra_to_yuyv_sse2),
+                              NULL,
+                              X86_KERNEL(bgra_to_yuyv_avx2));
+    kernel(bgra, yuyv, numPixels);
 
     return numPixels * 2;
 }
 
+
 static
-i32 bgra_to_grey(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
+i32 grey_to_yuyv(u8* grey, i32 greySize,
+                 u8* yuyv, i32 yuyvSize,
+                 u32 width, u32 height, nSimdLevel level)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    i32 numPixels = greySize;
+
+    if (numPixels % 2)
+    {
+        throw eColorspaceConversionError(
+                "A yuyv image must have a multiple of two number of pixels.");
+    }
+
+    if (yuyvSize < numPixels * 2)
+    {
+        throw eBufferOverflow(
+                "The supplied yuyv buffer cannot hold the image described by "
+                "the supplied grey buffer.");
+    }
+
+    tKernel kernel = s_choose(level, grey_to_yuyv_scalar,
+                              X86_KERNEL(grey_to_yuyv_sse2),
+                              NULL,
+                              NULL);
+    kernel(grey, yuyv, numPixels);
+
+    return numPixels * 2;
 }
 
+
 static
-i32 yuyv_to_bgra(u8* yuyv, i32 yuyvSize,
-                 u8* bgra, i32 bgraSize)
+i32 rgb24_to_grey(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
 {
-    // yuyv images use four bytes to describe two pixels.
-    // bgra images use four bytes to describe one pixel.
-
-    if (yuyvSize % 4)
+    if ((sourceSize % 3) > 0)
     {
-        throw eColorspaceConversionError(
-                "The yuyv image buffer has an incorrect size");
+        throw eColorspaceConversionError("The source buffer does not seem "
+                "to be an rgb24 image.");
     }
 
-    i32 numPixels = yuyvSize / 2;
+    i32 numPix = sourceSize / 3;
 
-    if (bgraSize < numPixels * 4)
+    if (destSize < numPix)
     {
         throw eBufferOverflow(
-                "The supplied bgra buffer cannot hold the image described by "
-                "the supplied yuyv buffer.");
+                "The supplied grey buffer cannot hold the image described by "
+                "the supplied rgb24 buffer.");
     }
 
-    for(i32 i = 0; i < yuyvSize; i += 4)
-    {
-        u8 y0 = yuyv[i+0];
-        u8 u  = yuyv[i+1];
-        u8 y1 = yuyv[i+2];
-        u8 v  = yuyv[i+3];
+    tKernel kernel = s_choose(level, rgb24_to_grey_scalar,
+                              NULL,
+                              X86_KERNEL(rgb24_to_grey_ssse3),
+                              X86_KERNEL(rgb24_to_grey_avx2));
+    kernel(source, dest, numPix);
 
-        /* standard: b0 = y0 + 1.772000*(u-128) */
-        /* logitech: b0 = y0 + 1.732446*(u-128) */
-        *bgra++ = clip(y0 + 1.772000*(u-128));
+    return numPix;
+}
 
-        /* standard: g0 = y0 - 0.344140*(u-128) - 0.714140*(v-128) */
-        /* logitech: g0 = y0 - 0.337633*(u-128) - 0.698001*(v-128) */
-        *bgra++ = clip(y0 - 0.344140*(u-128) - 0.714140*(v-128));
 
-        /* standard: r0 = y0 + 1.402000*(v-128) */
-        /* logitech: r0 = y0 + 1.370705*(v-128) */
-        *bgra++ = clip(y0 + 1.402000*(v-128));
+static
+i32 rgbx_to_grey(u8* source, i32 sourceSize,
+                 u8* dest, i32 destSize,
+                 u32 width, u32 height, nSimdLevel level)
+{
+    if (sourceSize % 4)
+        throw eColorspaceConversionError("An RGBA/BGRA buffer must be a multiple of 4.");
+    i32 numPixels = sourceSize / 4;
+    if (numPixels > destSize)
+        throw eBufferOverflow("Not enough bytes in the grey buffer.");
+    tKernel kernel = s_choose(level, rgbx_to_grey_scalar,
+                              X86_KERNEL(rgbx_to_grey_sse2),
+                              NULL,
+                              X86_KERNEL(rgbx_to_grey_avx2));
+    kernel(source, dest, numPixels);
+    return numPixels;
+}
 
-        /* The alpha value */
-        *bgra++ = 255;
 
-        /* standard: b1 = y1 + 1.772000*(u-128) */
-        /* logitech: b1 = y1 + 1.732446*(u-128) */
-        *bgra++ = clip(y1 + 1.772000*(u-128));
+static
+i32 grey_to_rgb24(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
+{
+    if (sourceSize * 3 > destSize)
+        throw eBufferOverflow("Not enough space in the destination buffer.");
+    tKernel kernel = s_choose(level, grey_to_rgb24_scalar,
+                              NULL,
+                              X86_KERNEL(grey_to_rgb24_ssse3),
+                              NULL);
+    kernel(source, dest, sourceSize);
+    return sourceSize * 3;
+}
 
-        /* standard: g1 = y1 - 0.344140*(u-128) - 0.714140*(v-128) */
-        /* logitech: g1 = y1 - 0.337633*(u-128) - 0.698001*(v-128) */
-        *bgra++ = clip(y1 - 0.344140*(u-128) - 0.714140*(v-128));
 
-        /* standard: r1 = y1 + 1.402000*(v-128) */
-        /* logitech: r1 = y1 + 1.370705*(v-128) */
-        *bgra++ = clip(y1 + 1.402000*(v-128));
+static
+i32 grey_to_rgbx(u8* source, i32 sourceSize,
+                 u8* dest, i32 destSize,
+                 u32 width, u32 height, nSimdLevel level)
+{
+    if (sourceSize * 4 > destSize)
+        throw eBufferOverflow("Not enough space in the destination buffer.");
+    tKernel kernel = s_choose(level, grey_to_rgbx_scalar,
+                              X86_KERNEL(grey_to_rgbx_sse2),
+                              NULL,
+                              NULL);
+    kernel(source, dest, sourceSize);
+    return sourceSize * 4;
+}
 
-        /* The alpha value */
-        *bgra++ = 255;
-    }
 
+static
+i32 rgb24_to_rgba(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
+{
+    if (sourceSize % 3)
+        throw eColorspaceConversionError("An RGB24 buffer must be a multiple of 3.");
+    i32 numPixels = sourceSize / 3;
+    if (numPixels * 4 > destSize)
+        throw eBufferOverflow("Not enough bytes in the RGBA buffer.");
+    tKernel kernel = s_choose(level, rgb24_to_rgba_scalar,
+                              NULL,
+                              X86_KERNEL(rgb24_to_rgba_ssse3),
+                              NULL);
+    kernel(source, dest, numPixels);
     return numPixels * 4;
 }
 
+
 static
-i32 yuyv_to_grey(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
+i32 rgb24_to_bgra(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    if (sourceSize % 3)
+        throw eColorspaceConversionError("An RGB24 buffer must be a multiple of 3.");
+    i32 numPixels = sourceSize / 3;
+    if (numPixels * 4 > destSize)
+        throw eBufferOverflow("Not enough bytes in the BGRA buffer.");
+    tKernel kernel = s_choose(level, rgb24_to_bgra_scalar,
+                              NULL,
+                              X86_KERNEL(rgb24_to_bgra_ssse3),
+                              NULL);
+    kernel(source, dest, numPixels);
+    return numPixels * 4;
 }
 
+
 static
-i32 grey_to_rgb16(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
+i32 rgba_to_rgb24(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    if (sourceSize % 4)
+        throw eColorspaceConversionError("An RGBA buffer must be a multiple of 4.");
+    i32 numPixels = sourceSize / 4;
+    if (numPixels * 3 > destSize)
+        throw eBufferOverflow("Not enough bytes in the RBG buffer.");
+    tKernel kernel = s_choose(level, rgba_to_rgb24_scalar,
+                              NULL,
+                              X86_KERNEL(rgba_to_rgb24_ssse3),
+                              NULL);
+    kernel(source, dest, numPixels);
+    return numPixels * 3;
 }
 
+
 static
-i32 grey_to_rgb24(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
+i32 bgra_to_rgb24(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
 {
-    if (sourceSize * 3 > destSize)
-        throw eBufferOverflow("Not enough space in the destination buffer.");
+    if (sourceSize % 4)
+        throw eColorspaceConversionError("An BGRA buffer must be a multiple of 4.");
+    i32 numPixels = sourceSize / 4;
+    if (numPixels * 3 > destSize)
+        throw eBufferOverflow("Not enough bytes in the RBG buffer.");
+    tKernel kernel = s_choose(level, bgra_to_rgb24_scalar,
+                              NULL,
+                              X86_KERNEL(bgra_to_rgb24_ssse3),
+                              NULL);
+    kernel(source, dest, numPixels);
+    return numPixels * 3;
+}
 
-    for (i32 i = 0; i < sourceSize; ++i)
-    {
-        u8 pix = *source++;
-        *dest++ = pix;
-        *dest++ = pix;
-        *dest++ = pix;
-    }
 
+static
+i32 swap_rb(u8* source, i32 sourceSize,
+            u8* dest, i32 destSize,
+            u32 width, u32 height, nSimdLevel level)
+{
+    if (sourceSize % 4)
+        throw eColorspaceConversionError("An RGBA/BGRA buffer must be a multiple of 4.");
+    if (sourceSize > destSize)
+        throw eBufferOverflow("Not enough bytes in the destination buffer.");
+    tKernel kernel = s_choose(level, swap_rb_scalar,
+                              X86_KERNEL(swap_rb_sse2),
+                              NULL,
+                              X86_KERNEL(swap_rb_avx2));
+    kernel(source, dest, sourceSize / 4);
     return sourceSize;
 }
 
+
+
+////////////////////////////////////////////////////////////////////////////////
+// The planar formats. kI420 and kNV12 share their chroma between the four
+// pixels of each 2x2 block, so these need the image's width and height.
+// The conversions between them and the packed formats go a row at a time
+// through yuyv, so that they use the yuyv kernels above (and their SIMD
+// versions); a 2x2 block's chroma is the rounded average of its two rows'
+// yuyv chroma.
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Checks the geometry of a 4:2:0 image (kI420 or kNV12).
+ */
 static
-i32 grey_to_rgba(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
+void s_check420(u32 width, u32 height)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    if (width == 0 || height == 0)
+    {
+        throw eInvalidArgument("Converting to or from kI420 or kNV12 needs the "
+                "image's width and height.");
+    }
+    if ((width % 2) || (height % 2))
+    {
+        throw eInvalidArgument("kI420 and kNV12 images must have an even width "
+                "and height.");
+    }
 }
 
+/*
+ * Where the chroma of a 4:2:0 image is. Row 'r' of the chroma (which goes
+ * with pixel rows 2r and 2r+1) starts at u + r*stride and v + r*stride,
+ * and the samples along it are 'step' bytes apart.
+ */
+struct t420Chroma
+{
+    u8* u;
+    u8* v;
+    u32 stride;
+    u32 step;
+};
+
 static
-i32 grey_to_bgra(u8* source, i32 sourceSize,
-                  u8* dest, i32 destSize)
+t420Chroma s_chroma(u8* buf, u32 width, u32 height, bool nv12)
 {
-    throw eNotImplemented("This function will be lazy-implemented.");
-    return 0;
+    t420Chroma chroma;
+    chroma.u = buf + width * height;
+    if (nv12)
+    {
+        chroma.v = chroma.u + 1;
+        chroma.stride = width;
+        chroma.step = 2;
+    }
+    else
+    {
+        chroma.v = chroma.u + (width/2) * (height/2);
+        chroma.stride = width / 2;
+        chroma.step = 1;
+    }
+    return chroma;
 }
 
+/*
+ * 4:2:0 -> a packed format. 'kernel' converts a row of yuyv to the packed
+ * format, or is NULL when the packed format is yuyv.
+ */
 static
-i32 grey_to_yuyv(u8* grey, i32 greySize,
-                  u8* yuyv, i32 yuyvSize)
+i32 s_from420(u8* source, i32 sourceSize, u8* dest, i32 destSize,
+              u32 width, u32 height, bool nv12, tKernel kernel, u32 destBpp)
 {
-    i32 numPixels = greySize;
+    s_check420(width, height);
+    if ((u32)sourceSize != getBufSize(kI420, width, height))
+    {
+        throw eColorspaceConversionError("The 4:2:0 buffer doesn't match the "
+                "image's width and height.");
+    }
+    if ((u32)destSize < width * height * destBpp)
+        throw eBufferOverflow("Not enough bytes in the destination buffer.");
 
-    if (numPixels % 2)
+    t420Chroma chroma = s_chroma(source, width, height, nv12);
+    std::vector<u8> yuyv(2 * width);
+    for (u32 row = 0; row < height; row++)
     {
-        throw eColorspaceConversionError(
-                "A yuyv image must have a multiple of two number of pixels.");
+        const u8* y = source + row * width;
+        const u8* u = chroma.u + (row/2) * chroma.stride;
+        const u8* v = chroma.v + (row/2) * chroma.stride;
+        u8* out = kernel ? &yuyv[0] : dest + row * width * destBpp;
+        for (u32 x = 0; x < width/2; x++)
+        {
+            out[4*x+0] = y[2*x];
+            out[4*x+1] = u[x * chroma.step];
+            out[4*x+2] = y[2*x+1];
+            out[4*x+3] = v[x * chroma.step];
+        }
+        if (kernel)
+            kernel(&yuyv[0], dest + row * width * destBpp, (i32)width);
     }
 
-    if (yuyvSize < numPixels * 2)
+    return (i32)(width * height * destBpp);
+}
+
+/*
+ * A packed format -> 4:2:0. 'kernel' converts a row of the packed format
+ * to yuyv, or is NULL when the packed format is yuyv.
+ */
+static
+i32 s_to420(u8* source, i32 sourceSize, u8* dest, i32 destSize,
+            u32 width, u32 height, bool nv12, tKernel kernel, u32 sourceBpp)
+{
+    s_check420(width, height);
+    if ((u32)sourceSize != width * height * sourceBpp)
     {
-        throw eBufferOverflow(
-                "The supplied yuyv buffer cannot hold the image described by "
-                "the supplied grey buffer.");
+        throw eColorspaceConversionError("The source buffer doesn't match the "
+                "image's width and height.");
     }
+    u32 destUsed = getBufSize(kI420, width, height);
+    if ((u32)destSize < destUsed)
+        throw eBufferOverflow("Not enough bytes in the 4:2:0 buffer.");
 
-    for (i32 i = 0; i < greySize; i += 2)
+    t420Chroma chroma = s_chroma(dest, width, height, nv12);
+    std::vector<u8> top(2 * width), bottom(2 * width);
+    for (u32 row = 0; row < height; row += 2)
     {
-        u8 r0 = grey[i+0];
-        u8 g0 = r0;
-        u8 b0 = r0;
-        u8 r1 = grey[i+1];
-        u8 g1 = r1;
-        u8 b1 = r1;
+        const u8* a = source + row * width * sourceBpp;
+        const u8* b = a + width * sourceBpp;
+        if (kernel)
+        {
+            kernel(a, &top[0], (i32)width);
+            kernel(b, &bottom[0], (i32)width);
+            a = &top[0];
+            b = &bottom[0];
+        }
+
+        u8* y0 = dest + row * width;
+        u8* y1 = y0 + width;
+        u8* u = chroma.u + (row/2) * chroma.stride;
+        u8* v = chroma.v + (row/2) * chroma.stride;
+        for (u32 x = 0; x < width/2; x++)
+        {
+            y0[2*x]   = a[4*x+0];
+            y0[2*x+1] = a[4*x+2];
+            y1[2*x]   = b[4*x+0];
+            y1[2*x+1] = b[4*x+2];
+            u[x * chroma.step] = (u8)((a[4*x+1] + b[4*x+1] + 1) >> 1);
+            v[x * chroma.step] = (u8)((a[4*x+3] + b[4*x+3] + 1) >> 1);
+        }
+    }
+
+    return (i32)destUsed;
+}
 
-        *yuyv++ = clip(0.299 * (r0 - 128) + 0.587 * (g0 - 128) + 0.114 * (b0 - 128) + 128);
-        *yuyv++ = clip(((- 0.147 * (r0 - 128) - 0.289 * (g0 - 128) + 0.436 * (b0 - 128) + 128) +
-                       (- 0.147 * (r1 - 128) - 0.289 * (g1 - 128) + 0.436 * (b1 - 128) + 128))/2);
-        *yuyv++ = clip(0.299 * (r1 - 128) + 0.587 * (g1 - 128) + 0.114 * (b1 - 128) + 128);
-        *yuyv++ = clip(((0.615 * (r0 - 128) - 0.515 * (g0 - 128) - 0.100 * (b0 - 128) + 128) +
-                       (0.615 * (r1 - 128) - 0.515 * (g1 - 128) - 0.100 * (b1 - 128) + 128))/2);
+static
+i32 s_420_to_420(u8* source, i32 sourceSize, u8* dest, i32 destSize,
+                 u32 width, u32 height, bool fromNv12)
+{
+    s_check420(width, height);
+    u32 size = getBufSize(kI420, width, height);
+    if ((u32)sourceSize != size)
+    {
+        throw eColorspaceConversionError("The 4:2:0 buffer doesn't match the "
+                "image's width and height.");
     }
+    if ((u32)destSize < size)
+        throw eBufferOverflow("Not enough bytes in the 4:2:0 buffer.");
 
-    return numPixels * 2;
+    memcpy(dest, source, width * height);
+    t420Chroma from = s_chroma(source, width, height, fromNv12);
+    t420Chroma to = s_chroma(dest, width, height, !fromNv12);
+    for (u32 row = 0; row < height/2; row++)
+    {
+        for (u32 x = 0; x < width/2; x++)
+        {
+            to.u[row * to.stride + x * to.step] = from.u[row * from.stride + x * from.step];
+            to.v[row * to.stride + x * to.step] = from.v[row * from.stride + x * from.step];
+        }
+    }
+    return (i32)size;
 }
 
+static
+i32 yuv420_to_grey(u8* source, i32 sourceSize,
+                   u8* dest, i32 destSize,
+                   u32 width, u32 height, nSimdLevel level)
+{
+    // (The same for kI420 and kNV12: the luma plane comes first in both.)
+    s_check420(width, height);
+    if ((u32)sourceSize != getBufSize(kI420, width, height))
+    {
+        throw eColorspaceConversionError("The 4:2:0 buffer doesn't match the "
+                "image's width and height.");
+    }
+    if ((u32)destSize < width * height)
+        throw eBufferOverflow("Not enough bytes in the grey buffer.");
+    memcpy(dest, source, width * height);
+    return (i32)(width * height);
+}
 
-typedef i32 (*converstion_func)(u8* source, i32 sourceSize, u8* dest, i32 destSize);
+static
+i32 s_grey_to_420(u8* source, i32 sourceSize, u8* dest, i32 destSize,
+                  u32 width, u32 height, bool nv12)
+{
+    s_check420(width, height);
+    if ((u32)sourceSize != width * height)
+    {
+        throw eColorspaceConversionError("The source buffer doesn't match the "
+                "image's width and height.");
+    }
+    u32 destUsed = getBufSize(kI420, width, height);
+    if ((u32)destSize < destUsed)
+        throw eBufferOverflow("Not enough bytes in the 4:2:0 buffer.");
+
+    // The chroma of grey is 128, whichever way it's laid out.
+    memcpy(dest, source, width * height);
+    memset(dest + width * height, 128, destUsed - width * height);
+    return (i32)destUsed;
+}
 
+/*
+ * The kernels between yuyv and the other packed formats, as the
+ * conversion functions above pick them.
+ */
+static
+tKernel s_fromYuyvKernel(nImageFormat to, nSimdLevel level)
+{
+    switch (to)
+    {
+        case kRGB24:
+            return s_choose(level, yuyv_to_rgb24_scalar,
+                            NULL,
+                            X86_KERNEL(yuyv_to_rgb24_ssse3),
+                            X86_KERNEL(yuyv_to_rgb24_avx2));
+        case kRGBA:
+            return s_choose(level, yuyv_to_rgba_scalar,
+                            X86_KERNEL(yuyv_to_rgba_sse2),
+                            NULL,
+                            X86_KERNEL(yuyv_to_rgba_avx2));
+        case kBGRA:
+            return s_choose(level, yuyv_to_bgra_scalar,
+                            X86_KERNEL(yuyv_to_bgra_sse2),
+                            NULL,
+                            X86_KERNEL(yuyv_to_bgra_avx2));
+        default:
+            throw eImpossiblePath();
+    }
+}
 
-struct tConversionFunctionMatrixBuilder
+static
+tKernel s_toYuyvKernel(nImageFormat from, nSimdLevel level)
 {
-    tConversionFunctionMatrixBuilder()
+    switch (from)
     {
-        i32 numFormats = (i32) kMaxImageFormat;
+        case kRGB24:
+            return s_choose(level, rgb24_to_yuyv_scalar,
+                            NULL,
+                            X86_KERNEL(rgb24_to_yuyv_ssse3),
+                            X86_KERNEL(rgb24_to_yuyv_avx2));
+        case kRGBA:
+            return s_choose(level, rgba_to_yuyv_scalar,
+                            X86_KERNEL(rgba_to_yuyv_sse2),
+                            NULL,
+                            X86_KERNEL(rgba_to_yuyv_avx2));
+        case kBGRA:
+            return s_choose(level, bgra_to_yuyv_scalar,
+                            X86_KERNEL(bgra_to_yuyv_sse2),
+                            NULL,
+                            X86_KERNEL(bgra_to_yuyv_avx2));
+        default:
+            throw eImpossiblePath();
+    }
+}
+
+
+static
+i32 i420_to_rgb24(u8* source, i32 sourceSize,
+                 u8* dest, i32 destSize,
+                 u32 width, u32 height, nSimdLevel level)
+{
+    return s_from420(source, sourceSize, dest, destSize, width, height, false,
+                     s_fromYuyvKernel(kRGB24, level), 3);
+}
+
+
+static
+i32 i420_to_rgba(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_from420(source, sourceSize, dest, destSize, width, height, false,
+                     s_fromYuyvKernel(kRGBA, level), 4);
+}
+
+
+static
+i32 i420_to_bgra(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_from420(source, sourceSize, dest, destSize, width, height, false,
+                     s_fromYuyvKernel(kBGRA, level), 4);
+}
+
+
+static
+i32 i420_to_yuyv(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_from420(source, sourceSize, dest, destSize, width, height, false, NULL, 2);
+}
+
+
+static
+i32 nv12_to_rgb24(u8* source, i32 sourceSize,
+                 u8* dest, i32 destSize,
+                 u32 width, u32 height, nSimdLevel level)
+{
+    return s_from420(source, sourceSize, dest, destSize, width, height, true,
+                     s_fromYuyvKernel(kRGB24, level), 3);
+}
+
+
+static
+i32 nv12_to_rgba(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_from420(source, sourceSize, dest, destSize, width, height, true,
+                     s_fromYuyvKernel(kRGBA, level), 4);
+}
+
+
+static
+i32 nv12_to_bgra(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_from420(source, sourceSize, dest, destSize, width, height, true,
+                     s_fromYuyvKernel(kBGRA, level), 4);
+}
+
+
+static
+i32 nv12_to_yuyv(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_from420(source, sourceSize, dest, destSize, width, height, true, NULL, 2);
+}
+
+
+static
+i32 rgb24_to_i420(u8* source, i32 sourceSize,
+                 u8* dest, i32 destSize,
+                 u32 width, u32 height, nSimdLevel level)
+{
+    return s_to420(source, sourceSize, dest, destSize, width, height, false,
+                   s_toYuyvKernel(kRGB24, level), 3);
+}
+
+
+static
+i32 rgba_to_i420(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_to420(source, sourceSize, dest, destSize, width, height, false,
+                   s_toYuyvKernel(kRGBA, level), 4);
+}
+
+
+static
+i32 bgra_to_i420(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_to420(source, sourceSize, dest, destSize, width, height, false,
+                   s_toYuyvKernel(kBGRA, level), 4);
+}
+
+
+static
+i32 yuyv_to_i420(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_to420(source, sourceSize, dest, destSize, width, height, false, NULL, 2);
+}
+
+
+static
+i32 grey_to_i420(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_grey_to_420(source, sourceSize, dest, destSize, width, height, false);
+}
+
+
+static
+i32 rgb24_to_nv12(u8* source, i32 sourceSize,
+                 u8* dest, i32 destSize,
+                 u32 width, u32 height, nSimdLevel level)
+{
+    return s_to420(source, sourceSize, dest, destSize, width, height, true,
+                   s_toYuyvKernel(kRGB24, level), 3);
+}
+
+
+static
+i32 rgba_to_nv12(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_to420(source, sourceSize, dest, destSize, width, height, true,
+                   s_toYuyvKernel(kRGBA, level), 4);
+}
+
 
-        matrix = new converstion_func*[numFormats];
-        for (i32 i = 0; i < numFormats; i++)
-            matrix[i] = new converstion_func[numFormats];
+static
+i32 bgra_to_nv12(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_to420(source, sourceSize, dest, destSize, width, height, true,
+                   s_toYuyvKernel(kBGRA, level), 4);
+}
 
-        for (i32 i = 0; i < numFormats; i++)
-            matrix[i][i] = no_conversion;
 
-        matrix[kRGB16][kRGB24] = rgb16_to_rgb24;
-        matrix[kRGB16][kRGBA]  = rgb16_to_rgba;
-        matrix[kRGB16][kBGRA]  = rgb16_to_bgra;
-        matrix[kRGB16][kYUYV]  = rgb16_to_yuyv;
-        matrix[kRGB16][kGrey]  = rgb16_to_grey;
+static
+i32 yuyv_to_nv12(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_to420(source, sourceSize, dest, destSize, width, height, true, NULL, 2);
+}
 
-        matrix[kRGB24][kRGB16] = rgb24_to_rgb16;
-        matrix[kRGB24][kRGBA]  = rgb24_to_rgba;
-        matrix[kRGB24][kBGRA]  = rgb24_to_bgra;
-        matrix[kRGB24][kYUYV]  = rgb24_to_yuyv;
-        matrix[kRGB24][kGrey]  = rgb24_to_grey;
 
-        matrix[kRGBA][kRGB16]  = rgba_to_rgb16;
-        matrix[kRGBA][kRGB24]  = rgba_to_rgb24;
-        matrix[kRGBA][kBGRA]   = rgba_to_bgra;
-        matrix[kRGBA][kYUYV]   = rgba_to_yuyv;
-        matrix[kRGBA][kGrey]   = rgba_to_grey;
+static
+i32 grey_to_nv12(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_grey_to_420(source, sourceSize, dest, destSize, width, height, true);
+}
+
 
-        matrix[kBGRA][kRGB16]  = bgra_to_rgb16;
-        matrix[kBGRA][kRGB24]  = bgra_to_rgb24;
-        matrix[kBGRA][kRGBA]   = bgra_to_rgba;
-        matrix[kBGRA][kYUYV]   = bgra_to_yuyv;
-        matrix[kBGRA][kGrey]   = bgra_to_grey;
+static
+i32 i420_to_nv12(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_420_to_420(source, sourceSize, dest, destSize, width, height, false);
+}
 
-        matrix[kYUYV][kRGB16]  = yuyv_to_rgb16;
-        matrix[kYUYV][kRGB24]  = yuyv_to_rgb24;
-        matrix[kYUYV][kRGBA]   = yuyv_to_rgba;
-        matrix[kYUYV][kBGRA]   = yuyv_to_bgra;
-        matrix[kYUYV][kGrey]   = yuyv_to_grey;
 
-        matrix[kGrey][kRGB16]  = grey_to_rgb16;
-        matrix[kGrey][kRGB24]  = grey_to_rgb24;
-        matrix[kGrey][kRGBA]   = grey_to_rgba;
-        matrix[kGrey][kBGRA]   = grey_to_bgra;
-        matrix[kGrey][kYUYV]   = grey_to_yuyv;
+static
+i32 nv12_to_i420(u8* source, i32 sourceSize,
+                u8* dest, i32 destSize,
+                u32 width, u32 height, nSimdLevel level)
+{
+    return s_420_to_420(source, sourceSize, dest, destSize, width, height, true);
+}
+
+
+/*
+ * kRGBPlanar is three whole planes, red then green then blue, so it only
+ * needs the number of pixels. 'ri', 'gi' and 'bi' are the offsets of the
+ * channels in the packed pixels (as for s_yuyv_to_rgb()), and a packed
+ * pixel of four bytes gets an alpha of 255.
+ */
+static
+i32 s_fromPlanar(u8* source, i32 sourceSize, u8* dest, i32 destSize,
+                 u32 ri, u32 gi, u32 bi, u32 bpp)
+{
+    if (sourceSize % 3)
+        throw eColorspaceConversionError("A planar RGB buffer must be a multiple of 3.");
+    u32 numPixels = (u32)sourceSize / 3;
+    if ((u32)destSize < numPixels * bpp)
+        throw eBufferOverflow("Not enough bytes in the destination buffer.");
+
+    const u8* r = source;
+    const u8* g = r + numPixels;
+    const u8* b = g + numPixels;
+    for (u32 i = 0; i < numPixels; i++)
+    {
+        u8* p = dest + i * bpp;
+        p[ri] = r[i];
+        p[gi] = g[i];
+        p[bi] = b[i];
+        if (bpp == 4)
+            p[3] = 255;
     }
+    return (i32)(numPixels * bpp);
+}
 
-    ~tConversionFunctionMatrixBuilder()
+static
+i32 s_toPlanar(u8* source, i32 sourceSize, u8* dest, i32 destSize,
+               u32 ri, u32 gi, u32 bi, u32 bpp)
+{
+    if (sourceSize % bpp)
+        throw eColorspaceConversionError("The source buffer is not a whole number of pixels.");
+    u32 numPixels = (u32)sourceSize / bpp;
+    if ((u32)destSize < numPixels * 3)
+        throw eBufferOverflow("Not enough bytes in the planar RGB buffer.");
+
+    u8* r = dest;
+    u8* g = r + numPixels;
+    u8* b = g + numPixels;
+    for (u32 i = 0; i < numPixels; i++)
     {
-        i32 numFormats = (i32) kMaxImageFormat;
-        for (i32 i = 0; i < numFormats; i++)
-            delete [] matrix[i];
-        delete [] matrix;
+        const u8* p = source + i * bpp;
+        r[i] = p[ri];
+        g[i] = p[gi];
+        b[i] = p[bi];
     }
+    return (i32)(numPixels * 3);
+}
+
+
+static
+i32 planar_to_rgb24(u8* source, i32 sourceSize,
+                   u8* dest, i32 destSize,
+                   u32 width, u32 height, nSimdLevel level)
+{
+    return s_fromPlanar(source, sourceSize, dest, destSize, 0, 1, 2, 3);
+}
+
+
+static
+i32 planar_to_rgba(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
+{
+    return s_fromPlanar(source, sourceSize, dest, destSize, 0, 1, 2, 4);
+}
+
+
+static
+i32 planar_to_bgra(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
+{
+    return s_fromPlanar(source, sourceSize, dest, destSize, 2, 1, 0, 4);
+}
+
+
+static
+i32 rgb24_to_planar(u8* source, i32 sourceSize,
+                   u8* dest, i32 destSize,
+                   u32 width, u32 height, nSimdLevel level)
+{
+    return s_toPlanar(source, sourceSize, dest, destSize, 0, 1, 2, 3);
+}
+
+
+static
+i32 rgba_to_planar(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
+{
+    return s_toPlanar(source, sourceSize, dest, destSize, 0, 1, 2, 4);
+}
 
-    converstion_func** matrix;
+
+static
+i32 bgra_to_planar(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
+{
+    return s_toPlanar(source, sourceSize, dest, destSize, 2, 1, 0, 4);
+}
+
+
+static
+i32 planar_to_grey(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
+{
+    if (sourceSize % 3)
+        throw eColorspaceConversionError("A planar RGB buffer must be a multiple of 3.");
+    i32 numPixels = sourceSize / 3;
+    if (destSize < numPixels)
+        throw eBufferOverflow("Not enough bytes in the grey buffer.");
+
+    // The same average as rgb24_to_grey_scalar().
+    const u8* r = source;
+    const u8* g = r + numPixels;
+    const u8* b = g + numPixels;
+    for (i32 i = 0; i < numPixels; i++)
+        dest[i] = (u8) ((r[i] + g[i] + b[i]) / 3);
+    return numPixels;
+}
+
+
+static
+i32 grey_to_planar(u8* source, i32 sourceSize,
+                  u8* dest, i32 destSize,
+                  u32 width, u32 height, nSimdLevel level)
+{
+    if (sourceSize * 3 > destSize)
+        throw eBufferOverflow("Not enough bytes in the planar RGB buffer.");
+    for (i32 i = 0; i < 3; i++)
+        memcpy(dest + i * sourceSize, source, sourceSize);
+    return sourceSize * 3;
+}
+
+
+typedef i32 (*converstion_func)(u8* source, i32 sourceSize, u8* dest, i32 destSize,
+                                u32 width, u32 height, nSimdLevel level);
+
+
+static const converstion_func kConversionMatrix[kMaxImageFormat][kMaxImageFormat] =
+{
+    // from kRGB16:
+    { no_conversion, not_implemented, not_implemented, not_implemented, not_implemented, not_implemented,
+      not_implemented, not_implemented, not_implemented },
+
+    // from kRGB24:
+    { not_implemented, no_conversion, rgb24_to_rgba, rgb24_to_bgra, rgb24_to_yuyv, rgb24_to_grey,
+      rgb24_to_i420, rgb24_to_nv12, rgb24_to_planar },
+
+    // from kRGBA:
+    { not_implemented, rgba_to_rgb24, no_conversion, swap_rb, rgba_to_yuyv, rgbx_to_grey,
+      rgba_to_i420, rgba_to_nv12, rgba_to_planar },
+
+    // from kBGRA:
+    { not_implemented, bgra_to_rgb24, swap_rb, no_conversion, bgra_to_yuyv, rgbx_to_grey,
+      bgra_to_i420, bgra_to_nv12, bgra_to_planar },
+
+    // from kYUYV:
+    { not_implemented, yuyv_to_rgb24, yuyv_to_rgba, yuyv_to_bgra, no_conversion, yuyv_to_grey,
+      yuyv_to_i420, yuyv_to_nv12, not_implemented },
+
+    // from kGrey:
+    { not_implemented, grey_to_rgb24, grey_to_rgbx, grey_to_rgbx, grey_to_yuyv, no_conversion,
+      grey_to_i420, grey_to_nv12, grey_to_planar },
+
+    // from kI420:
+    { not_implemented, i420_to_rgb24, i420_to_rgba, i420_to_bgra, i420_to_yuyv, yuv420_to_grey,
+      no_conversion, i420_to_nv12, not_implemented },
+
+    // from kNV12:
+    { not_implemented, nv12_to_rgb24, nv12_to_rgba, nv12_to_bgra, nv12_to_yuyv, yuv420_to_grey,
+      nv12_to_i420, no_conversion, not_implemented },
+
+    // from kRGBPlanar:
+    { not_implemented, planar_to_rgb24, planar_to_rgba, planar_to_bgra, not_implemented, planar_to_grey,
+      not_implemented, not_implemented, no_conversion },
 };
 
 
 i32 colorspace_conversion(nImageFormat from, nImageFormat to,
                           u8* source, i32 sourceSize,
                           u8* dest, i32 destSize)
+{
+    return colorspace_conversion(from, to, 0, 0, getSimdLevel(),
+                                 source, sourceSize, dest, destSize);
+}
+
+
+i32 colorspace_conversion(nImageFormat from, nImageFormat to,
+                          nSimdLevel maxLevel,
+                          u8* source, i32 sourceSize,
+                          u8* dest, i32 destSize)
+{
+    return colorspace_conversion(from, to, 0, 0, maxLevel,
+                                 source, sourceSize, dest, destSize);
+}
+
+
+i32 colorspace_conversion(nImageFormat from, nImageFormat to,
+                          u32 width, u32 height,
+                          u8* source, i32 sourceSize,
+                          u8* dest, i32 destSize)
+{
+    return colorspace_conversion(from, to, width, height, getSimdLevel(),
+                                 source, sourceSize, dest, destSize);
+}
+
+
+i32 colorspace_conversion(nImageFormat from, nImageFormat to,
+                          u32 width, u32 height,
+                          nSimdLevel maxLevel,
+                          u8* source, i32 sourceSize,
+                          u8* dest, i32 destSize)
 {
     i32 numFormats = (i32) kMaxImageFormat;
     if (from >= numFormats || to >= numFormats || from < 0 || to < 0)
         throw eInvalidArgument("'from' or 'to' format is invalid");
 
-    tConversionFunctionMatrixBuilder convFunc;
+    nSimdLevel level = getSimdLevel();
+    if (maxLevel < level)
+        level = maxLevel;
 
-    return convFunc.matrix[from][to](source, sourceSize, dest, destSize);
+    return kConversionMatrix[from][to](source, sourceSize, dest, destSize, width, height, level);
 }
 
 
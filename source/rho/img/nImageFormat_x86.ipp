@@ -0,0 +1,796 @@
+/*
+ * SSE2 / SSSE3 / AVX2 versions of the conversion kernels in nImageFormat.cpp.
+ *
+ * This file is included by nImageFormat.cpp on x86 machines only. Each
+ * function is compiled for its instruction set with a target attribute
+ * (rather than with a -m flag for the whole file), so nothing here runs
+ * unless getSimdLevel() says the cpu can handle it.
+ *
+ * Every kernel must produce exactly the same bytes as the scalar kernel
+ * of the same name. Each one converts as many whole blocks as it can and
+ * then hands the leftover pixels to the scalar kernel.
+ */
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+
+
+#define SSE2_FUNC  __attribute__((target("sse2")))
+#define SSSE3_FUNC __attribute__((target("ssse3")))
+#define AVX2_FUNC  __attribute__((target("avx2")))
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Helpers
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Eight 16-bit lanes holding (lo, hi, lo, hi, ...), i.e. the coefficient
+ * vector for _mm_madd_epi16() when the data is interleaved the same way.
+ */
+static inline SSE2_FUNC
+__m128i s_pair_sse2(i32 lo, i32 hi)
+{
+    return _mm_set_epi16((i16)hi, (i16)lo, (i16)hi, (i16)lo,
+                         (i16)hi, (i16)lo, (i16)hi, (i16)lo);
+}
+
+static inline AVX2_FUNC
+__m256i s_pair_avx2(i32 lo, i32 hi)
+{
+    return _mm256_broadcastsi128_si256(s_pair_sse2(lo, hi));
+}
+
+/*
+ * Copies the low 16 bits of each 32-bit lane into its high 16 bits.
+ * (Each chroma value is shared by two pixels.)
+ */
+static inline SSE2_FUNC
+__m128i s_dup16_sse2(__m128i c)
+{
+    return _mm_or_si128(_mm_and_si128(c, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(c, 16));
+}
+
+static inline AVX2_FUNC
+__m256i s_dup16_avx2(__m256i c)
+{
+    return _mm256_or_si256(_mm256_and_si256(c, _mm256_set1_epi32(0xFFFF)), _mm256_slli_epi32(c, 16));
+}
+
+/*
+ * Interleaves four vectors of channel bytes into 4-byte pixels:
+ * out[0..3] hold pixels 0-3, 4-7, 8-11 and 12-15.
+ */
+static inline SSE2_FUNC
+void s_interleave4_sse2(__m128i c0, __m128i c1, __m128i c2, __m128i c3, __m128i* out)
+{
+    __m128i c01lo = _mm_unpacklo_epi8(c0, c1);
+    __m128i c01hi = _mm_unpackhi_epi8(c0, c1);
+    __m128i c23lo = _mm_unpacklo_epi8(c2, c3);
+    __m128i c23hi = _mm_unpackhi_epi8(c2, c3);
+    out[0] = _mm_unpacklo_epi16(c01lo, c23lo);
+    out[1] = _mm_unpackhi_epi16(c01lo, c23lo);
+    out[2] = _mm_unpacklo_epi16(c01hi, c23hi);
+    out[3] = _mm_unpackhi_epi16(c01hi, c23hi);
+}
+
+/*
+ * Same, where the channel vectors came from _mm256_packus_epi16() of
+ * pixels 0-15 and 16-31 (so their 128-bit lanes are out of order).
+ * out[0..3] hold pixels 0-7, 8-15, 16-23 and 24-31.
+ */
+static inline AVX2_FUNC
+void s_interleave4_avx2(__m256i c0, __m256i c1, __m256i c2, __m256i c3, __m256i* out)
+{
+    __m256i c01lo = _mm256_unpacklo_epi8(c0, c1);
+    __m256i c01hi = _mm256_unpackhi_epi8(c0, c1);
+    __m256i c23lo = _mm256_unpacklo_epi8(c2, c3);
+    __m256i c23hi = _mm256_unpackhi_epi8(c2, c3);
+    __m256i p0 = _mm256_unpacklo_epi16(c01lo, c23lo);
+    __m256i p1 = _mm256_unpackhi_epi16(c01lo, c23lo);
+    __m256i p2 = _mm256_unpacklo_epi16(c01hi, c23hi);
+    __m256i p3 = _mm256_unpackhi_epi16(c01hi, c23hi);
+    out[0] = _mm256_permute2x128_si256(p0, p1, 0x20);
+    out[1] = _mm256_permute2x128_si256(p0, p1, 0x31);
+    out[2] = _mm256_permute2x128_si256(p2, p3, 0x20);
+    out[3] = _mm256_permute2x128_si256(p2, p3, 0x31);
+}
+
+/*
+ * Writes sixteen 4-byte pixels (in four vectors) as 48 bytes of 3-byte
+ * pixels. 'mask' picks the three bytes of each pixel (and their order)
+ * and must zero the last four bytes.
+ */
+static inline SSSE3_FUNC
+void s_store_4x3_ssse3(u8* dest, const __m128i* pix, __m128i mask)
+{
+    __m128i p0 = _mm_shuffle_epi8(pix[0], mask);
+    __m128i p1 = _mm_shuffle_epi8(pix[1], mask);
+    __m128i p2 = _mm_shuffle_epi8(pix[2], mask);
+    __m128i p3 = _mm_shuffle_epi8(pix[3], mask);
+    _mm_storeu_si128((__m128i*)(dest),    _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+    _mm_storeu_si128((__m128i*)(dest+16), _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+    _mm_storeu_si128((__m128i*)(dest+32), _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+}
+
+/*
+ * Reads eight 3-byte pixels (24 bytes, no more) as two vectors of 4-byte
+ * pixels. The fourth byte of each pixel is zero.
+ */
+static inline SSSE3_FUNC
+void s_load_3x8_ssse3(const u8* source, __m128i* pix)
+{
+    const __m128i kLo = _mm_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1);
+    const __m128i kHi = _mm_setr_epi8(4,5,6,-1, 7,8,9,-1, 10,11,12,-1, 13,14,15,-1);
+    pix[0] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(source)), kLo);
+    pix[1] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(source+8)), kHi);
+}
+
+/*
+ * Reads sixteen 3-byte pixels (48 bytes) as two vectors of 4-byte pixels,
+ * 0-7 and 8-15. The fourth byte of each pixel is zero.
+ */
+static inline AVX2_FUNC
+void s_load_3x16_avx2(const u8* source, __m256i* pix)
+{
+    const __m256i kMask = _mm256_setr_epi8(0,1,2,-1, 3,4,5,-1, 6,7,8,-1, 9,10,11,-1,
+                                           4,5,6,-1, 7,8,9,-1, 10,11,12,-1, 13,14,15,-1);
+    for (i32 i = 0; i < 2; i++)
+    {
+        __m128i lo = _mm_loadu_si128((const __m128i*)(source + 24*i));
+        __m128i hi = _mm_loadu_si128((const __m128i*)(source + 24*i + 8));
+        __m256i both = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        pix[i] = _mm256_shuffle_epi8(both, kMask);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// YUYV -> RGB
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Converts eight yuyv pixels (16 bytes) to 16-bit r, g and b values which
+ * haven't been clipped yet.
+ */
+static inline SSE2_FUNC
+void s_yuyv_to_rgb16_sse2(__m128i yuyv, __m128i& r, __m128i& g, __m128i& b)
+{
+    __m128i y  = _mm_and_si128(yuyv, _mm_set1_epi16(0x00FF));
+    __m128i uv = _mm_sub_epi16(_mm_srli_epi16(yuyv, 8), _mm_set1_epi16(128));
+    __m128i cr = _mm_srai_epi32(_mm_madd_epi16(uv, s_pair_sse2(0, kRV)), kShift);
+    __m128i cg = _mm_srai_epi32(_mm_madd_epi16(uv, s_pair_sse2(-kGU, -kGV)), kShift);
+    __m128i cb = _mm_srai_epi32(_mm_madd_epi16(uv, s_pair_sse2(kBU, 0)), kShift);
+    r = _mm_add_epi16(y, s_dup16_sse2(cr));
+    g = _mm_add_epi16(y, s_dup16_sse2(cg));
+    b = _mm_add_epi16(y, s_dup16_sse2(cb));
+}
+
+static inline AVX2_FUNC
+void s_yuyv_to_rgb16_avx2(__m256i yuyv, __m256i& r, __m256i& g, __m256i& b)
+{
+    __m256i y  = _mm256_and_si256(yuyv, _mm256_set1_epi16(0x00FF));
+    __m256i uv = _mm256_sub_epi16(_mm256_srli_epi16(yuyv, 8), _mm256_set1_epi16(128));
+    __m256i cr = _mm256_srai_epi32(_mm256_madd_epi16(uv, s_pair_avx2(0, kRV)), kShift);
+    __m256i cg = _mm256_srai_epi32(_mm256_madd_epi16(uv, s_pair_avx2(-kGU, -kGV)), kShift);
+    __m256i cb = _mm256_srai_epi32(_mm256_madd_epi16(uv, s_pair_avx2(kBU, 0)), kShift);
+    r = _mm256_add_epi16(y, s_dup16_avx2(cr));
+    g = _mm256_add_epi16(y, s_dup16_avx2(cg));
+    b = _mm256_add_epi16(y, s_dup16_avx2(cb));
+}
+
+/*
+ * Converts sixteen yuyv pixels (32 bytes) to sixteen 4-byte pixels.
+ */
+static inline SSE2_FUNC
+void s_yuyv_to_4x16_sse2(const u8* yuyv, bool bgra, __m128i* pix)
+{
+    __m128i r0, g0, b0, r1, g1, b1;
+    s_yuyv_to_rgb16_sse2(_mm_loadu_si128((const __m128i*)(yuyv)), r0, g0, b0);
+    s_yuyv_to_rgb16_sse2(_mm_loadu_si128((const __m128i*)(yuyv+16)), r1, g1, b1);
+    __m128i r = _mm_packus_epi16(r0, r1);
+    __m128i g = _mm_packus_epi16(g0, g1);
+    __m128i b = _mm_packus_epi16(b0, b1);
+    __m128i a = _mm_set1_epi8(-1);
+    if (bgra)
+        s_interleave4_sse2(b, g, r, a, pix);
+    else
+        s_interleave4_sse2(r, g, b, a, pix);
+}
+
+/*
+ * Converts thirty-two yuyv pixels (64 bytes) to thirty-two 4-byte pixels.
+ */
+static inline AVX2_FUNC
+void s_yuyv_to_4x32_avx2(const u8* yuyv, bool bgra, __m256i* pix)
+{
+    __m256i r0, g0, b0, r1, g1, b1;
+    s_yuyv_to_rgb16_avx2(_mm256_loadu_si256((const __m256i*)(yuyv)), r0, g0, b0);
+    s_yuyv_to_rgb16_avx2(_mm256_loadu_si256((const __m256i*)(yuyv+32)), r1, g1, b1);
+    __m256i r = _mm256_packus_epi16(r0, r1);
+    __m256i g = _mm256_packus_epi16(g0, g1);
+    __m256i b = _mm256_packus_epi16(b0, b1);
+    __m256i a = _mm256_set1_epi8(-1);
+    if (bgra)
+        s_interleave4_avx2(b, g, r, a, pix);
+    else
+        s_interleave4_avx2(r, g, b, a, pix);
+}
+
+static SSE2_FUNC
+void yuyv_to_rgba_sse2(const u8* yuyv, u8* rgba, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m128i pix[4];
+        s_yuyv_to_4x16_sse2(yuyv + 2*i, false, pix);
+        for (i32 j = 0; j < 4; j++)
+            _mm_storeu_si128((__m128i*)(rgba + 4*i + 16*j), pix[j]);
+    }
+    yuyv_to_rgba_scalar(yuyv + 2*i, rgba + 4*i, numPixels - i);
+}
+
+static SSE2_FUNC
+void yuyv_to_bgra_sse2(const u8* yuyv, u8* bgra, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m128i pix[4];
+        s_yuyv_to_4x16_sse2(yuyv + 2*i, true, pix);
+        for (i32 j = 0; j < 4; j++)
+            _mm_storeu_si128((__m128i*)(bgra + 4*i + 16*j), pix[j]);
+    }
+    yuyv_to_bgra_scalar(yuyv + 2*i, bgra + 4*i, numPixels - i);
+}
+
+static SSSE3_FUNC
+void yuyv_to_rgb24_ssse3(const u8* yuyv, u8* rgb, i32 numPixels)
+{
+    const __m128i kDropAlpha = _mm_setr_epi8(0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1);
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m128i pix[4];
+        s_yuyv_to_4x16_sse2(yuyv + 2*i, false, pix);
+        s_store_4x3_ssse3(rgb + 3*i, pix, kDropAlpha);
+    }
+    yuyv_to_rgb24_scalar(yuyv + 2*i, rgb + 3*i, numPixels - i);
+}
+
+static AVX2_FUNC
+void yuyv_to_rgba_avx2(const u8* yuyv, u8* rgba, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 32 <= numPixels; i += 32)
+    {
+        __m256i pix[4];
+        s_yuyv_to_4x32_avx2(yuyv + 2*i, false, pix);
+        for (i32 j = 0; j < 4; j++)
+            _mm256_storeu_si256((__m256i*)(rgba + 4*i + 32*j), pix[j]);
+    }
+    yuyv_to_rgba_sse2(yuyv + 2*i, rgba + 4*i, numPixels - i);
+}
+
+static AVX2_FUNC
+void yuyv_to_bgra_avx2(const u8* yuyv, u8* bgra, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 32 <= numPixels; i += 32)
+    {
+        __m256i pix[4];
+        s_yuyv_to_4x32_avx2(yuyv + 2*i, true, pix);
+        for (i32 j = 0; j < 4; j++)
+            _mm256_storeu_si256((__m256i*)(bgra + 4*i + 32*j), pix[j]);
+    }
+    yuyv_to_bgra_sse2(yuyv + 2*i, bgra + 4*i, numPixels - i);
+}
+
+static AVX2_FUNC
+void yuyv_to_rgb24_avx2(const u8* yuyv, u8* rgb, i32 numPixels)
+{
+    const __m128i kDropAlpha = _mm_setr_epi8(0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1);
+    i32 i = 0;
+    for (; i + 32 <= numPixels; i += 32)
+    {
+        __m256i pix[4];
+        s_yuyv_to_4x32_avx2(yuyv + 2*i, false, pix);
+        __m128i half[8];
+        for (i32 j = 0; j < 4; j++)
+        {
+            half[2*j]   = _mm256_castsi256_si128(pix[j]);
+            half[2*j+1] = _mm256_extracti128_si256(pix[j], 1);
+        }
+        s_store_4x3_ssse3(rgb + 3*i,      half,   kDropAlpha);
+        s_store_4x3_ssse3(rgb + 3*i + 48, half+4, kDropAlpha);
+    }
+    yuyv_to_rgb24_ssse3(yuyv + 2*i, rgb + 3*i, numPixels - i);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// RGB -> YUYV
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * The madd coefficients for converting 4-byte pixels to yuyv. Each pixel
+ * is split into its bytes 0 and 2 (the 'lo' pair) and bytes 1 and 3 (the
+ * 'hi' pair). Byte 3 is multiplied by zero.
+ */
+struct tYuvCoeffs
+{
+    i32 yLo[2], yHi[2];
+    i32 uLo[2], uHi[2];
+    i32 vLo[2], vHi[2];
+};
+
+static const tYuvCoeffs kRgbxCoeffs =
+{
+    { kYR,  kYB }, { kYG, 0 },
+    { -kUR, kUB }, { -kUG, 0 },
+    { kVR, -kVB }, { -kVG, 0 },
+};
+
+static const tYuvCoeffs kBgrxCoeffs =
+{
+    { kYB,  kYR }, { kYG, 0 },
+    { kUB, -kUR }, { -kUG, 0 },
+    { -kVB, kVR }, { -kVG, 0 },
+};
+
+/*
+ * Converts four 4-byte pixels into their luma (32-bit lanes 0-3) and the
+ * chroma of the two pairs (32-bit lanes u, v, u, v), not yet clipped.
+ */
+static inline SSE2_FUNC
+void s_4x4_to_yuv_sse2(__m128i pix, const tYuvCoeffs& k, __m128i& y, __m128i& c)
+{
+    const __m128i kBytes02 = _mm_set1_epi32(0x00FF00FF);
+    __m128i lo = _mm_and_si128(pix, kBytes02);
+    __m128i hi = _mm_and_si128(_mm_srli_epi32(pix, 8), kBytes02);
+    y = _mm_add_epi32(_mm_madd_epi16(lo, s_pair_sse2(k.yLo[0], k.yLo[1])),
+                      _mm_madd_epi16(hi, s_pair_sse2(k.yHi[0], k.yHi[1])));
+    y = _mm_srai_epi32(y, kShift);
+
+    // Sum each pair of pixels into the even 32-bit lanes.
+    __m128i loSum = _mm_add_epi16(lo, _mm_srli_epi64(lo, 32));
+    __m128i hiSum = _mm_add_epi16(hi, _mm_srli_epi64(hi, 32));
+    __m128i u = _mm_add_epi32(_mm_madd_epi16(loSum, s_pair_sse2(k.uLo[0], k.uLo[1])),
+                              _mm_madd_epi16(hiSum, s_pair_sse2(k.uHi[0], k.uHi[1])));
+    __m128i v = _mm_add_epi32(_mm_madd_epi16(loSum, s_pair_sse2(k.vLo[0], k.vLo[1])),
+                              _mm_madd_epi16(hiSum, s_pair_sse2(k.vHi[0], k.vHi[1])));
+    u = _mm_srai_epi32(u, kShift+1);
+    v = _mm_srai_epi32(v, kShift+1);
+    c = _mm_or_si128(_mm_and_si128(u, _mm_set_epi32(0, -1, 0, -1)), _mm_slli_epi64(v, 32));
+}
+
+static inline AVX2_FUNC
+void s_4x8_to_yuv_avx2(__m256i pix, const tYuvCoeffs& k, __m256i& y, __m256i& c)
+{
+    const __m256i kBytes02 = _mm256_set1_epi32(0x00FF00FF);
+    __m256i lo = _mm256_and_si256(pix, kBytes02);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi32(pix, 8), kBytes02);
+    y = _mm256_add_epi32(_mm256_madd_epi16(lo, s_pair_avx2(k.yLo[0], k.yLo[1])),
+                         _mm256_madd_epi16(hi, s_pair_avx2(k.yHi[0], k.yHi[1])));
+    y = _mm256_srai_epi32(y, kShift);
+
+    __m256i loSum = _mm256_add_epi16(lo, _mm256_srli_epi64(lo, 32));
+    __m256i hiSum = _mm256_add_epi16(hi, _mm256_srli_epi64(hi, 32));
+    __m256i u = _mm256_add_epi32(_mm256_madd_epi16(loSum, s_pair_avx2(k.uLo[0], k.uLo[1])),
+                                 _mm256_madd_epi16(hiSum, s_pair_avx2(k.uHi[0], k.uHi[1])));
+    __m256i v = _mm256_add_epi32(_mm256_madd_epi16(loSum, s_pair_avx2(k.vLo[0], k.vLo[1])),
+                                 _mm256_madd_epi16(hiSum, s_pair_avx2(k.vHi[0], k.vHi[1])));
+    u = _mm256_srai_epi32(u, kShift+1);
+    v = _mm256_srai_epi32(v, kShift+1);
+    c = _mm256_or_si256(_mm256_and_si256(u, _mm256_set1_epi64x(0xFFFFFFFF)), _mm256_slli_epi64(v, 32));
+}
+
+/*
+ * Converts eight 4-byte pixels (in two vectors) to 16 bytes of yuyv.
+ */
+static inline SSE2_FUNC
+__m128i s_4x8_to_yuyv_sse2(const __m128i* pix, const tYuvCoeffs& k)
+{
+    __m128i y0, c0, y1, c1;
+    s_4x4_to_yuv_sse2(pix[0], k, y0, c0);
+    s_4x4_to_yuv_sse2(pix[1], k, y1, c1);
+    __m128i y = _mm_packs_epi32(y0, y1);
+    __m128i c = _mm_add_epi16(_mm_packs_epi32(c0, c1), _mm_set1_epi16(128));
+    c = _mm_min_epi16(_mm_max_epi16(c, _mm_setzero_si128()), _mm_set1_epi16(255));
+    return _mm_or_si128(y, _mm_slli_epi16(c, 8));
+}
+
+/*
+ * Converts sixteen 4-byte pixels (0-7 and 8-15) to 32 bytes of yuyv.
+ */
+static inline AVX2_FUNC
+__m256i s_4x16_to_yuyv_avx2(const __m256i* pix, const tYuvCoeffs& k)
+{
+    __m256i y0, c0, y1, c1;
+    s_4x8_to_yuv_avx2(pix[0], k, y0, c0);
+    s_4x8_to_yuv_avx2(pix[1], k, y1, c1);
+    __m256i y = _mm256_packs_epi32(y0, y1);
+    __m256i c = _mm256_add_epi16(_mm256_packs_epi32(c0, c1), _mm256_set1_epi16(128));
+    c = _mm256_min_epi16(_mm256_max_epi16(c, _mm256_setzero_si256()), _mm256_set1_epi16(255));
+    __m256i yuyv = _mm256_or_si256(y, _mm256_slli_epi16(c, 8));
+    return _mm256_permute4x64_epi64(yuyv, 0xD8);     // undo the packs' lane order
+}
+
+static SSE2_FUNC
+void rgba_to_yuyv_sse2(const u8* rgba, u8* yuyv, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 8 <= numPixels; i += 8)
+    {
+        __m128i pix[2];
+        pix[0] = _mm_loadu_si128((const __m128i*)(rgba + 4*i));
+        pix[1] = _mm_loadu_si128((const __m128i*)(rgba + 4*i + 16));
+        _mm_storeu_si128((__m128i*)(yuyv + 2*i), s_4x8_to_yuyv_sse2(pix, kRgbxCoeffs));
+    }
+    rgba_to_yuyv_scalar(rgba + 4*i, yuyv + 2*i, numPixels - i);
+}
+
+static SSE2_FUNC
+void bgra_to_yuyv_sse2(const u8* bgra, u8* yuyv, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 8 <= numPixels; i += 8)
+    {
+        __m128i pix[2];
+        pix[0] = _mm_loadu_si128((const __m128i*)(bgra + 4*i));
+        pix[1] = _mm_loadu_si128((const __m128i*)(bgra + 4*i + 16));
+        _mm_storeu_si128((__m128i*)(yuyv + 2*i), s_4x8_to_yuyv_sse2(pix, kBgrxCoeffs));
+    }
+    bgra_to_yuyv_scalar(bgra + 4*i, yuyv + 2*i, numPixels - i);
+}
+
+static SSSE3_FUNC
+void rgb24_to_yuyv_ssse3(const u8* rgb, u8* yuyv, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 8 <= numPixels; i += 8)
+    {
+        __m128i pix[2];
+        s_load_3x8_ssse3(rgb + 3*i, pix);
+        _mm_storeu_si128((__m128i*)(yuyv + 2*i), s_4x8_to_yuyv_sse2(pix, kRgbxCoeffs));
+    }
+    rgb24_to_yuyv_scalar(rgb + 3*i, yuyv + 2*i, numPixels - i);
+}
+
+static SSE2_FUNC
+void grey_to_yuyv_sse2(const u8* grey, u8* yuyv, i32 numPixels)
+{
+    // With r == g == b the luma is the grey value and the chroma is
+    // exactly 128 (see the coefficients).
+    const __m128i k128 = _mm_set1_epi8(-128);
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m128i g = _mm_loadu_si128((const __m128i*)(grey + i));
+        _mm_storeu_si128((__m128i*)(yuyv + 2*i),      _mm_unpacklo_epi8(g, k128));
+        _mm_storeu_si128((__m128i*)(yuyv + 2*i + 16), _mm_unpackhi_epi8(g, k128));
+    }
+    grey_to_yuyv_scalar(grey + i, yuyv + 2*i, numPixels - i);
+}
+
+static AVX2_FUNC
+void rgba_to_yuyv_avx2(const u8* rgba, u8* yuyv, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m256i pix[2];
+        pix[0] = _mm256_loadu_si256((const __m256i*)(rgba + 4*i));
+        pix[1] = _mm256_loadu_si256((const __m256i*)(rgba + 4*i + 32));
+        _mm256_storeu_si256((__m256i*)(yuyv + 2*i), s_4x16_to_yuyv_avx2(pix, kRgbxCoeffs));
+    }
+    rgba_to_yuyv_sse2(rgba + 4*i, yuyv + 2*i, numPixels - i);
+}
+
+static AVX2_FUNC
+void bgra_to_yuyv_avx2(const u8* bgra, u8* yuyv, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m256i pix[2];
+        pix[0] = _mm256_loadu_si256((const __m256i*)(bgra + 4*i));
+        pix[1] = _mm256_loadu_si256((const __m256i*)(bgra + 4*i + 32));
+        _mm256_storeu_si256((__m256i*)(yuyv + 2*i), s_4x16_to_yuyv_avx2(pix, kBgrxCoeffs));
+    }
+    bgra_to_yuyv_sse2(bgra + 4*i, yuyv + 2*i, numPixels - i);
+}
+
+static AVX2_FUNC
+void rgb24_to_yuyv_avx2(const u8* rgb, u8* yuyv, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m256i pix[2];
+        s_load_3x16_avx2(rgb + 3*i, pix);
+        _mm256_storeu_si256((__m256i*)(yuyv + 2*i), s_4x16_to_yuyv_avx2(pix, kRgbxCoeffs));
+    }
+    rgb24_to_yuyv_ssse3(rgb + 3*i, yuyv + 2*i, numPixels - i);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// To grey
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Averages bytes 0-2 of eight 4-byte pixels (in two vectors), giving
+ * eight 16-bit lanes.
+ */
+static inline SSE2_FUNC
+__m128i s_4x8_to_grey16_sse2(const __m128i* pix)
+{
+    const __m128i kBytes02 = _mm_set1_epi32(0x00FF00FF);
+    const __m128i kByte1 = _mm_set1_epi32(0x000000FF);
+    __m128i sum[2];
+    for (i32 i = 0; i < 2; i++)
+    {
+        __m128i lo = _mm_and_si128(pix[i], kBytes02);
+        __m128i hi = _mm_and_si128(_mm_srli_epi32(pix[i], 8), kByte1);
+        sum[i] = _mm_madd_epi16(_mm_add_epi16(lo, hi), _mm_set1_epi16(1));
+    }
+    // x/3 == (x*21846)>>16 exactly for 0 <= x <= 765.
+    return _mm_mulhi_epu16(_mm_packs_epi32(sum[0], sum[1]), _mm_set1_epi16(21846));
+}
+
+static inline AVX2_FUNC
+__m256i s_4x16_to_grey16_avx2(const __m256i* pix)
+{
+    const __m256i kBytes02 = _mm256_set1_epi32(0x00FF00FF);
+    const __m256i kByte1 = _mm256_set1_epi32(0x000000FF);
+    __m256i sum[2];
+    for (i32 i = 0; i < 2; i++)
+    {
+        __m256i lo = _mm256_and_si256(pix[i], kBytes02);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi32(pix[i], 8), kByte1);
+        sum[i] = _mm256_madd_epi16(_mm256_add_epi16(lo, hi), _mm256_set1_epi16(1));
+    }
+    return _mm256_mulhi_epu16(_mm256_packs_epi32(sum[0], sum[1]), _mm256_set1_epi16(21846));
+}
+
+static SSE2_FUNC
+void rgbx_to_grey_sse2(const u8* rgbx, u8* grey, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m128i pix[4];
+        for (i32 j = 0; j < 4; j++)
+            pix[j] = _mm_loadu_si128((const __m128i*)(rgbx + 4*i + 16*j));
+        __m128i g = _mm_packus_epi16(s_4x8_to_grey16_sse2(pix), s_4x8_to_grey16_sse2(pix+2));
+        _mm_storeu_si128((__m128i*)(grey + i), g);
+    }
+    rgbx_to_grey_scalar(rgbx + 4*i, grey + i, numPixels - i);
+}
+
+static SSSE3_FUNC
+void rgb24_to_grey_ssse3(const u8* rgb, u8* grey, i32 numPixels)
+{
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m128i pix[4];
+        s_load_3x8_ssse3(rgb + 3*i, pix);
+        s_load_3x8_ssse3(rgb + 3*i + 24, pix+2);
+        __m128i g = _mm_packus_epi16(s_4x8_to_grey16_sse2(pix), s_4x8_to_grey16_sse2(pix+2));
+        _mm_storeu_si128((__m128i*)(grey + i), g);
+    }
+    rgb24_to_grey_scalar(rgb + 3*i, grey + i, numPixels - i);
+}
+
+static AVX2_FUNC
+void rgbx_to_grey_avx2(const u8* rgbx, u8* grey, i32 numPixels)
+{
+    // After the packs and packus, the 32-bit groups of four pixels come
+    // out in the order 0,2,4,6,1,3,5,7.
+    const __m256i kOrder = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    i32 i = 0;
+    for (; i + 32 <= numPixels; i += 32)
+    {
+        __m256i pix[4];
+        for (i32 j = 0; j < 4; j++)
+            pix[j] = _mm256_loadu_si256((const __m256i*)(rgbx + 4*i + 32*j));
+        __m256i g = _mm256_packus_epi16(s_4x16_to_grey16_avx2(pix), s_4x16_to_grey16_avx2(pix+2));
+        _mm256_storeu_si256((__m256i*)(grey + i), _mm256_permutevar8x32_epi32(g, kOrder));
+    }
+    rgbx_to_grey_sse2(rgbx + 4*i, grey + i, numPixels - i);
+}
+
+static AVX2_FUNC
+void rgb24_to_grey_avx2(const u8* rgb, u8* grey, i32 numPixels)
+{
+    const __m256i kOrder = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    i32 i = 0;
+    for (; i + 32 <= numPixels; i += 32)
+    {
+        __m256i pix[4];
+        s_load_3x16_avx2(rgb + 3*i, pix);
+        s_load_3x16_avx2(rgb + 3*i + 48, pix+2);
+        __m256i g = _mm256_packus_epi16(s_4x16_to_grey16_avx2(pix), s_4x16_to_grey16_avx2(pix+2));
+        _mm256_storeu_si256((__m256i*)(grey + i), _mm256_permutevar8x32_epi32(g, kOrder));
+    }
+    rgb24_to_grey_ssse3(rgb + 3*i, grey + i, numPixels - i);
+}
+
+static SSE2_FUNC
+void yuyv_to_grey_sse2(const u8* yuyv, u8* grey, i32 numPixels)
+{
+    const __m128i kLowBytes = _mm_set1_epi16(0x00FF);
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(yuyv + 2*i)), kLowBytes);
+        __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(yuyv + 2*i + 16)), kLowBytes);
+        _mm_storeu_si128((__m128i*)(grey + i), _mm_packus_epi16(a, b));
+    }
+    yuyv_to_grey_scalar(yuyv + 2*i, grey + i, numPixels - i);
+}
+
+static AVX2_FUNC
+void yuyv_to_grey_avx2(const u8* yuyv, u8* grey, i32 numPixels)
+{
+    const __m256i kLowBytes = _mm256_set1_epi16(0x00FF);
+    i32 i = 0;
+    for (; i + 32 <= numPixels; i += 32)
+    {
+        __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(yuyv + 2*i)), kLowBytes);
+        __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(yuyv + 2*i + 32)), kLowBytes);
+        __m256i g = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i*)(grey + i), g);
+    }
+    yuyv_to_grey_sse2(yuyv + 2*i, grey + i, numPixels - i);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// From grey
+////////////////////////////////////////////////////////////////////////////////
+
+static SSE2_FUNC
+void grey_to_rgbx_sse2(const u8* grey, u8* rgbx, i32 numPixels)
+{
+    const __m128i kAlpha = _mm_set1_epi8(-1);
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m128i g = _mm_loadu_si128((const __m128i*)(grey + i));
+        __m128i gg[2] = { _mm_unpacklo_epi8(g, g), _mm_unpackhi_epi8(g, g) };
+        __m128i ga[2] = { _mm_unpacklo_epi8(g, kAlpha), _mm_unpackhi_epi8(g, kAlpha) };
+        for (i32 j = 0; j < 2; j++)
+        {
+            _mm_storeu_si128((__m128i*)(rgbx + 4*i + 32*j),      _mm_unpacklo_epi16(gg[j], ga[j]));
+            _mm_storeu_si128((__m128i*)(rgbx + 4*i + 32*j + 16), _mm_unpackhi_epi16(gg[j], ga[j]));
+        }
+    }
+    grey_to_rgbx_scalar(grey + i, rgbx + 4*i, numPixels - i);
+}
+
+static SSSE3_FUNC
+void grey_to_rgb24_ssse3(const u8* grey, u8* rgb, i32 numPixels)
+{
+    const __m128i kMask0 = _mm_setr_epi8(0,0,0, 1,1,1, 2,2,2, 3,3,3, 4,4,4, 5);
+    const __m128i kMask1 = _mm_setr_epi8(5,5, 6,6,6, 7,7,7, 8,8,8, 9,9,9, 10,10);
+    const __m128i kMask2 = _mm_setr_epi8(10, 11,11,11, 12,12,12, 13,13,13, 14,14,14, 15,15,15);
+    i32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m128i g = _mm_loadu_si128((const __m128i*)(grey + i));
+        _mm_storeu_si128((__m128i*)(rgb + 3*i),      _mm_shuffle_epi8(g, kMask0));
+        _mm_storeu_si128((__m128i*)(rgb + 3*i + 16), _mm_shuffle_epi8(g, kMask1));
+        _mm_storeu_si128((__m128i*)(rgb + 3*i + 32), _mm_shuffle_epi8(g, kMask2));
+    }
+    grey_to_rgb24_scalar(grey + i, rgb + 3*i, numPixels - i);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Reordering bytes
+////////////////////////////////////////////////////////////////////////////////
+
+static SSSE3_FUNC
+void s_rgb24_to_4byte_ssse3(const u8* rgb, u8* dest, i32 numPixels, __m128i order)
+{
+    const __m128i kAlpha = _mm_set1_epi32((i32)0xFF000000);
+    for (i32 i = 0; i + 8 <= numPixels; i += 8)
+    {
+        __m128i pix[2];
+        s_load_3x8_ssse3(rgb + 3*i, pix);
+        for (i32 j = 0; j < 2; j++)
+        {
+            __m128i p = _mm_or_si128(_mm_shuffle_epi8(pix[j], order), kAlpha);
+            _mm_storeu_si128((__m128i*)(dest + 4*i + 16*j), p);
+        }
+    }
+}
+
+static SSSE3_FUNC
+void rgb24_to_rgba_ssse3(const u8* rgb, u8* rgba, i32 numPixels)
+{
+    const __m128i kOrder = _mm_setr_epi8(0,1,2,-1, 4,5,6,-1, 8,9,10,-1, 12,13,14,-1);
+    s_rgb24_to_4byte_ssse3(rgb, rgba, numPixels, kOrder);
+    i32 i = numPixels & ~7;
+    rgb24_to_rgba_scalar(rgb + 3*i, rgba + 4*i, numPixels - i);
+}
+
+static SSSE3_FUNC
+void rgb24_to_bgra_ssse3(const u8* rgb, u8* bgra, i32 numPixels)
+{
+    const __m128i kOrder = _mm_setr_epi8(2,1,0,-1, 6,5,4,-1, 10,9,8,-1, 14,13,12,-1);
+    s_rgb24_to_4byte_ssse3(rgb, bgra, numPixels, kOrder);
+    i32 i = numPixels & ~7;
+    rgb24_to_bgra_scalar(rgb + 3*i, bgra + 4*i, numPixels - i);
+}
+
+static SSSE3_FUNC
+void s_4byte_to_rgb24_ssse3(const u8* source, u8* rgb, i32 numPixels, __m128i order)
+{
+    for (i32 i = 0; i + 16 <= numPixels; i += 16)
+    {
+        __m128i pix[4];
+        for (i32 j = 0; j < 4; j++)
+            pix[j] = _mm_loadu_si128((const __m128i*)(source + 4*i + 16*j));
+        s_store_4x3_ssse3(rgb + 3*i, pix, order);
+    }
+}
+
+static SSSE3_FUNC
+void rgba_to_rgb24_ssse3(const u8* rgba, u8* rgb, i32 numPixels)
+{
+    const __m128i kOrder = _mm_setr_epi8(0,1,2, 4,5,6, 8,9,10, 12,13,14, -1,-1,-1,-1);
+    s_4byte_to_rgb24_ssse3(rgba, rgb, numPixels, kOrder);
+    i32 i = numPixels & ~15;
+    rgba_to_rgb24_scalar(rgba + 4*i, rgb + 3*i, numPixels - i);
+}
+
+static SSSE3_FUNC
+void bgra_to_rgb24_ssse3(const u8* bgra, u8* rgb, i32 numPixels)
+{
+    const __m128i kOrder = _mm_setr_epi8(2,1,0, 6,5,4, 10,9,8, 14,13,12, -1,-1,-1,-1);
+    s_4byte_to_rgb24_ssse3(bgra, rgb, numPixels, kOrder);
+    i32 i = numPixels & ~15;
+    bgra_to_rgb24_scalar(bgra + 4*i, rgb + 3*i, numPixels - i);
+}
+
+static SSE2_FUNC
+void swap_rb_sse2(const u8* source, u8* dest, i32 numPixels)
+{
+    const __m128i kBytes13 = _mm_set1_epi32((i32)0xFF00FF00);
+    const __m128i kByte0 = _mm_set1_epi32(0x000000FF);
+    i32 i = 0;
+    for (; i + 4 <= numPixels; i += 4)
+    {
+        __m128i p = _mm_loadu_si128((const __m128i*)(source + 4*i));
+        __m128i q = _mm_or_si128(_mm_and_si128(p, kBytes13),
+                    _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), kByte0),
+                                 _mm_slli_epi32(_mm_and_si128(p, kByte0), 16)));
+        _mm_storeu_si128((__m128i*)(dest + 4*i), q);
+    }
+    swap_rb_scalar(source + 4*i, dest + 4*i, numPixels - i);
+}
+
+static AVX2_FUNC
+void swap_rb_avx2(const u8* source, u8* dest, i32 numPixels)
+{
+    const __m256i kOrder = _mm256_setr_epi8(2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15,
+                                            2,1,0,3, 6,5,4,7, 10,9,8,11, 14,13,12,15);
+    i32 i = 0;
+    for (; i + 8 <= numPixels; i += 8)
+    {
+        __m256i p = _mm256_loadu_si256((const __m256i*)(source + 4*i));
+        _mm256_storeu_si256((__m256i*)(dest + 4*i), _mm256_shuffle_epi8(p, kOrder));
+    }
+    swap_rb_sse2(source + 4*i, dest + 4*i, numPixels - i);
+}
+
+
+#undef SSE2_FUNC
+#undef SSSE3_FUNC
+#undef AVX2_FUNC
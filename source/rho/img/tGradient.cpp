@@ -0,0 +1,306 @@
+#if __linux__
+#pragma GCC optimize 3
+#endif
+
+#include <rho/img/tGradient.h>
+#include <rho/img/tImage.h>
+#include <rho/img/tImageView.h>
+#include <rho/eRho.h>
+#include <rho/sync/parallel_util.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+
+namespace rho
+{
+namespace img
+{
+
+
+/*
+ * How many bands to split the rows into, per thread of the pool.
+ */
+static const u32 kBandsPerThread = 4;
+
+
+/*
+ * round(sqrt(s)), exactly. A float square root gets within one of it,
+ * but Scharr's sums of squares need up to 26 bits, more than a float
+ * holds, so the estimate r is nudged until r^2 - r < s <= r^2 + r
+ * (or, for r = 0, just s <= 0). No s is exactly halfway, so there are
+ * no ties. The vector kernels do the same.
+ */
+static inline
+u16 s_roundSqrt(i32 s)
+{
+    i32 r = (i32) lrintf(std::sqrt((f32)s));
+    if (s > r*r + r)
+        r++;
+    else if (r > 0 && s <= r*r - r)
+        r--;
+    return (u16) r;
+}
+
+template <bool kL2>
+static inline
+u16 s_magnitude(i32 gx, i32 gy)
+{
+    if (kL2)
+        return s_roundSqrt(gx*gx + gy*gy);
+    return (u16) (std::abs(gx) + std::abs(gy));
+}
+
+/*
+ * tan(22.5 degrees) and tan(67.5 degrees), in 256ths.
+ */
+static const i32 kTan22 = 106;
+static const i32 kTan67 = 618;
+
+static inline
+u8 s_orientation(i32 gx, i32 gy)
+{
+    i32 ax = std::abs(gx);
+    i32 ay = std::abs(gy);
+    if (256*ay <= kTan22*ax)
+        return kGradientHorizontal;
+    if (256*ay >= kTan67*ax)
+        return kGradientVertical;
+    return ((gx ^ gy) >= 0) ? kGradientDiagonalDown : kGradientDiagonalUp;
+}
+
+/*
+ * Computes 'n' outputs of one row. Output byte o (of the pixel row less
+ * its first and last pixel) is centred on byte o+bpp of 'row1', so its
+ * neighbours to the left and right are bytes o and o+2*bpp of each row.
+ */
+template <bool kScharr, bool kL2>
+static
+void s_gradientRow_scalar(const u8* row0, const u8* row1, const u8* row2,
+                          u32 n, u32 bpp, u16* magnitude, u8* orientation)
+{
+    for (u32 o = 0; o < n; o++)
+    {
+        i32 a = row0[o], b = row0[o+bpp], c = row0[o+2*bpp];
+        i32 d = row1[o],                  f = row1[o+2*bpp];
+        i32 g = row2[o], h = row2[o+bpp], i = row2[o+2*bpp];
+
+        i32 gx, gy;
+        if (kScharr)
+        {
+            gx = 3*(a-c) + 10*(d-f) + 3*(g-i);
+            gy = 3*(a-g) + 10*(b-h) + 3*(c-i);
+        }
+        else
+        {
+            gx = (a-c) + 2*(d-f) + (g-i);
+            gy = (a-g) + 2*(b-h) + (c-i);
+        }
+
+        magnitude[o] = s_magnitude<kL2>(gx, gy);
+        if (orientation)
+            orientation[o] = s_orientation(gx, gy);
+    }
+}
+
+
+#if __i386__ || __x86_64__
+#include "tGradient_x86.ipp"
+#define X86_KERNEL(f) f
+#else
+#define X86_KERNEL(f) NULL
+#endif
+
+
+typedef void (*tGradientKernel)(const u8* row0, const u8* row1, const u8* row2,
+                                u32 n, u32 bpp, u16* magnitude, u8* orientation);
+
+
+static
+tGradientKernel s_pickKernel(nGradientOperator op, nGradientNorm norm, nSimdLevel level)
+{
+    bool scharr = (op == kGradientScharr);
+    bool l2 = (norm == kGradientL2);
+
+    tGradientKernel kernel;
+    if (scharr)
+        kernel = l2 ? s_gradientRow_scalar<true, true> : s_gradientRow_scalar<true, false>;
+    else
+        kernel = l2 ? s_gradientRow_scalar<false, true> : s_gradientRow_scalar<false, false>;
+
+    if (level >= kSimdSSE2)
+    {
+        if (scharr)
+            kernel = l2 ? X86_KERNEL((s_gradientRow_sse2<true, true>))
+                        : X86_KERNEL((s_gradientRow_sse2<true, false>));
+        else
+            kernel = l2 ? X86_KERNEL((s_gradientRow_sse2<false, true>))
+                        : X86_KERNEL((s_gradientRow_sse2<false, false>));
+    }
+    if (level >= kSimdAVX2)
+    {
+        if (scharr)
+            kernel = l2 ? X86_KERNEL((s_gradientRow_avx2<true, true>))
+                        : X86_KERNEL((s_gradientRow_avx2<true, false>));
+        else
+            kernel = l2 ? X86_KERNEL((s_gradientRow_avx2<false, true>))
+                        : X86_KERNEL((s_gradientRow_avx2<false, false>));
+    }
+    return kernel;
+}
+
+
+tGradient::tGradient(nGradientOperator op, nGradientNorm norm, bool withOrientation)
+    : m_op(op),
+      m_norm(norm),
+      m_withOrientation(withOrientation)
+{
+    m_init(getSimdLevel());
+}
+
+tGradient::tGradient(nGradientOperator op, nGradientNorm norm, bool withOrientation,
+                     nSimdLevel maxLevel)
+    : m_op(op),
+      m_norm(norm),
+      m_withOrientation(withOrientation)
+{
+    m_init(maxLevel);
+}
+
+void tGradient::m_init(nSimdLevel maxLevel)
+{
+    if ((i32)m_op < 0 || m_op >= kMaxGradientOperator)
+        throw eInvalidArgument("Invalid gradient operator.");
+    if ((i32)m_norm < 0 || m_norm >= kMaxGradientNorm)
+        throw eInvalidArgument("Invalid gradient norm.");
+
+    m_level = std::min(maxLevel, getSimdLevel());
+    m_width = 0;
+    m_height = 0;
+    m_channels = 0;
+}
+
+void tGradient::m_prepare(const tImageView& view)
+{
+    if (view.width() < 3 || view.height() < 3)
+    {
+        throw eInvalidArgument("Cannot run the Sobel operator on an image "
+                "that is less than 3x3 pixels.");
+    }
+
+    u32 bpp = getBPP(view.format());
+    if (view.bpp() != bpp)
+        throw eLogicError("Something is wack with the given image.");
+
+    m_width = view.width() - 2;
+    m_height = view.height() - 2;
+    m_channels = bpp;
+
+    size_t size = (size_t)m_width * m_height * m_channels;
+    m_magnitude.resize(size);
+    if (m_withOrientation)
+        m_orientation.resize(size);
+    else
+        m_orientation.clear();
+}
+
+void tGradient::computeRows(const tImageView& view, u32 rowBegin, u32 rowEnd)
+{
+    tGradientKernel kernel = s_pickKernel(m_op, m_norm, m_level);
+    u32 stride = view.stride();
+    u32 n = m_width * m_channels;
+
+    for (u32 row = rowBegin; row < rowEnd; row++)
+    {
+        const u8* row0 = view.buf() + (size_t)row * stride;
+        size_t offset = (size_t)row * n;
+        kernel(row0, row0 + stride, row0 + 2*stride, n, m_channels,
+               &m_magnitude[offset],
+               m_withOrientation ? &m_orientation[offset] : NULL);
+    }
+}
+
+void tGradient::compute(const tImage* image)
+{
+    compute(tImageView(*image));
+}
+
+void tGradient::compute(const tImage* image, sync::tThreadPool& pool)
+{
+    compute(tImageView(*image), pool);
+}
+
+void tGradient::compute(const tImageView& view)
+{
+    m_prepare(view);
+    computeRows(view, 0, m_height);
+}
+
+class tGradientBands
+{
+    public:
+
+        tGradientBands(tGradient& gradient, const tImageView& view)
+            : m_gradient(gradient), m_view(view)
+        {
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            m_gradient.computeRows(m_view, rowBegin, rowEnd);
+        }
+
+    private:
+
+        tGradient&        m_gradient;
+        const tImageView& m_view;
+};
+
+void tGradient::compute(const tImageView& view, sync::tThreadPool& pool)
+{
+    m_prepare(view);
+
+    u32 numBands = pool.getNumThreads() * kBandsPerThread;
+    u32 grain = std::max((m_height + numBands - 1) / numBands, (u32)1);
+    tGradientBands bands(*this, view);
+    sync::parallelFor(pool, 0, m_height, grain, bands);
+}
+
+u32 tGradient::width() const
+{
+    return m_width;
+}
+
+u32 tGradient::height() const
+{
+    return m_height;
+}
+
+u32 tGradient::channels() const
+{
+    return m_channels;
+}
+
+const u16* tGradient::magnitude() const
+{
+    return m_magnitude.empty() ? NULL : &m_magnitude[0];
+}
+
+const u8* tGradient::orientation() const
+{
+    return m_orientation.empty() ? NULL : &m_orientation[0];
+}
+
+u16 tGradient::maxMagnitude() const
+{
+    // Each of gx and gy is at most (sum of one column's weights) * 255.
+    u32 component = (m_op == kGradientScharr) ? 16 * 255 : 4 * 255;
+    if (m_norm == kGradientL1)
+        return (u16) (2 * component);
+    return s_roundSqrt((i32)(2 * component * component));
+}
+
+
+}  // namespace img
+}  // namespace rho
@@ -0,0 +1,264 @@
+/*
+ * SSE2 / AVX2 versions of the row kernel in tGradient.cpp.
+ *
+ * This file is included by tGradient.cpp on x86 machines only, and every
+ * function has a target attribute; see nImageFormat_x86.ipp.
+ *
+ * Each vector holds consecutive output bytes, whatever the bytes per
+ * pixel: the left and right neighbours of output byte o are bytes o and
+ * o+2*bpp, so the neighbours of a run of outputs are just runs of bytes
+ * at other offsets. gx and gy fit in 16-bit lanes (Scharr's reach
+ * +-8160). The L2 magnitude is rounded exactly as the scalar kernel
+ * rounds it (see s_roundSqrt() there), and the direction tests are the scalar kernel's,
+ * with the tangents multiplied in by _mm_madd_epi16().
+ */
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+
+#define SSE2_FUNC  __attribute__((target("sse2")))
+#define AVX2_FUNC  __attribute__((target("avx2")))
+
+
+/*
+ * A 32-bit lane holding the 16-bit values (lo, hi).
+ */
+static inline
+i32 s_gradientPair(i32 lo, i32 hi)
+{
+    return (i32)((u32)(u16)lo | ((u32)(u16)hi << 16));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// SSE2: eight outputs per step
+////////////////////////////////////////////////////////////////////////////////
+
+static inline SSE2_FUNC
+__m128i s_load8_sse2(const u8* p)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+}
+
+static inline SSE2_FUNC
+__m128i s_abs16_sse2(__m128i v)
+{
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+/*
+ * s_roundSqrt() on each 32-bit lane. r fits in 16 bits, so r^2 + r and
+ * r^2 - r are each one _mm_madd_epi16() of (r, r) with (r, 1) or (r, -1).
+ */
+static inline SSE2_FUNC
+__m128i s_roundSqrt_sse2(__m128i s)
+{
+    __m128i r = _mm_cvtps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(s)));
+    __m128i rr = _mm_or_si128(r, _mm_slli_epi32(r, 16));
+    __m128i above = _mm_madd_epi16(rr, _mm_or_si128(r, _mm_set1_epi32(s_gradientPair(0, 1))));
+    __m128i below = _mm_madd_epi16(rr, _mm_or_si128(r, _mm_set1_epi32(s_gradientPair(0, -1))));
+    __m128i tooLow = _mm_cmpgt_epi32(s, above);
+    __m128i tooHigh = _mm_and_si128(_mm_cmpgt_epi32(_mm_add_epi32(below, _mm_set1_epi32(1)), s),
+                                    _mm_cmpgt_epi32(r, _mm_setzero_si128()));
+    return _mm_add_epi32(_mm_sub_epi32(r, tooLow), tooHigh);
+}
+
+template <bool kScharr, bool kL2>
+static SSE2_FUNC
+void s_gradientRow_sse2(const u8* row0, const u8* row1, const u8* row2,
+                        u32 n, u32 bpp, u16* magnitude, u8* orientation)
+{
+    const __m128i three = _mm_set1_epi16(3);
+    const __m128i ten = _mm_set1_epi16(10);
+    const __m128i tan22 = _mm_set1_epi32(s_gradientPair(256, -kTan22));
+    const __m128i tan67 = _mm_set1_epi32(s_gradientPair(256, -kTan67));
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i twos = _mm_set1_epi16(2);
+
+    u32 o = 0;
+    for (; o + 8 <= n; o += 8)
+    {
+        __m128i a = s_load8_sse2(row0 + o);
+        __m128i b = s_load8_sse2(row0 + o + bpp);
+        __m128i c = s_load8_sse2(row0 + o + 2*bpp);
+        __m128i d = s_load8_sse2(row1 + o);
+        __m128i f = s_load8_sse2(row1 + o + 2*bpp);
+        __m128i g = s_load8_sse2(row2 + o);
+        __m128i h = s_load8_sse2(row2 + o + bpp);
+        __m128i i = s_load8_sse2(row2 + o + 2*bpp);
+
+        __m128i gx, gy;
+        if (kScharr)
+        {
+            gx = _mm_add_epi16(_mm_mullo_epi16(three, _mm_add_epi16(_mm_sub_epi16(a, c), _mm_sub_epi16(g, i))),
+                               _mm_mullo_epi16(ten, _mm_sub_epi16(d, f)));
+            gy = _mm_add_epi16(_mm_mullo_epi16(three, _mm_add_epi16(_mm_sub_epi16(a, g), _mm_sub_epi16(c, i))),
+                               _mm_mullo_epi16(ten, _mm_sub_epi16(b, h)));
+        }
+        else
+        {
+            gx = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(a, c), _mm_sub_epi16(g, i)),
+                               _mm_slli_epi16(_mm_sub_epi16(d, f), 1));
+            gy = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(a, g), _mm_sub_epi16(c, i)),
+                               _mm_slli_epi16(_mm_sub_epi16(b, h), 1));
+        }
+
+        __m128i ax = s_abs16_sse2(gx);
+        __m128i ay = s_abs16_sse2(gy);
+
+        __m128i mag;
+        if (kL2)
+        {
+            __m128i lo = _mm_unpacklo_epi16(gx, gy);
+            __m128i hi = _mm_unpackhi_epi16(gx, gy);
+            lo = s_roundSqrt_sse2(_mm_madd_epi16(lo, lo));
+            hi = s_roundSqrt_sse2(_mm_madd_epi16(hi, hi));
+            mag = _mm_packs_epi32(lo, hi);
+        }
+        else
+        {
+            mag = _mm_add_epi16(ax, ay);
+        }
+        _mm_storeu_si128((__m128i*)(magnitude + o), mag);
+
+        if (orientation)
+        {
+            // 256*|gy| - tan*|gx|, as 32-bit lanes.
+            __m128i lo = _mm_unpacklo_epi16(ay, ax);
+            __m128i hi = _mm_unpackhi_epi16(ay, ax);
+            __m128i horiz = _mm_packs_epi32(_mm_cmpgt_epi32(_mm_madd_epi16(lo, tan22), zero),
+                                            _mm_cmpgt_epi32(_mm_madd_epi16(hi, tan22), zero));
+            horiz = _mm_xor_si128(horiz, _mm_set1_epi16(-1));     // <-- <= 0
+            __m128i vert = _mm_packs_epi32(_mm_cmplt_epi32(_mm_madd_epi16(lo, tan67), zero),
+                                           _mm_cmplt_epi32(_mm_madd_epi16(hi, tan67), zero));
+            vert = _mm_andnot_si128(_mm_or_si128(vert, horiz), _mm_set1_epi16(-1));  // <-- >= 0, and not horiz
+            __m128i diag = _mm_andnot_si128(_mm_or_si128(horiz, vert), _mm_set1_epi16(-1));
+            __m128i diffSign = _mm_srai_epi16(_mm_xor_si128(gx, gy), 15);
+
+            __m128i dir = _mm_and_si128(vert, twos);
+            dir = _mm_or_si128(dir, _mm_and_si128(diag, ones));
+            dir = _mm_or_si128(dir, _mm_and_si128(_mm_and_si128(diag, diffSign), twos));
+            _mm_storel_epi64((__m128i*)(orientation + o), _mm_packus_epi16(dir, dir));
+        }
+    }
+
+    s_gradientRow_scalar<kScharr, kL2>(row0 + o, row1 + o, row2 + o, n - o, bpp,
+                                       magnitude + o, orientation ? orientation + o : NULL);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// AVX2: sixteen outputs per step
+////////////////////////////////////////////////////////////////////////////////
+
+static inline AVX2_FUNC
+__m256i s_load16_avx2(const u8* p)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)p));
+}
+
+static inline AVX2_FUNC
+__m256i s_roundSqrt_avx2(__m256i s)
+{
+    __m256i r = _mm256_cvtps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(s)));
+    __m256i rr = _mm256_or_si256(r, _mm256_slli_epi32(r, 16));
+    __m256i above = _mm256_madd_epi16(rr, _mm256_or_si256(r, _mm256_set1_epi32(s_gradientPair(0, 1))));
+    __m256i below = _mm256_madd_epi16(rr, _mm256_or_si256(r, _mm256_set1_epi32(s_gradientPair(0, -1))));
+    __m256i tooLow = _mm256_cmpgt_epi32(s, above);
+    __m256i tooHigh = _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_add_epi32(below, _mm256_set1_epi32(1)), s),
+                                       _mm256_cmpgt_epi32(r, _mm256_setzero_si256()));
+    return _mm256_add_epi32(_mm256_sub_epi32(r, tooLow), tooHigh);
+}
+
+/*
+ * The unpacks below work within each 128-bit half, and the packs put
+ * the halves back in order, so the lanes come out where they went in.
+ */
+template <bool kScharr, bool kL2>
+static AVX2_FUNC
+void s_gradientRow_avx2(const u8* row0, const u8* row1, const u8* row2,
+                        u32 n, u32 bpp, u16* magnitude, u8* orientation)
+{
+    const __m256i three = _mm256_set1_epi16(3);
+    const __m256i ten = _mm256_set1_epi16(10);
+    const __m256i tan22 = _mm256_set1_epi32(s_gradientPair(256, -kTan22));
+    const __m256i tan67 = _mm256_set1_epi32(s_gradientPair(256, -kTan67));
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i allOnes = _mm256_set1_epi16(-1);
+    const __m256i ones = _mm256_set1_epi16(1);
+    const __m256i twos = _mm256_set1_epi16(2);
+
+    u32 o = 0;
+    for (; o + 16 <= n; o += 16)
+    {
+        __m256i a = s_load16_avx2(row0 + o);
+        __m256i b = s_load16_avx2(row0 + o + bpp);
+        __m256i c = s_load16_avx2(row0 + o + 2*bpp);
+        __m256i d = s_load16_avx2(row1 + o);
+        __m256i f = s_load16_avx2(row1 + o + 2*bpp);
+        __m256i g = s_load16_avx2(row2 + o);
+        __m256i h = s_load16_avx2(row2 + o + bpp);
+        __m256i i = s_load16_avx2(row2 + o + 2*bpp);
+
+        __m256i gx, gy;
+        if (kScharr)
+        {
+            gx = _mm256_add_epi16(_mm256_mullo_epi16(three, _mm256_add_epi16(_mm256_sub_epi16(a, c), _mm256_sub_epi16(g, i))),
+                                  _mm256_mullo_epi16(ten, _mm256_sub_epi16(d, f)));
+            gy = _mm256_add_epi16(_mm256_mullo_epi16(three, _mm256_add_epi16(_mm256_sub_epi16(a, g), _mm256_sub_epi16(c, i))),
+                                  _mm256_mullo_epi16(ten, _mm256_sub_epi16(b, h)));
+        }
+        else
+        {
+            gx = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(a, c), _mm256_sub_epi16(g, i)),
+                                  _mm256_slli_epi16(_mm256_sub_epi16(d, f), 1));
+            gy = _mm256_add_epi16(_mm256_add_epi16(_mm256_sub_epi16(a, g), _mm256_sub_epi16(c, i)),
+                                  _mm256_slli_epi16(_mm256_sub_epi16(b, h), 1));
+        }
+
+        __m256i ax = _mm256_abs_epi16(gx);
+        __m256i ay = _mm256_abs_epi16(gy);
+
+        __m256i mag;
+        if (kL2)
+        {
+            __m256i lo = _mm256_unpacklo_epi16(gx, gy);
+            __m256i hi = _mm256_unpackhi_epi16(gx, gy);
+            lo = s_roundSqrt_avx2(_mm256_madd_epi16(lo, lo));
+            hi = s_roundSqrt_avx2(_mm256_madd_epi16(hi, hi));
+            mag = _mm256_packs_epi32(lo, hi);
+        }
+        else
+        {
+            mag = _mm256_add_epi16(ax, ay);
+        }
+        _mm256_storeu_si256((__m256i*)(magnitude + o), mag);
+
+        if (orientation)
+        {
+            __m256i lo = _mm256_unpacklo_epi16(ay, ax);
+            __m256i hi = _mm256_unpackhi_epi16(ay, ax);
+            __m256i horiz = _mm256_packs_epi32(_mm256_cmpgt_epi32(_mm256_madd_epi16(lo, tan22), zero),
+                                               _mm256_cmpgt_epi32(_mm256_madd_epi16(hi, tan22), zero));
+            horiz = _mm256_xor_si256(horiz, allOnes);
+            __m256i vert = _mm256_packs_epi32(_mm256_cmpgt_epi32(zero, _mm256_madd_epi16(lo, tan67)),
+                                              _mm256_cmpgt_epi32(zero, _mm256_madd_epi16(hi, tan67)));
+            vert = _mm256_andnot_si256(_mm256_or_si256(vert, horiz), allOnes);
+            __m256i diag = _mm256_andnot_si256(_mm256_or_si256(horiz, vert), allOnes);
+            __m256i diffSign = _mm256_srai_epi16(_mm256_xor_si256(gx, gy), 15);
+
+            __m256i dir = _mm256_and_si256(vert, twos);
+            dir = _mm256_or_si256(dir, _mm256_and_si256(diag, ones));
+            dir = _mm256_or_si256(dir, _mm256_and_si256(_mm256_and_si256(diag, diffSign), twos));
+
+            // Bytes 0-7 and 8-15 end up in the first and third 64-bit lanes.
+            __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(dir, dir), 0x08);
+            _mm_storeu_si128((__m128i*)(orientation + o), _mm256_castsi256_si128(packed));
+        }
+    }
+
+    s_gradientRow_scalar<kScharr, kL2>(row0 + o, row1 + o, row2 + o, n - o, bpp,
+                                       magnitude + o, orientation ? orientation + o : NULL);
+}
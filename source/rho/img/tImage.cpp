@@ -3,7 +3,13 @@
 #endif
 
 #include <rho/img/tImage.h>
+#include <rho/img/tGradient.h>
+#include <rho/img/tImageView.h>
+#include <rho/img/tIntegralImage.h>
 #include <rho/eRho.h>
+#include <rho/sync/parallel_util.h>
+#include <rho/sync/tAutoSync.h>
+#include <rho/sync/tMutex.h>
 
 #include <algorithm>
 #include <cmath>
@@ -21,6 +27,7 @@ namespace img
 
 tImage::tImage()
     : m_buf(new u8[1024]),
+      m_ownsBuf(true),
       m_bufSize(1024),
       m_bufUsed(0),
       m_width(0),
@@ -31,6 +38,7 @@ tImage::tImage()
 
 tImage::tImage(u32 bufSize)
     : m_buf(new u8[bufSize]),
+      m_ownsBuf(true),
       m_bufSize(bufSize),
       m_bufUsed(0),
       m_width(0),
@@ -41,6 +49,7 @@ tImage::tImage(u32 bufSize)
 
 tImage::tImage(std::string filepath, nImageFormat format)
     : m_buf(NULL),
+      m_ownsBuf(true),
       m_bufSize(0),
       m_bufUsed(0),
       m_width(0),
@@ -54,6 +63,9 @@ tImage::tImage(std::string filepath, nImageFormat format)
         case kRGB16:
         case kRGB24:
         case kYUYV:
+        case kI420:
+        case kNV12:
+        case kRGBPlanar:
             req = 3;
             readFormat = kRGB24;
             break;
@@ -92,7 +104,7 @@ tImage::tImage(std::string filepath, nImageFormat format)
 
 tImage::~tImage()
 {
-    if (m_buf)
+    if (m_buf && m_ownsBuf)
         delete [] m_buf;
     m_buf = NULL;
     m_bufSize = 0;
@@ -123,6 +135,9 @@ void tImage::saveToFile(std::string filepath) const
         case kRGB16:
         case kRGB24:
         case kYUYV:
+        case kI420:
+        case kNV12:
+        case kRGBPlanar:
             saveFormat = LCT_RGB;
             needFormat = kRGB24;
             break;
@@ -164,9 +179,10 @@ void tImage::saveToFile(std::string filepath) const
 
 void tImage::setBufSize(u32 bufSize)
 {
-    if (m_buf)
+    if (m_buf && m_ownsBuf)
         delete [] m_buf;
     m_buf = new u8[bufSize];
+    m_ownsBuf = true;
     m_bufSize = bufSize;
 }
 
@@ -308,149 +324,136 @@ void s_crop(const tImage* image, geo::tRect rect, tImage* dest)
     if (image == dest)
         throw eInvalidArgument("s_crop(): source and destination must be different objects");
 
-    if (image->width() == 0 || image->height() == 0)
+    tImageView view;
+    tImageView(*image).crop(rect, &view);
+    view.copyTo(dest);
+}
+
+/*
+ * Several bands per thread, so that a thread which finishes early can
+ * steal some of the remaining rows.
+ */
+static const u32 kBandsPerThread = 4;
+
+/*
+ * Calls bands(rowBegin, rowEnd) so that the calls together cover
+ * [0, numRows). With no pool, that's a single call on this thread.
+ */
+template <class F>
+static
+void s_runBands(sync::tThreadPool* pool, u32 numRows, F& bands)
+{
+    if (pool == NULL || pool->getNumThreads() <= 1)
     {
-        dest->setBufUsed(0);
-        dest->setWidth(0);
-        dest->setHeight(0);
-        dest->setFormat(image->format());
+        bands(0, numRows);
         return;
     }
 
-    if (image->bufUsed() % (image->width() * image->height()))
-        throw eLogicError("Something is wack with the given image.");
-
-    i32 bpp = image->bufUsed() / (image->width() * image->height());
-
-    if (rect.x < 0.0)
-        rect.x = 0.0;
-
-    if (rect.y < 0.0)
-        rect.y = 0.0;
-
-    if (rect.x > image->width())
-        rect.x = image->width();
-
-    if (rect.y > image->height())
-        rect.y = image->height();
-
-    if (rect.width < 0.0)
-        rect.width = 0.0;
-
-    if (rect.height < 0.0)
-        rect.height = 0.0;
-
-    if ((rect.x + rect.width) > image->width())
-        rect.width = image->width() - rect.x;
-
-    if ((rect.y + rect.height) > image->height())
-        rect.height = image->height() - rect.y;
-
-    u32 x = (u32) rect.x;
-    u32 y = (u32) rect.y;
-    u32 width = (u32) rect.width;
-    u32 height = (u32) rect.height;
-
-    dest->setBufUsed(width * height * bpp);
-    dest->setWidth(width);
-    dest->setHeight(height);
-    dest->setFormat(image->format());
-
-    if (dest->bufSize() < dest->bufUsed())
-        dest->setBufSize(dest->bufUsed());
-
-    const u8* sbuf = image->buf() + (y*image->width() + x) * bpp;
-    u8* dbuf = dest->buf();
-
-    for (u32 j = 0; j < height; j++)
-    {
-        u32 numbytes = width * bpp;
-        memcpy(dbuf, sbuf, numbytes);
-        dbuf += numbytes;
-        sbuf += numbytes;
-        sbuf += (image->width() - width) * bpp;
-    }
+    u32 numBands = pool->getNumThreads() * kBandsPerThread;
+    u32 grain = (numRows + numBands - 1) / numBands;
+    if (grain == 0)
+        grain = 1;
+    sync::parallelFor(*pool, 0, numRows, grain, bands);
 }
 
 static
-u8 s_avg(const tImage* image, geo::tRect rect, u32 pixOffset, u32 bpp)   // helper for s_scale()
+u8 s_avg(const tImageView& image, geo::tRect rect, u32 pixOffset, u32 bpp)   // helper for s_scale()
 {
     u32 x = (u32) rect.x;
     u32 y = (u32) rect.y;
     u32 xend = (u32) std::ceil(rect.x + rect.width);
     u32 yend = (u32) std::ceil(rect.y + rect.height);
 
-    if (xend > image->width())
-        xend = image->width();
-    if (yend > image->height())
-        yend = image->height();
+    if (xend > image.width())
+        xend = image.width();
+    if (yend > image.height())
+        yend = image.height();
 
-    const u8* buf = image->buf() + (y*image->width() + x) * bpp + pixOffset;
+    const u8* buf = image.buf() + (size_t)y*image.stride() + x*bpp + pixOffset;
 
     u32 numpix = (xend-x) * (yend-y);
 
-    u8 avg = 0;
-    u32 count = 0;
+    u64 sum = 0;
     for (u32 r = y; r < yend; r++)
     {
         for (u32 c = x; c < xend; c++)
         {
-            count += *buf;
-            while (count >= numpix)
-            {
-                avg++;
-                count -= numpix;
-            }
+            sum += *buf;
             buf += bpp;
         }
-        buf += (image->width() - xend+x) * bpp;
+        buf += image.stride() - (xend-x) * bpp;
     }
 
-    return avg;
+    return (u8) (sum / numpix);
 }
 
+class tScaleBands
+{
+    public:
+
+        tScaleBands(const tImageView& from, tImage* to, u32 bpp)
+            : m_from(from), m_to(to), m_bpp(bpp)
+        {
+            m_wStretch = ((f64)from.width()) / to->width();
+            m_hStretch = ((f64)from.height()) / to->height();
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            u8* tbuf = m_to->buf() + rowBegin * m_to->width() * m_bpp;
+
+            geo::tRect rect(0.0, 0.0, m_wStretch, m_hStretch);
+
+            // Get to this band's first row the same way the rows above
+            // got to theirs, so that every band rounds the same way.
+            for (u32 h = 0; h < rowBegin; h++)
+                rect.y += m_hStretch;
+
+            for (u32 h = rowBegin; h < rowEnd; h++)
+            {
+                rect.x = 0.0;
+                for (u32 w = 0; w < m_to->width(); w++)
+                {
+                    for (u32 i = 0; i < m_bpp; i++)
+                    {
+                        *tbuf++ = s_avg(m_from, rect, i, m_bpp);
+                    }
+                    rect.x += m_wStretch;
+                }
+                rect.y += m_hStretch;
+            }
+        }
+
+    private:
+
+        tImageView    m_from;
+        tImage*       m_to;
+        u32           m_bpp;
+        f64           m_wStretch;
+        f64           m_hStretch;
+};
+
 static
-void s_scale(const tImage* from, u32 width, u32 height, tImage* to)
+void s_scale(const tImageView& from, u32 width, u32 height, tImage* to, sync::tThreadPool* pool)
 {
-    if (from == to)
+    if (from.looksInto(to))
         throw eInvalidArgument("s_scale(): source and destination must be different objects");
 
-    if (from->width() == 0 || from->height() == 0)
+    if (from.width() == 0 || from.height() == 0)
         throw eInvalidArgument("s_scale(): cannot scale an image of no width or no height");
 
-    if (from->bufUsed() % (from->width() * from->height()))
-        throw eLogicError("Something is wack with the given image.");
-
-    u32 bpp = from->bufUsed() / (from->width() * from->height());
+    u32 bpp = from.bpp();
 
     to->setBufUsed(width*height*bpp);
     to->setWidth(width);
     to->setHeight(height);
-    to->setFormat(from->format());
+    to->setFormat(from.format());
 
     if (to->bufSize() < to->bufUsed())
         to->setBufSize(to->bufUsed());
 
-    u8* tbuf = to->buf();
-
-    f64 wStretch = ((f64)from->width()) / to->width();
-    f64 hStretch = ((f64)from->height()) / to->height();
-
-    geo::tRect rect(0.0, 0.0, wStretch, hStretch);
-
-    for (u32 h = 0; h < height; h++)
-    {
-        rect.x = 0.0;
-        for (u32 w = 0; w < width; w++)
-        {
-            for (u32 i = 0; i < bpp; i++)
-            {
-                *tbuf++ = s_avg(from, rect, i, bpp);
-            }
-            rect.x += wStretch;
-        }
-        rect.y += hStretch;
-    }
+    tScaleBands bands(from, to, bpp);
+    s_runBands(pool, height, bands);
 }
 
 void tImage::verticalFlip()
@@ -473,17 +476,56 @@ void tImage::crop(geo::tRect rect, tImage* dest)  const
     s_crop(this, rect, dest);
 }
 
+void tImage::crop(geo::tRect rect, tImageView* dest) const
+{
+    tImageView(*this).crop(rect, dest);
+}
+
 void tImage::scale(u32 width, u32 height, tImage* dest)  const
 {
-    s_scale(this, width, height, dest);
+    s_scale(tImageView(*this), width, height, dest, NULL);
+}
+
+void tImage::scale(u32 width, u32 height, tImage* dest,
+                   sync::tThreadPool& pool) const
+{
+    s_scale(tImageView(*this), width, height, dest, &pool);
 }
 
+void tImage::scale(u32 width, u32 height, nScaleFilter filter, tImage* dest) const
+{
+    tScaler scaler(this->width(), this->height(), width, height, filter);
+    scaler.scale(this, dest);
+}
+
+void tImageView::scale(u32 width, u32 height, tImage* dest) const
+{
+    s_scale(*this, width, height, dest, NULL);
+}
+
+void tImageView::scale(u32 width, u32 height, tImage* dest,
+                       sync::tThreadPool& pool) const
+{
+    s_scale(*this, width, height, dest, &pool);
+}
+
+void tImageView::scale(u32 width, u32 height, nScaleFilter filter, tImage* dest) const
+{
+    tScaler scaler(m_width, m_height, width, height, filter);
+    scaler.scale(*this, dest);
+}
+
+/*
+ * Only rows in [rowBegin, rowEnd) are touched, so that bands of the canvas
+ * can be drawn independently.
+ */
 static
-void s_colorImageAtPoint(tImage* image, i32 npix, i32 x, i32 y, const u8* colorBuf, double percentage)
+void s_colorImageAtPoint(tImage* image, i32 npix, i32 x, i32 y, const u8* colorBuf, double percentage,
+                         i32 rowBegin, i32 rowEnd)
 {
     if (x < 0 || x >= (i32)image->width())
         return;
-    if (y < 0 || y >= (i32)image->height())
+    if (y < rowBegin || y >= rowEnd)
         return;
 
     u8* buf = image->buf() + npix*(y*image->width()+x);
@@ -495,7 +537,8 @@ void s_colorImageAtPoint(tImage* image, i32 npix, i32 x, i32 y, const u8* colorB
 }
 
 static
-void s_colorImageAtPoint(tImage* image, i32 npix, double x, double y, const u8* colorBuf)
+void s_colorImageAtPoint(tImage* image, i32 npix, double x, double y, const u8* colorBuf,
+                         i32 rowBegin, i32 rowEnd)
 {
     i32 xFloor = (i32) floor(x);
     i32 yFloor = (i32) floor(y);
@@ -507,69 +550,186 @@ void s_colorImageAtPoint(tImage* image, i32 npix, double x, double y, const u8*
     double topRatio = yCeil == y ? 1.0 :  yCeil - y;
 
     // Left-top pixel
-    s_colorImageAtPoint(image, npix, xFloor, yFloor, colorBuf, leftRatio*topRatio);
+    s_colorImageAtPoint(image, npix, xFloor, yFloor, colorBuf, leftRatio*topRatio, rowBegin, rowEnd);
 
     // Right-top pixel
-    s_colorImageAtPoint(image, npix, xCeil, yFloor, colorBuf, (1.0-leftRatio)*topRatio);
+    s_colorImageAtPoint(image, npix, xCeil, yFloor, colorBuf, (1.0-leftRatio)*topRatio, rowBegin, rowEnd);
 
     // Right-bottom pixel
-    s_colorImageAtPoint(image, npix, xCeil, yCeil, colorBuf, (1.0-leftRatio)*(1.0-topRatio));
+    s_colorImageAtPoint(image, npix, xCeil, yCeil, colorBuf, (1.0-leftRatio)*(1.0-topRatio), rowBegin, rowEnd);
 
     // Left-bottom pixel
-    s_colorImageAtPoint(image, npix, xFloor, yCeil, colorBuf, leftRatio*(1.0-topRatio));
+    s_colorImageAtPoint(image, npix, xFloor, yCeil, colorBuf, leftRatio*(1.0-topRatio), rowBegin, rowEnd);
 }
 
-void tImage::rotate(double angleDegrees, tImage* dest) const
+/*
+ * Draws each source pixel onto the canvas at its rotated position. The
+ * pixels are drawn in the same order no matter how the canvas is split,
+ * and the saturating adds in s_colorImageAtPoint() depend on that order.
+ */
+class tRotateBands
+{
+    public:
+
+        tRotateBands(const tImage* image, tImage* canvas, i32 npix, double angleRad,
+                     double halfWidthGain, double halfHeightGain)
+            : m_image(image), m_canvas(canvas), m_npix(npix),
+              m_halfWidthGain(halfWidthGain), m_halfHeightGain(halfHeightGain)
+        {
+            // Create the rotation matrix's cosine and sine elements.
+            m_c = std::cos(angleRad);
+            m_s = std::sin(angleRad);
+
+            m_originX = image->width()/2.0;
+            m_originY = image->height()/2.0;
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            u32 rowSize = m_npix * m_canvas->width();
+            memset(m_canvas->buf() + rowBegin*rowSize, 0, (rowEnd-rowBegin)*rowSize);
+
+            const tImage* image = m_image;
+            double c = m_c;
+            double s = m_s;
+
+            for (i32 y = 0; y < (i32)image->height(); y++)
+            {
+                i32 xBegin, xEnd;
+                m_columnsReaching(y, rowBegin, rowEnd, &xBegin, &xEnd);
+
+                for (i32 x = xBegin; x < xEnd; x++)
+                {
+                    const u8* imageBuf = image->buf() + m_npix*(y*image->width()+x);
+
+                    double xShift = x-m_originX;
+                    double yShift = y-m_originY;
+
+                    double xRotShift = xShift*c + yShift*s;
+                    double yRotShift = -xShift*s + yShift*c;
+
+                    double xRot = xRotShift+m_originX;
+                    double yRot = yRotShift+m_originY;
+
+                    xRot += m_halfWidthGain;
+                    yRot += m_halfHeightGain;
+
+                    s_colorImageAtPoint(m_canvas, m_npix, xRot, yRot, imageBuf,
+                                        (i32)rowBegin, (i32)rowEnd);
+                }
+            }
+        }
+
+    private:
+
+        /*
+         * Finds the pixels in source row y which might land on canvas rows
+         * [rowBegin, rowEnd). A pixel landing at yRot touches rows
+         * floor(yRot) and ceil(yRot), and yRot is linear along the row, so
+         * that's one run of columns. The run found has a column or so of
+         * slack on each side; the extra pixels are clipped when drawn.
+         */
+        void m_columnsReaching(i32 y, u32 rowBegin, u32 rowEnd, i32* xBegin, i32* xEnd) const
+        {
+            double width = m_image->width();
+            double yRot0 = m_originX*m_s + (y-m_originY)*m_c + m_originY + m_halfHeightGain;
+            double lo = rowBegin - 2.0;
+            double hi = rowEnd + 1.0;
+
+            *xBegin = 0;
+            *xEnd = (i32) m_image->width();
+
+            if (std::fabs(m_s) * width < 0.5)
+            {
+                // The row stays level (to within half a pixel).
+                if (yRot0 < lo || yRot0 > hi)
+                    *xEnd = 0;
+                return;
+            }
+
+            double xa = (yRot0 - lo) / m_s;
+            double xb = (yRot0 - hi) / m_s;
+            double xmin = std::max(std::floor(std::min(xa, xb)), 0.0);
+            double xmax = std::min(std::ceil(std::max(xa, xb)) + 1.0, width);
+            if (xmin >= xmax)
+            {
+                *xEnd = 0;
+                return;
+            }
+            *xBegin = (i32) xmin;
+            *xEnd = (i32) xmax;
+        }
+
+    private:
+
+        const tImage* m_image;
+        tImage*       m_canvas;
+        i32           m_npix;
+        double        m_c;
+        double        m_s;
+        double        m_originX;
+        double        m_originY;
+        double        m_halfWidthGain;
+        double        m_halfHeightGain;
+};
+
+static
+void s_rotate(const tImage* image, double angleDegrees, tImage* dest, sync::tThreadPool* pool)
 {
     // Stuff that will be needed below.
-    i32 npix = bufUsed() / (width()*height());
+    i32 npix = image->bufUsed() / (image->width()*image->height());
     double angleRad = (geo::kPI / 180.0) * angleDegrees;
 
     // Calculate how big the canvas needs to be.
-    double diagAng = atan(((double)height())/width());
-    double diagLen = hypot(width()/2.0, height()/2.0);
+    double diagAng = atan(((double)image->height())/image->width());
+    double diagLen = hypot(image->width()/2.0, image->height()/2.0);
     double newWidth  = std::max(fabs(cos(angleRad+diagAng)), fabs(cos(angleRad-diagAng))) * diagLen * 2;
     double newHeight = std::max(fabs(sin(angleRad+diagAng)), fabs(sin(angleRad-diagAng))) * diagLen * 2;
-    double halfWidthGain = (newWidth-width())/2.0;
-    double halfHeightGain = (newHeight-height())/2.0;
+    double halfWidthGain = (newWidth-image->width())/2.0;
+    double halfHeightGain = (newHeight-image->height())/2.0;
 
-    // Create a black canvas for drawing onto.
+    // Create a canvas for drawing onto. Each band blacks out its own rows.
     tImage& canvas = *dest;
-    canvas.setFormat(format());
+    canvas.setFormat(image->format());
     canvas.setWidth((u32)newWidth);
     canvas.setHeight((u32)newHeight);
     canvas.setBufSize(npix*canvas.width()*canvas.height());
     canvas.setBufUsed(canvas.bufSize());
-    for (u32 i = 0; i < canvas.bufUsed(); i++) canvas.buf()[i] = 0;
 
-    // Create the rotation matrix's cosine and sine elements.
-    double c = std::cos(angleRad);
-    double s = std::sin(angleRad);
-
-    // For each pixel in the image, draw it onto the canvas at its rotated position.
-    double originX = width()/2.0;
-    double originY = height()/2.0;
-    for (i32 y = 0; y < (i32)height(); y++)
-    {
-        for (i32 x = 0; x < (i32)width(); x++)
-        {
-            const u8* imageBuf = buf() + npix*(y*width()+x);
+    tRotateBands bands(image, &canvas, npix, angleRad, halfWidthGain, halfHeightGain);
+    s_runBands(pool, canvas.height(), bands);
+}
 
-            double xShift = x-originX;
-            double yShift = y-originY;
+void tImage::rotate(double angleDegrees, tImage* dest) const
+{
+    s_rotate(this, angleDegrees, dest, NULL);
+}
 
-            double xRotShift = xShift*c + yShift*s;
-            double yRotShift = -xShift*s + yShift*c;
+void tImage::rotate(double angleDegrees, tImage* dest, sync::tThreadPool& pool) const
+{
+    s_rotate(this, angleDegrees, dest, &pool);
+}
 
-            double xRot = xRotShift+originX;
-            double yRot = yRotShift+originY;
+void tImage::rotateBilinear(double angleDegrees, tImage* dest) const
+{
+    u32 newWidth, newHeight;
+    geo::tTrans4 trans = rotationTransform(width(), height(), angleDegrees, &newWidth, &newHeight);
+    tWarper warper(width(), height(), newWidth, newHeight, trans);
+    warper.warp(this, dest);
+}
 
-            xRot += halfWidthGain;
-            yRot += halfHeightGain;
+void tImage::rotateBilinear(double angleDegrees, tImage* dest, sync::tThreadPool& pool) const
+{
+    u32 newWidth, newHeight;
+    geo::tTrans4 trans = rotationTransform(width(), height(), angleDegrees, &newWidth, &newHeight);
+    tWarper warper(width(), height(), newWidth, newHeight, trans);
+    warper.warp(this, dest, pool);
+}
 
-            s_colorImageAtPoint(&canvas, npix, xRot, yRot, imageBuf);
-        }
-    }
+void tImage::warp(const geo::tTrans4& trans, u32 width, u32 height, tImage* dest) const
+{
+    tWarper warper(this->width(), this->height(), width, height, trans);
+    warper.warp(this, dest);
 }
 
 void tImage::rotate90CCW(int numRotations, tImage* dest) const
@@ -666,23 +826,37 @@ void tImage::rotate90CCW(int numRotations, tImage* dest) const
     }
 }
 
-void tImage::convertToFormat(nImageFormat format, tImage* dest) const
+tImageView tImage::viewLumaAsGrey() const
 {
-    if (this == dest)
-        throw eInvalidArgument("convertToFormat(): source and destination must be different objects");
+    if (m_format != kI420 && m_format != kNV12)
+        throw eInvalidArgument("viewLumaAsGrey(): the image must be kI420 or kNV12");
+    if (m_bufUsed != getBufSize(m_format, m_width, m_height))
+        throw eLogicError("Something is wack with the given image.");
 
+    return tImageView(m_buf, m_width, m_height, m_width, kGrey);
+}
+
+/*
+ * Converts the width x height image in 'source' into 'dest', growing the
+ * destination buffer until the result fits.
+ */
+static
+void s_convertToFormat(nImageFormat from, nImageFormat to, u32 width, u32 height,
+                       const u8* source, u32 sourceSize, tImage* dest)
+{
     dest->setBufSize(1024);
     while (true)
     {
         try
         {
-            i32 bufUsed = colorspace_conversion(m_format, format,
-                    m_buf, m_bufUsed,
+            i32 bufUsed = colorspace_conversion(from, to,
+                    width, height,
+                    const_cast<u8*>(source), (i32)sourceSize,
                     dest->buf(), dest->bufSize());
             dest->setBufUsed(bufUsed);
-            dest->setWidth(m_width);
-            dest->setHeight(m_height);
-            dest->setFormat(format);
+            dest->setWidth(width);
+            dest->setHeight(height);
+            dest->setFormat(to);
             break;
         }
         catch (eBufferOverflow& e)
@@ -694,6 +868,106 @@ void tImage::convertToFormat(nImageFormat format, tImage* dest) const
     }
 }
 
+/*
+ * Whether the rows of 'view' can be converted to 'format' one at a time.
+ * (A planar format can't be written a row at a time, and a row of YUYV
+ * must be whole macropixels.)
+ */
+static
+bool s_canConvertByRows(const tImageView& view, nImageFormat format)
+{
+    if (isPlanar(format))
+        return false;
+    if (view.format() == kYUYV || format == kYUYV)
+        return (view.width() % 2) == 0;
+    return true;
+}
+
+/*
+ * Converts rows [rowBegin, rowEnd) of a view into the same rows of 'dest',
+ * which is already the right size.
+ */
+class tConvertRowBands
+{
+    public:
+
+        tConvertRowBands(const tImageView& view, tImage* dest)
+            : m_view(view), m_dest(dest), m_destBpp(getBPP(dest->format()))
+        {
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            i32 sourceSize = (i32)(m_view.width() * m_view.bpp());
+            i32 destSize = (i32)(m_view.width() * m_destBpp);
+            for (u32 row = rowBegin; row < rowEnd; row++)
+            {
+                colorspace_conversion(m_view.format(), m_dest->format(),
+                                      const_cast<u8*>(m_view[row][0]), sourceSize,
+                                      m_dest->buf() + (size_t)row * (u32)destSize, destSize);
+            }
+        }
+
+    private:
+
+        tImageView m_view;
+        tImage*    m_dest;
+        u32        m_destBpp;
+};
+
+static
+void s_convertToFormat(const tImageView& view, nImageFormat format, tImage* dest,
+                       sync::tThreadPool* pool)
+{
+    if (view.looksInto(dest))
+        throw eInvalidArgument("convertToFormat(): source and destination must be different objects");
+
+    if (view.isContiguous() && pool == NULL)
+    {
+        s_convertToFormat(view.format(), format, view.width(), view.height(),
+                          view.buf(), view.stride() * view.height(), dest);
+        return;
+    }
+
+    if (!s_canConvertByRows(view, format))
+    {
+        tImage copy;
+        view.copyTo(&copy);
+        copy.convertToFormat(format, dest);
+        return;
+    }
+
+    // Find out here whether the conversion exists, because exceptions
+    // thrown on the pool's other threads are lost.
+    u8 nothing = 0;
+    colorspace_conversion(view.format(), format,
+                          const_cast<u8*>(view.buf()), 0, &nothing, 0);
+
+    u32 size = view.width() * view.height() * getBPP(format);
+    if (dest->bufSize() < size)
+        dest->setBufSize(size);
+    dest->setBufUsed(size);
+    dest->setWidth(view.width());
+    dest->setHeight(view.height());
+    dest->setFormat(format);
+
+    tConvertRowBands bands(view, dest);
+    s_runBands(pool, view.height(), bands);
+}
+
+void tImage::convertToFormat(nImageFormat format, tImage* dest) const
+{
+    if (this == dest)
+        throw eInvalidArgument("convertToFormat(): source and destination must be different objects");
+
+    s_convertToFormat(m_format, format, m_width, m_height, m_buf, m_bufUsed, dest);
+}
+
+void tImageView::convertToFormat(nImageFormat format, tImage* dest) const
+{
+    s_convertToFormat(*this, format, dest, NULL);
+}
+
 static
 void s_adaptiveThreshold(tImage* image, u32 s, u32 t, u32 b)
 {
@@ -736,85 +1010,692 @@ void s_adaptiveThreshold(tImage* image, u32 s, u32 t, u32 b)
     }
 }
 
-void tImage::adaptiveThreshold(tImage* dest,
-                               i32 s,
-                               i32 t,
-                               i32 b) const
+/*
+ * Converts pixel pairs [begin, end) to grey. Pairs, because a YUYV
+ * macropixel holds two pixels.
+ */
+class tGreyBands
+{
+    public:
+
+        tGreyBands(const tImage* image, tImage* grey)
+            : m_image(image), m_grey(grey), m_bpp(getBPP(image->format()))
+        {
+        }
+
+        void operator() (u32 begin, u32 end)
+        {
+            u8* source = const_cast<u8*>(m_image->buf()) + 2*begin*m_bpp;
+            u8* dest = m_grey->buf() + 2*begin;
+            colorspace_conversion(m_image->format(), kGrey,
+                                  source, (i32)(2*(end-begin)*m_bpp),
+                                  dest, (i32)(2*(end-begin)));
+        }
+
+    private:
+
+        const tImage* m_image;
+        tImage*       m_grey;
+        u32           m_bpp;
+};
+
+static
+void s_convertToGrey(const tImage* image, tImage* dest, sync::tThreadPool& pool)
+{
+    if (image == dest)
+        throw eInvalidArgument("convertToFormat(): source and destination must be different objects");
+
+    u32 numPixels = image->width() * image->height();
+
+    // Anything odd about the image is handled (and reported) the usual way.
+    // (So are the planar formats, whose grey is a plain copy anyway.)
+    if (image->format() == kUnknown || isPlanar(image->format()) || numPixels % 2 ||
+        image->bufUsed() != numPixels * getBPP(image->format()))
+    {
+        image->convertToFormat(kGrey, dest);
+        return;
+    }
+
+    // Find out here whether the conversion exists, because exceptions
+    // thrown on the pool's other threads are lost.
+    u8 nothing = 0;
+    colorspace_conversion(image->format(), kGrey,
+                          const_cast<u8*>(image->buf()), 0, &nothing, 0);
+
+    if (dest->bufSize() < numPixels)
+        dest->setBufSize(numPixels);
+    dest->setBufUsed(numPixels);
+    dest->setWidth(image->width());
+    dest->setHeight(image->height());
+    dest->setFormat(kGrey);
+
+    tGreyBands bands(image, dest);
+    u32 numPairs = numPixels / 2;
+    u32 grain = numPairs / (pool.getNumThreads() * kBandsPerThread) + 1;
+    sync::parallelFor(pool, 0, numPairs, grain, bands);
+}
+
+/*
+ * Checks adaptiveThreshold()'s parameters, filling in the default 's'.
+ */
+static
+void s_thresholdParams(u32 width, i32* s, i32 t, i32 b)
 {
-    if (s == -1)
-        s = width() / 8;
-    if (s < 0)
+    if (*s == -1)
+        *s = (i32)(width / 8);
+    if (*s < 0)
         throw eInvalidArgument("s must be >= 0 (or -1 to indicate the default value)");
     if (t < 0)
         throw eInvalidArgument("t must be >= 0");
     if (b < 0)
         throw eInvalidArgument("b must be >= 0");
+}
 
+void tImage::adaptiveThreshold(tImage* dest,
+                               i32 s,
+                               i32 t,
+                               i32 b) const
+{
+    s_thresholdParams(width(), &s, t, b);
     convertToFormat(kGrey, dest);
     s_adaptiveThreshold(dest, (u32)s, (u32)t, (u32)b);
 }
 
-template<class T>
-T s_median(const std::vector<T>& arr)
+void tImage::adaptiveThreshold(tImage* dest,
+                               i32 s,
+                               i32 t,
+                               i32 b,
+                               sync::tThreadPool& pool) const
 {
-    // If the array size is even:
-    if ((arr.size() & 1) == 0)
-    {
-        return (T) ( (arr[(arr.size()-1) / 2] + arr[arr.size() / 2]) / 2 );
-    }
-    // Else, the array size is odd:
-    else
-    {
-        return arr[arr.size() / 2];
-    }
+    s_thresholdParams(width(), &s, t, b);
+    s_convertToGrey(this, dest, pool);
+    s_adaptiveThreshold(dest, (u32)s, (u32)t, (u32)b);
 }
 
-void tImage::medianFilter(tImage* dest, u32 windowWidth, u32 windowHeight) const
+void tImageView::adaptiveThreshold(tImage* dest, i32 s, i32 t, i32 b) const
 {
-    if ((windowWidth % 2) == 0 || (windowHeight % 2) == 0)
-    {
-        throw eInvalidArgument("The window size most have odd dimensions.");
-    }
-
-    const tImage* orig = this;
+    s_thresholdParams(m_width, &s, t, b);
+    s_convertToFormat(*this, kGrey, dest, NULL);
+    s_adaptiveThreshold(dest, (u32)s, (u32)t, (u32)b);
+}
 
-    u32 bpp = getBPP(orig->format());
+void tImageView::adaptiveThreshold(tImage* dest, i32 s, i32 t, i32 b,
+                                   sync::tThreadPool& pool) const
+{
+    s_thresholdParams(m_width, &s, t, b);
+    s_convertToFormat(*this, kGrey, dest, &pool);
+    s_adaptiveThreshold(dest, (u32)s, (u32)t, (u32)b);
+}
 
-    dest->setFormat(orig->format());
-    dest->setWidth(orig->width());
-    dest->setHeight(orig->height());
-    dest->setBufSize(dest->width() * dest->height() * bpp);
-    dest->setBufUsed(dest->bufSize());
+/*
+ * Runs a window filter over rows [rowBegin, rowEnd) using the integral
+ * image of the original. The window is clipped to the image, and 'op'
+ * gets the window's sum (and sum of squares, if the table has them), the
+ * number of pixels in it, and the original pixel.
+ *
+ * Every output pixel depends only on the table (and its own original
+ * pixel), so the destination may be the original image.
+ */
+template <class tOp>
+class tWindowBands
+{
+    public:
 
-    std::vector<u8> arr;
-    u32 halfWidth = windowWidth / 2;
-    u32 halfHeight = windowHeight / 2;
+        tWindowBands(const tIntegralImage& integral, const u8* pixels, tImage* dest,
+                     u32 windowWidth, u32 windowHeight, const tOp& op)
+            : m_integral(integral), m_pixels(pixels), m_dest(dest),
+              m_halfHeight(windowHeight / 2), m_op(op)
+        {
+            u32 width = integral.width();
+            u32 halfWidth = windowWidth / 2;
+            m_lo.resize(width);
+            m_hi.resize(width);
+            for (u32 col = 0; col < width; col++)
+            {
+                m_lo[col] = (col > halfWidth) ? (col - halfWidth) : 0;
+                m_hi[col] = (u32) std::min((u64)col + halfWidth + 1, (u64)width);
+            }
+        }
 
-    for (u32 row = 0; row < dest->height(); row++)
-    {
-        for (u32 col = 0; col < dest->width(); col++)
+        void operator() (u32 rowBegin, u32 rowEnd)
         {
-            u32 minr = (row > halfHeight) ? (row - halfHeight) : 0;
-            u32 maxr = (row + halfHeight < dest->height()) ? (row + halfHeight) : (dest->height() - 1);
-            u32 minc = (col > halfWidth) ? (col - halfWidth) : 0;
-            u32 maxc = (col + halfWidth < dest->width()) ? (col + halfWidth) : (dest->width() - 1);
-            for (u32 k = 0; k < bpp; k++)
+            const u32* sums = m_integral.sums();
+            const u64* squares = m_integral.squares();
+            u32 stride = m_integral.stride();
+            u32 channels = m_integral.channels();
+            u32 width = m_integral.width();
+            u32 height = m_integral.height();
+
+            for (u32 row = rowBegin; row < rowEnd; row++)
             {
-                arr.clear();
-                for (u32 r = minr; r <= maxr; r++)
-                    for (u32 c = minc; c <= maxc; c++)
-                        arr.push_back((*orig)[r][c][k]);
-                std::sort(arr.begin(), arr.end());
-                (*dest)[row][col][k] = s_median(arr);
+                u32 y0 = (row > m_halfHeight) ? (row - m_halfHeight) : 0;
+                u32 y1 = (u32) std::min((u64)row + m_halfHeight + 1, (u64)height);
+                size_t top = (size_t)y0 * stride;
+                size_t bottom = (size_t)y1 * stride;
+
+                const u8* pixel = m_pixels + (size_t)row * width * channels;
+                u8* out = m_dest->buf() + (size_t)row * width * channels;
+
+                for (u32 col = 0; col < width; col++)
+                {
+                    u32 x0 = m_lo[col] * channels;
+                    u32 x1 = m_hi[col] * channels;
+                    u32 area = (m_hi[col] - m_lo[col]) * (y1 - y0);
+                    for (u32 k = 0; k < channels; k++)
+                    {
+                        u32 sum = sums[bottom+x1+k] - sums[bottom+x0+k]
+                                - sums[top+x1+k] + sums[top+x0+k];
+                        u64 sumSq = 0;
+                        if (squares)
+                            sumSq = squares[bottom+x1+k] - squares[bottom+x0+k]
+                                  - squares[top+x1+k] + squares[top+x0+k];
+                        *out++ = m_op(sum, sumSq, area, *pixel++);
+                    }
+                }
             }
         }
-    }
-}
 
+    private:
+
+        const tIntegralImage& m_integral;
+        const u8*             m_pixels;
+        tImage*               m_dest;
+        u32                   m_halfHeight;
+        tOp                   m_op;
+        std::vector<u32>      m_lo;       // <-- the window around column c is
+        std::vector<u32>      m_hi;       //     columns [m_lo[c], m_hi[c])
+};
+
+template <class tOp>
 static
-void s_sobel(const tImage* orig, tImage* edges, u32 clipAtValue)
+void s_windowFilter(const tImage* orig, tImage* dest, u32 windowWidth, u32 windowHeight,
+                    bool withSquares, const tOp& op, sync::tThreadPool* pool)
 {
-    if (orig->width() < 3 || orig->height() < 3)
+    if ((windowWidth % 2) == 0 || (windowHeight % 2) == 0)
+        throw eInvalidArgument("The window size must have odd dimensions.");
+
+    tIntegralImage integral;
+    if (pool)
+        integral.build(orig, withSquares, *pool);
+    else
+        integral.build(orig, withSquares);
+
+    u32 size = orig->bufUsed();
+    dest->setFormat(orig->format());
+    dest->setWidth(orig->width());
+    dest->setHeight(orig->height());
+    if (dest->bufSize() < size)
+        dest->setBufSize(size);
+    dest->setBufUsed(size);
+
+    // (When dest is orig, the pixels are read just before being replaced.)
+    tWindowBands<tOp> bands(integral, orig->buf(), dest, windowWidth, windowHeight, op);
+    s_runBands(pool, dest->height(), bands);
+}
+
+class tBradleyOp
+{
+    public:
+
+        tBradleyOp(u32 t) : m_t(t) { }
+
+        u8 operator() (u32 sum, u64, u32 area, u8 pixel) const
+        {
+            return ((u64)pixel * area * 100 <= (u64)sum * (100 - m_t)) ? 0 : 255;
+        }
+
+    private:
+
+        u32 m_t;
+};
+
+static
+void s_bradleyThreshold(const tImage* orig, tImage* dest, u32 windowSize, u32 t,
+                        sync::tThreadPool* pool)
+{
+    if ((windowSize % 2) == 0)
+        throw eInvalidArgument("The window size must be odd.");
+    if (t > 100)
+        throw eInvalidArgument("t must be in [0, 100]");
+
+    if (pool)
+        s_convertToGrey(orig, dest, *pool);
+    else
+        orig->convertToFormat(kGrey, dest);
+
+    // Thresholded in place; the integral image holds all it needs of the
+    // grey image.
+    s_windowFilter(dest, dest, windowSize, windowSize, false, tBradleyOp(t), pool);
+}
+
+void tImage::bradleyThreshold(tImage* dest, u32 windowSize, u32 t) const
+{
+    s_bradleyThreshold(this, dest, windowSize, t, NULL);
+}
+
+void tImage::bradleyThreshold(tImage* dest, u32 windowSize, u32 t,
+                              sync::tThreadPool& pool) const
+{
+    s_bradleyThreshold(this, dest, windowSize, t, &pool);
+}
+
+class tMeanOp
+{
+    public:
+
+        u8 operator() (u32 sum, u64, u32 area, u8) const
+        {
+            // (No overflow for any window the integral image can sum.)
+            return (u8) ((sum + area/2) / area);
+        }
+};
+
+class tStdDevOp
+{
+    public:
+
+        u8 operator() (u32 sum, u64 sumSq, u32 area, u8) const
+        {
+            // area^2 * variance, exactly.
+            u64 scaled = area * sumSq - (u64)sum * sum;
+            return (u8) std::floor(std::sqrt((f64)scaled) / area + 0.5);
+        }
+};
+
+void tImage::boxBlur(tImage* dest, u32 windowWidth, u32 windowHeight) const
+{
+    s_windowFilter(this, dest, windowWidth, windowHeight, false, tMeanOp(), NULL);
+}
+
+void tImage::boxBlur(tImage* dest, u32 windowWidth, u32 windowHeight,
+                     sync::tThreadPool& pool) const
+{
+    s_windowFilter(this, dest, windowWidth, windowHeight, false, tMeanOp(), &pool);
+}
+
+void tImage::localStdDev(tImage* dest, u32 windowWidth, u32 windowHeight) const
+{
+    s_windowFilter(this, dest, windowWidth, windowHeight, true, tStdDevOp(), NULL);
+}
+
+void tImage::localStdDev(tImage* dest, u32 windowWidth, u32 windowHeight,
+                         sync::tThreadPool& pool) const
+{
+    s_windowFilter(this, dest, windowWidth, windowHeight, true, tStdDevOp(), &pool);
+}
+
+template<class T>
+T s_median(const std::vector<T>& arr)
+{
+    // If the array size is even:
+    if ((arr.size() & 1) == 0)
+    {
+        return (T) ( (arr[(arr.size()-1) / 2] + arr[arr.size() / 2]) / 2 );
+    }
+    // Else, the array size is odd:
+    else
+    {
+        return arr[arr.size() / 2];
+    }
+}
+
+class tMedianBands
+{
+    public:
+
+        tMedianBands(const tImageView& orig, tImage* dest, u32 windowWidth, u32 windowHeight)
+            : m_orig(orig), m_dest(dest),
+              m_halfWidth(windowWidth / 2), m_halfHeight(windowHeight / 2)
+        {
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            const tImageView& orig = m_orig;
+            tImage* dest = m_dest;
+            u32 bpp = orig.bpp();
+
+            std::vector<u8> arr;
+            u32 halfWidth = m_halfWidth;
+            u32 halfHeight = m_halfHeight;
+
+            for (u32 row = rowBegin; row < rowEnd; row++)
+            {
+                for (u32 col = 0; col < dest->width(); col++)
+                {
+                    u32 minr = (row > halfHeight) ? (row - halfHeight) : 0;
+                    u32 maxr = (row + halfHeight < dest->height()) ? (row + halfHeight) : (dest->height() - 1);
+                    u32 minc = (col > halfWidth) ? (col - halfWidth) : 0;
+                    u32 maxc = (col + halfWidth < dest->width()) ? (col + halfWidth) : (dest->width() - 1);
+                    for (u32 k = 0; k < bpp; k++)
+                    {
+                        arr.clear();
+                        for (u32 r = minr; r <= maxr; r++)
+                            for (u32 c = minc; c <= maxc; c++)
+                                arr.push_back(orig[r][c][k]);
+                        std::sort(arr.begin(), arr.end());
+                        (*dest)[row][col][k] = s_median(arr);
+                    }
+                }
+            }
+        }
+
+    private:
+
+        tImageView    m_orig;
+        tImage*       m_dest;
+        u32           m_halfWidth;
+        u32           m_halfHeight;
+};
+
+/*
+ * The histogram of the pixels in a window, kept as 16 coarse bins (by the
+ * top four bits of the value) and 256 fine bins. It is built from one
+ * histogram per column of the image (see Perreault and Hebert, "Median
+ * Filtering in Constant Time"): sliding the window one column to the
+ * right removes one column's histogram and adds another.
+ *
+ * Only the coarse bins are kept current as the window slides. A group of
+ * 16 fine bins is brought up to date only when a median lands in it, so
+ * most of the fine bins are never touched for most pixels.
+ */
+class tSlidingHistogram
+{
+    public:
+
+        tSlidingHistogram(const std::vector<u16>& colCoarse, const std::vector<u16>& colFine)
+            : m_colCoarse(colCoarse), m_colFine(colFine)
+        {
+            reset();
+        }
+
+        /**
+         * Empties the window, ready for the start of a row.
+         */
+        void reset()
+        {
+            for (u32 i = 0; i < 16; i++)
+                m_coarse[i] = 0;
+            m_lo = 0;
+            m_hi = -1;
+            for (u32 b = 0; b < 16; b++)
+            {
+                m_fineLo[b] = 0;
+                m_fineHi[b] = -1;
+            }
+        }
+
+        /**
+         * Moves the window to cover columns [lo, hi]. Neither end may
+         * move left.
+         */
+        void slideTo(i32 lo, i32 hi)
+        {
+            for (i32 c = m_lo; c < lo && c <= m_hi; c++)
+            {
+                const u16* col = &m_colCoarse[16*c];
+                for (u32 i = 0; i < 16; i++)
+                    m_coarse[i] -= col[i];
+            }
+            for (i32 c = std::max(m_hi+1, lo); c <= hi; c++)
+            {
+                const u16* col = &m_colCoarse[16*c];
+                for (u32 i = 0; i < 16; i++)
+                    m_coarse[i] += col[i];
+            }
+            m_lo = lo;
+            m_hi = hi;
+        }
+
+        /**
+         * Returns the value of the i'th smallest pixel (from zero) in the
+         * window.
+         */
+        u32 kth(u32 i)
+        {
+            u32 b = 0;
+            while (m_coarse[b] <= i)
+                i -= m_coarse[b++];
+
+            m_bringUp(b);
+            const u32* fine = m_fine + 16*b;
+            u32 v = 0;
+            while (fine[v] <= i)
+                i -= fine[v++];
+            return 16*b + v;
+        }
+
+    private:
+
+        void m_bringUp(u32 b)
+        {
+            u32* fine = m_fine + 16*b;
+            if (m_fineHi[b] < m_lo)
+            {
+                for (u32 i = 0; i < 16; i++)
+                    fine[i] = 0;
+                m_fineLo[b] = m_lo;
+                m_fineHi[b] = m_lo-1;
+            }
+            for (i32 c = m_fineLo[b]; c < m_lo; c++)
+            {
+                const u16* col = &m_colFine[256*c + 16*b];
+                for (u32 i = 0; i < 16; i++)
+                    fine[i] -= col[i];
+            }
+            for (i32 c = m_fineHi[b]+1; c <= m_hi; c++)
+            {
+                const u16* col = &m_colFine[256*c + 16*b];
+                for (u32 i = 0; i < 16; i++)
+                    fine[i] += col[i];
+            }
+            m_fineLo[b] = m_lo;
+            m_fineHi[b] = m_hi;
+        }
+
+    private:
+
+        const std::vector<u16>& m_colCoarse;
+        const std::vector<u16>& m_colFine;
+
+        u32 m_coarse[16];
+        i32 m_lo, m_hi;
+
+        u32 m_fine[256];
+        i32 m_fineLo[16], m_fineHi[16];
+};
+
+/*
+ * The same filter as tMedianBands, in time independent of the window size.
+ * Each band builds its column histograms from scratch at its first row, so
+ * it reads the rows above and below it that its windows cover.
+ */
+class tHistogramMedianBands
+{
+    public:
+
+        tHistogramMedianBands(const tImageView& orig, tImage* dest, u32 windowWidth, u32 windowHeight)
+            : m_orig(orig), m_dest(dest),
+              m_halfWidth(windowWidth / 2), m_halfHeight(windowHeight / 2)
+        {
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            u32 width = m_dest->width();
+            u32 height = m_dest->height();
+            u32 bpp = m_orig.bpp();
+
+            std::vector<u16> colCoarse(width * 16);
+            std::vector<u16> colFine(width * 256);
+            tSlidingHistogram window(colCoarse, colFine);
+
+            for (u32 k = 0; k < bpp; k++)
+            {
+                std::fill(colCoarse.begin(), colCoarse.end(), (u16)0);
+                std::fill(colFine.begin(), colFine.end(), (u16)0);
+                u32 histLo = 0;     // the rows in the column histograms are [histLo, histHi)
+                u32 histHi = 0;
+
+                for (u32 row = rowBegin; row < rowEnd; row++)
+                {
+                    u32 minr = (row > m_halfHeight) ? (row - m_halfHeight) : 0;
+                    u32 maxr = (row + m_halfHeight < height) ? (row + m_halfHeight) : (height - 1);
+
+                    if (histLo == histHi)
+                        histLo = histHi = minr;
+                    for ( ; histLo < minr; histLo++)
+                        m_addRow(histLo, k, colCoarse, colFine, false);
+                    for ( ; histHi <= maxr; histHi++)
+                        m_addRow(histHi, k, colCoarse, colFine, true);
+
+                    window.reset();
+                    u32 numRows = maxr - minr + 1;
+                    for (u32 col = 0; col < width; col++)
+                    {
+                        u32 minc = (col > m_halfWidth) ? (col - m_halfWidth) : 0;
+                        u32 maxc = (col + m_halfWidth < width) ? (col + m_halfWidth) : (width - 1);
+                        window.slideTo((i32)minc, (i32)maxc);
+
+                        // Like s_median(): the mean of the middle two when
+                        // the window (clipped at the edges) is even.
+                        u32 n = numRows * (maxc - minc + 1);
+                        u32 median = window.kth((n-1) / 2);
+                        if ((n & 1) == 0)
+                            median = (median + window.kth(n / 2)) / 2;
+                        (*m_dest)[row][col][k] = (u8) median;
+                    }
+                }
+            }
+        }
+
+    private:
+
+        void m_addRow(u32 row, u32 k, std::vector<u16>& colCoarse, std::vector<u16>& colFine,
+                      bool add) const
+        {
+            const u8* pix = m_orig[row][0] + k;
+            u32 bpp = m_orig.bpp();
+            for (u32 c = 0; c < m_orig.width(); c++, pix += bpp)
+            {
+                u16& coarse = colCoarse[16*c + (*pix >> 4)];
+                u16& fine = colFine[256*c + *pix];
+                if (add)
+                {
+                    coarse++;
+                    fine++;
+                }
+                else
+                {
+                    coarse--;
+                    fine--;
+                }
+            }
+        }
+
+    private:
+
+        tImageView    m_orig;
+        tImage*       m_dest;
+        u32           m_halfWidth;
+        u32           m_halfHeight;
+};
+
+/*
+ * Below this many pixels in the window, sorting each window is quicker
+ * than keeping histograms.
+ */
+static const u32 kMinHistogramMedianArea = 5;
+
+static
+void s_medianFilter(const tImageView& orig, tImage* dest, u32 windowWidth, u32 windowHeight,
+                    sync::tThreadPool* pool)
+{
+    if ((windowWidth % 2) == 0 || (windowHeight % 2) == 0)
+    {
+        throw eInvalidArgument("The window size most have odd dimensions.");
+    }
+    if (orig.looksInto(dest))
+    {
+        throw eInvalidArgument("s_medianFilter(): source and destination must be different objects");
+    }
+
+    u32 bpp = orig.bpp();
+
+    dest->setFormat(orig.format());
+    dest->setWidth(orig.width());
+    dest->setHeight(orig.height());
+    dest->setBufSize(dest->width() * dest->height() * bpp);
+    dest->setBufUsed(dest->bufSize());
+
+    // The column histograms count up to windowHeight pixels in 16 bits.
+    if ((u64)windowWidth * windowHeight >= kMinHistogramMedianArea && windowHeight <= 0xFFFF)
+    {
+        tHistogramMedianBands bands(orig, dest, windowWidth, windowHeight);
+        s_runBands(pool, dest->height(), bands);
+    }
+    else
+    {
+        tMedianBands bands(orig, dest, windowWidth, windowHeight);
+        s_runBands(pool, dest->height(), bands);
+    }
+}
+
+void tImage::medianFilter(tImage* dest, u32 windowWidth, u32 windowHeight) const
+{
+    s_medianFilter(tImageView(*this), dest, windowWidth, windowHeight, NULL);
+}
+
+void tImage::medianFilter(tImage* dest, u32 windowWidth, u32 windowHeight,
+                          sync::tThreadPool& pool) const
+{
+    s_medianFilter(tImageView(*this), dest, windowWidth, windowHeight, &pool);
+}
+
+void tImageView::medianFilter(tImage* dest, u32 windowWidth, u32 windowHeight) const
+{
+    s_medianFilter(*this, dest, windowWidth, windowHeight, NULL);
+}
+
+void tImageView::medianFilter(tImage* dest, u32 windowWidth, u32 windowHeight,
+                              sync::tThreadPool& pool) const
+{
+    s_medianFilter(*this, dest, windowWidth, windowHeight, &pool);
+}
+
+/*
+ * Maps the gradient magnitudes through the clip-and-stretch table.
+ */
+class tSobelBands
+{
+    public:
+
+        tSobelBands(const tGradient& gradient, const std::vector<u8>& lut, tImage* edges)
+            : m_gradient(gradient), m_lut(lut), m_edges(edges)
+        {
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            u32 n = m_gradient.width() * m_gradient.channels();
+            const u16* magnitude = m_gradient.magnitude() + (size_t)rowBegin * n;
+            u8* out = m_edges->buf() + (size_t)rowBegin * n;
+            size_t count = (size_t)(rowEnd - rowBegin) * n;
+            for (size_t i = 0; i < count; i++)
+                out[i] = m_lut[magnitude[i]];
+        }
+
+    private:
+
+        const tGradient&       m_gradient;
+        const std::vector<u8>& m_lut;
+        tImage*                m_edges;
+};
+
+static
+void s_sobel(const tImageView& orig, tImage* edges, u32 clipAtValue, sync::tThreadPool* pool)
+{
+    if (orig.width() < 3 || orig.height() < 3)
     {
         throw eInvalidArgument("Cannot run the Sobel operator on an image "
                 "that is less than 3x3 pixels.");
@@ -824,45 +1705,207 @@ void s_sobel(const tImage* orig, tImage* edges, u32 clipAtValue)
         throw eInvalidArgument("Clip value must be positive.");
     }
 
-    u32 bpp = getBPP(orig->format());
+    tGradient gradient(kGradientSobel, kGradientL2, false);
+    if (pool)
+        gradient.compute(orig, *pool);
+    else
+        gradient.compute(orig);
 
-    edges->setFormat(orig->format());
-    edges->setWidth(orig->width() - 2);
-    edges->setHeight(orig->height() - 2);
-    edges->setBufSize(edges->width() * edges->height() * bpp);
+    // The magnitudes are small, so the clipping and the stretch to
+    // [0, 255] are looked up rather than divided out per pixel.
+    std::vector<u8> lut(gradient.maxMagnitude() + 1);
+    for (u32 m = 0; m < lut.size(); m++)
+    {
+        u32 grad = std::min(m, clipAtValue);
+        if (clipAtValue != 255)
+            grad = grad * 255 / clipAtValue;
+        lut[m] = (u8) grad;
+    }
+
+    edges->setFormat(orig.format());
+    edges->setWidth(gradient.width());
+    edges->setHeight(gradient.height());
+    edges->setBufSize(gradient.width() * gradient.height() * gradient.channels());
     edges->setBufUsed(edges->bufSize());
 
-    for (u32 row = 0; row < edges->height(); row++)
+    tSobelBands bands(gradient, lut, edges);
+    s_runBands(pool, edges->height(), bands);
+}
+
+void tImage::sobel(tImage* dest, u32 clipAtValue) const
+{
+    s_sobel(tImageView(*this), dest, clipAtValue, NULL);
+}
+
+void tImage::sobel(tImage* dest, u32 clipAtValue, sync::tThreadPool& pool) const
+{
+    s_sobel(tImageView(*this), dest, clipAtValue, &pool);
+}
+
+void tImageView::sobel(tImage* dest, u32 clipAtValue) const
+{
+    s_sobel(*this, dest, clipAtValue, NULL);
+}
+
+void tImageView::sobel(tImage* dest, u32 clipAtValue, sync::tThreadPool& pool) const
+{
+    s_sobel(*this, dest, clipAtValue, &pool);
+}
+
+/*
+ * Non-maximum suppression: a magnitude survives if it is a maximum along
+ * its gradient direction, and is then marked strong (2) or weak (1) by
+ * the thresholds. Neighbours off the plane count as zero. Of two equal
+ * neighbouring maxima only the one further along the direction survives,
+ * so the edges stay one pixel thick.
+ */
+class tCannyBands
+{
+    public:
+
+        tCannyBands(const tGradient& gradient, u32 lowThresh, u32 highThresh, u8* marks)
+            : m_gradient(gradient), m_lowThresh(lowThresh), m_highThresh(highThresh),
+              m_marks(marks)
+        {
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            static const i32 kSteps[4][2] = { { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 } };
+
+            i32 width = (i32) m_gradient.width();
+            i32 height = (i32) m_gradient.height();
+            i32 bpp = (i32) m_gradient.channels();
+            const u16* magnitude = m_gradient.magnitude();
+            const u8* orientation = m_gradient.orientation();
+
+            for (i32 row = (i32)rowBegin; row < (i32)rowEnd; row++)
+            {
+                for (i32 col = 0; col < width; col++)
+                {
+                    for (i32 k = 0; k < bpp; k++)
+                    {
+                        size_t i = ((size_t)row * (size_t)width + (size_t)col) * (size_t)bpp + (size_t)k;
+                        u32 m = magnitude[i];
+                        m_marks[i] = 0;
+                        if (m < m_lowThresh || m == 0)
+                            continue;
+
+                        const i32* step = kSteps[orientation[i]];
+                        u32 before = s_at(magnitude, width, height, bpp, col - step[0], row - step[1], k);
+                        u32 after  = s_at(magnitude, width, height, bpp, col + step[0], row + step[1], k);
+                        if (m < before || m <= after)
+                            continue;
+
+                        m_marks[i] = (m >= m_highThresh) ? 2 : 1;
+                    }
+                }
+            }
+        }
+
+    private:
+
+        static u32 s_at(const u16* magnitude, i32 width, i32 height, i32 bpp,
+                        i32 col, i32 row, i32 k)
+        {
+            if (col < 0 || col >= width || row < 0 || row >= height)
+                return 0;
+            return magnitude[((size_t)row * (size_t)width + (size_t)col) * (size_t)bpp + (size_t)k];
+        }
+
+    private:
+
+        const tGradient& m_gradient;
+        u32              m_lowThresh;
+        u32              m_highThresh;
+        u8*              m_marks;
+};
+
+/*
+ * Hysteresis: the weak marks that connect (8-way, within their channel)
+ * to a strong mark become strong. It's a flood fill, so it's serial.
+ */
+static
+void s_cannyHysteresis(u8* marks, u32 width, u32 height, u32 bpp)
+{
+    std::vector<size_t> stack;
+    size_t size = (size_t)width * height * bpp;
+    for (size_t i = 0; i < size; i++)
+        if (marks[i] == 2)
+            stack.push_back(i);
+
+    while (!stack.empty())
     {
-        for (u32 col = 0; col < edges->width(); col++)
+        size_t i = stack.back();
+        stack.pop_back();
+
+        u32 k = (u32)(i % bpp);
+        u32 col = (u32)(i / bpp % width);
+        u32 row = (u32)(i / bpp / width);
+        for (u32 r = (row > 0 ? row-1 : 0); r <= row+1 && r < height; r++)
         {
-            for (u32 k = 0; k < bpp; k++)
+            for (u32 c = (col > 0 ? col-1 : 0); c <= col+1 && c < width; c++)
             {
-                u32 a = (*orig)[row+0][col+0][k];
-                u32 b = (*orig)[row+0][col+1][k];
-                u32 c = (*orig)[row+0][col+2][k];
-                u32 d = (*orig)[row+1][col+0][k];
-                //u32 e = (*orig)[row+1][col+1][k];
-                u32 f = (*orig)[row+1][col+2][k];
-                u32 g = (*orig)[row+2][col+0][k];
-                u32 h = (*orig)[row+2][col+1][k];
-                u32 i = (*orig)[row+2][col+2][k];
-                u32 gx = 1*a + 2*d + 1*g - 1*c - 2*f - 1*i;
-                u32 gy = 1*a + 2*b + 1*c - 1*g - 2*h - 1*i;
-                u32 grad = (u32) round(std::sqrt(gx*gx + gy*gy));
-                if (grad > clipAtValue) grad = clipAtValue;
-                if (clipAtValue != 255)
-                    grad = grad * 255 / clipAtValue;
-                (*edges)[row][col][k] = (u8) grad;
-                //f64 gradAngle = std::atan2(gy, gx);
+                size_t j = ((size_t)r * width + c) * bpp + k;
+                if (marks[j] == 1)
+                {
+                    marks[j] = 2;
+                    stack.push_back(j);
+                }
             }
         }
     }
 }
 
-void tImage::sobel(tImage* dest, u32 clipAtValue) const
+static
+void s_canny(const tImage* orig, tImage* edges, u32 lowThresh, u32 highThresh,
+             sync::tThreadPool* pool)
 {
-    s_sobel(this, dest, clipAtValue);
+    if (orig->width() < 3 || orig->height() < 3)
+    {
+        throw eInvalidArgument("Cannot run the Canny edge detector on an image "
+                "that is less than 3x3 pixels.");
+    }
+    if (lowThresh > highThresh)
+    {
+        throw eInvalidArgument("The low threshold must not be above the high threshold.");
+    }
+
+    tGradient gradient(kGradientSobel, kGradientL2, true);
+    if (pool)
+        gradient.compute(orig, *pool);
+    else
+        gradient.compute(orig);
+
+    u32 width = gradient.width();
+    u32 height = gradient.height();
+    u32 bpp = gradient.channels();
+
+    edges->setFormat(orig->format());
+    edges->setWidth(width);
+    edges->setHeight(height);
+    edges->setBufSize(width * height * bpp);
+    edges->setBufUsed(edges->bufSize());
+
+    // The marks are made straight into the output, then turned into 0 / 255.
+    u8* marks = edges->buf();
+    tCannyBands bands(gradient, lowThresh, highThresh, marks);
+    s_runBands(pool, height, bands);
+
+    s_cannyHysteresis(marks, width, height, bpp);
+
+    for (size_t i = 0; i < edges->bufUsed(); i++)
+        marks[i] = (marks[i] == 2) ? 255 : 0;
+}
+
+void tImage::canny(tImage* dest, u32 lowThresh, u32 highThresh) const
+{
+    s_canny(this, dest, lowThresh, highThresh, NULL);
+}
+
+void tImage::canny(tImage* dest, u32 lowThresh, u32 highThresh, sync::tThreadPool& pool) const
+{
+    s_canny(this, dest, lowThresh, highThresh, &pool);
 }
 
 static
@@ -892,17 +1935,20 @@ u32 s_countAround(const tImage& image, u32 x, u32 y, u32 r, u32 b)
     return count * 2;   // times two because we only looked at half the circumference (we left holes in our search)
 }
 
+/*
+ * Checks the search space given to the houghCircles() methods, and clips
+ * the radii to the biggest which could matter on this image.
+ */
 static
-std::vector<tImage::tHoughCircle> s_houghCircles(const tImage* image,
-                                                 std::vector< std::vector<u32> >& allRadiiAccumulator,
-                                                 u32 x_min, u32 x_max, u32 x_step,
-                                                 u32 y_min, u32 y_max, u32 y_step,
-                                                 u32 r_min, u32 r_max, u32 r_step,
-                                                 u32 voteThresh)
+void s_checkHoughSearch(const tImage* image,
+                        u32 x_min, u32 x_max, u32 x_step,
+                        u32 y_min, u32 y_max, u32 y_step,
+                        u32* r_min, u32* r_max, u32 r_step,
+                        u32 voteThresh)
 {
     if (x_min > x_max)   throw eInvalidArgument("x_min must be less than or equal to x_max");
     if (y_min > y_max)   throw eInvalidArgument("y_min must be less than or equal to y_max");
-    if (r_min > r_max)   throw eInvalidArgument("r_min must be less than or equal to r_max");
+    if (*r_min > *r_max) throw eInvalidArgument("r_min must be less than or equal to r_max");
     if (voteThresh == 0) throw eInvalidArgument("The cicle vote threshold must be greater than 0.");
     if (x_min >= image->width() || x_max >= image->width())
         throw eInvalidArgument("x_min and x_max must be within the width of the image");
@@ -911,8 +1957,20 @@ std::vector<tImage::tHoughCircle> s_houghCircles(const tImage* image,
     if (x_step == 0 || y_step == 0 || r_step == 0)
         throw eInvalidArgument("No step length can be zero.");
     u32 maxPossibleRadius = (u32) std::floor( hypot(image->width(), image->height()) );
-    r_min = std::min(r_min, maxPossibleRadius);
-    r_max = std::min(r_max, maxPossibleRadius);
+    *r_min = std::min(*r_min, maxPossibleRadius);
+    *r_max = std::min(*r_max, maxPossibleRadius);
+}
+
+static
+std::vector<tImage::tHoughCircle> s_houghCircles(const tImage* image,
+                                                 std::vector< std::vector<u32> >& allRadiiAccumulator,
+                                                 u32 x_min, u32 x_max, u32 x_step,
+                                                 u32 y_min, u32 y_max, u32 y_step,
+                                                 u32 r_min, u32 r_max, u32 r_step,
+                                                 u32 voteThresh)
+{
+    s_checkHoughSearch(image, x_min, x_max, x_step, y_min, y_max, y_step,
+                       &r_min, &r_max, r_step, voteThresh);
 
     u32 accumWidth = (x_max-x_min)/x_step + 1;
     u32 accumHeight = (y_max-y_min)/y_step + 1;
@@ -958,6 +2016,330 @@ std::vector<tImage::tHoughCircle> tImage::houghCircles(std::vector< std::vector<
                           voteThresh);
 }
 
+/*
+ * An edge point for the gradient Hough transform: where it is (in the
+ * original image), which channel it's on, and which way its gradient
+ * points (as one of the angle bins of the offset table).
+ */
+struct tEdgePoint
+{
+    i32 x;
+    i32 y;
+    u32 bin;
+    u32 b;
+};
+
+/*
+ * Finds the edge points the way sobel() would (an edge value over 127),
+ * keeping the gradient direction that sobel() throws away. Each row of
+ * the Sobel output gets its own list, so bands needn't share anything.
+ */
+class tEdgePointBands
+{
+    public:
+
+        tEdgePointBands(const tImage* image, u32 clipAtValue, u32 numBins,
+                        std::vector< std::vector<tEdgePoint> >& rows)
+            : m_image(image), m_clipAtValue(clipAtValue), m_numBins(numBins), m_rows(rows)
+        {
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            u32 bpp = getBPP(m_image->format());
+            u32 stride = m_image->width() * bpp;
+            u32 numCols = m_image->width() - 2;
+
+            for (u32 row = rowBegin; row < rowEnd; row++)
+            {
+                std::vector<tEdgePoint>& points = m_rows[row];
+                points.clear();
+                const u8* above = m_image->buf() + row * stride;
+                const u8* here = above + stride;
+                const u8* below = here + stride;
+
+                for (u32 col = 0; col < numCols; col++)
+                {
+                    for (u32 k = 0; k < bpp; k++)
+                    {
+                        i32 a = above[col*bpp + k];
+                        i32 b = above[(col+1)*bpp + k];
+                        i32 c = above[(col+2)*bpp + k];
+                        i32 d = here[col*bpp + k];
+                        i32 f = here[(col+2)*bpp + k];
+                        i32 g = below[col*bpp + k];
+                        i32 h = below[(col+1)*bpp + k];
+                        i32 i = below[(col+2)*bpp + k];
+                        i32 gx = 1*a + 2*d + 1*g - 1*c - 2*f - 1*i;
+                        i32 gy = 1*a + 2*b + 1*c - 1*g - 2*h - 1*i;
+                        u32 grad = (u32) round(std::sqrt((f64)(gx*gx + gy*gy)));
+                        if (grad > m_clipAtValue) grad = m_clipAtValue;
+                        if (m_clipAtValue != 255)
+                            grad = grad * 255 / m_clipAtValue;
+                        if (grad <= 127)
+                            continue;
+
+                        // The centre may be either way along the gradient,
+                        // so only the direction's angle mod pi matters.
+                        f64 angle = std::atan2((f64)gy, (f64)gx);
+                        if (angle < 0.0)
+                            angle += geo::kPI;
+                        tEdgePoint point;
+                        point.x = (i32)col + 1;
+                        point.y = (i32)row + 1;
+                        point.bin = (u32)(angle / geo::kPI * m_numBins + 0.5) % m_numBins;
+                        point.b = k;
+                        points.push_back(point);
+                    }
+                }
+            }
+        }
+
+    private:
+
+        const tImage* m_image;
+        u32           m_clipAtValue;
+        u32           m_numBins;
+        std::vector< std::vector<tEdgePoint> >& m_rows;
+};
+
+/*
+ * Where the centre is, relative to an edge point, for one angle bin and
+ * one radius (or the negative of this, for the other way along the
+ * gradient).
+ */
+struct tCircleOffset
+{
+    i32 dx;
+    i32 dy;
+};
+
+/*
+ * Sobel's gradient direction is only good to a degree or two, so more
+ * angle bins than this buy nothing but a bigger offset table.
+ */
+static const u32 kMaxHoughAngleBins = 1024;
+
+/*
+ * Does the voting for the radii [begin, end). The votes land on a pixel
+ * accumulator (one per channel, reused for each radius) covering the
+ * search space plus a pixel all round, and each search point gets the
+ * votes within a pixel of it: the edges Sobel finds are two pixels thick
+ * and their directions are rough, so the votes for a centre spread a
+ * little.
+ *
+ * The circles found for each radius go in that radius's own list, and
+ * the vote totals are added to the shared accumulator under the lock, so
+ * the result doesn't depend on how the radii were split up.
+ */
+class tHoughVoteBands
+{
+    public:
+
+        tHoughVoteBands(const std::vector< std::vector<tEdgePoint> >& rows,
+                        const std::vector<tCircleOffset>& offsets,
+                        u32 bpp,
+                        u32 x_min, u32 x_step, u32 accumWidth,
+                        u32 y_min, u32 y_step, u32 accumHeight,
+                        u32 r_min, u32 r_step, u32 numRadii,
+                        u32 voteThresh,
+                        std::vector< std::vector<tImage::tHoughCircle> >& byRadius,
+                        std::vector<u32>& totals)
+            : m_rows(rows), m_offsets(offsets), m_bpp(bpp),
+              m_x_min(x_min), m_x_step(x_step), m_accumWidth(accumWidth),
+              m_y_min(y_min), m_y_step(y_step), m_accumHeight(accumHeight),
+              m_r_min(r_min), m_r_step(r_step), m_numRadii(numRadii),
+              m_voteThresh(voteThresh),
+              m_byRadius(byRadius), m_totals(totals)
+        {
+            // Pixels [x_min-1, x_max+1] by [y_min-1, y_max+1].
+            m_pixWidth = (accumWidth-1) * x_step + 3;
+            m_pixHeight = (accumHeight-1) * y_step + 3;
+        }
+
+        void operator() (u32 begin, u32 end)
+        {
+            u32 pixels = m_pixWidth * m_pixHeight;
+            u32 cells = m_accumWidth * m_accumHeight;
+            std::vector<u32> accum(pixels * m_bpp);
+            std::vector<u32> totals(cells, 0);
+
+            for (u32 ri = begin; ri < end; ri++)
+            {
+                u32 r = m_r_min + ri * m_r_step;
+                std::fill(accum.begin(), accum.end(), 0);
+
+                for (size_t row = 0; row < m_rows.size(); row++)
+                {
+                    const std::vector<tEdgePoint>& points = m_rows[row];
+                    for (size_t p = 0; p < points.size(); p++)
+                    {
+                        const tEdgePoint& point = points[p];
+                        const tCircleOffset& off = m_offsets[point.bin * m_numRadii + ri];
+                        u32* channel = &accum[point.b * pixels];
+                        m_vote(channel, point.x + off.dx, point.y + off.dy);
+                        if (r > 0)
+                            m_vote(channel, point.x - off.dx, point.y - off.dy);
+                    }
+                }
+
+                std::vector<tImage::tHoughCircle>& circles = m_byRadius[ri];
+                for (u32 j = 0; j < m_accumHeight; j++)
+                {
+                    for (u32 i = 0; i < m_accumWidth; i++)
+                    {
+                        u32 cell = j * m_accumWidth + i;
+                        for (u32 b = 0; b < m_bpp; b++)
+                        {
+                            // The 3x3 pixels around the search point.
+                            const u32* top = &accum[b * pixels + (j*m_y_step) * m_pixWidth + i*m_x_step];
+                            const u32* mid = top + m_pixWidth;
+                            const u32* bot = mid + m_pixWidth;
+                            u32 votes = top[0] + top[1] + top[2]
+                                      + mid[0] + mid[1] + mid[2]
+                                      + bot[0] + bot[1] + bot[2];
+                            totals[cell] += votes;
+                            if (votes >= m_voteThresh)
+                                circles.push_back(tImage::tHoughCircle(m_x_min + i*m_x_step,
+                                                                       m_y_min + j*m_y_step,
+                                                                       r, b, votes));
+                        }
+                    }
+                }
+            }
+
+            sync::tAutoSync as(m_mutex);
+            for (u32 cell = 0; cell < cells; cell++)
+                m_totals[cell] += totals[cell];
+        }
+
+    private:
+
+        void m_vote(u32* accum, i32 x, i32 y) const
+        {
+            i32 px = x - (i32)m_x_min + 1;
+            i32 py = y - (i32)m_y_min + 1;
+            if (px < 0 || py < 0 || px >= (i32)m_pixWidth || py >= (i32)m_pixHeight)
+                return;
+            accum[(u32)py * m_pixWidth + (u32)px]++;
+        }
+
+    private:
+
+        const std::vector< std::vector<tEdgePoint> >& m_rows;
+        const std::vector<tCircleOffset>& m_offsets;
+        u32 m_bpp;
+        u32 m_x_min, m_x_step, m_accumWidth;
+        u32 m_y_min, m_y_step, m_accumHeight;
+        u32 m_r_min, m_r_step, m_numRadii;
+        u32 m_voteThresh;
+        u32 m_pixWidth, m_pixHeight;
+
+        std::vector< std::vector<tImage::tHoughCircle> >& m_byRadius;
+        std::vector<u32>& m_totals;
+        sync::tMutex m_mutex;
+};
+
+static
+std::vector<tImage::tHoughCircle> s_houghCirclesGradient(const tImage* image,
+                                                         std::vector< std::vector<u32> >& allRadiiAccumulator,
+                                                         u32 x_min, u32 x_max, u32 x_step,
+                                                         u32 y_min, u32 y_max, u32 y_step,
+                                                         u32 r_min, u32 r_max, u32 r_step,
+                                                         u32 voteThresh, u32 clipAtValue,
+                                                         sync::tThreadPool* pool)
+{
+    if (image->width() < 3 || image->height() < 3)
+    {
+        throw eInvalidArgument("Cannot run the Sobel operator on an image "
+                "that is less than 3x3 pixels.");
+    }
+    if (clipAtValue == 0)
+    {
+        throw eInvalidArgument("Clip value must be positive.");
+    }
+    s_checkHoughSearch(image, x_min, x_max, x_step, y_min, y_max, y_step,
+                       &r_min, &r_max, r_step, voteThresh);
+
+    u32 bpp = getBPP(image->format());
+    if (image->bufUsed() != image->width() * image->height() * bpp)
+        throw eLogicError("Something is wack with the given image.");
+
+    u32 accumWidth = (x_max-x_min)/x_step + 1;
+    u32 accumHeight = (y_max-y_min)/y_step + 1;
+    u32 numRadii = (r_max-r_min)/r_step + 1;
+
+    // Enough angle bins that the biggest circle is stepped around about a
+    // pixel at a time.
+    u32 numBins = (u32) std::ceil(geo::kPI * std::max(r_max, (u32)1));
+    numBins = std::min(std::max(numBins, (u32)16), kMaxHoughAngleBins);
+
+    std::vector<tCircleOffset> offsets(numBins * numRadii);
+    for (u32 bin = 0; bin < numBins; bin++)
+    {
+        f64 angle = bin * geo::kPI / numBins;
+        f64 c = std::cos(angle);
+        f64 s = std::sin(angle);
+        for (u32 ri = 0; ri < numRadii; ri++)
+        {
+            u32 r = r_min + ri * r_step;
+            offsets[bin * numRadii + ri].dx = (i32) round(r * c);
+            offsets[bin * numRadii + ri].dy = (i32) round(r * s);
+        }
+    }
+
+    std::vector< std::vector<tEdgePoint> > rows(image->height() - 2);
+    tEdgePointBands edgeBands(image, clipAtValue, numBins, rows);
+    s_runBands(pool, (u32)rows.size(), edgeBands);
+
+    std::vector< std::vector<tImage::tHoughCircle> > byRadius(numRadii);
+    std::vector<u32> totals(accumWidth * accumHeight, 0);
+    tHoughVoteBands voteBands(rows, offsets, bpp,
+                              x_min, x_step, accumWidth,
+                              y_min, y_step, accumHeight,
+                              r_min, r_step, numRadii,
+                              voteThresh, byRadius, totals);
+    s_runBands(pool, numRadii, voteBands);
+
+    allRadiiAccumulator = std::vector< std::vector<u32> >(accumHeight, std::vector<u32>(accumWidth, 0));
+    for (u32 j = 0; j < accumHeight; j++)
+        for (u32 i = 0; i < accumWidth; i++)
+            allRadiiAccumulator[j][i] = totals[j * accumWidth + i];
+
+    std::vector<tImage::tHoughCircle> circleList;
+    for (u32 ri = 0; ri < numRadii; ri++)
+        circleList.insert(circleList.end(), byRadius[ri].begin(), byRadius[ri].end());
+    std::sort(circleList.begin(), circleList.end(), s_houghCircleSortCompare);
+    return circleList;
+}
+
+std::vector<tImage::tHoughCircle> tImage::houghCirclesGradient(std::vector< std::vector<u32> >& allRadiiAccumulator,
+                                                               u32 x_min, u32 x_max, u32 x_step,
+                                                               u32 y_min, u32 y_max, u32 y_step,
+                                                               u32 r_min, u32 r_max, u32 r_step,
+                                                               u32 voteThresh, u32 clipAtValue) const
+{
+    return s_houghCirclesGradient(this, allRadiiAccumulator,
+                                  x_min, x_max, x_step,
+                                  y_min, y_max, y_step,
+                                  r_min, r_max, r_step,
+                                  voteThresh, clipAtValue, NULL);
+}
+
+std::vector<tImage::tHoughCircle> tImage::houghCirclesGradient(std::vector< std::vector<u32> >& allRadiiAccumulator,
+                                                               u32 x_min, u32 x_max, u32 x_step,
+                                                               u32 y_min, u32 y_max, u32 y_step,
+                                                               u32 r_min, u32 r_max, u32 r_step,
+                                                               u32 voteThresh, u32 clipAtValue,
+                                                               sync::tThreadPool& pool) const
+{
+    return s_houghCirclesGradient(this, allRadiiAccumulator,
+                                  x_min, x_max, x_step,
+                                  y_min, y_max, y_step,
+                                  r_min, r_max, r_step,
+                                  voteThresh, clipAtValue, &pool);
+}
+
 void tImage::pack(iWritable* out) const
 {
     /*
@@ -978,14 +2360,13 @@ void tImage::unpack(iReadable* in)
 {
     try
     {
-        if (m_buf)
-        {
+        if (m_buf && m_ownsBuf)
             delete [] m_buf;
-            m_buf = NULL;
-        }
+        m_buf = NULL;
         rho::unpack(in, m_bufUsed);
         m_bufSize = m_bufUsed;
         m_buf = new u8[m_bufSize];
+        m_ownsBuf = true;
         if (in->readAll(m_buf, m_bufUsed) != (i32)m_bufUsed)
             throw eBufferUnderflow("Cannot unpack image buffer from input stream.");
         rho::unpack(in, m_width);
@@ -1004,6 +2385,39 @@ void tImage::unpack(iReadable* in)
     }
 }
 
+void tImage::unpackView(tMmapReadable* in)
+{
+    if (in == NULL)
+        throw eNullPointer("in must not be NULL.");
+
+    try
+    {
+        u32 bufUsed; rho::unpack(in, bufUsed);
+        u8* view = in->borrow(bufUsed);
+        if (view == NULL)
+            throw eBufferUnderflow("Cannot unpack image buffer from input stream.");
+        if (m_buf && m_ownsBuf)
+            delete [] m_buf;
+        m_buf = view;
+        m_ownsBuf = false;
+        m_bufSize = bufUsed;
+        m_bufUsed = bufUsed;
+        rho::unpack(in, m_width);
+        rho::unpack(in, m_height);
+        u32 format; rho::unpack(in, format);
+        m_format = (nImageFormat)format;
+    }
+    catch (std::exception& e)
+    {
+        setBufSize(1024);
+        setBufUsed(0);
+        setWidth(0);
+        setHeight(0);
+        setFormat(kUnspecified);
+        throw;
+    }
+}
+
 
 }     // namespace img
 }     // namespace rho
@@ -0,0 +1,190 @@
+#if __linux__
+#pragma GCC optimize 3
+#endif
+
+#include <rho/img/tImageView.h>
+#include <rho/eRho.h>
+
+#include <cstring>
+
+
+/*
+ * The filters (scale(), sobel(), etc) are in tImage.cpp, next to the code
+ * they share with tImage's.
+ */
+
+
+namespace rho
+{
+namespace img
+{
+
+
+tImageView::tImageView()
+    : m_buf(NULL),
+      m_width(0),
+      m_height(0),
+      m_stride(0),
+      m_bpp(0),
+      m_format(kUnspecified)
+{
+}
+
+tImageView::tImageView(const tImage& image)
+    : m_buf(image.buf()),
+      m_width(image.width()),
+      m_height(image.height()),
+      m_stride(0),
+      m_bpp(0),
+      m_format(image.format())
+{
+    if (isPlanar(m_format))
+        throw eInvalidArgument("tImageView: planar images can't be viewed (see tImage::viewLumaAsGrey())");
+
+    u32 numPixels = m_width * m_height;
+    if ((i32)m_format >= 0 && m_format < kMaxImageFormat)
+    {
+        m_bpp = getBPP(m_format);
+        if (image.bufUsed() != numPixels * m_bpp)
+            throw eLogicError("Something is wack with the given image.");
+    }
+    else if (numPixels > 0)
+    {
+        // As crop() and scale() always have, take an image of no
+        // particular format to be packed.
+        if (image.bufUsed() % numPixels)
+            throw eLogicError("Something is wack with the given image.");
+        m_bpp = image.bufUsed() / numPixels;
+    }
+    m_stride = m_width * m_bpp;
+}
+
+tImageView::tImageView(const u8* buf, u32 width, u32 height, u32 stride, nImageFormat format)
+    : m_buf(buf),
+      m_width(width),
+      m_height(height),
+      m_stride(stride),
+      m_bpp(getBPP(format)),
+      m_format(format)
+{
+    if (m_stride < m_width * m_bpp)
+        throw eInvalidArgument("tImageView: the stride is shorter than a row");
+    if (m_buf == NULL && m_width > 0 && m_height > 0)
+        throw eInvalidArgument("tImageView: no buffer given");
+}
+
+const u8* tImageView::buf() const
+{
+    return m_buf;
+}
+
+u32 tImageView::width() const
+{
+    return m_width;
+}
+
+u32 tImageView::height() const
+{
+    return m_height;
+}
+
+u32 tImageView::stride() const
+{
+    return m_stride;
+}
+
+u32 tImageView::bpp() const
+{
+    return m_bpp;
+}
+
+nImageFormat tImageView::format() const
+{
+    return m_format;
+}
+
+bool tImageView::isContiguous() const
+{
+    return m_stride == m_width * m_bpp;
+}
+
+bool tImageView::looksInto(const tImage* image) const
+{
+    // An empty view has no pixels to look at, wherever it points.
+    if (m_width == 0 || m_height == 0)
+        return false;
+    const u8* begin = image->buf();
+    return m_buf != NULL && begin != NULL &&
+           m_buf >= begin && m_buf < begin + image->bufSize();
+}
+
+void tImageView::crop(geo::tRect rect, tImageView* dest) const
+{
+    if (m_width == 0 || m_height == 0)
+    {
+        *dest = *this;
+        dest->m_width = 0;
+        dest->m_height = 0;
+        return;
+    }
+
+    if (rect.x < 0.0)
+        rect.x = 0.0;
+
+    if (rect.y < 0.0)
+        rect.y = 0.0;
+
+    if (rect.x > m_width)
+        rect.x = m_width;
+
+    if (rect.y > m_height)
+        rect.y = m_height;
+
+    if (rect.width < 0.0)
+        rect.width = 0.0;
+
+    if (rect.height < 0.0)
+        rect.height = 0.0;
+
+    if ((rect.x + rect.width) > m_width)
+        rect.width = m_width - rect.x;
+
+    if ((rect.y + rect.height) > m_height)
+        rect.height = m_height - rect.y;
+
+    u32 x = (u32) rect.x;
+    u32 y = (u32) rect.y;
+
+    tImageView view = *this;
+    view.m_buf = m_buf + (size_t)y * m_stride + (size_t)x * m_bpp;
+    view.m_width = (u32) rect.width;
+    view.m_height = (u32) rect.height;
+    *dest = view;
+}
+
+void tImageView::copyTo(tImage* dest) const
+{
+    if (looksInto(dest))
+        throw eInvalidArgument("tImageView::copyTo(): the destination is the image being viewed");
+
+    u32 rowSize = m_width * m_bpp;
+
+    dest->setBufUsed(rowSize * m_height);
+    dest->setWidth(m_width);
+    dest->setHeight(m_height);
+    dest->setFormat(m_format);
+
+    if (dest->bufSize() < dest->bufUsed())
+        dest->setBufSize(dest->bufUsed());
+
+    u8* dbuf = dest->buf();
+    for (u32 row = 0; row < m_height; row++)
+    {
+        memcpy(dbuf, m_buf + (size_t)row * m_stride, rowSize);
+        dbuf += rowSize;
+    }
+}
+
+
+}    // namespace img
+}    // namespace rho
@@ -0,0 +1,315 @@
+#if __linux__
+#pragma GCC optimize 3
+#endif
+
+#include <rho/img/tIntegralImage.h>
+#include <rho/img/tImage.h>
+#include <rho/eRho.h>
+#include <rho/sync/parallel_util.h>
+
+#include <algorithm>
+
+
+namespace rho
+{
+namespace img
+{
+
+
+/*
+ * How many bands to split the work into, per thread of the pool.
+ */
+static const u32 kBandsPerThread = 4;
+
+
+/*
+ * Writes one row of the table: 'out' gets 'above' plus the running sums
+ * of the 'numPixels' pixels at 'source'. ('above' and 'out' point just
+ * past the zero column.)
+ */
+static
+void s_sumRow_scalar(const u8* source, u32 numPixels, u32 channels, const u32* above, u32* out)
+{
+    u32 running[4] = { 0, 0, 0, 0 };
+    for (u32 i = 0; i < numPixels; i++)
+    {
+        for (u32 c = 0; c < channels; c++)
+        {
+            running[c] += *source++;
+            *out++ = *above++ + running[c];
+        }
+    }
+}
+
+static
+void s_squareRow(const u8* source, u32 numPixels, u32 channels, const u64* above, u64* out)
+{
+    u64 running[4] = { 0, 0, 0, 0 };
+    for (u32 i = 0; i < numPixels; i++)
+    {
+        for (u32 c = 0; c < channels; c++)
+        {
+            u32 val = *source++;
+            running[c] += val * val;
+            *out++ = *above++ + running[c];
+        }
+    }
+}
+
+
+#if __i386__ || __x86_64__
+#include "tIntegralImage_x86.ipp"
+#define X86_KERNEL(f) f
+#else
+#define X86_KERNEL(f) NULL
+#endif
+
+
+typedef void (*tSumRowKernel)(const u8* source, u32 numPixels, u32 channels, const u32* above, u32* out);
+
+
+/*
+ * Sums rows [rowBegin, rowEnd) of the image across only, as if the row
+ * above each were zero. (The first row of the table is zero.)
+ */
+class tRowSumBands
+{
+    public:
+
+        tRowSumBands(tSumRowKernel kernel, const tImage* image, u32 channels,
+                     u32* sums, u64* squares, u32 stride)
+            : m_kernel(kernel), m_image(image), m_channels(channels),
+              m_sums(sums), m_squares(squares), m_stride(stride)
+        {
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            u32 width = m_image->width();
+            for (u32 row = rowBegin; row < rowEnd; row++)
+            {
+                const u8* source = m_image->buf() + row * width * m_channels;
+                size_t offset = (size_t)(row+1) * m_stride + m_channels;
+                m_kernel(source, width, m_channels, m_sums + m_channels, m_sums + offset);
+                if (m_squares)
+                    s_squareRow(source, width, m_channels, m_squares + m_channels, m_squares + offset);
+            }
+        }
+
+    private:
+
+        tSumRowKernel m_kernel;
+        const tImage* m_image;
+        u32           m_channels;
+        u32*          m_sums;
+        u64*          m_squares;
+        u32           m_stride;
+};
+
+/*
+ * Adds each row of the table to the row below it, for the entries
+ * [begin, end) of each row. The columns don't depend on each other.
+ */
+class tColumnSumBands
+{
+    public:
+
+        tColumnSumBands(u32* sums, u64* squares, u32 stride, u32 numRows)
+            : m_sums(sums), m_squares(squares), m_stride(stride), m_numRows(numRows)
+        {
+        }
+
+        void operator() (u32 begin, u32 end)
+        {
+            for (u32 row = 1; row < m_numRows; row++)
+            {
+                u32* out = m_sums + (size_t)row * m_stride;
+                const u32* above = out - m_stride;
+                for (u32 i = begin; i < end; i++)
+                    out[i] += above[i];
+            }
+            if (m_squares == NULL)
+                return;
+            for (u32 row = 1; row < m_numRows; row++)
+            {
+                u64* out = m_squares + (size_t)row * m_stride;
+                const u64* above = out - m_stride;
+                for (u32 i = begin; i < end; i++)
+                    out[i] += above[i];
+            }
+        }
+
+    private:
+
+        u32* m_sums;
+        u64* m_squares;
+        u32  m_stride;
+        u32  m_numRows;
+};
+
+
+tIntegralImage::tIntegralImage()
+    : m_level(getSimdLevel()),
+      m_width(0),
+      m_height(0),
+      m_channels(0)
+{
+}
+
+tIntegralImage::tIntegralImage(nSimdLevel maxLevel)
+    : m_level(std::min(maxLevel, getSimdLevel())),
+      m_width(0),
+      m_height(0),
+      m_channels(0)
+{
+}
+
+void tIntegralImage::m_prepare(const tImage* image, bool withSquares)
+{
+    nImageFormat format = image->format();
+    if (format != kRGB24 && format != kRGBA && format != kBGRA && format != kGrey)
+        throw eInvalidArgument("tIntegralImage::build(): can only sum RGB24, RGBA, BGRA and grey images");
+
+    u32 channels = getBPP(format);
+    if (image->bufUsed() != image->width() * image->height() * channels)
+        throw eLogicError("Something is wack with the given image.");
+
+    m_width = image->width();
+    m_height = image->height();
+    m_channels = channels;
+
+    u32 stride = this->stride();
+    size_t size = (size_t)(m_height+1) * stride;
+
+    // The first row and the first column are zero; everything else is
+    // written by the build.
+    m_sums.resize(size);
+    std::fill(m_sums.begin(), m_sums.begin() + stride, 0);
+    for (u32 row = 1; row <= m_height; row++)
+        for (u32 c = 0; c < m_channels; c++)
+            m_sums[(size_t)row * stride + c] = 0;
+
+    if (withSquares)
+    {
+        m_squares.resize(size);
+        std::fill(m_squares.begin(), m_squares.begin() + stride, 0);
+        for (u32 row = 1; row <= m_height; row++)
+            for (u32 c = 0; c < m_channels; c++)
+                m_squares[(size_t)row * stride + c] = 0;
+    }
+    else
+    {
+        m_squares.clear();
+    }
+}
+
+static
+tSumRowKernel s_pickKernel(nSimdLevel level)
+{
+    tSumRowKernel kernel = s_sumRow_scalar;
+    if (level >= kSimdSSE2)
+        kernel = X86_KERNEL(s_sumRow_sse2);
+    return kernel;
+}
+
+void tIntegralImage::build(const tImage* image, bool withSquares)
+{
+    m_prepare(image, withSquares);
+
+    tSumRowKernel kernel = s_pickKernel(m_level);
+    u32 stride = this->stride();
+    u32 rowBytes = m_width * m_channels;
+
+    // One pass: each row is its running sums plus the row above.
+    for (u32 row = 0; row < m_height; row++)
+    {
+        const u8* source = image->buf() + row * rowBytes;
+        size_t above = (size_t)row * stride + m_channels;
+        size_t out = above + stride;
+        kernel(source, m_width, m_channels, &m_sums[above], &m_sums[out]);
+        if (withSquares)
+            s_squareRow(source, m_width, m_channels, &m_squares[above], &m_squares[out]);
+    }
+}
+
+void tIntegralImage::build(const tImage* image, bool withSquares, sync::tThreadPool& pool)
+{
+    m_prepare(image, withSquares);
+
+    u32 stride = this->stride();
+    u32* sums = &m_sums[0];
+    u64* squares = withSquares ? &m_squares[0] : NULL;
+    u32 numBands = pool.getNumThreads() * kBandsPerThread;
+
+    // The rows don't depend on each other when summed across only...
+    tRowSumBands rows(s_pickKernel(m_level), image, m_channels, sums, squares, stride);
+    u32 grain = std::max((m_height + numBands - 1) / numBands, (u32)1);
+    sync::parallelFor(pool, 0, m_height, grain, rows);
+
+    // ...and then the columns don't depend on each other when summed down.
+    // (At least a cache line of columns per band.)
+    tColumnSumBands columns(sums, squares, stride, m_height+1);
+    grain = std::max((stride + numBands - 1) / numBands, (u32)16);
+    sync::parallelFor(pool, 0, stride, grain, columns);
+}
+
+u32 tIntegralImage::width() const
+{
+    return m_width;
+}
+
+u32 tIntegralImage::height() const
+{
+    return m_height;
+}
+
+u32 tIntegralImage::channels() const
+{
+    return m_channels;
+}
+
+bool tIntegralImage::hasSquares() const
+{
+    return !m_squares.empty();
+}
+
+u32 tIntegralImage::sum(u32 x0, u32 y0, u32 x1, u32 y1, u32 channel) const
+{
+    if (x0 > x1 || x1 > m_width || y0 > y1 || y1 > m_height || channel >= m_channels)
+        throw eInvalidArgument("tIntegralImage::sum(): the rectangle or channel is out of bounds");
+
+    const u32* top = &m_sums[(size_t)y0 * stride() + channel];
+    const u32* bottom = &m_sums[(size_t)y1 * stride() + channel];
+    return bottom[x1*m_channels] - bottom[x0*m_channels] - top[x1*m_channels] + top[x0*m_channels];
+}
+
+u64 tIntegralImage::sumOfSquares(u32 x0, u32 y0, u32 x1, u32 y1, u32 channel) const
+{
+    if (!hasSquares())
+        throw eLogicError("tIntegralImage::sumOfSquares(): the table was built without squares");
+    if (x0 > x1 || x1 > m_width || y0 > y1 || y1 > m_height || channel >= m_channels)
+        throw eInvalidArgument("tIntegralImage::sumOfSquares(): the rectangle or channel is out of bounds");
+
+    const u64* top = &m_squares[(size_t)y0 * stride() + channel];
+    const u64* bottom = &m_squares[(size_t)y1 * stride() + channel];
+    return bottom[x1*m_channels] - bottom[x0*m_channels] - top[x1*m_channels] + top[x0*m_channels];
+}
+
+const u32* tIntegralImage::sums() const
+{
+    return m_sums.empty() ? NULL : &m_sums[0];
+}
+
+const u64* tIntegralImage::squares() const
+{
+    return m_squares.empty() ? NULL : &m_squares[0];
+}
+
+u32 tIntegralImage::stride() const
+{
+    return (m_width+1) * m_channels;
+}
+
+
+}  // namespace img
+}  // namespace rho
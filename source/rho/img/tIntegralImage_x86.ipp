@@ -0,0 +1,125 @@
+/*
+ * SSE2 versions of the row kernel in tIntegralImage.cpp.
+ *
+ * This file is included by tIntegralImage.cpp on x86 machines only, and
+ * every function has a target attribute; see nImageFormat_x86.ipp.
+ *
+ * The sums are all 32-bit integer additions which wrap the same way in
+ * vector lanes as in scalar code, so the table is exactly the same.
+ */
+
+#include <emmintrin.h>
+
+
+#define SSE2_FUNC  __attribute__((target("sse2")))
+
+
+/*
+ * The running sums of the eight 16-bit lanes (three shift-and-adds).
+ * Eight bytes sum to at most 2040, so the lanes can't overflow.
+ */
+static inline SSE2_FUNC
+__m128i s_prefix16_sse2(__m128i v)
+{
+    v = _mm_add_epi16(v, _mm_slli_si128(v, 2));
+    v = _mm_add_epi16(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi16(v, _mm_slli_si128(v, 8));
+    return v;
+}
+
+/*
+ * Grey: sixteen pixels at a time. The running sums within the sixteen
+ * are done as 16-bit lanes, then widened, and the total so far (kept in
+ * every lane of 'carry') is added on.
+ */
+static SSE2_FUNC
+void s_sumRowGrey_sse2(const u8* source, u32 numPixels, const u32* above, u32* out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i carry = zero;
+
+    u32 i = 0;
+    for (; i + 16 <= numPixels; i += 16)
+    {
+        __m128i pix = _mm_loadu_si128((const __m128i*)(source + i));
+        __m128i lo = s_prefix16_sse2(_mm_unpacklo_epi8(pix, zero));
+        __m128i hi = s_prefix16_sse2(_mm_unpackhi_epi8(pix, zero));
+
+        __m128i s0 = _mm_add_epi32(_mm_unpacklo_epi16(lo, zero), carry);
+        __m128i s1 = _mm_add_epi32(_mm_unpackhi_epi16(lo, zero), carry);
+        carry = _mm_shuffle_epi32(s1, 0xFF);
+        __m128i s2 = _mm_add_epi32(_mm_unpacklo_epi16(hi, zero), carry);
+        __m128i s3 = _mm_add_epi32(_mm_unpackhi_epi16(hi, zero), carry);
+        carry = _mm_shuffle_epi32(s3, 0xFF);
+
+        const __m128i* a = (const __m128i*)(above + i);
+        __m128i* o = (__m128i*)(out + i);
+        _mm_storeu_si128(o+0, _mm_add_epi32(s0, _mm_loadu_si128(a+0)));
+        _mm_storeu_si128(o+1, _mm_add_epi32(s1, _mm_loadu_si128(a+1)));
+        _mm_storeu_si128(o+2, _mm_add_epi32(s2, _mm_loadu_si128(a+2)));
+        _mm_storeu_si128(o+3, _mm_add_epi32(s3, _mm_loadu_si128(a+3)));
+    }
+
+    u32 running = (u32) _mm_cvtsi128_si32(carry);
+    for (; i < numPixels; i++)
+    {
+        running += source[i];
+        out[i] = above[i] + running;
+    }
+}
+
+/*
+ * Four channels: each pixel fills one vector of 32-bit lanes, so the
+ * running sums are plain vector additions, four pixels per load.
+ */
+static SSE2_FUNC
+void s_sumRowQuad_sse2(const u8* source, u32 numPixels, const u32* above, u32* out)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i running = zero;
+
+    u32 i = 0;
+    for (; i + 4 <= numPixels; i += 4)
+    {
+        __m128i pix = _mm_loadu_si128((const __m128i*)(source + 4*i));
+        __m128i lo = _mm_unpacklo_epi8(pix, zero);
+        __m128i hi = _mm_unpackhi_epi8(pix, zero);
+
+        const __m128i* a = (const __m128i*)(above + 4*i);
+        __m128i* o = (__m128i*)(out + 4*i);
+        running = _mm_add_epi32(running, _mm_unpacklo_epi16(lo, zero));
+        _mm_storeu_si128(o+0, _mm_add_epi32(running, _mm_loadu_si128(a+0)));
+        running = _mm_add_epi32(running, _mm_unpackhi_epi16(lo, zero));
+        _mm_storeu_si128(o+1, _mm_add_epi32(running, _mm_loadu_si128(a+1)));
+        running = _mm_add_epi32(running, _mm_unpacklo_epi16(hi, zero));
+        _mm_storeu_si128(o+2, _mm_add_epi32(running, _mm_loadu_si128(a+2)));
+        running = _mm_add_epi32(running, _mm_unpackhi_epi16(hi, zero));
+        _mm_storeu_si128(o+3, _mm_add_epi32(running, _mm_loadu_si128(a+3)));
+    }
+
+    u32 sums[4];
+    _mm_storeu_si128((__m128i*)sums, running);
+    for (; i < numPixels; i++)
+    {
+        for (u32 c = 0; c < 4; c++)
+        {
+            sums[c] += source[4*i + c];
+            out[4*i + c] = above[4*i + c] + sums[c];
+        }
+    }
+}
+
+/*
+ * RGB24 rows are left to the scalar kernel; the 3-byte pixels don't fit
+ * the lanes.
+ */
+static SSE2_FUNC
+void s_sumRow_sse2(const u8* source, u32 numPixels, u32 channels, const u32* above, u32* out)
+{
+    switch (channels)
+    {
+        case 1:  s_sumRowGrey_sse2(source, numPixels, above, out); break;
+        case 4:  s_sumRowQuad_sse2(source, numPixels, above, out); break;
+        default: s_sumRow_scalar(source, numPixels, channels, above, out); break;
+    }
+}
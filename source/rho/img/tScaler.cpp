@@ -0,0 +1,404 @@
+#if __linux__
+#pragma GCC optimize 3
+#endif
+
+#include <rho/img/tScaler.h>
+#include <rho/img/tImage.h>
+#include <rho/img/tImageView.h>
+#include <rho/eRho.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace rho
+{
+namespace img
+{
+
+
+/*
+ * The weights are fixed-point numbers with this many fraction bits.
+ */
+static const i32 kPrecision = 14;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Filters
+////////////////////////////////////////////////////////////////////////////////
+
+static
+f64 s_box(f64 x)
+{
+    return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+}
+
+static
+f64 s_triangle(f64 x)
+{
+    x = std::fabs(x);
+    return (x < 1.0) ? 1.0 - x : 0.0;
+}
+
+static
+f64 s_cubic(f64 x)
+{
+    const f64 a = -0.5;
+    x = std::fabs(x);
+    if (x < 1.0)
+        return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+    if (x < 2.0)
+        return (((x - 5.0) * x + 8.0) * x - 4.0) * a;
+    return 0.0;
+}
+
+static
+f64 s_sinc(f64 x)
+{
+    if (x == 0.0)
+        return 1.0;
+    x *= geo::kPI;
+    return std::sin(x) / x;
+}
+
+static
+f64 s_lanczos3(f64 x)
+{
+    if (x > -3.0 && x < 3.0)
+        return s_sinc(x) * s_sinc(x / 3.0);
+    return 0.0;
+}
+
+typedef f64 (*tFilterFunc)(f64 x);
+
+static
+void s_getFilter(nScaleFilter filter, tFilterFunc* func, f64* support)
+{
+    switch (filter)
+    {
+        case kScaleBox:       *func = s_box;       *support = 0.5; break;
+        case kScaleBilinear:  *func = s_triangle;  *support = 1.0; break;
+        case kScaleBicubic:   *func = s_cubic;     *support = 2.0; break;
+        case kScaleLanczos3:  *func = s_lanczos3;  *support = 3.0; break;
+        default:
+            throw eInvalidArgument("Invalid scale filter.");
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Weights
+////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Works out the weights for scaling 'inSize' pixels to 'outSize' pixels.
+ * Output pixel i is centred on input coordinate (i + 0.5) * inSize/outSize.
+ */
+static
+void s_computeWeights(u32 inSize, u32 outSize, nScaleFilter filter, tScaler::tWeights* w)
+{
+    tFilterFunc func;
+    f64 support;
+    s_getFilter(filter, &func, &support);
+
+    f64 scale = ((f64)inSize) / outSize;
+    f64 filterScale = std::max(scale, 1.0);
+    support *= filterScale;
+
+    w->maxTaps = (u32) std::ceil(support) * 2 + 1;
+    w->starts.assign(outSize, 0);
+    w->counts.assign(outSize, 0);
+    w->weights.assign(outSize * w->maxTaps, 0);
+
+    std::vector<f64> k(w->maxTaps);
+    std::vector<i32> fixed(w->maxTaps);
+
+    for (u32 i = 0; i < outSize; i++)
+    {
+        f64 center = (i + 0.5) * scale;
+        i32 lo = (i32) std::floor(center - support + 0.5);
+        i32 hi = (i32) std::floor(center + support + 0.5);
+        lo = std::max(lo, 0);
+        hi = std::min(hi, (i32)inSize);
+        if (hi - lo > (i32)w->maxTaps)
+            hi = lo + (i32)w->maxTaps;
+
+        u32 n = (u32)(hi - lo);
+        f64 total = 0.0;
+        for (u32 j = 0; j < n; j++)
+        {
+            k[j] = func((lo + j - center + 0.5) / filterScale);
+            total += k[j];
+        }
+
+        // Round to fixed point, then make the weights add up to exactly
+        // one by nudging the biggest, so flat areas stay flat.
+        i32 sum = 0;
+        u32 biggest = 0;
+        for (u32 j = 0; j < n; j++)
+        {
+            fixed[j] = (i32) std::floor(k[j] / total * (1 << kPrecision) + 0.5);
+            sum += fixed[j];
+            if (fixed[j] > fixed[biggest])
+                biggest = j;
+        }
+        fixed[biggest] += (1 << kPrecision) - sum;
+
+        // Zero weights at the ends are just wasted work.
+        u32 first = 0;
+        while (first < n && fixed[first] == 0)
+            first++;
+        while (n > first && fixed[n-1] == 0)
+            n--;
+
+        w->starts[i] = (u32)lo + first;
+        w->counts[i] = n - first;
+        for (u32 j = first; j < n; j++)
+            w->weights[i * w->maxTaps + j - first] = (i16) fixed[j];
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+// Kernels
+////////////////////////////////////////////////////////////////////////////////
+
+static
+u8 s_clip(i32 acc)
+{
+    acc >>= kPrecision;
+    if (acc < 0)
+        return 0;
+    if (acc > 255)
+        return 255;
+    return (u8) acc;
+}
+
+/*
+ * Filters one row of 'bpp'-byte pixels to the new width.
+ */
+static
+void s_horizontal_scalar(const u8* source, u8* dest, u32 bpp, const tScaler::tWeights& w)
+{
+    u32 numOut = (u32) w.starts.size();
+    for (u32 i = 0; i < numOut; i++)
+    {
+        const u8* pix = source + w.starts[i] * bpp;
+        const i16* k = &w.weights[i * w.maxTaps];
+        u32 n = w.counts[i];
+        for (u32 c = 0; c < bpp; c++)
+        {
+            i32 acc = 1 << (kPrecision-1);
+            for (u32 j = 0; j < n; j++)
+                acc += pix[j*bpp + c] * k[j];
+            *dest++ = s_clip(acc);
+        }
+    }
+}
+
+/*
+ * Writes numBytes bytes of one output row, each the weighted sum of the
+ * bytes in the same column of 'n' rows, the first at 'rows' and each
+ * 'stride' bytes after the last.
+ */
+static
+void s_vertical_scalar(const u8* rows, u32 stride, u32 n, const i16* k, u8* dest, u32 numBytes)
+{
+    for (u32 i = 0; i < numBytes; i++)
+    {
+        const u8* pix = rows + i;
+        i32 acc = 1 << (kPrecision-1);
+        for (u32 j = 0; j < n; j++)
+            acc += pix[j*stride] * k[j];
+        dest[i] = s_clip(acc);
+    }
+}
+
+
+#if __i386__ || __x86_64__
+#include "tScaler_x86.ipp"
+#define X86_KERNEL(f) f
+#else
+#define X86_KERNEL(f) NULL
+#endif
+
+
+/*
+ * Roughly how many times more a tap of the horizontal pass costs than a
+ * tap of the vertical pass.
+ */
+static const u64 kHorizontalTapCost = 4;
+
+
+typedef void (*tHorizontalKernel)(const u8* source, u8* dest, u32 bpp, const tScaler::tWeights& w);
+typedef void (*tVerticalKernel)(const u8* rows, u32 stride, u32 n, const i16* k, u8* dest, u32 numBytes);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// tScaler
+////////////////////////////////////////////////////////////////////////////////
+
+tScaler::tScaler(u32 fromWidth, u32 fromHeight,
+                 u32 toWidth,   u32 toHeight,
+                 nScaleFilter filter)
+    : m_fromWidth(fromWidth),
+      m_fromHeight(fromHeight),
+      m_toWidth(toWidth),
+      m_toHeight(toHeight),
+      m_filter(filter)
+{
+    m_init(getSimdLevel());
+}
+
+tScaler::tScaler(u32 fromWidth, u32 fromHeight,
+                 u32 toWidth,   u32 toHeight,
+                 nScaleFilter filter,
+                 nSimdLevel maxLevel)
+    : m_fromWidth(fromWidth),
+      m_fromHeight(fromHeight),
+      m_toWidth(toWidth),
+      m_toHeight(toHeight),
+      m_filter(filter)
+{
+    m_init(maxLevel);
+}
+
+void tScaler::m_init(nSimdLevel maxLevel)
+{
+    if (m_fromWidth == 0 || m_fromHeight == 0)
+        throw eInvalidArgument("tScaler: cannot scale an image of no width or no height");
+    if (m_toWidth == 0 || m_toHeight == 0)
+        throw eInvalidArgument("tScaler: cannot scale to an image of no width or no height");
+
+    m_level = std::min(maxLevel, getSimdLevel());
+
+    s_computeWeights(m_fromWidth, m_toWidth, m_filter, &m_horizontal);
+    s_computeWeights(m_fromHeight, m_toHeight, m_filter, &m_vertical);
+
+    m_firstRow = m_fromHeight;
+    m_lastRow = 0;
+    u64 verticalTaps = 0;
+    for (u32 r = 0; r < m_toHeight; r++)
+    {
+        m_firstRow = std::min(m_firstRow, m_vertical.starts[r]);
+        m_lastRow = std::max(m_lastRow, m_vertical.starts[r] + m_vertical.counts[r]);
+        verticalTaps += m_vertical.counts[r];
+    }
+    u64 horizontalTaps = 0;
+    for (u32 c = 0; c < m_toWidth; c++)
+        horizontalTaps += m_horizontal.counts[c];
+
+    // Do whichever pass order multiplies fewer bytes by weights. A
+    // horizontal tap costs a few times a vertical one, since the vertical
+    // pass works on whole rows of contiguous bytes.
+    u64 horizontalFirst = kHorizontalTapCost * (m_lastRow - m_firstRow) * horizontalTaps
+                        + verticalTaps * m_toWidth;
+    u64 verticalFirst = verticalTaps * m_fromWidth
+                      + kHorizontalTapCost * m_toHeight * horizontalTaps;
+    m_verticalFirst = verticalFirst < horizontalFirst;
+}
+
+void tScaler::scale(const tImage* from, tImage* to)
+{
+    if (from == to)
+        throw eInvalidArgument("tScaler::scale(): source and destination must be different objects");
+    if (from->width() != m_fromWidth || from->height() != m_fromHeight)
+        throw eInvalidArgument("tScaler::scale(): the source image is not the size this scaler was made for");
+
+    nImageFormat format = from->format();
+    if (format != kRGB24 && format != kRGBA && format != kBGRA && format != kGrey)
+        throw eInvalidArgument("tScaler::scale(): can only scale RGB24, RGBA, BGRA and grey images");
+
+    scale(tImageView(*from), to);
+}
+
+void tScaler::scale(const tImageView& from, tImage* to)
+{
+    if (from.looksInto(to))
+        throw eInvalidArgument("tScaler::scale(): source and destination must be different objects");
+    if (from.width() != m_fromWidth || from.height() != m_fromHeight)
+        throw eInvalidArgument("tScaler::scale(): the source image is not the size this scaler was made for");
+
+    nImageFormat format = from.format();
+    if (format != kRGB24 && format != kRGBA && format != kBGRA && format != kGrey)
+        throw eInvalidArgument("tScaler::scale(): can only scale RGB24, RGBA, BGRA and grey images");
+
+    u32 bpp = from.bpp();
+    u32 fromPitch = from.stride();
+    u32 fromStride = m_fromWidth * bpp;
+    u32 destStride = m_toWidth * bpp;
+
+    to->setFormat(format);
+    to->setWidth(m_toWidth);
+    to->setHeight(m_toHeight);
+    if (to->bufSize() < destStride * m_toHeight)
+        to->setBufSize(destStride * m_toHeight);
+    to->setBufUsed(destStride * m_toHeight);
+
+    tHorizontalKernel horizontal = s_horizontal_scalar;
+    tVerticalKernel vertical = s_vertical_scalar;
+    if (m_level >= kSimdSSE2)
+        horizontal = X86_KERNEL(s_horizontal_sse2);
+    if (m_level >= kSimdSSE2)
+        vertical = X86_KERNEL(s_vertical_sse2);
+    if (m_level >= kSimdAVX2)
+        vertical = X86_KERNEL(s_vertical_avx2);
+
+    if (m_verticalFirst)
+    {
+        // The temp image is toHeight rows of the original width.
+        m_temp.resize(fromStride * m_toHeight);
+        for (u32 r = 0; r < m_toHeight; r++)
+        {
+            vertical(from.buf() + (size_t)m_vertical.starts[r] * fromPitch, fromPitch,
+                     m_vertical.counts[r], &m_vertical.weights[r * m_vertical.maxTaps],
+                     &m_temp[r * fromStride], fromStride);
+        }
+        for (u32 r = 0; r < m_toHeight; r++)
+            horizontal(&m_temp[r * fromStride], to->buf() + r * destStride, bpp, m_horizontal);
+    }
+    else
+    {
+        // The temp image is fromHeight rows of the new width, though only
+        // the rows which some output row uses need doing.
+        m_temp.resize(destStride * m_fromHeight);
+        for (u32 r = m_firstRow; r < m_lastRow; r++)
+            horizontal(from.buf() + (size_t)r * fromPitch, &m_temp[r * destStride], bpp, m_horizontal);
+        for (u32 r = 0; r < m_toHeight; r++)
+        {
+            vertical(&m_temp[m_vertical.starts[r] * destStride], destStride,
+                     m_vertical.counts[r], &m_vertical.weights[r * m_vertical.maxTaps],
+                     to->buf() + r * destStride, destStride);
+        }
+    }
+}
+
+u32 tScaler::fromWidth() const
+{
+    return m_fromWidth;
+}
+
+u32 tScaler::fromHeight() const
+{
+    return m_fromHeight;
+}
+
+u32 tScaler::toWidth() const
+{
+    return m_toWidth;
+}
+
+u32 tScaler::toHeight() const
+{
+    return m_toHeight;
+}
+
+nScaleFilter tScaler::filter() const
+{
+    return m_filter;
+}
+
+
+}  // namespace img
+}  // namespace rho
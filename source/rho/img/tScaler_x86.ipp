@@ -0,0 +1,183 @@
+/*
+ * SSE2 / AVX2 versions of the filtering kernels in tScaler.cpp.
+ *
+ * This file is included by tScaler.cpp on x86 machines only, and every
+ * function has a target attribute; see nImageFormat_x86.ipp.
+ *
+ * The filtering is all integer math, so the order of the additions doesn't
+ * matter and every kernel gives exactly the bytes the scalar kernel does.
+ * Two taps are done per _mm_madd_epi16(): the bytes of two pixels (or
+ * rows) are interleaved as 16-bit lanes and multiplied by the pair of
+ * weights.
+ */
+
+#include <emmintrin.h>
+#include <immintrin.h>
+
+
+#define SSE2_FUNC  __attribute__((target("sse2")))
+#define AVX2_FUNC  __attribute__((target("avx2")))
+
+
+/*
+ * A 32-bit lane holding the 16-bit weights (lo, hi).
+ */
+static inline
+i32 s_weightPair(i16 lo, i16 hi)
+{
+    return (i32)((u32)(u16)lo | ((u32)(u16)hi << 16));
+}
+
+/*
+ * Loads a 3- or 4-byte pixel into the low lane, without reading past it.
+ * (The 3-byte pixel is put together in a register; going through memory
+ * with a 3-byte store and a 4-byte load stalls store forwarding.)
+ */
+template <u32 kBpp>
+static inline SSE2_FUNC
+__m128i s_loadPixel_sse2(const u8* pix)
+{
+    if (kBpp == 4)
+    {
+        i32 val;
+        memcpy(&val, pix, 4);
+        return _mm_cvtsi32_si128(val);
+    }
+    u32 val = (u32)pix[0] | ((u32)pix[1] << 8) | ((u32)pix[2] << 16);
+    return _mm_cvtsi32_si128((i32)val);
+}
+
+template <u32 kBpp>
+static SSE2_FUNC
+void s_horizontal_sse2(const u8* source, u8* dest, const tScaler::tWeights& w)
+{
+    const u32 bpp = kBpp;
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(1 << (kPrecision-1));
+
+    u32 numOut = (u32) w.starts.size();
+    for (u32 i = 0; i < numOut; i++)
+    {
+        const u8* pix = source + w.starts[i] * bpp;
+        const i16* k = &w.weights[i * w.maxTaps];
+        u32 n = w.counts[i];
+
+        __m128i acc = half;
+        u32 j = 0;
+        for ( ; j + 1 < n; j += 2)
+        {
+            __m128i a = s_loadPixel_sse2<kBpp>(pix + j*bpp);
+            __m128i b = s_loadPixel_sse2<kBpp>(pix + (j+1)*bpp);
+            __m128i ab = _mm_unpacklo_epi8(_mm_unpacklo_epi8(a, b), zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(ab, _mm_set1_epi32(s_weightPair(k[j], k[j+1]))));
+        }
+        if (j < n)
+        {
+            __m128i a = s_loadPixel_sse2<kBpp>(pix + j*bpp);
+            __m128i a0 = _mm_unpacklo_epi8(_mm_unpacklo_epi8(a, zero), zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(a0, _mm_set1_epi32(s_weightPair(k[j], 0))));
+        }
+
+        acc = _mm_srai_epi32(acc, kPrecision);
+        acc = _mm_packs_epi32(acc, acc);
+        acc = _mm_packus_epi16(acc, acc);
+        u32 out = (u32) _mm_cvtsi128_si32(acc);
+        for (u32 c = 0; c < bpp; c++, out >>= 8)
+            *dest++ = (u8) out;
+    }
+}
+
+static SSE2_FUNC
+void s_horizontal_sse2(const u8* source, u8* dest, u32 bpp, const tScaler::tWeights& w)
+{
+    if (bpp == 4)
+        s_horizontal_sse2<4>(source, dest, w);
+    else if (bpp == 3)
+        s_horizontal_sse2<3>(source, dest, w);
+    else
+        s_horizontal_scalar(source, dest, bpp, w);
+}
+
+static SSE2_FUNC
+void s_vertical_sse2(const u8* rows, u32 stride, u32 n, const i16* k, u8* dest, u32 numBytes)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi32(1 << (kPrecision-1));
+
+    u32 i = 0;
+    for ( ; i + 16 <= numBytes; i += 16)
+    {
+        __m128i acc0 = half, acc1 = half, acc2 = half, acc3 = half;
+        const u8* pix = rows + i;
+        u32 j = 0;
+        for ( ; j < n; j += 2, pix += 2*stride)
+        {
+            __m128i a = _mm_loadu_si128((const __m128i*)pix);
+            __m128i b = zero;
+            __m128i w = _mm_set1_epi32(s_weightPair(k[j], 0));
+            if (j + 1 < n)
+            {
+                b = _mm_loadu_si128((const __m128i*)(pix + stride));
+                w = _mm_set1_epi32(s_weightPair(k[j], k[j+1]));
+            }
+            __m128i alo = _mm_unpacklo_epi8(a, zero);
+            __m128i ahi = _mm_unpackhi_epi8(a, zero);
+            __m128i blo = _mm_unpacklo_epi8(b, zero);
+            __m128i bhi = _mm_unpackhi_epi8(b, zero);
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi16(alo, blo), w));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi16(alo, blo), w));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi16(ahi, bhi), w));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi16(ahi, bhi), w));
+        }
+        __m128i lo = _mm_packs_epi32(_mm_srai_epi32(acc0, kPrecision), _mm_srai_epi32(acc1, kPrecision));
+        __m128i hi = _mm_packs_epi32(_mm_srai_epi32(acc2, kPrecision), _mm_srai_epi32(acc3, kPrecision));
+        _mm_storeu_si128((__m128i*)(dest + i), _mm_packus_epi16(lo, hi));
+    }
+
+    s_vertical_scalar(rows + i, stride, n, k, dest + i, numBytes - i);
+}
+
+/*
+ * As above, 32 bytes at a time. The unpacks and packs all work within
+ * 128-bit lanes, and the packs undo the unpacks, so the bytes come out
+ * in order without any cross-lane shuffling.
+ */
+static AVX2_FUNC
+void s_vertical_avx2(const u8* rows, u32 stride, u32 n, const i16* k, u8* dest, u32 numBytes)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i half = _mm256_set1_epi32(1 << (kPrecision-1));
+
+    u32 i = 0;
+    for ( ; i + 32 <= numBytes; i += 32)
+    {
+        __m256i acc0 = half, acc1 = half, acc2 = half, acc3 = half;
+        const u8* pix = rows + i;
+        u32 j = 0;
+        for ( ; j < n; j += 2, pix += 2*stride)
+        {
+            __m256i a = _mm256_loadu_si256((const __m256i*)pix);
+            __m256i b = zero;
+            __m256i w = _mm256_set1_epi32(s_weightPair(k[j], 0));
+            if (j + 1 < n)
+            {
+                b = _mm256_loadu_si256((const __m256i*)(pix + stride));
+                w = _mm256_set1_epi32(s_weightPair(k[j], k[j+1]));
+            }
+            __m256i alo = _mm256_unpacklo_epi8(a, zero);
+            __m256i ahi = _mm256_unpackhi_epi8(a, zero);
+            __m256i blo = _mm256_unpacklo_epi8(b, zero);
+            __m256i bhi = _mm256_unpackhi_epi8(b, zero);
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi16(alo, blo), w));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi16(alo, blo), w));
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi16(ahi, bhi), w));
+            acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi16(ahi, bhi), w));
+        }
+        __m256i lo = _mm256_packs_epi32(_mm256_srai_epi32(acc0, kPrecision), _mm256_srai_epi32(acc1, kPrecision));
+        __m256i hi = _mm256_packs_epi32(_mm256_srai_epi32(acc2, kPrecision), _mm256_srai_epi32(acc3, kPrecision));
+        _mm256_storeu_si256((__m256i*)(dest + i), _mm256_packus_epi16(lo, hi));
+    }
+
+    s_vertical_sse2(rows + i, stride, n, k, dest + i, numBytes - i);
+}
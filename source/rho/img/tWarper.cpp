@@ -0,0 +1,274 @@
+#if __linux__
+#pragma GCC optimize 3
+#endif
+
+#include <rho/img/tWarper.h>
+#include <rho/img/tImage.h>
+#include <rho/eRho.h>
+#include <rho/sync/parallel_util.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+namespace rho
+{
+namespace img
+{
+
+
+static
+i64 s_fixed(f64 val)
+{
+    return (i64) std::floor(val * 65536.0 + 0.5);
+}
+
+
+/*
+ * Blends the (up to) four source pixels for each output pixel of a row.
+ * A neighbour whose weight is zero isn't read, which is what keeps the
+ * last row and column of the source from reading past the image.
+ */
+template <u32 kBpp>
+static
+void s_sampleRow(const u8* source, u32 stride, const tWarper::tRemap* remap, u32 n, u8* dest)
+{
+    for (u32 i = 0; i < n; i++, dest += kBpp)
+    {
+        if (remap[i].offset < 0)
+        {
+            for (u32 c = 0; c < kBpp; c++)
+                dest[c] = 0;
+            continue;
+        }
+
+        u32 fx = remap[i].fx;
+        u32 fy = remap[i].fy;
+        const u8* p00 = source + (u32)remap[i].offset * kBpp;
+        const u8* p01 = p00 + (fx ? kBpp : 0);
+        const u8* p10 = p00 + (fy ? stride : 0);
+        const u8* p11 = p10 + (fx ? kBpp : 0);
+
+        u32 w00 = (256-fx) * (256-fy);
+        u32 w01 = fx * (256-fy);
+        u32 w10 = (256-fx) * fy;
+        u32 w11 = fx * fy;
+
+        for (u32 c = 0; c < kBpp; c++)
+        {
+            u32 val = w00*p00[c] + w01*p01[c] + w10*p10[c] + w11*p11[c];
+            dest[c] = (u8) ((val + 32768) >> 16);
+        }
+    }
+}
+
+
+tWarper::tWarper(u32 fromWidth, u32 fromHeight,
+                 u32 toWidth,   u32 toHeight,
+                 const geo::tTrans4& trans)
+    : m_fromWidth(fromWidth),
+      m_fromHeight(fromHeight),
+      m_toWidth(toWidth),
+      m_toHeight(toHeight)
+{
+    if (m_fromWidth == 0 || m_fromHeight == 0)
+        throw eInvalidArgument("tWarper: cannot warp an image of no width or no height");
+    if (m_toWidth == 0 || m_toHeight == 0)
+        throw eInvalidArgument("tWarper: cannot warp to an image of no width or no height");
+
+    // Invert the 2D part: x' = a*x + b*y + tx, y' = c*x + d*y + ty.
+    f64 a = trans[0][0], b = trans[0][1], tx = trans[0][3];
+    f64 c = trans[1][0], d = trans[1][1], ty = trans[1][3];
+    f64 det = a*d - b*c;
+    if (std::fabs(det) < 1e-12)
+        throw eInvalidArgument("tWarper: the transformation squashes the image flat (it has no inverse)");
+
+    m_ax = d / det;
+    m_bx = -b / det;
+    m_cx = (b*ty - d*tx) / det;
+    m_ay = -c / det;
+    m_by = a / det;
+    m_cy = (c*tx - a*ty) / det;
+
+    m_stepX = s_fixed(m_ax);
+    m_stepY = s_fixed(m_ay);
+}
+
+void tWarper::cacheRemapTable()
+{
+    m_table.resize((size_t)m_toWidth * m_toHeight);
+    for (u32 row = 0; row < m_toHeight; row++)
+        m_remapRow(row, &m_table[(size_t)row * m_toWidth]);
+}
+
+void tWarper::m_remapRow(u32 row, tRemap* remap) const
+{
+    // Each row starts from its own exact point (rather than stepping down
+    // from the row above), so the rows can be done in any order.
+    i64 sx = s_fixed(m_bx*row + m_cx);
+    i64 sy = s_fixed(m_by*row + m_cy);
+    i64 maxX = ((i64)m_fromWidth - 1) << 16;
+    i64 maxY = ((i64)m_fromHeight - 1) << 16;
+
+    for (u32 col = 0; col < m_toWidth; col++)
+    {
+        if (sx >= 0 && sx <= maxX && sy >= 0 && sy <= maxY)
+        {
+            remap[col].offset = (i32) ((sy >> 16) * m_fromWidth + (sx >> 16));
+            remap[col].fx = (u8) ((sx >> 8) & 0xFF);
+            remap[col].fy = (u8) ((sy >> 8) & 0xFF);
+        }
+        else
+        {
+            remap[col].offset = -1;
+            remap[col].fx = 0;
+            remap[col].fy = 0;
+        }
+        sx += m_stepX;
+        sy += m_stepY;
+    }
+}
+
+void tWarper::m_prepare(const tImage* from, tImage* to) const
+{
+    if (from == to)
+        throw eInvalidArgument("tWarper::warp(): source and destination must be different objects");
+    if (from->width() != m_fromWidth || from->height() != m_fromHeight)
+        throw eInvalidArgument("tWarper::warp(): the source image is not the size this warper was made for");
+
+    nImageFormat format = from->format();
+    if (format != kRGB24 && format != kRGBA && format != kBGRA && format != kGrey)
+        throw eInvalidArgument("tWarper::warp(): can only warp RGB24, RGBA, BGRA and grey images");
+
+    u32 bpp = getBPP(format);
+    if (from->bufUsed() != m_fromWidth * m_fromHeight * bpp)
+        throw eLogicError("Something is wack with the given image.");
+
+    u32 size = m_toWidth * m_toHeight * bpp;
+    to->setFormat(format);
+    to->setWidth(m_toWidth);
+    to->setHeight(m_toHeight);
+    if (to->bufSize() < size)
+        to->setBufSize(size);
+    to->setBufUsed(size);
+}
+
+void tWarper::warpRows(const tImage* from, tImage* to, u32 rowBegin, u32 rowEnd) const
+{
+    u32 bpp = getBPP(from->format());
+    u32 stride = m_fromWidth * bpp;
+
+    std::vector<tRemap> rowRemap;
+    if (m_table.empty())
+        rowRemap.resize(m_toWidth);
+
+    for (u32 row = rowBegin; row < rowEnd; row++)
+    {
+        const tRemap* remap;
+        if (m_table.empty())
+        {
+            m_remapRow(row, &rowRemap[0]);
+            remap = &rowRemap[0];
+        }
+        else
+        {
+            remap = &m_table[(size_t)row * m_toWidth];
+        }
+
+        u8* dest = to->buf() + row * m_toWidth * bpp;
+        switch (bpp)
+        {
+            case 1: s_sampleRow<1>(from->buf(), stride, remap, m_toWidth, dest); break;
+            case 3: s_sampleRow<3>(from->buf(), stride, remap, m_toWidth, dest); break;
+            case 4: s_sampleRow<4>(from->buf(), stride, remap, m_toWidth, dest); break;
+            default: throw eImpossiblePath();
+        }
+    }
+}
+
+void tWarper::warp(const tImage* from, tImage* to)
+{
+    m_prepare(from, to);
+    warpRows(from, to, 0, m_toHeight);
+}
+
+class tWarpBands
+{
+    public:
+
+        tWarpBands(const tWarper& warper, const tImage* from, tImage* to)
+            : m_warper(warper), m_from(from), m_to(to)
+        {
+        }
+
+        void operator() (u32 rowBegin, u32 rowEnd)
+        {
+            m_warper.warpRows(m_from, m_to, rowBegin, rowEnd);
+        }
+
+    private:
+
+        const tWarper& m_warper;
+        const tImage*  m_from;
+        tImage*        m_to;
+};
+
+void tWarper::warp(const tImage* from, tImage* to, sync::tThreadPool& pool)
+{
+    m_prepare(from, to);
+
+    // A few bands per thread, so that threads which finish early can
+    // steal some of the remaining rows.
+    u32 numBands = pool.getNumThreads() * 4;
+    u32 grain = (m_toHeight + numBands - 1) / numBands;
+    tWarpBands bands(*this, from, to);
+    sync::parallelFor(pool, 0, m_toHeight, std::max(grain, (u32)1), bands);
+}
+
+u32 tWarper::fromWidth() const
+{
+    return m_fromWidth;
+}
+
+u32 tWarper::fromHeight() const
+{
+    return m_fromHeight;
+}
+
+u32 tWarper::toWidth() const
+{
+    return m_toWidth;
+}
+
+u32 tWarper::toHeight() const
+{
+    return m_toHeight;
+}
+
+
+geo::tTrans4 rotationTransform(u32 width, u32 height, f64 angleDegrees,
+                               u32* newWidth, u32* newHeight)
+{
+    // The same canvas and placement as tImage::rotate().
+    f64 angleRad = (geo::kPI / 180.0) * angleDegrees;
+    f64 diagAng = atan(((f64)height)/width);
+    f64 diagLen = hypot(width/2.0, height/2.0);
+    f64 canvasWidth  = std::max(fabs(cos(angleRad+diagAng)), fabs(cos(angleRad-diagAng))) * diagLen * 2;
+    f64 canvasHeight = std::max(fabs(sin(angleRad+diagAng)), fabs(sin(angleRad-diagAng))) * diagLen * 2;
+    *newWidth = (u32) canvasWidth;
+    *newHeight = (u32) canvasHeight;
+
+    // Move the centre to the origin, rotate (the y axis points down, so
+    // this turns the image the same way tImage::rotate() does), then move
+    // the origin to the centre of the canvas.
+    f64 originX = width/2.0;
+    f64 originY = height/2.0;
+    return geo::tTrans4::translate(canvasWidth/2.0, canvasHeight/2.0, 0.0) *
+           geo::tTrans4::rotateZ(-angleRad) *
+           geo::tTrans4::translate(-originX, -originY, 0.0);
+}
+
+
+}  // namespace img
+}  // namespace rho
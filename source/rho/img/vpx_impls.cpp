@@ -7,6 +7,7 @@
 #include <vpx/vpx_decoder.h>  // the base header for decoding with libvpx
 #include <vpx/vp8dx.h>        // the specific decoder stuff for the vp8 and vp9 codecs
 
+#include <cstring>
 #include <sstream>
 
 
@@ -256,70 +257,48 @@ void tVpxImageEncoder::signalEndOfStream()
 
 void tVpxImageEncoder::m_convertImage(const tImage& sourceImage)
 {
-    // Get the source image into YUYV format. We only know how to convert to
-    // YV12 from YUYV, so that's why we need YUYV right here.
+    // Check the image size.
+    if (sourceImage.width() != m_width)
+        throw eRuntimeError("The given image has the wrong width.");
+    if (sourceImage.height() != m_height)
+        throw eRuntimeError("The given image has the wrong height.");
+
+    // Converting to YV12 requires that the image have even dimensions.
+    if ((m_width % 2) || (m_height % 2))
+        throw eRuntimeError("The image must have even dimensions!");
+
+    // Get the source image into I420 format. It has the same planes as the
+    // vimage's YV12 (which only stores U and V the other way around), so
+    // then it's just a matter of copying the rows.
     const tImage* image = NULL;
-    if (sourceImage.format() == kYUYV)
+    if (sourceImage.format() == kI420)
     {
         image = &sourceImage;
     }
     else
     {
-        sourceImage.convertToFormat(kYUYV, &m_tempImage);
+        sourceImage.convertToFormat(kI420, &m_tempImage);
         image = &m_tempImage;
     }
 
-    // Check the image size.
-    if (image->width() != m_width)
-        throw eRuntimeError("The given image has the wrong width.");
-    if (image->height() != m_height)
-        throw eRuntimeError("The given image has the wrong height.");
-
-    // Converting to YV12 requires that the image have even dimensions.
-    if ((m_width % 2) || (m_height % 2))
-        throw eRuntimeError("The image must have even dimensions!");
-
     // Grab the reference to our vimage.
     vpx_image_t* vimage = (vpx_image_t*)(m_vimage);
 
-    // Convert the image. The vimage is in YV12 format, so that's what we're headed for.
+    // Copy the planes.
     const u8* srcBuf = image->buf();
-    u8* yPlane = vimage->planes[VPX_PLANE_Y];
-    u8* uPlane = vimage->planes[VPX_PLANE_U];
-    u8* vPlane = vimage->planes[VPX_PLANE_V];
-    int yPlaneStride = vimage->stride[VPX_PLANE_Y];
-    int uPlaneStride = vimage->stride[VPX_PLANE_U];
-    int vPlaneStride = vimage->stride[VPX_PLANE_V];
-    u32 width = m_width;
-    u32 height = m_height;
-    for (u32 h = 0; h < height; h += 2)
+    u32 planeWidths[3] = { m_width, m_width/2, m_width/2 };
+    u32 planeHeights[3] = { m_height, m_height/2, m_height/2 };
+    int planes[3] = { VPX_PLANE_Y, VPX_PLANE_U, VPX_PLANE_V };
+    for (u32 p = 0; p < 3; p++)
     {
-        for (u32 w = 0; w < width; w += 2)
+        u8* dest = vimage->planes[planes[p]];
+        int stride = vimage->stride[planes[p]];
+        for (u32 h = 0; h < planeHeights[p]; h++)
         {
-            u8 y0 = *srcBuf++;
-            u8 u  = *srcBuf++;
-            u8 y1 = *srcBuf++;
-            u8 v  = *srcBuf++;
-            yPlane[w] = y0;
-            yPlane[w+1] = y1;
-            uPlane[w>>1] = (u8)(u>>1);
-            vPlane[w>>1] = (u8)(v>>1);
+            memcpy(dest, srcBuf, planeWidths[p]);
+            srcBuf += planeWidths[p];
+            dest += stride;
         }
-        yPlane += yPlaneStride;
-        for (u32 w = 0; w < width; w += 2)
-        {
-            u8 y0 = *srcBuf++;
-            u8 u  = *srcBuf++;
-            u8 y1 = *srcBuf++;
-            u8 v  = *srcBuf++;
-            yPlane[w] = y0;
-            yPlane[w+1] = y1;
-            uPlane[w>>1] = (u8)(uPlane[w>>1] + (u>>1));
-            vPlane[w>>1] = (u8)(vPlane[w>>1] + (v>>1));
-        }
-        yPlane += yPlaneStride;
-        uPlane += uPlaneStride;
-        vPlane += vPlaneStride;
     }
 }
 
@@ -0,0 +1,509 @@
+#include "../_pre.h"
+#include <rho/ip/tcp/tReactor.h>
+#include <rho/ip/ebIP.h>
+
+#include <algorithm>
+#include <iostream>
+
+#if __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+
+namespace rho
+{
+namespace ip
+{
+namespace tcp
+{
+
+
+struct tReactorEntry : public bNonCopyable
+{
+    int               fd;
+    refc<tServer>     server;
+    refc<tSocket>     socket;
+    iAsyncReadable*   sink;
+    iReactorObserver* obs;
+    std::vector<u8>   out;          // bytes send() couldn't write yet
+    size_t            outPos;       // how much of 'out' has been written since
+    bool              blocked;      // whether to call obs->writable() once 'out' drains
+    bool              peerClosed;   // the peer is done sending; close once 'out' drains
+    bool              ended;        // sink->endStream() has been called
+    bool              dead;         // removed, but maybe still in the current event batch
+};
+
+
+#if __linux__
+
+
+static const size_t kReadBufSize = 64*1024;
+static const int    kMaxEventsPerWait = 256;
+static const int    kAcceptRetryMS = 100;
+
+
+tReactor::tReactor()
+    : m_epollFd(-1),
+      m_wakeFd(-1),
+      m_stopping(0),
+      m_entries(),
+      m_dead(),
+      m_acceptRetries(),
+      m_readBuf(kReadBufSize)
+{
+    m_epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0)
+        throw eResourceAcquisitionError(std::string("Cannot create epoll instance: ") + strerror(errno));
+
+    m_wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeFd < 0)
+    {
+        ::close(m_epollFd);
+        throw eResourceAcquisitionError(std::string("Cannot create eventfd: ") + strerror(errno));
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;            // <-- NULL means the wake-up fd
+    if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev) != 0)
+    {
+        ::close(m_wakeFd);
+        ::close(m_epollFd);
+        throw eResourceAcquisitionError(std::string("Cannot watch eventfd: ") + strerror(errno));
+    }
+}
+
+tReactor::~tReactor()
+{
+    std::map<int, tReactorEntry*>::iterator itr;
+    for (itr = m_entries.begin(); itr != m_entries.end(); itr++)
+        delete itr->second;
+    m_entries.clear();
+    for (size_t i = 0; i < m_dead.size(); i++)
+        delete m_dead[i];
+    m_dead.clear();
+
+    ::close(m_wakeFd);
+    ::close(m_epollFd);
+}
+
+void tReactor::add(refc<tServer> server, iReactorObserver* obs)
+{
+    if (server == NULL)
+        throw eNullPointer("The server must not be NULL.");
+    if (obs == NULL)
+        throw eNullPointer("A server's observer must not be NULL.");
+    if (m_find(server->getFileDescriptor()))
+        throw eLogicError("That server is already in the reactor.");
+
+    server->setNonBlocking(true);
+
+    tReactorEntry* entry = new tReactorEntry;
+    entry->fd = server->getFileDescriptor();
+    entry->server = server;
+    entry->sink = NULL;
+    entry->obs = obs;
+    entry->outPos = 0;
+    entry->blocked = false;
+    entry->peerClosed = false;
+    entry->ended = false;
+    entry->dead = false;
+    m_register(entry, EPOLLIN | EPOLLET);
+}
+
+void tReactor::add(refc<tSocket> socket, iAsyncReadable* sink, iReactorObserver* obs)
+{
+    if (socket == NULL)
+        throw eNullPointer("The socket must not be NULL.");
+    if (sink == NULL)
+        throw eNullPointer("The socket's sink must not be NULL.");
+    if (m_find(socket->getFileDescriptor()))
+        throw eLogicError("That socket is already in the reactor.");
+
+    socket->setNonBlocking(true);
+
+    tReactorEntry* entry = new tReactorEntry;
+    entry->fd = socket->getFileDescriptor();
+    entry->socket = socket;
+    entry->sink = sink;
+    entry->obs = obs;
+    entry->outPos = 0;
+    entry->blocked = false;
+    entry->peerClosed = false;
+    entry->ended = false;
+    entry->dead = false;
+    m_register(entry, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+}
+
+void tReactor::remove(refc<tServer> server)
+{
+    tReactorEntry* entry = (server != NULL) ? m_find(server->getFileDescriptor()) : NULL;
+    if (entry == NULL || entry->server != server)
+        throw eInvalidArgument("That server is not in the reactor.");
+    m_remove(entry);
+}
+
+void tReactor::remove(refc<tSocket> socket)
+{
+    tReactorEntry* entry = (socket != NULL) ? m_find(socket->getFileDescriptor()) : NULL;
+    if (entry == NULL || entry->socket != socket)
+        throw eInvalidArgument("That socket is not in the reactor.");
+    m_remove(entry);
+}
+
+void tReactor::send(refc<tSocket> socket, const u8* buffer, i32 length)
+{
+    if (length <= 0)
+        throw eInvalidArgument("Stream read/write length must be >0");
+
+    tReactorEntry* entry = (socket != NULL) ? m_find(socket->getFileDescriptor()) : NULL;
+    if (entry == NULL || entry->socket != socket)
+        throw eInvalidArgument("That socket is not in the reactor.");
+
+    // Only write straight away if nothing is queued ahead of these bytes.
+    i32 written = 0;
+    while (entry->outPos == entry->out.size() && written < length)
+    {
+        ssize_t n = ::send(entry->fd, buffer+written, (size_t)(length-written), MSG_NOSIGNAL);
+        if (n > 0)
+            written += (i32)n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else
+        {
+            m_close(entry);
+            return;
+        }
+    }
+
+    if (written == length)
+        return;
+
+    if (entry->outPos > 0 && entry->outPos >= entry->out.size() / 2)
+    {
+        entry->out.erase(entry->out.begin(), entry->out.begin() + entry->outPos);
+        entry->outPos = 0;
+    }
+    entry->out.insert(entry->out.end(), buffer+written, buffer+length);
+    entry->blocked = true;
+}
+
+u32 tReactor::pendingOutput(refc<tSocket> socket) const
+{
+    tReactorEntry* entry = (socket != NULL) ? m_find(socket->getFileDescriptor()) : NULL;
+    if (entry == NULL || entry->socket != socket)
+        throw eInvalidArgument("That socket is not in the reactor.");
+    return (u32)(entry->out.size() - entry->outPos);
+}
+
+u32 tReactor::size() const
+{
+    return (u32)m_entries.size();
+}
+
+void tReactor::run()
+{
+    while (!__atomic_load_n(&m_stopping, __ATOMIC_SEQ_CST))
+        m_wait(-1);
+    __atomic_store_n(&m_stopping, 0, __ATOMIC_SEQ_CST);
+}
+
+u32 tReactor::runOnce(u32 timeoutMS)
+{
+    return m_wait((timeoutMS > 0x7FFFFFFF) ? 0x7FFFFFFF : (int)timeoutMS);
+}
+
+void tReactor::stop()
+{
+    __atomic_store_n(&m_stopping, 1, __ATOMIC_SEQ_CST);
+    u64 one = 1;
+    if (::write(m_wakeFd, &one, sizeof(one)) != sizeof(one) && errno != EAGAIN)
+        throw eRuntimeError(std::string("Cannot wake the reactor: ") + strerror(errno));
+}
+
+tReactorEntry* tReactor::m_find(int fd) const
+{
+    std::map<int, tReactorEntry*>::const_iterator itr = m_entries.find(fd);
+    return (itr != m_entries.end()) ? itr->second : NULL;
+}
+
+void tReactor::m_register(tReactorEntry* entry, u32 events)
+{
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.ptr = entry;
+    if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, entry->fd, &ev) != 0)
+    {
+        int err = errno;
+        delete entry;
+        throw eRuntimeError(std::string("Cannot add to epoll: ") + strerror(err));
+    }
+    m_entries[entry->fd] = entry;
+}
+
+void tReactor::m_remove(tReactorEntry* entry)
+{
+    ::epoll_ctl(m_epollFd, EPOLL_CTL_DEL, entry->fd, NULL);
+    m_entries.erase(entry->fd);
+    m_acceptRetries.erase(std::remove(m_acceptRetries.begin(), m_acceptRetries.end(), entry),
+                          m_acceptRetries.end());
+
+    // The current batch of events may still point at this entry,
+    // so it is deleted at the end of the batch.
+    entry->dead = true;
+    m_dead.push_back(entry);
+}
+
+void tReactor::m_dispatch(tReactorEntry* entry, u32 events)
+{
+    if (entry->server != NULL)
+    {
+        m_accept(entry);
+        return;
+    }
+
+    if (entry->peerClosed)
+    {
+        m_flush(entry);                  // <-- only the queued output matters now
+        return;
+    }
+
+    if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        m_read(entry);
+    if (!entry->dead && (events & EPOLLOUT))
+        m_flush(entry);
+}
+
+void tReactor::m_accept(tReactorEntry* entry)
+{
+    // Edge-triggered: take every waiting connection now.
+    while (!entry->dead)
+    {
+        refc<tSocket> socket;
+        try
+        {
+            socket = entry->server->accept();
+        }
+        catch (eSocketCreationError& e)
+        {
+            int err = e.errnum();
+            entry->obs->acceptFailed(*this, entry->server, e);
+            if (err == ECONNABORTED || err == EINTR || err == EPROTO)
+                continue;                // <-- just that connection; keep going
+
+            // Out of fds or memory, probably. The connections still
+            // waiting won't raise another edge, so try again shortly.
+            if (!entry->dead && std::find(m_acceptRetries.begin(), m_acceptRetries.end(),
+                                          entry) == m_acceptRetries.end())
+                m_acceptRetries.push_back(entry);
+            break;
+        }
+        if (socket == NULL)
+            break;
+        entry->obs->accepted(*this, entry->server, socket);
+    }
+}
+
+void tReactor::m_read(tReactorEntry* entry)
+{
+    // Edge-triggered: read until the kernel has nothing more.
+    while (!entry->dead)
+    {
+        ssize_t n = ::read(entry->fd, &m_readBuf[0], m_readBuf.size());
+        if (n > 0)
+            entry->sink->takeInput(&m_readBuf[0], (i32)n);
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else if (n == 0)
+        {
+            // The peer is done sending (though maybe not receiving).
+            // Still deliver what's queued for it, then close.
+            entry->peerClosed = true;
+            entry->ended = true;
+            entry->sink->endStream();
+            if (!entry->dead)
+                m_flush(entry);
+            break;
+        }
+        else
+        {
+            m_close(entry);              // <-- a broken connection
+            break;
+        }
+    }
+}
+
+void tReactor::m_flush(tReactorEntry* entry)
+{
+    while (entry->outPos < entry->out.size())
+    {
+        ssize_t n = ::send(entry->fd, &entry->out[entry->outPos],
+                           entry->out.size() - entry->outPos, MSG_NOSIGNAL);
+        if (n > 0)
+            entry->outPos += (size_t)n;
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        else
+        {
+            m_close(entry);
+            return;
+        }
+    }
+
+    entry->out.clear();
+    entry->outPos = 0;
+    if (entry->peerClosed)
+    {
+        ::shutdown(entry->fd, SHUT_WR);
+        m_close(entry);
+        return;
+    }
+    if (entry->blocked)
+    {
+        entry->blocked = false;
+        if (entry->obs)
+            entry->obs->writable(*this, entry->socket);
+    }
+}
+
+void tReactor::m_close(tReactorEntry* entry)
+{
+    if (entry->dead)
+        return;                          // <-- already closed or removed
+    m_remove(entry);
+
+    // Even if endStream() throws, the observer still hears about it.
+    try
+    {
+        if (!entry->ended)
+        {
+            entry->ended = true;
+            entry->sink->endStream();
+        }
+    }
+    catch (...)
+    {
+        if (entry->obs)
+            entry->obs->closed(*this, entry->socket);
+        throw;
+    }
+    if (entry->obs)
+        entry->obs->closed(*this, entry->socket);
+}
+
+void tReactor::m_guardedDispatch(tReactorEntry* entry, u32 events)
+{
+    try
+    {
+        m_dispatch(entry, events);
+        return;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Reactor callback threw an exception: "
+                  << e.what() << std::endl;
+    }
+    catch (...)
+    {
+        std::cerr << "Reactor callback threw an unknown exception type."
+                  << std::endl;
+    }
+
+    // Give up on the connection, but close it properly so that the
+    // application can let go of whatever it keeps for it.
+    if (entry->socket == NULL)
+        return;
+    try
+    {
+        m_close(entry);
+    }
+    catch (...)
+    {
+        std::cerr << "Reactor close callback threw as well; ignoring it."
+                  << std::endl;
+    }
+}
+
+u32 tReactor::m_wait(int timeoutMS)
+{
+    if (!m_acceptRetries.empty() && (timeoutMS < 0 || timeoutMS > kAcceptRetryMS))
+        timeoutMS = kAcceptRetryMS;
+
+    struct epoll_event events[kMaxEventsPerWait];
+    int n = ::epoll_wait(m_epollFd, events, kMaxEventsPerWait, timeoutMS);
+    if (n < 0)
+    {
+        if (errno == EINTR)
+            return 0;
+        throw eRuntimeError(std::string("epoll_wait() failed: ") + strerror(errno));
+    }
+
+    // Servers which couldn't accept everything last time. (Taken now, so
+    // a server which fails during this batch waits for the next one.)
+    std::vector<tReactorEntry*> retries;
+    retries.swap(m_acceptRetries);
+
+    u32 numDispatched = 0;
+    for (int i = 0; i < n; i++)
+    {
+        tReactorEntry* entry = (tReactorEntry*) events[i].data.ptr;
+        if (entry == NULL)
+        {
+            u64 count;
+            while (::read(m_wakeFd, &count, sizeof(count)) > 0) { }
+            continue;
+        }
+        if (entry->dead)
+            continue;
+
+        m_guardedDispatch(entry, events[i].events);
+        numDispatched++;
+    }
+
+    for (size_t i = 0; i < retries.size(); i++)
+        if (!retries[i]->dead)
+            m_guardedDispatch(retries[i], EPOLLIN);
+
+    for (size_t i = 0; i < m_dead.size(); i++)
+        delete m_dead[i];
+    m_dead.clear();
+
+    return numDispatched;
+}
+
+
+#else
+
+
+tReactor::tReactor()
+    : m_epollFd(-1), m_wakeFd(-1), m_stopping(0)
+{
+    throw eRuntimeError("tReactor needs epoll, so it only works on Linux.");
+}
+
+tReactor::~tReactor() { }
+void tReactor::add(refc<tServer> server, iReactorObserver* obs) { }
+void tReactor::add(refc<tSocket> socket, iAsyncReadable* sink, iReactorObserver* obs) { }
+void tReactor::remove(refc<tServer> server) { }
+void tReactor::remove(refc<tSocket> socket) { }
+void tReactor::send(refc<tSocket> socket, const u8* buffer, i32 length) { }
+u32  tReactor::pendingOutput(refc<tSocket> socket) const { return 0; }
+u32  tReactor::size() const { return 0; }
+void tReactor::run() { }
+u32  tReactor::runOnce(u32 timeoutMS) { return 0; }
+void tReactor::stop() { }
+
+
+#endif
+
+
+}   // namespace tcp
+}   // namespace ip
+}   // namespace rho
@@ -162,10 +162,20 @@ refc<tSocket> tServer::accept()
 
     if (fd == kInvalidSocket)
     {
+        #if __linux__ || __APPLE__ || __CYGWIN__
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            return refc<tSocket>(NULL);      // <-- non-blocking, and nobody's waiting
+        #elif __MINGW32__
+        if (WSAGetLastError() == WSAEWOULDBLOCK)
+            return refc<tSocket>(NULL);
+        #else
+        #error What platform are you on!?
+        #endif
+        int err = errno;
         std::ostringstream o;
         o << "Server socket failed to accept() a new connection, error: "
-          << strerror(errno);
-        throw eSocketCreationError(o.str());
+          << strerror(err);
+        throw eSocketCreationError(o.str(), err);
     }
 
     #if __APPLE__ || __CYGWIN__ || __MINGW32__
@@ -187,7 +197,7 @@ refc<tSocket> tServer::accept()
         std::ostringstream o;
         o << "Cannot set close-on-exec on the new accept()ed connection, error: "
           << strerror(err);
-        throw eSocketCreationError(o.str());
+        throw eSocketCreationError(o.str(), err);
     }
     #endif
 
@@ -235,6 +245,24 @@ refc<tSocket> tServer::accept(u32 timeoutMS)
     return this->accept();
 }
 
+void tServer::setNonBlocking(bool on)
+{
+    #if __linux__ || __APPLE__ || __CYGWIN__
+    int currentFlags = ::fcntl(m_fd, F_GETFL);
+    if (currentFlags < 0)
+        throw eRuntimeError(strerror(errno));
+    int newFlags = on ? (currentFlags | O_NONBLOCK) : (currentFlags & ~O_NONBLOCK);
+    if (::fcntl(m_fd, F_SETFL, newFlags) != 0)
+        throw eRuntimeError(strerror(errno));
+    #elif __MINGW32__
+    unsigned long nonblockflag = on ? 1 : 0;
+    if (ioctlsocket(m_fd, FIONBIO, &nonblockflag) != 0)
+        throw eRuntimeError("Cannot change the socket's blocking mode.");
+    #else
+    #error What platform are you on!?
+    #endif
+}
+
 
 }   // namespace tcp
 }   // namespace ip
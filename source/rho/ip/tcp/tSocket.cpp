@@ -3,6 +3,16 @@
 #include <rho/ip/ebIP.h>
 
 #include <sstream>
+#include <vector>
+
+#if __linux__ || __APPLE__ || __CYGWIN__
+#include <sys/uio.h>
+#endif
+
+#if __linux__
+#include <poll.h>
+#include <sys/sendfile.h>
+#endif
 
 
 namespace rho
@@ -22,6 +32,55 @@ static const int kInvalidSocket = INVALID_SOCKET;
 #endif
 
 
+static const u32 kCopyChunkSize = 64*1024;
+static const int kMaxIoVecs = 64;      // well under IOV_MAX everywhere
+
+#if __linux__
+static const u64 kSendfileChunkSize = 0x40000000;    // sendfile(2) won't do more than ~2GB per call
+static const u64 kSpliceChunkSize = 64*1024;         // the default capacity of a pipe
+#endif
+
+
+#if __linux__
+/*
+ * Waits for the non-blocking socket 'fd' to have room to write. (If the
+ * connection breaks, this returns and the next write finds out.)
+ */
+static
+void s_waitWritable(int fd)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    while (::poll(&pfd, 1, -1) < 0 && errno == EINTR) { }
+}
+#endif
+
+
+static
+u64 s_copy(iReadable& from, iWritable& to, u64 length)
+{
+    std::vector<u8> buf((length < kCopyChunkSize) ? (size_t)length : kCopyChunkSize);
+    u64 moved = 0;
+    while (moved < length)
+    {
+        u64 chunk = length - moved;
+        if (chunk > buf.size())
+            chunk = buf.size();
+        i32 r = from.read(&buf[0], (i32)chunk);
+        if (r <= 0)
+            break;
+        i32 w = to.writeAll(&buf[0], r);
+        if (w > 0)
+            moved += (u64)w;
+        if (w < r)
+            break;
+    }
+    return moved;
+}
+
+
 tSocket::tSocket(const tAddr& addr, u16 port, u32 timeoutMS)
     : m_fd(kInvalidSocket), m_readEOF(false), m_writeEOF(false),
       m_internalReaderWriter(this),
@@ -334,6 +393,24 @@ void tSocket::setTimeout(u16 seconds)
 #endif
 }
 
+void tSocket::setNonBlocking(bool on)
+{
+    #if __linux__ || __APPLE__ || __CYGWIN__
+    int currentFlags = ::fcntl(m_fd, F_GETFL);
+    if (currentFlags < 0)
+        throw eRuntimeError(strerror(errno));
+    int newFlags = on ? (currentFlags | O_NONBLOCK) : (currentFlags & ~O_NONBLOCK);
+    if (::fcntl(m_fd, F_SETFL, newFlags) != 0)
+        throw eRuntimeError(strerror(errno));
+    #elif __MINGW32__
+    unsigned long nonblockflag = on ? 1 : 0;
+    if (ioctlsocket(m_fd, FIONBIO, &nonblockflag) != 0)
+        throw eRuntimeError("Cannot change the socket's blocking mode.");
+    #else
+    #error What platform are you on!?
+    #endif
+}
+
 i32 tSocket::read(u8* buffer, i32 length)
 {
     if (m_readEOF)
@@ -348,6 +425,15 @@ i32 tSocket::readAll(u8* buffer, i32 length)
     return m_bufferedReadable.readAll(buffer, length);
 }
 
+i32 tSocket::readv(const tIoVec* bufs, i32 count)
+{
+    if (m_readEOF)
+        return -1;
+    if (m_bufferedReadable.getNumBuffered() > 0)
+        return m_bufferedReadable.readv(bufs, count);
+    return m_internalReaderWriter.readv(bufs, count);
+}
+
 i32 tSocket::write(const u8* buffer, i32 length)
 {
     if (m_writeEOF)
@@ -362,11 +448,136 @@ i32 tSocket::writeAll(const u8* buffer, i32 length)
     return m_bufferedWritable.writeAll(buffer, length);
 }
 
+i32 tSocket::writev(const tConstIoVec* bufs, i32 count)
+{
+    if (m_writeEOF)
+        return 0;
+    return m_bufferedWritable.writev(bufs, count);
+}
+
 bool tSocket::flush()
 {
     return m_bufferedWritable.flush();
 }
 
+u64 tSocket::transferFrom(tFileReadable& file, u64 length)
+{
+    if (m_writeEOF || length == 0)
+        return 0;
+    if (! flush())
+        return 0;
+
+    #if __linux__
+    u64 start = file.getPosition();
+    off_t offset = (off_t)start;
+    u64 sent = 0;
+    while (sent < length)
+    {
+        u64 chunk = length - sent;
+        if (chunk > kSendfileChunkSize)
+            chunk = kSendfileChunkSize;
+        ssize_t n = ::sendfile(m_fd, file.getFileDescriptor(), &offset, (size_t)chunk);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;        // a non-blocking socket that's full for now
+        if (n < 0 && sent == 0 && (errno == EINVAL || errno == ENOSYS))
+        {
+            // Not something sendfile() can read from (e.g. a pipe).
+            return s_copy(file, m_internalReaderWriter, length);
+        }
+        if (n < 0)
+        {
+            closeWrite();
+            break;
+        }
+        if (n == 0)
+            break;        // eof
+        sent += (u64)n;
+    }
+    file.setPosition(start + sent);
+    return sent;
+    #elif __APPLE__ || __CYGWIN__ || __MINGW32__
+    return s_copy(file, m_internalReaderWriter, length);
+    #else
+    #error What platform are you on!?
+    #endif
+}
+
+u64 tSocket::transferFrom(tSocket& source, u64 length)
+{
+    if (m_writeEOF || length == 0)
+        return 0;
+    if (! flush())
+        return 0;
+
+    // First send what 'source' has already read into its buffer.
+    u64 moved = 0;
+    u64 numBuffered = source.m_bufferedReadable.getNumBuffered();
+    if (numBuffered > 0)
+    {
+        moved = s_copy(source, m_internalReaderWriter,
+                       (numBuffered < length) ? numBuffered : length);
+        if (moved < numBuffered)
+            return moved;
+    }
+
+    #if __linux__
+    int pipeFds[2];
+    if (::pipe2(pipeFds, O_CLOEXEC) != 0)
+        throw eResourceAcquisitionError(strerror(errno));
+
+    while (moved < length && !source.m_readEOF)
+    {
+        u64 chunk = length - moved;
+        if (chunk > kSpliceChunkSize)
+            chunk = kSpliceChunkSize;
+        ssize_t n = ::splice(source.m_fd, NULL, pipeFds[1], NULL, (size_t)chunk, SPLICE_F_MOVE);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;        // a non-blocking 'source' with nothing more for now
+        if (n <= 0)
+        {
+            source.closeRead();
+            break;
+        }
+
+        // These bytes have left 'source' already, so if this socket is
+        // non-blocking and full, wait for room rather than lose them.
+        ssize_t left = n;
+        while (left > 0)
+        {
+            ssize_t w = ::splice(pipeFds[0], NULL, m_fd, NULL, (size_t)left, SPLICE_F_MOVE);
+            if (w < 0 && errno == EINTR)
+                continue;
+            if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                s_waitWritable(m_fd);
+                continue;
+            }
+            if (w <= 0)
+            {
+                closeWrite();
+                break;
+            }
+            left -= w;
+            moved += (u64)w;
+        }
+        if (left > 0)
+            break;
+    }
+
+    ::close(pipeFds[0]);
+    ::close(pipeFds[1]);
+    return moved;
+    #elif __APPLE__ || __CYGWIN__ || __MINGW32__
+    return moved + s_copy(source, m_internalReaderWriter, length - moved);
+    #else
+    #error What platform are you on!?
+    #endif
+}
+
 void tSocket::close()
 {
     flush();
@@ -467,6 +678,101 @@ i32 tSocket::m_write(const u8* buffer, i32 length)
     }
 }
 
+i32 tSocket::m_readv(const tIoVec* bufs, i32 count)
+{
+    ioVecLength(bufs, count);
+
+    if (m_readEOF)
+        return -1;
+
+    #if __linux__ || __APPLE__ || __CYGWIN__
+    struct iovec vecs[kMaxIoVecs];
+    int numVecs = 0;
+    for (i32 i = 0; i < count && numVecs < kMaxIoVecs; i++)
+    {
+        if (bufs[i].length == 0)
+            continue;
+        vecs[numVecs].iov_base = bufs[i].base;
+        vecs[numVecs].iov_len = (size_t)bufs[i].length;
+        numVecs++;
+    }
+    i32 val = (i32) ::readv(m_fd, vecs, numVecs);
+    #elif __MINGW32__
+    WSABUF vecs[kMaxIoVecs];
+    DWORD numVecs = 0;
+    for (i32 i = 0; i < count && numVecs < (DWORD)kMaxIoVecs; i++)
+    {
+        if (bufs[i].length == 0)
+            continue;
+        vecs[numVecs].buf = (CHAR*)bufs[i].base;
+        vecs[numVecs].len = (ULONG)bufs[i].length;
+        numVecs++;
+    }
+    DWORD received = 0;
+    DWORD flags = 0;
+    i32 val = (::WSARecv(m_fd, vecs, numVecs, &received, &flags, NULL, NULL) == 0) ? (i32)received : -1;
+    #else
+    #error What platform are you on!?
+    #endif
+
+    if (val <= 0)
+    {
+        closeRead();
+        return 0;
+    }
+    else
+    {
+        return val;
+    }
+}
+
+i32 tSocket::m_writev(const tConstIoVec* bufs, i32 count)
+{
+    ioVecLength(bufs, count);
+
+    if (m_writeEOF)
+        return 0;
+
+    #if __linux__ || __APPLE__ || __CYGWIN__
+    struct iovec vecs[kMaxIoVecs];
+    int numVecs = 0;
+    for (i32 i = 0; i < count && numVecs < kMaxIoVecs; i++)
+    {
+        if (bufs[i].length == 0)
+            continue;
+        vecs[numVecs].iov_base = const_cast<u8*>(bufs[i].base);
+        vecs[numVecs].iov_len = (size_t)bufs[i].length;
+        numVecs++;
+    }
+    i32 val = (i32) ::writev(m_fd, vecs, numVecs);
+    #elif __MINGW32__
+    WSABUF vecs[kMaxIoVecs];
+    DWORD numVecs = 0;
+    for (i32 i = 0; i < count && numVecs < (DWORD)kMaxIoVecs; i++)
+    {
+        if (bufs[i].length == 0)
+            continue;
+        vecs[numVecs].buf = (CHAR*)const_cast<u8*>(bufs[i].base);
+        vecs[numVecs].len = (ULONG)bufs[i].length;
+        numVecs++;
+    }
+    DWORD sent = 0;
+    i32 val = (::WSASend(m_fd, vecs, numVecs, &sent, 0, NULL, NULL) == 0) ? (i32)sent : -1;
+    #else
+    #error What platform are you on!?
+    #endif
+
+    if (val <= 0)
+    {
+        closeWrite();
+        return 0;
+    }
+    else
+    {
+        return val;
+    }
+}
+
 
 i32 tSocket::tInternalReaderWriter::read(u8* buffer, i32 length)
 {
@@ -489,11 +795,21 @@ i32 tSocket::tInternalReaderWriter::readAll(u8* buffer, i32 length)
     return amountRead;
 }
 
+i32 tSocket::tInternalReaderWriter::readv(const tIoVec* bufs, i32 count)
+{
+    return m_socket->m_readv(bufs, count);
+}
+
 i32 tSocket::tInternalReaderWriter::write(const u8* buffer, i32 length)
 {
     return m_socket->m_write(buffer, length);
 }
 
+i32 tSocket::tInternalReaderWriter::writev(const tConstIoVec* bufs, i32 count)
+{
+    return m_socket->m_writev(bufs, count);
+}
+
 i32 tSocket::tInternalReaderWriter::writeAll(const u8* buffer, i32 length)
 {
     if (length <= 0)
@@ -511,6 +827,28 @@ i32 tSocket::tInternalReaderWriter::writeAll(const u8* buffer, i32 length)
 }
 
 
+u64 transfer(iReadable* from, iWritable* to, u64 length)
+{
+    if (from == NULL)
+        throw eNullPointer("from must not be NULL.");
+    if (to == NULL)
+        throw eNullPointer("to must not be NULL.");
+
+    tSocket* socket = dynamic_cast<tSocket*>(to);
+    if (socket)
+    {
+        tFileReadable* file = dynamic_cast<tFileReadable*>(from);
+        if (file)
+            return socket->transferFrom(*file, length);
+        tSocket* source = dynamic_cast<tSocket*>(from);
+        if (source)
+            return socket->transferFrom(*source, length);
+    }
+
+    return s_copy(*from, *to, length);
+}
+
+
 } // namespace tcp
 } // namespace ip
 } // namespace rho
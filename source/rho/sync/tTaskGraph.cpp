@@ -0,0 +1,167 @@
+#include <rho/sync/tTaskGraph.h>
+
+#include <iostream>
+
+
+namespace rho
+{
+namespace sync
+{
+
+
+class tGraphNodeTask : public iRunnable, public bNonCopyable
+{
+    public:
+
+        tGraphNodeTask(tTaskGraph* graph, tTaskGraph::tNodeId id)
+            : m_graph(graph),
+              m_id(id)
+        {
+        }
+
+        void run()
+        {
+            try
+            {
+                m_graph->m_nodes[m_id].runnable->run();
+            }
+            catch (std::exception& e)
+            {
+                std::cerr << "Task graph node " << m_id
+                          << " threw an exception: "
+                          << e.what() << std::endl;
+            }
+            catch (...)
+            {
+                std::cerr << "Task graph node " << m_id
+                          << " threw an unknown exception type."
+                          << std::endl;
+            }
+            m_graph->m_finished(m_id);
+        }
+
+    private:
+
+        tTaskGraph*         m_graph;
+        tTaskGraph::tNodeId m_id;
+};
+
+
+tTaskGraph::tTaskGraph()
+    : m_nodes(),
+      m_pool(NULL),
+      m_numUnfinished(0)
+{
+}
+
+tTaskGraph::tNodeId tTaskGraph::add(refc<iRunnable> runnable)
+{
+    if (runnable == NULL)
+        throw eInvalidArgument("The runnable may not be NULL.");
+    if (m_pool)
+        throw eLogicError("Don't add to a task graph while it is running.");
+    tNode node;
+    node.runnable = runnable;
+    node.numPredecessors = 0;
+    node.numPending = 0;
+    m_nodes.push_back(node);
+    return (tNodeId)(m_nodes.size() - 1);
+}
+
+void tTaskGraph::addDependency(tNodeId before, tNodeId after)
+{
+    if (before >= m_nodes.size() || after >= m_nodes.size())
+        throw eInvalidArgument("No such task graph node.");
+    if (before == after)
+        throw eInvalidArgument("A task cannot depend on itself.");
+    if (m_pool)
+        throw eLogicError("Don't add to a task graph while it is running.");
+    m_nodes[before].successors.push_back(after);
+    m_nodes[after].numPredecessors++;
+}
+
+u32 tTaskGraph::size() const
+{
+    return (u32)m_nodes.size();
+}
+
+void tTaskGraph::run(tThreadPool& pool)
+{
+    if (m_pool)
+        throw eLogicError("This task graph is already running.");
+    if (m_nodes.empty())
+        return;
+
+    // Kahn's algorithm, just to reject cycles before anything runs.
+    {
+        std::vector<u32> pending(m_nodes.size());
+        std::vector<tNodeId> ready;
+        for (size_t i = 0; i < m_nodes.size(); i++)
+        {
+            pending[i] = m_nodes[i].numPredecessors;
+            if (pending[i] == 0)
+                ready.push_back((tNodeId)i);
+        }
+        size_t numVisited = 0;
+        while (!ready.empty())
+        {
+            tNodeId id = ready.back();
+            ready.pop_back();
+            numVisited++;
+            for (size_t j = 0; j < m_nodes[id].successors.size(); j++)
+            {
+                tNodeId succ = m_nodes[id].successors[j];
+                if (--pending[succ] == 0)
+                    ready.push_back(succ);
+            }
+        }
+        if (numVisited != m_nodes.size())
+            throw eInvalidArgument("The task graph has a cycle.");
+    }
+
+    for (size_t i = 0; i < m_nodes.size(); i++)
+        m_nodes[i].numPending = m_nodes[i].numPredecessors;
+    m_numUnfinished = (u32)m_nodes.size();
+    m_pool = &pool;
+
+    for (size_t i = 0; i < m_nodes.size(); i++)
+    {
+        if (m_nodes[i].numPredecessors == 0)
+            m_schedule((tNodeId)i);
+    }
+
+    pool.m_waitFor(&m_numUnfinished, 0);
+
+    m_pool = NULL;
+}
+
+tTaskGraph::~tTaskGraph()
+{
+}
+
+void tTaskGraph::m_schedule(tNodeId id)
+{
+    refc<iRunnable> task(new tGraphNodeTask(this, id));
+    m_pool->forget(m_pool->push(task));
+}
+
+void tTaskGraph::m_finished(tNodeId id)
+{
+    // Grab everything we need from 'this' before the final decrement,
+    // since run() may return (and the graph may die) right after it.
+    tThreadPool* pool = m_pool;
+
+    for (size_t j = 0; j < m_nodes[id].successors.size(); j++)
+    {
+        tNodeId succ = m_nodes[id].successors[j];
+        if (__atomic_sub_fetch(&m_nodes[succ].numPending, 1, __ATOMIC_ACQ_REL) == 0)
+            m_schedule(succ);
+    }
+
+    if (__atomic_sub_fetch(&m_numUnfinished, 1, __ATOMIC_ACQ_REL) == 0)
+        pool->m_wakeWaiters();
+}
+
+
+}   // namespace sync
+}   // namespace rho
@@ -1,4 +1,8 @@
 #include <rho/sync/tThreadPool.h>
+#include <rho/sync/ebSync.h>
+#include <rho/eRho.h>
+
+#include <deque>
 
 
 namespace rho
@@ -31,67 +35,210 @@ class tAutoLock
 };
 
 
+class tAutoCount
+{
+    public:
+
+        tAutoCount(u32* count)
+            : m_count(count)
+        {
+            if (m_count)
+                __atomic_add_fetch(m_count, 1, __ATOMIC_SEQ_CST);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        }
+
+        ~tAutoCount()
+        {
+            if (m_count)
+                __atomic_sub_fetch(m_count, 1, __ATOMIC_SEQ_CST);
+        }
+
+    private:
+
+        u32* m_count;
+};
+
+
+enum nTaskState
+{
+    kPending   = 0,
+    kDone      = 1,
+    kForgotten = 2
+};
+
+
+/*
+ * A worker's deque. The owning worker pushes and pops at the back;
+ * thieves take from the front. The lock is almost always uncontended.
+ */
+class tWorkerQueue : public bNonCopyable
+{
+    public:
+
+        tWorkerQueue()
+            : m_tasks()
+        {
+            if (pthread_mutex_init(&m_mutex, NULL) != 0)
+                throw eMutexCreationError();
+        }
+
+        ~tWorkerQueue()
+        {
+            pthread_mutex_destroy(&m_mutex);
+        }
+
+        void pushBack(const std::pair< u32,refc<iRunnable> >& task)
+        {
+            tAutoLock al(&m_mutex);
+            m_tasks.push_back(task);
+        }
+
+        bool popBack(std::pair< u32,refc<iRunnable> >& task)
+        {
+            tAutoLock al(&m_mutex);
+            if (m_tasks.empty())
+                return false;
+            task = m_tasks.back();
+            m_tasks.pop_back();
+            return true;
+        }
+
+        bool popFront(std::pair< u32,refc<iRunnable> >& task)
+        {
+            tAutoLock al(&m_mutex);
+            if (m_tasks.empty())
+                return false;
+            task = m_tasks.front();
+            m_tasks.pop_front();
+            return true;
+        }
+
+    private:
+
+        std::deque< std::pair< u32,refc<iRunnable> > > m_tasks;
+        pthread_mutex_t m_mutex;
+
+        char m_pad[64];     // <-- keeps neighboring queues off each other's cache lines
+};
+
+
+class tWorker;
+
+static pthread_key_t  gCurrentWorkerKey;
+static pthread_once_t gCurrentWorkerKeyOnce = PTHREAD_ONCE_INIT;
+
+static void s_makeCurrentWorkerKey()
+{
+    if (pthread_key_create(&gCurrentWorkerKey, NULL) != 0)
+        throw eResourceAcquisitionError("Can't create tls key.");
+}
+
+static tWorker* s_currentWorker()
+{
+    pthread_once(&gCurrentWorkerKeyOnce, s_makeCurrentWorkerKey);
+    return static_cast<tWorker*>(pthread_getspecific(gCurrentWorkerKey));
+}
+
+
 class tWorker : public iRunnable
 {
     public:
 
-        tWorker(tThreadPool* pool)
-            : m_pool(pool)
+        tWorker(tThreadPool* pool, u32 index)
+            : m_pool(pool),
+              m_index(index)
         {
         }
 
         void run()
         {
+            pthread_once(&gCurrentWorkerKeyOnce, s_makeCurrentWorkerKey);
+            if (pthread_setspecific(gCurrentWorkerKey, this) != 0)
+                throw eRuntimeError("Can't store tls object.");
+
             while (true)
             {
-                tThreadPool::tTask task = m_pool->m_queue.pop();
-                if (task.second == NULL)
-                    break;
-                try
-                {
-                    task.second->run();
-                }
-                catch (std::exception& e)
+                tThreadPool::tTask task;
+                if (m_pool->m_pop(m_index, task))
                 {
-                    std::cerr << "Thread pool task " << task.first
-                              << " threw an exception: "
-                              << e.what() << std::endl;
+                    m_pool->m_run(task);
+                    continue;
                 }
-                catch (...)
+
+                tAutoLock autolock(&m_pool->m_mutex);
+                tAutoCount autocount(&m_pool->m_numSleepingWorkers);
+                while (__atomic_load_n(&m_pool->m_numQueued, __ATOMIC_SEQ_CST) <= 0)
                 {
-                    std::cerr << "Thread pool task " << task.first
-                              << " threw an unknown exception type."
-                              << std::endl;
+                    if (__atomic_load_n(&m_pool->m_stopping, __ATOMIC_SEQ_CST))
+                        break;
+                    if (pthread_cond_wait(&m_pool->m_workAvailable, &m_pool->m_mutex) != 0)
+                        throw eRuntimeError("Why can't I wait on the condition?");
                 }
-                m_pool->m_addToCompleted(task.first);
+                if (__atomic_load_n(&m_pool->m_numQueued, __ATOMIC_SEQ_CST) <= 0 &&
+                    __atomic_load_n(&m_pool->m_stopping, __ATOMIC_SEQ_CST))
+                    break;
             }
+
+            pthread_setspecific(gCurrentWorkerKey, NULL);
+        }
+
+        tThreadPool* pool() const
+        {
+            return m_pool;
+        }
+
+        u32 index() const
+        {
+            return m_index;
         }
 
     private:
 
         tThreadPool* m_pool;
+        u32          m_index;
 };
 
 
 tThreadPool::tThreadPool(u32 numThreads)
-    : m_queue(8, kGrow), m_nextKey(1)
+    : m_nextQueue(0),
+      m_numQueued(0),
+      m_numSleepingWorkers(0),
+      m_numWaiters(0),
+      m_numHelpers(0),
+      m_stopping(0),
+      m_numSlots(0),
+      m_freeHead(0)
 {
     if (numThreads == 0)
     {
         throw eInvalidArgument("There must be at least one thread in the pool.");
     }
-    if (pthread_mutex_init(&m_completedMutex, NULL) != 0)
+    for (u32 i = 0; i < kMaxChunks; i++)
+    {
+        m_chunks[i] = NULL;
+    }
+    if (pthread_mutex_init(&m_mutex, NULL) != 0)
     {
         throw eMutexCreationError();
     }
+    if (pthread_cond_init(&m_workAvailable, NULL) != 0)
+    {
+        pthread_mutex_destroy(&m_mutex);
+        throw eConditionCreationError();
+    }
     if (pthread_cond_init(&m_completedWasUpdated, NULL) != 0)
     {
-        pthread_mutex_destroy(&m_completedMutex);
+        pthread_mutex_destroy(&m_mutex);
+        pthread_cond_destroy(&m_workAvailable);
         throw eConditionCreationError();
     }
     for (u32 i = 0; i < numThreads; i++)
     {
-        refc<iRunnable> worker(new tWorker(this));
+        m_queues.push_back(new tWorkerQueue);
+    }
+    for (u32 i = 0; i < numThreads; i++)
+    {
+        refc<iRunnable> worker(new tWorker(this, i));
         refc<tThread> thread(new tThread(worker));
         m_threads.push_back(thread);
     }
@@ -99,10 +246,10 @@ tThreadPool::tThreadPool(u32 numThreads)
 
 tThreadPool::~tThreadPool()
 {
-    for (u32 i = 0; i < m_threads.size(); i++)
     {
-        refc<iRunnable> runnable(NULL);
-        m_push(runnable);
+        tAutoLock autolock(&m_mutex);
+        __atomic_store_n(&m_stopping, 1, __ATOMIC_SEQ_CST);
+        pthread_cond_broadcast(&m_workAvailable);   // (only fails on a bad cond; can't throw here)
     }
     for (u32 i = 0; i < m_threads.size(); i++)
     {
@@ -110,7 +257,20 @@ tThreadPool::~tThreadPool()
     }
     m_threads.clear();
 
-    pthread_mutex_destroy(&m_completedMutex);
+    for (u32 i = 0; i < m_queues.size(); i++)
+    {
+        delete m_queues[i];
+    }
+    m_queues.clear();
+
+    for (u32 i = 0; i < kMaxChunks; i++)
+    {
+        delete [] m_chunks[i];
+        m_chunks[i] = NULL;
+    }
+
+    pthread_mutex_destroy(&m_mutex);
+    pthread_cond_destroy(&m_workAvailable);
     pthread_cond_destroy(&m_completedWasUpdated);
 }
 
@@ -128,52 +288,229 @@ tThreadPool::tTaskKey tThreadPool::push(refc<iRunnable> runnable)
 
 void tThreadPool::wait(tTaskKey key)
 {
-    tAutoLock autolock(&m_completedMutex);
-    while (m_completed.find(key) == m_completed.end())
+    u32 index;
+    tSlot& slot = m_lookup(key, index);
+
+    if (__atomic_load_n(&slot.state, __ATOMIC_ACQUIRE) == kForgotten)
+        throw eRuntimeError("Don't wait on a key you've forgotten!");
+
+    m_waitFor(&slot.state, kDone);
+
+    m_freeSlot(index);
+}
+
+void tThreadPool::forget(tTaskKey key)
+{
+    u32 index;
+    tSlot& slot = m_lookup(key, index);
+
+    u32 expected = kPending;
+    if (__atomic_compare_exchange_n(&slot.state, &expected, (u32)kForgotten, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return;        // <-- the worker will free the slot when the task finishes
+
+    if (expected == kDone)
+        m_freeSlot(index);
+}
+
+u32 tThreadPool::m_allocSlot()
+{
+    // Pop from the free list. The upper 32 bits of m_freeHead are a tag
+    // which changes on every update (so a stale head can't be CAS'd back
+    // in); the lower 32 bits are the slot index plus one (zero means empty).
+    u64 head = __atomic_load_n(&m_freeHead, __ATOMIC_ACQUIRE);
+    while ((head & 0xFFFFFFFF) != 0)
     {
-        if (m_forgotten.find(key) != m_forgotten.end())
-            throw eRuntimeError("Don't wait on a key you've forgotten!");
-        if (pthread_cond_wait(&m_completedWasUpdated, &m_completedMutex) != 0)
-            throw eRuntimeError("Why can't I wait on the condition?");
+        u32 index = (u32)(head & 0xFFFFFFFF) - 1;
+        u32 next = __atomic_load_n(&m_slot(index).nextFree, __ATOMIC_RELAXED);
+        u64 newHead = (((head >> 32) + 1) << 32) | next;
+        if (__atomic_compare_exchange_n(&m_freeHead, &head, newHead, true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            __atomic_store_n(&m_slot(index).state, (u32)kPending, __ATOMIC_RELAXED);
+            return index;
+        }
     }
-    m_completed.erase(key);
+
+    // The free list is empty, so take a never-used slot.
+    u32 index = __atomic_fetch_add(&m_numSlots, 1, __ATOMIC_RELAXED);
+    u32 chunk = index / kSlotsPerChunk;
+    if (chunk >= kMaxChunks)
+    {
+        __atomic_fetch_sub(&m_numSlots, 1, __ATOMIC_RELAXED);
+        throw eResourceAcquisitionError("Too many outstanding thread pool tasks!");
+    }
+    if (__atomic_load_n(&m_chunks[chunk], __ATOMIC_ACQUIRE) == NULL)
+    {
+        tSlot* slots = new tSlot[kSlotsPerChunk];
+        for (u32 i = 0; i < kSlotsPerChunk; i++)
+        {
+            slots[i].generation = 1;
+            slots[i].state = kPending;
+            slots[i].nextFree = 0;
+        }
+        tSlot* expected = NULL;
+        if (!__atomic_compare_exchange_n(&m_chunks[chunk], &expected, slots, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            delete [] slots;
+    }
+    return index;
 }
 
-void tThreadPool::forget(tTaskKey key)
+void tThreadPool::m_freeSlot(u32 index)
 {
-    tAutoLock autolock(&m_completedMutex);
-    if (m_completed.find(key) != m_completed.end())
-        m_completed.erase(key);
-    else
-        m_forgotten.insert(key);
+    tSlot& slot = m_slot(index);
+    __atomic_add_fetch(&slot.generation, 1, __ATOMIC_RELEASE);
+
+    u64 head = __atomic_load_n(&m_freeHead, __ATOMIC_ACQUIRE);
+    while (true)
+    {
+        __atomic_store_n(&slot.nextFree, (u32)(head & 0xFFFFFFFF), __ATOMIC_RELAXED);
+        u64 newHead = (((head >> 32) + 1) << 32) | (u64)(index + 1);
+        if (__atomic_compare_exchange_n(&m_freeHead, &head, newHead, true,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            break;
+    }
 }
 
-tThreadPool::tTaskKey tThreadPool::m_incrementKey()
+tThreadPool::tSlot& tThreadPool::m_slot(u32 index)
 {
-    tAutoLock autolock(&m_completedMutex);
-    tTaskKey key = m_nextKey++;
+    tSlot* chunk = __atomic_load_n(&m_chunks[index / kSlotsPerChunk], __ATOMIC_ACQUIRE);
+    return chunk[index % kSlotsPerChunk];
+}
+
+tThreadPool::tSlot& tThreadPool::m_lookup(tTaskKey key, u32& index)
+{
+    index = (u32)(key & 0xFFFFFFFF);
+    u32 generation = (u32)(key >> 32);
+    if (index >= __atomic_load_n(&m_numSlots, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(&m_chunks[index / kSlotsPerChunk], __ATOMIC_ACQUIRE) == NULL)
+        throw eInvalidArgument("That is not a task key from this thread pool.");
+    tSlot& slot = m_slot(index);
+    if (__atomic_load_n(&slot.generation, __ATOMIC_ACQUIRE) != generation)
+        throw eRuntimeError("Don't wait on a key you've forgotten (or already waited on)!");
+    return slot;
+}
+
+tThreadPool::tTaskKey tThreadPool::m_push(refc<iRunnable> runnable)
+{
+    u32 index = m_allocSlot();
+    tTaskKey key = ((tTaskKey)__atomic_load_n(&m_slot(index).generation, __ATOMIC_RELAXED) << 32)
+                   | index;
+
+    u32 target;
+    tWorker* worker = s_currentWorker();
+    if (worker && worker->pool() == this)
+        target = worker->index();
+    else
+        target = __atomic_fetch_add(&m_nextQueue, 1, __ATOMIC_RELAXED) % (u32)m_queues.size();
+
+    m_queues[target]->pushBack(std::make_pair(index, runnable));
+    __atomic_add_fetch(&m_numQueued, 1, __ATOMIC_SEQ_CST);
+    m_wakeWorkers();
+
     return key;
 }
 
-void tThreadPool::m_addToCompleted(tTaskKey key)
+bool tThreadPool::m_pop(u32 workerIndex, tTask& task)
+{
+    bool found = m_queues[workerIndex]->popBack(task);
+    for (u32 i = 1; !found && i < m_queues.size(); i++)
+    {
+        found = m_queues[(workerIndex + i) % m_queues.size()]->popFront(task);
+    }
+    if (found)
+        __atomic_sub_fetch(&m_numQueued, 1, __ATOMIC_SEQ_CST);
+    return found;
+}
+
+void tThreadPool::m_run(tTask& task)
+{
+    try
+    {
+        task.second->run();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Thread pool task " << task.first
+                  << " threw an exception: "
+                  << e.what() << std::endl;
+    }
+    catch (...)
+    {
+        std::cerr << "Thread pool task " << task.first
+                  << " threw an unknown exception type."
+                  << std::endl;
+    }
+    m_complete(task.first);
+}
+
+void tThreadPool::m_complete(u32 index)
 {
-    tAutoLock autolock(&m_completedMutex);
-    if (m_forgotten.find(key) != m_forgotten.end())
-        m_forgotten.erase(key);
+    u32 old = __atomic_exchange_n(&m_slot(index).state, (u32)kDone, __ATOMIC_ACQ_REL);
+    if (old == kForgotten)
+        m_freeSlot(index);
     else
+        m_wakeWaiters();
+}
+
+void tThreadPool::m_waitFor(const u32* word, u32 value)
+{
+    tWorker* worker = s_currentWorker();
+    if (worker && worker->pool() != this)
+        worker = NULL;
+
+    while (__atomic_load_n(word, __ATOMIC_ACQUIRE) != value)
     {
-        m_completed.insert(key);
-        if (pthread_cond_broadcast(&m_completedWasUpdated) != 0)
-            throw eRuntimeError("Why can't I broadcast?");
+        // A worker thread helps out rather than sleeping while there is
+        // queued work (the task it's waiting on might be in its own deque).
+        if (worker)
+        {
+            tTask task;
+            if (m_pop(worker->index(), task))
+            {
+                m_run(task);
+                continue;
+            }
+        }
+
+        tAutoLock autolock(&m_mutex);
+        tAutoCount waitcount(&m_numWaiters);
+        tAutoCount helpcount(worker ? &m_numHelpers : NULL);
+        while (__atomic_load_n(word, __ATOMIC_ACQUIRE) != value)
+        {
+            if (worker && __atomic_load_n(&m_numQueued, __ATOMIC_SEQ_CST) > 0)
+                break;
+            if (pthread_cond_wait(&m_completedWasUpdated, &m_mutex) != 0)
+                throw eRuntimeError("Why can't I wait on the condition?");
+        }
     }
 }
 
-tThreadPool::tTaskKey tThreadPool::m_push(refc<iRunnable> runnable)
+void tThreadPool::m_wakeWorkers()
 {
-    tTaskKey key = m_incrementKey();
-    tTask task = std::make_pair(key, runnable);
-    m_queue.push(task);
-    return key;
+    // Pairs with tAutoCount in the sleepers: either a sleeper sees the new
+    // m_numQueued before sleeping, or we see it counted as sleeping here.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    u32 numSleeping = __atomic_load_n(&m_numSleepingWorkers, __ATOMIC_RELAXED);
+    u32 numHelpers = __atomic_load_n(&m_numHelpers, __ATOMIC_RELAXED);
+    if (numSleeping == 0 && numHelpers == 0)
+        return;
+    tAutoLock autolock(&m_mutex);
+    if (numSleeping > 0 && pthread_cond_signal(&m_workAvailable) != 0)
+        throw eRuntimeError("Why can't I signal?");
+    if (numHelpers > 0 && pthread_cond_broadcast(&m_completedWasUpdated) != 0)
+        throw eRuntimeError("Why can't I broadcast?");
+}
+
+void tThreadPool::m_wakeWaiters()
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&m_numWaiters, __ATOMIC_RELAXED) == 0)
+        return;
+    tAutoLock autolock(&m_mutex);
+    if (pthread_cond_broadcast(&m_completedWasUpdated) != 0)
+        throw eRuntimeError("Why can't I broadcast?");
 }
 
 
@@ -9,89 +9,35 @@ namespace sync
 {
 
 
-const static u64 kMinSleepTime = 300;    // 0.3 milliseconds
-const static u64 kMaxSleeptime = 50000;  // 50.0 milliseconds
-
-
-class tTimerInitEndManager
+tTimer::tTimer(iTimerObserver* obs, u64 period)
+    : m_service(&tTimerService::shared()),
+      m_id(0),
+      m_obs(obs),
+      m_period(period),
+      m_running(false)
 {
-    public:
-
-        tTimerInitEndManager(iTimerObserver* obs)
-            : m_obs(obs)
-        {
-            m_obs->timerThreadInit();
-        }
-
-        ~tTimerInitEndManager()
-        {
-            m_obs->timerThreadEnd();
-        }
-
-    private:
-
-        iTimerObserver* m_obs;
-};
-
+    m_init();
+}
 
-class tTimerThread : public iRunnable, public bNonCopyable
+tTimer::tTimer(iTimerObserver* obs, u64 period, tTimerService& service)
+    : m_service(&service),
+      m_id(0),
+      m_obs(obs),
+      m_period(period),
+      m_running(false)
 {
-    public:
-
-        tTimerThread(tTimer* timer)
-            : m_timer(timer)
-        {
-        }
-
-        void run()
-        {
-            tTimerInitEndManager initEndManager(m_timer->m_obs);
-
-            while (m_timer->m_running)
-            {
-                u64 currtime = tTimer::usecTime();
-
-                // If it's time to call the observer...
-                if (currtime >= m_timer->m_nextCallTime)
-                {
-                    bool callAgain = m_timer->m_obs->timerAlert(m_timer->m_period);
-                    if (!callAgain)
-                        break;
-                    m_timer->m_nextCallTime += m_timer->m_period;
-                }
-
-                // Else, we need to wait a little longer...
-                else
-                {
-                    u64 waitTime = m_timer->m_nextCallTime - currtime;
-                    if (waitTime > kMinSleepTime)
-                    {
-                        waitTime = std::min(waitTime-kMinSleepTime, kMaxSleeptime);
-                        tThread::usleep(waitTime);
-                    }
-                }
-            }
-
-            m_timer->m_stopped = true;
-        }
-
-    private:
-
-        tTimer* m_timer;
-};
-
+    m_init();
+}
 
-tTimer::tTimer(iTimerObserver* obs, u64 period)
-    : m_obs(obs), m_period(period), m_running(true), m_stopped(false)
+void tTimer::m_init()
 {
-    if (obs == NULL)
+    if (m_obs == NULL)
         throw eNullPointer("The observer must not be NULL.");
-    if (period == 0)
+    if (m_period == 0)
         throw eInvalidArgument("The period must be positive (i.e. not zero).");
 
-    m_nextCallTime = m_period + tTimer::usecTime();
-
-    m_thread = new tThread(refc<iRunnable>(new tTimerThread(this)));
+    m_id = m_service->schedule(m_obs, m_period);
+    m_running = true;
 }
 
 iTimerObserver* tTimer::getObserver() const
@@ -109,14 +55,13 @@ void tTimer::stop()
     if (m_running)
     {
         m_running = false;
-        m_thread->join();
-        m_thread = NULL;
+        m_service->cancel(m_id);
     }
 }
 
 bool tTimer::isStopped() const
 {
-    return m_stopped;
+    return !m_running || m_service->isStopped(m_id);
 }
 
 tTimer::~tTimer()
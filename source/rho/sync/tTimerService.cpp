@@ -0,0 +1,606 @@
+#include <rho/sync/tTimerService.h>
+
+#include <cerrno>
+#include <iostream>
+
+#include <sys/time.h>
+#include <time.h>
+
+
+namespace rho
+{
+namespace sync
+{
+
+
+class tTimerServiceThread : public iRunnable, public bNonCopyable
+{
+    public:
+
+        tTimerServiceThread(tTimerService* service)
+            : m_service(service)
+        {
+        }
+
+        void run()
+        {
+            m_service->m_run();
+        }
+
+    private:
+
+        tTimerService* m_service;
+};
+
+
+tTimerService::tTimerService()
+{
+    m_init(1000);
+}
+
+tTimerService::tTimerService(u64 tickPeriod)
+{
+    m_init(tickPeriod);
+}
+
+void tTimerService::m_init(u64 tickPeriod)
+{
+    if (tickPeriod == 0)
+        throw eInvalidArgument("The tick period must be positive (i.e. not zero).");
+
+    m_tickPeriod = tickPeriod;
+    m_baseTime = 0;
+    m_baseTime = m_now();
+    m_curTick = 0;
+
+    for (u32 i = 0; i < kLevel0Size; i++)
+        m_level0[i].prev = m_level0[i].next = &m_level0[i];
+    for (u32 i = 0; i < kLevel0Size / 64; i++)
+        m_level0Bits[i] = 0;
+    for (u32 level = 0; level < kNumUpperLevels; level++)
+        for (u32 i = 0; i < kLevelSize; i++)
+            m_levels[level][i].prev = m_levels[level][i].next = &m_levels[level][i];
+    m_expiring.prev = m_expiring.next = &m_expiring;
+    m_ending.prev = m_ending.next = &m_ending;
+
+    m_numScheduled = 0;
+    m_running = NULL;
+    m_serviceThreadId = pthread_t();
+    m_stopping = false;
+    m_sleeping = false;
+    m_sleepUntilTick = 0;
+
+    if (pthread_mutex_init(&m_mutex, NULL) != 0)
+        throw eMutexCreationError();
+
+    pthread_condattr_t attr;
+    if (pthread_condattr_init(&attr) != 0)
+    {
+        pthread_mutex_destroy(&m_mutex);
+        throw eConditionCreationError();
+    }
+    #if __linux__
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    #endif
+    if (pthread_cond_init(&m_wakeService, &attr) != 0)
+    {
+        pthread_condattr_destroy(&attr);
+        pthread_mutex_destroy(&m_mutex);
+        throw eConditionCreationError();
+    }
+    pthread_condattr_destroy(&attr);
+    if (pthread_cond_init(&m_callbackDone, NULL) != 0)
+    {
+        pthread_mutex_destroy(&m_mutex);
+        pthread_cond_destroy(&m_wakeService);
+        throw eConditionCreationError();
+    }
+
+    m_thread = new tThread(refc<iRunnable>(new tTimerServiceThread(this)));
+}
+
+tTimerService::tTimerId tTimerService::schedule(iTimerObserver* obs, u64 period)
+{
+    if (obs == NULL)
+        throw eNullPointer("The observer must not be NULL.");
+    if (period == 0)
+        throw eInvalidArgument("The period must be positive (i.e. not zero).");
+
+    tAutoLock al(this);
+
+    u64 now = m_now();
+
+    // The wheel doesn't turn while it's empty, so catch it up first.
+    if (m_numScheduled == 0 && m_curTick < m_tickOf(now))
+        m_curTick = m_tickOf(now);
+
+    tRecord* rec = m_allocRecord();
+    rec->obs = obs;
+    rec->period = period;
+    rec->due = now + period;
+    rec->expiresTick = m_tickFor(rec->due);
+    rec->initCalled = false;
+    rec->cancelled = false;
+    m_insert(rec);
+    m_numScheduled++;
+
+    if (m_sleeping && rec->expiresTick < m_sleepUntilTick)
+    {
+        if (pthread_cond_signal(&m_wakeService) != 0)
+            throw eRuntimeError("Why can't I signal?");
+    }
+
+    return (((tTimerId)rec->generation) << 32) | rec->index;
+}
+
+bool tTimerService::cancel(tTimerId id)
+{
+    tAutoLock al(this);
+
+    tRecord* rec = m_lookup(id);
+    if (rec == NULL)
+        return false;
+
+    rec->cancelled = true;
+
+    if (rec != m_running)
+    {
+        m_unlink(rec);
+        if (!rec->initCalled)
+        {
+            m_freeRecord(rec);
+            return true;
+        }
+
+        // The observer has had timerThreadInit(), so it gets
+        // timerThreadEnd() too, and that belongs on the service thread.
+        rec->prev = m_ending.prev;
+        rec->next = &m_ending;
+        m_ending.prev->next = rec;
+        m_ending.prev = rec;
+        rec->list = &m_ending;
+        if (pthread_cond_signal(&m_wakeService) != 0)
+            throw eRuntimeError("Why can't I signal?");
+    }
+
+    // Else the observer is being called right now, and the service
+    // thread will end the timer when the observer returns.
+
+    if (pthread_equal(m_serviceThreadId, pthread_self()))
+        return true;
+    u32 generation = rec->generation;
+    while (rec->generation == generation)
+    {
+        if (pthread_cond_wait(&m_callbackDone, &m_mutex) != 0)
+            throw eRuntimeError("Why can't I wait on the condition?");
+    }
+    return true;
+}
+
+bool tTimerService::isStopped(tTimerId id) const
+{
+    tAutoLock al(this);
+
+    u32 index = (u32) (id & 0xFFFFFFFF);
+    u32 generation = (u32) (id >> 32);
+    if (index >= m_records.size())
+        return true;
+    tRecord* rec = m_records[index];
+    return rec->generation != generation || rec->obs == NULL;
+}
+
+u64 tTimerService::getTickPeriod() const
+{
+    return m_tickPeriod;
+}
+
+u32 tTimerService::size() const
+{
+    tAutoLock al(this);
+    return m_numScheduled;
+}
+
+tTimerService::~tTimerService()
+{
+    {
+        tAutoLock al(this);
+        m_stopping = true;
+        pthread_cond_signal(&m_wakeService);   // (only fails on a bad cond; can't throw here)
+    }
+
+    m_thread->join();
+    m_thread = NULL;
+
+    for (size_t i = 0; i < m_records.size(); i++)
+        delete m_records[i];
+    m_records.clear();
+
+    pthread_mutex_destroy(&m_mutex);
+    pthread_cond_destroy(&m_wakeService);
+    pthread_cond_destroy(&m_callbackDone);
+}
+
+static tTimerService* gSharedTimerService = NULL;
+static pthread_once_t gSharedTimerServiceOnce = PTHREAD_ONCE_INIT;
+
+static void s_makeSharedTimerService()
+{
+    gSharedTimerService = new tTimerService;
+}
+
+tTimerService& tTimerService::shared()
+{
+    pthread_once(&gSharedTimerServiceOnce, s_makeSharedTimerService);
+    return *gSharedTimerService;
+}
+
+void tTimerService::m_run()
+{
+    tAutoLock al(this);
+
+    m_serviceThreadId = pthread_self();
+
+    while (!m_stopping)
+    {
+        u64 nowTick = m_tickOf(m_now());
+
+        if (m_numScheduled == 0 && m_curTick < nowTick)
+            m_curTick = nowTick;
+
+        m_endCancelled();
+
+        while (!m_stopping && m_curTick <= nowTick)
+        {
+            m_advance();
+            m_fireExpiring();
+        }
+
+        if (m_stopping)
+            break;
+
+        u64 wakeTick;
+        m_sleeping = true;
+        if (m_nextWakeTick(wakeTick))
+        {
+            m_sleepUntilTick = wakeTick;
+            u64 wakeTime = m_baseTime + wakeTick * m_tickPeriod;
+            struct timespec ts;
+            ts.tv_sec = (time_t) (wakeTime / 1000000);
+            ts.tv_nsec = (long) ((wakeTime % 1000000) * 1000);
+            int ret = pthread_cond_timedwait(&m_wakeService, &m_mutex, &ts);
+            if (ret != 0 && ret != ETIMEDOUT)
+                throw eRuntimeError("Why can't I wait on the condition?");
+        }
+        else
+        {
+            m_sleepUntilTick = (u64)-1;     // <-- i.e. until something is scheduled
+            if (pthread_cond_wait(&m_wakeService, &m_mutex) != 0)
+                throw eRuntimeError("Why can't I wait on the condition?");
+        }
+        m_sleeping = false;
+    }
+}
+
+tTimerService::tRecord* tTimerService::m_lookup(tTimerId id) const
+{
+    u32 index = (u32) (id & 0xFFFFFFFF);
+    u32 generation = (u32) (id >> 32);
+    if (index >= m_records.size())
+        return NULL;
+    tRecord* rec = m_records[index];
+    if (rec->generation != generation || rec->obs == NULL || rec->cancelled)
+        return NULL;
+    return rec;
+}
+
+tTimerService::tRecord* tTimerService::m_allocRecord()
+{
+    if (!m_freeRecords.empty())
+    {
+        tRecord* rec = m_records[m_freeRecords.back()];
+        m_freeRecords.pop_back();
+        return rec;
+    }
+
+    if (m_records.size() >= 0xFFFFFFFF)
+        throw eResourceAcquisitionError("Too many timers!");
+    tRecord* rec = new tRecord;
+    rec->prev = rec->next = NULL;
+    rec->list = NULL;
+    rec->obs = NULL;
+    rec->index = (u32) m_records.size();
+    rec->generation = 1;
+    rec->initCalled = false;
+    rec->cancelled = false;
+    m_records.push_back(rec);
+    return rec;
+}
+
+void tTimerService::m_freeRecord(tRecord* rec)
+{
+    rec->generation++;
+    rec->obs = NULL;
+    rec->cancelled = false;
+    m_freeRecords.push_back(rec->index);
+    m_numScheduled--;
+}
+
+u64 tTimerService::m_now() const
+{
+    u64 now;
+    #if __linux__
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = ((u64)ts.tv_sec) * 1000000 + ((u64)ts.tv_nsec) / 1000;
+    #else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    now = ((u64)tv.tv_sec) * 1000000 + ((u64)tv.tv_usec);
+    #endif
+    return (now > m_baseTime) ? now : m_baseTime;   // <-- gettimeofday() can go backwards
+}
+
+u64 tTimerService::m_tickOf(u64 time) const
+{
+    // The tick which 'time' falls in.
+    return (time - m_baseTime) / m_tickPeriod;
+}
+
+u64 tTimerService::m_tickFor(u64 due) const
+{
+    // The first tick which starts at or after 'due'.
+    return (due - m_baseTime + m_tickPeriod - 1) / m_tickPeriod;
+}
+
+void tTimerService::m_insert(tRecord* rec)
+{
+    u64 expires = rec->expiresTick;
+    if (expires < m_curTick)
+        expires = m_curTick;
+    u64 delta = expires - m_curTick;
+
+    tLink* list = NULL;
+    if (delta < kLevel0Size)
+    {
+        u32 index = (u32) (expires & (kLevel0Size-1));
+        m_level0Bits[index / 64] |= (((u64)1) << (index % 64));
+        list = &m_level0[index];
+    }
+    else
+    {
+        u32 level = 0;
+        while (level < kNumUpperLevels &&
+               delta >= (((u64)1) << (kLevel0Bits + (level+1)*kLevelBits)))
+        {
+            level++;
+        }
+        if (level == kNumUpperLevels)
+        {
+            // Too far out for the wheel. Park it in the farthest bucket;
+            // it will be re-inserted when that bucket comes around.
+            level = kNumUpperLevels - 1;
+            expires = m_curTick + (((u64)1) << (kLevel0Bits + kNumUpperLevels*kLevelBits)) - 1;
+        }
+        u32 shift = kLevel0Bits + level*kLevelBits;
+        u32 index = (u32) ((expires >> shift) & (kLevelSize-1));
+        list = &m_levels[level][index];
+    }
+
+    rec->prev = list->prev;
+    rec->next = list;
+    list->prev->next = rec;
+    list->prev = rec;
+    rec->list = list;
+}
+
+void tTimerService::m_unlink(tRecord* rec)
+{
+    rec->prev->next = rec->next;
+    rec->next->prev = rec->prev;
+    rec->prev = rec->next = NULL;
+
+    tLink* list = rec->list;
+    rec->list = NULL;
+    if (list->next == list && list >= m_level0 && list < m_level0 + kLevel0Size)
+    {
+        u32 index = (u32) (list - m_level0);
+        m_level0Bits[index / 64] &= ~(((u64)1) << (index % 64));
+    }
+}
+
+void tTimerService::m_cascade(u32 level)
+{
+    u32 shift = kLevel0Bits + level*kLevelBits;
+    u32 index = (u32) ((m_curTick >> shift) & (kLevelSize-1));
+    tLink* list = &m_levels[level][index];
+
+    // Detach the whole bucket first; some of its timers may land
+    // right back in it.
+    tLink head;
+    if (list->next == list)
+        return;
+    head.next = list->next;
+    head.prev = list->prev;
+    head.next->prev = &head;
+    head.prev->next = &head;
+    list->prev = list->next = list;
+
+    while (head.next != &head)
+    {
+        tRecord* rec = static_cast<tRecord*>(head.next);
+        head.next = rec->next;
+        rec->next->prev = &head;
+        m_insert(rec);
+    }
+}
+
+void tTimerService::m_advance()
+{
+    u32 index = (u32) (m_curTick & (kLevel0Size-1));
+
+    if (index == 0)
+    {
+        for (u32 level = 0; level < kNumUpperLevels; level++)
+        {
+            m_cascade(level);
+            u32 shift = kLevel0Bits + level*kLevelBits;
+            if (((m_curTick >> shift) & (kLevelSize-1)) != 0)
+                break;
+        }
+    }
+
+    tLink* list = &m_level0[index];
+    while (list->next != list)
+    {
+        tRecord* rec = static_cast<tRecord*>(list->next);
+        m_unlink(rec);
+        rec->prev = m_expiring.prev;
+        rec->next = &m_expiring;
+        m_expiring.prev->next = rec;
+        m_expiring.prev = rec;
+        rec->list = &m_expiring;
+    }
+
+    m_curTick++;
+}
+
+void tTimerService::m_fireExpiring()
+{
+    // m_curTick has already moved past the tick being processed, so
+    // periodic timers that come due again straight away go into the
+    // next tick's bucket rather than back into this list.
+    while (!m_stopping && m_expiring.next != &m_expiring)
+    {
+        tRecord* rec = static_cast<tRecord*>(m_expiring.next);
+        m_unlink(rec);
+
+        if (rec->expiresTick >= m_curTick)
+        {
+            m_insert(rec);          // <-- was parked (too far out), not due yet
+            continue;
+        }
+
+        m_running = rec;
+        iTimerObserver* obs = rec->obs;
+        u64 period = rec->period;
+        bool firstCall = !rec->initCalled;
+        rec->initCalled = true;
+        bool callAgain = false;
+
+        {
+            tAutoUnlock au(this);
+            try
+            {
+                if (firstCall)
+                    obs->timerThreadInit();
+                callAgain = obs->timerAlert(period);
+            }
+            catch (std::exception& e)
+            {
+                std::cerr << "Timer observer threw an exception: "
+                          << e.what() << std::endl;
+            }
+            catch (...)
+            {
+                std::cerr << "Timer observer threw an unknown exception type."
+                          << std::endl;
+            }
+        }
+
+        if (rec->cancelled || !callAgain)
+        {
+            m_end(rec);
+        }
+        else
+        {
+            m_running = NULL;
+            rec->due += period;
+            rec->expiresTick = m_tickFor(rec->due);
+            m_insert(rec);
+        }
+
+        m_endCancelled();
+    }
+}
+
+void tTimerService::m_end(tRecord* rec)
+{
+    // The timer stays m_running until its observer has been told, so
+    // that cancel() waits for that too.
+    m_running = rec;
+    rec->cancelled = true;
+
+    {
+        tAutoUnlock au(this);
+        try
+        {
+            rec->obs->timerThreadEnd();
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Timer observer threw an exception: "
+                      << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "Timer observer threw an unknown exception type."
+                      << std::endl;
+        }
+    }
+
+    m_running = NULL;
+    m_freeRecord(rec);
+    if (pthread_cond_broadcast(&m_callbackDone) != 0)
+        throw eRuntimeError("Why can't I broadcast?");
+}
+
+void tTimerService::m_endCancelled()
+{
+    while (!m_stopping && m_ending.next != &m_ending)
+    {
+        tRecord* rec = static_cast<tRecord*>(m_ending.next);
+        m_unlink(rec);
+        m_end(rec);
+    }
+}
+
+bool tTimerService::m_nextWakeTick(u64& tick) const
+{
+    if (m_numScheduled == 0)
+        return false;
+
+    // The first non-empty bucket in what's left of this turn of the
+    // bottom level. If there isn't one, wake up at the end of the turn
+    // to cascade the next level down.
+    u32 start = (u32) (m_curTick & (kLevel0Size-1));
+    u32 i = start;
+    while (i < kLevel0Size)
+    {
+        u64 word = m_level0Bits[i / 64] >> (i % 64);
+        if (word)
+        {
+            tick = m_curTick + (i - start) + (u32)__builtin_ctzll(word);
+            return true;
+        }
+        i = (i / 64 + 1) * 64;
+    }
+
+    tick = (m_curTick | (kLevel0Size-1)) + 1;
+    return true;
+}
+
+void tTimerService::m_lock() const
+{
+    if (pthread_mutex_lock(&m_mutex) != 0)
+        throw eRuntimeError("Cannot lock timer service mutex!");
+}
+
+void tTimerService::m_unlock() const
+{
+    if (pthread_mutex_unlock(&m_mutex) != 0)
+        throw eRuntimeError("Cannot unlock timer service mutex!");
+}
+
+
+}  // namespace sync
+}  // namespace rho
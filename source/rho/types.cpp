@@ -94,4 +94,45 @@ int getMachineBitness()
 }
 
 
+static
+nSimdLevel s_detectSimdLevel()
+{
+#if __i386__ || __x86_64__
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return kSimdAVX2;
+    if (__builtin_cpu_supports("ssse3"))
+        return kSimdSSSE3;
+    if (__builtin_cpu_supports("sse2"))
+        return kSimdSSE2;
+#endif
+    return kSimdNone;
+}
+
+
+nSimdLevel getSimdLevel()
+{
+    static nSimdLevel sLevel = s_detectSimdLevel();
+    return sLevel;
+}
+
+
+std::string simdLevelEnumToString(nSimdLevel level)
+{
+    switch (level)
+    {
+        case kSimdNone:
+            return "None";
+        case kSimdSSE2:
+            return "SSE2";
+        case kSimdSSSE3:
+            return "SSSE3";
+        case kSimdAVX2:
+            return "AVX2";
+        default:
+            return "Unknown";
+    }
+}
+
+
 }    // namespace rho
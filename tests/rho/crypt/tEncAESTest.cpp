@@ -1,7 +1,11 @@
 #include <rho/crypt/tEncAES.h>
+#include <rho/crypt/tDecAES.h>
+#include <rho/eRho.h>
 #include <rho/tCrashReporter.h>
 #include <rho/tTest.h>
 
+#include <algorithm>
+#include <cstdlib>
 #include <string>
 #include <vector>
 
@@ -138,6 +142,161 @@ void test_cbc(const tTest& t, string key,
 }
 
 
+void test_ctr(const tTest& t, string key,
+                              string counter,
+                              string pt,
+                              string ct)
+{
+    for (int impl = 0; impl < 2; impl++)
+    {
+        bool useFastASM = (impl == 0);     // <-- fast ASM impl, then the fallback impl
+        if (useFastASM && !gCanTestFastASM)
+            continue;
+
+        vector<u8> ptbuf = hexStringToVector(pt);
+        vector<u8> ctbuf = hexStringToVector(ct);
+        t.assert(ptbuf.size() == ctbuf.size());
+        t.assert(ptbuf.size() % 16 == 0);
+        u32 numblocks = (u32)(ptbuf.size() / 16);
+
+        vector<u8> keybuf = hexStringToVector(key);
+        crypt::tEncAES aes(crypt::kOpModeCTR, &keybuf[0], getKeyLengthForKey(keybuf), useFastASM);
+
+        // All at once.
+        vector<u8> ctrbuf = hexStringToVector(counter);
+        t.assert(ctrbuf.size() == 16);
+        vector<u8> outbuf(ptbuf.size());
+        aes.enc(&ptbuf[0], &outbuf[0], numblocks, &ctrbuf[0]);
+        t.assert(outbuf == ctbuf);
+
+        // The counter should have moved past the blocks used.
+        vector<u8> expectedCtr = hexStringToVector(counter);
+        for (u32 i = 0; i < numblocks; i++)
+            for (int j = 15; j >= 12 && ++expectedCtr[j] == 0; j--) { }
+        t.assert(ctrbuf == expectedCtr);
+
+        // A block at a time, carrying the counter along.
+        ctrbuf = hexStringToVector(counter);
+        for (u32 i = 0; i < numblocks; i++)
+            aes.enc(&ptbuf[i*16], &outbuf[i*16], 1, &ctrbuf[0]);
+        t.assert(outbuf == ctbuf);
+    }
+}
+
+
+void test_gcm(const tTest& t, string key,
+                              string nonce,
+                              string aad,
+                              string pt,
+                              string ct,
+                              string tag)
+{
+    for (int impl = 0; impl < 2; impl++)
+    {
+        bool useFastASM = (impl == 0);     // <-- fast ASM impl, then the fallback impl
+        if (useFastASM && !gCanTestFastASM)
+            continue;
+
+        vector<u8> ptbuf = hexStringToVector(pt);
+        vector<u8> ctbuf = hexStringToVector(ct);
+        vector<u8> aadbuf = hexStringToVector(aad);
+        vector<u8> noncebuf = hexStringToVector(nonce);
+        vector<u8> tagbuf = hexStringToVector(tag);
+        t.assert(ptbuf.size() == ctbuf.size());
+        t.assert(noncebuf.size() == 12);
+        t.assert(tagbuf.size() == 16);
+
+        vector<u8> keybuf = hexStringToVector(key);
+        crypt::tEncAES aes(crypt::kOpModeGCM, &keybuf[0], getKeyLengthForKey(keybuf), useFastASM);
+
+        vector<u8> outbuf(ptbuf.size() + 1);   // <-- +1 so that &outbuf[0] is fine when pt is empty
+        vector<u8> outtag(16);
+        aes.encGCM(ptbuf.size() ? &ptbuf[0] : NULL, &outbuf[0], (u32)ptbuf.size(), &noncebuf[0],
+                   aadbuf.size() ? &aadbuf[0] : NULL, (u32)aadbuf.size(), &outtag[0]);
+        outbuf.pop_back();
+        t.assert(outbuf == ctbuf);
+        t.assert(outtag == tagbuf);
+
+        // GCM mode has no use for enc().
+        u8 block[16] = { 0 };
+        try { aes.enc(block, block, 1); t.fail(); }
+        catch (eLogicError& e) { }
+    }
+}
+
+
+/*
+ * The fast ASM impl encrypts eight blocks at a time and hashes four at a
+ * time; make sure it agrees with the fallback impl at every length, and
+ * when the 32-bit counter wraps.
+ */
+void fastAndFallbackAgreeTest(const tTest& t)
+{
+    if (!gCanTestFastASM)
+        return;
+
+    crypt::nKeyLengthAES keylen = (crypt::nKeyLengthAES)(rand() % 3);
+    vector<u8> key(16 + 8*keylen);
+    for (size_t i = 0; i < key.size(); i++)
+        key[i] = (u8)(rand() % 256);
+
+    u32 len = (u32)(rand() % 10000);
+    vector<u8> pt(len + 16);
+    for (size_t i = 0; i < pt.size(); i++)
+        pt[i] = (u8)(rand() % 256);
+    vector<u8> aad(rand() % 50 + 1);
+    for (size_t i = 0; i < aad.size(); i++)
+        aad[i] = (u8)(rand() % 256);
+
+    // CTR mode:
+    {
+        u8 ctr1[16], ctr2[16];
+        for (int i = 0; i < 16; i++)
+            ctr1[i] = ctr2[i] = (u8)(rand() % 256);
+        for (int i = 12; i < 15; i++)
+            ctr1[i] = ctr2[i] = 0xFF;     // <-- wraps within 256 blocks
+        crypt::tEncAES fast(crypt::kOpModeCTR, &key[0], keylen, true);
+        crypt::tEncAES slow(crypt::kOpModeCTR, &key[0], keylen, false);
+        vector<u8> ct1(pt.size()), ct2(pt.size());
+        u32 numblocks = (u32)(pt.size() / 16);
+        fast.enc(&pt[0], &ct1[0], numblocks, ctr1);
+        slow.enc(&pt[0], &ct2[0], numblocks, ctr2);
+        t.assert(ct1 == ct2);
+        for (int i = 0; i < 16; i++)
+            t.iseq(ctr1[i], ctr2[i]);
+
+        // And decrypting gives the plain text back (in place).
+        crypt::tDecAES dec(crypt::kOpModeCTR, &key[0], keylen, (rand() % 2) == 0);
+        for (int i = 12; i < 16; i++)
+            ctr1[i] = 0xFF;
+        for (int i = 0; i < 12; i++)
+            ctr1[i] = ctr2[i];
+        u8 ctr3[16];
+        for (int i = 0; i < 16; i++)
+            ctr3[i] = ctr1[i];
+        fast.enc(&pt[0], &ct1[0], numblocks, ctr1);
+        dec.dec(&ct1[0], &ct1[0], numblocks, ctr3);
+        t.assert(std::equal(pt.begin(), pt.begin() + numblocks*16, ct1.begin()));
+    }
+
+    // GCM mode:
+    {
+        u8 nonce[12];
+        for (int i = 0; i < 12; i++)
+            nonce[i] = (u8)(rand() % 256);
+        crypt::tEncAES fast(crypt::kOpModeGCM, &key[0], keylen, true);
+        crypt::tEncAES slow(crypt::kOpModeGCM, &key[0], keylen, false);
+        vector<u8> ct1(len + 1), ct2(len + 1);
+        u8 tag1[16], tag2[16];
+        fast.encGCM(&pt[0], &ct1[0], len, nonce, &aad[0], (u32)aad.size(), tag1);
+        slow.encGCM(&pt[0], &ct2[0], len, nonce, &aad[0], (u32)aad.size(), tag2);
+        t.assert(ct1 == ct2);
+        for (int i = 0; i < 16; i++)
+            t.iseq(tag1[i], tag2[i]);
+    }
+}
+
+
 void test128(const tTest& t)
 {
     test_ecb(t, "2b7e151628aed2a6abf7158809cf4f3c", "6bc1bee22e409f96e93d7e117393172a", "3ad77bb40d7a3660a89ecaf32466ef97");
@@ -149,6 +308,12 @@ void test128(const tTest& t)
     test_cbc(t, "2b7e151628aed2a6abf7158809cf4f3c", "7649ABAC8119B246CEE98E9B12E9197D", "ae2d8a571e03ac9c9eb76fac45af8e51", "5086cb9b507219ee95db113a917678b2");
     test_cbc(t, "2b7e151628aed2a6abf7158809cf4f3c", "5086CB9B507219EE95DB113A917678B2", "30c81c46a35ce411e5fbc1191a0a52ef", "73bed6b8e3c1743b7116e69e22229516");
     test_cbc(t, "2b7e151628aed2a6abf7158809cf4f3c", "73BED6B8E3C1743B7116E69E22229516", "f69f2445df4f9b17ad2b417be66c3710", "3ff1caa1681fac09120eca307586e1a7");
+    test_ctr(t, "2b7e151628aed2a6abf7158809cf4f3c", "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710", "874d6191b620e3261bef6864990db6ce9806f66b7970fdff8617187bb9fffdff5ae4df3edbd5d35e5b4f09020db03eab1e031dda2fbe03d1792170a0f3009cee");
+
+    test_gcm(t, "00000000000000000000000000000000", "000000000000000000000000", "", "", "", "58e2fccefa7e3061367f1d57a4e7455a");
+    test_gcm(t, "00000000000000000000000000000000", "000000000000000000000000", "", "00000000000000000000000000000000", "0388dace60b6a392f328c2b971b2fe78", "ab6e47d42cec13bdf53a67b21257bddf");
+    test_gcm(t, "feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "", "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255", "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091473f5985", "4d5c2af327cd64a62cf35abd2ba6fab4");
+    test_gcm(t, "feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "feedfacedeadbeeffeedfacedeadbeefabaddad2", "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39", "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091", "5bc94fbc3221a5db94fae95ae7121a47");
 }
 
 
@@ -163,6 +328,10 @@ void test192(const tTest& t)
     test_cbc(t, "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b", "4F021DB243BC633D7178183A9FA071E8", "ae2d8a571e03ac9c9eb76fac45af8e51", "b4d9ada9ad7dedf4e5e738763f69145a");
     test_cbc(t, "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b", "B4D9ADA9AD7DEDF4E5E738763F69145A", "30c81c46a35ce411e5fbc1191a0a52ef", "571b242012fb7ae07fa9baac3df102e0");
     test_cbc(t, "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b", "571B242012FB7AE07FA9BAAC3DF102E0", "f69f2445df4f9b17ad2b417be66c3710", "08b0e27988598881d920a9e64f5615cd");
+    test_ctr(t, "8e73b0f7da0e6452c810f32b809079e562f8ead2522c6b7b", "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710", "1abc932417521ca24f2b0459fe7e6e0b090339ec0aa6faefd5ccc2c6f4ce8e941e36b26bd1ebc670d1bd1d665620abf74f78a7f6d29809585a97daec58c6b050");
+
+    test_gcm(t, "feffe9928665731c6d6a8f9467308308feffe9928665731c", "cafebabefacedbaddecaf888", "", "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255", "3980ca0b3c00e841eb06fac4872a2757859e1ceaa6efd984628593b40ca1e19c7d773d00c144c525ac619d18c84a3f4718e2448b2fe324d9ccda2710acade256", "9924a7c8587336bfb118024db8674a14");
+    test_gcm(t, "feffe9928665731c6d6a8f9467308308feffe9928665731c", "cafebabefacedbaddecaf888", "feedfacedeadbeeffeedfacedeadbeefabaddad2", "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39", "3980ca0b3c00e841eb06fac4872a2757859e1ceaa6efd984628593b40ca1e19c7d773d00c144c525ac619d18c84a3f4718e2448b2fe324d9ccda2710", "2519498e80f1478f37ba55bd6d27618c");
 }
 
 
@@ -177,6 +346,10 @@ void test256(const tTest& t)
     test_cbc(t, "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "F58C4C04D6E5F1BA779EABFB5F7BFBD6", "ae2d8a571e03ac9c9eb76fac45af8e51", "9cfc4e967edb808d679f777bc6702c7d");
     test_cbc(t, "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "9CFC4E967EDB808D679F777BC6702C7D", "30c81c46a35ce411e5fbc1191a0a52ef", "39f23369a9d9bacfa530e26304231461");
     test_cbc(t, "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "39F23369A9D9BACFA530E26304231461", "f69f2445df4f9b17ad2b417be66c3710", "b2eb05e2c39be9fcda6c19078c6a9d1b");
+    test_ctr(t, "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4", "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff", "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e5130c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710", "601ec313775789a5b7a7f504bbf3d228f443e3ca4d62b59aca84e990cacaf5c52b0930daa23de94ce87017ba2d84988ddfc9c58db67aada613c2dd08457941a6");
+
+    test_gcm(t, "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "", "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255", "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662898015ad", "b094dac5d93471bdec1a502270e3cc6c");
+    test_gcm(t, "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "feedfacedeadbeeffeedfacedeadbeefabaddad2", "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39", "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662", "76fc6ece0f4e1768cddf8853bb2d551b");
 }
 
 
@@ -187,6 +360,8 @@ int main()
 
     // Test vectors are from:
     // http://www.inconteam.com/software-development/41-encryption/55-aes-test-vectors
+    // (and the CTR ones from NIST SP 800-38A, the GCM ones from McGrew and
+    // Viega's "The Galois/Counter Mode of Operation (GCM)")
 
     if (!crypt::tEncAES::canRunFastASM())
     {
@@ -197,6 +372,7 @@ int main()
     tTest("tEncAES 128bit test", test128, kTestIters);
     tTest("tEncAES 192bit test", test192, kTestIters);
     tTest("tEncAES 256bit test", test256, kTestIters);
+    tTest("tEncAES fast/fallback agree test", fastAndFallbackAgreeTest, 200);
 
     return 0;
 }
@@ -6,9 +6,16 @@
 #include <rho/crypt/tSHA384.h>
 #include <rho/crypt/tSHA512.h>
 #include <rho/crypt/tWhirlpool.h>
+#include <rho/crypt/tXXHash64.h>
+#include <rho/crypt/tCRC32C.h>
+#include <rho/crypt/tAdler32.h>
+#include <rho/crypt/tHmac.h>
+#include <rho/sync/tThreadPool.h>
 #include <rho/tCrashReporter.h>
 #include <rho/tTest.h>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -2593,6 +2600,415 @@ void testPBKDF2_HMAC_WHIRLPOOL(const tTest& t)
 }
 
 
+
+/*
+ * HMAC straight from RFC 2104, to check tHmac against.
+ */
+template <class Hasher>
+vector<u8> refHmac(vector<u8> key, const vector<u8>& message)
+{
+    if (key.size() > Hasher::kBlockSize)
+    {
+        Hasher h;
+        h.write(&key[0], (i32)key.size());
+        key = h.getHash();
+    }
+    key.resize(Hasher::kBlockSize, 0x00);
+
+    Hasher inner;
+    for (size_t i = 0; i < key.size(); i++)
+    {
+        u8 b = (u8)(key[i] ^ 0x36);
+        inner.write(&b, 1);
+    }
+    if (message.size() > 0)
+        inner.write(&message[0], (i32)message.size());
+    vector<u8> innerHash = inner.getHash();
+
+    Hasher outer;
+    for (size_t i = 0; i < key.size(); i++)
+    {
+        u8 b = (u8)(key[i] ^ 0x5c);
+        outer.write(&b, 1);
+    }
+    outer.write(&innerHash[0], (i32)innerHash.size());
+    return outer.getHash();
+}
+
+
+vector<u8> randomBytes(size_t maxlen)
+{
+    vector<u8> v(rand() % (maxlen+1));
+    for (size_t i = 0; i < v.size(); i++)
+        v[i] = (u8)(rand() % 256);
+    return v;
+}
+
+
+template <class Hasher>
+void hmacContextTest(const tTest& t)
+{
+    // Keys shorter than, as long as, and longer than a block.
+    vector<u8> key = randomBytes(Hasher::kBlockSize * 2);
+    crypt::tHmac<Hasher> hmac(key);
+
+    // The same context, reused for several messages.
+    for (int m = 0; m < 3; m++)
+    {
+        vector<u8> message = randomBytes(300);
+        size_t pos = 0;
+        while (pos < message.size())
+        {
+            size_t dist = (rand() % (message.size()-pos)) + 1;
+            hmac.write(&message[pos], (i32)dist);
+            pos += dist;
+        }
+
+        vector<u8> expected = refHmac<Hasher>(key, message);
+        t.assert(hmac.getHash() == expected);
+        t.assert(hmac.getHashString() == crypt::hashToString(expected));
+
+        u8 raw[Hasher::kHashSize];
+        hmac.getHash(raw);
+        t.assert(memcmp(raw, &expected[0], Hasher::kHashSize) == 0);
+
+        hmac.reset();
+    }
+}
+
+
+void testHmacContext(const tTest& t)
+{
+    hmacContextTest<crypt::tMD5>(t);
+    hmacContextTest<crypt::tSHA1>(t);
+    hmacContextTest<crypt::tSHA224>(t);
+    hmacContextTest<crypt::tSHA256>(t);
+    hmacContextTest<crypt::tSHA384>(t);
+    hmacContextTest<crypt::tSHA512>(t);
+    hmacContextTest<crypt::tWhirlpool>(t);
+}
+
+
+/*
+ * A prf pbkdf2() doesn't recognize, so it takes the slow path.
+ */
+vector<u8> opaque_hmac_sha256(const vector<u8>& key, const vector<u8>& message)
+{
+    return refHmac<crypt::tSHA256>(key, message);
+}
+
+
+/*
+ * A broken prf: its hashes are 20 bytes, except for the first iteration
+ * of the second block's (whose message ends in the block index, 2).
+ */
+vector<u8> uneven_prf(const vector<u8>& key, const vector<u8>& message)
+{
+    if (message.size() == 4 && message[3] == 2)
+        return vector<u8>(10, 1);
+    return vector<u8>(20, 1);
+}
+
+
+/*
+ * Another: its hashes are empty.
+ */
+vector<u8> empty_prf(const vector<u8>& key, const vector<u8>& message)
+{
+    return vector<u8>();
+}
+
+
+void testPBKDF2_parallel(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    vector<u8> pass = randomBytes(100);
+    vector<u8> salt = randomBytes(40);
+    u32 iters = (rand() % 20) + 1;
+    u32 dklen = (rand() % 200) + 1;
+
+    vector<u8> expected = crypt::pbkdf2(opaque_hmac_sha256, pass, salt, iters, dklen);
+    t.iseq(expected.size(), (size_t)dklen);
+    t.assert(crypt::pbkdf2(crypt::hmac_sha256, pass, salt, iters, dklen) == expected);
+    t.assert(crypt::pbkdf2(crypt::hmac_sha256, pass, salt, iters, dklen, pool) == expected);
+    t.assert(crypt::pbkdf2(opaque_hmac_sha256, pass, salt, iters, dklen, pool) == expected);
+
+    vector<u8> whirl = crypt::pbkdf2(crypt::hmac_whirlpool, pass, salt, iters, dklen);
+    t.assert(crypt::pbkdf2(crypt::hmac_whirlpool, pass, salt, iters, dklen, pool) == whirl);
+
+    // A bad prf throws rather than leaving junk in the output, even when
+    // the bad block is done on another of the pool's threads.
+    vector<u8> noSalt;
+    t.iseq(crypt::pbkdf2(uneven_prf, pass, noSalt, 1, 20).size(), (size_t)20);
+    try { crypt::pbkdf2(uneven_prf, pass, noSalt, 1, 100); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { crypt::pbkdf2(uneven_prf, pass, noSalt, 1, 100, pool); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { crypt::pbkdf2(empty_prf, pass, salt, iters, dklen, pool); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    try { crypt::pbkdf2(NULL, pass, salt, iters, dklen, pool); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { crypt::pbkdf2(crypt::hmac_sha1, pass, salt, 0, dklen, pool); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { crypt::pbkdf2(crypt::hmac_sha1, pass, salt, iters, 0, pool); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+template <class Hasher>
+void shaBatchTest(const tTest& t,
+                  void (*batch)(const u8* const[], const u32[], u32, u8*, crypt::nShaImpl))
+{
+    // Lots of lengths near the padding boundaries, and a few long ones.
+    u32 count = rand() % 40;
+    vector< vector<u8> > messages(count);
+    vector<const u8*> ptrs(count);
+    vector<u32> lengths(count);
+    vector<u8> expected(count * Hasher::kHashSize);
+    for (u32 m = 0; m < count; m++)
+    {
+        switch (rand() % 3)
+        {
+            case 0: messages[m] = randomBytes(130); break;
+            case 1: messages[m] = randomBytes(5000); break;
+            default: messages[m].resize(64 * (rand() % 4) + 55 + rand() % 10);
+        }
+        ptrs[m] = messages[m].size() > 0 ? &messages[m][0] : NULL;
+        lengths[m] = (u32)messages[m].size();
+
+        Hasher h;
+        if (lengths[m] > 0)
+            h.write(ptrs[m], (i32)lengths[m]);
+        h.getHash(&expected[m * Hasher::kHashSize]);
+    }
+
+    const crypt::nShaImpl kImpls[] = { crypt::kShaImplPortable,
+                                       crypt::kShaImplSHANI,
+                                       crypt::kShaImplAVX2x8 };
+    for (size_t i = 0; i < sizeof(kImpls) / sizeof(kImpls[0]); i++)
+    {
+        if (!crypt::canRunShaImpl(kImpls[i]))
+            continue;
+        vector<u8> hashes(count * Hasher::kHashSize + 1, 0xAB);
+        batch(count > 0 ? &ptrs[0] : NULL, count > 0 ? &lengths[0] : NULL, count,
+              &hashes[0], kImpls[i]);
+        t.assert(std::equal(expected.begin(), expected.end(), hashes.begin()));
+        t.iseq(hashes.back(), (u8)0xAB);
+    }
+}
+
+
+void testShaBatch(const tTest& t)
+{
+    shaBatchTest<crypt::tSHA1>(t, crypt::sha1_batch);
+    shaBatchTest<crypt::tSHA256>(t, crypt::sha256_batch);
+
+    // The default impl.
+    string msg = "abc";
+    const u8* ptr = (const u8*)msg.c_str();
+    u32 len = (u32)msg.length();
+    u8 hash[32];
+    crypt::sha256_batch(&ptr, &len, 1, hash);
+    t.assert(crypt::hashToString(vector<u8>(hash, hash+32)) ==
+             "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    crypt::sha1_batch(&ptr, &len, 1, hash);
+    t.assert(crypt::hashToString(vector<u8>(hash, hash+20)) ==
+             "a9993e364706816aba3e25717850c26c9cd0d89d");
+
+    try { crypt::sha1_batch(&ptr, &len, 1, NULL); t.fail(); }
+    catch (eNullPointer& e) { }
+    ptr = NULL;
+    try { crypt::sha1_batch(&ptr, &len, 1, hash); t.fail(); }
+    catch (eNullPointer& e) { }
+}
+
+void testXXHash64(const tTest& t)
+{
+    vector< pair<string,string> > tests;
+
+    tests.push_back(make_pair(string(""),
+                              string("ef46db3751d8e999")));
+
+    tests.push_back(make_pair(string("a"),
+                              string("d24ec4f1a98c6e5b")));
+
+    tests.push_back(make_pair(string("abc"),
+                              string("44bc2cf5ad770999")));
+
+    tests.push_back(make_pair(string("message digest"),
+                              string("066ed728fceeb3be")));
+
+    tests.push_back(make_pair(string("abcdefghijklmnopqrstuvwxyz"),
+                              string("cfe1f278fa89835c")));
+
+    tests.push_back(make_pair(string("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"),
+                              string("aaa46907d3047814")));
+
+    tests.push_back(make_pair(string("12345678901234567890123456789012345678901234567890123456789012345678901234567890"),
+                              string("e04a477f19ee145d")));
+
+    for (size_t i = 0; i < tests.size(); i++)
+    {
+        crypt::tXXHash64 hasher;
+        test(hasher, tests[i], t);
+    }
+
+    string msg = "123456789";
+    t.iseq(crypt::xxhash64((const u8*)msg.c_str(), (u32)msg.length(), 0),
+           (u64)0x8cb841db40e6ae83ULL);
+    t.iseq(crypt::xxhash64((const u8*)msg.c_str(), (u32)msg.length(), 0x9E3779B97F4A7C15ULL),
+           (u64)0x6b8ebcf6d6f5b807ULL);
+    crypt::tXXHash64 seeded(0x9E3779B97F4A7C15ULL);
+    seeded.write((const u8*)msg.c_str(), (i32)msg.length());
+    t.iseq(seeded.getHash64(), (u64)0x6b8ebcf6d6f5b807ULL);
+}
+
+
+void testCRC32C(const tTest& t)
+{
+    vector< pair<string,string> > tests;
+
+    tests.push_back(make_pair(string(""),
+                              string("00000000")));
+
+    tests.push_back(make_pair(string("a"),
+                              string("c1d04330")));
+
+    tests.push_back(make_pair(string("abc"),
+                              string("364b3fb7")));
+
+    tests.push_back(make_pair(string("message digest"),
+                              string("02bd79d0")));
+
+    tests.push_back(make_pair(string("abcdefghijklmnopqrstuvwxyz"),
+                              string("9ee6ef25")));
+
+    tests.push_back(make_pair(string("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"),
+                              string("a245d57d")));
+
+    tests.push_back(make_pair(string("12345678901234567890123456789012345678901234567890123456789012345678901234567890"),
+                              string("477a6781")));
+
+    for (size_t i = 0; i < tests.size(); i++)
+    {
+        crypt::tCRC32C hasher;
+        test(hasher, tests[i], t);
+    }
+
+    string msg = "123456789";
+    t.iseq(crypt::crc32c(0, (const u8*)msg.c_str(), (u32)msg.length()), (u32)0xe3069283);
+}
+
+
+void testAdler32(const tTest& t)
+{
+    vector< pair<string,string> > tests;
+
+    tests.push_back(make_pair(string(""),
+                              string("00000001")));
+
+    tests.push_back(make_pair(string("a"),
+                              string("00620062")));
+
+    tests.push_back(make_pair(string("abc"),
+                              string("024d0127")));
+
+    tests.push_back(make_pair(string("message digest"),
+                              string("29750586")));
+
+    tests.push_back(make_pair(string("abcdefghijklmnopqrstuvwxyz"),
+                              string("90860b20")));
+
+    tests.push_back(make_pair(string("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"),
+                              string("8adb150c")));
+
+    tests.push_back(make_pair(string("12345678901234567890123456789012345678901234567890123456789012345678901234567890"),
+                              string("97b61069")));
+
+    for (size_t i = 0; i < tests.size(); i++)
+    {
+        crypt::tAdler32 hasher;
+        test(hasher, tests[i], t);
+    }
+
+    string msg = "123456789";
+    t.iseq(crypt::adler32(1, (const u8*)msg.c_str(), (u32)msg.length()), (u32)0x091e01de);
+}
+
+
+u32 refCrc32c(const vector<u8>& v)
+{
+    u32 crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < v.size(); i++)
+    {
+        crc ^= v[i];
+        for (int k = 0; k < 8; k++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82f63b78 : (crc >> 1);
+    }
+    return ~crc;
+}
+
+
+u32 refAdler32(const vector<u8>& v)
+{
+    u32 s1 = 1, s2 = 0;
+    for (size_t i = 0; i < v.size(); i++)
+    {
+        s1 = (s1 + v[i]) % 65521;
+        s2 = (s2 + s1) % 65521;
+    }
+    return (s2 << 16) | s1;
+}
+
+
+void testFastHashes(const tTest& t)
+{
+    // Short, a few blocks, and past both the crc32 instruction's
+    // three-way split and Adler-32's reduction interval. All-0xFF bytes
+    // are the worst case for Adler-32's sums.
+    vector<u8> v;
+    switch (rand() % 4)
+    {
+        case 0: v = randomBytes(100); break;
+        case 1: v = randomBytes(2000); break;
+        case 2: v = randomBytes(70000); break;
+        default: v.assign(rand() % 70000, 0xFF);
+    }
+    const u8* p = v.size() > 0 ? &v[0] : NULL;
+    u32 len = (u32)v.size();
+
+    u32 crc = refCrc32c(v);
+    t.iseq(crypt::crc32c(0, p, len, false), crc);
+    t.iseq(crypt::crc32c(0, p, len, true), crc);
+
+    u32 adler = refAdler32(v);
+    for (int level = kSimdNone; level < kMaxSimdLevel; level++)
+        t.iseq(crypt::adler32(1, p, len, (nSimdLevel)level), adler);
+
+    // Streaming in random pieces gives the one-shot answers.
+    crypt::tXXHash64 xx(len);
+    crypt::tCRC32C crcHasher;
+    crypt::tAdler32 adlerHasher;
+    for (u32 pos = 0; pos < len; )
+    {
+        u32 n = (rand() % std::min(len - pos, (u32)100)) + 1;
+        xx.write(p + pos, (i32)n);
+        crcHasher.write(p + pos, (i32)n);
+        adlerHasher.write(p + pos, (i32)n);
+        pos += n;
+    }
+    t.iseq(xx.getHash64(), crypt::xxhash64(p, len, len));
+    t.iseq(crcHasher.getCRC(), crc);
+    t.iseq(adlerHasher.getChecksum(), adler);
+
+    try { crcHasher.write(p, 0); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { crypt::xxhash64(NULL, 1, 0); t.fail(); }
+    catch (eNullPointer& e) { }
+}
+
 int main()
 {
     tCrashReporter::init();
@@ -2605,6 +3021,11 @@ int main()
     tTest("tSHA384 test", testSHA384, kNumIters);
     tTest("tSHA512 test", testSHA512, kNumIters);
     tTest("tWhirlpool test", testWhirlpool, kNumIters);
+    tTest("SHA batch test", testShaBatch, 200);
+    tTest("tXXHash64 test", testXXHash64, kNumIters);
+    tTest("tCRC32C test", testCRC32C, kNumIters);
+    tTest("tAdler32 test", testAdler32, kNumIters);
+    tTest("fast hash consistency test", testFastHashes, 200);
 
     tTest("HMAC_MD5 test", testHMAC_MD5, kNumIters);
     tTest("HMAC_SHA1 test", testHMAC_SHA1, kNumIters);
@@ -2613,10 +3034,12 @@ int main()
     tTest("HMAC_SHA384 test", testHMAC_SHA384, kNumIters);
     tTest("HMAC_SHA512 test", testHMAC_SHA512, kNumIters);
     tTest("HMAC_WHIRLPOOL test", testHMAC_WHIRLPOOL, kNumIters);
+    tTest("tHmac test", testHmacContext, kNumIters);
 
     tTest("PBKDF2_HMAC_SHA1 test", testPBKDF2_HMAC_SHA1);
     tTest("PBKDF2_HMAC_SHA512 test", testPBKDF2_HMAC_SHA512);
     tTest("PBKDF2_HMAC_WHIRLPOOL test", testPBKDF2_HMAC_WHIRLPOOL);
+    tTest("PBKDF2 parallel test", testPBKDF2_parallel, 100);
 
     return 0;
 }
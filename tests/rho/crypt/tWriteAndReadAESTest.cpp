@@ -1,5 +1,6 @@
 #include <rho/crypt/tReadableAES.h>
 #include <rho/crypt/tWritableAES.h>
+#include <rho/eRho.h>
 #include <rho/tCrashReporter.h>
 #include <rho/tTest.h>
 
@@ -124,6 +125,50 @@ void randomFlushTest(const tTest& t, crypt::nOperationModeAES opmode, u8* key, c
 }
 
 
+/*
+ * In GCM mode, any change to the stream must be noticed: either the read
+ * comes up short (when the change is to a chunk length) or it throws.
+ */
+void tamperTest(const tTest& t, u8* key, crypt::nKeyLengthAES keylen)
+{
+    tByteWritable bw;
+    tByteReadable br;
+
+    crypt::tWritableAES cw(&bw, crypt::kOpModeGCM, key, keylen);
+    crypt::tReadableAES cr(&br, crypt::kOpModeGCM, key, keylen);
+
+    for (int i = 0; i < kNumItersPerKey; i++)
+    {
+        // Gen a random message.
+        int messagelen = (rand() % kMaxMessageLength) + 1;
+        vector<u8> pt1(messagelen);
+        for (size_t j = 0; j < pt1.size(); j++)
+            pt1[j] = rand() % 256;
+
+        // Write the message to the AES writer (encryption).
+        bw.reset();
+        cw.reset();
+        cw.writeAll(&pt1[0], pt1.size());
+        cw.flush();
+
+        // Flip a bit somewhere in the stream.
+        vector<u8> ct = bw.getBuf();
+        ct[rand() % ct.size()] ^= (u8)(1 << (rand() % 8));
+
+        // Read the message through the AES reader (decryption).
+        br.reset(ct);
+        cr.reset();
+        vector<u8> pt2(messagelen);
+        try
+        {
+            i32 r = cr.readAll(&pt2[0], pt2.size());
+            t.assert(r < messagelen);
+        }
+        catch (eRuntimeError& e) { }
+    }
+}
+
+
 void test128(const tTest& t)
 {
     u8 key128[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
@@ -136,6 +181,11 @@ void test128(const tTest& t)
     simpleTest(t, crypt::kOpModeCBC, key128, crypt::k128bit);
     randomFlushTest(t, crypt::kOpModeECB, key128, crypt::k128bit);
     randomFlushTest(t, crypt::kOpModeCBC, key128, crypt::k128bit);
+    simpleTest(t, crypt::kOpModeCTR, key128, crypt::k128bit);
+    simpleTest(t, crypt::kOpModeGCM, key128, crypt::k128bit);
+    randomFlushTest(t, crypt::kOpModeCTR, key128, crypt::k128bit);
+    randomFlushTest(t, crypt::kOpModeGCM, key128, crypt::k128bit);
+    tamperTest(t, key128, crypt::k128bit);
 }
 
 
@@ -152,6 +202,11 @@ void test192(const tTest& t)
     simpleTest(t, crypt::kOpModeCBC, key192, crypt::k192bit);
     randomFlushTest(t, crypt::kOpModeECB, key192, crypt::k192bit);
     randomFlushTest(t, crypt::kOpModeCBC, key192, crypt::k192bit);
+    simpleTest(t, crypt::kOpModeCTR, key192, crypt::k192bit);
+    simpleTest(t, crypt::kOpModeGCM, key192, crypt::k192bit);
+    randomFlushTest(t, crypt::kOpModeCTR, key192, crypt::k192bit);
+    randomFlushTest(t, crypt::kOpModeGCM, key192, crypt::k192bit);
+    tamperTest(t, key192, crypt::k192bit);
 }
 
 
@@ -168,6 +223,11 @@ void test256(const tTest& t)
     simpleTest(t, crypt::kOpModeCBC, key256, crypt::k256bit);
     randomFlushTest(t, crypt::kOpModeECB, key256, crypt::k256bit);
     randomFlushTest(t, crypt::kOpModeCBC, key256, crypt::k256bit);
+    simpleTest(t, crypt::kOpModeCTR, key256, crypt::k256bit);
+    simpleTest(t, crypt::kOpModeGCM, key256, crypt::k256bit);
+    randomFlushTest(t, crypt::kOpModeCTR, key256, crypt::k256bit);
+    randomFlushTest(t, crypt::kOpModeGCM, key256, crypt::k256bit);
+    tamperTest(t, key256, crypt::k256bit);
 }
 
 
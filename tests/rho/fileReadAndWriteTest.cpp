@@ -1,3 +1,4 @@
+#include <rho/iPackable.h>
 #include <rho/iReadable.h>
 #include <rho/iWritable.h>
 #include <rho/tCrashReporter.h>
@@ -53,12 +54,132 @@ void test(const tTest& t)
 }
 
 
+void writevTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    vector<u8> small(10), big((lcg.next() % 1000000) + BUFSIZ);
+    for (size_t i = 0; i < small.size(); i++)
+        small[i] = (lcg.next() % 256);
+    for (size_t i = 0; i < big.size(); i++)
+        big[i] = (lcg.next() % 256);
+
+    // Mix stdio-buffered writes with ones that go straight to writev(2).
+    tConstIoVec smallVecs[2] = { { &small[0], 4 }, { &small[4], 6 } };
+    tConstIoVec bigVecs[2] = { { &small[0], 10 }, { &big[0], (i32)big.size() } };
+    {
+        tFileWritable file(gFilePath);
+        t.iseq(file.writeAll(&small[0], 10), 10);
+        t.iseq(file.writeAllv(bigVecs, 2), (i32)big.size() + 10);
+        t.iseq(file.writeAllv(smallVecs, 2), 10);
+    }
+
+    vector<u8> expected;
+    expected.insert(expected.end(), small.begin(), small.end());
+    expected.insert(expected.end(), small.begin(), small.end());
+    expected.insert(expected.end(), big.begin(), big.end());
+    expected.insert(expected.end(), small.begin(), small.end());
+
+    vector<u8> buffromfile(expected.size() + 1);
+    {
+        tFileReadable file(gFilePath);
+        t.iseq(file.readAll(&buffromfile[0], (i32)buffromfile.size()), (i32)expected.size());
+    }
+    buffromfile.resize(expected.size());
+
+    t.assert(buffromfile == expected);
+}
+
+
+void mmapReadTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    i32 buflen = (lcg.next() % 10000000);
+    vector<u8> buf(buflen);
+    for (i32 i = 0; i < buflen; i++)
+        buf[i] = (lcg.next() % 256);
+
+    {
+        tFileWritable file(gFilePath);
+        if (buflen > 0)
+            t.iseq(file.writeAll(&buf[0], buflen), buflen);
+    }
+
+    vector<u8> buffromfile;
+    tMmapReadable file(gFilePath);
+    t.iseq(file.getSize(), (u64)buflen);
+    u8 part[1000];
+    i32 r;
+    while ((r = file.read(part, (lcg.next() % 1000) + 1)) > 0)
+        buffromfile.insert(buffromfile.end(), part, part+r);
+    t.iseq(r, 0);
+    t.iseq(file.read(part, 1000), -1);
+    t.assert(buf == buffromfile);
+
+    // Rewind and borrow it all instead.
+    file.setPosition(0);
+    if (buflen > 0)
+    {
+        u8* view = file.borrow((u64)buflen);
+        t.assert(view != NULL);
+        t.assert(memcmp(view, &buf[0], buflen) == 0);
+        view[0] = (u8)(view[0] + 1);       // private to us, not written to the file
+    }
+    t.assert(file.borrow(1) == NULL);
+    t.iseq(file.getPosition(), (u64)buflen);
+
+    tFileReadable check(gFilePath);
+    vector<u8> again(buflen + 1);
+    t.iseq(check.readAll(&again[0], buflen + 1), buflen);
+    again.resize(buflen);
+    t.assert(again == buf);
+}
+
+
+void unpackViewTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    vector<u8> first(lcg.next() % 100000), second(lcg.next() % 100000);
+    for (size_t i = 0; i < first.size(); i++)
+        first[i] = (lcg.next() % 256);
+    for (size_t i = 0; i < second.size(); i++)
+        second[i] = (lcg.next() % 256);
+
+    {
+        tFileWritable file(gFilePath);
+        pack(&file, first);
+        pack(&file, (u32)1234);
+        pack(&file, second);
+    }
+
+    tMmapReadable file(gFilePath);
+    u64 length;
+    u8* view = unpackView(&file, length, 0xFFFFFFFFFFFFFFFFULL);
+    t.iseq(length, (u64)first.size());
+    t.assert(vector<u8>(view, view+length) == first);
+    u32 x; unpack(&file, x);
+    t.iseq(x, (u32)1234);
+    vector<u8> copied;
+    unpack(&file, copied);
+    t.assert(copied == second);
+
+    try { unpackView(&file, length, 0xFFFFFFFFFFFFFFFFULL); t.fail(); }
+    catch (eBufferUnderflow& e) { }
+
+    file.setPosition(0);
+    try { unpackView(&file, length, first.size() / 2); if (first.size() > 0) t.fail(); }
+    catch (eBufferOverflow& e) { }
+}
+
+
 int main()
 {
     tCrashReporter::init();
     srand(time(0));
 
     tTest("file read/write test", test);
+    tTest("writev test", writevTest, 10);
+    tTest("mmap read test", mmapReadTest, 10);
+    tTest("unpackView test", unpackViewTest, 10);
 
     return 0;
 }
@@ -918,6 +918,27 @@ void vector_u8_test(const tTest& t)
     t.assert(buf == buf2);
 }
 
+void packBytesTest(const tTest& t)
+{
+    string str = "Hi. Ryan speaking.";
+    tByteWritable out1;
+    pack(&out1, (u64)str.size());
+    for (size_t i = 0; i < str.size(); i++)
+        pack(&out1, (u8)str[i]);
+
+    tByteWritable out2;
+    packBytes(&out2, (const u8*)str.data(), (u64)str.size());
+    t.assert(out1.getBuf() == out2.getBuf());
+
+    tByteWritable out3;
+    pack(&out3, str);
+    t.assert(out1.getBuf() == out3.getBuf());
+
+    tByteWritable out4;
+    pack(&out4, vector<u8>(str.begin(), str.end()));
+    t.assert(out1.getBuf() == out4.getBuf());
+}
+
 void vector_u8_speedtest(const tTest& t)
 {
     const int kBufSize = 100000000;
@@ -973,6 +994,7 @@ int main()
 
     tTest("vector<u8> empty test", vector_u8_emptytest);
     tTest("vector<u8> test", vector_u8_test, 10000);
+    tTest("packBytes test", packBytesTest);
     //tTest("vector<u8> speed test", vector_u8_speedtest);
 
     return 0;
@@ -2,6 +2,8 @@
 #include <rho/tCrashReporter.h>
 #include <rho/tTest.h>
 
+#include <vector>
+
 
 using namespace rho;
 
@@ -46,12 +48,40 @@ void bufferedReadableTest(const tTest& t)
 }
 
 
+void readvTest(const tTest& t)
+{
+    std::vector<u8> data;
+    for (u8 i = 0; i < 10; i++)
+        data.push_back(i);
+
+    u8 a[3], b[4], c[5];
+    tIoVec bufs[4] = { { a, 3 }, { NULL, 0 }, { b, 4 }, { c, 5 } };
+
+    tByteReadable r1(data);
+    t.iseq(r1.readv(bufs+1, 3), 4);          // just the first non-empty buffer
+    t.iseq(b[0], (u8)0);
+    t.iseq(b[3], (u8)3);
+
+    tByteReadable r2(data);
+    t.iseq(r2.readAllv(bufs, 4), 10);        // short: eof
+    t.iseq(a[0], (u8)0);
+    t.iseq(a[2], (u8)2);
+    t.iseq(b[0], (u8)3);
+    t.iseq(c[2], (u8)9);
+    t.iseq(r2.readAllv(bufs, 4), -1);
+
+    try { r2.readv(bufs+1, 1); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
 int main()
 {
     tCrashReporter::init();
 
     tTest("iReadable test", interfaceTest);
     tTest("tBufferedReadable test", bufferedReadableTest);
+    tTest("readv test", readvTest);
 
     return 0;
 }
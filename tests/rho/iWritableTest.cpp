@@ -2,6 +2,9 @@
 #include <rho/tCrashReporter.h>
 #include <rho/tTest.h>
 
+#include <string>
+#include <string.h>
+
 
 using namespace rho;
 
@@ -46,12 +49,153 @@ void bufferedWritableTest(const tTest& t)
 }
 
 
+/*
+ * Takes at most 'max' bytes per write(), and counts the calls.
+ */
+class tTrickleWritable : public iWritable
+{
+    public:
+
+        tTrickleWritable(i32 max) : m_max(max), m_numWrites(0), m_numGathers(0) { }
+
+        i32 write(const u8* buffer, i32 length)
+        {
+            i32 n = (length < m_max) ? length : m_max;
+            m_data.append((const char*)buffer, n);
+            m_numWrites++;
+            return n;
+        }
+
+        i32 writeAll(const u8* buffer, i32 length)
+        {
+            i32 amountWritten = 0;
+            while (amountWritten < length)
+                amountWritten += write(buffer+amountWritten, length-amountWritten);
+            return amountWritten;
+        }
+
+        i32 writeAllv(const tConstIoVec* bufs, i32 count)
+        {
+            m_numGathers++;
+            return iWritable::writeAllv(bufs, count);
+        }
+
+        i32 m_max;
+        std::string m_data;
+        int m_numWrites;
+        int m_numGathers;
+};
+
+
+static
+tConstIoVec s_vec(const char* str)
+{
+    tConstIoVec v;
+    v.base = (const u8*)str;
+    v.length = (i32)strlen(str);
+    return v;
+}
+
+
+void writevTest(const tTest& t)
+{
+    tConstIoVec bufs[4] = { s_vec("abc"), s_vec(""), s_vec("defg"), s_vec("h") };
+
+    tTrickleWritable w1(100);
+    t.iseq(w1.writev(bufs+1, 3), 4);         // just the first non-empty buffer
+    t.assert(w1.m_data == "defg");
+
+    tTrickleWritable w2(3);
+    t.iseq(w2.writeAllv(bufs, 4), 8);
+    t.assert(w2.m_data == "abcdefgh");
+
+    try { w2.writev(bufs+1, 1); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { w2.writev(bufs, 0); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { w2.writeAllv(NULL, 1); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+void bufferedWritevTest(const tTest& t)
+{
+    tTrickleWritable inner(1000);
+    tBufferedWritable bw(&inner, 16);
+
+    tConstIoVec small[2] = { s_vec("abc"), s_vec("de") };
+    t.iseq(bw.writeAllv(small, 2), 5);
+    t.iseq(inner.m_numWrites, 0);            // fits, so it was buffered
+
+    // Too big to buffer: goes out in one gathered write, after what
+    // was buffered.
+    tConstIoVec big[3] = { s_vec("fghij"), s_vec("klmnopqrst"), s_vec("uvwxyz") };
+    t.iseq(bw.writeAllv(big, 3), 21);
+    t.iseq(inner.m_numGathers, 1);
+    t.assert(inner.m_data == "abcdefghijklmnopqrstuvwxyz");
+
+    t.assert(bw.flush());
+    t.assert(inner.m_data == "abcdefghijklmnopqrstuvwxyz");
+}
+
+
+/*
+ * Takes bytes until its budget runs out, then writes nothing until the
+ * budget is topped up.
+ */
+class tStallingWritable : public iWritable
+{
+    public:
+
+        tStallingWritable(i32 budget) : m_budget(budget) { }
+
+        i32 write(const u8* buffer, i32 length)
+        {
+            i32 n = (length < m_budget) ? length : m_budget;
+            m_data.append((const char*)buffer, n);
+            m_budget -= n;
+            return n;
+        }
+
+        i32 writeAll(const u8* buffer, i32 length)
+        {
+            return write(buffer, length);
+        }
+
+        i32 m_budget;
+        std::string m_data;
+};
+
+
+void bufferedWritevStallTest(const tTest& t)
+{
+    tStallingWritable inner(3);
+    tBufferedWritable bw(&inner, 16);
+
+    tConstIoVec small[1] = { s_vec("abcde") };
+    t.iseq(bw.writev(small, 1), 5);
+
+    // Only part of what was buffered gets out...
+    tConstIoVec big[1] = { s_vec("fghijklmnopqrstuvwxyz") };
+    t.iseq(bw.writev(big, 1), 0);
+    t.assert(inner.m_data == "abc");
+
+    // ...so the next flush() must send just the rest of it.
+    inner.m_budget = 100;
+    t.assert(bw.flush());
+    t.assert(inner.m_data == "abcde");
+}
+
+
 int main()
 {
     tCrashReporter::init();
 
     tTest("iWritable test", interfaceTest);
     tTest("tBufferedWritable test", bufferedWritableTest);
+    tTest("writev test", writevTest);
+    tTest("tBufferedWritable writev test", bufferedWritevTest);
+    tTest("tBufferedWritable writev stall test", bufferedWritevStallTest);
 
     return 0;
 }
@@ -0,0 +1,353 @@
+#include <rho/img/nImageFormat.h>
+#include <rho/img/ebImg.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+#include <rho/algo/tLCG.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+
+using namespace rho;
+using std::vector;
+
+
+static const u8 kCanary = 0xA5;
+
+
+static
+vector<u8> s_genData(algo::iLCG& lcg, u32 len)
+{
+    vector<u8> data(len);
+    for (u32 i = 0; i < len; i++)
+        data[i] = (u8)(lcg.next() % 256);
+    return data;
+}
+
+
+/*
+ * Converts a width x height image with the given level into a buffer which
+ * is a bit bigger than needed, and checks the extra bytes aren't touched.
+ */
+static
+vector<u8> s_convert(const tTest& t, img::nImageFormat from, img::nImageFormat to,
+                     nSimdLevel level, u32 width, u32 height, vector<u8> source)
+{
+    t.iseq((u32)source.size(), img::getBufSize(from, width, height));
+    u32 destSize = img::getBufSize(to, width, height);
+    vector<u8> dest(destSize + 64, kCanary);
+    i32 used = img::colorspace_conversion(from, to, width, height, level,
+                                          &source[0], (i32)source.size(),
+                                          &dest[0], (i32)dest.size());
+    t.iseq(used, (i32)destSize);
+    for (size_t i = destSize; i < dest.size(); i++)
+        t.assert(dest[i] == kCanary);
+    dest.resize(destSize);
+    return dest;
+}
+
+/*
+ * Same as above, for a single row of pixels (which is all the packed
+ * formats care about).
+ */
+static
+vector<u8> s_convert(const tTest& t, img::nImageFormat from, img::nImageFormat to,
+                     nSimdLevel level, vector<u8> source)
+{
+    u32 numPixels = (u32)source.size() / img::getBPP(from);
+    return s_convert(t, from, to, level, numPixels, 1, source);
+}
+
+
+static
+bool s_isImplemented(img::nImageFormat from, img::nImageFormat to)
+{
+    if (from == to)
+        return true;
+    if (from == img::kRGB16 || to == img::kRGB16)
+        return false;
+    if (from == img::kRGBPlanar)
+        return to != img::kYUYV && to != img::kI420 && to != img::kNV12;
+    if (to == img::kRGBPlanar)
+        return from != img::kYUYV && from != img::kI420 && from != img::kNV12;
+    return true;
+}
+
+
+void levelsAgreeTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+
+    // Rows big enough for every kernel's main loop, with a random tail.
+    // (Even sizes, for the 4:2:0 formats.)
+    u32 width = ((lcg.next() % 200) + 1) * 2;
+    u32 height = ((lcg.next() % 4) + 1) * 2;
+
+    for (i32 f = 0; f < img::kMaxImageFormat; f++)
+    {
+        for (i32 to = 0; to < img::kMaxImageFormat; to++)
+        {
+            img::nImageFormat from = (img::nImageFormat) f;
+            img::nImageFormat dest = (img::nImageFormat) to;
+            if (!s_isImplemented(from, dest))
+                continue;
+
+            vector<u8> source = s_genData(lcg, img::getBufSize(from, width, height));
+            vector<u8> expected = s_convert(t, from, dest, kSimdNone, width, height, source);
+
+            for (i32 level = kSimdSSE2; level <= getSimdLevel(); level++)
+            {
+                vector<u8> result = s_convert(t, from, dest, (nSimdLevel)level, width, height, source);
+                if (result != expected)
+                {
+                    std::cerr << "from " << f << " to " << to << " differs at level "
+                              << simdLevelEnumToString((nSimdLevel)level) << std::endl;
+                    t.fail();
+                }
+            }
+        }
+    }
+}
+
+
+void yuyvExhaustiveTest(const tTest& t)
+{
+    // Every (u, v) pair, with every y value somewhere.
+    vector<u8> yuyv(256 * 256 * 4);
+    for (u32 i = 0; i < 256*256; i++)
+    {
+        yuyv[4*i+0] = (u8)((i*13) % 256);
+        yuyv[4*i+1] = (u8)(i / 256);
+        yuyv[4*i+2] = (u8)((i*7 + 100) % 256);
+        yuyv[4*i+3] = (u8)(i % 256);
+    }
+
+    img::nImageFormat dests[] = { img::kRGB24, img::kRGBA, img::kBGRA, img::kGrey };
+    for (size_t d = 0; d < sizeof(dests)/sizeof(dests[0]); d++)
+    {
+        vector<u8> expected = s_convert(t, img::kYUYV, dests[d], kSimdNone, yuyv);
+        for (i32 level = kSimdSSE2; level <= getSimdLevel(); level++)
+            t.assert(s_convert(t, img::kYUYV, dests[d], (nSimdLevel)level, yuyv) == expected);
+    }
+}
+
+
+static
+i32 s_clip(double val)
+{
+    if (val > 255.0)
+        return 255;
+    else if (val < 0.0)
+        return 0;
+    return (i32)val;
+}
+
+
+static
+bool s_near(i32 a, i32 b)
+{
+    return abs(a - b) <= 1;
+}
+
+
+void matchesFloatingPointTest(const tTest& t)
+{
+    // The fixed-point reference is within one of the floating-point
+    // formulas the converters used to be written with.
+
+    algo::tKnuthLCG lcg(rand());
+    vector<u8> yuyv = s_genData(lcg, 20000);
+    vector<u8> rgb = s_convert(t, img::kYUYV, img::kRGB24, kSimdNone, yuyv);
+    for (size_t i = 0; i < yuyv.size(); i += 4)
+    {
+        i32 u = yuyv[i+1] - 128;
+        i32 v = yuyv[i+3] - 128;
+        for (i32 j = 0; j < 2; j++)
+        {
+            i32 y = yuyv[i+2*j];
+            const u8* p = &rgb[(i/2 + j) * 3];
+            t.assert(s_near(p[0], s_clip(y + 1.402000*v)));
+            t.assert(s_near(p[1], s_clip(y - 0.344140*u - 0.714140*v)));
+            t.assert(s_near(p[2], s_clip(y + 1.772000*u)));
+        }
+    }
+
+    rgb = s_genData(lcg, 30000);
+    yuyv = s_convert(t, img::kRGB24, img::kYUYV, kSimdNone, rgb);
+    for (size_t i = 0; i < rgb.size(); i += 6)
+    {
+        const u8* p = &rgb[i];
+        const u8* q = &yuyv[i/3*2];
+        double y0 = 0.299*p[0] + 0.587*p[1] + 0.114*p[2];
+        double y1 = 0.299*p[3] + 0.587*p[4] + 0.114*p[5];
+        double u = (- 0.147*(p[0]+p[3]) - 0.289*(p[1]+p[4]) + 0.436*(p[2]+p[5])) / 2 + 128;
+        double v = (0.615*(p[0]+p[3]) - 0.515*(p[1]+p[4]) - 0.100*(p[2]+p[5])) / 2 + 128;
+        t.assert(s_near(q[0], s_clip(y0)));
+        t.assert(s_near(q[1], s_clip(u)));
+        t.assert(s_near(q[2], s_clip(y1)));
+        t.assert(s_near(q[3], s_clip(v)));
+    }
+}
+
+
+void roundTripTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    u32 numPixels = ((lcg.next() % 1000) + 1) * 2;
+    vector<u8> rgb = s_genData(lcg, numPixels * 3);
+
+    // The byte reorderings are lossless.
+    img::nImageFormat formats[] = { img::kRGBA, img::kBGRA };
+    for (size_t i = 0; i < 2; i++)
+    {
+        vector<u8> four = s_convert(t, img::kRGB24, formats[i], getSimdLevel(), rgb);
+        for (u32 p = 0; p < numPixels; p++)
+            t.assert(four[4*p+3] == 255);
+        vector<u8> other = s_convert(t, formats[i], formats[1-i], getSimdLevel(), four);
+        t.assert(s_convert(t, formats[1-i], img::kRGB24, getSimdLevel(), other) == rgb);
+        t.assert(s_convert(t, formats[i], img::kRGB24, getSimdLevel(), four) == rgb);
+    }
+
+    // Grey survives the trip through every other format.
+    vector<u8> grey = s_genData(lcg, numPixels * 2);
+    for (i32 f = img::kRGB24; f < img::kMaxImageFormat; f++)
+    {
+        img::nImageFormat format = (img::nImageFormat)f;
+        vector<u8> other = s_convert(t, img::kGrey, format, getSimdLevel(), numPixels, 2, grey);
+        t.assert(s_convert(t, format, img::kGrey, getSimdLevel(), numPixels, 2, other) == grey);
+    }
+}
+
+
+void planarTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    u32 width = ((lcg.next() % 100) + 1) * 2;
+    u32 height = ((lcg.next() % 30) + 1) * 2;
+    vector<u8> rgb = s_genData(lcg, width * height * 3);
+
+    // I420 and NV12 hold the same samples, only laid out differently.
+    vector<u8> i420 = s_convert(t, img::kRGB24, img::kI420, getSimdLevel(), width, height, rgb);
+    vector<u8> nv12 = s_convert(t, img::kRGB24, img::kNV12, getSimdLevel(), width, height, rgb);
+    t.assert(s_convert(t, img::kI420, img::kNV12, getSimdLevel(), width, height, i420) == nv12);
+    t.assert(s_convert(t, img::kNV12, img::kI420, getSimdLevel(), width, height, nv12) == i420);
+    u32 numPixels = width * height;
+    u32 chromaSize = numPixels / 4;
+    for (u32 i = 0; i < chromaSize; i++)
+    {
+        t.assert(nv12[numPixels + 2*i] == i420[numPixels + i]);
+        t.assert(nv12[numPixels + 2*i + 1] == i420[numPixels + chromaSize + i]);
+    }
+
+    // Their luma is the luma of the yuyv conversion, and each 2x2 block's
+    // chroma is the rounded average of the two rows' yuyv chroma.
+    vector<u8> yuyv = s_convert(t, img::kRGB24, img::kYUYV, getSimdLevel(), width, height, rgb);
+    for (u32 y = 0; y < height; y++)
+        for (u32 x = 0; x < width; x++)
+            t.assert(i420[y*width + x] == yuyv[(y*width + x) * 2]);
+    for (u32 y = 0; y < height/2; y++)
+    {
+        for (u32 x = 0; x < width/2; x++)
+        {
+            const u8* top = &yuyv[(2*y*width + 2*x) * 2];
+            const u8* bottom = top + width * 2;
+            t.iseq(i420[numPixels + y*width/2 + x], (u8)((top[1] + bottom[1] + 1) / 2));
+            t.iseq(i420[numPixels + chromaSize + y*width/2 + x], (u8)((top[3] + bottom[3] + 1) / 2));
+        }
+    }
+    t.assert(s_convert(t, img::kYUYV, img::kI420, getSimdLevel(), width, height, yuyv) == i420);
+
+    // Back to rgb is the same as through yuyv with the chroma of each
+    // pair of rows.
+    vector<u8> i420Yuyv = s_convert(t, img::kI420, img::kYUYV, getSimdLevel(), width, height, i420);
+    t.assert(s_convert(t, img::kI420, img::kRGB24, getSimdLevel(), width, height, i420) ==
+             s_convert(t, img::kYUYV, img::kRGB24, getSimdLevel(), width, height, i420Yuyv));
+    for (u32 y = 0; y < height; y += 2)
+    {
+        for (u32 x = 0; x < width; x += 2)
+        {
+            t.assert(i420Yuyv[(y*width + x)*2 + 1] == i420Yuyv[((y+1)*width + x)*2 + 1]);
+            t.assert(i420Yuyv[(y*width + x)*2 + 3] == i420Yuyv[((y+1)*width + x)*2 + 3]);
+        }
+    }
+
+    // Planar RGB is lossless.
+    vector<u8> planar = s_convert(t, img::kRGB24, img::kRGBPlanar, getSimdLevel(), width, height, rgb);
+    for (u32 i = 0; i < numPixels; i++)
+    {
+        t.assert(planar[i] == rgb[3*i]);
+        t.assert(planar[numPixels + i] == rgb[3*i+1]);
+        t.assert(planar[2*numPixels + i] == rgb[3*i+2]);
+    }
+    t.assert(s_convert(t, img::kRGBPlanar, img::kRGB24, getSimdLevel(), width, height, planar) == rgb);
+    vector<u8> bgra = s_convert(t, img::kRGBPlanar, img::kBGRA, getSimdLevel(), width, height, planar);
+    t.assert(bgra == s_convert(t, img::kRGB24, img::kBGRA, getSimdLevel(), width, height, rgb));
+    t.assert(s_convert(t, img::kBGRA, img::kRGBPlanar, getSimdLevel(), width, height, bgra) == planar);
+    t.assert(s_convert(t, img::kRGBPlanar, img::kGrey, getSimdLevel(), width, height, planar) ==
+             s_convert(t, img::kRGB24, img::kGrey, getSimdLevel(), width, height, rgb));
+}
+
+
+void badSizesTest(const tTest& t)
+{
+    u8 source[64] = { 0 };
+    u8 dest[256];
+
+    for (i32 level = kSimdNone; level <= getSimdLevel(); level++)
+    {
+        nSimdLevel l = (nSimdLevel) level;
+
+        try { img::colorspace_conversion(img::kYUYV, img::kRGB24, l, source, 6, dest, 256); t.fail(); }
+        catch (img::eColorspaceConversionError& e) { }
+        try { img::colorspace_conversion(img::kRGB24, img::kYUYV, l, source, 9, dest, 256); t.fail(); }
+        catch (img::eColorspaceConversionError& e) { }
+        try { img::colorspace_conversion(img::kRGBA, img::kGrey, l, source, 63, dest, 256); t.fail(); }
+        catch (img::eColorspaceConversionError& e) { }
+
+        try { img::colorspace_conversion(img::kYUYV, img::kRGBA, l, source, 64, dest, 127); t.fail(); }
+        catch (eBufferOverflow& e) { }
+        try { img::colorspace_conversion(img::kGrey, img::kRGB24, l, source, 64, dest, 191); t.fail(); }
+        catch (eBufferOverflow& e) { }
+        try { img::colorspace_conversion(img::kBGRA, img::kRGBA, l, source, 64, dest, 60); t.fail(); }
+        catch (eBufferOverflow& e) { }
+
+        try { img::colorspace_conversion(img::kRGB16, img::kRGB24, l, source, 64, dest, 256); t.fail(); }
+        catch (eNotImplemented& e) { }
+    }
+
+    try { img::colorspace_conversion(img::kUnknown, img::kRGB24, source, 64, dest, 256); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    // The 4:2:0 formats need an even width and height, and a buffer to match.
+    try { img::colorspace_conversion(img::kI420, img::kRGB24, source, 24, dest, 256); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { img::colorspace_conversion(img::kI420, img::kRGB24, 4, 3, source, 18, dest, 256); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { img::colorspace_conversion(img::kNV12, img::kGrey, 4, 4, source, 23, dest, 256); t.fail(); }
+    catch (img::eColorspaceConversionError& e) { }
+    try { img::colorspace_conversion(img::kRGB24, img::kNV12, 4, 4, source, 45, dest, 256); t.fail(); }
+    catch (img::eColorspaceConversionError& e) { }
+    try { img::colorspace_conversion(img::kRGB24, img::kI420, 4, 4, source, 48, dest, 23); t.fail(); }
+    catch (eBufferOverflow& e) { }
+    try { img::getBPP(img::kNV12); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    t.iseq(img::getBufSize(img::kI420, 6, 4), (u32)36);
+    t.iseq(img::getBufSize(img::kRGBPlanar, 6, 4), (u32)72);
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("Levels agree test", levelsAgreeTest, 50);
+    tTest("YUYV exhaustive test", yuyvExhaustiveTest);
+    tTest("Matches floating point test", matchesFloatingPointTest, 20);
+    tTest("Round trip test", roundTripTest, 20);
+    tTest("Planar test", planarTest, 20);
+    tTest("Bad sizes test", badSizesTest);
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include <rho/img/tGradient.h>
+#include <rho/img/tImage.h>
+#include <rho/sync/tThreadPool.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+#include <rho/algo/tLCG.h>
+
+#include "testImages.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+
+using namespace rho;
+
+
+static const img::nImageFormat kFormats[] = { img::kRGB24, img::kRGBA, img::kGrey };
+
+
+static
+void s_randomImage(algo::iLCG& lcg, img::tImage* image)
+{
+    randomImage(lcg, (lcg.next() % 100) + 3, (lcg.next() % 60) + 3, kFormats[lcg.next() % 3], image);
+
+    // Sometimes only 0s and 255s, for the biggest gradients there are.
+    if (lcg.next() % 4 == 0)
+        for (u32 i = 0; i < image->bufUsed(); i++)
+            image->buf()[i] = (u8)((image->buf()[i] % 2) * 255);
+}
+
+
+/*
+ * The gradient at output (col, row, k), the slow way.
+ */
+static
+void s_reference(const img::tImage& image, img::nGradientOperator op, u32 col, u32 row, u32 k,
+                 i32* gx, i32* gy)
+{
+    i32 side = (op == img::kGradientScharr) ? 3 : 1;
+    i32 middle = (op == img::kGradientScharr) ? 10 : 2;
+    i32 a = image[row+0][col+0][k], b = image[row+0][col+1][k], c = image[row+0][col+2][k];
+    i32 d = image[row+1][col+0][k],                             f = image[row+1][col+2][k];
+    i32 g = image[row+2][col+0][k], h = image[row+2][col+1][k], i = image[row+2][col+2][k];
+    *gx = side*(a + g - c - i) + middle*(d - f);
+    *gy = side*(a + c - g - i) + middle*(b - h);
+}
+
+static
+u8 s_referenceDirection(i32 gx, i32 gy)
+{
+    // The line the gradient lies along, folded into [0, 180) degrees,
+    // with y down. (The boundaries are at 22.5 + 45n, to within the
+    // rounding of the tangents the kernels use.)
+    f64 angle = std::atan2((f64)gy, (f64)gx) * 180.0 / M_PI;
+    if (angle < 0.0)
+        angle += 180.0;
+    if (angle >= 180.0)
+        angle -= 180.0;
+    if (angle < 22.5 || angle > 157.5)
+        return img::kGradientHorizontal;
+    if (angle < 67.5)
+        return img::kGradientDiagonalDown;
+    if (angle <= 112.5)
+        return img::kGradientVertical;
+    return img::kGradientDiagonalUp;
+}
+
+
+void referenceTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage image;
+    s_randomImage(lcg, &image);
+    img::nGradientOperator op = (img::nGradientOperator)(lcg.next() % 2);
+    img::nGradientNorm norm = (img::nGradientNorm)(lcg.next() % 2);
+    u32 bpp = img::getBPP(image.format());
+
+    img::tGradient gradient(op, norm, true);
+    gradient.compute(&image);
+    t.iseq(gradient.width(), image.width() - 2);
+    t.iseq(gradient.height(), image.height() - 2);
+    t.iseq(gradient.channels(), bpp);
+
+    const u16* magnitude = gradient.magnitude();
+    const u8* orientation = gradient.orientation();
+    for (u32 row = 0; row < gradient.height(); row++)
+    {
+        for (u32 col = 0; col < gradient.width(); col++)
+        {
+            for (u32 k = 0; k < bpp; k++)
+            {
+                i32 gx, gy;
+                s_reference(image, op, col, row, k, &gx, &gy);
+                size_t i = ((size_t)row * gradient.width() + col) * bpp + k;
+
+                u32 expected = (norm == img::kGradientL2)
+                        ? (u32) round(std::sqrt((f64)(gx*gx + gy*gy)))
+                        : (u32) (std::abs(gx) + std::abs(gy));
+                t.iseq(magnitude[i], expected);
+                t.assert(magnitude[i] <= gradient.maxMagnitude());
+
+                // Away from the boundaries, the direction is exact.
+                f64 angle = std::atan2((f64)std::abs(gy), (f64)std::abs(gx)) * 180.0 / M_PI;
+                if (std::fabs(angle - 22.5) > 0.1 && std::fabs(angle - 67.5) > 0.1)
+                    t.iseq(orientation[i], s_referenceDirection(gx, gy));
+                t.assert(orientation[i] <= img::kGradientDiagonalUp);
+            }
+        }
+    }
+}
+
+
+void levelsAndPoolTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage image;
+    s_randomImage(lcg, &image);
+    img::nGradientOperator op = (img::nGradientOperator)(lcg.next() % 2);
+    img::nGradientNorm norm = (img::nGradientNorm)(lcg.next() % 2);
+    size_t size = (size_t)(image.width()-2) * (image.height()-2) * img::getBPP(image.format());
+
+    img::tGradient expected(op, norm, true, kSimdNone);
+    expected.compute(&image);
+
+    for (i32 level = kSimdNone; level <= getSimdLevel(); level++)
+    {
+        img::tGradient gradient(op, norm, true, (nSimdLevel)level);
+        gradient.compute(&image);
+        t.assert(memcmp(gradient.magnitude(), expected.magnitude(), size * sizeof(u16)) == 0);
+        t.assert(memcmp(gradient.orientation(), expected.orientation(), size) == 0);
+
+        gradient.compute(&image, pool);
+        t.assert(memcmp(gradient.magnitude(), expected.magnitude(), size * sizeof(u16)) == 0);
+        t.assert(memcmp(gradient.orientation(), expected.orientation(), size) == 0);
+
+        // Without the orientation plane, the magnitudes are the same.
+        img::tGradient magOnly(op, norm, false, (nSimdLevel)level);
+        magOnly.compute(&image, pool);
+        t.assert(magOnly.orientation() == NULL);
+        t.assert(memcmp(magOnly.magnitude(), expected.magnitude(), size * sizeof(u16)) == 0);
+    }
+}
+
+
+void maxMagnitudeTest(const tTest& t)
+{
+    // A step from 0 to 255 along both axes at once reaches the maximum.
+    img::tImage image(3*3);
+    image.setBufUsed(3*3);
+    image.setWidth(3);
+    image.setHeight(3);
+    image.setFormat(img::kGrey);
+    u8 pixels[9] = { 255, 255, 0,
+                     255,   0, 0,
+                       0,   0, 0 };
+    memcpy(image.buf(), pixels, 9);
+
+    for (i32 op = 0; op < img::kMaxGradientOperator; op++)
+    {
+        for (i32 norm = 0; norm < img::kMaxGradientNorm; norm++)
+        {
+            // The corner pixels can't both be at their extremes at once.
+            img::tGradient gradient((img::nGradientOperator)op, (img::nGradientNorm)norm, true);
+            gradient.compute(&image);
+            t.assert(gradient.magnitude()[0] <= gradient.maxMagnitude());
+            t.iseq(gradient.orientation()[0], (u8)img::kGradientDiagonalDown);
+        }
+    }
+
+    img::tGradient sobel(img::kGradientSobel, img::kGradientL2, false);
+    t.iseq(sobel.maxMagnitude(), (u16)1442);
+    img::tGradient scharr(img::kGradientScharr, img::kGradientL1, false);
+    t.iseq(scharr.maxMagnitude(), (u16)8160);
+}
+
+
+void badArgsTest(const tTest& t)
+{
+    try { img::tGradient g((img::nGradientOperator)2, img::kGradientL2, false); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { img::tGradient g(img::kGradientSobel, (img::nGradientNorm)-1, false); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    img::tImage image(2*5);
+    image.setBufUsed(2*5);
+    image.setWidth(2);
+    image.setHeight(5);
+    image.setFormat(img::kGrey);
+    img::tGradient gradient(img::kGradientSobel, img::kGradientL2, false);
+    try { gradient.compute(&image); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    image.setWidth(5);
+    image.setHeight(5);
+    try { gradient.compute(&image); t.fail(); }
+    catch (eLogicError& e) { }
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("Reference test", referenceTest, 50);
+    tTest("SIMD levels and pool test", levelsAndPoolTest, 50);
+    tTest("Max magnitude test", maxMagnitudeTest, 1);
+    tTest("Bad args test", badArgsTest, 1);
+
+    return 0;
+}
@@ -0,0 +1,675 @@
+#include <rho/img/tImage.h>
+#include <rho/img/tGradient.h>
+#include <rho/img/tImageView.h>
+#include <rho/iReadable.h>
+#include <rho/iWritable.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+#include <rho/algo/tLCG.h>
+#include "testImages.h"
+#include <rho/sync/tThreadPool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+
+using namespace rho;
+
+
+#if __linux__ || __APPLE__ || __CYGWIN__
+std::string gFilePath = "/tmp/packedimages.bin";
+#elif __MINGW32__
+std::string gFilePath = "C:\\packedimages.bin";
+#else
+#error What platform are you on!?
+#endif
+
+
+static
+void s_randomImage(algo::iLCG& lcg, img::tImage* image)
+{
+    u32 width = (lcg.next() % 500) + 1;
+    u32 height = (lcg.next() % 500) + 1;
+    randomImage(lcg, width, height, img::kRGB24, image);
+}
+
+
+void packUnpackTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig;
+    s_randomImage(lcg, &orig);
+
+    tByteWritable out;
+    orig.pack(&out);
+    tByteReadable in(out.getBuf());
+    img::tImage copy;
+    copy.unpack(&in);
+    t.assert(sameImage(orig, copy));
+}
+
+
+void unpackViewTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig1, orig2;
+    s_randomImage(lcg, &orig1);
+    s_randomImage(lcg, &orig2);
+    {
+        tFileWritable file(gFilePath);
+        orig1.pack(&file);
+        orig2.pack(&file);
+    }
+
+    tMmapReadable file(gFilePath);
+    img::tImage view1, view2;
+    view1.unpackView(&file);
+    view2.unpackView(&file);
+    t.assert(sameImage(orig1, view1));
+    t.assert(sameImage(orig2, view2));
+
+    // The views point into the mapping...
+    t.assert(view1.buf() == view2.buf() - view1.bufUsed() - 4*4);
+
+    // ...but writing to them is fine, and so is giving them their own
+    // buffer back.
+    view1.buf()[0] = (u8)(view1.buf()[0] + 1);
+    view2.copyTo(&view1);
+    t.assert(sameImage(orig2, view1));
+
+    // A truncated image leaves the image empty.
+    file.setPosition(file.getSize() - 10);
+    try { view2.unpackView(&file); t.fail(); }
+    catch (eBufferUnderflow& e) { }
+    t.iseq(view2.bufUsed(), (u32)0);
+}
+
+
+/*
+ * Small enough for the slow filters, and sometimes with fewer rows than
+ * the pool has bands.
+ */
+static
+void s_smallImage(algo::iLCG& lcg, img::nImageFormat format, img::tImage* image)
+{
+    u32 width = (lcg.next() % 120) + 3;
+    u32 height = (lcg.next() % 4 == 0) ? (lcg.next() % 6) + 3 : (lcg.next() % 120) + 3;
+    if (format == img::kYUYV)
+        width += width % 2;
+    randomImage(lcg, width, height, format, image);
+}
+
+
+static const img::nImageFormat kFormats[] = { img::kRGB24, img::kRGBA, img::kGrey };
+
+
+void parallelFiltersTest(const tTest& t)
+{
+    static sync::tThreadPool pool(4);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig;
+    s_smallImage(lcg, kFormats[lcg.next() % 3], &orig);
+
+    img::tImage serial, parallel;
+
+    orig.medianFilter(&serial, 5, 3);
+    orig.medianFilter(&parallel, 5, 3, pool);
+    t.assert(sameImage(serial, parallel));
+
+    orig.sobel(&serial, 200);
+    orig.sobel(&parallel, 200, pool);
+    t.assert(sameImage(serial, parallel));
+
+    u32 width = (lcg.next() % 200) + 1;
+    u32 height = (lcg.next() % 200) + 1;
+    orig.scale(width, height, &serial);
+    orig.scale(width, height, &parallel, pool);
+    t.assert(sameImage(serial, parallel));
+
+    double angle = (lcg.next() % 3600) / 10.0;
+    orig.rotate(angle, &serial);
+    orig.rotate(angle, &parallel, pool);
+    t.assert(sameImage(serial, parallel));
+}
+
+
+void parallelRotateTest(const tTest& t)
+{
+    static sync::tThreadPool pool(4);
+
+    // The level and nearly-level cases take a different path through
+    // the band code.
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig;
+    s_smallImage(lcg, kFormats[lcg.next() % 3], &orig);
+
+    double angles[] = { 0.0, 90.0, 180.0, 270.0, 360.0, 0.001, -0.001, 45.0, -135.0 };
+    for (size_t i = 0; i < sizeof(angles)/sizeof(angles[0]); i++)
+    {
+        img::tImage serial, parallel;
+        orig.rotate(angles[i], &serial);
+        orig.rotate(angles[i], &parallel, pool);
+        t.assert(sameImage(serial, parallel));
+    }
+}
+
+
+/*
+ * The median filter written the obvious way.
+ */
+static
+void s_sortMedian(const img::tImage& orig, u32 windowWidth, u32 windowHeight, img::tImage* dest)
+{
+    orig.copyTo(dest);
+    u32 bpp = img::getBPP(orig.format());
+    i32 hw = (i32)windowWidth / 2;
+    i32 hh = (i32)windowHeight / 2;
+    for (i32 row = 0; row < (i32)orig.height(); row++)
+    {
+        for (i32 col = 0; col < (i32)orig.width(); col++)
+        {
+            for (u32 k = 0; k < bpp; k++)
+            {
+                std::vector<u32> arr;
+                for (i32 r = row-hh; r <= row+hh; r++)
+                    for (i32 c = col-hw; c <= col+hw; c++)
+                        if (r >= 0 && r < (i32)orig.height() && c >= 0 && c < (i32)orig.width())
+                            arr.push_back(orig[r][c][k]);
+                std::sort(arr.begin(), arr.end());
+                u32 n = (u32)arr.size();
+                (*dest)[row][col][k] = (u8)((arr[(n-1)/2] + arr[n/2]) / 2);
+            }
+        }
+    }
+}
+
+
+void medianFilterTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig;
+    s_smallImage(lcg, kFormats[lcg.next() % 3], &orig);
+
+    // Mostly flat images give lots of ties.
+    if (lcg.next() % 2)
+        for (u32 i = 0; i < orig.bufUsed(); i++)
+            orig.buf()[i] = (u8)(orig.buf()[i] / 64 * 64);
+
+    // Small windows are sorted, big ones use histograms; some are
+    // bigger than the image.
+    u32 windowWidth = (lcg.next() % 20) * 2 + 1;
+    u32 windowHeight = (lcg.next() % 20) * 2 + 1;
+    if (lcg.next() % 4 == 0)
+    {
+        windowWidth = 1;
+        windowHeight = 3;
+    }
+
+    img::tImage expected, result;
+    s_sortMedian(orig, windowWidth, windowHeight, &expected);
+    orig.medianFilter(&result, windowWidth, windowHeight);
+    t.assert(sameImage(expected, result));
+    orig.medianFilter(&result, windowWidth, windowHeight, pool);
+    t.assert(sameImage(expected, result));
+
+    try { orig.medianFilter(&result, windowWidth+1, windowHeight); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+void parallelThresholdTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::nImageFormat formats[] = { img::kRGB24, img::kRGBA, img::kBGRA, img::kYUYV, img::kGrey };
+    img::tImage orig;
+    s_smallImage(lcg, formats[lcg.next() % 5], &orig);
+
+    img::tImage serial, parallel;
+    orig.adaptiveThreshold(&serial, -1, 5, 127);
+    orig.adaptiveThreshold(&parallel, -1, 5, 127, pool);
+    t.assert(sameImage(serial, parallel));
+
+    // Errors come out on the calling thread.
+    orig.setFormat(img::kRGB16);
+    orig.setWidth(orig.bufUsed() / 2 / orig.height());
+    orig.setBufUsed(orig.width() * orig.height() * 2);
+    try { orig.adaptiveThreshold(&parallel, -1, 5, 127, pool); t.fail(); }
+    catch (eNotImplemented& e) { }
+    try { orig.adaptiveThreshold(&orig, -1, 5, 127, pool); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+/*
+ * The sum and sum of squares of channel k over the clipped window, the
+ * slow way.
+ */
+static
+u32 s_windowSums(const img::tImage& orig, u32 row, u32 col, u32 k,
+                 u32 windowWidth, u32 windowHeight, u64* sumSq)
+{
+    u32 minr = (row > windowHeight/2) ? (row - windowHeight/2) : 0;
+    u32 maxr = std::min(row + windowHeight/2, orig.height() - 1);
+    u32 minc = (col > windowWidth/2) ? (col - windowWidth/2) : 0;
+    u32 maxc = std::min(col + windowWidth/2, orig.width() - 1);
+    u32 sum = 0;
+    *sumSq = 0;
+    for (u32 r = minr; r <= maxr; r++)
+    {
+        for (u32 c = minc; c <= maxc; c++)
+        {
+            u32 val = orig[r][c][k];
+            sum += val;
+            *sumSq += val * val;
+        }
+    }
+    return sum;
+}
+
+static
+u32 s_windowArea(const img::tImage& orig, u32 row, u32 col, u32 windowWidth, u32 windowHeight)
+{
+    u32 minr = (row > windowHeight/2) ? (row - windowHeight/2) : 0;
+    u32 maxr = std::min(row + windowHeight/2, orig.height() - 1);
+    u32 minc = (col > windowWidth/2) ? (col - windowWidth/2) : 0;
+    u32 maxc = std::min(col + windowWidth/2, orig.width() - 1);
+    return (maxr - minr + 1) * (maxc - minc + 1);
+}
+
+
+void windowFiltersTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::nImageFormat formats[] = { img::kRGB24, img::kRGBA, img::kBGRA, img::kGrey };
+    img::tImage orig;
+    s_smallImage(lcg, formats[lcg.next() % 4], &orig);
+
+    u32 windowWidth = (lcg.next() % 20) * 2 + 1;
+    u32 windowHeight = (lcg.next() % 20) * 2 + 1;
+    u32 bpp = img::getBPP(orig.format());
+
+    img::tImage mean, stdDev;
+    mean.setBufSize(orig.bufUsed());
+    mean.setBufUsed(orig.bufUsed());
+    mean.setWidth(orig.width());
+    mean.setHeight(orig.height());
+    mean.setFormat(orig.format());
+    stdDev.setBufSize(orig.bufUsed());
+    stdDev.setBufUsed(orig.bufUsed());
+    stdDev.setWidth(orig.width());
+    stdDev.setHeight(orig.height());
+    stdDev.setFormat(orig.format());
+    for (u32 r = 0; r < orig.height(); r++)
+    {
+        for (u32 c = 0; c < orig.width(); c++)
+        {
+            u32 area = s_windowArea(orig, r, c, windowWidth, windowHeight);
+            for (u32 k = 0; k < bpp; k++)
+            {
+                u64 sumSq;
+                u32 sum = s_windowSums(orig, r, c, k, windowWidth, windowHeight, &sumSq);
+                mean[r][c][k] = (u8)((sum + area/2) / area);
+                f64 variance = ((f64)sumSq - (f64)sum * sum / area) / area;
+                f64 expected = std::sqrt(std::max(variance, 0.0));
+                stdDev[r][c][k] = (u8)std::floor(expected + 0.5);
+            }
+        }
+    }
+
+    img::tImage result;
+    orig.boxBlur(&result, windowWidth, windowHeight);
+    t.assert(sameImage(mean, result));
+    orig.boxBlur(&result, windowWidth, windowHeight, pool);
+    t.assert(sameImage(mean, result));
+
+    orig.localStdDev(&result, windowWidth, windowHeight, pool);
+    t.assert(result.bufUsed() == stdDev.bufUsed());
+    for (u32 i = 0; i < result.bufUsed(); i++)
+        t.assert(std::abs((i32)result.buf()[i] - (i32)stdDev.buf()[i]) <= 1);
+    img::tImage serial;
+    orig.localStdDev(&serial, windowWidth, windowHeight);
+    t.assert(sameImage(serial, result));
+
+    // In place.
+    orig.boxBlur(&orig, windowWidth, windowHeight);
+    t.assert(sameImage(mean, orig));
+
+    try { orig.boxBlur(&result, windowWidth+1, windowHeight); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+void bradleyThresholdTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::nImageFormat formats[] = { img::kRGB24, img::kRGBA, img::kBGRA, img::kYUYV, img::kGrey };
+    img::tImage orig;
+    s_smallImage(lcg, formats[lcg.next() % 5], &orig);
+
+    u32 windowSize = (lcg.next() % 20) * 2 + 1;
+    u32 percent = lcg.next() % 30;
+
+    img::tImage grey, expected;
+    orig.convertToFormat(img::kGrey, &grey);
+    grey.copyTo(&expected);
+    for (u32 r = 0; r < grey.height(); r++)
+    {
+        for (u32 c = 0; c < grey.width(); c++)
+        {
+            u64 sumSq;
+            u32 sum = s_windowSums(grey, r, c, 0, windowSize, windowSize, &sumSq);
+            u32 area = s_windowArea(grey, r, c, windowSize, windowSize);
+            bool black = (u64)grey[r][c][0] * area * 100 <= (u64)sum * (100 - percent);
+            expected[r][c][0] = black ? 0 : 255;
+        }
+    }
+
+    img::tImage result;
+    orig.bradleyThreshold(&result, windowSize, percent);
+    t.assert(sameImage(expected, result));
+    orig.bradleyThreshold(&result, windowSize, percent, pool);
+    t.assert(sameImage(expected, result));
+
+    try { orig.bradleyThreshold(&result, windowSize+1, percent); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { orig.bradleyThreshold(&result, windowSize, 101, pool); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+/*
+ * A grey image of a few filled discs (some darker, some lighter than the
+ * background), each in its own slot across the image.
+ */
+static
+void s_discImage(algo::iLCG& lcg, u32 width, u32 height,
+                 std::vector<img::tImage::tHoughCircle>* discs, img::tImage* image)
+{
+    image->setBufSize(width*height);
+    image->setBufUsed(width*height);
+    image->setWidth(width);
+    image->setHeight(height);
+    image->setFormat(img::kGrey);
+    memset(image->buf(), 128, width*height);
+
+    discs->clear();
+    u32 numDiscs = (lcg.next() % 3) + 1;
+    u32 slotWidth = width / numDiscs;
+    for (u32 n = 0; n < numDiscs; n++)
+    {
+        u32 r = (lcg.next() % 10) + 8;
+        u32 x = n * slotWidth + (lcg.next() % (slotWidth - 2*r - 4)) + r + 2;
+        u32 y = (lcg.next() % (height - 2*r - 4)) + r + 2;
+        u8 shade = (lcg.next() % 2) ? 255 : 0;
+        for (u32 row = y - r; row <= y + r; row++)
+            for (u32 col = x - r; col <= x + r; col++)
+                if ((col-x)*(col-x) + (row-y)*(row-y) <= r*r)
+                    (*image)[row][col][0] = shade;
+        discs->push_back(img::tImage::tHoughCircle(x, y, r, 0, 0));
+    }
+}
+
+
+void houghGradientTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage image;
+    std::vector<img::tImage::tHoughCircle> discs;
+    s_discImage(lcg, 120, 100, &discs, &image);
+
+    u32 thresh = 20;
+    std::vector< std::vector<u32> > accum, poolAccum;
+    std::vector<img::tImage::tHoughCircle> circles =
+        image.houghCirclesGradient(accum, 0, 119, 1, 0, 99, 1, 5, 20, 1, thresh, 255);
+    std::vector<img::tImage::tHoughCircle> poolCircles =
+        image.houghCirclesGradient(poolAccum, 0, 119, 1, 0, 99, 1, 5, 20, 1, thresh, 255, pool);
+
+    t.assert(accum == poolAccum);
+    t.iseq(circles.size(), poolCircles.size());
+    for (size_t i = 0; i < circles.size() && i < poolCircles.size(); i++)
+    {
+        t.iseq(circles[i].x, poolCircles[i].x);
+        t.iseq(circles[i].y, poolCircles[i].y);
+        t.iseq(circles[i].r, poolCircles[i].r);
+        t.iseq(circles[i].v, poolCircles[i].v);
+    }
+    t.iseq(accum.size(), (size_t)100);
+    t.iseq(accum[0].size(), (size_t)120);
+
+    // Every disc is found, within a pixel, with plenty of votes.
+    for (size_t n = 0; n < discs.size(); n++)
+    {
+        bool found = false;
+        for (size_t i = 0; i < circles.size(); i++)
+        {
+            if (std::abs((i32)circles[i].x - (i32)discs[n].x) <= 1 &&
+                std::abs((i32)circles[i].y - (i32)discs[n].y) <= 1 &&
+                std::abs((i32)circles[i].r - (i32)discs[n].r) <= 1 &&
+                circles[i].v >= 2 * discs[n].r)
+            {
+                found = true;
+            }
+        }
+        t.assert(found);
+    }
+    t.assert(circles.size() > 0);
+    t.assert(circles[0].v >= 2 * 8);
+
+    // Strongest first.
+    for (size_t i = 1; i < circles.size(); i++)
+        t.assert(circles[i-1].v >= circles[i].v);
+
+    // A coarser grid still sees the discs.
+    std::vector<img::tImage::tHoughCircle> coarse =
+        image.houghCirclesGradient(accum, 1, 119, 2, 1, 99, 2, 5, 20, 3, thresh, 255, pool);
+    t.assert(coarse.size() > 0);
+    t.iseq(accum.size(), (size_t)50);
+    t.iseq(accum[0].size(), (size_t)60);
+
+    try { image.houghCirclesGradient(accum, 0, 119, 1, 0, 99, 1, 5, 20, 1, 0, 255); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { image.houghCirclesGradient(accum, 0, 120, 1, 0, 99, 1, 5, 20, 1, thresh, 255); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { image.houghCirclesGradient(accum, 0, 119, 1, 0, 99, 1, 5, 20, 1, thresh, 0, pool); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+/*
+ * sobel() as it was before it used tGradient, with its u32 arithmetic.
+ */
+static
+void s_oldSobel(const img::tImage& orig, u32 clipAtValue, img::tImage* edges)
+{
+    u32 bpp = img::getBPP(orig.format());
+    edges->setFormat(orig.format());
+    edges->setWidth(orig.width() - 2);
+    edges->setHeight(orig.height() - 2);
+    edges->setBufSize(edges->width() * edges->height() * bpp);
+    edges->setBufUsed(edges->bufSize());
+    for (u32 row = 0; row < edges->height(); row++)
+    {
+        for (u32 col = 0; col < edges->width(); col++)
+        {
+            for (u32 k = 0; k < bpp; k++)
+            {
+                u32 a = orig[row+0][col+0][k], b = orig[row+0][col+1][k], c = orig[row+0][col+2][k];
+                u32 d = orig[row+1][col+0][k],                            f = orig[row+1][col+2][k];
+                u32 g = orig[row+2][col+0][k], h = orig[row+2][col+1][k], i = orig[row+2][col+2][k];
+                u32 gx = 1*a + 2*d + 1*g - 1*c - 2*f - 1*i;
+                u32 gy = 1*a + 2*b + 1*c - 1*g - 2*h - 1*i;
+                u32 grad = (u32) round(std::sqrt((f64)(gx*gx + gy*gy)));
+                if (grad > clipAtValue) grad = clipAtValue;
+                if (clipAtValue != 255)
+                    grad = grad * 255 / clipAtValue;
+                (*edges)[row][col][k] = (u8) grad;
+            }
+        }
+    }
+}
+
+
+void sobelTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig;
+    s_smallImage(lcg, kFormats[lcg.next() % 3], &orig);
+    if (lcg.next() % 4 == 0)
+    {
+        for (u32 i = 0; i < orig.bufUsed(); i++)
+            orig.buf()[i] = (u8)((lcg.next() % 2) * 255);
+    }
+
+    static const u32 kClips[] = { 1, 100, 255, 256, 1000, 1442, 5000 };
+    u32 clipAtValue = kClips[lcg.next() % 7];
+
+    img::tImage expected, serial, parallel;
+    s_oldSobel(orig, clipAtValue, &expected);
+    orig.sobel(&serial, clipAtValue);
+    orig.sobel(&parallel, clipAtValue, pool);
+    t.assert(sameImage(expected, serial));
+    t.assert(sameImage(expected, parallel));
+
+    try { orig.sobel(&serial, 0); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+void cannyTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig, serial, parallel;
+    s_smallImage(lcg, kFormats[lcg.next() % 3], &orig);
+    u32 low = lcg.next() % 400;
+    u32 high = low + lcg.next() % 400;
+    orig.canny(&serial, low, high);
+    orig.canny(&parallel, low, high, pool);
+    t.assert(sameImage(serial, parallel));
+    t.iseq(serial.width(), orig.width() - 2);
+    t.iseq(serial.height(), orig.height() - 2);
+    for (u32 i = 0; i < serial.bufUsed(); i++)
+        t.assert(serial.buf()[i] == 0 || serial.buf()[i] == 255);
+
+    // Nothing below the low threshold is an edge.
+    img::tGradient gradient(img::kGradientSobel, img::kGradientL2, false);
+    gradient.compute(&orig);
+    for (u32 i = 0; i < serial.bufUsed(); i++)
+        t.assert(serial.buf()[i] == 0 || gradient.magnitude()[i] >= low);
+
+    // A filled disc gives a closed ring one pixel thick.
+    std::vector<img::tImage::tHoughCircle> discs;
+    s_discImage(lcg, 120, 100, &discs, &orig);
+    orig.canny(&serial, 100, 300, pool);
+    for (size_t n = 0; n < discs.size(); n++)
+    {
+        // Along each row through the middle of the disc (in the edge
+        // image's coordinates, one pixel in), one or two edge pixels
+        // each side.
+        i32 cx = (i32)discs[n].x - 1;
+        i32 cy = (i32)discs[n].y - 1;
+        i32 r = (i32)discs[n].r;
+        for (i32 row = cy - r/3; row <= cy + r/3; row++)
+        {
+            u32 left = 0, right = 0;
+            for (i32 col = cx - r - 2; col < cx; col++)
+                left += serial[row][col][0] ? 1 : 0;
+            for (i32 col = cx; col <= cx + r + 2; col++)
+                right += serial[row][col][0] ? 1 : 0;
+            t.assert(left >= 1 && left <= 2);
+            t.assert(right >= 1 && right <= 2);
+        }
+        t.assert(serial[cy][cx][0] == 0);
+    }
+
+    try { orig.canny(&serial, 200, 100); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+void lumaViewTest(const tTest& t)
+{
+    static sync::tThreadPool pool(2);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage rgb;
+    s_smallImage(lcg, img::kRGB24, &rgb);
+    rgb.setWidth(rgb.width() & ~1u);
+    rgb.setHeight(rgb.height() & ~1u);
+    rgb.setBufUsed(rgb.width() * rgb.height() * 3);
+
+    img::tImage i420, nv12, grey;
+    rgb.convertToFormat(img::kI420, &i420);
+    rgb.convertToFormat(img::kNV12, &nv12);
+    t.iseq(i420.bufUsed(), img::getBufSize(img::kI420, rgb.width(), rgb.height()));
+    t.iseq(i420.width(), rgb.width());
+
+    // The view is the luma plane, in place.
+    img::tImageView view = i420.viewLumaAsGrey();
+    t.assert(view.buf() == i420.buf());
+    t.iseq(view.format(), img::kGrey);
+    t.iseq(view.width(), rgb.width());
+    t.iseq(view.height(), rgb.height());
+    t.assert(view.isContiguous());
+    i420.convertToFormat(img::kGrey, &grey);
+    img::tImage copy;
+    view.copyTo(&copy);
+    t.assert(sameImage(copy, grey));
+    nv12.viewLumaAsGrey().copyTo(&copy);
+    t.assert(sameImage(copy, grey));
+
+    // The pooled conversion to grey (here, inside adaptiveThreshold())
+    // handles the planar formats too.
+    img::tImage fromPlanar, fromGrey;
+    i420.adaptiveThreshold(&fromPlanar, 2, 5, 127, pool);
+    grey.adaptiveThreshold(&fromGrey, 2, 5, 127, pool);
+    t.assert(sameImage(fromPlanar, fromGrey));
+
+    // The filters take the view like any other.
+    img::tImage fromView;
+    view.sobel(&fromView, 255);
+    grey.sobel(&fromGrey);
+    t.assert(sameImage(fromView, fromGrey));
+
+    try { rgb.viewLumaAsGrey(); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("pack/unpack test", packUnpackTest, 20);
+    tTest("unpackView test", unpackViewTest, 20);
+    tTest("parallel filters test", parallelFiltersTest, 50);
+    tTest("parallel rotate test", parallelRotateTest, 20);
+    tTest("parallel threshold test", parallelThresholdTest, 50);
+    tTest("median filter test", medianFilterTest, 50);
+    tTest("window filters test", windowFiltersTest, 50);
+    tTest("bradley threshold test", bradleyThresholdTest, 50);
+    tTest("hough gradient test", houghGradientTest, 20);
+    tTest("sobel test", sobelTest, 50);
+    tTest("canny test", cannyTest, 50);
+    tTest("luma view test", lumaViewTest, 20);
+
+    return 0;
+}
@@ -0,0 +1,271 @@
+#include <rho/img/tImageView.h>
+#include <rho/img/ebImg.h>
+#include <rho/img/tImage.h>
+#include <rho/sync/tThreadPool.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+#include <rho/algo/tLCG.h>
+
+#include "testImages.h"
+
+#include <cstdlib>
+#include <cstring>
+
+
+using namespace rho;
+
+
+static const img::nImageFormat kFormats[] = { img::kRGB24, img::kRGBA, img::kGrey };
+
+
+static
+void s_randomImage(algo::iLCG& lcg, img::nImageFormat format, img::tImage* image)
+{
+    randomImage(lcg, (lcg.next() % 90) + 10, (lcg.next() % 60) + 10, format, image);
+}
+
+/*
+ * A rectangle of 'image' at least 3x3 and, when 'even', with an even
+ * width and height.
+ */
+static
+geo::tRect s_randomRect(algo::iLCG& lcg, const img::tImage& image, bool even)
+{
+    u32 width = 3 + lcg.next() % (image.width() - 3);
+    u32 height = 3 + lcg.next() % (image.height() - 3);
+    if (even)
+    {
+        width &= ~1u;
+        height &= ~1u;
+    }
+    u32 x = lcg.next() % (image.width() - width + 1);
+    u32 y = lcg.next() % (image.height() - height + 1);
+    return geo::tRect(x, y, width, height);
+}
+
+
+void cropTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage image;
+    s_randomImage(lcg, kFormats[lcg.next() % 3], &image);
+    u32 bpp = img::getBPP(image.format());
+
+    // Any rectangle, even one hanging off the image, is clipped the same
+    // way for copies and views.
+    geo::tRect rect((f64)(lcg.next() % 120) - 10.0, (f64)(lcg.next() % 80) - 10.0,
+                    (f64)(lcg.next() % 120), (f64)(lcg.next() % 80));
+    img::tImage copy;
+    image.crop(rect, &copy);
+    img::tImageView view;
+    image.crop(rect, &view);
+    t.iseq(view.width(), copy.width());
+    t.iseq(view.height(), copy.height());
+    t.iseq(view.format(), image.format());
+    t.iseq(view.stride(), image.width() * bpp);
+    t.assert(!view.looksInto(&copy));
+
+    img::tImage fromView;
+    view.copyTo(&fromView);
+    t.assert(sameImage(copy, fromView));
+    if (view.width() > 0 && view.height() > 0)
+    {
+        t.assert(view.looksInto(&image));
+        u32 row = lcg.next() % view.height();
+        u32 col = lcg.next() % view.width();
+        t.iseq(view[row][col][bpp-1], copy[row][col][bpp-1]);
+    }
+
+    // Views of views.
+    geo::tRect inner((f64)(lcg.next() % 40), (f64)(lcg.next() % 30),
+                     (f64)(lcg.next() % 40), (f64)(lcg.next() % 30));
+    img::tImage innerCopy;
+    copy.crop(inner, &innerCopy);
+    img::tImageView innerView;
+    view.crop(inner, &innerView);
+    innerView.copyTo(&fromView);
+    t.assert(sameImage(innerCopy, fromView));
+
+    // The whole image is a contiguous view.
+    img::tImageView whole(image);
+    t.assert(whole.isContiguous());
+    t.assert(whole.buf() == image.buf());
+    whole.copyTo(&fromView);
+    t.assert(sameImage(image, fromView));
+}
+
+
+void filtersTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage image;
+    s_randomImage(lcg, kFormats[lcg.next() % 3], &image);
+    geo::tRect rect = s_randomRect(lcg, image, false);
+
+    img::tImageView view;
+    image.crop(rect, &view);
+    img::tImage copy;
+    image.crop(rect, &copy);
+    t.assert(!view.isContiguous() || view.height() == 1 || view.width() == image.width());
+
+    img::tImage expected, actual;
+
+    copy.sobel(&expected, 255);
+    view.sobel(&actual, 255);
+    t.assert(sameImage(expected, actual));
+    view.sobel(&actual, 255, pool);
+    t.assert(sameImage(expected, actual));
+
+    u32 windowWidth = 2 * (lcg.next() % 4) + 1;
+    u32 windowHeight = 2 * (lcg.next() % 4) + 1;
+    copy.medianFilter(&expected, windowWidth, windowHeight);
+    view.medianFilter(&actual, windowWidth, windowHeight);
+    t.assert(sameImage(expected, actual));
+    view.medianFilter(&actual, windowWidth, windowHeight, pool);
+    t.assert(sameImage(expected, actual));
+
+    u32 width = (lcg.next() % 80) + 1;
+    u32 height = (lcg.next() % 80) + 1;
+    copy.scale(width, height, &expected);
+    view.scale(width, height, &actual);
+    t.assert(sameImage(expected, actual));
+    view.scale(width, height, &actual, pool);
+    t.assert(sameImage(expected, actual));
+
+    img::nScaleFilter filter = (img::nScaleFilter)(lcg.next() % img::kMaxScaleFilter);
+    copy.scale(width, height, filter, &expected);
+    view.scale(width, height, filter, &actual);
+    t.assert(sameImage(expected, actual));
+
+    i32 s = (i32)(lcg.next() % 20) + 2;
+    copy.adaptiveThreshold(&expected, s, 5, 127);
+    view.adaptiveThreshold(&actual, s, 5, 127);
+    t.assert(sameImage(expected, actual));
+    view.adaptiveThreshold(&actual, s, 5, 127, pool);
+    t.assert(sameImage(expected, actual));
+}
+
+
+void convertTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage image;
+    s_randomImage(lcg, kFormats[lcg.next() % 3], &image);
+
+    // Odd widths too, which can't be converted to YUYV a row at a time.
+    geo::tRect rect = s_randomRect(lcg, image, (lcg.next() % 2) == 0);
+    img::tImageView view;
+    image.crop(rect, &view);
+    img::tImage copy;
+    image.crop(rect, &copy);
+
+    const img::nImageFormat kTo[] = { img::kRGB24, img::kRGBA, img::kBGRA, img::kGrey,
+                                      img::kYUYV, img::kI420, img::kRGBPlanar };
+    for (size_t i = 0; i < sizeof(kTo) / sizeof(kTo[0]); i++)
+    {
+        if (kTo[i] == img::kI420 && (copy.width() % 2 || copy.height() % 2))
+            continue;
+        img::tImage expected, actual;
+        try
+        {
+            copy.convertToFormat(kTo[i], &expected);
+        }
+        catch (img::eColorspaceConversionError& e)
+        {
+            // An odd number of pixels can't be YUYV, from a copy or a view.
+            try { view.convertToFormat(kTo[i], &actual); t.fail(); }
+            catch (img::eColorspaceConversionError& e) { }
+            continue;
+        }
+        view.convertToFormat(kTo[i], &actual);
+        t.assert(sameImage(expected, actual));
+    }
+}
+
+
+void rawViewTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage image;
+    s_randomImage(lcg, img::kRGB24, &image);
+
+    // The same pixels, with padding at the end of each row.
+    u32 rowSize = image.width() * 3;
+    u32 stride = rowSize + 1 + lcg.next() % 64;
+    std::vector<u8> padded(stride * image.height(), 0xAB);
+    for (u32 row = 0; row < image.height(); row++)
+        memcpy(&padded[row * stride], image.buf() + row * rowSize, rowSize);
+
+    img::tImageView view(&padded[0], image.width(), image.height(), stride, img::kRGB24);
+    t.assert(!view.isContiguous());
+    t.iseq(view.bpp(), (u32)3);
+
+    img::tImage copy;
+    view.copyTo(&copy);
+    t.assert(sameImage(image, copy));
+
+    img::tImage expected, actual;
+    image.medianFilter(&expected, 3, 3);
+    view.medianFilter(&actual, 3, 3);
+    t.assert(sameImage(expected, actual));
+    image.convertToFormat(img::kGrey, &expected);
+    view.convertToFormat(img::kGrey, &actual);
+    t.assert(sameImage(expected, actual));
+}
+
+
+void badArgsTest(const tTest& t)
+{
+    img::tImage image(6*4*3);
+    image.setBufUsed(6*4*3);
+    image.setWidth(6);
+    image.setHeight(4);
+    image.setFormat(img::kRGB24);
+    memset(image.buf(), 0, image.bufUsed());
+
+    img::tImageView view;
+    image.crop(geo::tRect(1, 1, 4, 3), &view);
+
+    // Writing into the viewed image would free the pixels being read.
+    try { view.copyTo(&image); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { view.medianFilter(&image, 3, 3); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { view.scale(2, 2, &image); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { view.convertToFormat(img::kGrey, &image); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    try { img::tImageView v(image.buf(), 6, 4, 6*3-1, img::kRGB24); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { img::tImageView v(image.buf(), 6, 4, 6*3, img::kI420); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    img::tImage planar(6*4*3/2);
+    planar.setBufUsed(6*4*3/2);
+    planar.setWidth(6);
+    planar.setHeight(4);
+    planar.setFormat(img::kI420);
+    try { img::tImageView v(planar); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    image.setBufUsed(6*4*3 - 1);
+    try { img::tImageView v(image); t.fail(); }
+    catch (eLogicError& e) { }
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("Crop test", cropTest, 500);
+    tTest("Filters test", filtersTest, 100);
+    tTest("Convert test", convertTest, 100);
+    tTest("Raw view test", rawViewTest, 50);
+    tTest("Bad args test", badArgsTest, 1);
+
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <rho/img/tIntegralImage.h>
+#include <rho/img/tImage.h>
+#include <rho/sync/tThreadPool.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+#include <rho/algo/tLCG.h>
+
+#include "testImages.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+
+using namespace rho;
+
+
+static
+void s_randomImage(algo::iLCG& lcg, img::tImage* image)
+{
+    randomImage(lcg, (lcg.next() % 150) + 1, (lcg.next() % 150) + 1, randomFormat(lcg), image);
+
+    // Sometimes all 255s, the biggest sums there are.
+    if (lcg.next() % 4 == 0)
+        memset(image->buf(), 255, image->bufUsed());
+}
+
+
+static
+bool s_sameTables(const img::tIntegralImage& a, const img::tIntegralImage& b)
+{
+    size_t size = (size_t)(a.height()+1) * a.stride();
+    if (a.width() != b.width() || a.height() != b.height() || a.channels() != b.channels())
+        return false;
+    if (memcmp(a.sums(), b.sums(), size * sizeof(u32)) != 0)
+        return false;
+    if (a.hasSquares() != b.hasSquares())
+        return false;
+    return !a.hasSquares() || memcmp(a.squares(), b.squares(), size * sizeof(u64)) == 0;
+}
+
+
+void sumsTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage image;
+    s_randomImage(lcg, &image);
+    u32 bpp = img::getBPP(image.format());
+
+    img::tIntegralImage integral;
+    integral.build(&image, true);
+    t.iseq(integral.width(), image.width());
+    t.iseq(integral.height(), image.height());
+    t.iseq(integral.channels(), bpp);
+    t.assert(integral.hasSquares());
+
+    for (u32 i = 0; i < 20; i++)
+    {
+        u32 x0 = lcg.next() % (image.width() + 1);
+        u32 x1 = lcg.next() % (image.width() + 1);
+        u32 y0 = lcg.next() % (image.height() + 1);
+        u32 y1 = lcg.next() % (image.height() + 1);
+        if (x0 > x1) std::swap(x0, x1);
+        if (y0 > y1) std::swap(y0, y1);
+        u32 k = lcg.next() % bpp;
+
+        u32 sum = 0;
+        u64 sumSq = 0;
+        for (u32 y = y0; y < y1; y++)
+        {
+            for (u32 x = x0; x < x1; x++)
+            {
+                u32 val = image[y][x][k];
+                sum += val;
+                sumSq += val * val;
+            }
+        }
+        t.iseq(integral.sum(x0, y0, x1, y1, k), sum);
+        t.assert(integral.sumOfSquares(x0, y0, x1, y1, k) == sumSq);
+    }
+
+    // The whole image.
+    u32 total = 0;
+    for (u32 i = 0; i < image.bufUsed(); i += bpp)
+        total += image.buf()[i];
+    t.iseq(integral.sum(0, 0, image.width(), image.height(), 0), total);
+}
+
+
+void levelsAndPoolTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage image;
+    s_randomImage(lcg, &image);
+    bool withSquares = (lcg.next() % 2 == 0);
+
+    img::tIntegralImage expected(kSimdNone);
+    expected.build(&image, withSquares);
+    t.assert(expected.hasSquares() == withSquares);
+
+    for (i32 level = kSimdNone; level <= getSimdLevel(); level++)
+    {
+        img::tIntegralImage integral((nSimdLevel)level);
+        integral.build(&image, withSquares);
+        t.assert(s_sameTables(expected, integral));
+        integral.build(&image, withSquares, pool);
+        t.assert(s_sameTables(expected, integral));
+    }
+
+    // Building again over a bigger table doesn't leave anything behind.
+    img::tImage other;
+    s_randomImage(lcg, &other);
+    img::tIntegralImage reused, fresh;
+    reused.build(&image, true);
+    reused.build(&other, withSquares);
+    fresh.build(&other, withSquares);
+    t.assert(s_sameTables(fresh, reused));
+}
+
+
+void badArgsTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage image;
+    s_randomImage(lcg, &image);
+
+    img::tIntegralImage integral;
+    integral.build(&image, false);
+    try { integral.sumOfSquares(0, 0, 1, 1, 0); t.fail(); }
+    catch (eLogicError& e) { }
+    try { integral.sum(0, 0, image.width()+1, 1, 0); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { integral.sum(1, 0, 0, 1, 0); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { integral.sum(0, 0, 1, 1, integral.channels()); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    image.setFormat(img::kRGB16);
+    try { integral.build(&image, false); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("Sums test", sumsTest, 50);
+    tTest("SIMD levels and pool test", levelsAndPoolTest, 50);
+    tTest("Bad args test", badArgsTest, 10);
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <rho/img/tScaler.h>
+#include <rho/img/tImage.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+#include <rho/algo/tLCG.h>
+
+#include "testImages.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+
+using namespace rho;
+
+
+void levelsAgreeTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    u32 width = (lcg.next() % 150) + 1;
+    u32 height = (lcg.next() % 150) + 1;
+    u32 toWidth = (lcg.next() % 150) + 1;
+    u32 toHeight = (lcg.next() % 150) + 1;
+    img::nScaleFilter filter = (img::nScaleFilter)(lcg.next() % img::kMaxScaleFilter);
+
+    img::tImage orig;
+    randomImage(lcg, width, height, randomFormat(lcg), &orig);
+
+    img::tImage expected;
+    img::tScaler scalar(width, height, toWidth, toHeight, filter, kSimdNone);
+    scalar.scale(&orig, &expected);
+    t.iseq(expected.width(), toWidth);
+    t.iseq(expected.height(), toHeight);
+    t.iseq(expected.bufUsed(), toWidth * toHeight * img::getBPP(orig.format()));
+
+    for (i32 level = kSimdSSE2; level <= getSimdLevel(); level++)
+    {
+        img::tImage result;
+        img::tScaler scaler(width, height, toWidth, toHeight, filter, (nSimdLevel)level);
+        scaler.scale(&orig, &result);
+        if (!sameImage(expected, result))
+        {
+            std::cerr << width << "x" << height << " -> " << toWidth << "x" << toHeight
+                      << " filter " << filter << " differs at level "
+                      << simdLevelEnumToString((nSimdLevel)level) << std::endl;
+            t.fail();
+        }
+    }
+
+    // tImage::scale() is the same thing.
+    img::tImage result;
+    orig.scale(toWidth, toHeight, filter, &result);
+    t.assert(sameImage(expected, result));
+}
+
+
+void flatStaysFlatTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    u32 width = (lcg.next() % 100) + 1;
+    u32 height = (lcg.next() % 100) + 1;
+    u32 toWidth = (lcg.next() % 300) + 1;
+    u32 toHeight = (lcg.next() % 300) + 1;
+    u8 value = (u8)(lcg.next() % 256);
+
+    img::tImage orig;
+    randomImage(lcg, width, height, img::kGrey, &orig);
+    memset(orig.buf(), value, orig.bufUsed());
+
+    for (i32 f = 0; f < img::kMaxScaleFilter; f++)
+    {
+        img::tImage result;
+        img::tScaler scaler(width, height, toWidth, toHeight, (img::nScaleFilter)f);
+        scaler.scale(&orig, &result);
+        for (u32 i = 0; i < result.bufUsed(); i++)
+            t.assert(result.buf()[i] == value);
+    }
+}
+
+
+void sameSizeTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    u32 width = (lcg.next() % 100) + 1;
+    u32 height = (lcg.next() % 100) + 1;
+
+    img::tImage orig;
+    randomImage(lcg, width, height, randomFormat(lcg), &orig);
+
+    for (i32 f = 0; f < img::kMaxScaleFilter; f++)
+    {
+        img::tImage result;
+        img::tScaler scaler(width, height, width, height, (img::nScaleFilter)f);
+        scaler.scale(&orig, &result);
+        t.assert(sameImage(orig, result));
+    }
+}
+
+
+void boxHalvesTest(const tTest& t)
+{
+    // Each output pixel is (to within the rounding of each pass) the mean
+    // of a 2x2 block.
+    algo::tKnuthLCG lcg(rand());
+    u32 width = ((lcg.next() % 100) + 1) * 2;
+    u32 height = ((lcg.next() % 100) + 1) * 2;
+
+    img::tImage orig;
+    randomImage(lcg, width, height, img::kRGB24, &orig);
+
+    img::tImage result;
+    img::tScaler scaler(width, height, width/2, height/2, img::kScaleBox);
+    scaler.scale(&orig, &result);
+    for (u32 r = 0; r < height/2; r++)
+    {
+        for (u32 c = 0; c < width/2; c++)
+        {
+            for (u32 k = 0; k < 3; k++)
+            {
+                i32 sum = orig[2*r][2*c][k] + orig[2*r][2*c+1][k] +
+                          orig[2*r+1][2*c][k] + orig[2*r+1][2*c+1][k];
+                i32 diff = 4 * result[r][c][k] - sum;
+                t.assert(diff >= -4 && diff <= 4);
+            }
+        }
+    }
+}
+
+
+void reuseTest(const tTest& t)
+{
+    // One scaler, many frames.
+    algo::tKnuthLCG lcg(rand());
+    img::tScaler scaler(64, 48, 20, 15, img::kScaleLanczos3);
+    img::tImage result;
+    for (u32 i = 0; i < 5; i++)
+    {
+        img::tImage orig, expected;
+        randomImage(lcg, 64, 48, randomFormat(lcg), &orig);
+        scaler.scale(&orig, &result);
+        orig.scale(20, 15, img::kScaleLanczos3, &expected);
+        t.assert(sameImage(expected, result));
+    }
+}
+
+
+void badArgsTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig, result;
+    randomImage(lcg, 10, 10, img::kRGB24, &orig);
+
+    try { img::tScaler scaler(0, 10, 5, 5, img::kScaleBox); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { img::tScaler scaler(10, 10, 5, 0, img::kScaleBox); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { img::tScaler scaler(10, 10, 5, 5, img::kMaxScaleFilter); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    img::tScaler scaler(10, 11, 5, 5, img::kScaleBicubic);
+    try { scaler.scale(&orig, &result); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    img::tScaler square(10, 10, 5, 5, img::kScaleBicubic);
+    try { square.scale(&orig, &orig); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    orig.setFormat(img::kYUYV);
+    try { square.scale(&orig, &result); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("Levels agree test", levelsAgreeTest, 100);
+    tTest("Flat stays flat test", flatStaysFlatTest, 20);
+    tTest("Same size test", sameSizeTest, 20);
+    tTest("Box halves test", boxHalvesTest, 20);
+    tTest("Reuse test", reuseTest);
+    tTest("Bad args test", badArgsTest);
+
+    return 0;
+}
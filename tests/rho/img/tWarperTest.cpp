@@ -0,0 +1,186 @@
+#include <rho/img/tWarper.h>
+#include <rho/img/tImage.h>
+#include <rho/sync/tThreadPool.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+#include <rho/algo/tLCG.h>
+
+#include "testImages.h"
+
+#include <cstdlib>
+#include <cstring>
+
+
+using namespace rho;
+
+
+void identityTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig, result;
+    randomImage(lcg, (lcg.next() % 100) + 1, (lcg.next() % 100) + 1,
+                randomFormat(lcg), &orig);
+
+    orig.warp(geo::tTrans4::identity(), orig.width(), orig.height(), &result);
+    t.assert(sameImage(orig, result));
+}
+
+
+void translateTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig, result;
+    randomImage(lcg, (lcg.next() % 100) + 1, (lcg.next() % 100) + 1, img::kRGB24, &orig);
+
+    // Whole pixels move exactly, and what's uncovered is black.
+    i32 dx = (i32)(lcg.next() % 11) - 5;
+    i32 dy = (i32)(lcg.next() % 11) - 5;
+    orig.warp(geo::tTrans4::translate(dx, dy, 0.0), orig.width(), orig.height(), &result);
+    for (i32 r = 0; r < (i32)orig.height(); r++)
+    {
+        for (i32 c = 0; c < (i32)orig.width(); c++)
+        {
+            i32 sr = r - dy;
+            i32 sc = c - dx;
+            bool inside = sr >= 0 && sr < (i32)orig.height() && sc >= 0 && sc < (i32)orig.width();
+            for (u32 k = 0; k < 3; k++)
+                t.assert(result[r][c][k] == (inside ? orig[sr][sc][k] : 0));
+        }
+    }
+
+    // Half a pixel blends neighbours evenly.
+    orig.warp(geo::tTrans4::translate(-0.5, 0.0, 0.0), orig.width(), orig.height(), &result);
+    for (u32 r = 0; r < orig.height(); r++)
+        for (u32 c = 0; c + 1 < orig.width(); c++)
+            for (u32 k = 0; k < 3; k++)
+                t.assert(result[r][c][k] == (orig[r][c][k] + orig[r][c+1][k] + 1) / 2);
+}
+
+
+void rotate90Test(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig, result, expected;
+    randomImage(lcg, (lcg.next() % 100) + 1, (lcg.next() % 100) + 1,
+                randomFormat(lcg), &orig);
+
+    // x' = y, y' = (width-1) - x
+    geo::tTrans4 trans = geo::tTrans4::identity();
+    trans[0][0] = 0.0;  trans[0][1] = 1.0;  trans[0][3] = 0.0;
+    trans[1][0] = -1.0; trans[1][1] = 0.0;  trans[1][3] = orig.width() - 1.0;
+
+    orig.warp(trans, orig.height(), orig.width(), &result);
+    orig.rotate90CCW(1, &expected);
+    t.assert(sameImage(expected, result));
+}
+
+
+void cachedAndBandedTest(const tTest& t)
+{
+    static sync::tThreadPool pool(3);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig;
+    randomImage(lcg, (lcg.next() % 150) + 1, (lcg.next() % 150) + 1,
+                randomFormat(lcg), &orig);
+
+    f64 angle = (lcg.next() % 3600) / 10.0;
+    f64 zoom = ((lcg.next() % 30) + 5) / 10.0;
+    geo::tTrans4 trans = geo::tTrans4::translate(40.0, 30.0, 0.0) *
+                         geo::tTrans4::scale(zoom, zoom, 1.0) *
+                         geo::tTrans4::rotateZ(angle);
+    u32 width = (lcg.next() % 150) + 1;
+    u32 height = (lcg.next() % 150) + 1;
+
+    img::tWarper warper(orig.width(), orig.height(), width, height, trans);
+    img::tImage expected, result;
+    warper.warp(&orig, &expected);
+    t.iseq(expected.width(), width);
+    t.iseq(expected.height(), height);
+
+    warper.warp(&orig, &result, pool);
+    t.assert(sameImage(expected, result));
+
+    warper.cacheRemapTable();
+    warper.warp(&orig, &result);
+    t.assert(sameImage(expected, result));
+    warper.warp(&orig, &result, pool);
+    t.assert(sameImage(expected, result));
+
+    // The table is good for any format.
+    img::tImage other, otherExpected;
+    randomImage(lcg, orig.width(), orig.height(), randomFormat(lcg), &other);
+    warper.warp(&other, &result);
+    img::tWarper(other.width(), other.height(), width, height, trans).warp(&other, &otherExpected);
+    t.assert(sameImage(otherExpected, result));
+}
+
+
+void rotateBilinearTest(const tTest& t)
+{
+    static sync::tThreadPool pool(2);
+
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig;
+    randomImage(lcg, (lcg.next() % 150) + 8, (lcg.next() % 150) + 8, img::kRGBA, &orig);
+    f64 angle = (lcg.next() % 3600) / 10.0;
+
+    // Same canvas as the forward-mapping rotate().
+    img::tImage forward, result, banded;
+    orig.rotate(angle, &forward);
+    orig.rotateBilinear(angle, &result);
+    orig.rotateBilinear(angle, &banded, pool);
+    t.iseq(result.width(), forward.width());
+    t.iseq(result.height(), forward.height());
+    t.assert(sameImage(result, banded));
+
+    // A flat image stays flat in the middle.
+    img::tImage flat;
+    randomImage(lcg, orig.width(), orig.height(), img::kGrey, &flat);
+    memset(flat.buf(), 77, flat.bufUsed());
+    flat.rotateBilinear(angle, &result);
+    t.assert(result[result.height()/2][result.width()/2][0] == 77);
+}
+
+
+void badArgsTest(const tTest& t)
+{
+    algo::tKnuthLCG lcg(rand());
+    img::tImage orig, result;
+    randomImage(lcg, 10, 10, img::kRGB24, &orig);
+
+    try { img::tWarper w(10, 10, 5, 5, geo::tTrans4::scale(0.0, 1.0, 1.0)); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { img::tWarper w(0, 10, 5, 5, geo::tTrans4::identity()); t.fail(); }
+    catch (eInvalidArgument& e) { }
+    try { img::tWarper w(10, 10, 5, 0, geo::tTrans4::identity()); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    img::tWarper warper(10, 11, 10, 10, geo::tTrans4::identity());
+    try { warper.warp(&orig, &result); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    img::tWarper square(10, 10, 10, 10, geo::tTrans4::identity());
+    try { square.warp(&orig, &orig); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    orig.setFormat(img::kYUYV);
+    orig.setBufUsed(200);
+    try { square.warp(&orig, &result); t.fail(); }
+    catch (eInvalidArgument& e) { }
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("Identity test", identityTest, 20);
+    tTest("Translate test", translateTest, 20);
+    tTest("Rotate 90 test", rotate90Test, 20);
+    tTest("Cached and banded test", cachedAndBandedTest, 50);
+    tTest("rotateBilinear test", rotateBilinearTest, 20);
+    tTest("Bad args test", badArgsTest);
+
+    return 0;
+}
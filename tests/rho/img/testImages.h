@@ -0,0 +1,58 @@
+/*
+ * Helpers shared by the img tests. (Not a test itself; RunTests.bash
+ * only builds the .cpp files.)
+ */
+
+#ifndef __rho_tests_img_testImages_h__
+#define __rho_tests_img_testImages_h__
+
+
+#include <rho/img/tImage.h>
+#include <rho/algo/tLCG.h>
+
+#include <cstring>
+
+
+/*
+ * Gives 'image' the size and format asked for, and random bytes.
+ */
+inline
+void randomImage(rho::algo::iLCG& lcg, rho::u32 width, rho::u32 height,
+                 rho::img::nImageFormat format, rho::img::tImage* image)
+{
+    rho::u32 size = width * height * rho::img::getBPP(format);
+    image->setBufSize(size);
+    image->setBufUsed(size);
+    image->setWidth(width);
+    image->setHeight(height);
+    image->setFormat(format);
+    for (rho::u32 i = 0; i < size; i++)
+        image->buf()[i] = (rho::u8)(lcg.next() % 256);
+}
+
+
+/*
+ * One of RGB24, RGBA, BGRA and grey.
+ */
+inline
+rho::img::nImageFormat randomFormat(rho::algo::iLCG& lcg)
+{
+    static const rho::img::nImageFormat kFormats[] = { rho::img::kRGB24, rho::img::kRGBA,
+                                                       rho::img::kBGRA, rho::img::kGrey };
+    return kFormats[lcg.next() % 4];
+}
+
+
+/*
+ * Whether the images have the same size, format and bytes.
+ */
+inline
+bool sameImage(const rho::img::tImage& a, const rho::img::tImage& b)
+{
+    return a.bufUsed() == b.bufUsed() && a.width() == b.width() &&
+           a.height() == b.height() && a.format() == b.format() &&
+           memcmp(a.buf(), b.buf(), a.bufUsed()) == 0;
+}
+
+
+#endif   // __rho_tests_img_testImages_h__
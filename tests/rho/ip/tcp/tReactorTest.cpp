@@ -0,0 +1,497 @@
+#include <rho/ip/tcp/tReactor.h>
+#include <rho/ip/tcp/tServer.h>
+#include <rho/ip/tcp/tSocket.h>
+#include <rho/sync/tAtomicInt.h>
+#include <rho/sync/tThread.h>
+#include <rho/bNonCopyable.h>
+#include <rho/iAsyncReadable.h>
+#include <rho/iWritable.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+#include <rho/types.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+
+using namespace rho;
+using std::vector;
+
+
+static const u16 kBasePort = 16101;
+
+
+class tReactorRunnable : public sync::iRunnable
+{
+    public:
+
+        tReactorRunnable(ip::tcp::tReactor& reactor) : m_reactor(reactor) { }
+
+        void run() { m_reactor.run(); }
+
+    private:
+
+        ip::tcp::tReactor& m_reactor;
+};
+
+
+/*
+ * Sends every byte it's given straight back down its socket.
+ */
+class tEchoSink : public iAsyncReadable, public bNonCopyable
+{
+    public:
+
+        tEchoSink(ip::tcp::tReactor& reactor, refc<ip::tcp::tSocket> socket)
+            : m_reactor(reactor), m_socket(socket), m_ended(false) { }
+
+        void takeInput(const u8* buffer, i32 length)
+        {
+            m_reactor.send(m_socket, buffer, length);
+        }
+
+        void endStream()
+        {
+            m_ended = true;
+        }
+
+        ip::tcp::tReactor& m_reactor;
+        refc<ip::tcp::tSocket> m_socket;
+        bool m_ended;
+};
+
+
+class tEchoObserver : public ip::tcp::iReactorObserver
+{
+    public:
+
+        tEchoObserver() : m_numAccepted(0), m_numClosed(0), m_numEnded(0) { }
+
+        void accepted(ip::tcp::tReactor& reactor, refc<ip::tcp::tServer> server,
+                      refc<ip::tcp::tSocket> socket)
+        {
+            tEchoSink* sink = new tEchoSink(reactor, socket);
+            m_sinks.push_back(sink);
+            reactor.add(socket, sink, this);
+            ++m_numAccepted;
+        }
+
+        void closed(ip::tcp::tReactor& reactor, refc<ip::tcp::tSocket> socket)
+        {
+            for (size_t i = 0; i < m_sinks.size(); i++)
+                if (m_sinks[i]->m_socket == socket && m_sinks[i]->m_ended)
+                    ++m_numEnded;
+            ++m_numClosed;
+        }
+
+        ~tEchoObserver()
+        {
+            for (size_t i = 0; i < m_sinks.size(); i++)
+                delete m_sinks[i];
+        }
+
+        vector<tEchoSink*> m_sinks;
+        sync::au32 m_numAccepted;
+        sync::au32 m_numClosed;
+        sync::au32 m_numEnded;
+};
+
+
+void echoTest(const tTest& t)
+{
+    static u16 sPort = kBasePort;
+    u16 port = sPort++;
+
+    ip::tcp::tReactor reactor;
+    tEchoObserver obs;
+    reactor.add(refc<ip::tcp::tServer>(new ip::tcp::tServer(port)), &obs);
+    t.iseq(reactor.size(), (u32)1);
+    sync::tThread thread(refc<sync::iRunnable>(new tReactorRunnable(reactor)));
+
+    const u32 kNumClients = 64;
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    vector< refc<ip::tcp::tSocket> > clients;
+    for (u32 i = 0; i < kNumClients; i++)
+        clients.push_back(refc<ip::tcp::tSocket>(new ip::tcp::tSocket(addrGroup, port)));
+
+    // Interleave the conversations, so the reactor juggles them all.
+    for (u32 round = 0; round < 5; round++)
+    {
+        vector< vector<u8> > messages(kNumClients);
+        for (u32 i = 0; i < kNumClients; i++)
+        {
+            messages[i].resize((rand() % 5000) + 1);
+            for (size_t j = 0; j < messages[i].size(); j++)
+                messages[i][j] = (u8)(rand() % 256);
+            clients[i]->writeAll(&messages[i][0], (i32)messages[i].size());
+            t.assert(clients[i]->flush());
+        }
+        for (u32 i = 0; i < kNumClients; i++)
+        {
+            vector<u8> echo(messages[i].size());
+            t.iseq(clients[i]->readAll(&echo[0], (i32)echo.size()), (i32)echo.size());
+            t.assert(echo == messages[i]);
+        }
+    }
+
+    t.iseq(obs.m_numAccepted.val(), kNumClients);
+    t.iseq(obs.m_numClosed.val(), (u32)0);
+
+    for (u32 i = 0; i < kNumClients; i++)
+        clients[i]->close();
+    clients.clear();
+    while (obs.m_numClosed.val() < kNumClients)
+        sync::tThread::msleep(1);
+
+    reactor.stop();
+    thread.join();
+
+    t.iseq(obs.m_numEnded.val(), kNumClients);
+    t.iseq(reactor.size(), (u32)1);
+}
+
+
+class tBigSendObserver : public ip::tcp::iReactorObserver
+{
+    public:
+
+        tBigSendObserver(u32 numBytes)
+            : m_numBytes(numBytes), m_pendingAfterSend(0),
+              m_pendingWhenWritable(0), m_numWritable(0), m_numAccepted(0) { }
+
+        void accepted(ip::tcp::tReactor& reactor, refc<ip::tcp::tServer> server,
+                      refc<ip::tcp::tSocket> socket)
+        {
+            reactor.add(socket, &m_sink, this);
+            vector<u8> buf(m_numBytes);
+            for (u32 i = 0; i < m_numBytes; i++)
+                buf[i] = (u8)(i % 251);
+            reactor.send(socket, &buf[0], (i32)buf.size());
+            m_pendingAfterSend = reactor.pendingOutput(socket);
+            ++m_numAccepted;
+        }
+
+        void writable(ip::tcp::tReactor& reactor, refc<ip::tcp::tSocket> socket)
+        {
+            m_pendingWhenWritable = reactor.pendingOutput(socket);
+            ++m_numWritable;
+        }
+
+        u32 m_numBytes;
+        sync::au32 m_pendingAfterSend;
+        sync::au32 m_pendingWhenWritable;
+        sync::au32 m_numWritable;
+        sync::au32 m_numAccepted;
+        tByteAsyncReadable m_sink;
+};
+
+
+void backPressureTest(const tTest& t)
+{
+    static u16 sPort = kBasePort + 100;
+    u16 port = sPort++;
+
+    const u32 kNumBytes = 16*1024*1024;
+    ip::tcp::tReactor reactor;
+    tBigSendObserver obs(kNumBytes);
+    reactor.add(refc<ip::tcp::tServer>(new ip::tcp::tServer(port)), &obs);
+    sync::tThread thread(refc<sync::iRunnable>(new tReactorRunnable(reactor)));
+
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    ip::tcp::tSocket client(addrGroup, port);
+    while (obs.m_numAccepted.val() == 0)
+        sync::tThread::msleep(1);
+
+    // Far more than fits in the kernel's socket buffers, so most of it
+    // has to wait in the reactor until we start reading.
+    t.assert(obs.m_pendingAfterSend.val() > 0);
+    t.iseq(obs.m_numWritable.val(), (u32)0);
+
+    vector<u8> buf(kNumBytes);
+    t.iseq(client.readAll(&buf[0], (i32)buf.size()), (i32)buf.size());
+    for (u32 i = 0; i < kNumBytes; i++)
+    {
+        if (buf[i] != (u8)(i % 251))
+        {
+            t.fail();
+            break;
+        }
+    }
+
+    while (obs.m_numWritable.val() == 0)
+        sync::tThread::msleep(1);
+    t.iseq(obs.m_numWritable.val(), (u32)1);
+    t.iseq(obs.m_pendingWhenWritable.val(), (u32)0);
+
+    reactor.stop();
+    thread.join();
+}
+
+
+void zlibSinkTest(const tTest& t)
+{
+    static u16 sPort = kBasePort + 200;
+    u16 port = sPort++;
+
+    // An existing async parser used as the socket's sink.
+    tByteAsyncReadable bytes;
+    tZlibAsyncReadable zlib(&bytes);
+
+    class tZlibObserver : public ip::tcp::iReactorObserver
+    {
+        public:
+            tZlibObserver(iAsyncReadable* sink) : m_sink(sink), m_numClosed(0) { }
+            void accepted(ip::tcp::tReactor& reactor, refc<ip::tcp::tServer> server,
+                          refc<ip::tcp::tSocket> socket)
+            {
+                reactor.add(socket, m_sink, this);
+            }
+            void closed(ip::tcp::tReactor& reactor, refc<ip::tcp::tSocket> socket)
+            {
+                ++m_numClosed;
+            }
+            iAsyncReadable* m_sink;
+            sync::au32 m_numClosed;
+    };
+
+    ip::tcp::tReactor reactor;
+    tZlibObserver obs(&zlib);
+    reactor.add(refc<ip::tcp::tServer>(new ip::tcp::tServer(port)), &obs);
+
+    vector<u8> original(200000);
+    for (size_t i = 0; i < original.size(); i++)
+        original[i] = (u8)((i * 7) % 13);
+
+    // No separate thread this time: poll the reactor by hand.
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    {
+        ip::tcp::tSocket client(addrGroup, port);
+        tZlibWritable zw(&client);
+        t.iseq(zw.writeAll(&original[0], (i32)original.size()), (i32)original.size());
+        t.assert(zw.flush());
+        zw.close();
+    }
+    for (u32 i = 0; i < 1000 && obs.m_numClosed.val() == 0; i++)
+        reactor.runOnce(10);
+
+    t.iseq(obs.m_numClosed.val(), (u32)1);
+    t.assert(bytes.getBuf() == original);
+    t.iseq(reactor.size(), (u32)1);
+}
+
+
+void halfCloseTest(const tTest& t)
+{
+    static u16 sPort = kBasePort + 400;
+    u16 port = sPort++;
+
+    // The server has a lot queued for the client when the client shuts
+    // down its side; all of it must still arrive.
+    const u32 kNumBytes = 16*1024*1024;
+    ip::tcp::tReactor reactor;
+    tBigSendObserver obs(kNumBytes);
+    reactor.add(refc<ip::tcp::tServer>(new ip::tcp::tServer(port)), &obs);
+    sync::tThread thread(refc<sync::iRunnable>(new tReactorRunnable(reactor)));
+
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    ip::tcp::tSocket client(addrGroup, port);
+    while (obs.m_numAccepted.val() == 0)
+        sync::tThread::msleep(1);
+    t.assert(obs.m_pendingAfterSend.val() > 0);
+    client.closeWrite();
+
+    vector<u8> buf(kNumBytes);
+    t.iseq(client.readAll(&buf[0], (i32)buf.size()), (i32)buf.size());
+    for (u32 i = 0; i < kNumBytes; i++)
+    {
+        if (buf[i] != (u8)(i % 251))
+        {
+            t.fail();
+            break;
+        }
+    }
+    u8 c;
+    t.iseq(client.read(&c, 1), 0);           // <-- the server closed its side too
+
+    reactor.stop();
+    thread.join();
+    t.iseq(reactor.size(), (u32)1);
+}
+
+
+class tThrowingSink : public iAsyncReadable
+{
+    public:
+
+        tThrowingSink() : m_ended(false) { }
+
+        void takeInput(const u8* buffer, i32 length)
+        {
+            throw eRuntimeError("This sink doesn't like input.");
+        }
+
+        void endStream()
+        {
+            m_ended = true;
+        }
+
+        bool m_ended;
+};
+
+
+void throwingSinkTest(const tTest& t)
+{
+    static u16 sPort = kBasePort + 500;
+    u16 port = sPort++;
+
+    class tObserver : public ip::tcp::iReactorObserver
+    {
+        public:
+            tObserver(iAsyncReadable* sink) : m_sink(sink), m_numClosed(0) { }
+            void accepted(ip::tcp::tReactor& reactor, refc<ip::tcp::tServer> server,
+                          refc<ip::tcp::tSocket> socket)
+            {
+                reactor.add(socket, m_sink, this);
+            }
+            void closed(ip::tcp::tReactor& reactor, refc<ip::tcp::tSocket> socket)
+            {
+                ++m_numClosed;
+            }
+            iAsyncReadable* m_sink;
+            u32 m_numClosed;
+    };
+
+    ip::tcp::tReactor reactor;
+    tThrowingSink sink;
+    tObserver obs(&sink);
+    reactor.add(refc<ip::tcp::tServer>(new ip::tcp::tServer(port)), &obs);
+
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    ip::tcp::tSocket client(addrGroup, port);
+    u8 c = 42;
+    t.iseq(client.writeAll(&c, 1), 1);
+    t.assert(client.flush());
+    for (u32 i = 0; i < 1000 && obs.m_numClosed == 0; i++)
+        reactor.runOnce(10);
+
+    // The connection is dropped, but properly: both callbacks ran.
+    t.iseq(obs.m_numClosed, (u32)1);
+    t.assert(sink.m_ended);
+    t.iseq(reactor.size(), (u32)1);
+}
+
+
+class tAcceptObserver : public ip::tcp::iReactorObserver
+{
+    public:
+
+        tAcceptObserver() : m_numAccepted(0), m_numFailed(0), m_lastErrnum(0) { }
+
+        void accepted(ip::tcp::tReactor& reactor, refc<ip::tcp::tServer> server,
+                      refc<ip::tcp::tSocket> socket)
+        {
+            m_sockets.push_back(socket);
+            ++m_numAccepted;
+        }
+
+        void acceptFailed(ip::tcp::tReactor& reactor, refc<ip::tcp::tServer> server,
+                          const ip::eSocketCreationError& e)
+        {
+            ++m_numFailed;
+            m_lastErrnum = e.errnum();
+        }
+
+        vector< refc<ip::tcp::tSocket> > m_sockets;
+        u32 m_numAccepted;
+        u32 m_numFailed;
+        int m_lastErrnum;
+};
+
+
+void outOfFdsTest(const tTest& t)
+{
+    static u16 sPort = kBasePort + 600;
+    u16 port = sPort++;
+
+    // Keep the fd limit small, so it's quick to use them all up.
+    struct rlimit oldLimit;
+    t.iseq(getrlimit(RLIMIT_NOFILE, &oldLimit), 0);
+    struct rlimit limit = oldLimit;
+    if (limit.rlim_cur > 512)
+        limit.rlim_cur = 512;
+    t.iseq(setrlimit(RLIMIT_NOFILE, &limit), 0);
+
+    ip::tcp::tReactor reactor;
+    tAcceptObserver obs;
+    reactor.add(refc<ip::tcp::tServer>(new ip::tcp::tServer(port)), &obs);
+
+    const u32 kNumClients = 3;
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    vector< refc<ip::tcp::tSocket> > clients;
+    for (u32 i = 0; i < kNumClients; i++)
+        clients.push_back(refc<ip::tcp::tSocket>(new ip::tcp::tSocket(addrGroup, port)));
+
+    vector<int> fillers;
+    for (int fd; (fd = dup(0)) >= 0; )
+        fillers.push_back(fd);
+
+    for (u32 i = 0; i < 10; i++)
+        reactor.runOnce(10);
+    t.iseq(obs.m_numAccepted, (u32)0);
+    t.assert(obs.m_numFailed > 0);
+    t.iseq(obs.m_lastErrnum, EMFILE);
+
+    // No new connections arrive, but the waiting ones still get in.
+    for (size_t i = 0; i < fillers.size(); i++)
+        close(fillers[i]);
+    for (u32 i = 0; i < 100 && obs.m_numAccepted < kNumClients; i++)
+        reactor.runOnce(1000);
+    t.iseq(obs.m_numAccepted, kNumClients);
+
+    t.iseq(setrlimit(RLIMIT_NOFILE, &oldLimit), 0);
+}
+
+
+void argumentsTest(const tTest& t)
+{
+    ip::tcp::tReactor reactor;
+    tEchoObserver obs;
+    refc<ip::tcp::tServer> server(new ip::tcp::tServer(kBasePort + 300));
+
+    try { reactor.add(server, NULL); t.fail(); }
+    catch (eNullPointer& e) { }
+
+    reactor.add(server, &obs);
+    try { reactor.add(server, &obs); t.fail(); }
+    catch (eLogicError& e) { }
+
+    reactor.remove(server);
+    t.iseq(reactor.size(), (u32)0);
+    try { reactor.remove(server); t.fail(); }
+    catch (eInvalidArgument& e) { }
+
+    t.iseq(reactor.runOnce(0), (u32)0);
+
+    reactor.stop();
+    reactor.run();            // returns at once, since stop() was called
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("Echo test", echoTest, 3);
+    tTest("Back-pressure test", backPressureTest);
+    tTest("Zlib sink test", zlibSinkTest);
+    tTest("Half-close test", halfCloseTest);
+    tTest("Throwing sink test", throwingSinkTest);
+    tTest("Out-of-fds test", outOfFdsTest);
+    tTest("Arguments test", argumentsTest);
+
+    return 0;
+}
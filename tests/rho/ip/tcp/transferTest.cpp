@@ -0,0 +1,270 @@
+#include <rho/ip/tcp/tServer.h>
+#include <rho/ip/tcp/tSocket.h>
+#include <rho/sync/tThread.h>
+#include <rho/iReadable.h>
+#include <rho/iWritable.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+#include <rho/types.h>
+#include <rho/algo/tLCG.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+using namespace rho;
+using std::vector;
+
+
+#if __linux__ || __APPLE__ || __CYGWIN__
+std::string gFilePath = "/tmp/transferfile.bin";
+#elif __MINGW32__
+std::string gFilePath = "C:\\transferfile.bin";
+#else
+#error What platform are you on!?
+#endif
+
+static const u16 kBasePort = 16501;
+static const u64 kEverything = 0xFFFFFFFFFFFFFFFFULL;
+
+
+static
+vector<u8> s_genData(u32 len)
+{
+    algo::tKnuthLCG lcg(rand());
+    vector<u8> data(len);
+    for (u32 i = 0; i < len; i++)
+        data[i] = (u8)(lcg.next() % 256);
+    return data;
+}
+
+
+/*
+ * Reads everything from a socket until eof (after waiting 'delayMS', so
+ * that the socket's buffers can fill up first).
+ */
+class tDrainRunnable : public sync::iRunnable
+{
+    public:
+
+        tDrainRunnable(refc<ip::tcp::tSocket> socket, u32 delayMS = 0)
+            : m_socket(socket), m_delayMS(delayMS) { }
+
+        void run()
+        {
+            if (m_delayMS > 0)
+                sync::tThread::msleep(m_delayMS);
+            u8 buf[4096];
+            i32 r;
+            while ((r = m_socket->read(buf, sizeof(buf))) > 0)
+                m_received.insert(m_received.end(), buf, buf+r);
+        }
+
+        refc<ip::tcp::tSocket> m_socket;
+        u32 m_delayMS;
+        vector<u8> m_received;
+};
+
+
+/*
+ * Writes some data to a socket, then closes it.
+ */
+class tSendRunnable : public sync::iRunnable
+{
+    public:
+
+        tSendRunnable(refc<ip::tcp::tSocket> socket, const vector<u8>& data)
+            : m_socket(socket), m_data(data) { }
+
+        void run()
+        {
+            m_socket->writeAll(&m_data[0], (i32)m_data.size());
+            m_socket->close();
+        }
+
+        refc<ip::tcp::tSocket> m_socket;
+        vector<u8> m_data;
+};
+
+
+void fileToSocketTest(const tTest& t)
+{
+    static u16 sPort = kBasePort;
+    u16 port = sPort++;
+
+    vector<u8> data = s_genData((rand() % 5000000) + 5000);
+    {
+        tFileWritable file(gFilePath);
+        t.iseq(file.writeAll(&data[0], (i32)data.size()), (i32)data.size());
+    }
+
+    ip::tcp::tServer server(port);
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    ip::tcp::tSocket client(addrGroup, port);
+    tDrainRunnable* drain = new tDrainRunnable(server.accept());
+    refc<sync::iRunnable> drainRef(drain);
+    sync::tThread thread(drainRef);
+
+    tFileReadable file(gFilePath);
+
+    // Read a little the normal way first, so that the FILE* has buffered
+    // ahead of what we've consumed.
+    u8 head[1000];
+    t.iseq(file.readAll(head, 1000), 1000);
+    t.iseq(client.writeAll(head, 1000), 1000);
+    t.iseq(file.getPosition(), (u64)1000);
+
+    // Then a fixed amount, then the rest through the generic helper.
+    u64 len = (data.size() - 1000) / 2;
+    t.iseq(client.transferFrom(file, len), len);
+    t.iseq(file.getPosition(), 1000 + len);
+    t.iseq(ip::tcp::transfer(&file, &client, kEverything), data.size() - 1000 - len);
+
+    u8 tail[10];
+    t.iseq(file.read(tail, 10), 0);
+    t.iseq(file.read(tail, 10), -1);
+
+    client.close();
+    thread.join();
+    t.assert(drain->m_received == data);
+}
+
+
+void socketToSocketTest(const tTest& t)
+{
+    static u16 sPort = kBasePort + 100;
+    u16 port = sPort++;
+
+    // Data goes: sender -> proxyIn ... proxyOut -> receiver.
+    ip::tcp::tServer inServer(port);
+    ip::tcp::tServer outServer(port + 50);
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+
+    refc<ip::tcp::tSocket> sender(new ip::tcp::tSocket(addrGroup, port));
+    refc<ip::tcp::tSocket> proxyIn = inServer.accept();
+    refc<ip::tcp::tSocket> proxyOut(new ip::tcp::tSocket(addrGroup, port + 50));
+
+    tDrainRunnable* drain = new tDrainRunnable(outServer.accept());
+    refc<sync::iRunnable> drainRef(drain);
+    sync::tThread drainThread(drainRef);
+
+    vector<u8> data = s_genData((rand() % 5000000) + 5000);
+    refc<sync::iRunnable> sendRef(new tSendRunnable(sender, data));
+    sync::tThread sendThread(sendRef);
+
+    // Pull a few bytes through the proxy's buffered reader, so
+    // transferFrom() has to send those along first.
+    u8 head[10];
+    t.iseq(proxyIn->readAll(head, 10), 10);
+    t.iseq(proxyOut->writeAll(head, 10), 10);
+
+    u64 len = (data.size() - 10) / 3;
+    t.iseq(proxyOut->transferFrom(*proxyIn, len), len);
+
+    t.iseq(ip::tcp::transfer(proxyIn, proxyOut, kEverything), data.size() - 10 - len);
+    sendThread.join();
+
+    proxyOut->close();
+    drainThread.join();
+    t.assert(drain->m_received == data);
+}
+
+
+void nonBlockingTest(const tTest& t)
+{
+    static u16 sPort = kBasePort + 300;
+    u16 port = sPort++;
+
+    // Would-block on either end must leave the connections open: a full
+    // proxyOut (its receiver is slow to start) and an empty proxyIn (its
+    // sender is slow to start).
+    ip::tcp::tServer inServer(port);
+    ip::tcp::tServer outServer(port + 50);
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+
+    refc<ip::tcp::tSocket> sender(new ip::tcp::tSocket(addrGroup, port));
+    refc<ip::tcp::tSocket> proxyIn = inServer.accept();
+    refc<ip::tcp::tSocket> proxyOut(new ip::tcp::tSocket(addrGroup, port + 50));
+    proxyIn->setNonBlocking(true);
+    proxyOut->setNonBlocking(true);
+
+    tDrainRunnable* drain = new tDrainRunnable(outServer.accept(), 100);
+    refc<sync::iRunnable> drainRef(drain);
+    sync::tThread drainThread(drainRef);
+
+    t.iseq(proxyOut->transferFrom(*proxyIn, 100), (u64)0);     // nothing sent yet
+
+    vector<u8> data = s_genData((rand() % 5000000) + 5000000);
+    refc<sync::iRunnable> sendRef(new tSendRunnable(sender, data));
+    sync::tThread sendThread(sendRef);
+
+    // The file's half goes after the forwarded half, from a file into
+    // the (full, then drained) non-blocking proxyOut.
+    {
+        tFileWritable file(gFilePath);
+        t.iseq(file.writeAll(&data[0], (i32)data.size()), (i32)data.size());
+    }
+
+    u64 moved = 0;
+    for (u32 i = 0; moved < data.size() && i < 10000; i++)
+    {
+        u64 n = proxyOut->transferFrom(*proxyIn, data.size() - moved);
+        moved += n;
+        if (n == 0)
+            sync::tThread::msleep(1);
+    }
+    t.iseq(moved, (u64)data.size());
+    sendThread.join();
+
+    tFileReadable file(gFilePath);
+    u64 sent = 0;
+    for (u32 i = 0; sent < data.size() && i < 10000; i++)
+    {
+        u64 n = proxyOut->transferFrom(file, data.size() - sent);
+        sent += n;
+        if (n == 0)
+            sync::tThread::msleep(1);
+    }
+    t.iseq(sent, (u64)data.size());
+    t.iseq(file.getPosition(), (u64)data.size());
+
+    proxyOut->close();
+    drainThread.join();
+    t.iseq(drain->m_received.size(), 2 * data.size());
+    t.assert(std::equal(data.begin(), data.end(), drain->m_received.begin()));
+    t.assert(std::equal(data.begin(), data.end(), drain->m_received.begin() + (long)data.size()));
+}
+
+
+void copyFallbackTest(const tTest& t)
+{
+    vector<u8> data = s_genData((rand() % 200000) + 1);
+    tByteReadable readable(data);
+    tByteWritable writable;
+
+    u64 len = data.size() / 2;
+    t.iseq(ip::tcp::transfer(&readable, &writable, len), len);
+    t.iseq(ip::tcp::transfer(&readable, &writable, kEverything), data.size() - len);
+    t.iseq(ip::tcp::transfer(&readable, &writable, kEverything), (u64)0);
+    t.assert(writable.getBuf() == data);
+
+    try { ip::tcp::transfer(NULL, &writable, 1); t.fail(); }
+    catch (eNullPointer& e) { }
+    try { ip::tcp::transfer(&readable, NULL, 1); t.fail(); }
+    catch (eNullPointer& e) { }
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("File to socket test", fileToSocketTest, 5);
+    tTest("Socket to socket test", socketToSocketTest, 5);
+    tTest("Non-blocking test", nonBlockingTest, 3);
+    tTest("Copy fallback test", copyFallbackTest, 20);
+
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include <rho/ip/tcp/tServer.h>
+#include <rho/ip/tcp/tSocket.h>
+#include <rho/sync/tThread.h>
+#include <rho/iPackable.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+#include <rho/types.h>
+#include <rho/algo/tLCG.h>
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+
+using namespace rho;
+using std::vector;
+
+
+static const u16 kBasePort = 16701;
+
+
+static
+vector<u8> s_genData(u32 len)
+{
+    algo::tKnuthLCG lcg(rand());
+    vector<u8> data(len);
+    for (u32 i = 0; i < len; i++)
+        data[i] = (u8)(lcg.next() % 256);
+    return data;
+}
+
+
+/*
+ * Sends a header (the payload length) and a payload in one gathered
+ * write, then closes.
+ */
+class tSendRunnable : public sync::iRunnable
+{
+    public:
+
+        tSendRunnable(refc<ip::tcp::tSocket> socket, const vector<u8>& payload)
+            : m_socket(socket), m_payload(payload) { }
+
+        void run()
+        {
+            u32 length = (u32)m_payload.size();
+            tConstIoVec bufs[2];
+            bufs[0].base = (const u8*)&length;
+            bufs[0].length = 4;
+            bufs[1].base = &m_payload[0];
+            bufs[1].length = (i32)m_payload.size();
+            m_result = m_socket->writeAllv(bufs, 2);
+            m_socket->close();
+        }
+
+        refc<ip::tcp::tSocket> m_socket;
+        vector<u8> m_payload;
+        i32 m_result;
+};
+
+
+void gatherScatterTest(const tTest& t)
+{
+    static u16 sPort = kBasePort;
+    u16 port = sPort++;
+
+    ip::tcp::tServer server(port);
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    refc<ip::tcp::tSocket> client(new ip::tcp::tSocket(addrGroup, port));
+    refc<ip::tcp::tSocket> conn = server.accept();
+
+    vector<u8> payload = s_genData((rand() % 2000000) + 1);
+    tSendRunnable* sender = new tSendRunnable(client, payload);
+    refc<sync::iRunnable> senderRef(sender);
+    sync::tThread thread(senderRef);
+
+    // Read one byte the normal way so some of the message sits in the
+    // socket's read buffer, then scatter the rest.
+    u8 first;
+    t.iseq(conn->readAll(&first, 1), 1);
+
+    u8 header[3];
+    vector<u8> received(payload.size());
+    tIoVec bufs[2];
+    bufs[0].base = header;
+    bufs[0].length = 3;
+    bufs[1].base = &received[0];
+    bufs[1].length = (i32)received.size();
+    t.iseq(conn->readAllv(bufs, 2), (i32)received.size() + 3);
+
+    u32 length;
+    u8* p = (u8*)&length;
+    p[0] = first; p[1] = header[0]; p[2] = header[1]; p[3] = header[2];
+    t.iseq(length, (u32)payload.size());
+    t.assert(received == payload);
+
+    u8 more;
+    t.iseq(conn->read(&more, 1), 0);
+    t.iseq(conn->read(&more, 1), -1);
+
+    thread.join();
+    t.iseq(sender->m_result, (i32)payload.size() + 4);
+}
+
+
+void packTest(const tTest& t)
+{
+    static u16 sPort = kBasePort + 100;
+    u16 port = sPort++;
+
+    ip::tcp::tServer server(port);
+    ip::tAddrGroup addrGroup(ip::tAddrGroup::kLocalhostConnect);
+    ip::tcp::tSocket client(addrGroup, port);
+    refc<ip::tcp::tSocket> conn = server.accept();
+
+    // A small message with a byte payload: the fields are buffered and
+    // the payload goes out with them in one gathered write.
+    u32 id = (u32)rand();
+    std::string name = "some message";
+    vector<u8> payload = s_genData((rand() % 100000) + 1);
+    pack(&client, id);
+    pack(&client, name);
+    pack(&client, payload);
+    t.assert(client.flush());
+
+    u32 id2;
+    std::string name2;
+    vector<u8> payload2;
+    unpack(conn, id2);
+    unpack(conn, name2);
+    unpack(conn, payload2);
+    t.iseq(id2, id);
+    t.assert(name2 == name);
+    t.assert(payload2 == payload);
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("Gather/scatter test", gatherScatterTest, 5);
+    tTest("Pack test", packTest, 5);
+
+    return 0;
+}
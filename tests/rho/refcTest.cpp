@@ -9,6 +9,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <string>
 #include <vector>
 
 
@@ -60,6 +61,115 @@ class tCountingObject
 };
 
 
+class tIntrusiveCountingObject : public bRefcounted
+{
+    public:
+
+        tIntrusiveCountingObject()
+        {
+            gObjectCount++;
+        }
+
+        ~tIntrusiveCountingObject()
+        {
+            gObjectCount--;
+        }
+};
+
+
+class tArgsCountingObject
+{
+    public:
+
+        tArgsCountingObject(i32 a, const std::string& b, f64 c)
+            : m_a(a), m_b(b), m_c(c)
+        {
+            gObjectCount++;
+        }
+
+        ~tArgsCountingObject()
+        {
+            gObjectCount--;
+        }
+
+        i32 m_a;
+        std::string m_b;
+        f64 m_c;
+};
+
+
+/*
+ * Neither base has a virtual destructor, and tUpcastBase isn't at the
+ * start of a tUpcastObject, so a refc<tUpcastBase> must both adjust the
+ * pointer and delete the object as a tUpcastObject.
+ */
+class tUpcastOtherBase
+{
+    public:
+
+        tUpcastOtherBase() : m_other(1) { }
+
+        i64 m_other;
+};
+
+
+class tUpcastBase
+{
+    public:
+
+        tUpcastBase() : m_base(2) { }
+
+        i64 m_base;
+};
+
+
+class tUpcastObject : public tUpcastOtherBase, public tUpcastBase
+{
+    public:
+
+        tUpcastObject()
+        {
+            gObjectCount++;
+        }
+
+        ~tUpcastObject()
+        {
+            gObjectCount--;
+        }
+};
+
+
+class tIntrusiveRunnable : public sync::iRunnable, public bRefcounted
+{
+    public:
+
+        tIntrusiveRunnable()
+        {
+            gObjectCount++;
+        }
+
+        ~tIntrusiveRunnable()
+        {
+            gObjectCount--;
+        }
+
+        void run()
+        {
+        }
+};
+
+
+class tThrowingObject
+{
+    public:
+
+        tThrowingObject(i32 x)
+        {
+            throw eInvalidArgument("tThrowingObject");
+        }
+};
+
+
 static sync::tThreadLocal<i64> gThreadLocalObjectCount;
 
 
@@ -485,6 +595,129 @@ void threadLocalRandomTest2(const tTest& t)
 }
 
 
+void intrusiveTest(const tTest& t)
+{
+    {
+        tIntrusiveCountingObject* object = new tIntrusiveCountingObject;
+        refc<tIntrusiveCountingObject> r1(object);
+        t.assert(gObjectCount == 1);
+        t.iseq(r1.count(), (u32)1);
+        {
+            refc<tIntrusiveCountingObject> r2(object);   // same count, from the raw ptr
+            refc<tIntrusiveCountingObject> r3(r1);
+            t.iseq(r1.count(), (u32)3);
+        }
+        t.iseq(r1.count(), (u32)1);
+
+        r1 = new tIntrusiveCountingObject;
+        t.assert(gObjectCount == 1);
+        t.assert(r1 != NULL);
+        r1 = NULL;
+        t.assert(gObjectCount == 0);
+    }
+    t.assert(gObjectCount == 0);
+
+    {
+        refc<tIntrusiveCountingObject> r = makeRefc<tIntrusiveCountingObject>();
+        refc<tIntrusiveCountingObject> r2((tIntrusiveCountingObject*)r);
+        t.iseq(r.count(), (u32)2);
+        t.assert(gObjectCount == 1);
+    }
+    t.assert(gObjectCount == 0);
+}
+
+
+void makeRefcTest(const tTest& t)
+{
+    {
+        refc<tCountingObject> r = makeRefc<tCountingObject>();
+        t.assert(gObjectCount == 1);
+        t.iseq(r.count(), (u32)1);
+        refc<tCountingObject> r2 = r;
+        t.iseq(r.count(), (u32)2);
+        r = NULL;
+        t.assert(gObjectCount == 1);
+        t.iseq(r2.count(), (u32)1);
+    }
+    t.assert(gObjectCount == 0);
+
+    {
+        refc<tArgsCountingObject> r = makeRefc<tArgsCountingObject>(7, std::string("hi"), 2.5);
+        t.iseq(r->m_a, 7);
+        t.iseq(r->m_b, "hi");
+        t.assert(r->m_c == 2.5);
+        t.assert(gObjectCount == 1);
+    }
+    t.assert(gObjectCount == 0);
+
+    {
+        refc<f64> r = makeRefc<f64>(1.5);
+        t.assert(*r == 1.5);
+        t.assert((((size_t)(f64*)r) % __alignof__(f64)) == 0);
+    }
+
+    try
+    {
+        refc<tThrowingObject> r = makeRefc<tThrowingObject>(1);
+        t.fail();
+    }
+    catch (eInvalidArgument& e)
+    {
+    }
+
+    {
+        vector< refc<tCountingObject> > v;
+        for (int i = 0; i < 100; i++)
+        {
+            if (rand() % 2)
+                v.push_back(makeRefc<tCountingObject>());
+            else
+                v.push_back(refc<tCountingObject>(new tCountingObject));
+        }
+        for (int i = 0; i < 1000; i++)
+            v[rand() % 100] = v[rand() % 100];
+    }
+    t.assert(gObjectCount == 0);
+}
+
+
+void upcastTest(const tTest& t)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        refc<tUpcastObject> d = (i == 0) ? makeRefc<tUpcastObject>()
+                                         : refc<tUpcastObject>(new tUpcastObject);
+        {
+            refc<tUpcastBase> b(d);
+            t.iseq(d.count(), (u32)2);
+            t.assert((tUpcastBase*)b == (tUpcastObject*)d);
+            t.iseq(b->m_base, (i64)2);
+        }
+        t.iseq(d.count(), (u32)1);
+        t.assert(gObjectCount == 1);
+
+        refc<tUpcastBase> b;
+        b = d;
+        t.iseq(b.count(), (u32)2);
+        d = NULL;
+        t.assert(gObjectCount == 1);
+        b = NULL;                       // <-- the last ref is the base's
+        t.assert(gObjectCount == 0);
+    }
+
+    {
+        refc<tIntrusiveRunnable> d = makeRefc<tIntrusiveRunnable>();
+        refc<sync::iRunnable> b(d);
+        t.iseq(d.count(), (u32)2);
+        d = NULL;
+        t.iseq(b.count(), (u32)1);
+        t.assert(gObjectCount == 1);
+        b = NULL;
+        t.assert(gObjectCount == 0);
+    }
+}
+
+
 class tRefcTestRunnable : public sync::iRunnable
 {
     public:
@@ -532,6 +765,10 @@ int main()
     tTest("Test 2", test2);
     tTest("Test 3", test3);
 
+    tTest("Intrusive test", intrusiveTest);
+    tTest("makeRefc test", makeRefcTest);
+    tTest("Upcast test", upcastTest);
+
     srand((u32)time(0));
     tTest("Randomized test 1", randomTest1, kMaxTests);
     tTest("Randomized test 2", randomTest2, kMaxTests);
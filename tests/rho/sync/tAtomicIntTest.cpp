@@ -64,6 +64,71 @@ void test(const tTest& t)
 }
 
 
+void explicitOrderTest(const tTest& t)
+{
+    sync::au32 a(5);
+    t.iseq((u32)5, a.load(sync::kRelaxed));
+    t.iseq((u32)5, a.load(sync::kAcquire));
+
+    a.store(7, sync::kRelease);
+    t.iseq((u32)7, a.val());
+
+    t.iseq((u32)7, a.fetchAdd(3, sync::kRelaxed));      // <-- returns the old value
+    t.iseq((u32)10, a.val());
+    t.iseq((u32)10, a.fetchSub(4, sync::kAcqRel));
+    t.iseq((u32)6, a.val());
+
+    t.iseq((u32)6, a.exchange(42, sync::kSeqCst));
+    t.iseq((u32)42, a.val());
+
+    u32 expected = 41;
+    t.reject(a.compareExchange(expected, 1, sync::kAcqRel));
+    t.iseq((u32)42, expected);                           // <-- updated on failure
+    t.assert(a.compareExchange(expected, 1, sync::kRelease));
+    t.iseq((u32)1, a.val());
+
+    sync::au8 b(255);
+    t.iseq((u8)0, ++b);
+    t.iseq((u8)255, --b);
+
+    sync::ai64 c(-1);
+    t.iseq((i64)-1, c.fetchAdd(1, sync::kRelaxed));
+    t.iseq((i64)0, c.val());
+    c -= 1LL << 40;
+    t.iseq(-(1LL << 40), c.val());
+}
+
+
+sync::au64 gRelaxedCount;
+
+
+class tRelaxedAdder : public sync::iRunnable
+{
+    public:
+
+        void run()
+        {
+            for (int i = 0; i < 100000; i++)
+                gRelaxedCount.fetchAdd(1, sync::kRelaxed);
+        }
+};
+
+
+void relaxedCountTest(const tTest& t)
+{
+    gRelaxedCount = 0;
+    int numThreads = rand() % 10 + 1;
+
+    std::vector< refc<sync::tThread> > threads;
+    for (int i = 0; i < numThreads; i++)
+        threads.push_back(refc<sync::tThread>(new sync::tThread(refc<sync::iRunnable>(new tRelaxedAdder))));
+    for (int i = 0; i < numThreads; i++)
+        threads[i]->join();
+
+    t.iseq((u64)numThreads * 100000, gRelaxedCount.val());
+}
+
+
 int main()
 {
     tCrashReporter::init();
@@ -71,6 +136,8 @@ int main()
     srand((u32)time(0));
 
     tTest("tAtomicInt test", test, kTestCount);
+    tTest("tAtomicInt explicit order test", explicitOrderTest);
+    tTest("tAtomicInt relaxed count test", relaxedCountTest, kTestCount);
 
     return 0;
 }
@@ -0,0 +1,412 @@
+#include <rho/sync/tLockFreePCQ.h>
+#include <rho/sync/tTimer.h>
+#include <rho/refc.h>
+#include <rho/sync/tThread.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+using namespace rho;
+using std::cout;
+using std::endl;
+using std::vector;
+
+
+typedef sync::tLockFreePCQ<u32> tIntPCQ;
+
+
+const int kNumThingsToProduce = 100000;
+const int kNumProducers = 4;
+const int kNumConsumers = 10;
+
+
+u32 next(u32 val)
+{
+    return (val*27+13) % 32;   // stupid lcg, but good enough for this test
+}
+
+
+class tConsumeOne : public sync::iRunnable
+{
+    public:
+
+        tConsumeOne(u32 msleep, refc<tIntPCQ> pcq, bool* doneflag)
+            : m_msleep(msleep),
+              m_pcq(pcq),
+              m_doneflag(doneflag)
+        {
+        }
+
+        void run()
+        {
+            sync::tThread::msleep(m_msleep);
+            *m_doneflag = true;
+            m_pcq->pop();
+        }
+
+    private:
+
+        u32 m_msleep;
+        refc<tIntPCQ> m_pcq;
+        bool* m_doneflag;
+};
+
+
+class tConsumer : public sync::iRunnable
+{
+    public:
+
+        tConsumer(int numThingsToConsume, refc<tIntPCQ> pcq)
+            : m_numThingsToConsume(numThingsToConsume),
+              m_pcq(pcq),
+              m_sum(0)
+        {
+        }
+
+        void run()
+        {
+            for (int i = 0; i < m_numThingsToConsume; i++)
+                m_sum += m_pcq->pop();
+        }
+
+        u64 sum() const
+        {
+            return m_sum;
+        }
+
+    private:
+
+        int m_numThingsToConsume;
+        refc<tIntPCQ> m_pcq;
+        u64 m_sum;
+};
+
+
+class tProducer : public sync::iRunnable
+{
+    public:
+
+        tProducer(int numThingsToProduce, refc<tIntPCQ> pcq)
+            : m_numThingsToProduce(numThingsToProduce),
+              m_pcq(pcq)
+        {
+        }
+
+        void run()
+        {
+            for (int i = 0; i < m_numThingsToProduce; i++)
+                m_pcq->push((u32)i);
+        }
+
+    private:
+
+        int m_numThingsToProduce;
+        refc<tIntPCQ> m_pcq;
+};
+
+
+class tLCGProducer : public sync::iRunnable
+{
+    public:
+
+        tLCGProducer(int numThingsToProduce, refc<tIntPCQ> pcq)
+            : m_numThingsToProduce(numThingsToProduce),
+              m_pcq(pcq),
+              m_val(0)
+        {
+        }
+
+        void run()
+        {
+            for (int i = 0; i < m_numThingsToProduce; i++)
+            {
+                m_val = next(m_val);
+                m_pcq->push(m_val);
+            }
+        }
+
+    private:
+
+        int m_numThingsToProduce;
+        refc<tIntPCQ> m_pcq;
+        u32 m_val;
+};
+
+
+void capacityTest(const tTest& t)
+{
+    t.iseq((u32)2, tIntPCQ(1, sync::kThrow).capacity());
+    t.iseq((u32)2, tIntPCQ(2, sync::kThrow).capacity());
+    t.iseq((u32)4, tIntPCQ(3, sync::kThrow).capacity());
+    t.iseq((u32)16, tIntPCQ(10, sync::kThrow).capacity());
+    t.iseq((u32)1024, tIntPCQ(1024, sync::kThrow).capacity());
+
+    try
+    {
+        tIntPCQ q(0, sync::kBlock);
+        t.fail();
+    }
+    catch (eInvalidArgument& e)
+    {
+        // Yay!
+    }
+
+    try
+    {
+        tIntPCQ q(8, sync::kGrow);
+        t.fail();
+    }
+    catch (eInvalidArgument& e)
+    {
+        // Yay!
+    }
+}
+
+
+void discardTest(const tTest& t)
+{
+    u32 cap = 16;
+
+    tIntPCQ q(cap, sync::kDiscard);
+    t.iseq((u32)0, q.size());
+    t.iseq(cap, q.capacity());
+
+    for (u32 i = 0; i < cap; i++)
+    {
+        q.push(i);
+        t.iseq(i+1, q.size());
+    }
+
+    q.push(100);
+    t.iseq(cap, q.size());            // didn't change from above...
+
+    for (u32 i = 0; i < cap; i++)
+    {
+        u32 f = q.pop();
+        t.iseq(f, i);
+        t.iseq(cap-i-1, q.size());
+    }
+
+    t.iseq((u32)0, q.size());
+    t.iseq(cap, q.capacity());
+}
+
+
+void blockTest(const tTest& t)
+{
+    u32 cap = 16;
+
+    refc<tIntPCQ> q(new tIntPCQ(cap, sync::kBlock));
+
+    for (u32 i = 0; i < cap; i++)
+        q->push(i);
+    t.iseq(cap, q->size());
+
+    bool doneflag = false;
+
+    refc<sync::iRunnable> co(new tConsumeOne(100, q, &doneflag));
+    sync::tThread ct(co);
+
+    q->push(100);
+
+    t.iseq(doneflag, true);
+
+    ct.join();
+
+    for (u32 i = 1; i < cap; i++)
+        t.iseq(i, q->pop());
+    t.iseq((u32)100, q->pop());
+}
+
+
+void throwTest(const tTest& t)
+{
+    u32 cap = 16;
+
+    tIntPCQ q(cap, sync::kThrow);
+
+    for (u32 i = 0; i < cap; i++)
+        q.push(i);
+    t.iseq(cap, q.size());
+
+    try
+    {
+        q.push(10);
+        t.fail();
+    }
+    catch (eBufferOverflow& e)
+    {
+        // Yay!
+    }
+
+    t.iseq((u32)0, q.pop());
+    q.push(10);
+    t.iseq(cap, q.size());
+}
+
+
+void wrapAroundTest(const tTest& t)
+{
+    tIntPCQ q(4, sync::kThrow);
+    for (u32 i = 0; i < 1000; i++)
+    {
+        q.push(i);
+        q.push(i+1);
+        t.iseq(i, q.pop());
+        t.iseq(i+1, q.pop());
+        t.iseq((u32)0, q.size());
+    }
+}
+
+
+void releaseTest(const tTest& t)
+{
+    sync::tLockFreePCQ< refc<u32> > q(4, sync::kThrow);
+    refc<u32> r(new u32(42));
+    q.push(r);
+    t.iseq((u32)2, r.count());
+    refc<u32> p = q.pop();
+    t.iseq((u32)2, r.count());     // <-- the queue's slot no longer holds it
+    t.iseq((u32)42, *p);
+}
+
+
+void stressTest(const tTest& t, refc<tIntPCQ> pcq)
+{
+    vector< refc<sync::tThread> > consumerThreads, producerThreads;
+    vector<tConsumer*> consumers;
+
+    for (int i = 0; i < kNumConsumers; i++)
+    {
+        int numThingsToConsume = kNumThingsToProduce * kNumProducers / kNumConsumers;
+        tConsumer* consumer = new tConsumer(numThingsToConsume, pcq);
+        consumers.push_back(consumer);
+        refc<sync::tThread> consumerThread(new sync::tThread(refc<sync::iRunnable>(consumer)));
+        consumerThreads.push_back(consumerThread);
+    }
+
+    for (int i = 0; i < kNumProducers; i++)
+    {
+        refc<sync::iRunnable> producer(new tProducer(kNumThingsToProduce, pcq));
+        refc<sync::tThread> producerThread(new sync::tThread(producer));
+        producerThreads.push_back(producerThread);
+    }
+
+    u64 sum = 0;
+    for (int i = 0; i < kNumConsumers; i++)
+    {
+        consumerThreads[i]->join();
+        sum += consumers[i]->sum();
+    }
+    consumerThreads.clear();
+
+    for (int i = 0; i < kNumProducers; i++)
+    {
+        producerThreads[i]->join();
+    }
+    producerThreads.clear();
+
+    u64 expected = (u64)kNumProducers * (u64)kNumThingsToProduce
+                                      * (u64)(kNumThingsToProduce-1) / 2;
+    t.iseq(expected, sum);
+    t.iseq((u32)0, pcq->size());
+}
+
+
+void stressTest(const tTest& t)
+{
+    {
+        refc<tIntPCQ> pcq(new tIntPCQ(1, sync::kBlock));
+        stressTest(t, pcq);
+    }
+
+    {
+        refc<tIntPCQ> pcq(new tIntPCQ(64, sync::kBlock));
+        stressTest(t, pcq);
+    }
+}
+
+
+void orderTest(const tTest& t, refc<tIntPCQ> pcq)
+{
+    sync::tThread producerThread(refc<sync::iRunnable>(new tLCGProducer(kNumThingsToProduce, pcq)));
+
+    u32 val = 0;
+    for (int i = 0; i < kNumThingsToProduce; i++)
+    {
+        val = next(val);
+        u32 thing = pcq->pop();
+        t.iseq(val, thing);
+    }
+
+    producerThread.join();
+}
+
+
+void orderTest(const tTest& t)
+{
+    {
+        refc<tIntPCQ> pcq(new tIntPCQ(1, sync::kBlock));
+        orderTest(t, pcq);
+    }
+
+    {
+        refc<tIntPCQ> pcq(new tIntPCQ(32, sync::kBlock));
+        orderTest(t, pcq);
+    }
+}
+
+
+void popTimeoutTest(const tTest& t)
+{
+    tIntPCQ pcq(1, sync::kBlock);
+    bool didThrow = false;
+    u64 starttime = sync::tTimer::usecTime();
+    try
+    {
+        pcq.pop(11);   // <-- will block for 11 milliseconds, and then will throw
+        std::cerr << "Why didn't pop() throw here!?" << std::endl;
+        t.fail();
+    }
+    catch (sync::eQueueBlockingTimeoutExpired& e)
+    {
+        u64 endtime = sync::tTimer::usecTime();
+        u64 elapsed = endtime - starttime;
+        u64 elapsedMS = elapsed / 1000;
+
+        if (elapsedMS <= 9 || elapsedMS >= 25)
+            std::cerr << "elapsedMS: " << elapsedMS << std::endl;
+        t.assert(elapsedMS > 9);
+        t.assert(elapsedMS < 25);
+
+        didThrow = true;
+    }
+    t.assert(didThrow);
+
+    pcq.push(7);
+    t.iseq((u32)7, pcq.pop(11));
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    srand((u32)time(0));
+
+    tTest("Capacity test", capacityTest);
+    tTest("Discard test", discardTest);
+    tTest("Block test", blockTest);
+    tTest("Throw test", throwTest);
+    tTest("Wrap-around test", wrapAroundTest);
+    tTest("Release test", releaseTest);
+    tTest("Stress test", stressTest);
+    tTest("Order test", orderTest);
+    tTest("Pop with timeout test", popTimeoutTest, 100);
+
+    return 0;
+}
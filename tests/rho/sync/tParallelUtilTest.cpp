@@ -0,0 +1,144 @@
+#include <rho/sync/parallel_util.h>
+#include <rho/sync/tAtomicInt.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+
+#include <vector>
+
+
+using namespace rho;
+using std::vector;
+
+
+class tSquareFunctor
+{
+    public:
+
+        tSquareFunctor(vector<u64>& out, sync::au32& numCalls)
+            : m_out(out),
+              m_numCalls(numCalls)
+        {
+        }
+
+        void operator() (u32 begin, u32 end)
+        {
+            ++m_numCalls;
+            for (u32 i = begin; i < end; i++)
+                m_out[i] += (u64)i * i;
+        }
+
+    private:
+
+        vector<u64>& m_out;
+        sync::au32&  m_numCalls;
+};
+
+
+void simpleTest(const tTest& t)
+{
+    sync::tThreadPool pool(4);
+
+    for (u32 n = 0; n < 300; n += 7)
+    {
+        for (u32 grain = 1; grain < 40; grain += 5)
+        {
+            vector<u64> out(n, 0);
+            sync::au32 numCalls(0);
+            tSquareFunctor f(out, numCalls);
+            sync::parallelFor(pool, 0, n, grain, f);
+            for (u32 i = 0; i < n; i++)
+                t.iseq((u64)i * i, out[i]);       // <-- every index exactly once
+            if (n > 0)
+                t.assert(numCalls.val() >= (n + grain - 1) / grain);
+        }
+    }
+
+    vector<u64> out(10, 0);
+    sync::au32 numCalls(0);
+    tSquareFunctor f(out, numCalls);
+    sync::parallelFor(pool, 3, 7, 100, f);
+    t.iseq((u32)1, numCalls.val());
+    t.iseq((u64)0, out[2]);
+    t.iseq((u64)9, out[3]);
+    t.iseq((u64)36, out[6]);
+    t.iseq((u64)0, out[7]);
+
+    try
+    {
+        sync::parallelFor(pool, 0, 10, 0, f);
+        t.fail();
+    }
+    catch (eInvalidArgument& e)
+    {
+        // Yay!
+    }
+}
+
+
+class tNestedFunctor
+{
+    public:
+
+        tNestedFunctor(sync::tThreadPool& pool, vector<u64>& out, u32 numCols)
+            : m_pool(pool),
+              m_out(out),
+              m_numCols(numCols)
+        {
+        }
+
+        void operator() (u32 begin, u32 end)
+        {
+            for (u32 row = begin; row < end; row++)
+            {
+                tRowFunctor rf(m_out, row * m_numCols);
+                sync::parallelFor(m_pool, 0, m_numCols, 3, rf);
+            }
+        }
+
+    private:
+
+        class tRowFunctor
+        {
+            public:
+                tRowFunctor(vector<u64>& out, u32 offset) : m_out(out), m_offset(offset) { }
+                void operator() (u32 begin, u32 end)
+                {
+                    for (u32 i = begin; i < end; i++)
+                        m_out[m_offset + i] += m_offset + i;
+                }
+            private:
+                vector<u64>& m_out;
+                u32 m_offset;
+        };
+
+        sync::tThreadPool& m_pool;
+        vector<u64>& m_out;
+        u32 m_numCols;
+};
+
+
+void nestedTest(const tTest& t)
+{
+    // Every level blocks in wait(); with only two workers this would
+    // deadlock if waiting workers didn't help.
+    sync::tThreadPool pool(2);
+
+    u32 numRows = 64, numCols = 50;
+    vector<u64> out(numRows * numCols, 0);
+    tNestedFunctor f(pool, out, numCols);
+    sync::parallelFor(pool, 0, numRows, 1, f);
+
+    for (u32 i = 0; i < numRows * numCols; i++)
+        t.iseq((u64)i, out[i]);
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("parallelFor() simple test", simpleTest);
+    tTest("parallelFor() nested test", nestedTest, 10);
+
+    return 0;
+}
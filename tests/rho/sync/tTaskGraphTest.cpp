@@ -0,0 +1,221 @@
+#include <rho/sync/tTaskGraph.h>
+#include <rho/sync/tAtomicInt.h>
+#include <rho/bNonCopyable.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+
+#include <vector>
+
+
+using namespace rho;
+using std::vector;
+
+
+class tRecordTask : public sync::iRunnable, public bNonCopyable
+{
+    public:
+
+        tRecordTask(u32 id, sync::au32* clock, vector<u32>* finishTimes)
+            : m_id(id),
+              m_clock(clock),
+              m_finishTimes(finishTimes)
+        {
+        }
+
+        void run()
+        {
+            (*m_finishTimes)[m_id] = ++(*m_clock);
+        }
+
+    private:
+
+        u32 m_id;
+        sync::au32* m_clock;
+        vector<u32>* m_finishTimes;
+};
+
+
+class tThrowTask : public sync::iRunnable
+{
+    public:
+
+        void run()
+        {
+            throw eRuntimeError("(This error is expected by the test.)");
+        }
+};
+
+
+void diamondTest(const tTest& t)
+{
+    sync::tThreadPool pool(4);
+
+    /*
+     *        0
+     *      / | \
+     *     1  2  3
+     *      \ | /
+     *        4
+     */
+    sync::au32 clock(0);
+    vector<u32> finished(5, 0);
+    sync::tTaskGraph g;
+    for (u32 i = 0; i < 5; i++)
+        t.iseq(i, g.add(refc<sync::iRunnable>(new tRecordTask(i, &clock, &finished))));
+    g.addDependency(0, 1);
+    g.addDependency(0, 2);
+    g.addDependency(0, 3);
+    g.addDependency(1, 4);
+    g.addDependency(2, 4);
+    g.addDependency(3, 4);
+    t.iseq((u32)5, g.size());
+
+    for (u32 run = 0; run < 50; run++)
+    {
+        g.run(pool);
+        t.assert(finished[0] < finished[1]);
+        t.assert(finished[0] < finished[2]);
+        t.assert(finished[0] < finished[3]);
+        t.assert(finished[1] < finished[4]);
+        t.assert(finished[2] < finished[4]);
+        t.assert(finished[3] < finished[4]);
+    }
+    t.iseq((u32)250, clock.val());
+}
+
+
+void chainTest(const tTest& t)
+{
+    sync::tThreadPool pool(3);
+
+    const u32 kLength = 500;
+    sync::au32 clock(0);
+    vector<u32> finished(kLength, 0);
+    sync::tTaskGraph g;
+    for (u32 i = 0; i < kLength; i++)
+    {
+        g.add(refc<sync::iRunnable>(new tRecordTask(i, &clock, &finished)));
+        if (i > 0)
+            g.addDependency(i-1, i);
+    }
+    g.run(pool);
+    for (u32 i = 0; i < kLength; i++)
+        t.iseq(i+1, finished[i]);
+}
+
+
+class tSubGraphTask : public sync::iRunnable, public bNonCopyable
+{
+    public:
+
+        tSubGraphTask(sync::tThreadPool* pool, sync::au32* counter)
+            : m_pool(pool),
+              m_counter(counter)
+        {
+        }
+
+        void run()
+        {
+            vector<u32> finished(10, 0);
+            sync::tTaskGraph g;
+            for (u32 i = 0; i < 10; i++)
+                g.add(refc<sync::iRunnable>(new tRecordTask(i, m_counter, &finished)));
+            for (u32 i = 1; i < 10; i++)
+                g.addDependency(0, i);
+            g.run(*m_pool);
+        }
+
+    private:
+
+        sync::tThreadPool* m_pool;
+        sync::au32* m_counter;
+};
+
+
+void nestedTest(const tTest& t)
+{
+    sync::tThreadPool pool(2);
+
+    sync::au32 counter(0);
+    sync::tTaskGraph g;
+    for (u32 i = 0; i < 20; i++)
+        g.add(refc<sync::iRunnable>(new tSubGraphTask(&pool, &counter)));
+    g.run(pool);
+    t.iseq((u32)200, counter.val());
+}
+
+
+void errorTest(const tTest& t)
+{
+    sync::tThreadPool pool(2);
+
+    sync::au32 clock(0);
+    vector<u32> finished(3, 0);
+
+    {
+        sync::tTaskGraph g;
+        g.add(refc<sync::iRunnable>(new tRecordTask(0, &clock, &finished)));
+        g.add(refc<sync::iRunnable>(new tRecordTask(1, &clock, &finished)));
+        g.add(refc<sync::iRunnable>(new tRecordTask(2, &clock, &finished)));
+        g.addDependency(0, 1);
+        g.addDependency(1, 2);
+        g.addDependency(2, 0);
+        try
+        {
+            g.run(pool);
+            t.fail();
+        }
+        catch (eInvalidArgument& e)
+        {
+            // Yay!
+        }
+        t.iseq((u32)0, clock.val());
+
+        try
+        {
+            g.addDependency(1, 1);
+            t.fail();
+        }
+        catch (eInvalidArgument& e)
+        {
+            // Yay!
+        }
+
+        try
+        {
+            g.addDependency(1, 3);
+            t.fail();
+        }
+        catch (eInvalidArgument& e)
+        {
+            // Yay!
+        }
+    }
+
+    {
+        sync::tTaskGraph g;
+        g.add(refc<sync::iRunnable>(new tThrowTask));
+        g.add(refc<sync::iRunnable>(new tRecordTask(1, &clock, &finished)));
+        g.addDependency(0, 1);
+        g.run(pool);
+        t.iseq((u32)1, clock.val());
+    }
+
+    {
+        sync::tTaskGraph g;
+        g.run(pool);        // <-- an empty graph is fine
+    }
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("tTaskGraph diamond test", diamondTest);
+    tTest("tTaskGraph chain test", chainTest);
+    tTest("tTaskGraph nested test", nestedTest, 10);
+    tTest("tTaskGraph error test", errorTest);
+
+    return 0;
+}
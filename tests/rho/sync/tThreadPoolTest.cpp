@@ -1,4 +1,5 @@
 #include <rho/sync/tThreadPool.h>
+#include <rho/sync/tAtomicInt.h>
 #include <rho/bNonCopyable.h>
 #include <rho/tCrashReporter.h>
 #include <rho/tTest.h>
@@ -121,6 +122,126 @@ void shortPoolTest(const tTest& t)
 }
 
 
+class tCountTask : public sync::iRunnable, public bNonCopyable
+{
+    public:
+
+        tCountTask(sync::au32* counter)
+            : m_counter(counter)
+        {
+        }
+
+        void run()
+        {
+            ++(*m_counter);
+        }
+
+    private:
+
+        sync::au32* m_counter;
+};
+
+
+class tSpawnTask : public sync::iRunnable, public bNonCopyable
+{
+    public:
+
+        tSpawnTask(sync::tThreadPool* pool, u32 numChildren, sync::au32* counter)
+            : m_pool(pool),
+              m_numChildren(numChildren),
+              m_counter(counter)
+        {
+        }
+
+        void run()
+        {
+            for (u32 i = 0; i < m_numChildren; i++)
+            {
+                refc<sync::iRunnable> child(new tCountTask(m_counter));
+                m_pool->forget(m_pool->push(child));
+            }
+        }
+
+    private:
+
+        sync::tThreadPool* m_pool;
+        u32 m_numChildren;
+        sync::au32* m_counter;
+};
+
+
+void nestedPushTest(const tTest& t)
+{
+    const u32 kNumParents = 100;
+    const u32 kNumChildren = 100;
+
+    sync::au32 counter(0);
+
+    {
+        sync::tThreadPool pool(4);
+
+        std::vector< sync::tThreadPool::tTaskKey > keys;
+        for (u32 i = 0; i < kNumParents; i++)
+        {
+            refc<sync::iRunnable> parent(new tSpawnTask(&pool, kNumChildren, &counter));
+            keys.push_back(pool.push(parent));
+        }
+        for (u32 i = 0; i < kNumParents; i++)
+            pool.wait(keys[i]);
+
+        // The destructor finishes every child task still in the deques.
+    }
+
+    t.iseq(kNumParents * kNumChildren, counter.val());
+}
+
+
+void forgetTest(const tTest& t)
+{
+    sync::au32 counter(0);
+    sync::tThreadPool pool(3);
+
+    for (u32 round = 0; round < 20; round++)
+    {
+        std::vector< sync::tThreadPool::tTaskKey > keys;
+        for (u32 i = 0; i < 500; i++)
+            keys.push_back(pool.push(refc<sync::iRunnable>(new tCountTask(&counter))));
+        for (u32 i = 0; i < keys.size(); i++)
+        {
+            if (i % 2)
+                pool.forget(keys[i]);
+            else
+                pool.wait(keys[i]);
+        }
+    }
+
+    sync::tThreadPool::tTaskKey key = pool.push(refc<sync::iRunnable>(new tCountTask(&counter)));
+    pool.wait(key);
+    try
+    {
+        pool.wait(key);      // <-- already waited on
+        t.fail();
+    }
+    catch (eRuntimeError& e)
+    {
+        // Yay!
+    }
+
+    try
+    {
+        pool.wait(0xFFFFFFFFFFFFULL);
+        t.fail();
+    }
+    catch (eInvalidArgument& e)
+    {
+        // Yay!
+    }
+
+    while (counter.val() != 20*500 + 1)
+        sync::tThread::yield();
+}
+
+
 int main()
 {
     tCrashReporter::init();
@@ -128,6 +249,8 @@ int main()
 
     tTest("tThreadPool long-worker test", longPoolTest);
     tTest("tThreadPool short-worker test", shortPoolTest, kNumRepeatTests);
+    tTest("tThreadPool nested push test", nestedPushTest);
+    tTest("tThreadPool forget test", forgetTest);
 
     return 0;
 }
@@ -0,0 +1,331 @@
+#include <rho/sync/tTimerService.h>
+#include <rho/sync/tTimer.h>
+#include <rho/sync/tAtomicInt.h>
+#include <rho/bNonCopyable.h>
+#include <rho/tCrashReporter.h>
+#include <rho/tTest.h>
+
+#include <vector>
+
+
+using namespace rho;
+using std::vector;
+
+
+class tCountingObserver : public sync::iTimerObserver, public bNonCopyable
+{
+    public:
+
+        tCountingObserver(u32 numCalls)
+            : m_numCalls(numCalls),
+              m_count(0),
+              m_startTime(sync::tTimer::usecTime()),
+              m_firstCallTime(0),
+              m_lastCallTime(0),
+              m_numInits(0),
+              m_numEnds(0)
+        {
+        }
+
+        bool timerAlert(u64 timerPeriod)
+        {
+            m_lastCallTime = sync::tTimer::usecTime();
+            if (m_count.val() == 0)
+                m_firstCallTime = m_lastCallTime;
+            return (++m_count < m_numCalls);
+        }
+
+        void timerThreadInit() { ++m_numInits; }
+        void timerThreadEnd()  { ++m_numEnds; }
+
+        u32              m_numCalls;
+        sync::au32       m_count;
+        u64              m_startTime;
+        u64              m_firstCallTime;
+        u64              m_lastCallTime;
+        sync::au32       m_numInits;
+        sync::au32       m_numEnds;
+};
+
+
+class tSelfCancellingObserver : public sync::iTimerObserver
+{
+    public:
+
+        tSelfCancellingObserver(sync::tTimerService& service)
+            : m_service(service), m_id(0), m_count(0), m_cancelResult(false)
+        {
+        }
+
+        bool timerAlert(u64 timerPeriod)
+        {
+            ++m_count;
+            m_cancelResult = m_service.cancel(m_id);
+            return true;
+        }
+
+        sync::tTimerService& m_service;
+        sync::tTimerService::tTimerId m_id;
+        sync::au32 m_count;
+        bool m_cancelResult;
+};
+
+
+/*
+ * Notes which thread each of its methods is called on.
+ */
+class tThreadNotingObserver : public sync::iTimerObserver
+{
+    public:
+
+        tThreadNotingObserver() : m_count(0), m_sameThread(true) { }
+
+        void timerThreadInit() { m_initThread = pthread_self(); }
+
+        bool timerAlert(u64 timerPeriod)
+        {
+            if (!pthread_equal(m_initThread, pthread_self()))
+                m_sameThread = false;
+            ++m_count;
+            return true;
+        }
+
+        void timerThreadEnd()
+        {
+            if (!pthread_equal(m_initThread, pthread_self()))
+                m_sameThread = false;
+            m_endThread = pthread_self();
+        }
+
+        pthread_t  m_initThread;
+        pthread_t  m_endThread;
+        sync::au32 m_count;
+        bool       m_sameThread;
+};
+
+
+class tThrowingObserver : public sync::iTimerObserver
+{
+    public:
+
+        tThrowingObserver() : m_count(0) { }
+
+        bool timerAlert(u64 timerPeriod)
+        {
+            ++m_count;
+            throw eRuntimeError("(This error is expected by the test.)");
+        }
+
+        sync::au32 m_count;
+};
+
+
+class tSlowObserver : public sync::iTimerObserver
+{
+    public:
+
+        tSlowObserver() : m_inside(0), m_count(0) { }
+
+        bool timerAlert(u64 timerPeriod)
+        {
+            ++m_inside;
+            sync::tThread::msleep(50);
+            ++m_count;
+            --m_inside;
+            return true;
+        }
+
+        sync::au32 m_inside;
+        sync::au32 m_count;
+};
+
+
+void periodicTest(const tTest& t)
+{
+    sync::tTimerService service;
+    tCountingObserver obs(10);
+    sync::tTimerService::tTimerId id = service.schedule(&obs, 5000);
+    t.iseq(service.size(), (u32)1);
+
+    while (obs.m_count.val() < 10)
+        sync::tThread::msleep(5);
+    sync::tThread::msleep(30);
+
+    t.iseq(obs.m_count.val(), (u32)10);
+    t.iseq(service.size(), (u32)0);
+    t.reject(service.cancel(id));                  // it already stopped itself
+    t.assert(obs.m_firstCallTime - obs.m_startTime >= 5000);
+    t.assert(obs.m_lastCallTime - obs.m_startTime >= 50000);
+    t.iseq(obs.m_numInits.val(), (u32)1);
+    t.iseq(obs.m_numEnds.val(), (u32)1);
+}
+
+
+void levelsTest(const tTest& t)
+{
+    // With a 100us tick these span the bottom three levels of the wheel.
+    sync::tTimerService service(100);
+    u64 periods[] = { 1000, 20000, 25600, 25700, 60000, 200000, 1700000 };
+    u32 numPeriods = sizeof(periods) / sizeof(periods[0]);
+
+    vector<tCountingObserver*> observers;
+    for (u32 i = 0; i < numPeriods; i++)
+    {
+        observers.push_back(new tCountingObserver(1));
+        service.schedule(observers.back(), periods[i]);
+    }
+
+    while (service.size() > 0)
+        sync::tThread::msleep(10);
+
+    for (u32 i = 0; i < numPeriods; i++)
+    {
+        t.iseq(observers[i]->m_count.val(), (u32)1);
+        u64 elapsed = observers[i]->m_firstCallTime - observers[i]->m_startTime;
+        t.assert(elapsed >= periods[i]);              // never early
+        t.assert(elapsed < periods[i] + 500000);      // and not terribly late
+        delete observers[i];
+    }
+}
+
+
+void cancelTest(const tTest& t)
+{
+    sync::tTimerService service;
+
+    vector<tCountingObserver*> observers;
+    vector<sync::tTimerService::tTimerId> ids;
+    for (u32 i = 0; i < 1000; i++)
+    {
+        observers.push_back(new tCountingObserver(1));
+        u64 period = 1000000 + ((u64)i) * 3600000000ULL;       // up to ~41 days
+        ids.push_back(service.schedule(observers.back(), period));
+    }
+    t.iseq(service.size(), (u32)1000);
+
+    for (u32 i = 0; i < ids.size(); i += 2)
+        t.assert(service.cancel(ids[i]));
+    t.iseq(service.size(), (u32)500);
+    for (u32 i = 0; i < ids.size(); i += 2)
+        t.reject(service.cancel(ids[i]));
+    for (u32 i = 1; i < ids.size(); i += 2)
+        t.assert(service.cancel(ids[i]));
+    t.iseq(service.size(), (u32)0);
+
+    for (u32 i = 0; i < observers.size(); i++)
+    {
+        t.iseq(observers[i]->m_count.val(), (u32)0);
+        delete observers[i];
+    }
+
+    t.reject(service.cancel(12345));
+}
+
+
+void cancelFromObserverTest(const tTest& t)
+{
+    sync::tTimerService service;
+    tSelfCancellingObserver obs(service);
+    obs.m_id = service.schedule(&obs, 20000);
+    sync::tThread::msleep(100);
+    t.iseq(obs.m_count.val(), (u32)1);
+    t.assert(obs.m_cancelResult);
+    t.iseq(service.size(), (u32)0);
+}
+
+
+void cancelWhileRunningTest(const tTest& t)
+{
+    sync::tTimerService service;
+    tSlowObserver obs;
+    sync::tTimerService::tTimerId id = service.schedule(&obs, 1000);
+    while (obs.m_inside.val() == 0)
+        sync::tThread::msleep(1);
+    t.assert(service.cancel(id));
+    t.iseq(obs.m_inside.val(), (u32)0);            // cancel() waited for it
+    u32 count = obs.m_count.val();
+    sync::tThread::msleep(100);
+    t.iseq(obs.m_count.val(), count);
+}
+
+
+void throwTest(const tTest& t)
+{
+    sync::tTimerService service;
+    tThrowingObserver obs;
+    service.schedule(&obs, 1000);
+    sync::tThread::msleep(50);
+    t.iseq(obs.m_count.val(), (u32)1);
+    t.iseq(service.size(), (u32)0);
+}
+
+
+void timerTest(const tTest& t)
+{
+    tCountingObserver obs(5);
+    sync::tTimer timer(&obs, 2000);
+    t.assert(timer.getObserver() == &obs);
+    t.iseq(timer.getPeriod(), (u64)2000);
+    while (!timer.isStopped())
+        sync::tThread::msleep(5);
+    t.iseq(obs.m_count.val(), (u32)5);
+    t.iseq(obs.m_numInits.val(), (u32)1);
+    t.iseq(obs.m_numEnds.val(), (u32)1);
+    timer.stop();
+    t.iseq(obs.m_numEnds.val(), (u32)1);
+}
+
+
+void timerStopTest(const tTest& t)
+{
+    sync::tTimerService service;
+    tCountingObserver obs(1000000);
+    {
+        sync::tTimer timer(&obs, 1000, service);
+        while (obs.m_count.val() < 3)
+            sync::tThread::msleep(1);
+        t.reject(timer.isStopped());
+        timer.stop();
+        t.assert(timer.isStopped());
+    }
+    u32 count = obs.m_count.val();
+    sync::tThread::msleep(20);
+    t.iseq(obs.m_count.val(), count);
+    t.iseq(obs.m_numInits.val(), (u32)1);
+    t.iseq(obs.m_numEnds.val(), (u32)1);
+    t.iseq(service.size(), (u32)0);
+}
+
+
+void timerThreadHooksTest(const tTest& t)
+{
+    // Stopping the timer from this thread still tears down on the
+    // service thread, and before stop() returns.
+    sync::tTimerService service;
+    tThreadNotingObserver obs;
+    sync::tTimer timer(&obs, 1000, service);
+    while (obs.m_count.val() < 3)
+        sync::tThread::msleep(1);
+    timer.stop();
+    t.assert(obs.m_sameThread);
+    t.reject(pthread_equal(obs.m_endThread, pthread_self()));
+    t.assert(timer.isStopped());
+}
+
+
+int main()
+{
+    tCrashReporter::init();
+
+    tTest("Periodic test", periodicTest);
+    tTest("Wheel levels test", levelsTest);
+    tTest("Cancel test", cancelTest);
+    tTest("Cancel from observer test", cancelFromObserverTest);
+    tTest("Cancel while running test", cancelWhileRunningTest);
+    tTest("Throwing observer test", throwTest);
+    tTest("tTimer test", timerTest);
+    tTest("tTimer stop test", timerStopTest);
+    tTest("tTimer thread hooks test", timerThreadHooksTest);
+
+    return 0;
+}